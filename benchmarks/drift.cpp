@@ -0,0 +1,241 @@
+#include <CLI11.hpp>
+
+#include "audiograph.h"
+#include "inputnode.h"
+#include "logger.h"
+#include "outputnode.h"
+#include "streamconfig.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <vector>
+
+using namespace miniaudioengine;
+using namespace miniaudioengine::dataplane;
+
+namespace
+{
+
+constexpr unsigned int CHANNELS = 2;
+constexpr double PI = 3.14159265358979323846;
+constexpr double TONE_HZ = 440.0;
+constexpr float TONE_AMPLITUDE = 0.5f;
+
+/** @struct DriftOptions
+ *  @brief The two clocks the drift run simulates and the limits it must stay within.
+ */
+struct DriftOptions
+{
+  double drift_ppm{80.0}; // How much faster the capture clock runs than the playback clock
+  unsigned int seconds{3600};
+  unsigned int input_frames{256};
+  unsigned int input_rate{48000};
+  unsigned int frames{128};
+  unsigned int sample_rate{48000};
+  unsigned int ring_blocks{8};
+  unsigned int settle_seconds{120}; // Start-up the controller may spend converging, not checked
+  unsigned int report_seconds{600};
+  double max_error_ppm{2.0}; // Largest distance of the mean estimate from the simulated drift
+  bool compensate{true};
+};
+
+/** @struct DriftResult
+ *  @brief What the run saw after the settle time.
+ */
+struct DriftResult
+{
+  unsigned long long underruns{0};
+  unsigned long long overflows{0};
+  size_t min_fill{std::numeric_limits<size_t>::max()};
+  size_t max_fill{0};
+  double max_step{0.0}; // Largest difference between consecutive output samples
+
+  // The estimate swings with the beat of the capture blocks against the playback blocks, so it is averaged
+  double drift_ppm{0.0};
+  double min_drift_ppm{std::numeric_limits<double>::max()};
+  double max_drift_ppm{std::numeric_limits<double>::lowest()};
+};
+
+/** @brief Render the capture ring through the AudioGraph on simulated time. A capture device writes blocks
+ *  of a sine on its own clock, the playback device reads blocks on the graph's. Whichever is due next runs,
+ *  so hours of drift take seconds and every run is repeatable.
+ */
+DriftResult run(const DriftOptions &options)
+{
+  framework::StreamConfig config;
+  config.frames_per_buffer = options.frames;
+  config.sample_rate = options.sample_rate;
+  config.ring_capacity_blocks = options.ring_blocks;
+
+  AudioGraph graph;
+  auto output = graph.add_output_node(nullptr);
+  auto input = graph.add_input_node(nullptr, output);
+  auto ring = std::make_shared<framework::Buffer>(config.get_ring_capacity(CHANNELS));
+  input->set_source(ring, CHANNELS, options.input_rate);
+  input->set_drift_compensation(options.compensate);
+  if (!graph.compile(CHANNELS, options.frames, options.sample_rate))
+  {
+    std::cerr << "Error: AudioGraph failed to compile" << std::endl;
+    std::exit(1);
+  }
+
+  std::vector<float> captured(static_cast<size_t>(options.input_frames) * CHANNELS);
+  std::vector<float> played(static_cast<size_t>(options.frames) * CHANNELS);
+  const double capture_period = options.input_frames / (options.input_rate * (1.0 + options.drift_ppm * 1e-6));
+  const double playback_period = static_cast<double>(options.frames) / options.sample_rate;
+  const double phase_increment = 2.0 * PI * TONE_HZ / options.input_rate;
+
+  // The capture stream starts a little after playback, as two devices opened one after the other do
+  double capture_time = 0.003;
+  double playback_time = 0.0;
+  double phase = 0.0;
+  double next_report = options.report_seconds;
+  unsigned long long settled_underruns = 0;
+  unsigned long long settled_blocks = 0;
+  double drift_sum = 0.0;
+  bool settled = false;
+  float last_sample = 0.0f;
+
+  DriftResult result;
+  while (playback_time < options.seconds)
+  {
+    if (capture_time <= playback_time)
+    {
+      for (unsigned int frame = 0; frame < options.input_frames; frame++)
+      {
+        const float sample = TONE_AMPLITUDE * static_cast<float>(std::sin(phase));
+        std::fill_n(captured.begin() + frame * CHANNELS, CHANNELS, sample);
+        phase = std::fmod(phase + phase_increment, 2.0 * PI);
+      }
+      if (ring->write(captured) < captured.size() && settled)
+      {
+        result.overflows++;
+      }
+      capture_time += capture_period;
+      continue;
+    }
+
+    if (!settled && playback_time >= options.settle_seconds)
+    {
+      settled = true;
+      settled_underruns = input->get_underrun_count();
+    }
+
+    const size_t fill = ring->size() / CHANNELS;
+    graph.process(played.data(), options.frames);
+    for (unsigned int frame = 0; frame < options.frames; frame++)
+    {
+      const float sample = played[frame * CHANNELS];
+      if (settled)
+      {
+        result.max_step = std::max(result.max_step, static_cast<double>(std::fabs(sample - last_sample)));
+      }
+      last_sample = sample;
+    }
+    if (settled)
+    {
+      const double drift_ppm = input->get_drift_ppm();
+      drift_sum += drift_ppm;
+      settled_blocks++;
+      result.min_drift_ppm = std::min(result.min_drift_ppm, drift_ppm);
+      result.max_drift_ppm = std::max(result.max_drift_ppm, drift_ppm);
+      result.min_fill = std::min(result.min_fill, fill);
+      result.max_fill = std::max(result.max_fill, fill);
+    }
+    playback_time += playback_period;
+
+    if (options.report_seconds > 0 && playback_time >= next_report)
+    {
+      std::cout << "[" << static_cast<unsigned long long>(next_report) << " s] Fill=" << fill
+                << ", Drift=" << input->get_drift_ppm() << " ppm, Underruns=" << input->get_underrun_count() << std::endl;
+      next_report += options.report_seconds;
+    }
+  }
+
+  result.underruns = settled ? input->get_underrun_count() - settled_underruns : 0;
+  result.drift_ppm = settled_blocks > 0 ? drift_sum / static_cast<double>(settled_blocks) : 0.0;
+  return result;
+}
+
+/** @brief Returns true if the run stayed within every limit. Prints each failure. */
+bool check(const DriftResult &result, const DriftOptions &options)
+{
+  bool passed = true;
+  if (result.underruns > 0 || result.overflows > 0)
+  {
+    std::cout << "FAIL: " << result.underruns << " reads ran the ring dry and " << result.overflows
+              << " writes overflowed it after the settle time" << std::endl;
+    passed = false;
+  }
+
+  // A sine never steps further between two output samples than its slope allows, a dropout or skip does
+  const double max_step = TONE_AMPLITUDE * 2.0 * PI * TONE_HZ / options.sample_rate * 1.1;
+  if (result.max_step > max_step)
+  {
+    std::cout << "FAIL: The output stepped by " << result.max_step << ", a sine of this rate steps by at most "
+              << max_step << std::endl;
+    passed = false;
+  }
+
+  if (options.compensate && std::fabs(result.drift_ppm - options.drift_ppm) > options.max_error_ppm)
+  {
+    std::cout << "FAIL: Estimated a drift of " << result.drift_ppm << " ppm, simulated " << options.drift_ppm
+              << " ppm" << std::endl;
+    passed = false;
+  }
+  return passed;
+}
+
+} // namespace
+
+/** @brief Headless drift run: a capture ring written on one simulated device clock and read through the
+ *  AudioGraph on another that drifts against it. Exits non-zero if the ring ran dry or overflowed after the
+ *  settle time, the output had a discontinuity, or the mean drift estimate is away from the simulated drift.
+ */
+int main(int argc, char **argv)
+{
+  DriftOptions options;
+  bool no_compensation = false;
+  bool verbose = false;
+
+  CLI::App app{"drift - Render a capture ring across two drifting device clocks and fail on dropouts"};
+  argv = app.ensure_utf8(argv);
+  app.add_option("--drift-ppm", options.drift_ppm, "Drift of the capture clock against the playback clock")->capture_default_str();
+  app.add_option("--seconds", options.seconds, "Simulated length of the run")->capture_default_str();
+  app.add_option("--input-frames", options.input_frames, "Frames per capture block")->capture_default_str();
+  app.add_option("--input-rate", options.input_rate, "Capture sample rate in Hz")->capture_default_str();
+  app.add_option("--frames", options.frames, "Frames per playback block")->capture_default_str();
+  app.add_option("--sample-rate", options.sample_rate, "Playback sample rate in Hz")->capture_default_str();
+  app.add_option("--ring-blocks", options.ring_blocks, "Capture ring capacity, in playback blocks")->capture_default_str();
+  app.add_option("--settle-seconds", options.settle_seconds, "Start-up left unchecked")->capture_default_str();
+  app.add_option("--report-seconds", options.report_seconds, "Simulated interval between progress reports, 0 for none")->capture_default_str();
+  app.add_option("--max-error-ppm", options.max_error_ppm, "Largest error of the final drift estimate")->capture_default_str();
+  app.add_flag("--no-compensation", no_compensation, "Read the ring at the nominal rate, to see the drift it cancels");
+  app.add_flag("--verbose", verbose, "Enable engine logging");
+  CLI11_PARSE(app, argc, argv);
+  options.compensate = !no_compensation;
+
+  framework::Logger::instance().enable_console_output(verbose);
+
+  std::cout << "Simulating " << options.seconds << " s of " << options.drift_ppm << " ppm drift, capturing "
+            << options.input_frames << " frames at " << options.input_rate << " Hz, playing " << options.frames
+            << " frames at " << options.sample_rate << " Hz" << (options.compensate ? "" : " without compensation")
+            << std::endl;
+
+  const DriftResult result = run(options);
+  std::cout << "Drift=" << result.drift_ppm << " ppm [" << result.min_drift_ppm << ", " << result.max_drift_ppm
+            << "], Underruns=" << result.underruns
+            << ", Overflows=" << result.overflows << ", Fill=[" << result.min_fill << ", " << result.max_fill
+            << "], MaxStep=" << result.max_step << std::endl;
+  if (!check(result, options))
+  {
+    std::cout << "Drift FAILED" << std::endl;
+    return 1;
+  }
+  std::cout << "Drift passed" << std::endl;
+  return 0;
+}
@@ -0,0 +1,215 @@
+#include <benchmark/benchmark.h>
+
+#include "dspkernels.h"
+#include "resampler.h"
+#include "sampleformat.h"
+
+#include <cstdint>
+#include <vector>
+
+using namespace miniaudioengine::framework;
+
+namespace
+{
+
+/** Runs a kernel benchmark on one instruction set, skipping levels this CPU or build lacks. */
+bool select_level(benchmark::State &state, int64_t level)
+{
+  if (!dsp::set_simd_level(static_cast<dsp::eSimdLevel>(level)))
+  {
+    state.SkipWithError("Instruction set not supported");
+    return false;
+  }
+  state.SetLabel(dsp::to_string(static_cast<dsp::eSimdLevel>(level)));
+  return true;
+}
+
+void restore_level()
+{
+  dsp::set_simd_level(dsp::get_best_simd_level());
+}
+
+void kernel_args(benchmark::internal::Benchmark *benchmark)
+{
+  for (int64_t level : {static_cast<int64_t>(dsp::eSimdLevel::Scalar),
+                        static_cast<int64_t>(dsp::eSimdLevel::SSE2),
+                        static_cast<int64_t>(dsp::eSimdLevel::AVX2),
+                        static_cast<int64_t>(dsp::eSimdLevel::NEON)})
+  {
+    for (int64_t n : {64, 256, 1024})
+    {
+      benchmark->Args({n, level});
+    }
+  }
+  benchmark->ArgNames({"n", "simd"});
+}
+
+void BM_MixAdd(benchmark::State &state)
+{
+  const size_t n = static_cast<size_t>(state.range(0));
+  std::vector<float> destination(n, 0.0f);
+  std::vector<float> source(n, 0.5f);
+  if (!select_level(state, state.range(1)))
+  {
+    return;
+  }
+
+  for (auto _ : state)
+  {
+    dsp::add(destination.data(), source.data(), n);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+  restore_level();
+}
+BENCHMARK(BM_MixAdd)->Apply(kernel_args);
+
+void BM_MixAddWithGain(benchmark::State &state)
+{
+  const size_t n = static_cast<size_t>(state.range(0));
+  std::vector<float> destination(n, 0.0f);
+  std::vector<float> source(n, 0.5f);
+  if (!select_level(state, state.range(1)))
+  {
+    return;
+  }
+
+  for (auto _ : state)
+  {
+    dsp::add_with_gain(destination.data(), source.data(), 0.7f, n);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+  restore_level();
+}
+BENCHMARK(BM_MixAddWithGain)->Apply(kernel_args);
+
+void BM_GainRamp(benchmark::State &state)
+{
+  const size_t n = static_cast<size_t>(state.range(0));
+  std::vector<float> buffer(n, 0.5f);
+  std::vector<float> gains(n, 0.0f);
+  if (!select_level(state, state.range(1)))
+  {
+    return;
+  }
+
+  for (auto _ : state)
+  {
+    dsp::fill_exponential_ramp(gains.data(), 0.5f, 1.0001f, n);
+    dsp::multiply(buffer.data(), gains.data(), n);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+  restore_level();
+}
+BENCHMARK(BM_GainRamp)->Apply(kernel_args);
+
+void BM_MixAddPanned(benchmark::State &state)
+{
+  const size_t n = static_cast<size_t>(state.range(0));
+  std::vector<float> left(n, 0.0f);
+  std::vector<float> right(n, 0.0f);
+  std::vector<float> source(n, 0.5f);
+  if (!select_level(state, state.range(1)))
+  {
+    return;
+  }
+
+  const dsp::PanGains gains = dsp::constant_power_pan(0.3f);
+  for (auto _ : state)
+  {
+    dsp::add_panned(left.data(), right.data(), source.data(), gains, n);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+  restore_level();
+}
+BENCHMARK(BM_MixAddPanned)->Apply(kernel_args);
+
+void BM_InterleaveStereo(benchmark::State &state)
+{
+  const size_t n = static_cast<size_t>(state.range(0));
+  std::vector<float> destination(n * 2);
+  std::vector<float> left(n, 0.25f);
+  std::vector<float> right(n, 0.5f);
+  if (!select_level(state, state.range(1)))
+  {
+    return;
+  }
+
+  for (auto _ : state)
+  {
+    dsp::interleave_stereo(destination.data(), left.data(), right.data(), n);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+  restore_level();
+}
+BENCHMARK(BM_InterleaveStereo)->Apply(kernel_args);
+
+void BM_FloatToInt16(benchmark::State &state)
+{
+  const size_t n = static_cast<size_t>(state.range(0));
+  std::vector<int16_t> destination(n);
+  std::vector<float> source(n, 0.5f);
+  if (!select_level(state, state.range(1)))
+  {
+    return;
+  }
+
+  for (auto _ : state)
+  {
+    dsp::float_to_int16(destination.data(), source.data(), n);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+  restore_level();
+}
+BENCHMARK(BM_FloatToInt16)->Apply(kernel_args);
+
+// Converts a 256 frame stereo block to each device format, as an integer device's callback does
+void BM_DeviceFormat(benchmark::State &state)
+{
+  const eSampleFormat format = static_cast<eSampleFormat>(state.range(0));
+  constexpr size_t n = 256 * 2;
+  const dsp::SampleFormatKernels &kernels = dsp::get_format_kernels(format);
+  std::vector<uint8_t> destination(n * get_bytes_per_sample(format));
+  std::vector<float> source(n, 0.5f);
+  state.SetLabel(to_string(format));
+
+  for (auto _ : state)
+  {
+    kernels.from_float(destination.data(), source.data(), n);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+}
+BENCHMARK(BM_DeviceFormat)->DenseRange(static_cast<int64_t>(eSampleFormat::Int16),
+                                       static_cast<int64_t>(eSampleFormat::Float32));
+
+// Converts a 256 frame stereo block from 44.1 kHz to 48 kHz at each quality tier
+void BM_Resampler(benchmark::State &state)
+{
+  constexpr size_t frames = 256;
+  constexpr unsigned int channels = 2;
+  const auto quality = static_cast<eResampleQuality>(state.range(0));
+
+  Resampler resampler;
+  resampler.prepare(44100, 48000, channels, frames, quality);
+  std::vector<float> input(resampler.get_max_input_frames() * channels, 0.5f);
+  std::vector<float> output(frames * channels);
+  state.SetLabel(to_string(quality));
+
+  for (auto _ : state)
+  {
+    const size_t needed = resampler.get_input_frames_needed(frames);
+    benchmark::DoNotOptimize(resampler.process(input.data(), needed, output.data(), frames));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(frames));
+}
+BENCHMARK(BM_Resampler)->DenseRange(static_cast<int64_t>(eResampleQuality::Fast),
+                                    static_cast<int64_t>(eResampleQuality::High))->ArgName("quality");
+
+} // namespace
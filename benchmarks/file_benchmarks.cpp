@@ -0,0 +1,125 @@
+#include <benchmark/benchmark.h>
+
+#include "fileadapter.h"
+#include "wavreader.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace miniaudioengine;
+using namespace miniaudioengine::adapters;
+
+namespace
+{
+
+constexpr long long FRAMES_PER_READ = 1024;
+
+/** Decode a whole file in fixed-size chunks through libsndfile on every iteration. */
+void BM_FileAdapterReadFrames(benchmark::State &state, const std::filesystem::path &path)
+{
+  SndFileInfo info = {};
+  SndFile *file = sf_open(path.string().c_str(), SFM_READ, &info);
+  if (file == nullptr)
+  {
+    state.SkipWithError("Cannot open file");
+    return;
+  }
+
+  std::vector<float> buffer(static_cast<size_t>(FRAMES_PER_READ * info.channels));
+  int64_t frames = 0;
+  for (auto _ : state)
+  {
+    FileAdapter::seek(file, 0);
+    long long frames_read = 0;
+    while ((frames_read = FileAdapter::read_frames(file, buffer, FRAMES_PER_READ)) > 0)
+    {
+      frames += frames_read;
+    }
+    benchmark::DoNotOptimize(buffer.data());
+  }
+
+  state.SetItemsProcessed(frames);
+  state.SetBytesProcessed(frames * info.channels * static_cast<int64_t>(sizeof(float)));
+  sf_close(file);
+}
+
+/** Decode the same file in the same chunks with the native reader, to compare with libsndfile. */
+void BM_WavReaderReadFrames(benchmark::State &state, const std::filesystem::path &path)
+{
+  WavReader reader;
+  if (!reader.open(path))
+  {
+    state.SkipWithError("Not a native PCM or float WAV file");
+    return;
+  }
+
+  std::vector<float> buffer(static_cast<size_t>(FRAMES_PER_READ) * reader.get_channels());
+  int64_t frames = 0;
+  for (auto _ : state)
+  {
+    reader.seek(0);
+    size_t frames_read = 0;
+    while ((frames_read = reader.read_frames(buffer.data(), FRAMES_PER_READ)) > 0)
+    {
+      frames += static_cast<int64_t>(frames_read);
+    }
+    benchmark::DoNotOptimize(buffer.data());
+  }
+
+  state.SetItemsProcessed(frames);
+  state.SetBytesProcessed(frames * reader.get_channels() * static_cast<int64_t>(sizeof(float)));
+}
+
+/** Bulk load a whole file into a SampleBuffer, as SampleCache and OfflineRenderer do. */
+void BM_FileAdapterDecodeFile(benchmark::State &state, const std::filesystem::path &path)
+{
+  int64_t frames = 0;
+  unsigned int channels = 0;
+  for (auto _ : state)
+  {
+    framework::SampleBufferPtr buffer = FileAdapter::decode_file(path);
+    if (!buffer)
+    {
+      state.SkipWithError("Cannot decode file");
+      return;
+    }
+    frames += static_cast<int64_t>(buffer->get_frames());
+    channels = buffer->get_channels();
+    benchmark::DoNotOptimize(buffer->data());
+  }
+
+  state.SetItemsProcessed(frames);
+  state.SetBytesProcessed(frames * channels * static_cast<int64_t>(sizeof(float)));
+}
+
+} // namespace
+
+namespace miniaudioengine::benchmarks
+{
+
+/** @brief Register the libsndfile, native and bulk decode benchmarks for every audio file under samples/. */
+void register_file_benchmarks()
+{
+  std::vector<std::filesystem::path> files;
+  std::error_code error;
+  for (const auto &entry : std::filesystem::recursive_directory_iterator(MINIAUDIOENGINE_SAMPLES_DIR, error))
+  {
+    if (entry.is_regular_file() && entry.path().extension() == ".wav")
+    {
+      files.push_back(entry.path());
+    }
+  }
+  std::sort(files.begin(), files.end());
+
+  for (const auto &path : files)
+  {
+    const std::string file = std::filesystem::relative(path, MINIAUDIOENGINE_SAMPLES_DIR).generic_string();
+    benchmark::RegisterBenchmark(("BM_FileAdapterReadFrames/" + file).c_str(), BM_FileAdapterReadFrames, path);
+    benchmark::RegisterBenchmark(("BM_WavReaderReadFrames/" + file).c_str(), BM_WavReaderReadFrames, path);
+    benchmark::RegisterBenchmark(("BM_FileAdapterDecodeFile/" + file).c_str(), BM_FileAdapterDecodeFile, path);
+  }
+}
+
+} // namespace miniaudioengine::benchmarks
@@ -0,0 +1,197 @@
+#include <benchmark/benchmark.h>
+
+#include "commandqueue.h"
+#include "ringbuffer.h"
+#include "statesnapshot.h"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+using namespace miniaudioengine::framework;
+
+namespace
+{
+
+constexpr size_t RING_CAPACITY = 16384;
+
+// -----------------------------------------------------------------------------
+// RingBuffer
+// -----------------------------------------------------------------------------
+
+void BM_RingBufferPushPop(benchmark::State &state)
+{
+  RingBuffer<float> ring(RING_CAPACITY);
+  float sample = 0.0f;
+  for (auto _ : state)
+  {
+    ring.try_push(1.0f);
+    ring.try_pop(sample);
+    benchmark::DoNotOptimize(sample);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RingBufferPushPop);
+
+void BM_RingBufferBulk(benchmark::State &state)
+{
+  const size_t n = static_cast<size_t>(state.range(0));
+  RingBuffer<float> ring(RING_CAPACITY);
+  std::vector<float> input(n, 1.0f);
+  std::vector<float> output(n);
+  for (auto _ : state)
+  {
+    ring.write(input);
+    ring.read(output);
+    benchmark::DoNotOptimize(output.data());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+  state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(n * sizeof(float)));
+}
+BENCHMARK(BM_RingBufferBulk)->RangeMultiplier(4)->Range(64, 4096);
+
+/** Thread 0 produces and thread 1 consumes. Neither side waits, so only successful transfers are counted. */
+void BM_RingBufferSpsc(benchmark::State &state)
+{
+  static std::unique_ptr<RingBuffer<float>> ring;
+  if (state.thread_index() == 0)
+  {
+    ring = std::make_unique<RingBuffer<float>>(RING_CAPACITY);
+  }
+
+  // The timed loop starts once every thread has finished its setup
+  for (auto _ : state)
+  {
+    if (state.thread_index() == 0)
+    {
+      benchmark::DoNotOptimize(ring->try_push(1.0f));
+    }
+    else
+    {
+      float sample = 0.0f;
+      benchmark::DoNotOptimize(ring->try_pop(sample));
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RingBufferSpsc)->Threads(2)->UseRealTime();
+
+void BM_RingBufferSpscBulk(benchmark::State &state)
+{
+  static std::unique_ptr<RingBuffer<float>> ring;
+  if (state.thread_index() == 0)
+  {
+    ring = std::make_unique<RingBuffer<float>>(RING_CAPACITY);
+  }
+
+  const size_t n = static_cast<size_t>(state.range(0));
+  std::vector<float> block(n, 1.0f);
+  int64_t transferred = 0;
+  for (auto _ : state)
+  {
+    transferred += static_cast<int64_t>(state.thread_index() == 0 ? ring->write(block) : ring->read(block));
+  }
+  state.SetItemsProcessed(transferred);
+}
+BENCHMARK(BM_RingBufferSpscBulk)->Arg(256)->Threads(2)->UseRealTime();
+
+// -----------------------------------------------------------------------------
+// StateSnapshot
+// -----------------------------------------------------------------------------
+
+/** A parameter set of the size a processor publishes per change. */
+using ParameterSet = std::array<float, 32>;
+
+void BM_StateSnapshotPublishRead(benchmark::State &state)
+{
+  StateSnapshot<ParameterSet> snapshot;
+  ParameterSet parameters{};
+  for (auto _ : state)
+  {
+    parameters[0] += 1.0f;
+    snapshot.publish(parameters);
+    benchmark::DoNotOptimize(snapshot.read()[0]);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StateSnapshotPublishRead);
+
+/** Thread 0 publishes continuously and thread 1 reads, as a control thread and the audio thread would. */
+void BM_StateSnapshotContended(benchmark::State &state)
+{
+  static std::unique_ptr<StateSnapshot<ParameterSet>> snapshot;
+  if (state.thread_index() == 0)
+  {
+    snapshot = std::make_unique<StateSnapshot<ParameterSet>>();
+  }
+
+  ParameterSet parameters{};
+  for (auto _ : state)
+  {
+    if (state.thread_index() == 0)
+    {
+      parameters[0] += 1.0f;
+      snapshot->publish(parameters);
+    }
+    else
+    {
+      benchmark::DoNotOptimize(snapshot->read()[0]);
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StateSnapshotContended)->Threads(2)->UseRealTime();
+
+// -----------------------------------------------------------------------------
+// CommandQueue
+// -----------------------------------------------------------------------------
+
+/** A move-only command the size of a parameter change. */
+struct BenchmarkCommand
+{
+  std::unique_ptr<int> payload;
+  uint32_t target{0};
+  float value{0.0f};
+};
+
+void BM_CommandQueuePushPop(benchmark::State &state)
+{
+  CommandQueue<BenchmarkCommand> queue;
+  BenchmarkCommand command;
+  for (auto _ : state)
+  {
+    queue.try_push(BenchmarkCommand{nullptr, 1, 0.5f});
+    benchmark::DoNotOptimize(queue.try_pop(command));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CommandQueuePushPop);
+
+/** Thread 0 drains in batches, as the audio thread would once per block, and every other thread pushes. */
+void BM_CommandQueueContended(benchmark::State &state)
+{
+  static std::unique_ptr<CommandQueue<BenchmarkCommand>> queue;
+  if (state.thread_index() == 0)
+  {
+    queue = std::make_unique<CommandQueue<BenchmarkCommand>>();
+  }
+
+  int64_t transferred = 0;
+  for (auto _ : state)
+  {
+    if (state.thread_index() == 0)
+    {
+      transferred += static_cast<int64_t>(queue->try_pop_batch([](BenchmarkCommand &&command) noexcept {
+        benchmark::DoNotOptimize(command.value);
+      }, 64));
+    }
+    else if (queue->try_push(BenchmarkCommand{nullptr, static_cast<uint32_t>(state.thread_index()), 0.5f}))
+    {
+      transferred++;
+    }
+  }
+  state.SetItemsProcessed(transferred);
+}
+BENCHMARK(BM_CommandQueueContended)->Threads(2)->Threads(5)->UseRealTime();
+
+} // namespace
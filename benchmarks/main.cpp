@@ -0,0 +1,25 @@
+#include <benchmark/benchmark.h>
+
+#include "logger.h"
+
+namespace miniaudioengine::benchmarks
+{
+void register_file_benchmarks();
+}
+
+int main(int argc, char **argv)
+{
+  // Keep compile and stream logging out of the timings
+  miniaudioengine::framework::Logger::instance().enable_console_output(false);
+
+  miniaudioengine::benchmarks::register_file_benchmarks();
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+  {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,247 @@
+#include <benchmark/benchmark.h>
+
+#include "audiograph.h"
+#include "inputnode.h"
+#include "meter.h"
+#include "mixernode.h"
+#include "outputnode.h"
+#include "processornode.h"
+#include "sampler.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+using namespace miniaudioengine;
+using namespace miniaudioengine::dataplane;
+
+namespace
+{
+
+constexpr unsigned int CHANNELS = 2;
+constexpr unsigned int SAMPLE_RATE = 48000;
+
+/** Headless render of N tracks: OutputNode <- master MixerNode <- per track MixerNode <- ProcessorNode <- InputNode.
+ *  Each iteration refills every track's ring buffer with one block, as the file streaming thread would,
+ *  and renders one block. No device is opened.
+ */
+void BM_AudioGraphRender(benchmark::State &state)
+{
+  const unsigned int tracks = static_cast<unsigned int>(state.range(0));
+  const unsigned int n_frames = static_cast<unsigned int>(state.range(1));
+  const unsigned int workers = static_cast<unsigned int>(state.range(2));
+
+  AudioGraph graph;
+  graph.set_worker_threads(workers, false);
+  auto output = graph.add_output_node(nullptr);
+  auto master = graph.add_mixer_node(output);
+
+  std::vector<framework::BufferPtr> buffers;
+  for (unsigned int track = 0; track < tracks; track++)
+  {
+    auto mixer = graph.add_mixer_node(master);
+    mixer->set_gain(0.5f);
+    mixer->set_pan(track % 2 == 0 ? -0.5f : 0.5f);
+    auto processor = graph.add_processor_node(mixer);
+    auto input = graph.add_input_node(nullptr, processor);
+
+    buffers.push_back(std::make_shared<framework::Buffer>(n_frames * CHANNELS * 4));
+    input->set_source(buffers.back(), CHANNELS);
+  }
+
+  if (!graph.compile(CHANNELS, n_frames, SAMPLE_RATE))
+  {
+    state.SkipWithError("AudioGraph failed to compile");
+    return;
+  }
+
+  const std::vector<float> block(n_frames * CHANNELS, 0.25f);
+  std::vector<float> rendered(n_frames * CHANNELS);
+  for (auto _ : state)
+  {
+    for (const auto &buffer : buffers)
+    {
+      buffer->write(block);
+    }
+    graph.process(rendered.data(), n_frames);
+    benchmark::DoNotOptimize(rendered.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * n_frames);
+
+  // Fraction of the block's real-time duration spent rendering it
+  state.counters["dsp_load"] = benchmark::Counter(
+      static_cast<double>(n_frames) / SAMPLE_RATE * static_cast<double>(state.iterations()),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+BENCHMARK(BM_AudioGraphRender)
+    ->ArgNames({"tracks", "frames", "workers"})
+    ->ArgsProduct({{1, 8, 32}, {64, 256}, {0}})
+    ->ArgsProduct({{8, 32}, {256}, {2}})
+    ->UseRealTime();
+
+/** Sampler rendering N voices of a stereo sample, either at its recorded pitch (drums) or spread over
+ *  two octaves (keys, interpolated). Voices that finish are retriggered so N keep sounding.
+ */
+void BM_SamplerVoices(benchmark::State &state)
+{
+  const unsigned int voices = static_cast<unsigned int>(state.range(0));
+  const bool pitched = state.range(1) != 0;
+  constexpr unsigned int n_frames = 256;
+  constexpr size_t sample_frames = SAMPLE_RATE * 4;
+
+  auto samples = framework::SampleBuffer::allocate(sample_frames, CHANNELS, SAMPLE_RATE);
+  float *data = samples->get_writable_data();
+  for (size_t i = 0; i < sample_frames * CHANNELS; i++)
+  {
+    data[i] = 0.5f * std::sin(static_cast<float>(i) * 0.01f);
+  }
+
+  Sampler sampler(voices);
+  SamplerZone zone;
+  zone.samples = samples;
+  zone.pitch_tracking = pitched;
+  zone.one_shot = true;
+  sampler.add_zone(zone);
+  sampler.prepare(SAMPLE_RATE, n_frames, CHANNELS);
+
+  std::vector<float> left(n_frames);
+  std::vector<float> right(n_frames);
+  float *channels[CHANNELS] = {left.data(), right.data()};
+  framework::AudioBlockView block(channels, CHANNELS, n_frames);
+  midi::MidiEventList events(voices);
+
+  unsigned int next_note = 0;
+  for (auto _ : state)
+  {
+    events.clear();
+    for (size_t voice = sampler.get_active_voice_count(); voice < voices; voice++)
+    {
+      midi::MidiMessage message{};
+      message.type = midi::eMidiMessageType::NoteOn;
+      message.data1 = static_cast<unsigned char>(48 + next_note++ % 24);
+      message.data2 = 100;
+      events.add({0, message});
+    }
+
+    std::fill(left.begin(), left.end(), 0.0f);
+    std::fill(right.begin(), right.end(), 0.0f);
+    sampler.process(block, events);
+    benchmark::DoNotOptimize(left.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * n_frames * voices);
+  state.counters["dsp_load"] = benchmark::Counter(
+      static_cast<double>(n_frames) / SAMPLE_RATE * static_cast<double>(state.iterations()),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+BENCHMARK(BM_SamplerVoices)
+    ->ArgNames({"voices", "pitched"})
+    ->ArgsProduct({{32, 128, 256}, {0, 1}});
+
+/** N stereo meters measuring one 256 frame block each, as a mixer with N metered buses does.
+ *  "full" adds true peak and loudness to peak and RMS.
+ */
+void BM_MeterTaps(benchmark::State &state)
+{
+  const unsigned int meters = static_cast<unsigned int>(state.range(0));
+  const bool full = state.range(1) != 0;
+  constexpr unsigned int n_frames = 256;
+
+  framework::MeterConfig config;
+  config.true_peak = full;
+  config.loudness = full;
+
+  std::vector<framework::MeterTap> taps(meters);
+  for (framework::MeterTap &tap : taps)
+  {
+    tap.prepare(std::make_shared<framework::Meter>(config), CHANNELS, SAMPLE_RATE);
+  }
+
+  std::vector<float> left(n_frames);
+  std::vector<float> right(n_frames);
+  for (unsigned int i = 0; i < n_frames; i++)
+  {
+    left[i] = 0.5f * std::sin(static_cast<float>(i) * 0.05f);
+    right[i] = 0.5f * std::cos(static_cast<float>(i) * 0.05f);
+  }
+  float *channels[CHANNELS] = {left.data(), right.data()};
+
+  for (auto _ : state)
+  {
+    for (framework::MeterTap &tap : taps)
+    {
+      tap.process(channels, n_frames);
+    }
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations() * n_frames * meters);
+  state.counters["dsp_load"] = benchmark::Counter(
+      static_cast<double>(n_frames) / SAMPLE_RATE * static_cast<double>(state.iterations()),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+BENCHMARK(BM_MeterTaps)
+    ->ArgNames({"meters", "full"})
+    ->ArgsProduct({{1, 100}, {0, 1}});
+
+/** Control-thread cost of a live edit: route one of N tracks through an effect insert or around it,
+ *  commit the edit and render the block the new plan crossfades in.
+ */
+void BM_GraphHotSwap(benchmark::State &state)
+{
+  const unsigned int tracks = static_cast<unsigned int>(state.range(0));
+  constexpr unsigned int n_frames = 256;
+
+  AudioGraph graph;
+  auto output = graph.add_output_node(nullptr);
+  auto master = graph.add_mixer_node(output);
+
+  std::vector<framework::BufferPtr> buffers;
+  std::vector<MixerNodePtr> mixers;
+  for (unsigned int track = 0; track < tracks; track++)
+  {
+    mixers.push_back(graph.add_mixer_node(master));
+    auto input = graph.add_input_node(nullptr, mixers.back());
+    buffers.push_back(std::make_shared<framework::Buffer>(n_frames * CHANNELS * 4));
+    input->set_source(buffers.back(), CHANNELS);
+  }
+
+  if (!graph.compile(CHANNELS, n_frames, SAMPLE_RATE))
+  {
+    state.SkipWithError("AudioGraph failed to compile");
+    return;
+  }
+
+  const std::vector<float> block(n_frames * CHANNELS, 0.25f);
+  std::vector<float> rendered(n_frames * CHANNELS);
+  auto insert = graph.add_processor_node();
+  bool inserted = false;
+  for (auto _ : state)
+  {
+    if (inserted)
+    {
+      graph.disconnect(master, insert);
+      graph.disconnect(insert, mixers.front());
+      graph.connect(master, mixers.front());
+    }
+    else
+    {
+      graph.disconnect(master, mixers.front());
+      graph.connect(master, insert);
+      graph.connect(insert, mixers.front());
+    }
+    inserted = !inserted;
+    graph.commit();
+
+    for (const auto &buffer : buffers)
+    {
+      buffer->write(block);
+    }
+    graph.process(rendered.data(), n_frames);
+    benchmark::DoNotOptimize(rendered.data());
+  }
+}
+BENCHMARK(BM_GraphHotSwap)->ArgName("tracks")->Arg(8)->Arg(64)->Unit(benchmark::kMicrosecond);
+
+} // namespace
@@ -0,0 +1,251 @@
+#include <CLI11.hpp>
+
+#include "audiograph.h"
+#include "gainprocessor.h"
+#include "inputnode.h"
+#include "logger.h"
+#include "mixernode.h"
+#include "outputnode.h"
+#include "processornode.h"
+#include "realtime_assert.h"
+#include "streamstatistics.h"
+#include "syntheticaudioadapter.h"
+#include "threading.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace miniaudioengine;
+using namespace miniaudioengine::dataplane;
+
+namespace
+{
+
+constexpr unsigned int CHANNELS = 2;
+
+std::atomic<bool> running{true};
+
+/** @struct SoakOptions
+ *  @brief What the soak run renders, the stress it injects and the limits it must stay within.
+ */
+struct SoakOptions
+{
+  unsigned int tracks{16};
+  unsigned int frames{128};
+  unsigned int sample_rate{48000};
+  unsigned int workers{0};
+  unsigned int seconds{60};
+  unsigned int report_seconds{10};
+  adapters::SyntheticDeviceConfig device;
+  double max_p99_percent{50.0}; // Largest p99 block time, as a percentage of the period
+};
+
+/** @brief Keep every track's ring buffer topped up with a sine, as the file streaming threads would. */
+void produce(const std::vector<framework::BufferPtr> &buffers, unsigned int frames, unsigned int sample_rate,
+             std::chrono::nanoseconds interval, std::stop_token stop_token)
+{
+  framework::threading::register_current_thread("SoakProducer", framework::eThreadClass::Io);
+
+  std::vector<std::vector<float>> blocks(buffers.size(), std::vector<float>(static_cast<size_t>(frames) * CHANNELS));
+  std::vector<double> phases(buffers.size(), 0.0);
+  while (!stop_token.stop_requested())
+  {
+    for (size_t track = 0; track < buffers.size(); track++)
+    {
+      const double increment = 2.0 * 3.14159265358979323846 * (110.0 * (track + 1)) / sample_rate;
+      std::vector<float> &block = blocks[track];
+      while (buffers[track]->available() >= block.size())
+      {
+        for (unsigned int frame = 0; frame < frames; frame++)
+        {
+          const float sample = 0.1f * static_cast<float>(std::sin(phases[track]));
+          block[frame * CHANNELS] = sample;
+          block[frame * CHANNELS + 1] = sample;
+          phases[track] += increment;
+        }
+        phases[track] = std::fmod(phases[track], 2.0 * 3.14159265358979323846);
+        buffers[track]->write(block);
+      }
+    }
+    std::this_thread::sleep_for(interval);
+  }
+}
+
+void report(const framework::StreamStatistics &statistics, const adapters::SyntheticAudioAdapter &adapter,
+            std::chrono::steady_clock::duration elapsed)
+{
+  std::cout << "[" << std::chrono::duration_cast<std::chrono::seconds>(elapsed).count() << " s] "
+            << statistics.get_snapshot().to_string() << ", MissedPeriods=" << adapter.get_missed_periods()
+            << ", RealtimeViolations=" << framework::get_realtime_violation_count() << std::endl;
+}
+
+/** @brief Returns true if the run stayed within every limit. Prints each failure. */
+bool check(const framework::StreamStatisticsSnapshot &snapshot, const adapters::SyntheticAudioAdapter &adapter,
+           const SoakOptions &options)
+{
+  bool passed = true;
+  if (snapshot.callback_count == 0)
+  {
+    std::cout << "FAIL: No callbacks ran" << std::endl;
+    passed = false;
+  }
+  if (snapshot.underrun_count > 0 || adapter.get_underrun_count() > 0)
+  {
+    std::cout << "FAIL: " << snapshot.underrun_count << " blocks ran out of buffered input" << std::endl;
+    passed = false;
+  }
+  if (snapshot.xrun_count > 0 || adapter.get_missed_periods() > 0)
+  {
+    std::cout << "FAIL: " << snapshot.xrun_count << " callbacks finished late, " << adapter.get_missed_periods()
+              << " periods played silence" << std::endl;
+    passed = false;
+  }
+
+  const double max_p99_us = snapshot.period_us * options.max_p99_percent / 100.0;
+  if (snapshot.block_time_p99_us > max_p99_us)
+  {
+    std::cout << "FAIL: p99 block time " << snapshot.block_time_p99_us << " us exceeds " << max_p99_us << " us ("
+              << options.max_p99_percent << "% of the period)" << std::endl;
+    passed = false;
+  }
+
+#ifdef ENABLE_REALTIME_CHECKS
+  size_t unsafe = 0;
+  for (const auto &violation : framework::get_realtime_violations())
+  {
+    if (violation.type != framework::realtime::eViolation::Deadline)
+    {
+      std::cout << "FAIL: " << framework::to_string(violation) << std::endl;
+      unsafe++;
+    }
+  }
+  if (framework::get_realtime_violation_count() > framework::realtime::MAX_VIOLATIONS)
+  {
+    std::cout << "FAIL: " << framework::get_realtime_violation_count() - framework::realtime::MAX_VIOLATIONS
+              << " further realtime violations were not kept" << std::endl;
+    unsafe++;
+  }
+  passed = passed && unsafe == 0;
+#else
+  std::cout << "Note: Built without ENABLE_REALTIME_CHECKS, allocations and locks on the audio thread are not checked" << std::endl;
+#endif
+  return passed;
+}
+
+} // namespace
+
+/** @brief Headless soak run: N tracks rendered through the AudioGraph by a synthetic device for a set time.
+ *  Exits non-zero if any block underran, any callback missed its period, the realtime checks recorded an
+ *  allocation or lock on the audio path, or the p99 block time exceeded its limit. Build with
+ *  ENABLE_REALTIME_CHECKS to check allocations and locks.
+ */
+int main(int argc, char **argv)
+{
+  SoakOptions options;
+  bool verbose = false;
+
+  CLI::App app{"soak - Render tracks on a synthetic audio device and fail on underruns, xruns or realtime violations"};
+  argv = app.ensure_utf8(argv);
+  app.add_option("--tracks", options.tracks, "Tracks to render")->capture_default_str();
+  app.add_option("--frames", options.frames, "Frames per callback")->capture_default_str();
+  app.add_option("--sample-rate", options.sample_rate, "Sample rate in Hz")->capture_default_str();
+  app.add_option("--workers", options.workers, "Graph worker threads")->capture_default_str();
+  app.add_option("--seconds", options.seconds, "Length of the run")->capture_default_str();
+  app.add_option("--report-seconds", options.report_seconds, "Interval between progress reports, 0 for none")->capture_default_str();
+  app.add_option("--jitter-us", options.device.jitter_us, "Largest random lateness of a callback")->capture_default_str();
+  app.add_option("--load-percent", options.device.load_percent, "Share of each period the device spins before the callback")->capture_default_str();
+  app.add_option("--seed", options.device.seed, "Seed of the jitter")->capture_default_str();
+  app.add_option("--max-p99-percent", options.max_p99_percent, "Largest p99 block time, as a percentage of the period")->capture_default_str();
+  app.add_flag("--verbose", verbose, "Enable engine logging");
+  CLI11_PARSE(app, argc, argv);
+
+  framework::Logger::instance().enable_console_output(verbose);
+  framework::threading::register_current_thread("Soak", framework::eThreadClass::Normal);
+  std::signal(SIGINT, [](int) { running = false; });
+
+  framework::StreamConfig config;
+  config.frames_per_buffer = options.frames;
+  config.sample_rate = options.sample_rate;
+
+  auto graph = std::make_shared<AudioGraph>();
+  auto statistics = std::make_shared<framework::StreamStatistics>();
+  graph->set_worker_threads(options.workers);
+  graph->set_statistics(statistics);
+  auto output = graph->add_output_node(nullptr);
+  auto master = graph->add_mixer_node(output);
+
+  std::vector<framework::BufferPtr> buffers;
+  for (unsigned int track = 0; track < options.tracks; track++)
+  {
+    auto mixer = graph->add_mixer_node(master);
+    mixer->set_gain(1.0f / options.tracks);
+    mixer->set_pan(track % 2 == 0 ? -0.5f : 0.5f);
+    auto processor = graph->add_processor_node(mixer);
+    processor->add_processor(std::make_shared<GainProcessor>());
+    auto input = graph->add_input_node(nullptr, processor);
+
+    buffers.push_back(std::make_shared<framework::Buffer>(config.get_ring_capacity(CHANNELS)));
+    input->set_source(buffers.back(), CHANNELS);
+  }
+
+  if (!graph->compile(CHANNELS, options.frames, options.sample_rate))
+  {
+    std::cerr << "Error: AudioGraph failed to compile" << std::endl;
+    return 1;
+  }
+
+  // Fill the ring buffers before the first callback, then refill four times per period
+  const auto period = std::chrono::nanoseconds(static_cast<uint64_t>(options.frames) * 1000000000ull / options.sample_rate);
+  std::jthread producer([&](std::stop_token stop_token) { produce(buffers, options.frames, options.sample_rate, period / 4, stop_token); });
+  while (buffers.back()->available() >= static_cast<size_t>(options.frames) * CHANNELS)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  framework::clear_realtime_violations();
+  adapters::SyntheticAudioAdapter adapter;
+  adapter.set_audio_graph(graph);
+  adapter.set_statistics(statistics);
+  options.device.output_channels = CHANNELS;
+  if (!adapter.open_stream(options.device, nullptr, framework::eInputOutputDirection::Output, config))
+  {
+    std::cerr << "Error: Failed to open the synthetic audio device" << std::endl;
+    return 1;
+  }
+
+  std::cout << "Soaking " << options.tracks << " tracks at " << options.frames << " frames, " << options.sample_rate
+            << " Hz for " << options.seconds << " s with " << options.device.to_string() << std::endl;
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto end = start + std::chrono::seconds(options.seconds);
+  auto next_report = start + std::chrono::seconds(options.report_seconds);
+  while (running && std::chrono::steady_clock::now() < end)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (options.report_seconds > 0 && std::chrono::steady_clock::now() >= next_report)
+    {
+      report(*statistics, adapter, std::chrono::steady_clock::now() - start);
+      next_report += std::chrono::seconds(options.report_seconds);
+    }
+  }
+
+  adapter.close_stream();
+  producer.request_stop();
+  producer.join();
+
+  const framework::StreamStatisticsSnapshot snapshot = statistics->get_snapshot();
+  std::cout << snapshot.to_string() << std::endl;
+  if (!check(snapshot, adapter, options))
+  {
+    std::cout << "Soak FAILED" << std::endl;
+    return 1;
+  }
+  std::cout << "Soak passed" << std::endl;
+  return 0;
+}
@@ -221,6 +221,8 @@ int main(int argc, char *argv[])
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
   }
 
+  std::cout << track->get_statistics().to_string() << std::endl;
+
   // Stop playback
   session.stop();
   if (session.get_state() != eAudioSessionState::Stopped)
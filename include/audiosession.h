@@ -1,33 +1,61 @@
 #ifndef __AUDIO_SESSION_H__
 #define __AUDIO_SESSION_H__
 
+#include <chrono>
+#include <functional>
 #include <vector>
 #include <memory>
 #include <filesystem>
 
+#include "realtimememory.h"
+#include "streamconfig.h"
+#include "threading.h"
+
 namespace miniaudioengine
 {
 
 // Forward declarations
 class Device;
+struct DeviceChange;
 class File;
+struct AudioFileInfo;
+class NetworkStream;
+struct NetworkStreamConfig;
 class Track;
+struct TrackStatistics;
+struct OfflineRenderConfig;
+struct OfflineRenderResult;
+struct OfflineRenderJob;
 
 class TrackService;
 class DeviceService;
 class FileService;
+class SampleCache;
+
+namespace dataplane
+{
+class Transport;
+}
 
 using DevicePtr = std::shared_ptr<Device>;
 using FilePtr = std::shared_ptr<File>;
+using NetworkStreamPtr = std::shared_ptr<NetworkStream>;
 using TrackPtr = std::shared_ptr<Track>;
 
 using DeviceList = std::vector<DevicePtr>;
 using FileList = std::vector<FilePtr>;
+using AudioFileInfoList = std::vector<AudioFileInfo>;
 using TrackList = std::vector<TrackPtr>;
+using TrackStatisticsList = std::vector<TrackStatistics>;
+using OfflineRenderJobList = std::vector<OfflineRenderJob>;
+using OfflineRenderResultList = std::vector<OfflineRenderResult>;
+typedef std::function<void(const DeviceChange &)> DeviceChangeCallback;
 
 using DeviceServicePtr = std::unique_ptr<DeviceService>;
 using FileServicePtr = std::unique_ptr<FileService>;
 using TrackServicePtr = std::unique_ptr<TrackService>;
+using SampleCachePtr = std::shared_ptr<SampleCache>;
+using TransportPtr = std::shared_ptr<dataplane::Transport>;
 
 /** @enum eAudioSessionState
  *  @brief Represents the state of an audio session.
@@ -58,6 +86,14 @@ public:
   DevicePtr get_default_audio_input_device() const;
   DevicePtr get_default_audio_output_device() const;
 
+  /** @brief Enumerate the devices now instead of waiting for the next background poll.
+   *  @return True if a device was plugged in or removed, or a default device changed.
+   */
+  bool refresh_devices() const;
+
+  /** @brief Set a callback run on the device enumeration thread whenever devices are plugged in or removed. */
+  void set_device_change_callback(DeviceChangeCallback callback) const;
+
   // Files
   FileList get_audio_files(const std::filesystem::path& directory) const;
   FileList get_midi_files(const std::filesystem::path& directory) const;
@@ -65,23 +101,146 @@ public:
   FilePtr get_audio_file(const std::filesystem::path& file_path) const;
   FilePtr get_midi_file(const std::filesystem::path& file_path) const;
 
+  /** @brief Find every WAV file below a directory from its header alone, on a pool of threads.
+   *  Open the files that are used with get_audio_file(info.path).
+   */
+  AudioFileInfoList scan_audio_files(const std::filesystem::path& directory) const;
+
+  /** @brief Keep the metadata of scanned files in an index file, so the next launch only probes new or changed files. */
+  bool set_file_index_path(const std::filesystem::path& index_path);
+
+  /** @brief Create a WAV file to use as the audio output of a recording track. */
+  FilePtr create_audio_file(const std::filesystem::path& file_path) const;
+
+  /** @brief Create an RTP stream to config.address to use as the audio output of a track.
+   *  The track's graph renders at the stream's sample rate and channel count.
+   */
+  NetworkStreamPtr create_network_output(const NetworkStreamConfig& config) const;
+
+  /** @brief Create an RTP stream received on config.address to use as the audio input of a track. */
+  NetworkStreamPtr create_network_input(const NetworkStreamConfig& config) const;
+
+  /** @brief Returns the session's shared sample cache, used to preload one-shot samples into memory. */
+  SampleCachePtr get_sample_cache() const { return p_sample_cache; }
+
+  /** @brief Returns the session's transport: the shared sample position, tempo map and click.
+   *  It is driven by one of the device streams, so tracks can be started and stopped on its beats and bars.
+   */
+  TransportPtr get_transport() const { return p_transport; }
+
   // Tracks
   TrackList get_tracks() const;
   TrackPtr add_track() const;
 
+  /** @brief Snapshot the statistics of every track, in the order of get_tracks().
+   *  Only reads the counters the audio path updates lock-free, so monitoring can poll it while playing.
+   */
+  TrackStatisticsList get_track_statistics() const;
+
   // Control
-  bool play();
-  bool record();
+
+  /** @brief Longest play() and record() wait for file inputs to preroll before starting anyway. */
+  static constexpr std::chrono::milliseconds PREROLL_TIMEOUT{1000};
+
+  /** @brief Start the transport and playback of all tracks, or of none.
+   *  Every track's streams and graph are prepared while the transport holds, then the file inputs
+   *  preroll config.preroll_blocks blocks and the transport starts. Tracks on device streams all
+   *  start on the transport's first frame, sample aligned. If a track cannot start, every track is
+   *  stopped again and the session stays stopped.
+   *  @param config Buffer size, sample rate and latency profile for the session's streams,
+   *                e.g. framework::StreamConfig::live() or framework::StreamConfig::render().
+   */
+  bool play(const framework::StreamConfig &config = framework::StreamConfig());
+
+  /** @brief Start all tracks and record every track with a device audio input and a file audio output.
+   *  Captured audio is queued to a background writer, so the input stream never waits on the disk.
+   *  Set config.record_preallocate_seconds to reserve disk space for the expected take length.
+   */
+  bool record(const framework::StreamConfig &config = framework::StreamConfig());
+
+  /** @brief Stop all tracks and rewind the transport to frame 0. */
   bool stop();
 
+  // Offline rendering
+
+  /** @brief Bounce every track with an audio file input to a WAV file, as fast as the CPU allows.
+   *  No device is opened. The session must be stopped.
+   *  @param output_path The rendered file, overwritten if it exists.
+   *  @param config Block size, sample rate, tail and sample format of the render.
+   *  @return The outcome, including throughput as a multiple of realtime.
+   */
+  OfflineRenderResult render(const std::filesystem::path &output_path, const OfflineRenderConfig &config) const;
+
+  /** @brief Describe a render of this session's tracks, for render_parallel(). */
+  OfflineRenderJob make_render_job(const std::filesystem::path &output_path, const OfflineRenderConfig &config) const;
+
+  /** @brief Render jobs from any number of stopped sessions concurrently, one job per core.
+   *  Jobs made from the same session share its tracks' processors and are rendered one after another.
+   *  @param max_threads Largest number of jobs rendered at once. 0 uses every hardware thread.
+   *  @return One result per job, in the order of jobs.
+   */
+  static OfflineRenderResultList render_parallel(const OfflineRenderJobList &jobs, unsigned int max_threads = 0);
+
+  // Memory
+
+  /** @brief Lock the realtime working set in RAM, so neither page faults nor swapping can glitch playback.
+   *  Ring buffers, graph arenas, loop buffers and cached samples are allocated from a pool that faults
+   *  every page in up front. Enabling locks the pool's current and future pages, and the memory-mapped
+   *  samples loaded from then on, with mlockall() where the process may lock without limit and page by
+   *  page otherwise. Best enabled before loading, so the first play runs entirely from locked memory.
+   *  @return False if the OS refused to lock part of the pool, e.g. above RLIMIT_MEMLOCK. The pages stay prefaulted.
+   */
+  bool set_realtime_memory(bool enabled);
+
+  bool is_realtime_memory_enabled() const;
+
+  /** @brief Returns how much of the realtime memory pool is reserved and locked. */
+  framework::RealtimeMemoryStatistics get_realtime_memory_statistics() const;
+
+  // Threads
+
+  /** @brief Set the priorities and cores of the engine's threads, e.g. realtime_cores = {2, 3, 4, 5}.
+   *  Applies to the threads already running and to every thread started later. The audio callback and
+   *  graph workers run on the realtime cores, file I/O, decoding and scans are kept off them.
+   *  @return False if the OS refused part of the configuration, e.g. without realtime scheduling rights.
+   */
+  bool set_threading(const framework::ThreadingConfig &config);
+
+  framework::ThreadingConfig get_threading() const;
+
+  /** @brief Returns every running engine thread with its class, for diagnostics. */
+  std::vector<framework::ThreadInfo> get_threads() const;
+
+  // Tracing
+
+  /** @brief Record what the audio callback, graph nodes, file I/O and MIDI threads do, for write_trace().
+   *  Each thread keeps its most recent events in its own ring, so tracing can stay on and be dumped
+   *  right after a glitch. Enabling allocates the rings on the first call.
+   *  @return False if the engine was built without ENABLE_TRACING, so no events would be recorded.
+   */
+  bool set_tracing(bool enabled);
+
+  bool is_tracing_enabled() const;
+
+  /** @brief Write the recorded events as Chrome trace JSON, opened by chrome://tracing and ui.perfetto.dev.
+   *  Recording continues while the rings are read.
+   *  @return False if the file cannot be written.
+   */
+  bool write_trace(const std::filesystem::path &path) const;
+
   // State
   eAudioSessionState get_state() const { return m_state; }
 
 private:
+  /** @brief Start every track on a common transport frame and enter a state, or roll back. */
+  bool start(const framework::StreamConfig &config, eAudioSessionState state);
+
   // Services
   DeviceServicePtr p_device_service;
   FileServicePtr p_file_service;
   TrackServicePtr p_track_service;
+  SampleCachePtr p_sample_cache;
+  TransportPtr p_transport;
 
   // State
   eAudioSessionState m_state = eAudioSessionState::Stopped;
@@ -4,14 +4,28 @@
 #include "device.h"
 #include "logger.h"
 #include "ringbuffer.h"
+#include "sampleformat.h"
+#include "streamstatistics.h"
 #include "adapter.h"
 
+#include <atomic>
 #include <memory>
+#include <span>
+#include <vector>
 #include <rtaudio/RtAudio.h>
 
+namespace miniaudioengine::dataplane
+{
+class AudioGraph;
+class StreamMixer;
+}
+
 namespace miniaudioengine::adapters
 {
 
+class FileWriter;
+using FileWriterPtr = std::shared_ptr<FileWriter>;
+
 typedef RtAudioStreamStatus AudioStreamStatus;
 typedef RtAudio::StreamParameters AudioStreamParameters;
 typedef RtAudio::DeviceInfo AudioDeviceInfo;
@@ -22,14 +36,38 @@ using RtAudioPtr = std::unique_ptr<RtAudio>;
 class AudioCallbackHandler : public framework::IAdapterCallback
 {
 public:
-  struct Params : public framework::IAdapterCallback::IParams {};
+  struct Params : public framework::IAdapterCallback::IParams
+  {
+    unsigned int n_channels{1};
+    unsigned int n_input_channels{0}; // Captured channels of a Duplex stream. n_channels counts the output
+    unsigned int sample_rate{0};
+    std::atomic<unsigned long long> underrun_count{0};
+    dataplane::AudioGraph *graph{nullptr};
+    dataplane::StreamMixer *mixer{nullptr};
+    framework::StreamStatistics *statistics{nullptr};
+    FileWriter *recorder{nullptr};
+
+    // Conversions of a device opened with an integer format, nullptr for float32. The block is rendered
+    // into the float scratch buffers and converted to and from the device buffers at the edge
+    const framework::dsp::SampleFormatKernels *format_kernels{nullptr};
+    float *output_scratch{nullptr};
+    float *input_scratch{nullptr};
+    size_t scratch_frames{0};
+  };
 
   static int audio_callback(void *output_buffer, void *input_buffer, unsigned int n_frames,
                             double stream_time, AudioStreamStatus status, void *user_data) noexcept;
+
+private:
+  static int render_block(Params *params, float *output, const float *input, unsigned int n_frames) noexcept;
+  static void capture_input(Params *params, std::span<const float> input) noexcept;
 };
 
 /** @class AudioAdapter
  *  @brief Adapter class that encapsulates RtAudio, separating the audio controller from direct dependency on RtAudio.
+ *  A Duplex stream opens the device's input and output together. Each callback writes the captured
+ *  block into the Buffer and then renders the AudioGraph, which reads it back, so the input reaches
+ *  the output within the same period.
  */
 class AudioAdapter : public framework::IAdapter<DeviceInfo>
 {
@@ -42,15 +80,62 @@ public:
   unsigned int get_device_count();
   std::vector<DevicePtr> get_devices();
 
-  bool open_stream(const DeviceInfo &info, const framework::BufferPtr &buffer, const framework::eInputOutputDirection &direction);
+  bool open_stream(const DeviceInfo &info, const framework::BufferPtr &buffer, const framework::eInputOutputDirection &direction, const framework::StreamConfig &config);
   bool close_stream();
   bool stop_stream();
 
   bool is_stream_open();
   bool is_stream_running();
 
+  /** @brief Render output streams through a compiled AudioGraph instead of reading the Buffer directly.
+   *  @param graph The graph to render, or nullptr to read the Buffer directly.
+   *  @note Must be set while the stream is closed.
+   */
+  bool set_audio_graph(const std::shared_ptr<dataplane::AudioGraph> &graph);
+
+  /** @brief Hand every block to a StreamMixer shared by many tracks instead of a single graph or Buffer.
+   *  @param mixer The mixer that captures and renders for the stream, or nullptr to stop sharing.
+   *  @note Must be set while the stream is closed. Takes precedence over the AudioGraph and the Buffer.
+   */
+  bool set_stream_mixer(const std::shared_ptr<dataplane::StreamMixer> &mixer);
+
+  /** @brief Record callback timing, driver xruns and ring buffer fill into a StreamStatistics.
+   *  @param statistics Statistics to update, or nullptr to stop recording.
+   *  @note Must be set while the stream is closed.
+   */
+  bool set_statistics(const framework::StreamStatisticsPtr &statistics);
+
+  /** @brief Stream every block an input stream captures to a FileWriter.
+   *  @param recorder The writer to feed from the audio thread, or nullptr to stop recording.
+   *  @note Must be set while the stream is closed.
+   */
+  bool set_recorder(const FileWriterPtr &recorder);
+
+  /** @brief Returns the number of output callbacks that ran out of buffered audio and played silence. */
+  unsigned long long get_underrun_count() const
+  {
+    return m_callback_params.underrun_count.load(std::memory_order_relaxed);
+  }
+
+  /** @brief Returns the frames of buffering between the device input and output of the open stream.
+   *  For a Duplex stream this is the round trip from the input jack to the output jack.
+   */
+  unsigned long long get_latency_frames() const { return m_latency_frames; }
+
 private:
   RtAudioPtr p_rtaudio;
+  AudioCallbackHandler::Params m_callback_params;
+  std::shared_ptr<dataplane::AudioGraph> p_audio_graph;
+  std::shared_ptr<dataplane::StreamMixer> p_stream_mixer;
+  framework::StreamStatisticsPtr p_statistics;
+  FileWriterPtr p_recorder;
+  unsigned long long m_latency_frames{0};
+  std::vector<float> m_output_scratch;
+  std::vector<float> m_input_scratch;
+
+  void prepare_device_format(framework::eSampleFormat format, unsigned int output_channels, unsigned int input_channels,
+                             unsigned int buffer_size);
+  unsigned long long query_latency_frames(const framework::eInputOutputDirection &direction, unsigned int buffer_size);
 
   static DevicePtr make_device_handle(const DeviceInfo &info)
   {
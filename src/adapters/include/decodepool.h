@@ -0,0 +1,69 @@
+#ifndef __DECODE_POOL_H__
+#define __DECODE_POOL_H__
+
+#include "streamqueue.h"
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace miniaudioengine::adapters
+{
+
+class FileStream;
+
+/** @class DecodePool
+ *  @brief Engine-wide pool of worker threads that decode compressed files into their FileStream rings.
+ *  The pool has a fixed number of workers however many streams are open. Each pass a worker takes
+ *  the stream with the earliest deadline from the StreamQueue and decodes at most
+ *  DECODE_BUDGET_FRAMES into it, so one long decode cannot starve the other streams.
+ */
+class DecodePool
+{
+public:
+  /** @brief Most frames decoded into one stream before a worker moves on to the next emptiest one. */
+  static constexpr size_t DECODE_BUDGET_FRAMES = 4096;
+
+  /** @brief Most workers the default pool starts. */
+  static constexpr unsigned int MAX_WORKERS = 4;
+
+  /** @brief Start a pool.
+   *  @param worker_count Decode threads. 0 uses half the hardware threads, between 1 and MAX_WORKERS.
+   */
+  explicit DecodePool(unsigned int worker_count = 0);
+  ~DecodePool();
+
+  DecodePool(const DecodePool &) = delete;
+  DecodePool &operator=(const DecodePool &) = delete;
+
+  /** @brief The pool every compressed FileStream is filled by. */
+  static DecodePool &instance()
+  {
+    static DecodePool instance;
+    return instance;
+  }
+
+  /** @brief Start filling a stream. */
+  void add(FileStream *stream) { m_queue.add(stream); }
+
+  /** @brief Stop filling a stream. Returns once no worker is filling it, so it can then be closed. */
+  void remove(FileStream *stream) { m_queue.remove(stream); }
+
+  /** @brief Wake idle workers, e.g. after a seek, instead of waiting for the next poll. */
+  void wake() noexcept { m_queue.wake(); }
+
+  unsigned int get_worker_count() const { return static_cast<unsigned int>(m_workers.size()); }
+
+  /** @brief Returns the number of streams being filled. */
+  size_t get_stream_count() const { return m_queue.size(); }
+
+private:
+  void run(std::stop_token stop_token);
+
+  StreamQueue m_queue;
+  std::vector<std::jthread> m_workers; // Declared last, so workers stop before the queue is destroyed
+};
+
+} // namespace miniaudioengine::adapters
+
+#endif // __DECODE_POOL_H__
@@ -2,15 +2,17 @@
 #define __FILE_ADAPTER_H__
 
 #include "file.h"
-#include "ringbuffer.h"
+#include "filestream.h"
 #include "adapter.h"
+#include "samplebuffer.h"
 
 #include <sndfile.h>
 #include <filesystem>
 #include <string>
 #include <memory>
+#include <optional>
 #include <stdexcept>
-#include <thread>
+#include <vector>
 
 namespace miniaudioengine::adapters
 {
@@ -18,33 +20,16 @@ namespace miniaudioengine::adapters
 typedef SNDFILE SndFile;
 typedef SF_INFO SndFileInfo;
 
-// TODO - Should FileAudioStreamThread be moved to FileService instead?
-class FileAudioStreamThread : public framework::IAdapterCallback
+/** @struct AudioFormatInfo
+ *  @brief Format of an audio file, read from its header without decoding any samples.
+ */
+struct AudioFormatInfo
 {
-public:
-  struct Params : public framework::IAdapterCallback::IParams
-  {
-    SndFile* snd_file;
-    SndFileInfo snd_file_info;
-    size_t n_frames_to_read;
-  };
-
-  FileAudioStreamThread() = default;
-  ~FileAudioStreamThread() = default;
-  // TODO - Cannot be copied
-
-  bool start(const Params &params);
-  bool stop();
-  bool is_running() { return p_audio_stream_thread != nullptr; }
-
-  static void callback(std::stop_token stop_token, void *input_buffer, void *output_buffer, const Params &params);
-
-private:
-
-  static void read_from_file(SndFile *file, framework::Buffer *buffer, const size_t frames_to_read);
-  static void write_to_file(framework::Buffer * buffer, SndFile * file, const size_t frames_to_read);
-
-  std::unique_ptr<std::jthread> p_audio_stream_thread;
+  uint64_t frames{0};
+  unsigned int sample_rate{0};
+  unsigned int channels{0};
+  unsigned int bits_per_sample{0}; // 0 for encodings without a fixed sample width
+  std::string format;              // "WAV", "AIFF", "FLAC", "OGG", "MP3" or "Unknown"
 };
 
 /** @class FileAdapter 
@@ -53,30 +38,63 @@ private:
 class FileAdapter : public framework::IAdapter<std::filesystem::path>
 {
 public:
-  FileAdapter() = default;
-  FileAdapter(const FileAdapter &) = default;
-  FileAdapter &operator=(const FileAdapter &) = default;
-  ~FileAdapter() = default;
-
-  SndFileInfo get_info() const { return m_info; }
-
-  bool open_stream(const std::filesystem::path &filename, const framework::BufferPtr &buffer, const framework::eInputOutputDirection &direction);
+  FileAdapter();
+  FileAdapter(const FileAdapter &) = delete;
+  FileAdapter &operator=(const FileAdapter &) = delete;
+  ~FileAdapter();
+
+  /** @brief Start streaming a file from disk.
+   *  The file streams into a read-ahead ring of its own, read through get_stream(), so buffer is unused.
+   */
+  bool open_stream(const std::filesystem::path &filename, const framework::BufferPtr &buffer, const framework::eInputOutputDirection &direction,
+                   const framework::StreamConfig &config);
+
+  /** @brief Start streaming a file from disk from a frame.
+   *  @param start_frame File frame playback starts at.
+   */
+  bool open_stream(const std::filesystem::path &filename, const framework::eInputOutputDirection &direction, uint64_t start_frame);
   bool close_stream();
+
+  /** @brief Returns the open stream, or nullptr. */
+  const FileStreamPtr &get_stream() const { return p_stream; }
   bool stop_stream() { return false; }  // TODO
   
   bool is_stream_open();
   bool is_stream_running() { return false; }  // TODO
 
+  /** @brief Read the format of an audio file from its header.
+   *  PCM and float WAV files are parsed natively, anything else is opened and closed with libsndfile.
+   *  @param path Path to the audio file.
+   *  @return The format, or std::nullopt if the file cannot be read.
+   */
+  static std::optional<AudioFormatInfo> probe(const std::filesystem::path &path);
+
   static long long read_frames(SndFile *file, std::vector<float> &buffer, long long frames_to_read);
   static void seek(SndFile *file, long long frame_offset);
 
-private:
-  SndFileInfo m_info = {};
-
-  FileAudioStreamThread m_audio_stream_thread;
+  /** @brief Decode an entire audio file into an aligned, interleaved float SampleBuffer.
+   *  PCM and float WAV files are read natively by a WavReader, anything else through libsndfile.
+   *  @param path Path to any libsndfile-compatible file.
+   *  @return The decoded samples, or nullptr if the file cannot be read.
+   */
+  static framework::SampleBufferPtr decode_file(const std::filesystem::path &path);
+
+  /** @brief Memory-map the data chunk of a little-endian 32-bit float WAV file without copying it.
+   *  @param path Path to the WAV file.
+   *  @return The mapped samples, or nullptr if the file is not a mappable float WAV or mapping is unsupported.
+   */
+  static framework::SampleBufferPtr map_file(const std::filesystem::path &path);
+
+  /** @brief Decode frames from a position of an audio file, e.g. the preload of a cue point.
+   *  @param path Path to any libsndfile-compatible file.
+   *  @param start_frame First frame to decode.
+   *  @param frames Frames to decode, fewer are returned at the end of the file.
+   *  @return The decoded samples, or nullptr if the file cannot be read or start_frame is past its end.
+   */
+  static framework::SampleBufferPtr decode_region(const std::filesystem::path &path, uint64_t start_frame, size_t frames);
 
-  SndFile *open(const char *filename);
-  void close(SndFile *file);
+private:
+  FileStreamPtr p_stream;
 
   static FilePtr make_wav_file_handle(const std::filesystem::path &path)
   {
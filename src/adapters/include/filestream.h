@@ -0,0 +1,253 @@
+#ifndef __FILE_STREAM_H__
+#define __FILE_STREAM_H__
+
+#include "audiosource.h"
+#include "io.h"
+#include "rcupointer.h"
+#include "samplebuffer.h"
+#include "wavreader.h"
+
+#include <sndfile.h>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace miniaudioengine::adapters
+{
+
+/** @struct CuePoint
+ *  @brief A file position playback can jump to instantly, and the first frames from it held in RAM.
+ */
+struct CuePoint
+{
+  uint64_t frame{0};
+  framework::SampleBufferPtr samples; // Interleaved frames from frame on, at the file's rate
+};
+
+using CuePointList = std::vector<CuePoint>;
+
+/** @class FileStream
+ *  @brief Streams an audio file from disk into a read-ahead ring, with seek, loop region and cue
+ *  point support.
+ *  The ring is filled by a producer shared with every other open stream, so streams cost no
+ *  thread of their own: PCM and float WAV files by the IoScheduler, which batches their reads, and
+ *  files libsndfile decodes, e.g. FLAC, Ogg or MP3, by the DecodePool's workers.
+ *  A seek is a handshake between the audio thread and the producer: the producer stops filling,
+ *  the audio thread drops what is left in the ring, and the producer resumes from the new
+ *  position. A seek to a cue point plays the cue's preloaded frames meanwhile, and the producer
+ *  resumes right after them, so the jump is heard on the next block with no gap. A loop region is
+ *  looped by the producer itself, so the wrap is seamless.
+ *  The read-ahead depth follows the slowest recent disk read, between MIN_READ_AHEAD_SECONDS and
+ *  the ring's capacity of MAX_READ_AHEAD_SECONDS.
+ *  Seek, loop and cue changes are made from control threads; read_frames() is the audio thread's.
+ */
+class FileStream : public framework::IAudioSource
+{
+public:
+  static constexpr uint64_t NO_LOOP = std::numeric_limits<uint64_t>::max();
+  static constexpr uint64_t MIN_LOOP_FRAMES = 256;
+  static constexpr double MIN_READ_AHEAD_SECONDS = 0.1;
+  static constexpr double MAX_READ_AHEAD_SECONDS = 2.0;
+  /** @brief Least decode-ahead kept for files decoded on the DecodePool, which also wait for a free worker. */
+  static constexpr double MIN_DECODE_AHEAD_SECONDS = 0.25;
+  /** @brief Read-ahead kept per second of the slowest recent disk read. */
+  static constexpr double READ_LATENCY_HEADROOM = 4.0;
+
+  /** @enum eFillStep
+   *  @brief What a producer step did.
+   */
+  enum class eFillStep
+  {
+    Idle,    // Nothing to do, e.g. the ring is full
+    Waiting, // A seek waits on the audio thread to drop the ring, check again soon
+    Worked,  // Did some work, call again
+    Read     // A read is prepared
+  };
+
+  FileStream();
+  ~FileStream() override;
+
+  FileStream(const FileStream &) = delete;
+  FileStream &operator=(const FileStream &) = delete;
+
+  /** @brief Open a file and start streaming it from a frame.
+   *  PCM and float WAV files are read natively, anything else is decoded by libsndfile on the DecodePool.
+   *  @return False if the file cannot be opened or a stream is already running.
+   */
+  bool open(const std::filesystem::path &path, uint64_t start_frame = 0);
+
+  /** @brief Stop filling the ring and close the file. */
+  void close();
+
+  bool is_open() const { return m_open; }
+
+  /** @brief Returns true if the file is decoded on the DecodePool, false if it is read natively on the IoScheduler. */
+  bool is_pooled() const { return m_open && !p_wav_reader; }
+
+  unsigned int get_channels() const { return m_channels; }
+  unsigned int get_sample_rate() const { return m_sample_rate; }
+  uint64_t get_frames() const { return m_frames; }
+
+  /** @brief Jump to a frame. Heard on the next block if the frame is inside a cue point's preload. */
+  void seek(uint64_t frame) noexcept;
+
+  /** @brief Loop [start_frame, end_frame) once playback reaches end_frame. NO_LOOP as end_frame plays through.
+   *  @return False if the region is shorter than MIN_LOOP_FRAMES.
+   */
+  bool set_loop_region(uint64_t start_frame, uint64_t end_frame) noexcept;
+
+  /** @brief Replace the cue points. Cues point into immutable SampleBuffers, so they can be shared between streams. */
+  void set_cue_points(const CuePointList &cues);
+
+  /** @brief Returns the file frame the next block starts at. */
+  uint64_t get_position() const noexcept { return m_position.load(std::memory_order_acquire); }
+
+  /** @brief Returns the read-ahead depth the producer currently keeps, in frames. */
+  size_t get_read_ahead_frames() const noexcept { return m_read_ahead_frames.load(std::memory_order_relaxed); }
+
+  /** @brief Returns the slowest recent disk read, in milliseconds. */
+  double get_read_latency_ms() const noexcept { return m_read_latency_ms.load(std::memory_order_relaxed); }
+
+  /** @note Audio thread only. Control threads use get_buffered_frames(). */
+  size_t get_available_frames() const noexcept override;
+
+  /** @brief Returns the frames ready to play from the last seek on, cue preload included.
+   *  0 while a seek has not been served yet, as the ring still holds audio from before it.
+   *  @note Any thread.
+   */
+  size_t get_buffered_frames() const noexcept;
+
+  size_t read_frames(float *destination, size_t frames) noexcept override;
+
+  /** @brief Producer step: serve a pending seek or loop wrap, or top the ring up by at most max_frames.
+   *  Called by one DecodePool worker at a time. Reads synchronously.
+   *  @return eFillStep::Worked if the step did something, else why not.
+   */
+  eFillStep service(size_t max_frames);
+
+  /** @brief Returns how soon the stream needs its producer, in seconds: the audio left above the low
+   *  watermark, or -infinity while a seek or loop wrap is waiting to be served however full the ring is.
+   *  @note Producer side only, e.g. a scheduler thread holding the StreamQueue's lock while the stream is unclaimed.
+   */
+  double get_deadline_seconds() const noexcept;
+
+  /** @brief Producer step for natively read files that leaves the read to the caller, e.g. to batch it with others.
+   *  @param request Set to the read to issue when eFillStep::Read is returned. Finish it with complete_read().
+   */
+  eFillStep prepare_read(size_t max_frames, WavReader::ReadRequest &request);
+
+  /** @brief Issue a read from prepare_read() synchronously. Returns the number of bytes read. */
+  size_t submit_read(const WavReader::ReadRequest &request) { return p_wav_reader->submit_read(request); }
+
+  /** @brief Finish a read from prepare_read().
+   *  @param bytes_read Bytes the read returned.
+   *  @param read_seconds How long the read took, which sets the read-ahead depth.
+   */
+  void complete_read(const WavReader::ReadRequest &request, size_t bytes_read, double read_seconds);
+
+private:
+  /** @struct SegmentMarker
+   *  @brief Where a discontinuity written by the producer, a seek or a loop wrap, starts.
+   */
+  struct SegmentMarker
+  {
+    uint64_t stream_frame{0}; // Frames written to the ring before the segment
+    uint64_t file_frame{0};   // File frame the segment starts at
+  };
+
+  /** @struct CueTable
+   *  @brief Immutable cue points sorted by frame, read by the audio thread.
+   */
+  struct CueTable
+  {
+    CuePointList cues;
+  };
+
+  /** @brief Producer: serve a pending seek or loop wrap, or work out how many frames to read next. */
+  eFillStep begin_fill(size_t max_frames, size_t &frames_to_read);
+
+  /** @brief Producer: move frames read into m_scratch to the ring, or handle the end of the file. */
+  void end_fill(size_t frames_read, double read_seconds);
+
+  size_t read_file(float *destination, size_t frames);
+  void seek_file(uint64_t frame);
+
+  /** @brief Producer: deepen the read-ahead after a slow read, and let it recover while reads are fast. */
+  void update_read_ahead(double read_seconds, size_t capacity_frames) noexcept;
+
+  /** @brief Audio thread: start serving a new seek. */
+  void begin_seek(uint64_t frame) noexcept;
+
+  /** @brief Audio thread: drop the stale ring once the producer has paused for the seek. */
+  void try_flush() noexcept;
+
+  /** @brief Audio thread: count frames read from the ring and follow the segments they belong to. */
+  void advance_position(size_t frames) noexcept;
+
+  /** @brief Audio thread: publish the cue frames left for get_buffered_frames(). */
+  void publish_cue_frames() noexcept;
+
+  // Set when the file opens
+  framework::BufferPtr p_ring;
+  std::unique_ptr<WavReader> p_wav_reader;
+  SNDFILE *p_snd_file{nullptr};
+  unsigned int m_channels{0};
+  unsigned int m_sample_rate{0};
+  uint64_t m_frames{0};
+  size_t m_min_read_ahead_frames{0};
+  bool m_open{false};
+
+  // Requests from control threads
+  std::atomic<uint64_t> m_seek_frame{0};
+  std::atomic<uint64_t> m_seek_sequence{0};
+  std::atomic<uint64_t> m_loop_start{0};
+  std::atomic<uint64_t> m_loop_end{NO_LOOP};
+  framework::RcuPointer<CueTable> m_cues;
+
+  // Seek handshake between the producer and the audio thread
+  std::atomic<uint64_t> m_paused_sequence{0};  // Producer stopped filling for this seek
+  std::atomic<uint64_t> m_paused_written{0};   // Frames it had written to the ring by then
+  std::atomic<uint64_t> m_flushed_sequence{0}; // Audio thread dropped the ring for this seek
+  std::atomic<uint64_t> m_resume_frame{0};     // File frame the producer resumes at
+  framework::RingBuffer<SegmentMarker> m_markers{1024};
+
+  // Reported to control threads
+  std::atomic<uint64_t> m_position{0};
+  std::atomic<size_t> m_cue_frames{0};        // Cue frames left to play for the seek in m_cue_sequence
+  std::atomic<uint64_t> m_cue_sequence{0};
+  std::atomic<size_t> m_read_ahead_frames{0};
+  std::atomic<double> m_read_latency_ms{0.0};
+
+  // Audio thread only
+  uint64_t m_consumer_sequence{0};
+  bool m_flushed{true};
+  uint64_t m_seek_target{0};
+  uint64_t m_consumed{0};      // Frames read from the ring
+  SegmentMarker m_segment;     // Segment the ring is being read from
+  SegmentMarker m_next_segment;
+  bool m_has_next_segment{false};
+  uint64_t m_cue_frame{0};     // Cue being played, while m_cue_offset < m_cue_end
+  size_t m_cue_offset{0};
+  size_t m_cue_end{0};
+
+  // Producer only: the scheduler thread that has claimed the stream
+  uint64_t m_producer_sequence{0};
+  uint64_t m_written{0};
+  uint64_t m_file_frame{0};
+  bool m_end_of_file{false};
+  bool m_waiting_for_flush{false};
+  bool m_marker_pending{false};
+  SegmentMarker m_pending_marker;
+  uint64_t m_fill_loop_end{NO_LOOP}; // Loop end the current read was sized for
+  std::vector<float> m_scratch;
+  double m_slowest_read{0.0};
+};
+
+using FileStreamPtr = std::shared_ptr<FileStream>;
+
+} // namespace miniaudioengine::adapters
+
+#endif // __FILE_STREAM_H__
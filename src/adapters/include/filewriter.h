@@ -0,0 +1,185 @@
+#ifndef __FILE_WRITER_H__
+#define __FILE_WRITER_H__
+
+#include "bufferarena.h"
+#include "ringbuffer.h"
+#include "sampleformat.h"
+#include "streamstatistics.h"
+
+#include <sndfile.h>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <semaphore>
+#include <span>
+#include <string>
+#include <thread>
+
+namespace miniaudioengine::adapters
+{
+
+/** @brief Sample encoding of a written audio file. */
+using eSampleFormat = framework::eSampleFormat;
+
+/** @struct FileWriterConfig
+ *  @brief Encoding and buffering of a file written by a FileWriter.
+ */
+struct FileWriterConfig
+{
+  static constexpr size_t DEFAULT_CHUNK_FRAMES = 16 * 1024;
+  static constexpr size_t DEFAULT_CHUNK_COUNT = 8;
+
+  /** @brief Sample encoding. Integer formats clip out-of-range samples. */
+  eSampleFormat format{eSampleFormat::Float32};
+
+  /** @brief Frames per chunk, which is also the size of every disk write. */
+  size_t chunk_frames{DEFAULT_CHUNK_FRAMES};
+
+  /** @brief Chunks in the pool. chunk_frames * chunk_count frames can be queued before audio is dropped. */
+  size_t chunk_count{DEFAULT_CHUNK_COUNT};
+
+  /** @brief Reserve disk space for this many frames up front, so the file system does not
+   *         allocate blocks while recording. 0 disables it. Linux only.
+   */
+  unsigned long long preallocate_frames{0};
+};
+
+/** @class FileWriter
+ *  @brief Streams interleaved float audio to a WAV file on a background thread.
+ *  Audio is copied into a pool of preallocated, 64-byte aligned chunks. Full chunks travel to a
+ *  writer thread through a lock-free SPSC queue and come back through a second one once written,
+ *  so the producer never blocks on the disk and the writer always issues one large
+ *  sf_writef_float per chunk straight from the chunk's memory. When every chunk is in flight the
+ *  producer drops audio instead of waiting, and counts it.
+ */
+class FileWriter
+{
+public:
+  using Config = FileWriterConfig;
+
+  FileWriter() = default;
+  ~FileWriter();
+
+  FileWriter(const FileWriter &) = delete;
+  FileWriter &operator=(const FileWriter &) = delete;
+
+  /** @brief Create the file, allocate the chunk pool and start the writer thread.
+   *  @param path Destination, overwritten if it exists.
+   *  @param channels Number of interleaved channels.
+   *  @param sample_rate Sample rate in Hz.
+   *  @param config Encoding and buffering.
+   *  @return False if the file cannot be created or a file is already open.
+   */
+  bool open(const std::filesystem::path &path, unsigned int channels, unsigned int sample_rate,
+            const Config &config = Config());
+
+  /** @brief Queue as many whole frames as there are free chunks for.
+   *  Frames that do not fit are counted by get_dropped_frames() and the statistics.
+   *  @param samples Interleaved samples, a whole number of frames.
+   *  @return The number of samples queued.
+   *  @note Producer thread only. Lock-free and allocation-free, safe on the audio thread.
+   */
+  size_t write(std::span<const float> samples) noexcept;
+
+  /** @brief Queue every sample, waiting for the writer thread whenever no chunk is free.
+   *  For producers that run faster than the disk, e.g. an offline render.
+   *  @return False if the writer failed or no file is open.
+   *  @note Producer thread only.
+   */
+  bool write_all(std::span<const float> samples);
+
+  /** @brief Hand the partially filled chunk to the writer thread.
+   *  @note Producer thread only.
+   */
+  void flush() noexcept;
+
+  /** @brief Write out everything queued, stop the writer thread and finalize the file.
+   *  @note Call once the producer has stopped writing.
+   *  @return False if any write failed.
+   */
+  bool close();
+
+  /** @brief Record dropped frames into a StreamStatistics.
+   *  @param statistics Statistics to update, or nullptr to stop recording.
+   *  @note Must be set while the file is closed.
+   */
+  bool set_statistics(const framework::StreamStatisticsPtr &statistics);
+
+  bool is_open() const { return p_file != nullptr; }
+
+  /** @brief Returns true if libsndfile reported a short write. */
+  bool has_error() const { return m_error.load(std::memory_order_acquire); }
+
+  const std::filesystem::path &get_path() const { return m_path; }
+  unsigned int get_channels() const { return m_channels; }
+  unsigned int get_sample_rate() const { return m_sample_rate; }
+
+  /** @brief Returns the number of frames written to the file so far. */
+  unsigned long long get_frames_written() const { return m_frames_written.load(std::memory_order_relaxed); }
+
+  /** @brief Returns the number of frames write() dropped because every chunk was in flight. */
+  unsigned long long get_dropped_frames() const { return m_dropped_frames.load(std::memory_order_relaxed); }
+
+private:
+  /** @struct ChunkRef
+   *  @brief A chunk of the pool and the number of frames it holds.
+   */
+  struct ChunkRef
+  {
+    uint32_t index{0};
+    uint32_t frames{0};
+  };
+
+  static constexpr uint32_t NO_CHUNK = UINT32_MAX;
+
+  SNDFILE *open_file(const std::filesystem::path &path, SF_INFO &info, const Config &config);
+
+  /** @brief Returns the interleaved samples of a chunk, stored as a one-channel arena buffer. */
+  float *get_chunk(uint32_t index) noexcept { return m_chunks.get_channel(index, 0); }
+
+  size_t queue(std::span<const float> samples) noexcept;
+
+  void submit_chunk() noexcept;
+
+  void run(std::stop_token stop_token);
+
+  static void notify(std::atomic<bool> &pending, std::binary_semaphore &signal) noexcept;
+  static void wait(std::atomic<bool> &pending, std::binary_semaphore &signal);
+
+  SNDFILE *p_file{nullptr};
+  std::filesystem::path m_path;
+  unsigned int m_channels{0};
+  unsigned int m_sample_rate{0};
+  size_t m_chunk_frames{0};
+
+  // Chunk pool and the two queues a chunk cycles through: free -> producer -> full -> writer -> free
+  framework::BufferArena m_chunks;
+  std::unique_ptr<framework::RingBuffer<uint32_t>> p_free_chunks;
+  std::unique_ptr<framework::RingBuffer<ChunkRef>> p_full_chunks;
+
+  // Producer state, the chunk currently being filled
+  uint32_t m_current_chunk{NO_CHUNK};
+  size_t m_current_frames{0};
+
+  std::unique_ptr<std::jthread> p_writer_thread;
+
+  // Writer wakeup when a chunk is submitted, and producer wakeup when a chunk is returned.
+  // Each is signalled at most once until the waiter consumes it.
+  std::atomic<bool> m_data_pending{false};
+  std::binary_semaphore m_data_signal{0};
+  std::atomic<bool> m_space_pending{false};
+  std::binary_semaphore m_space_signal{0};
+
+  framework::StreamStatisticsPtr p_statistics;
+
+  std::atomic<bool> m_error{false};
+  std::atomic<unsigned long long> m_frames_written{0};
+  std::atomic<unsigned long long> m_dropped_frames{0};
+};
+
+using FileWriterPtr = std::shared_ptr<FileWriter>;
+
+} // namespace miniaudioengine::adapters
+
+#endif // __FILE_WRITER_H__
@@ -0,0 +1,83 @@
+#ifndef __IO_SCHEDULER_H__
+#define __IO_SCHEDULER_H__
+
+#include "streamqueue.h"
+#include "wavreader.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace miniaudioengine::adapters
+{
+
+class FileStream;
+
+/** @class IoScheduler
+ *  @brief Engine-wide I/O thread that fills the rings of every natively read FileStream.
+ *  One thread serves all streams, however many tracks are open. Each pass it claims up to
+ *  MAX_BATCH streams from the StreamQueue, emptiest ring first, prepares one read of at most
+ *  READ_BUDGET_FRAMES for each and issues them together. On Linux the batch is submitted to an
+ *  io_uring with a single system call, so the reads proceed in parallel on the device; where
+ *  io_uring is unavailable, e.g. an old kernel or a container that blocks it, they are issued
+ *  one after another with pread.
+ */
+class IoScheduler
+{
+public:
+  /** @brief Most streams read in one batch. */
+  static constexpr size_t MAX_BATCH = 32;
+
+  /** @brief Most frames read into one stream per batch. */
+  static constexpr size_t READ_BUDGET_FRAMES = 8192;
+
+  IoScheduler();
+  ~IoScheduler();
+
+  IoScheduler(const IoScheduler &) = delete;
+  IoScheduler &operator=(const IoScheduler &) = delete;
+
+  /** @brief The scheduler every natively read FileStream is filled by. */
+  static IoScheduler &instance()
+  {
+    static IoScheduler instance;
+    return instance;
+  }
+
+  /** @brief Start filling a stream. */
+  void add(FileStream *stream) { m_queue.add(stream); }
+
+  /** @brief Stop filling a stream. Returns once its reads have completed, so it can then be closed. */
+  void remove(FileStream *stream) { m_queue.remove(stream); }
+
+  /** @brief Wake the I/O thread, e.g. after a seek, instead of waiting for the next poll. */
+  void wake() noexcept { m_queue.wake(); }
+
+  /** @brief Returns the number of streams being filled. */
+  size_t get_stream_count() const { return m_queue.size(); }
+
+  /** @brief Returns true while batches are submitted through io_uring rather than pread. */
+  bool is_io_uring_enabled() const { return m_io_uring_enabled.load(std::memory_order_relaxed); }
+
+private:
+  void run(std::stop_token stop_token);
+
+  /** @brief Issue the reads prepared for a batch of streams and wait for all of them.
+   *  @param bytes_read Receives the bytes each read returned.
+   */
+  void read_batch(const std::vector<FileStream *> &streams, const std::vector<WavReader::ReadRequest> &requests,
+                  std::vector<size_t> &bytes_read);
+
+  struct Uring;
+  std::unique_ptr<Uring> p_uring;
+  std::atomic<bool> m_io_uring_enabled{false};
+
+  StreamQueue m_queue;
+  std::jthread m_thread; // Declared last, so the thread stops before the queue and ring are destroyed
+};
+
+} // namespace miniaudioengine::adapters
+
+#endif // __IO_SCHEDULER_H__
@@ -0,0 +1,179 @@
+#ifndef __JITTER_BUFFER_H__
+#define __JITTER_BUFFER_H__
+
+#include "audiosource.h"
+#include "bufferarena.h"
+#include "driftestimator.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace miniaudioengine::adapters
+{
+
+/** @struct JitterBufferConfig
+ *  @brief Format and delay range of a JitterBuffer.
+ */
+struct JitterBufferConfig
+{
+  unsigned int channels{2};
+  unsigned int packet_frames{48};
+  unsigned int sample_rate{48000};
+
+  /** @brief Packet slots, rounded up to a power of two. Raised to hold twice max_delay_ms. */
+  size_t capacity_packets{64};
+
+  /** @brief Largest block read_frames() converts at once. Larger reads are split. */
+  size_t max_read_frames{1024};
+
+  double min_delay_ms{2.0};
+  double max_delay_ms{40.0};
+};
+
+/** @class JitterBuffer
+ *  @brief Reorders received packets and plays them out at an adaptive delay, as an IAudioSource.
+ *  The receive thread stores each packet in the slot of its sequence number, so reordered packets
+ *  land in place and the audio thread reads them in order without a lock. A packet that has not
+ *  arrived when its turn comes is played as silence and counted lost; if it arrives later it is late
+ *  and dropped.
+ *  The playout delay is one read block, one packet and four times the RFC 3550 interarrival jitter,
+ *  plus a margin that grows on every underrun by the backlog the stall left and decays slowly, clamped to
+ *  [min_delay_ms, max_delay_ms].
+ *  The audio thread steers the buffered frames towards it by reading slightly faster or slower with
+ *  linear interpolation. A DriftEstimator does the steering: its integral converges on the clock drift
+ *  between the sender and the reading stream, so the delay holds for hours without dropouts, and the
+ *  correction stays within 0.5%, well below an audible pitch change.
+ *  @note push() and restart() are the receive thread's, read_frames() the audio thread's.
+ */
+class JitterBuffer : public framework::IAudioSource
+{
+public:
+  using Config = JitterBufferConfig;
+
+  JitterBuffer() = default;
+  ~JitterBuffer() override = default;
+
+  JitterBuffer(const JitterBuffer &) = delete;
+  JitterBuffer &operator=(const JitterBuffer &) = delete;
+
+  /** @brief Allocate the slots and scratch buffers. Control thread, before either thread runs.
+   *  @return False if the format is invalid.
+   */
+  bool prepare(const Config &config);
+
+  /** @brief Store a received packet. The first packet of a stream only places the playout position.
+   *  @param sequence RTP sequence number.
+   *  @param timestamp RTP timestamp, in frames.
+   *  @param samples Interleaved samples of the packet.
+   *  @param frames Frames in the packet, at most packet_frames.
+   *  @param arrival_ns Arrival time in nanoseconds on any steady clock.
+   *  @return False if the packet was late, a duplicate or did not fit.
+   *  @note Receive thread only. Lock-free and allocation-free.
+   */
+  bool push(uint16_t sequence, uint32_t timestamp, const float *samples, unsigned int frames, uint64_t arrival_ns) noexcept;
+
+  /** @brief Start over with a new sender. Its first packet places the playout position again.
+   *  @note Receive thread only.
+   */
+  void restart() noexcept;
+
+  size_t get_available_frames() const noexcept override;
+
+  /** @brief Play out up to frames interleaved frames. Outputs silence while buffering up to the delay.
+   *  @return The frames written, fewer than asked only in the block the buffer runs dry.
+   *  @note Audio thread only. Lock-free and allocation-free.
+   */
+  size_t read_frames(float *destination, size_t frames) noexcept override;
+
+  /** @brief Returns the playout delay the buffer is converging on, in frames. */
+  size_t get_target_frames() const noexcept { return m_target_frames.load(std::memory_order_relaxed); }
+
+  /** @brief Returns the RFC 3550 interarrival jitter, in frames. */
+  double get_jitter_frames() const noexcept { return m_jitter_frames.load(std::memory_order_relaxed); }
+
+  /** @brief Returns the sender's clock drift against the reading stream's, in parts per million. */
+  double get_drift_ppm() const noexcept { return m_drift_ppm.load(std::memory_order_relaxed); }
+
+  unsigned long long get_received_packets() const noexcept { return m_received.load(std::memory_order_relaxed); }
+  unsigned long long get_lost_packets() const noexcept { return m_lost.load(std::memory_order_relaxed); }
+  unsigned long long get_late_packets() const noexcept { return m_late.load(std::memory_order_relaxed); }
+  unsigned long long get_dropped_packets() const noexcept { return m_dropped.load(std::memory_order_relaxed); }
+  unsigned long long get_underrun_count() const noexcept { return m_underruns.load(std::memory_order_relaxed); }
+
+  unsigned int get_channels() const noexcept { return m_channels; }
+  unsigned int get_sample_rate() const noexcept { return m_sample_rate; }
+
+private:
+  enum class eState
+  {
+    Buffering,
+    Playing
+  };
+
+  static constexpr uint64_t NO_SEQUENCE = 0;
+
+  float *get_slot(uint64_t sequence) noexcept { return m_slots.get_channel(sequence & m_mask, 0); }
+
+  size_t get_fill_frames(uint64_t newest) const noexcept;
+  size_t read_block(float *destination, size_t frames) noexcept;
+  bool pull_packet(uint64_t newest) noexcept;
+  void skip_to(uint64_t sequence) noexcept;
+
+  unsigned int m_channels{0};
+  unsigned int m_packet_frames{0};
+  unsigned int m_sample_rate{0};
+  size_t m_capacity{0};
+  size_t m_mask{0};
+  size_t m_max_read_frames{0};
+  size_t m_min_delay_frames{0};
+  size_t m_max_delay_frames{0};
+
+  // Packet slots. A slot's tag is the extended sequence number it holds plus one, published after its samples
+  framework::BufferArena m_slots;
+  std::unique_ptr<std::atomic<uint64_t>[]> p_tags;
+  std::unique_ptr<unsigned int[]> p_slot_frames;
+
+  // Shared between the threads
+  std::atomic<uint64_t> m_newest{NO_SEQUENCE};          // Newest extended sequence number stored
+  std::atomic<uint64_t> m_read_sequence{0};             // Next sequence number the audio thread plays
+  std::atomic<uint64_t> m_resync_sequence{NO_SEQUENCE}; // Asks the audio thread to play from here
+  std::atomic<double> m_jitter_frames{0.0};
+
+  // Receive thread
+  bool m_has_packets{false};
+  uint64_t m_base{0};            // Extended sequence numbers of the next sender start above here
+  uint64_t m_newest_written{0};
+  uint32_t m_last_timestamp{0};
+  uint64_t m_last_arrival_ns{0};
+  double m_jitter{0.0};
+
+  // Audio thread: frames copied out of the slots, and the interpolation position within them
+  eState m_state{eState::Buffering};
+  uint64_t m_read{0};
+  std::vector<float> m_staging;
+  std::vector<float> m_planar;
+  size_t m_staged_frames{0};
+  double m_position{0.0};
+  double m_ratio{1.0};
+  framework::DriftEstimator m_rate_control;
+  double m_margin_frames{0.0};
+  size_t m_underrun_target{0}; // Delay the buffer last ran dry at
+
+  // Read by any thread
+  std::atomic<size_t> m_target_frames{0};
+  std::atomic<double> m_drift_ppm{0.0};
+  std::atomic<unsigned long long> m_received{0};
+  std::atomic<unsigned long long> m_lost{0};
+  std::atomic<unsigned long long> m_late{0};
+  std::atomic<unsigned long long> m_dropped{0};
+  std::atomic<unsigned long long> m_underruns{0};
+};
+
+using JitterBufferPtr = std::shared_ptr<JitterBuffer>;
+
+} // namespace miniaudioengine::adapters
+
+#endif // __JITTER_BUFFER_H__
@@ -8,6 +8,11 @@
 
 #include "device.h"
 #include "logger.h"
+#include "midiqueue.h"
+#include "streamclock.h"
+#include "streamstatistics.h"
+
+#include <atomic>
 
 namespace miniaudioengine::adapters
 {
@@ -18,20 +23,35 @@ namespace miniaudioengine::adapters
 class MidiCallbackHandler
 {
 public:
+  /** @struct Params
+   *  @brief State shared with the RtMidi callback thread.
+   */
+  struct Params
+  {
+    framework::MidiQueue *queue{nullptr};
+    const framework::StreamClock *clock{nullptr};
+    std::atomic<unsigned long long> overflow_count{0};
+    framework::StreamStatistics *statistics{nullptr};
+
+    // Timeline of the RtMidi deltatimes, anchored to the arrival time of a message
+    bool anchored{false};
+    framework::StreamClock::Clock::time_point anchor;
+    double seconds_since_anchor{0.0};
+  };
+
+  /** @brief Largest gap between RtMidi's timeline and the arrival time before re-anchoring. */
+  static constexpr double MAX_LATENESS_SECONDS = 0.01;
+
   /** @brief Callback function to handle incoming MIDI messages.
    *  This function is called by the RtMidi library when a MIDI message is received.
-   *  It prints the received MIDI message to the console.
+   *  It stamps the message with the stream frame it was received at and pushes it to the
+   *  Params queue without locking, allocating or logging.
    *
    *  @param deltatime The time in seconds since the last message was received.
    *  @param message A vector containing the MIDI message bytes.
-   *  @param user_data A pointer to the MidiEngine object.
+   *  @param user_data A pointer to the Params.
    */
-  static void midi_callback(double deltatime, std::vector<unsigned char> *message, void *user_data)
-  {
-    (void)deltatime;
-    (void)user_data;
-    (void)message;
-  }
+  static void midi_callback(double deltatime, std::vector<unsigned char> *message, void *user_data) noexcept;
 };
 
 class MidiAdapter
@@ -46,12 +66,33 @@ public:
   std::vector<DevicePtr> get_devices();
 
   bool open_input_port(DevicePtr device, void *callback_context);
+
+  /** @brief Open an input port that pushes every message into a queue.
+   *  @param port Port number of the MIDI device.
+   *  @param queue Queue drained by the audio thread.
+   *  @param clock Clock of the stream the messages are timestamped against. May be nullptr.
+   *  @param statistics Statistics that count messages dropped by a full queue. May be nullptr.
+   */
+  bool open_input_port(unsigned int port, const framework::MidiQueuePtr &queue, const framework::StreamClockPtr &clock,
+                       const framework::StreamStatisticsPtr &statistics = nullptr);
   bool close_input_port();
 
   bool is_port_open();
 
+  /** @brief Returns the number of messages dropped because the queue was full. */
+  unsigned long long get_overflow_count() const
+  {
+    return m_callback_params.overflow_count.load(std::memory_order_relaxed);
+  }
+
 private:
+  bool open_port(unsigned int port, void *callback_context);
+
   std::unique_ptr<RtMidiIn> p_rtmidi_in;
+  MidiCallbackHandler::Params m_callback_params;
+  framework::MidiQueuePtr p_queue;
+  framework::StreamClockPtr p_clock;
+  framework::StreamStatisticsPtr p_statistics;
 
   static DevicePtr make_device_handle(const unsigned int id, const std::string &name)
   {
@@ -0,0 +1,193 @@
+#ifndef __NETWORK_ADAPTER_H__
+#define __NETWORK_ADAPTER_H__
+
+#include "audioadapter.h"
+#include "bufferarena.h"
+#include "jitterbuffer.h"
+#include "networkstream.h"
+#include "ringbuffer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <semaphore>
+#include <thread>
+#include <vector>
+
+namespace miniaudioengine::adapters
+{
+
+/** @brief Bytes of an RTP header without CSRCs or extensions. */
+constexpr size_t RTP_HEADER_SIZE = 12;
+
+/** @brief Largest RTP payload that fits an Ethernet frame: 1500 bytes less the IPv4, UDP and RTP headers. */
+constexpr size_t MAX_RTP_PAYLOAD_SIZE = 1500 - 20 - 8 - RTP_HEADER_SIZE;
+
+/** @brief Native UDP socket, kept as an integer so this header stays free of the socket headers. */
+using SocketHandle = intptr_t;
+constexpr SocketHandle INVALID_SOCKET_HANDLE = -1;
+
+/** @class NetworkSender
+ *  @brief Renders an AudioGraph on a timer thread and streams it as RTP over UDP.
+ *  The render thread wakes once per period like the SyntheticAudioAdapter's, runs the same
+ *  AudioCallbackHandler a device would, and copies the block into preallocated packets that travel
+ *  to the sender thread through a lock-free SPSC queue, as a FileWriter's chunks do. The sender
+ *  thread encodes each packet, writes its RTP header and hands the kernel every queued packet in one
+ *  sendmmsg() call, then returns them through a second queue. When every packet is in flight the
+ *  render thread drops the audio of a packet and counts it instead of waiting.
+ */
+class NetworkSender
+{
+public:
+  NetworkSender() = default;
+  ~NetworkSender();
+
+  NetworkSender(const NetworkSender &) = delete;
+  NetworkSender &operator=(const NetworkSender &) = delete;
+
+  /** @brief Open the socket, allocate the packets and start the render and sender threads.
+   *  @return False if a stream is open, the format is invalid, a packet does not fit an Ethernet
+   *          frame, or there is no AudioGraph.
+   */
+  bool open_stream(const NetworkStreamConfig &network, const framework::StreamConfig &config);
+  bool close_stream();
+
+  bool is_stream_open() const { return m_socket != INVALID_SOCKET_HANDLE; }
+
+  /** @brief See AudioAdapter::set_audio_graph(). Must be set while the stream is closed. */
+  bool set_audio_graph(const std::shared_ptr<dataplane::AudioGraph> &graph);
+
+  /** @brief See AudioAdapter::set_statistics(). Must be set while the stream is closed. */
+  bool set_statistics(const framework::StreamStatisticsPtr &statistics);
+
+  unsigned long long get_packets_sent() const { return m_packets_sent.load(std::memory_order_relaxed); }
+
+  /** @brief Returns the number of packets dropped because every packet was in flight. */
+  unsigned long long get_packets_dropped() const { return m_packets_dropped.load(std::memory_order_relaxed); }
+
+  unsigned long long get_send_errors() const { return m_send_errors.load(std::memory_order_relaxed); }
+
+  /** @brief Returns the number of periods skipped because the render thread fell too far behind to catch up. */
+  unsigned long long get_missed_periods() const { return m_missed_periods.load(std::memory_order_relaxed); }
+
+  /** @brief Returns the render period plus one packet, in frames. */
+  unsigned long long get_latency_frames() const { return m_latency_frames; }
+
+private:
+  /** @struct PacketRef
+   *  @brief A packet of the pool, its RTP sequence number and its first frame in the stream, the RTP timestamp.
+   */
+  struct PacketRef
+  {
+    uint32_t index{0};
+    uint16_t sequence{0};
+    uint32_t timestamp{0};
+  };
+
+  static constexpr uint32_t NO_PACKET = UINT32_MAX;
+
+  float *get_packet(uint32_t index) noexcept { return m_packets.get_channel(index, 0); }
+
+  void render(std::stop_token stop_token);
+  void queue(const float *samples, unsigned int frames) noexcept;
+  void send(std::stop_token stop_token);
+  size_t encode(const PacketRef &packet, uint8_t *datagram) noexcept;
+  void send_batch(size_t count);
+
+  NetworkStreamConfig m_network;
+  AudioCallbackHandler::Params m_callback_params;
+  std::shared_ptr<dataplane::AudioGraph> p_audio_graph;
+  framework::StreamStatisticsPtr p_statistics;
+  SocketHandle m_socket{INVALID_SOCKET_HANDLE};
+  unsigned int m_frames_per_buffer{0};
+  unsigned long long m_latency_frames{0};
+  size_t m_payload_size{0};
+
+  // Packet pool and the two queues a packet cycles through: free -> render -> full -> sender -> free
+  framework::BufferArena m_packets;
+  std::unique_ptr<framework::RingBuffer<uint32_t>> p_free_packets;
+  std::unique_ptr<framework::RingBuffer<PacketRef>> p_full_packets;
+
+  // Render thread: the rendered block and the packet being filled. A packet dropped while the pool is
+  // empty still takes its sequence number, so the receiver plays silence for it instead of closing the gap
+  std::vector<float> m_output;
+  uint32_t m_current_packet{NO_PACKET};
+  unsigned int m_current_frames{0};
+  uint16_t m_sequence{0};
+  uint32_t m_timestamp{0};
+
+  // Sender thread: the packets of a batch and their datagrams
+  uint32_t m_ssrc{0};
+  bool m_first_packet{true};
+  bool m_error_logged{false};
+  std::vector<PacketRef> m_batch;
+  std::vector<uint8_t> m_datagrams;
+  std::vector<size_t> m_datagram_sizes;
+
+  std::unique_ptr<std::jthread> p_render_thread;
+  std::unique_ptr<std::jthread> p_sender_thread;
+
+  // Sender wakeup when a packet is submitted, signalled at most once until the sender consumes it
+  std::atomic<bool> m_data_pending{false};
+  std::binary_semaphore m_data_signal{0};
+
+  std::atomic<unsigned long long> m_packets_sent{0};
+  std::atomic<unsigned long long> m_packets_dropped{0};
+  std::atomic<unsigned long long> m_send_errors{0};
+  std::atomic<unsigned long long> m_missed_periods{0};
+};
+
+/** @class NetworkReceiver
+ *  @brief Receives an RTP audio stream over UDP into a JitterBuffer.
+ *  A receive thread takes batches of datagrams with recvmmsg(). On Linux the kernel timestamps each on
+ *  arrival, so the jitter estimate does not include the thread's own wakeup latency. Each packet is checked,
+ *  decoded to float and stored in the jitter buffer, which the audio thread reads as an IAudioSource.
+ *  The receiver follows the first sender it hears. Another sender takes over once the current one has
+ *  been silent for a second.
+ */
+class NetworkReceiver
+{
+public:
+  NetworkReceiver() = default;
+  ~NetworkReceiver();
+
+  NetworkReceiver(const NetworkReceiver &) = delete;
+  NetworkReceiver &operator=(const NetworkReceiver &) = delete;
+
+  /** @brief Bind the socket, join the group of a multicast address and start the receive thread.
+   *  @param config frames_per_buffer bounds the blocks the jitter buffer converts at once.
+   *  @return False if a stream is open, the format is invalid or the socket cannot be bound.
+   */
+  bool open_stream(const NetworkStreamConfig &network, const framework::StreamConfig &config);
+  bool close_stream();
+
+  bool is_stream_open() const { return m_socket != INVALID_SOCKET_HANDLE; }
+
+  /** @brief Returns the jitter buffer the audio thread reads. Valid once a stream has been opened. */
+  JitterBufferPtr get_jitter_buffer() const { return p_jitter_buffer; }
+
+  /** @brief Returns the number of datagrams that were not a packet of the stream. */
+  unsigned long long get_packets_invalid() const { return m_packets_invalid.load(std::memory_order_relaxed); }
+
+private:
+  void receive(std::stop_token stop_token);
+  void handle_datagram(const uint8_t *data, size_t size, uint64_t arrival_ns);
+
+  NetworkStreamConfig m_network;
+  SocketHandle m_socket{INVALID_SOCKET_HANDLE};
+  JitterBufferPtr p_jitter_buffer;
+
+  // Receive thread: one datagram buffer per packet of a batch and the decoded samples of a packet
+  std::vector<uint8_t> m_datagrams;
+  std::vector<float> m_decoded;
+  bool m_has_sender{false};
+  uint32_t m_ssrc{0};
+  uint64_t m_last_packet_ns{0};
+
+  std::unique_ptr<std::jthread> p_receive_thread;
+  std::atomic<unsigned long long> m_packets_invalid{0};
+};
+
+} // namespace miniaudioengine::adapters
+
+#endif // __NETWORK_ADAPTER_H__
@@ -0,0 +1,87 @@
+#ifndef __STREAM_QUEUE_H__
+#define __STREAM_QUEUE_H__
+
+#include "filestream.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <vector>
+
+namespace miniaudioengine::adapters
+{
+
+/** @class StreamQueue
+ *  @brief The FileStreams a scheduler fills, handed to its threads earliest deadline first.
+ *  A stream's deadline is a pending seek first, then the audio left in its ring above the low
+ *  watermark, so the emptiest ring is filled first. A claimed stream is filled by one thread until
+ *  it is released, which keeps its ring single-producer. A stream with nothing to do is left alone
+ *  for POLL_INTERVAL, or SEEK_POLL_INTERVAL while a seek waits on the audio thread, and threads with
+ *  no stream due sleep until the next one is, since the audio thread never signals them directly.
+ *  @note Thread-safe.
+ */
+class StreamQueue
+{
+public:
+  /** @brief How long a stream with nothing to do is left before it is checked again. */
+  static constexpr std::chrono::milliseconds POLL_INTERVAL{5};
+
+  /** @brief How long a stream whose seek waits on the audio thread is left, which bounds the extra seek latency. */
+  static constexpr std::chrono::milliseconds SEEK_POLL_INTERVAL{1};
+
+  StreamQueue() = default;
+  ~StreamQueue() = default;
+
+  StreamQueue(const StreamQueue &) = delete;
+  StreamQueue &operator=(const StreamQueue &) = delete;
+
+  void add(FileStream *stream);
+
+  /** @brief Stop handing out a stream. Returns once no thread is filling it, so it can then be closed. */
+  void remove(FileStream *stream);
+
+  /** @brief Check every stream again right away, e.g. after a seek, instead of waiting for the next poll. */
+  void wake() noexcept;
+
+  /** @brief Returns the number of streams in the queue. */
+  size_t size() const;
+
+  /** @brief Block until streams are due, then claim up to max_streams of them, earliest deadline first.
+   *  @param streams Replaced with the claimed streams. Each must be handed back with release().
+   *  @return False if stop was requested.
+   */
+  bool acquire(std::stop_token stop_token, size_t max_streams, std::vector<FileStream *> &streams);
+
+  /** @brief Hand a claimed stream back.
+   *  @param step What the stream's last producer step did, which decides how long it is left alone.
+   */
+  void release(FileStream *stream, FileStream::eFillStep step);
+
+private:
+  /** @struct Entry
+   *  @brief A stream and its scheduling state.
+   */
+  struct Entry
+  {
+    FileStream *stream{nullptr};
+    bool busy{false}; // Claimed by a thread
+    std::chrono::steady_clock::time_point idle_until; // Had nothing to do, check again from then
+    double deadline{0.0};
+  };
+
+  mutable std::mutex m_mutex;
+  std::condition_variable_any m_wake;
+  std::condition_variable m_released; // A claimed stream was released, for remove()
+  std::atomic<uint64_t> m_wake_requests{0};
+  uint64_t m_cleared_requests{0}; // Wake requests already served by clearing idle times
+  std::vector<std::unique_ptr<Entry>> m_entries;
+  std::vector<Entry *> m_due; // Scratch for acquire(), reused to avoid allocating
+};
+
+} // namespace miniaudioengine::adapters
+
+#endif // __STREAM_QUEUE_H__
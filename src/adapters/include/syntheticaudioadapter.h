@@ -0,0 +1,122 @@
+#ifndef __SYNTHETIC_AUDIO_ADAPTER_H__
+#define __SYNTHETIC_AUDIO_ADAPTER_H__
+
+#include "audioadapter.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace miniaudioengine::adapters
+{
+
+/** @struct SyntheticDeviceConfig
+ *  @brief The simulated device a SyntheticAudioAdapter runs, and the stress it injects.
+ */
+struct SyntheticDeviceConfig
+{
+  unsigned int output_channels{2};
+
+  /** @brief Captured channels of a Duplex stream. The device captures a -20 dBFS 440 Hz sine. */
+  unsigned int input_channels{0};
+
+  /** @brief Sample rate used when StreamConfig::sample_rate is 0. */
+  unsigned int preferred_sample_rate{48000};
+
+  /** @brief Each callback wakes up late by a random 0 to jitter_us microseconds, like a busy driver thread. */
+  unsigned int jitter_us{0};
+
+  /** @brief Share of every period the simulated driver spins on the audio thread before the callback,
+   *  taking headroom away from the engine like other processes competing for the core. 0 to 100.
+   */
+  double load_percent{0.0};
+
+  /** @brief Seed of the jitter, so a failing run can be repeated. */
+  uint32_t seed{1};
+
+  std::string to_string() const;
+};
+
+/** @class SyntheticAudioAdapter
+ *  @brief Audio backend without a device: a timer thread runs the real audio callback once per period.
+ *  The thread wakes on a high-resolution deadline and hands the block to the same AudioCallbackHandler
+ *  RtAudio streams use, so the graph, the StreamStatistics and the RT_ASSERT checks behave as with
+ *  hardware. The device buffers two periods. A callback that finishes after the next period started
+ *  underflowed it: the next callback is flagged with RTAUDIO_OUTPUT_UNDERFLOW, recorded as an xrun, and
+ *  the timer skips the periods it missed. Used for headless soak runs that gate releases.
+ */
+class SyntheticAudioAdapter
+{
+public:
+  SyntheticAudioAdapter() = default;
+  ~SyntheticAudioAdapter();
+
+  SyntheticAudioAdapter(const SyntheticAudioAdapter &) = delete;
+  SyntheticAudioAdapter &operator=(const SyntheticAudioAdapter &) = delete;
+
+  /** @brief Open the simulated device and start its timer thread.
+   *  @return False if a stream is open, the direction has no channels, or a Duplex stream has no graph.
+   */
+  bool open_stream(const SyntheticDeviceConfig &device, const framework::BufferPtr &buffer,
+                   const framework::eInputOutputDirection &direction, const framework::StreamConfig &config);
+  bool close_stream();
+  bool stop_stream();
+
+  bool is_stream_open() const { return m_open; }
+  bool is_stream_running() const { return p_thread != nullptr; }
+
+  /** @brief See AudioAdapter::set_audio_graph(). Must be set while the stream is closed. */
+  bool set_audio_graph(const std::shared_ptr<dataplane::AudioGraph> &graph);
+
+  /** @brief See AudioAdapter::set_stream_mixer(). Must be set while the stream is closed. */
+  bool set_stream_mixer(const std::shared_ptr<dataplane::StreamMixer> &mixer);
+
+  /** @brief See AudioAdapter::set_statistics(). Must be set while the stream is closed. */
+  bool set_statistics(const framework::StreamStatisticsPtr &statistics);
+
+  /** @brief Returns the number of output callbacks that ran out of buffered audio and played silence. */
+  unsigned long long get_underrun_count() const
+  {
+    return m_callback_params.underrun_count.load(std::memory_order_relaxed);
+  }
+
+  /** @brief Returns the number of callbacks the timer has run since the stream opened. */
+  unsigned long long get_callback_count() const { return m_callback_count.load(std::memory_order_relaxed); }
+
+  /** @brief Returns the number of periods the simulated device played without a rendered block. */
+  unsigned long long get_missed_periods() const { return m_missed_periods.load(std::memory_order_relaxed); }
+
+  /** @brief Returns the two periods the simulated device buffers, in frames. */
+  unsigned long long get_latency_frames() const { return m_latency_frames; }
+
+private:
+  void run(std::stop_token stop_token);
+  void fill_input(unsigned int n_frames) noexcept;
+
+  SyntheticDeviceConfig m_device;
+  AudioCallbackHandler::Params m_callback_params;
+  std::shared_ptr<dataplane::AudioGraph> p_audio_graph;
+  std::shared_ptr<dataplane::StreamMixer> p_stream_mixer;
+  framework::StreamStatisticsPtr p_statistics;
+  bool m_open{false};
+  unsigned int m_frames_per_buffer{0};
+  unsigned long long m_latency_frames{0};
+
+  // Timer thread only: the device buffers the callback reads and writes
+  std::vector<float> m_output;
+  std::vector<float> m_input;
+  double m_input_phase{0.0};
+
+  std::unique_ptr<std::jthread> p_thread;
+  std::atomic<unsigned long long> m_callback_count{0};
+  std::atomic<unsigned long long> m_missed_periods{0};
+};
+
+using SyntheticAudioAdapterPtr = std::shared_ptr<SyntheticAudioAdapter>;
+
+} // namespace miniaudioengine::adapters
+
+#endif // __SYNTHETIC_AUDIO_ADAPTER_H__
@@ -0,0 +1,62 @@
+#ifndef __WAV_PARSER_H__
+#define __WAV_PARSER_H__
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+
+namespace miniaudioengine::adapters
+{
+
+/** @struct WavHeader
+ *  @brief Layout of a RIFF/WAVE file, as found by WavParser.
+ */
+struct WavHeader
+{
+  /** @enum eSampleFormat
+   *  @brief Sample encoding of the data chunk. WAVE_FORMAT_EXTENSIBLE files are resolved to their sub-format.
+   */
+  enum class eSampleFormat
+  {
+    Pcm,
+    Float,
+    Other
+  };
+
+  eSampleFormat sample_format{eSampleFormat::Other};
+  unsigned int channels{0};
+  unsigned int sample_rate{0};
+  unsigned int bits_per_sample{0};
+  unsigned int block_align{0};
+  uint64_t data_offset{0}; // Byte offset of the first sample from the start of the file
+  uint64_t data_size{0};   // Size of the data chunk in bytes
+
+  /** @brief Returns the number of complete sample frames in the data chunk. */
+  uint64_t get_frames() const { return block_align > 0 ? data_size / block_align : 0; }
+
+  /** @brief Returns true for little-endian 32-bit IEEE float samples. */
+  bool is_float32() const { return sample_format == eSampleFormat::Float && bits_per_sample == 32; }
+
+  /** @brief Returns true for little-endian integer PCM samples of the given width. */
+  bool is_pcm(unsigned int bits) const { return sample_format == eSampleFormat::Pcm && bits_per_sample == bits; }
+
+  std::string to_string() const;
+};
+
+/** @class WavParser
+ *  @brief Minimal RIFF/WAVE chunk parser. Reads only the "fmt " and "data" chunk headers, never sample data.
+ */
+class WavParser
+{
+public:
+  /** @brief Parse the header of a WAV file.
+   *  @param path Path to the file.
+   *  @return The parsed header, or std::nullopt if the file is not a little-endian RIFF/WAVE file.
+   */
+  static std::optional<WavHeader> parse(const std::filesystem::path &path);
+};
+
+} // namespace miniaudioengine::adapters
+
+#endif // __WAV_PARSER_H__
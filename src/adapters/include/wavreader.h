@@ -0,0 +1,117 @@
+#ifndef __WAV_READER_H__
+#define __WAV_READER_H__
+
+#include "wavparser.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+namespace miniaudioengine::adapters
+{
+
+/** @class WavReader
+ *  @brief Native reader for little-endian 16, 24 and 32-bit PCM and 32-bit float WAV files.
+ *  The RIFF chunks are parsed once when the file opens. Samples are then read with large
+ *  positioned reads straight into the destination for float files, or into a scratch block that
+ *  the SIMD conversion kernels turn into float, bypassing libsndfile's generic conversion path.
+ *  Any other encoding is rejected by open(), so callers can fall back to libsndfile.
+ *  A read can also be split into prepare_read() and complete_read(), so a scheduler can issue the
+ *  file reads of many readers as one batch.
+ *  @note Not thread-safe. One reader per stream.
+ */
+class WavReader
+{
+public:
+  /** @brief Bytes read from the file per call when samples need converting. */
+  static constexpr size_t READ_CHUNK_BYTES = 256 * 1024;
+
+  /** @struct ReadRequest
+   *  @brief One positioned read of whole frames, from prepare_read() to complete_read().
+   */
+  struct ReadRequest
+  {
+    int fd{-1};                  // Descriptor to read from, -1 where the reader uses stdio
+    uint64_t offset{0};          // Absolute file offset
+    size_t bytes{0};
+    void *buffer{nullptr};       // Where the file's bytes go
+    float *destination{nullptr}; // Where complete_read() leaves the float samples
+  };
+
+  WavReader() = default;
+  ~WavReader();
+
+  WavReader(const WavReader &) = delete;
+  WavReader &operator=(const WavReader &) = delete;
+
+  /** @brief Returns true if the reader can decode samples with this header. */
+  static bool is_supported(const WavHeader &header);
+
+  /** @brief Open a WAV file.
+   *  @return False if the file cannot be opened or its encoding is not supported.
+   */
+  bool open(const std::filesystem::path &path);
+
+  void close();
+
+  bool is_open() const;
+
+  const WavHeader &get_header() const { return m_header; }
+
+  unsigned int get_channels() const { return m_header.channels; }
+
+  unsigned int get_sample_rate() const { return m_header.sample_rate; }
+
+  /** @brief Returns the number of frames in the file, trusting the file size over a data chunk size left unset. */
+  uint64_t get_frames() const { return m_frames; }
+
+  /** @brief Returns the frame the next read starts at. */
+  uint64_t get_position() const { return m_position; }
+
+  /** @brief Move the read position, clamped to the end of the file. */
+  void seek(uint64_t frame);
+
+  /** @brief Read and convert interleaved frames to float.
+   *  @param destination Room for frames * get_channels() samples.
+   *  @param frames Frames to read.
+   *  @return Frames read, fewer than requested only at the end of the file or on a read error.
+   */
+  size_t read_frames(float *destination, size_t frames);
+
+  /** @brief Prepare the next read from the read position, without touching the file.
+   *  At most one request per reader may be outstanding, since PCM bytes share one scratch block.
+   *  @param destination Room for frames * get_channels() samples.
+   *  @param frames Most frames to read. Fewer are requested at the end of the file, or to fit the scratch block.
+   *  @return False if the reader is closed or at the end of the file.
+   */
+  bool prepare_read(float *destination, size_t frames, ReadRequest &request);
+
+  /** @brief Issue a prepared read synchronously. Returns the number of bytes read. */
+  size_t submit_read(const ReadRequest &request);
+
+  /** @brief Convert the bytes of a finished read to float and advance the read position.
+   *  @param bytes_read Bytes the read returned, which may be fewer than requested.
+   *  @return Frames read.
+   */
+  size_t complete_read(const ReadRequest &request, size_t bytes_read);
+
+private:
+  /** @brief Read bytes from an absolute file offset. Returns the number of bytes read. */
+  size_t read_bytes(void *destination, size_t bytes, uint64_t offset);
+
+  WavHeader m_header;
+  uint64_t m_frames{0};
+  uint64_t m_position{0};
+  std::vector<uint8_t> m_raw;
+
+#ifdef PLATFORM_LINUX
+  int m_fd{-1};
+#else
+  std::FILE *p_file{nullptr};
+#endif
+};
+
+} // namespace miniaudioengine::adapters
+
+#endif // __WAV_READER_H__
@@ -1,54 +1,195 @@
 #include "audioadapter.h"
+#include "audiograph.h"
+#include "denormals.h"
+#include "filewriter.h"
+#include "realtime_assert.h"
+#include "realtimememory.h"
+#include "threading.h"
+#include "trace.h"
+#include "streammixer.h"
 
+#include <algorithm>
 #include <cstring>
+#include <span>
 
 using namespace miniaudioengine;
 using namespace miniaudioengine::adapters;
 
+namespace
+{
 
-unsigned int BUFFER_SIZE = 1024;
+RtAudioFormat to_rtaudio_format(framework::eSampleFormat format)
+{
+  switch (format)
+  {
+    case framework::eSampleFormat::Int16:
+      return RTAUDIO_SINT16;
+    case framework::eSampleFormat::Int24:
+      return RTAUDIO_SINT24;
+    case framework::eSampleFormat::Int32:
+      return RTAUDIO_SINT32;
+    case framework::eSampleFormat::Float32:
+    default:
+      return RTAUDIO_FLOAT32;
+  }
+}
+
+} // namespace
 
 
 int AudioCallbackHandler::audio_callback(void *output_buffer, void *input_buffer, unsigned int n_frames,
                                          double stream_time, AudioStreamStatus status, void *user_data) noexcept
 {
-  framework::set_thread_name("AudioCallbackHandler");
+  // Register the RtAudio thread and fault in its stack once rather than on every callback
+  if (!framework::threading::is_current_thread_registered())
+  {
+    framework::threading::register_current_thread("AudioCallbackHandler", framework::eThreadClass::Audio);
+    framework::realtime_memory::prefault_stack();
+  }
 
-  (void)input_buffer;
+  // Decaying tails must not fall into the CPU's denormal slow path. The driver's mode is restored on return
+  framework::ScopedFlushDenormals flush_denormals;
+
+  AudioCallbackHandler::Params *params = static_cast<AudioCallbackHandler::Params *>(user_data);
+
+  // The callback must finish within one period and never allocate or block
+  RT_ASSERT_NO_ALLOCATIONS();
+  RT_ASSERT_NO_LOCKS();
+  RT_ASSERT_BOUNDED_TIME(params != nullptr && params->sample_rate > 0
+                           ? static_cast<uint64_t>(n_frames) * 1000000 / params->sample_rate
+                           : 0);
+
+  (void)stream_time;
 
   // Verify user data is a valid pointer
-  if (user_data == nullptr)
+  if (params == nullptr)
   {
-    LOG_ERROR("AudioCallbackHandler: Audio callback does not have user data pointer");
+    LOG_RT_ERROR("AudioCallbackHandler: Audio callback does not have user data pointer");
     return 1;
   }
 
-  AudioCallbackHandler::Params *params = (AudioCallbackHandler::Params *)user_data;
-  if (params == nullptr)
+  TRACE_SCOPE_ID("AudioCallback", n_frames);
+  framework::StreamStatistics::BlockTimer block_timer(params->statistics, n_frames, params->sample_rate);
+  if (status != 0 && params->statistics != nullptr)
+  {
+    params->statistics->record_xrun();
+  }
+  if (status != 0)
+  {
+    TRACE_INSTANT("DeviceXrun");
+  }
+
+  if (params->format_kernels == nullptr)
+  {
+    return render_block(params, static_cast<float *>(output_buffer), static_cast<const float *>(input_buffer), n_frames);
+  }
+
+  // An integer device is rendered in float and converted at the edge
+  const bool is_input = params->direction == framework::eInputOutputDirection::Input;
+  const size_t output_samples = static_cast<size_t>(n_frames) * (is_input ? 0 : params->n_channels);
+  const size_t input_samples = static_cast<size_t>(n_frames) * (is_input ? params->n_channels : params->n_input_channels);
+  if (n_frames > params->scratch_frames)
+  {
+    LOG_RT_ERROR("AudioCallbackHandler: Device block exceeds the format conversion buffers");
+    if (output_buffer != nullptr)
+    {
+      std::memset(output_buffer, 0, output_samples * framework::get_bytes_per_sample(params->format_kernels->format));
+    }
+    return 0;
+  }
+
+  const float *input = nullptr;
+  if (input_buffer != nullptr && input_samples > 0)
+  {
+    params->format_kernels->to_float(params->input_scratch, input_buffer, input_samples);
+    input = params->input_scratch;
+  }
+  float *output = output_buffer != nullptr && output_samples > 0 ? params->output_scratch : nullptr;
+
+  const int result = render_block(params, output, input, n_frames);
+  if (output != nullptr)
+  {
+    params->format_kernels->from_float(output_buffer, output, output_samples);
+  }
+  return result;
+}
+
+/** @brief Render one float block for the callback: the shared mixer, the graph or the track's Buffer. */
+int AudioCallbackHandler::render_block(Params *params, float *output_buffer, const float *input_buffer, unsigned int n_frames) noexcept
+{
+  // A shared stream captures and renders for every attached track at once
+  if (params->mixer != nullptr)
+  {
+    params->mixer->process(input_buffer, output_buffer, n_frames);
+    return 0;
+  }
+
+  // A duplex stream queues its input first so the graph renders it in this same callback
+  if (params->direction == framework::eInputOutputDirection::Duplex && input_buffer != nullptr)
+  {
+    capture_input(params, std::span<const float>(input_buffer, static_cast<size_t>(n_frames) * params->n_input_channels));
+  }
+
+  // Render the compiled graph when one is attached
+  if (params->direction != framework::eInputOutputDirection::Input && params->graph != nullptr)
+  {
+    if (!params->graph->process(output_buffer, n_frames))
+    {
+      std::fill_n(output_buffer, static_cast<size_t>(n_frames) * params->n_channels, 0.0f);
+    }
+    return 0;
+  }
+
+  if (params->buffer == nullptr && params->recorder == nullptr)
   {
-    LOG_ERROR("AudioCallbackHandler: Audio callback user data does not reference a AudioCallbackHandler::Params object.");
+    LOG_RT_ERROR("AudioCallbackHandler: Audio callback user data does not reference a Buffer.");
     return 1;
   }
 
   switch (params->direction)
   {
     case framework::eInputOutputDirection::Input:
-      LOG_DEBUG("AudioCallbackHandler: Reading input...");
+    {
+      if (input_buffer == nullptr)
+      {
+        break;
+      }
+
+      capture_input(params, std::span<const float>(input_buffer, static_cast<size_t>(n_frames) * params->n_channels));
       break;
+    }
     case framework::eInputOutputDirection::Output:
     {
-      LOG_DEBUG("AudioCallbackHandler: Writing ", n_frames, " to output buffer. Status=", status, ". Stream Time=", stream_time);
-      std::vector<float> data(n_frames);
-      float val = 0;
-      for (size_t i = 0; i < n_frames; i++)
+      if (params->buffer == nullptr)
+      {
+        break;
+      }
+
+      float *output = output_buffer;
+      const size_t n_channels = params->n_channels;
+      const size_t n_samples = static_cast<size_t>(n_frames) * n_channels;
+
+      // Only consume whole frames so the channel interleaving never slips
+      const size_t available = params->buffer->size();
+      if (params->statistics != nullptr)
       {
-        // Poll until buffer has data
-        // TODO - Use a condition variable instead
-        // TODO - Look up producer / consumer pattern
-        while (!params->buffer->try_pop(val)) {}
+        params->statistics->record_ring_fill(available);
+      }
+      TRACE_COUNTER("OutputRingFill", 0, available);
+      const size_t samples_to_read = std::min(n_samples, available - (available % n_channels));
+
+      // Copy straight from the ring buffer's contiguous regions into the device buffer
+      const size_t samples_read = params->buffer->read(std::span<float>(output, samples_to_read));
+      if (samples_read < n_samples)
+      {
+        // Underrun - never wait on the producer, fill the rest of the block with silence
+        std::fill(output + samples_read, output + n_samples, 0.0f);
+        params->underrun_count.fetch_add(1, std::memory_order_relaxed);
+        if (params->statistics != nullptr)
+        {
+          params->statistics->record_underrun();
+        }
       }
-      // Copy to output_buffer
-      memcpy(output_buffer, data.data(), n_frames);
       break;
     }
     default:
@@ -58,6 +199,31 @@ int AudioCallbackHandler::audio_callback(void *output_buffer, void *input_buffer
   return 0;
 }
 
+/** @brief Queue a captured block for the recorder and the track's Buffer. */
+void AudioCallbackHandler::capture_input(Params *params, std::span<const float> input) noexcept
+{
+  const size_t n_channels = params->direction == framework::eInputOutputDirection::Duplex ? params->n_input_channels : params->n_channels;
+
+  // Hand the block to the disk writer's chunk queue. Never waits on the disk, drops are counted by the writer
+  if (params->recorder != nullptr)
+  {
+    params->recorder->write(input);
+  }
+
+  if (params->buffer == nullptr || n_channels == 0)
+  {
+    return;
+  }
+
+  // Only queue whole frames so the channel interleaving never slips. The rest of the block is dropped
+  const size_t available = params->buffer->available();
+  const size_t samples_to_write = std::min(input.size(), available - (available % n_channels));
+  if (params->buffer->write(input.first(samples_to_write)) < input.size() && params->statistics != nullptr)
+  {
+    params->statistics->record_overflow();
+  }
+}
+
 AudioAdapter::AudioAdapter()
 {
   // List available RtAudio APIs
@@ -130,11 +296,12 @@ std::vector<DevicePtr> AudioAdapter::get_devices()
   return devices;
 }
 
-bool AudioAdapter::open_stream(const DeviceInfo &info, const framework::BufferPtr &buffer, const framework::eInputOutputDirection &direction)
+bool AudioAdapter::open_stream(const DeviceInfo &info, const framework::BufferPtr &buffer, const framework::eInputOutputDirection &direction, const framework::StreamConfig &config)
 {
   unsigned int device_id = info.id;
-  unsigned int sample_rate = info.preferred_sample_rate;
+  unsigned int sample_rate = config.sample_rate > 0 ? config.sample_rate : info.preferred_sample_rate;
   unsigned int channels;
+  unsigned int input_channels = 0;
 
   switch (direction)
   {
@@ -144,36 +311,77 @@ bool AudioAdapter::open_stream(const DeviceInfo &info, const framework::BufferPt
     case framework::eInputOutputDirection::Output:
       channels = info.output_channels;
       break;
+    case framework::eInputOutputDirection::Duplex:
+      channels = info.output_channels;
+      input_channels = info.input_channels;
+      if (input_channels == 0)
+      {
+        LOG_ERROR("AudioAdapter: open_stream - Device has no input channels for a duplex stream.");
+        return false;
+      }
+      if (!p_audio_graph && !p_stream_mixer)
+      {
+        LOG_ERROR("AudioAdapter: open_stream - A duplex stream needs an AudioGraph to render its input.");
+        return false;
+      }
+      break;
     default:
-      LOG_ERROR("AudioAdapter: open_stream - Cannot open stream unless direction is Input or Output: ", direction);
+      LOG_ERROR("AudioAdapter: open_stream - Cannot open stream unless direction is Input, Output or Duplex: ", direction);
       return false;
   }
 
-  // Set audio output I/O parameters
+  if (channels == 0)
+  {
+    LOG_ERROR("AudioAdapter: open_stream - Device has no channels for direction: ", direction);
+    return false;
+  }
+
+  // Input streams capture from the device, output streams play to it and duplex streams do both
+  const bool is_input = direction == framework::eInputOutputDirection::Input;
+  const bool is_duplex = direction == framework::eInputOutputDirection::Duplex;
   adapters::AudioStreamParameters params = {
     device_id,
     channels,
     0
   };
+  adapters::AudioStreamParameters duplex_input_params = {
+    device_id,
+    input_channels,
+    0
+  };
+  adapters::AudioStreamParameters *output_params = is_input ? nullptr : &params;
+  adapters::AudioStreamParameters *input_params = is_input ? &params : (is_duplex ? &duplex_input_params : nullptr);
 
-  unsigned int buffer_size = BUFFER_SIZE;
+  unsigned int buffer_size = config.frames_per_buffer;
 
-  m_params = {
-    direction,
-    buffer
-  };
+  // Map the latency profile onto RtAudio stream options
+  RtAudio::StreamOptions options;
+  options.flags = 0;
+  options.numberOfBuffers = config.number_of_periods;
+  if (config.minimize_latency)
+    options.flags |= RTAUDIO_MINIMIZE_LATENCY;
+  if (config.schedule_realtime)
+    options.flags |= RTAUDIO_SCHEDULE_REALTIME;
+
+  m_callback_params.direction = direction;
+  m_callback_params.buffer = buffer;
+  m_callback_params.n_channels = channels;
+  m_callback_params.n_input_channels = input_channels;
+  m_callback_params.sample_rate = sample_rate;
+  m_callback_params.underrun_count.store(0, std::memory_order_relaxed);
 
 #if defined(RTAUDIO_VERSION_MAJOR) && RTAUDIO_VERSION_MAJOR >= 6
-  LOG_DEBUG("AudioAdapter: open_stream - Opening RtAudio audio stream with Device ID=", device_id, ", Channels=", channels, ", Sample Rate=", sample_rate, ", Buffer Size=", BUFFER_SIZE);
+  LOG_DEBUG("AudioAdapter: open_stream - Opening RtAudio audio stream with Device ID=", device_id, ", Channels=", channels, ", Sample Rate=", sample_rate, ", Buffer Size=", buffer_size, ", ", config.to_string());
 
   RtAudioErrorType rc;
-  rc = p_rtaudio->openStream(&params,
-                             nullptr,
-                             RTAUDIO_FLOAT32,
+  rc = p_rtaudio->openStream(output_params,
+                             input_params,
+                             to_rtaudio_format(config.device_format),
                              sample_rate,
                              &buffer_size,
                              &AudioCallbackHandler::audio_callback,
-                             &m_params);
+                             &m_callback_params,
+                             &options);
 
   if (rc != RTAUDIO_NO_ERROR)
   {
@@ -181,6 +389,7 @@ bool AudioAdapter::open_stream(const DeviceInfo &info, const framework::BufferPt
     return false;
   }
 
+  prepare_device_format(config.device_format, is_input ? 0 : channels, is_input ? channels : input_channels, buffer_size);
   rc = p_rtaudio->startStream();
   if (rc != RTAUDIO_NO_ERROR)
   {
@@ -190,13 +399,15 @@ bool AudioAdapter::open_stream(const DeviceInfo &info, const framework::BufferPt
 #else
   try
   {
-    p_rtaudio->openStream(&params,
-                          nullptr,
-                          RTAUDIO_FLOAT32,
+    p_rtaudio->openStream(output_params,
+                          input_params,
+                          to_rtaudio_format(config.device_format),
                           sample_rate,
                           &buffer_size,
                           &AudioCallbackHandler::audio_callback,
-                          &m_params);
+                          &m_callback_params,
+                          &options);
+    prepare_device_format(config.device_format, is_input ? 0 : channels, is_input ? channels : input_channels, buffer_size);
     p_rtaudio->startStream();
   }
   catch (const RtAudioError &e)
@@ -205,10 +416,75 @@ bool AudioAdapter::open_stream(const DeviceInfo &info, const framework::BufferPt
     return false;
   }
 #endif
-  LOG_DEBUG("AudioAdapter: open_stream - Opened audio stream");
+  if (buffer_size != config.frames_per_buffer)
+  {
+    LOG_WARNING("AudioAdapter: open_stream - Device adjusted buffer size from ", config.frames_per_buffer, " to ", buffer_size, " frames");
+  }
+
+  m_latency_frames = query_latency_frames(direction, buffer_size);
+  if (p_statistics)
+  {
+    p_statistics->record_latency(m_latency_frames, sample_rate);
+  }
+
+  LOG_INFO("AudioAdapter: open_stream - Opened ", (is_duplex ? "duplex" : "audio"), " stream. Latency=", m_latency_frames,
+           " frames (", sample_rate > 0 ? 1000.0 * static_cast<double>(m_latency_frames) / sample_rate : 0.0, " ms)");
   return true;
 }
 
+/** @brief Allocate the float blocks an integer device is rendered into, before the stream starts.
+ *  Float32 devices are rendered straight into the device buffers and need none.
+ */
+void AudioAdapter::prepare_device_format(framework::eSampleFormat format, unsigned int output_channels,
+                                          unsigned int input_channels, unsigned int buffer_size)
+{
+  if (format == framework::eSampleFormat::Float32)
+  {
+    m_callback_params.format_kernels = nullptr;
+    m_output_scratch.clear();
+    m_input_scratch.clear();
+    m_callback_params.output_scratch = nullptr;
+    m_callback_params.input_scratch = nullptr;
+    m_callback_params.scratch_frames = 0;
+    return;
+  }
+
+  m_output_scratch.assign(static_cast<size_t>(buffer_size) * output_channels, 0.0f);
+  m_input_scratch.assign(static_cast<size_t>(buffer_size) * input_channels, 0.0f);
+  m_callback_params.format_kernels = &framework::dsp::get_format_kernels(format);
+  m_callback_params.output_scratch = m_output_scratch.data();
+  m_callback_params.input_scratch = m_input_scratch.data();
+  m_callback_params.scratch_frames = buffer_size;
+  LOG_INFO("AudioAdapter: open_stream - Converting the device's ", framework::to_string(format), " samples at the stream edge");
+}
+
+/** @brief Returns the buffering the backend reports for the open stream.
+ *  Some backends report 0, so fall back to the least a stream can buffer: one period per direction.
+ */
+unsigned long long AudioAdapter::query_latency_frames(const framework::eInputOutputDirection &direction, unsigned int buffer_size)
+{
+  long latency = 0;
+#if defined(RTAUDIO_VERSION_MAJOR) && RTAUDIO_VERSION_MAJOR >= 6
+  latency = p_rtaudio->getStreamLatency();
+#else
+  try
+  {
+    latency = p_rtaudio->getStreamLatency();
+  }
+  catch (const RtAudioError &e)
+  {
+    LOG_WARNING("AudioAdapter: Failed to query RtAudio stream latency: ", e.getMessage());
+  }
+#endif
+  if (latency > 0)
+  {
+    return static_cast<unsigned long long>(latency);
+  }
+
+  const unsigned long long directions = direction == framework::eInputOutputDirection::Duplex ? 2 : 1;
+  return directions * buffer_size;
+}
+
 bool AudioAdapter::close_stream()
 {
 #if defined(RTAUDIO_VERSION_MAJOR) && RTAUDIO_VERSION_MAJOR >= 6
@@ -251,6 +527,58 @@ bool AudioAdapter::stop_stream()
   return true;
 }
 
+bool AudioAdapter::set_audio_graph(const std::shared_ptr<dataplane::AudioGraph> &graph)
+{
+  if (p_rtaudio->isStreamOpen())
+  {
+    LOG_ERROR("AudioAdapter: set_audio_graph - Cannot change the AudioGraph while the stream is open.");
+    return false;
+  }
+
+  p_audio_graph = graph;
+  m_callback_params.graph = graph.get();
+  return true;
+}
+
+bool AudioAdapter::set_stream_mixer(const std::shared_ptr<dataplane::StreamMixer> &mixer)
+{
+  if (p_rtaudio->isStreamOpen())
+  {
+    LOG_ERROR("AudioAdapter: set_stream_mixer - Cannot change the StreamMixer while the stream is open.");
+    return false;
+  }
+
+  p_stream_mixer = mixer;
+  m_callback_params.mixer = mixer.get();
+  return true;
+}
+
+bool AudioAdapter::set_statistics(const framework::StreamStatisticsPtr &statistics)
+{
+  if (p_rtaudio->isStreamOpen())
+  {
+    LOG_ERROR("AudioAdapter: set_statistics - Cannot change the StreamStatistics while the stream is open.");
+    return false;
+  }
+
+  p_statistics = statistics;
+  m_callback_params.statistics = statistics.get();
+  return true;
+}
+
+bool AudioAdapter::set_recorder(const FileWriterPtr &recorder)
+{
+  if (p_rtaudio->isStreamOpen())
+  {
+    LOG_ERROR("AudioAdapter: set_recorder - Cannot change the recorder while the stream is open.");
+    return false;
+  }
+
+  p_recorder = recorder;
+  m_callback_params.recorder = recorder.get();
+  return true;
+}
+
 bool AudioAdapter::is_stream_open()
 {
   return p_rtaudio->isStreamOpen();
@@ -0,0 +1,46 @@
+#include "decodepool.h"
+#include "filestream.h"
+#include "logger.h"
+#include "threading.h"
+
+#include <algorithm>
+
+using namespace miniaudioengine::adapters;
+
+DecodePool::DecodePool(unsigned int worker_count)
+{
+  if (worker_count == 0)
+  {
+    worker_count = std::clamp(std::thread::hardware_concurrency() / 2, 1u, MAX_WORKERS);
+  }
+
+  m_workers.reserve(worker_count);
+  for (unsigned int i = 0; i < worker_count; ++i)
+  {
+    m_workers.emplace_back([this, i](std::stop_token stop_token) {
+      framework::threading::register_current_thread("DecodePool" + std::to_string(i), framework::eThreadClass::Io, i);
+      run(stop_token);
+    });
+  }
+
+  LOG_DEBUG("DecodePool: Started ", worker_count, " decode workers");
+}
+
+DecodePool::~DecodePool()
+{
+  for (std::jthread &worker : m_workers)
+  {
+    worker.request_stop();
+  }
+  m_workers.clear();
+}
+
+void DecodePool::run(std::stop_token stop_token)
+{
+  std::vector<FileStream *> streams;
+  while (m_queue.acquire(stop_token, 1, streams))
+  {
+    FileStream *stream = streams.front();
+    m_queue.release(stream, stream->service(DECODE_BUDGET_FRAMES));
+  }
+}
@@ -1,215 +1,315 @@
 #include "fileadapter.h"
+#include "wavparser.h"
+#include "wavreader.h"
 #include "logger.h"
+#include "realtimememory.h"
 
-#include <chrono>
+#include <algorithm>
+
+#ifdef PLATFORM_LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 using namespace miniaudioengine::adapters;
 
-bool FileAudioStreamThread::start(const Params &params)
+FileAdapter::FileAdapter() = default;
+
+FileAdapter::~FileAdapter()
 {
-  if (is_running())
+  if (p_stream)
   {
-    LOG_WARNING("FileAudioStreamThread: start - Audio stream thread is already running!");
-    return false;
+    p_stream->close();
   }
+}
 
-  if (params.snd_file == nullptr)
+bool FileAdapter::open_stream(const std::filesystem::path &filename, const framework::BufferPtr &buffer, const framework::eInputOutputDirection &direction,
+                              const framework::StreamConfig &config)
+{
+  (void)buffer;
+  (void)config;
+  return open_stream(filename, direction, 0);
+}
+
+bool FileAdapter::open_stream(const std::filesystem::path &filename, const framework::eInputOutputDirection &direction, uint64_t start_frame)
+{
+  LOG_DEBUG("FileAdapter: open_stream - Opening audio stream");
+
+  if (is_stream_open())
   {
-    LOG_WARNING("FileAudioStreamThread: start - SndFile is null.");
-    return false;
+    LOG_WARNING("FileAdapter: open_stream - Audio stream is already open!");
+    close_stream();
   }
 
-  // Define input or output buffer
-  void *input_buffer = nullptr;
-  void *output_buffer = nullptr;
-
-  switch (params.direction)
+  // Files are only streamed as inputs. Recordings are written through a FileWriter
+  if (direction != framework::eInputOutputDirection::Input)
   {
-    case framework::eInputOutputDirection::Input:
-      input_buffer = params.snd_file;
-      output_buffer = params.buffer.get();
-      break;
-    case framework::eInputOutputDirection::Output:
-      input_buffer = params.buffer.get();
-      output_buffer = params.snd_file;
-      break;
+    LOG_ERROR("FileAdapter: open_stream - File outputs are recorded through a FileWriter, not streamed: ", filename);
+    return false;
   }
 
-  // Create new thread
-  p_audio_stream_thread = std::make_unique<std::jthread>(
-    FileAudioStreamThread::callback,
-    input_buffer,
-    output_buffer,
-    params
-  );
+  auto stream = std::make_shared<FileStream>();
+  if (!stream->open(filename, start_frame))
+  {
+    LOG_WARNING("FileAdapter: open_stream - Failed to open file stream: ", filename);
+    return false;
+  }
 
-  LOG_DEBUG("FileAudioStreamThread: start - Started audio stream thread");
+  p_stream = std::move(stream);
   return true;
 }
 
-bool FileAudioStreamThread::stop()
+bool FileAdapter::close_stream()
 {
-  if (!is_running())
+  if (!is_stream_open())
   {
-    LOG_WARNING("FileAudioStreamThread: stop - Audio stream not running");
+    LOG_ERROR("FileAdapter: close_stream - Audio stream not open");
     return false;
   }
 
-  LOG_DEBUG("FileAudioStreamThread: stop - Stopped audio stream thread");
-  p_audio_stream_thread->request_stop();
-  p_audio_stream_thread->join();
+  // The audio graph may still hold the stream, so only its thread and file are released here
+  p_stream->close();
+  p_stream.reset();
   return true;
 }
 
-void FileAudioStreamThread::callback(std::stop_token stop_token, void *input_buffer, void *output_buffer, const Params &params)
+bool FileAdapter::is_stream_open()
 {
-  framework::set_thread_name("FileAudioStreamThread");
-
-  const size_t total_frames_to_read = params.n_frames_to_read * params.snd_file_info.channels;
-  const float cycle_time_s = 1.0 / (params.snd_file_info.samplerate / total_frames_to_read);
-  const unsigned int cycle_time_ms = (unsigned int)(cycle_time_s * 1000 * 0.9); // Read 10% faster than the expected bitrate
-
-  LOG_DEBUG("FileAudioStreamThread: callback - Sample Rate = ", params.snd_file_info.samplerate, " Cycle Time = ", cycle_time_ms, " ms");
+  return p_stream && p_stream->is_open();
+}
 
-  while (true)
+long long FileAdapter::read_frames(SndFile *file, std::vector<float> &buffer, long long frames_to_read)
+{
+  if (file == nullptr)
   {
-    if (stop_token.stop_requested())
-    {
-      LOG_DEBUG("FileAudioStreamThread: callback - Stop requested. Exiting...");
-      break;
-    }
-
-    switch (params.direction)
-    {
-      case framework::eInputOutputDirection::Input:
-      {
-        SndFile *file = static_cast<SndFile *>(input_buffer);
-        framework::Buffer *buffer = static_cast<framework::Buffer *>(output_buffer);
-        read_from_file(file, buffer, params.n_frames_to_read);
-        break;
-      }
-      case framework::eInputOutputDirection::Output:
-      {
-        framework::Buffer *buffer = static_cast<framework::Buffer *>(input_buffer);
-        SndFile *file = static_cast<SndFile *>(output_buffer);
-        write_to_file(buffer, file, params.n_frames_to_read);
-        break;
-      }
-    }
-
-    std::this_thread::sleep_for(std::chrono::milliseconds(cycle_time_ms));
+    LOG_WARNING("FileAdapter: read_frames - Cannot read from null SndFile.");
+    return 0LL;
   }
+  return sf_readf_float(file,
+                        buffer.data(),
+                        static_cast<sf_count_t>(frames_to_read));
 }
 
-void FileAudioStreamThread::read_from_file(SndFile *file, framework::Buffer *buffer, const size_t frames_to_read)
+void FileAdapter::seek(SndFile *file, long long frame_offset)
 {
-  LOG_DEBUG("FileAudioStreamThread: read_from_file: ", frames_to_read, " bytes");
-  // TODO - Read from File to Buffer
-  std::vector<float> buffer_data(frames_to_read);
-  FileAdapter::read_frames(file, buffer_data, frames_to_read);
-
-  // TODO - Transfer to Buffer
-  for (const float val : buffer_data)
+  if (file == nullptr)
   {
-    buffer->try_push(val);
+    LOG_WARNING("FileAdapter: seek - Cannot read from null SndFile.");
+    return;
   }
+  sf_seek(file, static_cast<sf_count_t>(frame_offset), SEEK_SET);
 }
 
-void FileAudioStreamThread::write_to_file(framework::Buffer *buffer, SndFile *file, const size_t frames_to_read)
+std::optional<AudioFormatInfo> FileAdapter::probe(const std::filesystem::path &path)
 {
-  (void)file;
-  LOG_DEBUG("FileAudioStreamThread: write_to_file: ", frames_to_read, " bytes");
-  // TODO - Write from Buffer to File
-}
+  // The RIFF chunk headers are enough for the common encodings, no libsndfile handle needed
+  const std::optional<WavHeader> header = WavParser::parse(path);
+  if (header && header->channels > 0 && header->sample_rate > 0 &&
+      (header->sample_format == WavHeader::eSampleFormat::Pcm || header->sample_format == WavHeader::eSampleFormat::Float))
+  {
+    AudioFormatInfo info;
+    info.frames = header->get_frames();
+    info.sample_rate = header->sample_rate;
+    info.channels = header->channels;
+    info.bits_per_sample = header->bits_per_sample;
+    info.format = "WAV";
+    return info;
+  }
 
-SndFile* FileAdapter::open(const char *filename)
-{
-  m_info = {};
-  return sf_open(filename, SFM_READ, &m_info);
+  SndFileInfo sf_info = {};
+  SndFile *file = sf_open(path.string().c_str(), SFM_READ, &sf_info);
+  if (file == nullptr)
+  {
+    return std::nullopt;
+  }
+  sf_close(file);
+
+  AudioFormatInfo info;
+  info.frames = sf_info.frames > 0 ? static_cast<uint64_t>(sf_info.frames) : 0;
+  info.sample_rate = static_cast<unsigned int>(sf_info.samplerate);
+  info.channels = static_cast<unsigned int>(sf_info.channels);
+
+  switch (sf_info.format & SF_FORMAT_SUBMASK)
+  {
+    case SF_FORMAT_PCM_16: info.bits_per_sample = 16; break;
+    case SF_FORMAT_PCM_24: info.bits_per_sample = 24; break;
+    case SF_FORMAT_PCM_32: info.bits_per_sample = 32; break;
+    case SF_FORMAT_FLOAT:  info.bits_per_sample = 32; break;
+    case SF_FORMAT_DOUBLE: info.bits_per_sample = 64; break;
+    default:               info.bits_per_sample = 0; break;
+  }
+
+  switch (sf_info.format & SF_FORMAT_TYPEMASK)
+  {
+    case SF_FORMAT_WAV:  info.format = "WAV"; break;
+    case SF_FORMAT_AIFF: info.format = "AIFF"; break;
+    case SF_FORMAT_FLAC: info.format = "FLAC"; break;
+    case SF_FORMAT_OGG:  info.format = "OGG"; break;
+    case SF_FORMAT_MPEG: info.format = "MP3"; break;
+    default:             info.format = "Unknown"; break;
+  }
+
+  return info;
 }
 
-void FileAdapter::close(SndFile *file)
+miniaudioengine::framework::SampleBufferPtr FileAdapter::decode_file(const std::filesystem::path &path)
 {
+  WavReader reader;
+  if (reader.open(path))
+  {
+    if (reader.get_frames() == 0)
+    {
+      LOG_WARNING("FileAdapter: decode_file - File has no audio frames: ", path.string());
+      return nullptr;
+    }
+
+    auto sample_buffer = framework::SampleBuffer::allocate(static_cast<size_t>(reader.get_frames()),
+                                                           reader.get_channels(), reader.get_sample_rate());
+    const size_t frames_read = reader.read_frames(sample_buffer->get_writable_data(), static_cast<size_t>(reader.get_frames()));
+    if (frames_read != reader.get_frames())
+    {
+      LOG_WARNING("FileAdapter: decode_file - Read ", frames_read, " of ", reader.get_frames(), " frames from ", path.string());
+    }
+    return sample_buffer;
+  }
+
+  SndFileInfo info = {};
+  SndFile *file = sf_open(path.string().c_str(), SFM_READ, &info);
   if (file == nullptr)
   {
-    LOG_WARNING("FileAdapter: close - Cannot close null SndFile");
-    return;
+    LOG_WARNING("FileAdapter: decode_file - Failed to open SndFile: ", path.string());
+    return nullptr;
   }
+
+  if (info.channels <= 0 || info.frames <= 0)
+  {
+    LOG_WARNING("FileAdapter: decode_file - File has no audio frames: ", path.string());
+    sf_close(file);
+    return nullptr;
+  }
+
+  auto sample_buffer = framework::SampleBuffer::allocate(static_cast<size_t>(info.frames),
+                                                         static_cast<unsigned int>(info.channels),
+                                                         static_cast<unsigned int>(info.samplerate));
+
+  // Decode the whole file in one call straight into the aligned buffer
+  const sf_count_t frames_read = sf_readf_float(file, sample_buffer->get_writable_data(), info.frames);
   sf_close(file);
+
+  if (frames_read != info.frames)
+  {
+    LOG_WARNING("FileAdapter: decode_file - Read ", frames_read, " of ", info.frames, " frames from ", path.string());
+  }
+
+  return sample_buffer;
 }
 
-bool FileAdapter::open_stream(const std::filesystem::path &filename, const framework::BufferPtr &buffer, const framework::eInputOutputDirection &direction)
+miniaudioengine::framework::SampleBufferPtr FileAdapter::decode_region(const std::filesystem::path &path, uint64_t start_frame, size_t frames)
 {
-  LOG_DEBUG("FileAdapter: open_stream - Opening audio stream");
+  if (frames == 0)
+  {
+    return nullptr;
+  }
 
-  if (m_audio_stream_thread.is_running())
+  WavReader reader;
+  if (reader.open(path))
   {
-    LOG_WARNING("FileAdapter: open_stream - Audio stream thread is already running!");
-    if (!m_audio_stream_thread.stop())
+    if (start_frame >= reader.get_frames())
+    {
+      return nullptr;
+    }
+
+    frames = static_cast<size_t>(std::min<uint64_t>(frames, reader.get_frames() - start_frame));
+    auto sample_buffer = framework::SampleBuffer::allocate(frames, reader.get_channels(), reader.get_sample_rate());
+    reader.seek(start_frame);
+    const size_t frames_read = reader.read_frames(sample_buffer->get_writable_data(), frames);
+    if (frames_read != frames)
     {
-      LOG_ERROR("FileAdapter: open_stream - Failed to stop audio stream thread");
-      throw std::runtime_error("FileAdapter: open_stream - Failed to stop audio stream thread");
+      LOG_WARNING("FileAdapter: decode_region - Read ", frames_read, " of ", frames, " frames from ", path.string());
     }
+    return sample_buffer;
   }
 
-  SndFile *file = open(filename.string().c_str());
+  SndFileInfo info = {};
+  SndFile *file = sf_open(path.string().c_str(), SFM_READ, &info);
   if (file == nullptr)
   {
-    LOG_WARNING("FileAdapter: open_stream - Failed to open SndFile: ", filename);
-    return false;
+    LOG_WARNING("FileAdapter: decode_region - Failed to open SndFile: ", path.string());
+    return nullptr;
   }
 
-  FileAudioStreamThread::Params params =
+  if (info.channels <= 0 || info.frames <= 0 || start_frame >= static_cast<uint64_t>(info.frames) ||
+      sf_seek(file, static_cast<sf_count_t>(start_frame), SEEK_SET) < 0)
   {
-    direction,
-    buffer,
-    file,
-    m_info,
-    1024
-  };
+    sf_close(file);
+    return nullptr;
+  }
 
-  if (!m_audio_stream_thread.start(params))
+  frames = static_cast<size_t>(std::min<uint64_t>(frames, static_cast<uint64_t>(info.frames) - start_frame));
+  auto sample_buffer = framework::SampleBuffer::allocate(frames, static_cast<unsigned int>(info.channels),
+                                                         static_cast<unsigned int>(info.samplerate));
+  const sf_count_t frames_read = sf_readf_float(file, sample_buffer->get_writable_data(), static_cast<sf_count_t>(frames));
+  sf_close(file);
+
+  if (frames_read != static_cast<sf_count_t>(frames))
   {
-    LOG_ERROR("FileAdapter: open_stream - Failed to start audio stream thread");
-    return false;
+    LOG_WARNING("FileAdapter: decode_region - Read ", frames_read, " of ", frames, " frames from ", path.string());
   }
 
-  return m_audio_stream_thread.is_running();
+  return sample_buffer;
 }
 
-bool FileAdapter::close_stream()
+miniaudioengine::framework::SampleBufferPtr FileAdapter::map_file(const std::filesystem::path &path)
 {
-  if (!m_audio_stream_thread.stop())
+#ifdef PLATFORM_LINUX
+  const std::optional<WavHeader> header = WavParser::parse(path);
+  if (!header || !header->is_float32() || header->channels == 0 || header->data_offset % sizeof(float) != 0)
   {
-    LOG_ERROR("FileAdapter: open_stream - Failed to stop audio stream thread");
-    return false;
+    return nullptr;
   }
-  return true;
-}
 
-bool FileAdapter::is_stream_open()
-{
-  return m_audio_stream_thread.is_running();
-}
+  const int fd = ::open(path.string().c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    LOG_WARNING("FileAdapter: map_file - Failed to open ", path.string());
+    return nullptr;
+  }
 
-long long FileAdapter::read_frames(SndFile *file, std::vector<float> &buffer, long long frames_to_read)
-{
-  if (file == nullptr)
+  struct stat file_stat = {};
+  if (::fstat(fd, &file_stat) != 0 || static_cast<uint64_t>(file_stat.st_size) <= header->data_offset)
   {
-    LOG_WARNING("FileAdapter: read_frames - Cannot read from null SndFile.");
-    return 0LL;
+    ::close(fd);
+    return nullptr;
   }
-  return sf_readf_float(file,
-                        buffer.data(),
-                        static_cast<sf_count_t>(frames_to_read));
-}
 
-void FileAdapter::seek(SndFile *file, long long frame_offset)
-{
-  if (file == nullptr)
+  const size_t file_size = static_cast<size_t>(file_stat.st_size);
+  void *mapping = ::mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED)
   {
-    LOG_WARNING("FileAdapter: seek - Cannot read from null SndFile.");
-    return;
+    LOG_WARNING("FileAdapter: map_file - mmap failed for ", path.string());
+    return nullptr;
   }
-  sf_seek(file, static_cast<sf_count_t>(frame_offset), SEEK_SET);
+  ::madvise(mapping, file_size, MADV_WILLNEED);
+
+  // In realtime memory mode the samples are read in and pinned now, not on the first voice that plays them
+  if (framework::realtime_memory::is_enabled() && !framework::realtime_memory::lock(mapping, file_size))
+  {
+    LOG_WARNING("FileAdapter: map_file - Failed to lock ", file_size, " bytes of ", path.string(),
+                ". Raise RLIMIT_MEMLOCK to lock mapped samples.");
+  }
+
+  // Trust the file size over the data chunk size, which streaming writers may leave unset
+  const uint64_t data_size = std::min<uint64_t>(header->data_size, file_size - header->data_offset);
+  const size_t frames = static_cast<size_t>(data_size / header->block_align);
+
+  auto storage = std::shared_ptr<void>(mapping, [file_size](void *p) { ::munmap(p, file_size); });
+  const float *samples = reinterpret_cast<const float *>(static_cast<const char *>(mapping) + header->data_offset);
+  return framework::SampleBuffer::wrap(samples, frames, header->channels, header->sample_rate, std::move(storage));
+#else
+  (void)path;
+  return nullptr;
+#endif
 }
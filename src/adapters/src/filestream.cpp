@@ -0,0 +1,537 @@
+#include "filestream.h"
+#include "wavreader.h"
+#include "decodepool.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace miniaudioengine::adapters;
+
+namespace
+{
+
+/** @brief Largest read issued to the disk at once, in frames. */
+constexpr size_t READ_CHUNK_FRAMES = 8192;
+
+/** @brief Per-read decay of the slowest read latency, so one slow read does not keep the read-ahead deep for ever. */
+constexpr double READ_LATENCY_DECAY = 0.98;
+
+} // namespace
+
+FileStream::FileStream() = default;
+
+FileStream::~FileStream()
+{
+  close();
+}
+
+bool FileStream::open(const std::filesystem::path &path, uint64_t start_frame)
+{
+  if (is_open())
+  {
+    LOG_WARNING("FileStream: open - Stream is already open");
+    return false;
+  }
+
+  // Common PCM and float WAV files are read natively, anything else through libsndfile
+  p_wav_reader = std::make_unique<WavReader>();
+  if (p_wav_reader->open(path))
+  {
+    m_channels = p_wav_reader->get_channels();
+    m_sample_rate = p_wav_reader->get_sample_rate();
+    m_frames = p_wav_reader->get_frames();
+  }
+  else
+  {
+    p_wav_reader.reset();
+    SF_INFO info = {};
+    p_snd_file = sf_open(path.string().c_str(), SFM_READ, &info);
+    if (p_snd_file == nullptr || info.channels <= 0 || info.samplerate <= 0)
+    {
+      LOG_ERROR("FileStream: open - Cannot open ", path.string());
+      close();
+      return false;
+    }
+    m_channels = static_cast<unsigned int>(info.channels);
+    m_sample_rate = static_cast<unsigned int>(info.samplerate);
+    m_frames = info.frames > 0 ? static_cast<uint64_t>(info.frames) : 0;
+  }
+
+  // The ring is sized for the deepest read-ahead; the producer only keeps the current depth in it.
+  // Pooled streams keep more, since they also wait for a free decode worker
+  const size_t capacity_frames = static_cast<size_t>(std::ceil(MAX_READ_AHEAD_SECONDS * m_sample_rate));
+  const double min_read_ahead_seconds = p_wav_reader ? MIN_READ_AHEAD_SECONDS : MIN_DECODE_AHEAD_SECONDS;
+  m_min_read_ahead_frames = static_cast<size_t>(std::ceil(min_read_ahead_seconds * m_sample_rate));
+  p_ring = std::make_shared<framework::Buffer>(capacity_frames * m_channels);
+  m_read_ahead_frames.store(std::min(capacity_frames, m_min_read_ahead_frames * 4), std::memory_order_relaxed);
+  m_read_latency_ms.store(0.0, std::memory_order_relaxed);
+  m_slowest_read = 0.0;
+
+  start_frame = std::min(start_frame, m_frames);
+  SegmentMarker stale;
+  while (m_markers.try_pop(stale))
+  {
+  }
+  m_seek_frame.store(start_frame, std::memory_order_relaxed);
+  m_seek_sequence.store(0, std::memory_order_relaxed);
+  m_paused_sequence.store(0, std::memory_order_relaxed);
+  m_flushed_sequence.store(0, std::memory_order_relaxed);
+  m_position.store(start_frame, std::memory_order_relaxed);
+  m_consumer_sequence = 0;
+  m_producer_sequence = 0;
+  m_flushed = true;
+  m_consumed = 0;
+  m_written = 0;
+  m_segment = SegmentMarker{0, start_frame};
+  m_has_next_segment = false;
+  m_cue_offset = 0;
+  m_cue_end = 0;
+  publish_cue_frames();
+
+  m_file_frame = start_frame;
+  m_end_of_file = false;
+  m_waiting_for_flush = false;
+  m_marker_pending = false;
+  m_scratch.assign(READ_CHUNK_FRAMES * m_channels, 0.0f);
+
+  seek_file(start_frame);
+  m_open = true;
+
+  // No stream has a thread of its own. Native reads are batched by the I/O scheduler, and decoding
+  // is CPU bound, so compressed files share the decode pool's workers
+  if (p_wav_reader)
+  {
+    IoScheduler::instance().add(this);
+  }
+  else
+  {
+    DecodePool::instance().add(this);
+  }
+
+  LOG_INFO("FileStream: Streaming ", path.string(), " from frame ", start_frame,
+           p_wav_reader ? " with the native WAV reader on the I/O scheduler" : " through libsndfile on the decode pool");
+  return true;
+}
+
+void FileStream::close()
+{
+  // Returns once no scheduler thread is filling this stream
+  if (m_open && p_wav_reader)
+  {
+    IoScheduler::instance().remove(this);
+  }
+  else if (m_open)
+  {
+    DecodePool::instance().remove(this);
+  }
+  m_open = false;
+
+  p_wav_reader.reset();
+  if (p_snd_file != nullptr)
+  {
+    sf_close(p_snd_file);
+    p_snd_file = nullptr;
+  }
+}
+
+void FileStream::seek(uint64_t frame) noexcept
+{
+  m_seek_frame.store(std::min(frame, m_frames), std::memory_order_release);
+  m_seek_sequence.fetch_add(1, std::memory_order_acq_rel);
+  if (m_open && p_wav_reader)
+  {
+    IoScheduler::instance().wake();
+  }
+  else if (m_open)
+  {
+    DecodePool::instance().wake();
+  }
+}
+
+bool FileStream::set_loop_region(uint64_t start_frame, uint64_t end_frame) noexcept
+{
+  if (end_frame == NO_LOOP)
+  {
+    m_loop_end.store(NO_LOOP, std::memory_order_release);
+    return true;
+  }
+
+  end_frame = std::min(end_frame, m_frames);
+  if (start_frame >= end_frame || end_frame - start_frame < MIN_LOOP_FRAMES)
+  {
+    LOG_ERROR("FileStream: set_loop_region - Region [", start_frame, ", ", end_frame, ") is shorter than ", MIN_LOOP_FRAMES, " frames");
+    return false;
+  }
+
+  // The start is stored first, so a producer that sees the new end also sees the new start
+  m_loop_start.store(start_frame, std::memory_order_release);
+  m_loop_end.store(end_frame, std::memory_order_release);
+  return true;
+}
+
+void FileStream::set_cue_points(const CuePointList &cues)
+{
+  auto table = std::make_unique<CueTable>();
+  for (const CuePoint &cue : cues)
+  {
+    if (cue.samples && cue.samples->get_channels() == m_channels && cue.samples->get_frames() > 0)
+    {
+      table->cues.push_back(cue);
+    }
+  }
+  std::sort(table->cues.begin(), table->cues.end(), [](const CuePoint &a, const CuePoint &b) { return a.frame < b.frame; });
+  m_cues.publish(std::move(table));
+}
+
+size_t FileStream::get_available_frames() const noexcept
+{
+  const size_t ring_frames = m_flushed && p_ring && m_channels > 0 ? p_ring->size() / m_channels : 0;
+  return (m_cue_end - m_cue_offset) + ring_frames;
+}
+
+size_t FileStream::get_buffered_frames() const noexcept
+{
+  // The ring only holds audio of the latest seek once the audio thread has flushed it for that seek
+  const uint64_t sequence = m_seek_sequence.load(std::memory_order_acquire);
+  const size_t cue_frames = m_cue_sequence.load(std::memory_order_acquire) == sequence ? m_cue_frames.load(std::memory_order_relaxed) : 0;
+  const bool flushed = m_flushed_sequence.load(std::memory_order_acquire) == sequence;
+  const size_t ring_frames = flushed && p_ring && m_channels > 0 ? p_ring->size() / m_channels : 0;
+  return cue_frames + ring_frames;
+}
+
+size_t FileStream::read_frames(float *destination, size_t frames) noexcept
+{
+  if (!p_ring || m_channels == 0)
+  {
+    return 0;
+  }
+
+  const uint64_t sequence = m_seek_sequence.load(std::memory_order_acquire);
+  if (sequence != m_consumer_sequence)
+  {
+    m_consumer_sequence = sequence;
+    begin_seek(m_seek_frame.load(std::memory_order_acquire));
+  }
+  if (!m_flushed)
+  {
+    try_flush();
+  }
+
+  size_t frames_read = 0;
+
+  // Preloaded cue frames play while the producer catches up from disk
+  if (m_cue_offset < m_cue_end)
+  {
+    auto table = m_cues.read();
+    const CuePoint *cue = nullptr;
+    if (table)
+    {
+      auto it = std::lower_bound(table->cues.begin(), table->cues.end(), m_cue_frame,
+                                 [](const CuePoint &c, uint64_t frame) { return c.frame < frame; });
+      cue = it != table->cues.end() && it->frame == m_cue_frame ? &*it : nullptr;
+    }
+
+    if (cue != nullptr)
+    {
+      frames_read = std::min(frames, m_cue_end - m_cue_offset);
+      std::copy_n(cue->samples->data() + m_cue_offset * m_channels, frames_read * m_channels, destination);
+      m_cue_offset += frames_read;
+    }
+    else
+    {
+      // The cue was removed while it played, the disk stream takes over where it left off
+      m_cue_end = m_cue_offset;
+    }
+  }
+
+  if (m_flushed && frames_read < frames)
+  {
+    // The producer only writes whole frames, so the interleaving never slips
+    const size_t frames_available = p_ring->size() / m_channels;
+    const size_t frames_to_read = std::min(frames - frames_read, frames_available);
+    const size_t ring_frames = p_ring->read(std::span<float>(destination + frames_read * m_channels, frames_to_read * m_channels)) / m_channels;
+    frames_read += ring_frames;
+    advance_position(ring_frames);
+  }
+
+  publish_cue_frames();
+  if (m_cue_offset < m_cue_end)
+  {
+    m_position.store(m_cue_frame + m_cue_offset, std::memory_order_release);
+  }
+  else if (m_flushed)
+  {
+    m_position.store(m_segment.file_frame + (m_consumed - m_segment.stream_frame), std::memory_order_release);
+  }
+
+  return frames_read;
+}
+
+void FileStream::begin_seek(uint64_t frame) noexcept
+{
+  m_seek_target = frame;
+  m_flushed = false;
+  m_cue_offset = 0;
+  m_cue_end = 0;
+
+  auto table = m_cues.read();
+  if (table)
+  {
+    // The last cue at or before the target, if the target falls inside its preload
+    auto it = std::upper_bound(table->cues.begin(), table->cues.end(), frame,
+                               [](uint64_t f, const CuePoint &c) { return f < c.frame; });
+    if (it != table->cues.begin())
+    {
+      const CuePoint &cue = *std::prev(it);
+      const size_t cue_frames = cue.samples->get_frames();
+      if (frame < cue.frame + cue_frames)
+      {
+        m_cue_frame = cue.frame;
+        m_cue_offset = static_cast<size_t>(frame - cue.frame);
+        m_cue_end = cue_frames;
+
+        // Stop the cue at the loop end, the producer then resumes at the loop start
+        const uint64_t loop_end = m_loop_end.load(std::memory_order_acquire);
+        if (loop_end != NO_LOOP && frame < loop_end)
+        {
+          m_cue_end = static_cast<size_t>(std::min<uint64_t>(cue_frames, loop_end - cue.frame));
+        }
+      }
+    }
+  }
+
+  publish_cue_frames();
+  m_position.store(frame, std::memory_order_release);
+}
+
+void FileStream::publish_cue_frames() noexcept
+{
+  m_cue_frames.store(m_cue_end - m_cue_offset, std::memory_order_relaxed);
+  m_cue_sequence.store(m_consumer_sequence, std::memory_order_release);
+}
+
+void FileStream::try_flush() noexcept
+{
+  if (m_paused_sequence.load(std::memory_order_acquire) != m_consumer_sequence)
+  {
+    return;
+  }
+
+  // The producer has stopped filling, so everything in the ring is from before the seek
+  p_ring->discard();
+  SegmentMarker stale;
+  while (m_markers.try_pop(stale))
+  {
+  }
+
+  const uint64_t resume_frame = m_cue_end > 0 ? m_cue_frame + m_cue_end : m_seek_target;
+  m_consumed = m_paused_written.load(std::memory_order_acquire);
+  m_segment = SegmentMarker{m_consumed, resume_frame};
+  m_has_next_segment = false;
+  m_flushed = true;
+
+  m_resume_frame.store(resume_frame, std::memory_order_release);
+  m_flushed_sequence.store(m_consumer_sequence, std::memory_order_release);
+}
+
+void FileStream::advance_position(size_t frames) noexcept
+{
+  m_consumed += frames;
+
+  // Move onto every segment the producer started at or before the frames read so far
+  while (true)
+  {
+    if (!m_has_next_segment)
+    {
+      m_has_next_segment = m_markers.try_pop(m_next_segment);
+      if (!m_has_next_segment)
+      {
+        return;
+      }
+    }
+
+    if (m_next_segment.stream_frame > m_consumed)
+    {
+      return;
+    }
+    m_segment = m_next_segment;
+    m_has_next_segment = false;
+  }
+}
+
+FileStream::eFillStep FileStream::begin_fill(size_t max_frames, size_t &frames_to_read)
+{
+  // A seek pauses filling until the audio thread has dropped the ring, then resumes at its frame
+  const uint64_t sequence = m_seek_sequence.load(std::memory_order_acquire);
+  if (sequence != m_producer_sequence)
+  {
+    m_producer_sequence = sequence;
+    m_paused_written.store(m_written, std::memory_order_relaxed);
+    m_paused_sequence.store(sequence, std::memory_order_release);
+    m_waiting_for_flush = true;
+  }
+
+  if (m_waiting_for_flush)
+  {
+    if (m_flushed_sequence.load(std::memory_order_acquire) != m_producer_sequence)
+    {
+      return eFillStep::Waiting;
+    }
+    m_waiting_for_flush = false;
+    m_file_frame = m_resume_frame.load(std::memory_order_acquire);
+    seek_file(m_file_frame);
+    m_end_of_file = false;
+    m_marker_pending = false;
+  }
+
+  if (m_marker_pending)
+  {
+    if (!m_markers.try_push(m_pending_marker))
+    {
+      return eFillStep::Idle;
+    }
+    m_marker_pending = false;
+  }
+
+  const uint64_t loop_end = m_loop_end.load(std::memory_order_acquire);
+  const uint64_t loop_start = m_loop_start.load(std::memory_order_acquire);
+  m_fill_loop_end = loop_end != NO_LOOP && loop_start < loop_end ? loop_end : NO_LOOP;
+  if (m_fill_loop_end != NO_LOOP && m_file_frame >= m_fill_loop_end)
+  {
+    // Wrap in the ring itself, so the audio thread plays straight through the loop point
+    m_file_frame = loop_start;
+    seek_file(m_file_frame);
+    m_pending_marker = SegmentMarker{m_written, m_file_frame};
+    m_marker_pending = true;
+    m_end_of_file = false;
+    return eFillStep::Worked;
+  }
+
+  const size_t capacity_frames = p_ring->capacity() / m_channels;
+  const size_t fill_frames = p_ring->size() / m_channels;
+  const size_t target_frames = std::min(m_read_ahead_frames.load(std::memory_order_relaxed), capacity_frames);
+  if (m_end_of_file || fill_frames >= target_frames)
+  {
+    return eFillStep::Idle;
+  }
+
+  frames_to_read = std::min({target_frames - fill_frames, max_frames, READ_CHUNK_FRAMES});
+  if (m_fill_loop_end != NO_LOOP)
+  {
+    frames_to_read = static_cast<size_t>(std::min<uint64_t>(frames_to_read, m_fill_loop_end - m_file_frame));
+  }
+  return eFillStep::Read;
+}
+
+void FileStream::end_fill(size_t frames_read, double read_seconds)
+{
+  update_read_ahead(read_seconds, p_ring->capacity() / m_channels);
+
+  if (frames_read == 0)
+  {
+    // A loop end past the end of the file wraps at the end of the file
+    if (m_fill_loop_end != NO_LOOP)
+    {
+      m_file_frame = m_fill_loop_end;
+    }
+    else
+    {
+      LOG_DEBUG("FileStream: Reached end of file");
+      m_end_of_file = true;
+    }
+    return;
+  }
+
+  // Only one producer adds data, so the free space measured by begin_fill() is still available
+  p_ring->write(std::span<const float>(m_scratch.data(), frames_read * m_channels));
+  m_written += frames_read;
+  m_file_frame += frames_read;
+}
+
+FileStream::eFillStep FileStream::service(size_t max_frames)
+{
+  size_t frames_to_read = 0;
+  const eFillStep step = begin_fill(max_frames, frames_to_read);
+  if (step != eFillStep::Read)
+  {
+    return step;
+  }
+
+  const auto read_start = std::chrono::steady_clock::now();
+  const size_t frames_read = read_file(m_scratch.data(), frames_to_read);
+  end_fill(frames_read, std::chrono::duration<double>(std::chrono::steady_clock::now() - read_start).count());
+  return eFillStep::Worked;
+}
+
+FileStream::eFillStep FileStream::prepare_read(size_t max_frames, WavReader::ReadRequest &request)
+{
+  size_t frames_to_read = 0;
+  const eFillStep step = begin_fill(max_frames, frames_to_read);
+  if (step != eFillStep::Read)
+  {
+    return step;
+  }
+
+  if (!p_wav_reader->prepare_read(m_scratch.data(), frames_to_read, request))
+  {
+    // At the end of the file, so there is nothing to issue
+    end_fill(0, 0.0);
+    return eFillStep::Worked;
+  }
+  return eFillStep::Read;
+}
+
+void FileStream::complete_read(const WavReader::ReadRequest &request, size_t bytes_read, double read_seconds)
+{
+  end_fill(p_wav_reader->complete_read(request, bytes_read), read_seconds);
+}
+
+double FileStream::get_deadline_seconds() const noexcept
+{
+  const bool seek_pending = m_seek_sequence.load(std::memory_order_acquire) != m_producer_sequence ||
+                            (m_waiting_for_flush && m_flushed_sequence.load(std::memory_order_acquire) == m_producer_sequence);
+  if (seek_pending || m_marker_pending || !p_ring || m_sample_rate == 0)
+  {
+    return -std::numeric_limits<double>::infinity();
+  }
+
+  const size_t fill_frames = p_ring->size() / m_channels;
+  return (static_cast<double>(fill_frames) - static_cast<double>(m_min_read_ahead_frames)) / m_sample_rate;
+}
+
+size_t FileStream::read_file(float *destination, size_t frames)
+{
+  TRACE_SCOPE_ID("FileRead", frames);
+  if (p_wav_reader)
+  {
+    return p_wav_reader->read_frames(destination, frames);
+  }
+
+  const sf_count_t frames_read = sf_readf_float(p_snd_file, destination, static_cast<sf_count_t>(frames));
+  return frames_read > 0 ? static_cast<size_t>(frames_read) : 0;
+}
+
+void FileStream::seek_file(uint64_t frame)
+{
+  if (p_wav_reader)
+  {
+    p_wav_reader->seek(frame);
+  }
+  else if (p_snd_file != nullptr)
+  {
+    sf_seek(p_snd_file, static_cast<sf_count_t>(frame), SEEK_SET);
+  }
+}
+
+void FileStream::update_read_ahead(double read_seconds, size_t capacity_frames) noexcept
+{
+  m_slowest_read = std::max(read_seconds, m_slowest_read * READ_LATENCY_DECAY);
+
+  const size_t latency_frames = static_cast<size_t>(m_slowest_read * READ_LATENCY_HEADROOM * m_sample_rate);
+  m_read_ahead_frames.store(std::clamp(latency_frames, m_min_read_ahead_frames, capacity_frames), std::memory_order_relaxed);
+  m_read_latency_ms.store(m_slowest_read * 1000.0, std::memory_order_relaxed);
+}
@@ -0,0 +1,329 @@
+#include "filewriter.h"
+#include "logger.h"
+#include "threading.h"
+
+#include <algorithm>
+#include <chrono>
+
+#ifdef PLATFORM_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace miniaudioengine::adapters;
+
+namespace
+{
+
+/** @brief Longest the writer thread sleeps before re-checking the queue, so stop requests are observed promptly. */
+constexpr auto WRITER_WAIT_TIMEOUT = std::chrono::milliseconds(10);
+
+/** @brief Room reserved for the WAV header and metadata chunks when preallocating. */
+constexpr unsigned long long HEADER_RESERVE_BYTES = 4096;
+
+int to_sndfile_format(eSampleFormat format)
+{
+  switch (format)
+  {
+    case eSampleFormat::Int16:
+      return SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+    case eSampleFormat::Int24:
+      return SF_FORMAT_WAV | SF_FORMAT_PCM_24;
+    case eSampleFormat::Int32:
+      return SF_FORMAT_WAV | SF_FORMAT_PCM_32;
+    case eSampleFormat::Float32:
+    default:
+      return SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+  }
+}
+
+} // namespace
+
+FileWriter::~FileWriter()
+{
+  if (is_open())
+  {
+    close();
+  }
+}
+
+bool FileWriter::open(const std::filesystem::path &path, unsigned int channels, unsigned int sample_rate,
+                      const Config &config)
+{
+  if (is_open())
+  {
+    LOG_WARNING("FileWriter: open - Already writing ", m_path.string());
+    return false;
+  }
+
+  if (channels == 0 || sample_rate == 0 || config.chunk_frames == 0 || config.chunk_count == 0)
+  {
+    LOG_ERROR("FileWriter: open - Invalid stream format. Channels=", channels, ", SampleRate=", sample_rate,
+              ", ChunkFrames=", config.chunk_frames, ", ChunkCount=", config.chunk_count);
+    return false;
+  }
+
+  SF_INFO info = {};
+  info.channels = static_cast<int>(channels);
+  info.samplerate = static_cast<int>(sample_rate);
+  info.format = to_sndfile_format(config.format);
+  if (!sf_format_check(&info))
+  {
+    LOG_ERROR("FileWriter: open - Unsupported format ", to_string(config.format), " for ", path.string());
+    return false;
+  }
+
+  SNDFILE *file = open_file(path, info, config);
+  if (file == nullptr)
+  {
+    LOG_ERROR("FileWriter: open - Failed to create ", path.string(), ": ", sf_strerror(nullptr));
+    return false;
+  }
+
+  // Saturate instead of wrapping when float samples exceed the integer range
+  sf_command(file, SFC_SET_CLIPPING, nullptr, SF_TRUE);
+
+  p_file = file;
+  m_path = path;
+  m_channels = channels;
+  m_sample_rate = sample_rate;
+  m_chunk_frames = config.chunk_frames;
+  m_error.store(false, std::memory_order_relaxed);
+  m_frames_written.store(0, std::memory_order_relaxed);
+  m_dropped_frames.store(0, std::memory_order_relaxed);
+
+  // Allocating zeroed chunks up front also faults their pages in before the producer touches them
+  const uint32_t chunk_count = static_cast<uint32_t>(config.chunk_count);
+  m_chunks.allocate(chunk_count, 1, static_cast<unsigned int>(m_chunk_frames * channels));
+  p_free_chunks = std::make_unique<framework::RingBuffer<uint32_t>>(chunk_count);
+  p_full_chunks = std::make_unique<framework::RingBuffer<ChunkRef>>(chunk_count);
+  for (uint32_t i = 0; i < chunk_count; i++)
+  {
+    p_free_chunks->try_push(i);
+  }
+  m_current_chunk = NO_CHUNK;
+  m_current_frames = 0;
+
+  p_writer_thread = std::make_unique<std::jthread>([this](std::stop_token stop_token) { run(stop_token); });
+
+  LOG_INFO("FileWriter: Writing ", path.string(), ". Channels=", channels, ", SampleRate=", sample_rate,
+           ", Format=", to_string(config.format), ", Chunks=", chunk_count, "x", m_chunk_frames, " frames");
+  return true;
+}
+
+SNDFILE *FileWriter::open_file(const std::filesystem::path &path, SF_INFO &info, const Config &config)
+{
+  if (config.preallocate_frames == 0)
+  {
+    return sf_open(path.string().c_str(), SFM_WRITE, &info);
+  }
+
+#ifdef PLATFORM_LINUX
+  const int fd = ::open(path.string().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+  {
+    return nullptr;
+  }
+
+  // Reserve the blocks without changing the file size, so the header libsndfile writes on close stays valid
+  const unsigned long long bytes = config.preallocate_frames * static_cast<unsigned long long>(info.channels) *
+                                   get_bytes_per_sample(config.format) + HEADER_RESERVE_BYTES;
+  if (::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(bytes)) != 0)
+  {
+    LOG_WARNING("FileWriter: open - Could not preallocate ", bytes, " bytes for ", path.string());
+  }
+
+  SNDFILE *file = sf_open_fd(fd, SFM_WRITE, &info, SF_TRUE);
+  if (file == nullptr)
+  {
+    ::close(fd);
+  }
+  return file;
+#else
+  LOG_DEBUG("FileWriter: open - Preallocation is not supported on this platform");
+  return sf_open(path.string().c_str(), SFM_WRITE, &info);
+#endif
+}
+
+size_t FileWriter::write(std::span<const float> samples) noexcept
+{
+  if (!is_open())
+  {
+    return 0;
+  }
+
+  const size_t queued = queue(samples);
+  if (queued < samples.size())
+  {
+    const unsigned long long dropped = (samples.size() - queued) / m_channels;
+    m_dropped_frames.fetch_add(dropped, std::memory_order_relaxed);
+    if (p_statistics)
+    {
+      p_statistics->record_dropped_frames(dropped);
+    }
+  }
+  return queued;
+}
+
+bool FileWriter::write_all(std::span<const float> samples)
+{
+  if (!is_open())
+  {
+    LOG_ERROR("FileWriter: write_all - No file is open");
+    return false;
+  }
+
+  while (true)
+  {
+    samples = samples.subspan(queue(samples));
+    if (has_error())
+    {
+      return false;
+    }
+
+    if (samples.empty())
+    {
+      return true;
+    }
+
+    wait(m_space_pending, m_space_signal);
+  }
+}
+
+void FileWriter::flush() noexcept
+{
+  if (m_current_chunk != NO_CHUNK && m_current_frames > 0)
+  {
+    submit_chunk();
+  }
+}
+
+bool FileWriter::close()
+{
+  if (!is_open())
+  {
+    LOG_WARNING("FileWriter: close - No file is open");
+    return false;
+  }
+
+  // The writer drains every submitted chunk before it observes the stop request
+  flush();
+  p_writer_thread->request_stop();
+  notify(m_data_pending, m_data_signal);
+  p_writer_thread->join();
+  p_writer_thread.reset();
+
+  sf_write_sync(p_file);
+  sf_close(p_file);
+  p_file = nullptr;
+
+  const bool success = !has_error();
+  LOG_INFO("FileWriter: Closed ", m_path.string(), ". Frames=", get_frames_written(),
+           ", Dropped=", get_dropped_frames(), (success ? "" : ", write errors occurred"));
+  return success;
+}
+
+bool FileWriter::set_statistics(const framework::StreamStatisticsPtr &statistics)
+{
+  if (is_open())
+  {
+    LOG_ERROR("FileWriter: set_statistics - Cannot change statistics while a file is open.");
+    return false;
+  }
+
+  p_statistics = statistics;
+  return true;
+}
+
+size_t FileWriter::queue(std::span<const float> samples) noexcept
+{
+  const size_t frames = samples.size() / m_channels;
+  size_t frames_queued = 0;
+  while (frames_queued < frames)
+  {
+    if (m_current_chunk == NO_CHUNK)
+    {
+      uint32_t chunk = NO_CHUNK;
+      if (!p_free_chunks->try_pop(chunk))
+      {
+        break;
+      }
+      m_current_chunk = chunk;
+      m_current_frames = 0;
+    }
+
+    const size_t count = std::min(frames - frames_queued, m_chunk_frames - m_current_frames);
+    std::copy_n(samples.data() + frames_queued * m_channels, count * m_channels,
+                get_chunk(m_current_chunk) + m_current_frames * m_channels);
+    m_current_frames += count;
+    frames_queued += count;
+
+    if (m_current_frames == m_chunk_frames)
+    {
+      submit_chunk();
+    }
+  }
+
+  return frames_queued * m_channels;
+}
+
+void FileWriter::submit_chunk() noexcept
+{
+  // Never fails, the full queue has room for every chunk of the pool
+  p_full_chunks->try_push(ChunkRef{m_current_chunk, static_cast<uint32_t>(m_current_frames)});
+  m_current_chunk = NO_CHUNK;
+  m_current_frames = 0;
+  notify(m_data_pending, m_data_signal);
+}
+
+void FileWriter::run(std::stop_token stop_token)
+{
+  framework::threading::register_current_thread("FileWriter", framework::eThreadClass::Io);
+
+  while (true)
+  {
+    // Sample the stop flag before draining so chunks submitted before close() are never left behind
+    const bool stopping = stop_token.stop_requested();
+
+    ChunkRef chunk;
+    if (p_full_chunks->try_pop(chunk))
+    {
+      const sf_count_t written = sf_writef_float(p_file, get_chunk(chunk.index), static_cast<sf_count_t>(chunk.frames));
+      if (written != static_cast<sf_count_t>(chunk.frames))
+      {
+        LOG_ERROR("FileWriter: run - Wrote ", written, " of ", chunk.frames, " frames to ", m_path.string());
+        m_error.store(true, std::memory_order_release);
+      }
+      m_frames_written.fetch_add(static_cast<unsigned long long>(std::max<sf_count_t>(written, 0)), std::memory_order_relaxed);
+
+      p_free_chunks->try_push(chunk.index);
+      notify(m_space_pending, m_space_signal);
+      continue;
+    }
+
+    if (stopping)
+    {
+      return;
+    }
+
+    wait(m_data_pending, m_data_signal);
+  }
+}
+
+void FileWriter::notify(std::atomic<bool> &pending, std::binary_semaphore &signal) noexcept
+{
+  // The semaphore release never blocks, so this is safe to call from the audio thread
+  if (!pending.exchange(true, std::memory_order_acq_rel))
+  {
+    signal.release();
+  }
+}
+
+void FileWriter::wait(std::atomic<bool> &pending, std::binary_semaphore &signal)
+{
+  if (signal.try_acquire_for(WRITER_WAIT_TIMEOUT))
+  {
+    // Only clear the pending flag once the release has been consumed, so the semaphore never exceeds one
+    pending.store(false, std::memory_order_release);
+  }
+}
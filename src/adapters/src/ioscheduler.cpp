@@ -0,0 +1,305 @@
+#include "ioscheduler.h"
+#include "filestream.h"
+#include "logger.h"
+#include "threading.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#ifdef PLATFORM_LINUX
+#include <csignal>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define MINIAUDIOENGINE_IO_URING
+#endif
+#endif
+
+using namespace miniaudioengine::adapters;
+
+/** @struct IoScheduler::Uring
+ *  @brief Minimal io_uring, set up with the raw system calls so no liburing is needed.
+ *  Only the I/O thread touches it, and every batch is reaped before the next is submitted, so the
+ *  submission queue can never overflow.
+ */
+struct IoScheduler::Uring
+{
+#ifdef MINIAUDIOENGINE_IO_URING
+  int fd{-1};
+  void *sq_ring{MAP_FAILED};
+  void *cq_ring{MAP_FAILED};
+  size_t sq_ring_size{0};
+  size_t cq_ring_size{0};
+  io_uring_sqe *sqes{static_cast<io_uring_sqe *>(MAP_FAILED)};
+  size_t sqes_size{0};
+
+  unsigned *sq_tail{nullptr};
+  unsigned *sq_mask{nullptr};
+  unsigned *sq_array{nullptr};
+  unsigned *cq_head{nullptr};
+  unsigned *cq_tail{nullptr};
+  unsigned *cq_mask{nullptr};
+  io_uring_cqe *cqes{nullptr};
+
+  /** @brief Create the ring. Returns false if the kernel or a seccomp filter refuses io_uring. */
+  bool setup(unsigned entries)
+  {
+    io_uring_params params = {};
+    fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0)
+    {
+      return false;
+    }
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap)
+    {
+      sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+    }
+
+    sq_ring = ::mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_ring == MAP_FAILED)
+    {
+      return false;
+    }
+    cq_ring = single_mmap ? sq_ring :
+      ::mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (cq_ring == MAP_FAILED)
+    {
+      return false;
+    }
+
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = static_cast<io_uring_sqe *>(::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+    if (sqes == MAP_FAILED)
+    {
+      return false;
+    }
+
+    char *sq = static_cast<char *>(sq_ring);
+    char *cq = static_cast<char *>(cq_ring);
+    sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  ~Uring()
+  {
+    if (sqes != MAP_FAILED)
+    {
+      ::munmap(sqes, sqes_size);
+    }
+    if (cq_ring != MAP_FAILED && cq_ring != sq_ring)
+    {
+      ::munmap(cq_ring, cq_ring_size);
+    }
+    if (sq_ring != MAP_FAILED)
+    {
+      ::munmap(sq_ring, sq_ring_size);
+    }
+    if (fd >= 0)
+    {
+      ::close(fd);
+    }
+  }
+
+  int enter(unsigned to_submit, unsigned min_complete)
+  {
+    while (true)
+    {
+      const long result = ::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, IORING_ENTER_GETEVENTS, nullptr, _NSIG / 8);
+      if (result >= 0 || errno != EINTR)
+      {
+        return static_cast<int>(result);
+      }
+    }
+  }
+
+  std::vector<long long> results; // Each read's return value, bytes or a negative errno
+
+  /** @brief Submit every read in one call and reap them all into results.
+   *  @return False if io_uring itself failed, or the kernel does not support IORING_OP_READ.
+   */
+  bool read(const std::vector<WavReader::ReadRequest> &requests)
+  {
+    const unsigned count = static_cast<unsigned>(requests.size());
+    unsigned tail = std::atomic_ref<unsigned>(*sq_tail).load(std::memory_order_relaxed);
+    for (unsigned i = 0; i < count; ++i)
+    {
+      const unsigned index = tail & *sq_mask;
+      io_uring_sqe &sqe = sqes[index];
+      std::memset(&sqe, 0, sizeof(sqe));
+      sqe.opcode = IORING_OP_READ;
+      sqe.fd = requests[i].fd;
+      sqe.addr = reinterpret_cast<uint64_t>(requests[i].buffer);
+      sqe.len = static_cast<uint32_t>(requests[i].bytes);
+      sqe.off = requests[i].offset;
+      sqe.user_data = i;
+      sq_array[index] = index;
+      ++tail;
+    }
+    std::atomic_ref<unsigned>(*sq_tail).store(tail, std::memory_order_release);
+
+    results.assign(count, 0);
+    unsigned to_submit = count;
+    unsigned completed = 0;
+    bool supported = true;
+    while (completed < count)
+    {
+      const int submitted = enter(to_submit, count - completed);
+      if (submitted < 0)
+      {
+        return false;
+      }
+      to_submit -= std::min<unsigned>(to_submit, static_cast<unsigned>(submitted));
+
+      unsigned head = std::atomic_ref<unsigned>(*cq_head).load(std::memory_order_relaxed);
+      const unsigned cq_end = std::atomic_ref<unsigned>(*cq_tail).load(std::memory_order_acquire);
+      for (; head != cq_end; ++head, ++completed)
+      {
+        const io_uring_cqe &cqe = cqes[head & *cq_mask];
+        results[static_cast<size_t>(cqe.user_data)] = cqe.res;
+        supported = supported && cqe.res != -EINVAL && cqe.res != -EOPNOTSUPP;
+      }
+      std::atomic_ref<unsigned>(*cq_head).store(head, std::memory_order_release);
+    }
+    return supported;
+  }
+#endif
+};
+
+IoScheduler::IoScheduler()
+{
+#ifdef MINIAUDIOENGINE_IO_URING
+  auto uring = std::make_unique<Uring>();
+  if (uring->setup(static_cast<unsigned>(MAX_BATCH)))
+  {
+    p_uring = std::move(uring);
+    m_io_uring_enabled.store(true, std::memory_order_relaxed);
+  }
+#endif
+  LOG_DEBUG("IoScheduler: Batching reads with ", is_io_uring_enabled() ? "io_uring" : "pread");
+
+  m_thread = std::jthread([this](std::stop_token stop_token) {
+    framework::threading::register_current_thread("IoScheduler", framework::eThreadClass::Io);
+    run(stop_token);
+  });
+}
+
+IoScheduler::~IoScheduler()
+{
+  m_thread.request_stop();
+  if (m_thread.joinable())
+  {
+    m_thread.join();
+  }
+}
+
+void IoScheduler::run(std::stop_token stop_token)
+{
+  std::vector<FileStream *> streams;
+  std::vector<FileStream *> reading;
+  std::vector<WavReader::ReadRequest> requests;
+  std::vector<size_t> bytes_read;
+  streams.reserve(MAX_BATCH);
+  reading.reserve(MAX_BATCH);
+  requests.reserve(MAX_BATCH);
+  bytes_read.reserve(MAX_BATCH);
+
+  while (m_queue.acquire(stop_token, MAX_BATCH, streams))
+  {
+    reading.clear();
+    requests.clear();
+    for (FileStream *stream : streams)
+    {
+      WavReader::ReadRequest request;
+      const FileStream::eFillStep step = stream->prepare_read(READ_BUDGET_FRAMES, request);
+      if (step == FileStream::eFillStep::Read)
+      {
+        reading.push_back(stream);
+        requests.push_back(request);
+      }
+      else
+      {
+        m_queue.release(stream, step);
+      }
+    }
+
+    if (requests.empty())
+    {
+      continue;
+    }
+
+    // Every stream in the batch waited for the whole batch, so that is the latency their read-ahead covers
+    const auto read_start = std::chrono::steady_clock::now();
+    read_batch(reading, requests, bytes_read);
+    const double read_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - read_start).count();
+
+    for (size_t i = 0; i < reading.size(); ++i)
+    {
+      reading[i]->complete_read(requests[i], bytes_read[i], read_seconds);
+      m_queue.release(reading[i], FileStream::eFillStep::Worked);
+    }
+  }
+}
+
+void IoScheduler::read_batch(const std::vector<FileStream *> &streams, const std::vector<WavReader::ReadRequest> &requests,
+                             std::vector<size_t> &bytes_read)
+{
+  TRACE_SCOPE_ID("IoReadBatch", requests.size());
+  bytes_read.assign(requests.size(), 0);
+
+#ifdef MINIAUDIOENGINE_IO_URING
+  bool all_have_fd = true;
+  for (const WavReader::ReadRequest &request : requests)
+  {
+    all_have_fd = all_have_fd && request.fd >= 0;
+  }
+
+  if (p_uring && all_have_fd)
+  {
+    if (p_uring->read(requests))
+    {
+      const std::vector<long long> &results = p_uring->results;
+      for (size_t i = 0; i < requests.size(); ++i)
+      {
+        if (results[i] >= 0)
+        {
+          bytes_read[i] = static_cast<size_t>(results[i]);
+        }
+        else if (results[i] == -EINTR || results[i] == -EAGAIN)
+        {
+          bytes_read[i] = streams[i]->submit_read(requests[i]);
+        }
+        else
+        {
+          LOG_WARNING("IoScheduler: read_batch - Read failed: ", std::strerror(static_cast<int>(-results[i])));
+        }
+      }
+      return;
+    }
+
+    // Positioned reads are idempotent, so the batch is simply read again without io_uring
+    LOG_WARNING("IoScheduler: read_batch - io_uring reads are not supported, falling back to pread");
+    p_uring.reset();
+    m_io_uring_enabled.store(false, std::memory_order_relaxed);
+  }
+#endif
+
+  for (size_t i = 0; i < requests.size(); ++i)
+  {
+    bytes_read[i] = streams[i]->submit_read(requests[i]);
+  }
+}
@@ -0,0 +1,339 @@
+#include "jitterbuffer.h"
+#include "dspkernels.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+using namespace miniaudioengine;
+using namespace miniaudioengine::adapters;
+
+namespace
+{
+
+/** @brief Extended sequence numbers start here, so reordered packets before the first one stay positive. */
+constexpr uint64_t FIRST_BASE = 1 << 16;
+
+/** @brief Multiple of the interarrival jitter added to the playout delay. */
+constexpr double JITTER_MULTIPLE = 4.0;
+
+/** @brief Response of the rate control, critically damped to settle in about 20 s. Quicker than a device
+ *  boundary's, as the target moves with the measured jitter and must be followed within seconds.
+ */
+constexpr framework::DriftEstimatorConfig RATE_CONTROL{.average_seconds = 0.25,
+                                                       .proportional_gain = 0.5,
+                                                       .integral_gain = 0.0625,
+                                                       .max_drift = 0.002,
+                                                       .max_correction = 0.005};
+
+/** @brief The margin added by an underrun shrinks by one packet every this many seconds. */
+constexpr double MARGIN_DECAY_SECONDS = 10.0;
+
+size_t to_frames(double ms, unsigned int sample_rate)
+{
+  return static_cast<size_t>(std::max(ms, 0.0) * sample_rate / 1000.0);
+}
+
+} // namespace
+
+bool JitterBuffer::prepare(const Config &config)
+{
+  if (config.channels == 0 || config.packet_frames == 0 || config.sample_rate == 0 || config.max_read_frames == 0)
+  {
+    LOG_ERROR("JitterBuffer: prepare - Invalid format. Channels=", config.channels, ", PacketFrames=",
+              config.packet_frames, ", SampleRate=", config.sample_rate, ", MaxReadFrames=", config.max_read_frames);
+    return false;
+  }
+
+  m_channels = config.channels;
+  m_packet_frames = config.packet_frames;
+  m_sample_rate = config.sample_rate;
+  m_max_read_frames = config.max_read_frames;
+  m_max_delay_frames = std::max<size_t>(to_frames(config.max_delay_ms, m_sample_rate), m_packet_frames);
+  m_min_delay_frames = std::min(to_frames(config.min_delay_ms, m_sample_rate), m_max_delay_frames);
+
+  // Packets keep arriving for the whole delay, so the slots must cover it with room to spare
+  const size_t delay_packets = m_max_delay_frames / m_packet_frames + 1;
+  m_capacity = std::bit_ceil(std::max(config.capacity_packets, 2 * delay_packets));
+  m_mask = m_capacity - 1;
+
+  m_slots.allocate(m_capacity, 1, m_packet_frames * m_channels);
+  p_tags = std::make_unique<std::atomic<uint64_t>[]>(m_capacity);
+  p_slot_frames = std::make_unique<unsigned int[]>(m_capacity);
+
+  // Output frame i interpolates staged frames floor(p) and floor(p) + 1, p advancing by up to 1 + RATE_CONTROL.max_correction
+  const size_t staging_frames = 2 * m_max_read_frames + 2 * m_packet_frames + 4;
+  m_staging.assign(staging_frames * m_channels, 0.0f);
+  m_planar.assign(m_max_read_frames * m_channels, 0.0f);
+
+  m_newest.store(NO_SEQUENCE, std::memory_order_relaxed);
+  m_read_sequence.store(0, std::memory_order_relaxed);
+  m_resync_sequence.store(NO_SEQUENCE, std::memory_order_relaxed);
+  m_jitter_frames.store(0.0, std::memory_order_relaxed);
+  m_has_packets = false;
+  m_base = FIRST_BASE;
+  m_newest_written = 0;
+  m_jitter = 0.0;
+
+  m_state = eState::Buffering;
+  m_read = 0;
+  m_staged_frames = 0;
+  m_position = 0.0;
+  m_ratio = 1.0;
+  m_rate_control.prepare(RATE_CONTROL, m_sample_rate);
+  m_underrun_target = 0;
+  m_margin_frames = 0.0;
+
+  m_target_frames.store(m_min_delay_frames, std::memory_order_relaxed);
+  m_drift_ppm.store(0.0, std::memory_order_relaxed);
+  m_received.store(0, std::memory_order_relaxed);
+  m_lost.store(0, std::memory_order_relaxed);
+  m_late.store(0, std::memory_order_relaxed);
+  m_dropped.store(0, std::memory_order_relaxed);
+  m_underruns.store(0, std::memory_order_relaxed);
+
+  LOG_INFO("JitterBuffer: prepare - ", m_capacity, " slots of ", m_packet_frames, " frames. Delay=",
+           m_min_delay_frames, "-", m_max_delay_frames, " frames");
+  return true;
+}
+
+bool JitterBuffer::push(uint16_t sequence, uint32_t timestamp, const float *samples, unsigned int frames,
+                        uint64_t arrival_ns) noexcept
+{
+  if (m_channels == 0 || samples == nullptr || frames == 0)
+  {
+    return false;
+  }
+  frames = std::min(frames, m_packet_frames);
+  m_received.fetch_add(1, std::memory_order_relaxed);
+
+  if (!m_has_packets)
+  {
+    // Playout starts after this packet. It may alias a slot the audio thread still reads, so it is not stored
+    m_has_packets = true;
+    m_newest_written = m_base + sequence;
+    m_last_timestamp = timestamp;
+    m_last_arrival_ns = arrival_ns;
+    m_resync_sequence.store(m_newest_written + 1, std::memory_order_release);
+    return false;
+  }
+
+  // Extend the 16-bit sequence number by its distance to the newest, which handles wrap-around and reordering
+  const int16_t distance = static_cast<int16_t>(static_cast<uint16_t>(sequence - static_cast<uint16_t>(m_newest_written)));
+  const uint64_t extended = m_newest_written + static_cast<uint64_t>(static_cast<int64_t>(distance));
+  m_newest_written = std::max(m_newest_written, extended);
+
+  // RFC 3550 interarrival jitter: the change in transit time between consecutive packets, smoothed by 1/16
+  const double arrival_frames = static_cast<double>(static_cast<int64_t>(arrival_ns - m_last_arrival_ns)) * m_sample_rate / 1e9;
+  const double transit_change = arrival_frames - static_cast<double>(static_cast<int32_t>(timestamp - m_last_timestamp));
+  m_jitter += (std::abs(transit_change) - m_jitter) / 16.0;
+  m_jitter_frames.store(m_jitter, std::memory_order_relaxed);
+  m_last_timestamp = timestamp;
+  m_last_arrival_ns = arrival_ns;
+
+  const uint64_t read = m_read_sequence.load(std::memory_order_acquire);
+  if (extended < read)
+  {
+    m_late.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  if (extended >= read + m_capacity)
+  {
+    // Beyond the slots: the audio thread is not reading yet, or the stream jumped. Play on from here
+    if (m_resync_sequence.exchange(extended + 1, std::memory_order_acq_rel) == NO_SEQUENCE)
+    {
+      m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    return false;
+  }
+
+  const size_t slot = extended & m_mask;
+  if (p_tags[slot].load(std::memory_order_relaxed) == extended + 1)
+  {
+    return false; // Duplicate
+  }
+
+  std::copy_n(samples, static_cast<size_t>(frames) * m_channels, get_slot(extended));
+  p_slot_frames[slot] = frames;
+  p_tags[slot].store(extended + 1, std::memory_order_release);
+
+  if (extended > m_newest.load(std::memory_order_relaxed))
+  {
+    m_newest.store(extended, std::memory_order_release);
+  }
+  return true;
+}
+
+void JitterBuffer::restart() noexcept
+{
+  // Sequence numbers of the new sender start above every tag of the old one, so no stale slot reads as present
+  m_has_packets = false;
+  m_base = m_newest_written + m_capacity + FIRST_BASE;
+  m_jitter = 0.0;
+  m_jitter_frames.store(0.0, std::memory_order_relaxed);
+}
+
+size_t JitterBuffer::get_available_frames() const noexcept
+{
+  return get_fill_frames(m_newest.load(std::memory_order_acquire));
+}
+
+size_t JitterBuffer::read_frames(float *destination, size_t frames) noexcept
+{
+  if (m_channels == 0)
+  {
+    return 0;
+  }
+
+  size_t done = 0;
+  while (done < frames)
+  {
+    const size_t block = std::min(frames - done, m_max_read_frames);
+    const size_t produced = read_block(destination + done * m_channels, block);
+    done += produced;
+    if (produced < block)
+    {
+      break;
+    }
+  }
+  return done;
+}
+
+size_t JitterBuffer::get_fill_frames(uint64_t newest) const noexcept
+{
+  const uint64_t packets = newest != NO_SEQUENCE && newest + 1 > m_read ? newest + 1 - m_read : 0;
+  const size_t staged = m_staged_frames - std::min(m_staged_frames, static_cast<size_t>(m_position));
+  return static_cast<size_t>(packets) * m_packet_frames + staged;
+}
+
+size_t JitterBuffer::read_block(float *destination, size_t frames) noexcept
+{
+  const uint64_t resync = m_resync_sequence.exchange(NO_SEQUENCE, std::memory_order_acq_rel);
+  if (resync != NO_SEQUENCE)
+  {
+    skip_to(resync);
+    m_state = eState::Buffering;
+    m_underrun_target = 0;
+  }
+
+  const uint64_t newest = m_newest.load(std::memory_order_acquire);
+  const size_t fill = get_fill_frames(newest);
+
+  // There must be a whole block and a packet in hand, plus headroom for the jitter and past underruns
+  const double wanted = static_cast<double>(frames + m_packet_frames) +
+                        JITTER_MULTIPLE * m_jitter_frames.load(std::memory_order_relaxed) + m_margin_frames;
+  size_t target = std::clamp(static_cast<size_t>(wanted), m_min_delay_frames, m_max_delay_frames);
+  m_target_frames.store(target, std::memory_order_relaxed);
+  const double margin_decay = std::min(m_margin_frames, static_cast<double>(frames) * m_packet_frames / (m_sample_rate * MARGIN_DECAY_SECONDS));
+  m_margin_frames -= margin_decay;
+
+  if (m_state == eState::Buffering)
+  {
+    if (fill < target)
+    {
+      std::fill_n(destination, frames * m_channels, 0.0f);
+      return frames;
+    }
+    // The packets a stall held back arrive together. Their backlog beyond the delay the buffer ran dry at
+    // is how much deeper it had to be, so it joins the margin instead of being sped through, which would
+    // read as clock drift
+    m_state = eState::Playing;
+    const size_t shortfall = fill - std::min(fill, m_underrun_target);
+    m_margin_frames = std::min(m_margin_frames + static_cast<double>(shortfall), static_cast<double>(m_max_delay_frames));
+    m_underrun_target = 0;
+    target = std::min(fill, m_max_delay_frames);
+    m_target_frames.store(target, std::memory_order_relaxed);
+    // The rest of a burst can still arrive after playback resumes. Its excess is not clock drift, so the
+    // integral holds until the buffer is back within a packet of the target
+    m_rate_control.settle(static_cast<double>(fill) - static_cast<double>(target), m_packet_frames);
+  }
+  else if (fill > target + m_max_delay_frames)
+  {
+    // A burst after a stall upstream. Drop the backlog rather than speed through it for seconds
+    const uint64_t keep = target / m_packet_frames + 1;
+    const uint64_t resume = newest + 1 > keep ? newest + 1 - keep : m_read;
+    m_dropped.fetch_add(resume > m_read ? resume - m_read : 0, std::memory_order_relaxed);
+    skip_to(std::max(resume, m_read));
+  }
+
+  // A shrinking margin lowers the target by a known amount per block, which is followed directly
+  m_ratio = m_rate_control.update(static_cast<double>(fill) - static_cast<double>(target), frames,
+                                  margin_decay / static_cast<double>(frames));
+  m_drift_ppm.store(m_rate_control.get_drift() * 1e6, std::memory_order_relaxed);
+
+  // Output frame i interpolates staged frames floor(p_i) and floor(p_i) + 1, p_i = position + ratio * i
+  const size_t needed = static_cast<size_t>(m_position + m_ratio * static_cast<double>(frames - 1)) + 2;
+  while (m_staged_frames < needed && pull_packet(newest))
+  {
+  }
+
+  size_t produced = frames;
+  if (m_staged_frames < needed)
+  {
+    // Ran dry. Play what is staged, then buffer up to a delay one packet longer
+    const double span = static_cast<double>(m_staged_frames) - 1.0 - m_position;
+    produced = span > 0.0 ? std::min(frames, static_cast<size_t>(std::ceil(span / m_ratio))) : 0;
+    m_state = eState::Buffering;
+    m_margin_frames = std::min(m_margin_frames + m_packet_frames, static_cast<double>(m_max_delay_frames));
+    m_underrun_target = target;
+    m_underruns.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  if (produced > 0)
+  {
+    for (unsigned int channel = 0; channel < m_channels; channel++)
+    {
+      framework::dsp::interpolate_linear(m_planar.data() + channel * m_max_read_frames, m_staging.data() + channel,
+                                         m_channels, m_position, m_ratio, produced);
+    }
+    framework::dsp::interleave(destination, m_planar.data(), m_max_read_frames, m_channels, produced);
+
+    m_position += m_ratio * static_cast<double>(produced);
+    const size_t consumed = std::min(static_cast<size_t>(m_position), m_staged_frames);
+    std::copy(m_staging.begin() + static_cast<std::ptrdiff_t>(consumed * m_channels),
+              m_staging.begin() + static_cast<std::ptrdiff_t>(m_staged_frames * m_channels), m_staging.begin());
+    m_staged_frames -= consumed;
+    m_position -= static_cast<double>(consumed);
+  }
+  return produced;
+}
+
+bool JitterBuffer::pull_packet(uint64_t newest) noexcept
+{
+  if (newest == NO_SEQUENCE || m_read > newest)
+  {
+    return false;
+  }
+
+  // A packet missing at its turn, while later ones have arrived, is lost. Play silence in its place
+  const size_t slot = m_read & m_mask;
+  float *staging = m_staging.data() + m_staged_frames * m_channels;
+  if (p_tags[slot].load(std::memory_order_acquire) == m_read + 1)
+  {
+    const unsigned int frames = p_slot_frames[slot];
+    std::copy_n(get_slot(m_read), static_cast<size_t>(frames) * m_channels, staging);
+    m_staged_frames += frames;
+  }
+  else
+  {
+    std::fill_n(staging, static_cast<size_t>(m_packet_frames) * m_channels, 0.0f);
+    m_staged_frames += m_packet_frames;
+    m_lost.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Publishing the position hands the slot back to the receive thread
+  m_read++;
+  m_read_sequence.store(m_read, std::memory_order_release);
+  return true;
+}
+
+void JitterBuffer::skip_to(uint64_t sequence) noexcept
+{
+  m_read = sequence;
+  m_read_sequence.store(m_read, std::memory_order_release);
+  m_staged_frames = 0;
+  m_position = 0.0;
+  m_rate_control.settle(0.0, m_packet_frames);
+}
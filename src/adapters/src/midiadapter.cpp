@@ -1,8 +1,54 @@
 #include "midiadapter.h"
+#include "trace.h"
+
+#include <chrono>
 
 using namespace miniaudioengine;
 using namespace miniaudioengine::adapters;
 
+void MidiCallbackHandler::midi_callback(double deltatime, std::vector<unsigned char> *message, void *user_data) noexcept
+{
+  TRACE_SCOPE("MidiCallback");
+  Params *params = static_cast<Params *>(user_data);
+  if (params == nullptr || params->queue == nullptr || message == nullptr)
+  {
+    return;
+  }
+
+  midi::MidiMessage midi_message{};
+  if (!midi::decode_midi_message(message->data(), message->size(), midi_message))
+  {
+    return;
+  }
+
+  // RtMidi's deltatimes are stamped by the driver and are steadier than the callback's arrival time.
+  // Follow them from an anchor, and re-anchor if they run ahead of arrival or fall too far behind.
+  const auto now = framework::StreamClock::Clock::now();
+  params->seconds_since_anchor += deltatime;
+  const double lateness = std::chrono::duration<double>(now - params->anchor).count() - params->seconds_since_anchor;
+  if (!params->anchored || lateness < 0.0 || lateness > MAX_LATENESS_SECONDS)
+  {
+    params->anchor = now;
+    params->seconds_since_anchor = 0.0;
+    params->anchored = true;
+  }
+
+  const auto received = params->anchor + std::chrono::duration_cast<framework::StreamClock::Clock::duration>(
+                                             std::chrono::duration<double>(params->seconds_since_anchor));
+
+  midi_message.deltatime = deltatime;
+  midi_message.timestamp = params->clock != nullptr ? params->clock->get_frame(received) : 0;
+
+  if (!params->queue->try_push(midi_message))
+  {
+    params->overflow_count.fetch_add(1, std::memory_order_relaxed);
+    if (params->statistics != nullptr)
+    {
+      params->statistics->record_overflow();
+    }
+  }
+}
+
 MidiAdapter::MidiAdapter()
 {
   std::vector<RtMidi::Api> apis;
@@ -63,14 +109,47 @@ bool MidiAdapter::open_input_port(DevicePtr device, void *callback_context)
   }
 
   LOG_DEBUG("MidiAdapter: Opening MIDI port ", device->to_string());
+  return open_port(device->get_port_number(), callback_context);
+}
+
+bool MidiAdapter::open_input_port(unsigned int port, const framework::MidiQueuePtr &queue, const framework::StreamClockPtr &clock,
+                                  const framework::StreamStatisticsPtr &statistics)
+{
+  if (!queue)
+  {
+    LOG_ERROR("MidiAdapter: open_input_port - MIDI queue is null.");
+    return false;
+  }
 
+  if (is_port_open())
+  {
+    LOG_ERROR("MidiAdapter: open_input_port - Port is already open.");
+    return false;
+  }
+
+  // The callback only sees raw pointers, the adapter keeps their owners alive
+  p_queue = queue;
+  p_clock = clock;
+  p_statistics = statistics;
+  m_callback_params.queue = p_queue.get();
+  m_callback_params.clock = p_clock.get();
+  m_callback_params.statistics = p_statistics.get();
+  m_callback_params.anchored = false;
+  m_callback_params.seconds_since_anchor = 0.0;
+
+  LOG_DEBUG("MidiAdapter: Opening MIDI port ", port);
+  return open_port(port, &m_callback_params);
+}
+
+bool MidiAdapter::open_port(unsigned int port, void *callback_context)
+{
   p_rtmidi_in->setCallback(&MidiCallbackHandler::midi_callback, callback_context);
   p_rtmidi_in->ignoreTypes(false, true, true);
 
   // Set up the MIDI input port
   try
   {
-    p_rtmidi_in->openPort(device->get_port_number());
+    p_rtmidi_in->openPort(port);
   }
   catch (const RtMidiError &error)
   {
@@ -78,7 +157,7 @@ bool MidiAdapter::open_input_port(DevicePtr device, void *callback_context)
     return false;
   }
 
-  LOG_DEBUG("MidiAdapter: Opened MIDI input port ", device->to_string());
+  LOG_DEBUG("MidiAdapter: Opened MIDI input port ", port);
   return true;
 }
 
@@ -0,0 +1,914 @@
+#include "networkadapter.h"
+#include "logger.h"
+#include "realtimememory.h"
+#include "threading.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <random>
+
+#ifdef PLATFORM_WINDOWS
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+using namespace miniaudioengine;
+using namespace miniaudioengine::adapters;
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+/** @brief Sleeping overshoots by up to a scheduler tick, so sleep until shortly before the deadline and spin the rest. */
+constexpr std::chrono::microseconds SPIN_MARGIN{200};
+
+/** @brief Longest the sender and receiver threads block before re-checking for a stop request. */
+constexpr auto THREAD_WAIT_TIMEOUT = std::chrono::milliseconds(10);
+
+/** @brief Largest batch of packets passed to one sendmmsg() or recvmmsg() call. */
+constexpr unsigned int MAX_BATCH_PACKETS = 64;
+
+/** @brief Room for one received datagram. Larger ones are truncated and rejected. */
+constexpr size_t DATAGRAM_CAPACITY = 2048;
+
+/** @brief Receive buffer requested from the kernel, so a burst survives a late wakeup of the receive thread. */
+constexpr int RECEIVE_BUFFER_BYTES = 1 << 20;
+
+/** @brief DSCP AF41 in the IP TOS byte, the class AES67 recommends for media packets. */
+constexpr int MEDIA_TOS = 34 << 2;
+
+/** @brief Lateness the render thread catches up on by rendering back to back. The receiver's jitter buffer
+ *  absorbs the burst, where skipping the periods would leave it short of audio. Later than this, they are skipped.
+ */
+constexpr auto MAX_RENDER_CATCH_UP = std::chrono::milliseconds(20);
+
+/** @brief Silence from the followed sender after which another sender is followed instead. */
+constexpr uint64_t SENDER_TIMEOUT_NS = 1000000000ull;
+
+constexpr uint8_t RTP_VERSION = 2;
+
+void wait_until(Clock::time_point deadline)
+{
+  if (deadline - Clock::now() > SPIN_MARGIN)
+  {
+    std::this_thread::sleep_until(deadline - SPIN_MARGIN);
+  }
+  while (Clock::now() < deadline)
+  {
+  }
+}
+
+uint64_t now_ns()
+{
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+}
+
+void notify(std::atomic<bool> &pending, std::binary_semaphore &signal) noexcept
+{
+  // The semaphore release never blocks, so this is safe to call from the render thread
+  if (!pending.exchange(true, std::memory_order_acq_rel))
+  {
+    signal.release();
+  }
+}
+
+void wait(std::atomic<bool> &pending, std::binary_semaphore &signal)
+{
+  if (signal.try_acquire_for(THREAD_WAIT_TIMEOUT))
+  {
+    // Only clear the pending flag once the release has been consumed, so the semaphore never exceeds one
+    pending.store(false, std::memory_order_release);
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Sockets
+// -----------------------------------------------------------------------------
+
+#ifdef PLATFORM_WINDOWS
+using NativeSocket = SOCKET;
+#else
+using NativeSocket = int;
+#endif
+
+NativeSocket to_native(SocketHandle handle)
+{
+  return static_cast<NativeSocket>(handle);
+}
+
+std::string get_socket_error()
+{
+#ifdef PLATFORM_WINDOWS
+  return "WSA error " + std::to_string(WSAGetLastError());
+#else
+  return std::strerror(errno);
+#endif
+}
+
+bool start_sockets()
+{
+#ifdef PLATFORM_WINDOWS
+  static std::once_flag once;
+  static bool started = false;
+  std::call_once(once, [] {
+    WSADATA data;
+    started = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+  });
+  return started;
+#else
+  return true;
+#endif
+}
+
+void close_socket(SocketHandle &handle)
+{
+  if (handle == INVALID_SOCKET_HANDLE)
+  {
+    return;
+  }
+#ifdef PLATFORM_WINDOWS
+  ::closesocket(to_native(handle));
+#else
+  ::close(to_native(handle));
+#endif
+  handle = INVALID_SOCKET_HANDLE;
+}
+
+SocketHandle open_udp_socket()
+{
+  if (!start_sockets())
+  {
+    return INVALID_SOCKET_HANDLE;
+  }
+  const NativeSocket native = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#ifdef PLATFORM_WINDOWS
+  return native == INVALID_SOCKET ? INVALID_SOCKET_HANDLE : static_cast<SocketHandle>(native);
+#else
+  return native < 0 ? INVALID_SOCKET_HANDLE : static_cast<SocketHandle>(native);
+#endif
+}
+
+bool resolve(const std::string &address, uint16_t port, sockaddr_in &resolved)
+{
+  addrinfo hints{};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  addrinfo *result = nullptr;
+  if (::getaddrinfo(address.c_str(), nullptr, &hints, &result) != 0 || result == nullptr)
+  {
+    return false;
+  }
+  std::memcpy(&resolved, result->ai_addr, sizeof(sockaddr_in));
+  resolved.sin_port = htons(port);
+  ::freeaddrinfo(result);
+  return true;
+}
+
+template <typename T>
+bool set_option(SocketHandle handle, int level, int option, const T &value)
+{
+  return ::setsockopt(to_native(handle), level, option, reinterpret_cast<const char *>(&value), sizeof(value)) == 0;
+}
+
+bool set_receive_timeout(SocketHandle handle, std::chrono::milliseconds timeout)
+{
+#ifdef PLATFORM_WINDOWS
+  const DWORD milliseconds = static_cast<DWORD>(timeout.count());
+  return set_option(handle, SOL_SOCKET, SO_RCVTIMEO, milliseconds);
+#else
+  timeval value{};
+  value.tv_usec = static_cast<suseconds_t>(std::chrono::duration_cast<std::chrono::microseconds>(timeout).count());
+  return set_option(handle, SOL_SOCKET, SO_RCVTIMEO, value);
+#endif
+}
+
+// -----------------------------------------------------------------------------
+// RTP payloads: big-endian samples
+// -----------------------------------------------------------------------------
+
+void put_u16(uint8_t *destination, uint16_t value)
+{
+  destination[0] = static_cast<uint8_t>(value >> 8);
+  destination[1] = static_cast<uint8_t>(value);
+}
+
+void put_u32(uint8_t *destination, uint32_t value)
+{
+  destination[0] = static_cast<uint8_t>(value >> 24);
+  destination[1] = static_cast<uint8_t>(value >> 16);
+  destination[2] = static_cast<uint8_t>(value >> 8);
+  destination[3] = static_cast<uint8_t>(value);
+}
+
+uint16_t get_u16(const uint8_t *source)
+{
+  return static_cast<uint16_t>((source[0] << 8) | source[1]);
+}
+
+uint32_t get_u32(const uint8_t *source)
+{
+  return (static_cast<uint32_t>(source[0]) << 24) | (static_cast<uint32_t>(source[1]) << 16) |
+         (static_cast<uint32_t>(source[2]) << 8) | static_cast<uint32_t>(source[3]);
+}
+
+void encode_samples(eNetworkCodec codec, const float *source, size_t n, uint8_t *destination) noexcept
+{
+  switch (codec)
+  {
+    case eNetworkCodec::Pcm16:
+      for (size_t i = 0; i < n; i++)
+      {
+        const long value = std::lrint(std::clamp(source[i], -1.0f, 1.0f) * 32767.0f);
+        put_u16(destination + 2 * i, static_cast<uint16_t>(value));
+      }
+      break;
+    case eNetworkCodec::Pcm24:
+      for (size_t i = 0; i < n; i++)
+      {
+        const uint32_t value = static_cast<uint32_t>(std::lrint(std::clamp(source[i], -1.0f, 1.0f) * 8388607.0f));
+        destination[3 * i] = static_cast<uint8_t>(value >> 16);
+        destination[3 * i + 1] = static_cast<uint8_t>(value >> 8);
+        destination[3 * i + 2] = static_cast<uint8_t>(value);
+      }
+      break;
+    case eNetworkCodec::Float32:
+    default:
+      for (size_t i = 0; i < n; i++)
+      {
+        put_u32(destination + 4 * i, std::bit_cast<uint32_t>(source[i]));
+      }
+      break;
+  }
+}
+
+void decode_samples(eNetworkCodec codec, const uint8_t *source, size_t n, float *destination) noexcept
+{
+  switch (codec)
+  {
+    case eNetworkCodec::Pcm16:
+      for (size_t i = 0; i < n; i++)
+      {
+        destination[i] = static_cast<float>(static_cast<int16_t>(get_u16(source + 2 * i))) / 32768.0f;
+      }
+      break;
+    case eNetworkCodec::Pcm24:
+      for (size_t i = 0; i < n; i++)
+      {
+        // Place the 24 bits at the top of an int32 so the sign extends, then scale back down
+        const uint32_t bits = (static_cast<uint32_t>(source[3 * i]) << 24) | (static_cast<uint32_t>(source[3 * i + 1]) << 16) |
+                              (static_cast<uint32_t>(source[3 * i + 2]) << 8);
+        destination[i] = static_cast<float>(static_cast<int32_t>(bits)) / 2147483648.0f;
+      }
+      break;
+    case eNetworkCodec::Float32:
+    default:
+      for (size_t i = 0; i < n; i++)
+      {
+        destination[i] = std::bit_cast<float>(get_u32(source + 4 * i));
+      }
+      break;
+  }
+}
+
+/** @brief Returns an error message if a stream format cannot be sent or received, else an empty string. */
+std::string check_format(const NetworkStreamConfig &network, const framework::StreamConfig &config)
+{
+  if (network.channels == 0 || network.sample_rate == 0 || network.packet_frames == 0 ||
+      network.queue_packets == 0 || network.batch_packets == 0 || config.frames_per_buffer == 0)
+  {
+    return "Invalid stream format. " + network.to_string() + ", FramesPerBuffer=" + std::to_string(config.frames_per_buffer);
+  }
+
+  const size_t payload = static_cast<size_t>(network.packet_frames) * network.channels * get_bytes_per_sample(network.codec);
+  if (payload > MAX_RTP_PAYLOAD_SIZE)
+  {
+    return "A packet of " + std::to_string(network.packet_frames) + " frames takes " + std::to_string(payload) +
+           " bytes, more than the " + std::to_string(MAX_RTP_PAYLOAD_SIZE) + " an Ethernet frame carries. Lower packet_frames";
+  }
+  return "";
+}
+
+} // namespace
+
+// =============================================================================
+// NetworkSender
+// =============================================================================
+
+NetworkSender::~NetworkSender()
+{
+  close_stream();
+}
+
+bool NetworkSender::open_stream(const NetworkStreamConfig &network, const framework::StreamConfig &config)
+{
+  if (is_stream_open())
+  {
+    LOG_ERROR("NetworkSender: open_stream - A stream is already open.");
+    return false;
+  }
+
+  if (!p_audio_graph)
+  {
+    LOG_ERROR("NetworkSender: open_stream - A network output needs an AudioGraph to render.");
+    return false;
+  }
+
+  const std::string format_error = check_format(network, config);
+  if (!format_error.empty())
+  {
+    LOG_ERROR("NetworkSender: open_stream - ", format_error);
+    return false;
+  }
+
+  sockaddr_in destination{};
+  if (!resolve(network.address, network.port, destination))
+  {
+    LOG_ERROR("NetworkSender: open_stream - Cannot resolve ", network.address);
+    return false;
+  }
+
+  SocketHandle socket = open_udp_socket();
+  if (socket == INVALID_SOCKET_HANDLE)
+  {
+    LOG_ERROR("NetworkSender: open_stream - Cannot create a UDP socket: ", get_socket_error());
+    return false;
+  }
+
+  // Connecting fixes the destination, so every send skips the route lookup
+  if (::connect(to_native(socket), reinterpret_cast<const sockaddr *>(&destination), sizeof(destination)) != 0)
+  {
+    LOG_ERROR("NetworkSender: open_stream - Cannot connect to ", network.address, ":", network.port, ": ", get_socket_error());
+    close_socket(socket);
+    return false;
+  }
+  if (!set_option(socket, IPPROTO_IP, IP_TOS, MEDIA_TOS))
+  {
+    LOG_DEBUG("NetworkSender: open_stream - Could not mark packets as media traffic");
+  }
+
+  m_network = network;
+  m_network.batch_packets = std::min(network.batch_packets, MAX_BATCH_PACKETS);
+  m_frames_per_buffer = config.frames_per_buffer;
+  m_payload_size = static_cast<size_t>(network.packet_frames) * network.channels * get_bytes_per_sample(network.codec);
+
+  const uint32_t packet_count = std::bit_ceil(network.queue_packets);
+  m_packets.allocate(packet_count, 1, network.packet_frames * network.channels);
+  p_free_packets = std::make_unique<framework::RingBuffer<uint32_t>>(packet_count);
+  p_full_packets = std::make_unique<framework::RingBuffer<PacketRef>>(packet_count);
+  for (uint32_t i = 0; i < packet_count; i++)
+  {
+    p_free_packets->try_push(i);
+  }
+  m_batch.assign(m_network.batch_packets, PacketRef{});
+  m_datagrams.assign(static_cast<size_t>(m_network.batch_packets) * (RTP_HEADER_SIZE + m_payload_size), 0);
+  m_datagram_sizes.assign(m_network.batch_packets, 0);
+
+  // RFC 3550 starts the sequence number and timestamp at random values
+  std::random_device random;
+  m_ssrc = random();
+  m_sequence = static_cast<uint16_t>(random());
+  m_timestamp = random();
+  m_first_packet = true;
+  m_error_logged = false;
+  m_current_packet = NO_PACKET;
+  m_current_frames = 0;
+  m_output.assign(static_cast<size_t>(m_frames_per_buffer) * network.channels, 0.0f);
+
+  m_callback_params.direction = framework::eInputOutputDirection::Output;
+  m_callback_params.buffer = nullptr;
+  m_callback_params.n_channels = network.channels;
+  m_callback_params.n_input_channels = 0;
+  m_callback_params.sample_rate = network.sample_rate;
+  m_callback_params.format_kernels = nullptr;
+  m_callback_params.underrun_count.store(0, std::memory_order_relaxed);
+  m_packets_sent.store(0, std::memory_order_relaxed);
+  m_packets_dropped.store(0, std::memory_order_relaxed);
+  m_send_errors.store(0, std::memory_order_relaxed);
+  m_missed_periods.store(0, std::memory_order_relaxed);
+
+  m_latency_frames = static_cast<unsigned long long>(m_frames_per_buffer) + network.packet_frames;
+  if (p_statistics)
+  {
+    p_statistics->record_latency(m_latency_frames, network.sample_rate);
+  }
+
+  m_socket = socket;
+  p_sender_thread = std::make_unique<std::jthread>([this](std::stop_token stop_token) { send(stop_token); });
+  p_render_thread = std::make_unique<std::jthread>([this](std::stop_token stop_token) { render(stop_token); });
+
+  LOG_INFO("NetworkSender: open_stream - Streaming to ", network.address, ":", network.port, ". ",
+           m_network.to_string(), ", FramesPerBuffer=", m_frames_per_buffer);
+  return true;
+}
+
+bool NetworkSender::close_stream()
+{
+  if (!is_stream_open())
+  {
+    return true;
+  }
+
+  if (p_render_thread)
+  {
+    p_render_thread->request_stop();
+    p_render_thread->join();
+    p_render_thread.reset();
+  }
+
+  // The sender sends every queued packet before it observes the stop request
+  if (p_sender_thread)
+  {
+    p_sender_thread->request_stop();
+    notify(m_data_pending, m_data_signal);
+    p_sender_thread->join();
+    p_sender_thread.reset();
+  }
+
+  close_socket(m_socket);
+  LOG_INFO("NetworkSender: close_stream - Closed stream to ", m_network.address, ":", m_network.port, ". Sent=",
+           get_packets_sent(), ", Dropped=", get_packets_dropped(), ", SendErrors=", get_send_errors(),
+           ", MissedPeriods=", get_missed_periods());
+  return true;
+}
+
+bool NetworkSender::set_audio_graph(const std::shared_ptr<dataplane::AudioGraph> &graph)
+{
+  if (is_stream_open())
+  {
+    LOG_ERROR("NetworkSender: set_audio_graph - Cannot change the AudioGraph while the stream is open.");
+    return false;
+  }
+
+  p_audio_graph = graph;
+  m_callback_params.graph = graph.get();
+  return true;
+}
+
+bool NetworkSender::set_statistics(const framework::StreamStatisticsPtr &statistics)
+{
+  if (is_stream_open())
+  {
+    LOG_ERROR("NetworkSender: set_statistics - Cannot change the StreamStatistics while the stream is open.");
+    return false;
+  }
+
+  p_statistics = statistics;
+  m_callback_params.statistics = statistics.get();
+  return true;
+}
+
+/** @brief The network output's clock: render one block per period through the audio callback and queue it.
+ *  A block finished after the next period started delays the stream; the periods it missed are skipped
+ *  and the next callback is flagged as an xrun, as on the SyntheticAudioAdapter.
+ */
+void NetworkSender::render(std::stop_token stop_token)
+{
+  framework::threading::register_current_thread("NetworkRender", framework::eThreadClass::Audio);
+  framework::realtime_memory::prefault_stack();
+
+  const unsigned int n_frames = m_frames_per_buffer;
+  const auto period = std::chrono::nanoseconds(static_cast<uint64_t>(n_frames) * 1000000000ull / m_network.sample_rate);
+
+  AudioStreamStatus status = 0;
+  double stream_time = 0.0;
+  auto period_start = Clock::now();
+  while (!stop_token.stop_requested())
+  {
+    wait_until(period_start);
+
+    const int result = AudioCallbackHandler::audio_callback(m_output.data(), nullptr, n_frames, stream_time, status, &m_callback_params);
+    if (result != 0)
+    {
+      LOG_WARNING("NetworkSender: render - Audio callback stopped the stream. Result=", result);
+      break;
+    }
+    queue(m_output.data(), n_frames);
+
+    period_start += period;
+    stream_time += std::chrono::duration<double>(period).count();
+    status = 0;
+    const auto finished = Clock::now();
+    if (finished > period_start + MAX_RENDER_CATCH_UP)
+    {
+      const auto missed = (finished - period_start) / period + 1;
+      m_missed_periods.fetch_add(static_cast<unsigned long long>(missed), std::memory_order_relaxed);
+      period_start += period * missed;
+      stream_time += std::chrono::duration<double>(period * missed).count();
+      status = RTAUDIO_OUTPUT_UNDERFLOW;
+    }
+  }
+}
+
+void NetworkSender::queue(const float *samples, unsigned int frames) noexcept
+{
+  const unsigned int channels = m_network.channels;
+  const unsigned int packet_frames = m_network.packet_frames;
+
+  unsigned int done = 0;
+  while (done < frames)
+  {
+    if (m_current_packet == NO_PACKET && m_current_frames == 0)
+    {
+      // With every packet in flight the packet's frames are counted off without a copy
+      if (!p_free_packets->try_pop(m_current_packet))
+      {
+        m_current_packet = NO_PACKET;
+        m_packets_dropped.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    const unsigned int count = std::min(frames - done, packet_frames - m_current_frames);
+    if (m_current_packet != NO_PACKET)
+    {
+      std::copy_n(samples + static_cast<size_t>(done) * channels, static_cast<size_t>(count) * channels,
+                  get_packet(m_current_packet) + static_cast<size_t>(m_current_frames) * channels);
+    }
+    m_current_frames += count;
+    done += count;
+
+    if (m_current_frames == packet_frames)
+    {
+      if (m_current_packet != NO_PACKET)
+      {
+        // Never fails, the full queue has room for every packet of the pool
+        p_full_packets->try_push(PacketRef{m_current_packet, m_sequence, m_timestamp});
+        notify(m_data_pending, m_data_signal);
+      }
+      m_sequence++;
+      m_timestamp += packet_frames;
+      m_current_packet = NO_PACKET;
+      m_current_frames = 0;
+    }
+  }
+}
+
+void NetworkSender::send(std::stop_token stop_token)
+{
+  framework::threading::register_current_thread("NetworkSender", framework::eThreadClass::Io);
+
+  while (true)
+  {
+    // Sample the stop flag before draining so packets queued before close_stream() are still sent
+    const bool stopping = stop_token.stop_requested();
+
+    size_t count = 0;
+    while (count < m_batch.size() && p_full_packets->try_pop(m_batch[count]))
+    {
+      m_datagram_sizes[count] = encode(m_batch[count], m_datagrams.data() + count * (RTP_HEADER_SIZE + m_payload_size));
+      count++;
+    }
+
+    if (count > 0)
+    {
+      TRACE_SCOPE_ID("NetworkSendBatch", count);
+      send_batch(count);
+      for (size_t i = 0; i < count; i++)
+      {
+        p_free_packets->try_push(m_batch[i].index);
+      }
+      continue;
+    }
+
+    if (stopping)
+    {
+      return;
+    }
+
+    wait(m_data_pending, m_data_signal);
+  }
+}
+
+size_t NetworkSender::encode(const PacketRef &packet, uint8_t *datagram) noexcept
+{
+  // RTP header, RFC 3550: version 2, no padding, extension or CSRCs. The marker flags the first packet
+  datagram[0] = RTP_VERSION << 6;
+  datagram[1] = static_cast<uint8_t>((m_first_packet ? 0x80 : 0x00) | (m_network.payload_type & 0x7F));
+  put_u16(datagram + 2, packet.sequence);
+  put_u32(datagram + 4, packet.timestamp);
+  put_u32(datagram + 8, m_ssrc);
+  m_first_packet = false;
+
+  encode_samples(m_network.codec, get_packet(packet.index),
+                 static_cast<size_t>(m_network.packet_frames) * m_network.channels, datagram + RTP_HEADER_SIZE);
+  return RTP_HEADER_SIZE + m_payload_size;
+}
+
+void NetworkSender::send_batch(size_t count)
+{
+  const size_t stride = RTP_HEADER_SIZE + m_payload_size;
+  size_t sent = 0;
+  size_t failed = 0;
+
+#ifdef PLATFORM_LINUX
+  std::array<iovec, MAX_BATCH_PACKETS> vectors{};
+  std::array<mmsghdr, MAX_BATCH_PACKETS> messages{};
+  for (size_t i = 0; i < count; i++)
+  {
+    vectors[i].iov_base = m_datagrams.data() + i * stride;
+    vectors[i].iov_len = m_datagram_sizes[i];
+    messages[i].msg_hdr.msg_iov = &vectors[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  // One system call for the batch. A datagram the kernel refuses, e.g. after an ICMP port unreachable, is skipped
+  while (sent + failed < count)
+  {
+    const int result = ::sendmmsg(to_native(m_socket), messages.data() + sent + failed,
+                                  static_cast<unsigned int>(count - sent - failed), 0);
+    if (result > 0)
+    {
+      sent += static_cast<size_t>(result);
+    }
+    else if (errno != EINTR)
+    {
+      failed++;
+    }
+  }
+#else
+  for (size_t i = 0; i < count; i++)
+  {
+    const auto result = ::send(to_native(m_socket), reinterpret_cast<const char *>(m_datagrams.data() + i * stride),
+                               static_cast<int>(m_datagram_sizes[i]), 0);
+    if (result == static_cast<decltype(result)>(m_datagram_sizes[i]))
+    {
+      sent++;
+    }
+    else
+    {
+      failed++;
+    }
+  }
+#endif
+
+  m_packets_sent.fetch_add(sent, std::memory_order_relaxed);
+  if (failed > 0)
+  {
+    m_send_errors.fetch_add(failed, std::memory_order_relaxed);
+    if (!m_error_logged)
+    {
+      LOG_WARNING("NetworkSender: send - Failed to send to ", m_network.address, ":", m_network.port, ": ", get_socket_error());
+      m_error_logged = true;
+    }
+  }
+}
+
+// =============================================================================
+// NetworkReceiver
+// =============================================================================
+
+NetworkReceiver::~NetworkReceiver()
+{
+  close_stream();
+}
+
+bool NetworkReceiver::open_stream(const NetworkStreamConfig &network, const framework::StreamConfig &config)
+{
+  if (is_stream_open())
+  {
+    LOG_ERROR("NetworkReceiver: open_stream - A stream is already open.");
+    return false;
+  }
+
+  const std::string format_error = check_format(network, config);
+  if (!format_error.empty())
+  {
+    LOG_ERROR("NetworkReceiver: open_stream - ", format_error);
+    return false;
+  }
+
+  sockaddr_in local{};
+  if (!resolve(network.address, network.port, local))
+  {
+    LOG_ERROR("NetworkReceiver: open_stream - Cannot resolve ", network.address);
+    return false;
+  }
+
+  JitterBuffer::Config jitter_config;
+  jitter_config.channels = network.channels;
+  jitter_config.packet_frames = network.packet_frames;
+  jitter_config.sample_rate = network.sample_rate;
+  jitter_config.capacity_packets = network.queue_packets;
+  jitter_config.max_read_frames = config.frames_per_buffer;
+  jitter_config.min_delay_ms = network.min_delay_ms;
+  jitter_config.max_delay_ms = network.max_delay_ms;
+  auto jitter_buffer = std::make_shared<JitterBuffer>();
+  if (!jitter_buffer->prepare(jitter_config))
+  {
+    return false;
+  }
+
+  SocketHandle socket = open_udp_socket();
+  if (socket == INVALID_SOCKET_HANDLE)
+  {
+    LOG_ERROR("NetworkReceiver: open_stream - Cannot create a UDP socket: ", get_socket_error());
+    return false;
+  }
+
+  // A multicast group is joined on a socket bound to every interface
+  const bool multicast = IN_MULTICAST(ntohl(local.sin_addr.s_addr));
+  const in_addr group = local.sin_addr;
+  if (multicast)
+  {
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+  }
+
+  set_option(socket, SOL_SOCKET, SO_REUSEADDR, 1);
+  if (::bind(to_native(socket), reinterpret_cast<const sockaddr *>(&local), sizeof(local)) != 0)
+  {
+    LOG_ERROR("NetworkReceiver: open_stream - Cannot listen on ", network.address, ":", network.port, ": ", get_socket_error());
+    close_socket(socket);
+    return false;
+  }
+
+  if (multicast)
+  {
+    ip_mreq membership{};
+    membership.imr_multiaddr = group;
+    membership.imr_interface.s_addr = htonl(INADDR_ANY);
+    if (!set_option(socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, membership))
+    {
+      LOG_ERROR("NetworkReceiver: open_stream - Cannot join multicast group ", network.address, ": ", get_socket_error());
+      close_socket(socket);
+      return false;
+    }
+  }
+
+  set_receive_timeout(socket, THREAD_WAIT_TIMEOUT);
+  if (!set_option(socket, SOL_SOCKET, SO_RCVBUF, RECEIVE_BUFFER_BYTES))
+  {
+    LOG_DEBUG("NetworkReceiver: open_stream - Could not enlarge the receive buffer");
+  }
+#ifdef PLATFORM_LINUX
+  if (!set_option(socket, SOL_SOCKET, SO_TIMESTAMPNS, 1))
+  {
+    LOG_DEBUG("NetworkReceiver: open_stream - Kernel receive timestamps are unavailable, timestamping on the receive thread");
+  }
+#endif
+
+  m_network = network;
+  m_network.batch_packets = std::min(network.batch_packets, MAX_BATCH_PACKETS);
+  m_datagrams.assign(static_cast<size_t>(m_network.batch_packets) * DATAGRAM_CAPACITY, 0);
+  m_decoded.assign(static_cast<size_t>(network.packet_frames) * network.channels, 0.0f);
+  m_has_sender = false;
+  m_packets_invalid.store(0, std::memory_order_relaxed);
+  p_jitter_buffer = jitter_buffer;
+
+  m_socket = socket;
+  p_receive_thread = std::make_unique<std::jthread>([this](std::stop_token stop_token) { receive(stop_token); });
+
+  LOG_INFO("NetworkReceiver: open_stream - Listening on ", network.address, ":", network.port, ". ", m_network.to_string());
+  return true;
+}
+
+bool NetworkReceiver::close_stream()
+{
+  if (!is_stream_open())
+  {
+    return true;
+  }
+
+  if (p_receive_thread)
+  {
+    p_receive_thread->request_stop();
+    p_receive_thread->join();
+    p_receive_thread.reset();
+  }
+
+  close_socket(m_socket);
+  LOG_INFO("NetworkReceiver: close_stream - Closed stream on ", m_network.address, ":", m_network.port,
+           ". Received=", p_jitter_buffer->get_received_packets(), ", Lost=", p_jitter_buffer->get_lost_packets(),
+           ", Late=", p_jitter_buffer->get_late_packets(), ", Invalid=", get_packets_invalid());
+  return true;
+}
+
+void NetworkReceiver::receive(std::stop_token stop_token)
+{
+  framework::threading::register_current_thread("NetworkReceiver", framework::eThreadClass::Io);
+
+#ifdef PLATFORM_LINUX
+  const unsigned int batch = m_network.batch_packets;
+  std::array<iovec, MAX_BATCH_PACKETS> vectors{};
+  std::array<mmsghdr, MAX_BATCH_PACKETS> messages{};
+  std::array<std::array<char, CMSG_SPACE(sizeof(timespec))>, MAX_BATCH_PACKETS> controls{};
+
+  while (!stop_token.stop_requested())
+  {
+    for (unsigned int i = 0; i < batch; i++)
+    {
+      vectors[i].iov_base = m_datagrams.data() + i * DATAGRAM_CAPACITY;
+      vectors[i].iov_len = DATAGRAM_CAPACITY;
+      messages[i].msg_hdr = msghdr{};
+      messages[i].msg_hdr.msg_iov = &vectors[i];
+      messages[i].msg_hdr.msg_iovlen = 1;
+      messages[i].msg_hdr.msg_control = controls[i].data();
+      messages[i].msg_hdr.msg_controllen = controls[i].size();
+    }
+
+    // Blocks until at least one datagram arrives or the receive timeout passes, then takes what is queued
+    const int count = ::recvmmsg(to_native(m_socket), messages.data(), batch, MSG_WAITFORONE, nullptr);
+    if (count <= 0)
+    {
+      continue;
+    }
+
+    TRACE_SCOPE_ID("NetworkReceiveBatch", count);
+    const uint64_t received_ns = now_ns();
+    for (int i = 0; i < count; i++)
+    {
+      uint64_t arrival_ns = received_ns;
+      for (cmsghdr *control = CMSG_FIRSTHDR(&messages[i].msg_hdr); control != nullptr;
+           control = CMSG_NXTHDR(&messages[i].msg_hdr, control))
+      {
+        if (control->cmsg_level == SOL_SOCKET && control->cmsg_type == SCM_TIMESTAMPNS)
+        {
+          timespec stamp;
+          std::memcpy(&stamp, CMSG_DATA(control), sizeof(stamp));
+          arrival_ns = static_cast<uint64_t>(stamp.tv_sec) * 1000000000ull + static_cast<uint64_t>(stamp.tv_nsec);
+        }
+      }
+      const bool truncated = (messages[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+      handle_datagram(m_datagrams.data() + i * DATAGRAM_CAPACITY, truncated ? 0 : messages[i].msg_len, arrival_ns);
+    }
+  }
+#else
+  while (!stop_token.stop_requested())
+  {
+    const auto size = ::recv(to_native(m_socket), reinterpret_cast<char *>(m_datagrams.data()),
+                             static_cast<int>(DATAGRAM_CAPACITY), 0);
+    if (size > 0)
+    {
+      handle_datagram(m_datagrams.data(), static_cast<size_t>(size), now_ns());
+    }
+  }
+#endif
+}
+
+void NetworkReceiver::handle_datagram(const uint8_t *data, size_t size, uint64_t arrival_ns)
+{
+  auto reject = [this]() { m_packets_invalid.fetch_add(1, std::memory_order_relaxed); };
+
+  if (size < RTP_HEADER_SIZE || (data[0] >> 6) != RTP_VERSION || (data[1] & 0x7F) != m_network.payload_type)
+  {
+    reject();
+    return;
+  }
+
+  const bool padding = (data[0] & 0x20) != 0;
+  const bool extension = (data[0] & 0x10) != 0;
+  const size_t csrc_count = data[0] & 0x0F;
+  const uint16_t sequence = get_u16(data + 2);
+  const uint32_t timestamp = get_u32(data + 4);
+  const uint32_t ssrc = get_u32(data + 8);
+
+  // Skip the CSRCs and a header extension, and drop trailing padding
+  size_t begin = RTP_HEADER_SIZE + 4 * csrc_count;
+  if (extension)
+  {
+    begin = begin + 4 <= size ? begin + 4 + 4 * static_cast<size_t>(get_u16(data + begin + 2)) : size + 1;
+  }
+  const size_t end = padding ? size - std::min<size_t>(data[size - 1], size) : size;
+
+  const size_t frame_bytes = static_cast<size_t>(m_network.channels) * get_bytes_per_sample(m_network.codec);
+  const size_t payload = end > begin ? end - begin : 0;
+  const size_t frames = payload / frame_bytes;
+  if (payload == 0 || payload % frame_bytes != 0 || frames > m_network.packet_frames)
+  {
+    reject();
+    return;
+  }
+
+  if (!m_has_sender || ssrc != m_ssrc)
+  {
+    if (m_has_sender && arrival_ns - m_last_packet_ns < SENDER_TIMEOUT_NS)
+    {
+      reject();
+      return;
+    }
+    if (m_has_sender)
+    {
+      p_jitter_buffer->restart();
+    }
+    m_has_sender = true;
+    m_ssrc = ssrc;
+    LOG_INFO("NetworkReceiver: receive - Following sender ", ssrc, " on port ", m_network.port);
+  }
+  m_last_packet_ns = arrival_ns;
+
+  decode_samples(m_network.codec, data + begin, frames * m_network.channels, m_decoded.data());
+  p_jitter_buffer->push(sequence, timestamp, m_decoded.data(), static_cast<unsigned int>(frames), arrival_ns);
+}
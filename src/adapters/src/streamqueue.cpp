@@ -0,0 +1,124 @@
+#include "streamqueue.h"
+
+#include <algorithm>
+
+using namespace miniaudioengine::adapters;
+
+void StreamQueue::add(FileStream *stream)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto entry = std::make_unique<Entry>();
+    entry->stream = stream;
+    m_entries.push_back(std::move(entry));
+  }
+  wake();
+}
+
+void StreamQueue::remove(FileStream *stream)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto it = std::find_if(m_entries.begin(), m_entries.end(), [stream](const std::unique_ptr<Entry> &e) { return e->stream == stream; });
+  if (it == m_entries.end())
+  {
+    return;
+  }
+
+  // The entry stays in the list while a thread fills it, so it is erased only once released
+  Entry *entry = it->get();
+  m_released.wait(lock, [entry] { return !entry->busy; });
+  std::erase_if(m_entries, [entry](const std::unique_ptr<Entry> &e) { return e.get() == entry; });
+}
+
+void StreamQueue::wake() noexcept
+{
+  // Idle streams are checked again right away; the next acquire() clears their idle time
+  m_wake_requests.fetch_add(1, std::memory_order_release);
+  m_wake.notify_all();
+}
+
+size_t StreamQueue::size() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_entries.size();
+}
+
+bool StreamQueue::acquire(std::stop_token stop_token, size_t max_streams, std::vector<FileStream *> &streams)
+{
+  streams.clear();
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  while (!stop_token.stop_requested())
+  {
+    const uint64_t wake_requests = m_wake_requests.load(std::memory_order_acquire);
+    if (wake_requests != m_cleared_requests)
+    {
+      for (const std::unique_ptr<Entry> &entry : m_entries)
+      {
+        entry->idle_until = {};
+      }
+      m_cleared_requests = wake_requests;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    auto wake_at = now + POLL_INTERVAL;
+    m_due.clear();
+    for (const std::unique_ptr<Entry> &entry : m_entries)
+    {
+      if (entry->busy)
+      {
+        continue;
+      }
+      if (entry->idle_until > now)
+      {
+        wake_at = std::min(wake_at, entry->idle_until);
+        continue;
+      }
+
+      // Only threads holding the lock read an unclaimed stream's producer state
+      entry->deadline = entry->stream->get_deadline_seconds();
+      m_due.push_back(entry.get());
+    }
+
+    if (m_due.empty())
+    {
+      m_wake.wait_until(lock, stop_token, wake_at, [this, wake_requests] {
+        return m_wake_requests.load(std::memory_order_acquire) != wake_requests;
+      });
+      continue;
+    }
+
+    const size_t count = std::min(max_streams, m_due.size());
+    std::partial_sort(m_due.begin(), m_due.begin() + static_cast<std::ptrdiff_t>(count), m_due.end(),
+                      [](const Entry *a, const Entry *b) { return a->deadline < b->deadline; });
+    for (size_t i = 0; i < count; ++i)
+    {
+      m_due[i]->busy = true;
+      streams.push_back(m_due[i]->stream);
+    }
+    return true;
+  }
+
+  return false;
+}
+
+void StreamQueue::release(FileStream *stream, FileStream::eFillStep step)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = std::find_if(m_entries.begin(), m_entries.end(), [stream](const std::unique_ptr<Entry> &e) { return e->stream == stream; });
+    if (it != m_entries.end())
+    {
+      (*it)->busy = false;
+      if (step == FileStream::eFillStep::Idle)
+      {
+        (*it)->idle_until = std::chrono::steady_clock::now() + POLL_INTERVAL;
+      }
+      else if (step == FileStream::eFillStep::Waiting)
+      {
+        (*it)->idle_until = std::chrono::steady_clock::now() + SEEK_POLL_INTERVAL;
+      }
+    }
+  }
+  m_released.notify_all();
+}
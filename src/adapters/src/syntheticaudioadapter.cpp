@@ -0,0 +1,256 @@
+#include "syntheticaudioadapter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+using namespace miniaudioengine;
+using namespace miniaudioengine::adapters;
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+/** @brief Sleeping overshoots by up to a scheduler tick, so sleep until shortly before the deadline and spin the rest. */
+constexpr std::chrono::microseconds SPIN_MARGIN{200};
+
+void wait_until(Clock::time_point deadline)
+{
+  if (deadline - Clock::now() > SPIN_MARGIN)
+  {
+    std::this_thread::sleep_until(deadline - SPIN_MARGIN);
+  }
+  while (Clock::now() < deadline)
+  {
+  }
+}
+
+} // namespace
+
+std::string SyntheticDeviceConfig::to_string() const
+{
+  return "SyntheticDeviceConfig(OutputChannels=" + std::to_string(output_channels) +
+         ", InputChannels=" + std::to_string(input_channels) +
+         ", PreferredSampleRate=" + std::to_string(preferred_sample_rate) +
+         ", JitterUs=" + std::to_string(jitter_us) +
+         ", LoadPercent=" + std::to_string(load_percent) +
+         ", Seed=" + std::to_string(seed) + ")";
+}
+
+SyntheticAudioAdapter::~SyntheticAudioAdapter()
+{
+  close_stream();
+}
+
+bool SyntheticAudioAdapter::open_stream(const SyntheticDeviceConfig &device, const framework::BufferPtr &buffer,
+                                        const framework::eInputOutputDirection &direction,
+                                        const framework::StreamConfig &config)
+{
+  if (m_open)
+  {
+    LOG_ERROR("SyntheticAudioAdapter: open_stream - A stream is already open.");
+    return false;
+  }
+
+  const unsigned int sample_rate = config.sample_rate > 0 ? config.sample_rate : device.preferred_sample_rate;
+  unsigned int channels = 0;
+  unsigned int input_channels = 0;
+  switch (direction)
+  {
+    case framework::eInputOutputDirection::Input:
+      channels = device.input_channels;
+      break;
+    case framework::eInputOutputDirection::Output:
+      channels = device.output_channels;
+      break;
+    case framework::eInputOutputDirection::Duplex:
+      channels = device.output_channels;
+      input_channels = device.input_channels;
+      if (input_channels == 0)
+      {
+        LOG_ERROR("SyntheticAudioAdapter: open_stream - Device has no input channels for a duplex stream.");
+        return false;
+      }
+      if (!p_audio_graph && !p_stream_mixer)
+      {
+        LOG_ERROR("SyntheticAudioAdapter: open_stream - A duplex stream needs an AudioGraph to render its input.");
+        return false;
+      }
+      break;
+    default:
+      LOG_ERROR("SyntheticAudioAdapter: open_stream - Cannot open stream unless direction is Input, Output or Duplex: ", direction);
+      return false;
+  }
+
+  if (channels == 0 || sample_rate == 0 || config.frames_per_buffer == 0)
+  {
+    LOG_ERROR("SyntheticAudioAdapter: open_stream - Invalid stream format. Channels=", channels,
+              ", SampleRate=", sample_rate, ", FramesPerBuffer=", config.frames_per_buffer);
+    return false;
+  }
+  if (config.device_format != framework::eSampleFormat::Float32)
+  {
+    LOG_WARNING("SyntheticAudioAdapter: open_stream - The synthetic device is Float32, ignoring ",
+                framework::to_string(config.device_format));
+  }
+
+  const bool is_input = direction == framework::eInputOutputDirection::Input;
+  m_device = device;
+  m_device.load_percent = std::clamp(device.load_percent, 0.0, 100.0);
+  m_frames_per_buffer = config.frames_per_buffer;
+  m_output.assign(is_input ? 0 : static_cast<size_t>(m_frames_per_buffer) * channels, 0.0f);
+  m_input.assign(static_cast<size_t>(m_frames_per_buffer) * (is_input ? channels : input_channels), 0.0f);
+  m_input_phase = 0.0;
+
+  m_callback_params.direction = direction;
+  m_callback_params.buffer = buffer;
+  m_callback_params.n_channels = channels;
+  m_callback_params.n_input_channels = input_channels;
+  m_callback_params.sample_rate = sample_rate;
+  m_callback_params.format_kernels = nullptr;
+  m_callback_params.underrun_count.store(0, std::memory_order_relaxed);
+  m_callback_count.store(0, std::memory_order_relaxed);
+  m_missed_periods.store(0, std::memory_order_relaxed);
+
+  m_latency_frames = 2ull * m_frames_per_buffer;
+  if (p_statistics)
+  {
+    p_statistics->record_latency(m_latency_frames, sample_rate);
+  }
+
+  m_open = true;
+  p_thread = std::make_unique<std::jthread>([this](std::stop_token stop_token) { run(stop_token); });
+
+  LOG_INFO("SyntheticAudioAdapter: open_stream - Opened synthetic stream. Channels=", channels, ", SampleRate=",
+           sample_rate, ", FramesPerBuffer=", m_frames_per_buffer, ", ", m_device.to_string());
+  return true;
+}
+
+bool SyntheticAudioAdapter::close_stream()
+{
+  stop_stream();
+  m_open = false;
+  return true;
+}
+
+bool SyntheticAudioAdapter::stop_stream()
+{
+  if (p_thread)
+  {
+    p_thread->request_stop();
+    p_thread->join();
+    p_thread.reset();
+  }
+  return true;
+}
+
+bool SyntheticAudioAdapter::set_audio_graph(const std::shared_ptr<dataplane::AudioGraph> &graph)
+{
+  if (m_open)
+  {
+    LOG_ERROR("SyntheticAudioAdapter: set_audio_graph - Cannot change the AudioGraph while the stream is open.");
+    return false;
+  }
+
+  p_audio_graph = graph;
+  m_callback_params.graph = graph.get();
+  return true;
+}
+
+bool SyntheticAudioAdapter::set_stream_mixer(const std::shared_ptr<dataplane::StreamMixer> &mixer)
+{
+  if (m_open)
+  {
+    LOG_ERROR("SyntheticAudioAdapter: set_stream_mixer - Cannot change the StreamMixer while the stream is open.");
+    return false;
+  }
+
+  p_stream_mixer = mixer;
+  m_callback_params.mixer = mixer.get();
+  return true;
+}
+
+bool SyntheticAudioAdapter::set_statistics(const framework::StreamStatisticsPtr &statistics)
+{
+  if (m_open)
+  {
+    LOG_ERROR("SyntheticAudioAdapter: set_statistics - Cannot change the StreamStatistics while the stream is open.");
+    return false;
+  }
+
+  p_statistics = statistics;
+  m_callback_params.statistics = statistics.get();
+  return true;
+}
+
+/** @brief The simulated device: wake once per period, burn the injected load, then run the callback.
+ *  Callback k starts at period k and must finish before period k + 1, when the device plays its block.
+ */
+void SyntheticAudioAdapter::run(std::stop_token stop_token)
+{
+  const unsigned int n_frames = m_frames_per_buffer;
+  const auto period = std::chrono::nanoseconds(static_cast<uint64_t>(n_frames) * 1000000000ull / m_callback_params.sample_rate);
+  const auto load = std::chrono::duration_cast<Clock::duration>(period * (m_device.load_percent / 100.0));
+  std::mt19937 random(m_device.seed);
+  std::uniform_int_distribution<unsigned int> jitter(0, m_device.jitter_us);
+
+  const bool is_input = m_callback_params.direction == framework::eInputOutputDirection::Input;
+  const AudioStreamStatus late_status = is_input ? RTAUDIO_INPUT_OVERFLOW : RTAUDIO_OUTPUT_UNDERFLOW;
+  float *output = m_output.empty() ? nullptr : m_output.data();
+  float *input = m_input.empty() ? nullptr : m_input.data();
+
+  AudioStreamStatus status = 0;
+  double stream_time = 0.0;
+  auto period_start = Clock::now();
+  while (!stop_token.stop_requested())
+  {
+    wait_until(period_start + std::chrono::microseconds(m_device.jitter_us > 0 ? jitter(random) : 0));
+
+    const auto load_end = Clock::now() + load;
+    while (Clock::now() < load_end)
+    {
+    }
+
+    if (input != nullptr)
+    {
+      fill_input(n_frames);
+    }
+    const int result = AudioCallbackHandler::audio_callback(output, input, n_frames, stream_time, status, &m_callback_params);
+    m_callback_count.fetch_add(1, std::memory_order_relaxed);
+    if (result != 0)
+    {
+      LOG_WARNING("SyntheticAudioAdapter: run - Audio callback stopped the stream. Result=", result);
+      break;
+    }
+
+    // The block is due when the next period starts. A late block underflows the periods it missed
+    period_start += period;
+    stream_time += std::chrono::duration<double>(period).count();
+    status = 0;
+    const auto finished = Clock::now();
+    if (finished > period_start)
+    {
+      const auto missed = (finished - period_start) / period + 1;
+      m_missed_periods.fetch_add(static_cast<unsigned long long>(missed), std::memory_order_relaxed);
+      period_start += period * missed;
+      stream_time += std::chrono::duration<double>(period * missed).count();
+      status = late_status;
+    }
+  }
+}
+
+/** @brief Capture a -20 dBFS 440 Hz sine on every input channel. */
+void SyntheticAudioAdapter::fill_input(unsigned int n_frames) noexcept
+{
+  const unsigned int channels = static_cast<unsigned int>(m_input.size() / m_frames_per_buffer);
+  const double increment = 2.0 * 3.14159265358979323846 * 440.0 / m_callback_params.sample_rate;
+  for (unsigned int frame = 0; frame < n_frames; frame++)
+  {
+    const float sample = 0.1f * static_cast<float>(std::sin(m_input_phase));
+    std::fill_n(m_input.data() + static_cast<size_t>(frame) * channels, channels, sample);
+    m_input_phase += increment;
+  }
+  m_input_phase = std::fmod(m_input_phase, 2.0 * 3.14159265358979323846);
+}
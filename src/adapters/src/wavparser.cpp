@@ -0,0 +1,119 @@
+#include "wavparser.h"
+#include "logger.h"
+
+#include <array>
+#include <cstring>
+#include <fstream>
+
+using namespace miniaudioengine::adapters;
+
+namespace
+{
+
+constexpr uint16_t WAVE_FORMAT_PCM = 0x0001;
+constexpr uint16_t WAVE_FORMAT_IEEE_FLOAT = 0x0003;
+constexpr uint16_t WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+
+uint16_t read_u16(const unsigned char *bytes)
+{
+  return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+uint32_t read_u32(const unsigned char *bytes)
+{
+  return static_cast<uint32_t>(bytes[0]) |
+         (static_cast<uint32_t>(bytes[1]) << 8) |
+         (static_cast<uint32_t>(bytes[2]) << 16) |
+         (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+WavHeader::eSampleFormat to_sample_format(uint16_t format_tag)
+{
+  switch (format_tag)
+  {
+    case WAVE_FORMAT_PCM:        return WavHeader::eSampleFormat::Pcm;
+    case WAVE_FORMAT_IEEE_FLOAT: return WavHeader::eSampleFormat::Float;
+    default:                     return WavHeader::eSampleFormat::Other;
+  }
+}
+
+} // namespace
+
+std::string WavHeader::to_string() const
+{
+  return "WavHeader(Format=" + std::string(sample_format == eSampleFormat::Pcm ? "PCM" : sample_format == eSampleFormat::Float ? "Float" : "Other") +
+         ", Channels=" + std::to_string(channels) +
+         ", SampleRate=" + std::to_string(sample_rate) +
+         ", BitsPerSample=" + std::to_string(bits_per_sample) +
+         ", DataOffset=" + std::to_string(data_offset) +
+         ", DataSize=" + std::to_string(data_size) + ")";
+}
+
+std::optional<WavHeader> WavParser::parse(const std::filesystem::path &path)
+{
+  std::ifstream stream(path, std::ios::binary);
+  if (!stream)
+  {
+    LOG_WARNING("WavParser: parse - Cannot open ", path.string());
+    return std::nullopt;
+  }
+
+  std::array<unsigned char, 12> riff{};
+  if (!stream.read(reinterpret_cast<char *>(riff.data()), riff.size()) ||
+      std::memcmp(riff.data(), "RIFF", 4) != 0 ||
+      std::memcmp(riff.data() + 8, "WAVE", 4) != 0)
+  {
+    return std::nullopt;
+  }
+
+  WavHeader header;
+  bool found_fmt = false;
+  uint64_t offset = riff.size();
+
+  std::array<unsigned char, 8> chunk{};
+  while (stream.read(reinterpret_cast<char *>(chunk.data()), chunk.size()))
+  {
+    const uint32_t chunk_size = read_u32(chunk.data() + 4);
+    offset += chunk.size();
+
+    if (std::memcmp(chunk.data(), "fmt ", 4) == 0)
+    {
+      std::array<unsigned char, 40> fmt{};
+      const size_t fmt_size = std::min<size_t>(chunk_size, fmt.size());
+      if (fmt_size < 16 || !stream.read(reinterpret_cast<char *>(fmt.data()), fmt_size))
+      {
+        return std::nullopt;
+      }
+
+      uint16_t format_tag = read_u16(fmt.data());
+      header.channels = read_u16(fmt.data() + 2);
+      header.sample_rate = read_u32(fmt.data() + 4);
+      header.block_align = read_u16(fmt.data() + 12);
+      header.bits_per_sample = read_u16(fmt.data() + 14);
+
+      // WAVE_FORMAT_EXTENSIBLE stores the real format tag in the first two bytes of the sub-format GUID
+      if (format_tag == WAVE_FORMAT_EXTENSIBLE && fmt_size >= 26)
+      {
+        format_tag = read_u16(fmt.data() + 24);
+      }
+      header.sample_format = to_sample_format(format_tag);
+      found_fmt = true;
+    }
+    else if (std::memcmp(chunk.data(), "data", 4) == 0)
+    {
+      if (!found_fmt)
+      {
+        return std::nullopt;
+      }
+      header.data_offset = offset;
+      header.data_size = chunk_size;
+      return header;
+    }
+
+    // Chunks are padded to an even number of bytes
+    offset += chunk_size + (chunk_size & 1u);
+    stream.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+  }
+
+  return std::nullopt;
+}
@@ -0,0 +1,236 @@
+#include "wavreader.h"
+#include "dspkernels.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+
+#ifdef PLATFORM_LINUX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace miniaudioengine::adapters;
+
+WavReader::~WavReader()
+{
+  close();
+}
+
+bool WavReader::is_supported(const WavHeader &header)
+{
+  // Samples are used in place, so the host must share the file's byte order
+  if constexpr (std::endian::native != std::endian::little)
+  {
+    return false;
+  }
+
+  if (header.channels == 0 || header.sample_rate == 0)
+  {
+    return false;
+  }
+
+  const bool supported = header.is_pcm(16) || header.is_pcm(24) || header.is_pcm(32) || header.is_float32();
+  return supported && header.block_align == header.channels * (header.bits_per_sample / 8);
+}
+
+bool WavReader::open(const std::filesystem::path &path)
+{
+  close();
+
+  const std::optional<WavHeader> header = WavParser::parse(path);
+  if (!header || !is_supported(*header))
+  {
+    return false;
+  }
+
+  uint64_t file_size = 0;
+#ifdef PLATFORM_LINUX
+  m_fd = ::open(path.string().c_str(), O_RDONLY | O_CLOEXEC);
+  if (m_fd < 0)
+  {
+    LOG_WARNING("WavReader: open - Failed to open ", path.string());
+    return false;
+  }
+
+  struct stat file_stat = {};
+  if (::fstat(m_fd, &file_stat) == 0)
+  {
+    file_size = static_cast<uint64_t>(file_stat.st_size);
+  }
+  ::posix_fadvise(m_fd, static_cast<off_t>(header->data_offset), 0, POSIX_FADV_SEQUENTIAL);
+#else
+  p_file = std::fopen(path.string().c_str(), "rb");
+  if (p_file == nullptr)
+  {
+    LOG_WARNING("WavReader: open - Failed to open ", path.string());
+    return false;
+  }
+
+  std::error_code ec;
+  file_size = std::filesystem::file_size(path, ec);
+#endif
+
+  m_header = *header;
+
+  // Trust the file size over the data chunk size, which streaming writers may leave unset
+  const uint64_t available = file_size > m_header.data_offset ? file_size - m_header.data_offset : 0;
+  m_frames = std::min<uint64_t>(m_header.data_size, available) / m_header.block_align;
+  m_position = 0;
+
+  if (!m_header.is_float32())
+  {
+    m_raw.resize(READ_CHUNK_BYTES - READ_CHUNK_BYTES % m_header.block_align);
+  }
+
+  return true;
+}
+
+void WavReader::close()
+{
+#ifdef PLATFORM_LINUX
+  if (m_fd >= 0)
+  {
+    ::close(m_fd);
+    m_fd = -1;
+  }
+#else
+  if (p_file != nullptr)
+  {
+    std::fclose(p_file);
+    p_file = nullptr;
+  }
+#endif
+  m_frames = 0;
+  m_position = 0;
+}
+
+bool WavReader::is_open() const
+{
+#ifdef PLATFORM_LINUX
+  return m_fd >= 0;
+#else
+  return p_file != nullptr;
+#endif
+}
+
+void WavReader::seek(uint64_t frame)
+{
+  m_position = std::min(frame, m_frames);
+}
+
+size_t WavReader::read_frames(float *destination, size_t frames)
+{
+  const unsigned int channels = m_header.channels;
+  size_t frames_done = 0;
+  while (frames_done < frames)
+  {
+    ReadRequest request;
+    if (!prepare_read(destination + frames_done * channels, frames - frames_done, request))
+    {
+      break;
+    }
+
+    const size_t bytes_read = submit_read(request);
+    frames_done += complete_read(request, bytes_read);
+    if (bytes_read < request.bytes)
+    {
+      break;
+    }
+  }
+
+  return frames_done;
+}
+
+bool WavReader::prepare_read(float *destination, size_t frames, ReadRequest &request)
+{
+  if (!is_open() || m_position >= m_frames || frames == 0)
+  {
+    return false;
+  }
+
+  const unsigned int block_align = m_header.block_align;
+  frames = static_cast<size_t>(std::min<uint64_t>(frames, m_frames - m_position));
+
+  request.offset = m_header.data_offset + m_position * block_align;
+  request.destination = destination;
+#ifdef PLATFORM_LINUX
+  request.fd = m_fd;
+#endif
+
+  // Float files are read straight into the destination, no conversion needed
+  if (m_header.is_float32())
+  {
+    request.buffer = destination;
+    request.bytes = frames * block_align;
+  }
+  else
+  {
+    request.buffer = m_raw.data();
+    request.bytes = std::min(frames, m_raw.size() / block_align) * block_align;
+  }
+  return true;
+}
+
+size_t WavReader::submit_read(const ReadRequest &request)
+{
+  return read_bytes(request.buffer, request.bytes, request.offset);
+}
+
+size_t WavReader::complete_read(const ReadRequest &request, size_t bytes_read)
+{
+  const size_t frames_read = std::min(bytes_read, request.bytes) / m_header.block_align;
+  if (!m_header.is_float32() && frames_read > 0)
+  {
+    const framework::dsp::KernelTable &kernels = framework::dsp::get_kernels();
+    const size_t samples = frames_read * m_header.channels;
+    switch (m_header.bits_per_sample)
+    {
+      case 16:
+        kernels.int16_to_float(request.destination, reinterpret_cast<const int16_t *>(m_raw.data()), samples);
+        break;
+      case 24:
+        kernels.int24_to_float(request.destination, m_raw.data(), samples);
+        break;
+      default:
+        kernels.int32_to_float(request.destination, reinterpret_cast<const int32_t *>(m_raw.data()), samples);
+        break;
+    }
+  }
+
+  m_position += frames_read;
+  return frames_read;
+}
+
+size_t WavReader::read_bytes(void *destination, size_t bytes, uint64_t offset)
+{
+  size_t done = 0;
+#ifdef PLATFORM_LINUX
+  while (done < bytes)
+  {
+    const ssize_t result = ::pread(m_fd, static_cast<char *>(destination) + done, bytes - done, static_cast<off_t>(offset + done));
+    if (result < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (result <= 0)
+    {
+      if (result < 0)
+      {
+        LOG_WARNING("WavReader: read_bytes - Read failed: ", std::strerror(errno));
+      }
+      break;
+    }
+    done += static_cast<size_t>(result);
+  }
+#else
+  if (std::fseek(p_file, static_cast<long>(offset), SEEK_SET) == 0)
+  {
+    done = std::fread(destination, 1, bytes, p_file);
+  }
+#endif
+  return done;
+}
@@ -1,10 +1,16 @@
 #include "audiosession.h"
 
 #include "trackservice.h"
+#include "track.h"
 #include "deviceservice.h"
 #include "fileservice.h"
+#include "networkstream.h"
+#include "samplecache.h"
+#include "offlinerenderer.h"
+#include "transport.h"
 
 #include "logger.h"
+#include "trace.h"
 
 using namespace miniaudioengine;
 using namespace miniaudioengine::adapters;
@@ -13,7 +19,10 @@ AudioSession::AudioSession()
 {
   p_file_service = std::make_unique<FileService>();
   p_device_service = std::make_unique<DeviceService>();
-  p_track_service = std::make_unique<TrackService>();
+  p_track_service = std::make_unique<TrackService>(p_device_service.get());
+  p_sample_cache = std::make_shared<SampleCache>();
+  p_transport = std::make_shared<dataplane::Transport>();
+  p_device_service->set_transport(p_transport);
 
   LOG_INFO("AudioSession: Initialized!");
 }
@@ -50,11 +59,31 @@ DevicePtr AudioSession::get_default_audio_output_device() const
   return p_device_service->get_default_audio_output_device();
 }
 
+bool AudioSession::refresh_devices() const
+{
+  return p_device_service->refresh_devices();
+}
+
+void AudioSession::set_device_change_callback(DeviceChangeCallback callback) const
+{
+  p_device_service->set_device_change_callback(std::move(callback));
+}
+
 FileList AudioSession::get_audio_files(const std::filesystem::path &directory) const
 {
   return p_file_service->get_audio_files(directory);
 }
 
+AudioFileInfoList AudioSession::scan_audio_files(const std::filesystem::path &directory) const
+{
+  return p_file_service->scan_audio_files(directory);
+}
+
+bool AudioSession::set_file_index_path(const std::filesystem::path &index_path)
+{
+  return p_file_service->set_index_path(index_path);
+}
+
 FileList AudioSession::get_midi_files(const std::filesystem::path &directory) const
 {
   return p_file_service->get_midi_files(directory);
@@ -70,6 +99,21 @@ FilePtr AudioSession::get_midi_file(const std::filesystem::path &file_path) cons
   return p_file_service->get_midi_file(file_path);
 }
 
+FilePtr AudioSession::create_audio_file(const std::filesystem::path &file_path) const
+{
+  return p_file_service->create_audio_file(file_path);
+}
+
+NetworkStreamPtr AudioSession::create_network_output(const NetworkStreamConfig &config) const
+{
+  return NetworkStreamFactory::make_output(config);
+}
+
+NetworkStreamPtr AudioSession::create_network_input(const NetworkStreamConfig &config) const
+{
+  return NetworkStreamFactory::make_input(config);
+}
+
 TrackList AudioSession::get_tracks() const
 {
   return p_track_service->get_tracks();
@@ -80,23 +124,143 @@ TrackPtr AudioSession::add_track() const
   return p_track_service->add_track();
 }
 
-bool AudioSession::play()
+TrackStatisticsList AudioSession::get_track_statistics() const
 {
-  bool ret = p_track_service->play();
-  m_state = ret ? eAudioSessionState::Playing : eAudioSessionState::Stopped;
-  return ret;
+  TrackStatisticsList statistics;
+  for (const TrackPtr &track : p_track_service->get_tracks())
+  {
+    statistics.push_back(track->get_statistics());
+  }
+  return statistics;
 }
 
-bool AudioSession::record()
+bool AudioSession::play(const framework::StreamConfig &config)
 {
-  // TODO - Implement
-  LOG_ERROR("Record functionality not implemented yet.");
-  return false;
+  return start(config, eAudioSessionState::Playing);
+}
+
+bool AudioSession::record(const framework::StreamConfig &config)
+{
+  // Recording tracks are identified by their routing, so this only differs from play() in state
+  return start(config, eAudioSessionState::Recording);
+}
+
+bool AudioSession::start(const framework::StreamConfig &config, eAudioSessionState state)
+{
+  // Hold the transport while the tracks open, so none of them sounds before the others are ready.
+  // Each track is armed and starts on the first frame the transport moves on
+  p_transport->stop();
+  if (!p_track_service->play(config))
+  {
+    m_state = eAudioSessionState::Stopped;
+    return false;
+  }
+
+  const size_t preroll_frames = static_cast<size_t>(config.frames_per_buffer) * config.preroll_blocks;
+  if (preroll_frames > 0 && !p_track_service->wait_for_preroll(preroll_frames, PREROLL_TIMEOUT))
+  {
+    LOG_WARNING("AudioSession: start - File inputs did not preroll ", preroll_frames, " frames in ",
+                PREROLL_TIMEOUT.count(), " ms. Starting anyway.");
+  }
+
+  p_transport->start();
+  m_state = state;
+  return true;
+}
+
+OfflineRenderResult AudioSession::render(const std::filesystem::path &output_path, const OfflineRenderConfig &config) const
+{
+  if (m_state != eAudioSessionState::Stopped)
+  {
+    LOG_ERROR("AudioSession: render - Stop the session before rendering offline.");
+    OfflineRenderResult result;
+    result.output_path = output_path;
+    return result;
+  }
+
+  return OfflineRenderer(p_sample_cache).render(p_track_service->get_tracks(), output_path, config);
+}
+
+OfflineRenderJob AudioSession::make_render_job(const std::filesystem::path &output_path, const OfflineRenderConfig &config) const
+{
+  return OfflineRenderJob{p_track_service->get_tracks(), output_path, config};
+}
+
+OfflineRenderResultList AudioSession::render_parallel(const OfflineRenderJobList &jobs, unsigned int max_threads)
+{
+  return OfflineRenderer().render_parallel(jobs, max_threads);
 }
 
 bool AudioSession::stop()
 {
+  p_transport->stop();
+  p_transport->locate(0);
   bool ret = p_track_service->stop();
-  m_state = ret ? eAudioSessionState::Stopped : eAudioSessionState::Playing;
+  if (ret)
+  {
+    m_state = eAudioSessionState::Stopped;
+  }
   return ret;
 }
+
+bool AudioSession::set_realtime_memory(bool enabled)
+{
+  if (!enabled)
+  {
+    framework::realtime_memory::disable();
+    return true;
+  }
+  return framework::realtime_memory::enable();
+}
+
+bool AudioSession::is_realtime_memory_enabled() const
+{
+  return framework::realtime_memory::is_enabled();
+}
+
+framework::RealtimeMemoryStatistics AudioSession::get_realtime_memory_statistics() const
+{
+  return framework::realtime_memory::get_statistics();
+}
+
+bool AudioSession::set_threading(const framework::ThreadingConfig &config)
+{
+  return framework::threading::configure(config);
+}
+
+framework::ThreadingConfig AudioSession::get_threading() const
+{
+  return framework::threading::get_config();
+}
+
+std::vector<framework::ThreadInfo> AudioSession::get_threads() const
+{
+  return framework::threading::get_threads();
+}
+
+bool AudioSession::set_tracing(bool enabled)
+{
+  if (!enabled)
+  {
+    framework::trace::disable();
+    return true;
+  }
+
+#ifdef ENABLE_TRACING
+  framework::trace::enable();
+  return true;
+#else
+  LOG_WARNING("AudioSession: set_tracing - Built without ENABLE_TRACING, no events are recorded");
+  return false;
+#endif
+}
+
+bool AudioSession::is_tracing_enabled() const
+{
+  return framework::trace::is_enabled();
+}
+
+bool AudioSession::write_trace(const std::filesystem::path &path) const
+{
+  return framework::trace::write_chrome_json(path);
+}
@@ -4,8 +4,15 @@
 #include "audiographnode.h"
 #include "io.h"
 #include "graph.h"
+#include "graphplan.h"
+#include "graphscheduler.h"
+#include "midiqueue.h"
+#include "rcupointer.h"
+#include "streamclock.h"
+#include "streamstatistics.h"
 
 #include <memory>
+#include <mutex>
 #include <string>
 
 namespace miniaudioengine::dataplane
@@ -27,24 +34,192 @@ using ProcessorNodePtr = std::shared_ptr<ProcessorNode>;
 
 /** @class AudioGraph
  *  @brief Represents the audio processing graph.
- *  @note TODO - Implement AudioGraph using an adjacency list to avoid
- *               the use of recursion.
+ *  The root node is the OutputNode. Audio flows from each child to its parent.
+ *  Nodes are edited on control threads and compile() turns the graph into a flat GraphPlan, which
+ *  is published atomically. The audio callback only ever walks the published plan.
+ *  Edits made while a plan plays are batched: they change nothing audible until commit() compiles
+ *  them into one new plan, which the audio thread swaps in at its next block. Edges the batch added
+ *  fade in and edges it removed fade out over a short crossfade, rendered by the new plan alone.
+ *  Resamplers, drift estimates and meter taps of nodes whose format is unchanged carry over into the new plan, and
+ *  processors already prepared are not prepared again, so unchanged nodes keep their state.
+ *  Processor latencies are compensated where paths meet: each input of a node is delayed to match
+ *  its slowest input, so lookahead effects on one branch never comb-filter against another.
  */
 class AudioGraph : public framework::IGraph<IAudioGraphNodePtr>
 {
 public:
+  static constexpr unsigned int DEFAULT_SAMPLE_RATE = 44100;
+  static constexpr double DEFAULT_CROSSFADE_MS = 5.0;
+
   AudioGraph() = default;
   ~AudioGraph() = default;
 
+  AudioGraph(const AudioGraph &) = delete;
+  AudioGraph &operator=(const AudioGraph &) = delete;
+
   MixerNodePtr add_mixer_node(IAudioGraphNodePtr parent = nullptr);
   InputNodePtr add_input_node(IInputOutputPtr input, IAudioGraphNodePtr parent = nullptr);
   OutputNodePtr add_output_node(IInputOutputPtr output, IAudioGraphNodePtr parent = nullptr);
   ProcessorNodePtr add_processor_node(IAudioGraphNodePtr parent = nullptr);
 
+  /** @brief Feed a child's output into a parent. Applied by the next commit().
+   *  @return False if either node is not in the graph or was removed, or the edge already exists.
+   */
+  bool connect(const IAudioGraphNodePtr &parent, const IAudioGraphNodePtr &child);
+
+  /** @brief Stop feeding a child's output into a parent. Applied by the next commit().
+   *  @return False if the edge does not exist.
+   */
+  bool disconnect(const IAudioGraphNodePtr &parent, const IAudioGraphNodePtr &child);
+
+  /** @brief Disconnect a node from every parent and child and retire it from the graph.
+   *  Removed nodes keep their index but are never compiled again. The root cannot be removed.
+   *  @return False if the node is not in the graph or is the root.
+   */
+  bool remove_node(const IAudioGraphNodePtr &node);
+
+  /** @brief Compile the edits made since the last published plan with the format of that plan.
+   *  @return False if no plan has been compiled yet, or compile() fails. The playing plan is kept.
+   */
+  bool commit();
+
+  /** @brief Returns true if edits were made that the published plan does not contain. */
+  bool has_pending_edits() const;
+
+  /** @brief Set the length of the crossfade on edges changed by an edit. Applied by the next commit().
+   *  @param milliseconds Crossfade length. 0 switches changed edges at the block boundary.
+   */
+  void set_crossfade_ms(double milliseconds);
+
+  /** @brief Build a topologically sorted plan of the graph and publish it to the audio thread.
+   *  Can be called while the audio stream is running, the new plan is picked up on the next block.
+   *  When the format matches the published plan, edges edited since then are crossfaded. In any other format
+   *  the processors are prepared again: the playing plan is withdrawn first, the stream renders silence until
+   *  the new plan is published, and stays silent if the compile then fails.
+   *  @param channels Number of interleaved channels written to the output.
+   *  @param max_frames Largest block rendered in one pass. Larger blocks are split.
+   *  @param sample_rate Sample rate in Hz that processors are prepared for.
+   *  @return True if the plan was published. False if the graph is empty, has no OutputNode root or contains a cycle.
+   */
+  bool compile(unsigned int channels, unsigned int max_frames, unsigned int sample_rate = DEFAULT_SAMPLE_RATE);
+
+  /** @brief Render independent branches of the graph in parallel. Applied by the next compile().
+   *  @param worker_threads Worker threads started in addition to the audio thread. 0 renders on the audio thread only.
+   *  @param realtime Request realtime priority and core pinning for the workers.
+   */
+  void set_worker_threads(unsigned int worker_threads, bool realtime = true);
+
+  /** @brief Select the filter used for InputNodes whose source sample rate differs from the graph's.
+   *  Applied by the next compile().
+   */
+  void set_resample_quality(framework::eResampleQuality quality);
+
+  /** @brief Deliver MIDI messages from a queue to the graph's processors. Applied by the next compile().
+   *  @param queue Queue filled by a MIDI input, or nullptr to stop receiving MIDI.
+   */
+  void set_midi_queue(const framework::MidiQueuePtr &queue);
+
+  /** @brief Record input ring buffer fill and underruns into a StreamStatistics. Applied by the next compile().
+   *  @param statistics Statistics to update, or nullptr to stop recording.
+   */
+  void set_statistics(const framework::StreamStatisticsPtr &statistics);
+
+  /** @brief Returns the clock advanced by every process() call, for timestamping MIDI input. */
+  const framework::StreamClockPtr &get_stream_clock() const { return p_stream_clock; }
+
+  /** @brief Render the published plan into an interleaved output buffer.
+   *  @param output Interleaved output buffer.
+   *  @param n_frames Number of frames to render.
+   *  @return False if no plan has been published. The output is left untouched.
+   *  @note Audio thread only. Lock-free and allocation-free.
+   */
+  bool process(float *output, unsigned int n_frames) noexcept;
+
+  /** @brief Returns the number of interleaved channels of the published plan, or 0 if none is published. */
+  unsigned int get_channels() const;
+
+  /** @brief Returns the latency of the published plan's output: the frames the longest processor path
+   *  delays the audio, to which every shorter path is aligned. 0 if no plan is published.
+   */
+  unsigned int get_latency_frames() const;
+
+  /** @brief Returns the bytes of intermediate buffers reserved by the published plan. */
+  size_t get_arena_size_bytes() const;
+
+  /** @brief Returns the largest intermediate buffer arena of any plan compiled by this graph. */
+  size_t get_peak_arena_size_bytes() const;
+
+  /** @brief Returns true if a compiled plan is published. */
+  bool is_compiled() const { return m_plan.has_value(); }
+
   std::string to_string() const;
 
 private:
+  /** @struct PlanFormat
+   *  @brief Everything a node's carried-over state depends on besides the node itself.
+   */
+  struct PlanFormat
+  {
+    unsigned int channels{0};
+    unsigned int max_frames{0};
+    unsigned int sample_rate{0};
+    framework::eResampleQuality resample_quality{framework::eResampleQuality::Balanced};
+
+    bool operator==(const PlanFormat &) const = default;
+  };
+
+  /** @struct CompiledNode
+   *  @brief Per-node state built by compile(), carried into the next plan while the format and node are unchanged.
+   */
+  struct CompiledNode
+  {
+    std::shared_ptr<framework::Resampler> p_resampler;
+    std::shared_ptr<framework::DriftEstimator> p_drift_estimator;
+    unsigned int source_rate{0};
+    unsigned int source_channels{0};
+    std::shared_ptr<framework::MeterTap> p_meter_tap;
+    framework::MeterPtr p_meter;
+    std::vector<std::pair<size_t, framework::DelayLinePtr>> p_input_delays; // Child node and the line aligning it
+    bool live{false}; // Audible in the plan, not only fading out
+  };
+
+  using Edge = std::pair<size_t, size_t>;
+
   IAudioGraphNodePtr add_node(IAudioGraphNodePtr node, IAudioGraphNodePtr parent = nullptr);
+  bool contains(const IAudioGraphNodePtr &node) const;
+  void add_edge_locked(size_t parent, size_t child);
+  void remove_edge_locked(size_t parent, size_t child);
+  bool compile_locked(const PlanFormat &format);
+
+  /** @brief Withdraw the published plan and wait until the audio thread has left it. */
+  void unpublish_locked();
+  bool attach_meter(GraphPlan &plan, NodeTask &task, const framework::MeterPtr &meter, const PlanFormat &format,
+                    CompiledNode &compiled, const CompiledNode *previous) const;
+  framework::DelayLine *attach_delay(GraphPlan &plan, size_t child, unsigned int delay_frames, const PlanFormat &format,
+                                     CompiledNode &compiled, const CompiledNode *previous) const;
+
+  bool sort_nodes(std::vector<size_t> &order, const std::vector<std::vector<size_t>> *retiring_children = nullptr) const;
+
+  framework::RcuPointer<GraphPlan> m_plan;
+  GraphSchedulerPtr p_scheduler;
+  framework::MidiQueuePtr p_midi_queue;
+  framework::StreamStatisticsPtr p_statistics;
+  framework::StreamClockPtr p_stream_clock{std::make_shared<framework::StreamClock>()};
+
+  // Guards the graph's nodes and edges, the pending edits and every compile setting
+  mutable std::mutex m_graph_mutex;
+  framework::eResampleQuality m_resample_quality{framework::eResampleQuality::Balanced};
+  double m_crossfade_ms{DEFAULT_CROSSFADE_MS};
+  std::vector<bool> m_removed;
+
+  // Edits since the published plan and the state that plan was compiled with
+  std::vector<Edge> m_added_edges;
+  std::vector<Edge> m_removed_edges;
+  PlanFormat m_format;
+  std::vector<CompiledNode> m_compiled_nodes;
+  unsigned int m_latency_frames{0};
+  size_t m_arena_size_bytes{0};
+  size_t m_peak_arena_size_bytes{0};
 };
 
 using AudioGraphPtr = std::shared_ptr<AudioGraph>;
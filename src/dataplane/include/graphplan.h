@@ -0,0 +1,400 @@
+#ifndef __GRAPH_PLAN_H__
+#define __GRAPH_PLAN_H__
+
+#include "audiosource.h"
+#include "bufferarena.h"
+#include "delayline.h"
+#include "driftestimator.h"
+#include "io.h"
+#include "meter.h"
+#include "midieventlist.h"
+#include "midiqueue.h"
+#include "processor.h"
+#include "resampler.h"
+#include "statesnapshot.h"
+#include "streamstatistics.h"
+#include "trace.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace miniaudioengine::dataplane
+{
+
+class GraphPlan;
+struct MixerParameters;
+class GraphScheduler;
+
+/** @enum eInputFade
+ *  @brief How a task mixes one input while a hot-swapped plan crossfades.
+ */
+enum class eInputFade : unsigned char
+{
+  None, // Mixed at unity
+  In,   // Edge added by the edit, ramps up from silence
+  Out   // Edge removed by the edit, ramps down to silence and is then ignored
+};
+
+/** @struct NodeTask
+ *  @brief One step of a compiled GraphPlan.
+ *  Everything the audio thread needs is resolved at compile time: the kernel to run, the buffer to
+ *  write and the buffers to read. Raw pointers are kept alive by the owning GraphPlan.
+ */
+struct NodeTask
+{
+  using ProcessFunc = void (*)(const NodeTask &task, GraphPlan &plan, unsigned int n_frames) noexcept;
+
+  ProcessFunc process{nullptr};
+
+  /** @brief Index of the node in the AudioGraph this task was compiled from. */
+  size_t node_index{0};
+
+  /** @brief Name of the task's trace events, the node's class. */
+  const char *trace_name{"Node"};
+
+  /** @brief Plan buffer written by this task. */
+  size_t output_buffer{0};
+
+  /** @brief Range of plan buffers read by this task, stored in GraphPlan::get_inputs(). */
+  size_t inputs_begin{0};
+  size_t inputs_count{0};
+
+  /** @brief Range of tasks that read this task's buffer, stored in GraphPlan::get_dependents(). */
+  size_t dependents_begin{0};
+  size_t dependents_count{0};
+
+  /** @brief True if any input has an eInputFade other than None, stored in GraphPlan::get_input_fades(). */
+  bool has_input_fades{false};
+
+  /** @brief True if any input is read through a latency compensation delay, stored in GraphPlan::get_input_delays(). */
+  bool has_input_delays{false};
+
+  /** @brief True for a node the edit disconnected, rendered only until the plan's crossfade completes. */
+  bool retiring{false};
+
+  // Mixer node fields
+  framework::StateSnapshot<MixerParameters> *p_mixer_parameters{nullptr};
+
+  // Measures the task's buffer once it is rendered, nullptr when the node is not metered. Mixer and output nodes
+  framework::MeterTap *p_meter{nullptr};
+
+  // Processor node fields, a range of GraphPlan::get_processors()
+  size_t processors_begin{0};
+  size_t processors_count{0};
+
+  // Input node fields
+  framework::Buffer *p_source{nullptr};
+  framework::IAudioSource *p_audio_source{nullptr}; // Read instead of p_source when set
+  unsigned int source_channels{0};
+  size_t scratch_offset{0};
+  std::atomic<unsigned long long> *p_underrun_count{nullptr};
+
+  // Converts the source to the plan's sample rate, or nullptr when the rates match.
+  // The converted frames are written to the scratch space at resampled_offset.
+  framework::Resampler *p_resampler{nullptr};
+  size_t resampled_offset{0};
+
+  // Steers the ring buffer's fill through the resampler's rate, or nullptr when the source shares the plan's clock
+  framework::DriftEstimator *p_drift_estimator{nullptr};
+  std::atomic<double> *p_drift_ppm{nullptr};
+};
+
+/** @class GraphPlan
+ *  @brief Flat, topologically sorted execution plan compiled from an AudioGraph.
+ *  Tasks are ordered so that every node runs after the nodes feeding it, which lets the audio
+ *  thread render the graph with a single pass over a contiguous vector. Intermediate audio is
+ *  planar: each plan buffer holds get_channels() channels of get_max_frames() samples.
+ *  Inputs arriving with less processor latency than a task's slowest input are read through a
+ *  preallocated DelayLine, so parallel paths line up again where they are summed.
+ *  Plan buffers live in one preallocated BufferArena. finalize() assigns them by liveness, so tasks
+ *  whose buffers can never be in use at the same time share memory, even when the plan is
+ *  rendered in parallel.
+ *  @note A plan is owned by one reader at a time. It is built by AudioGraph::compile() and is
+ *        never modified by the control thread after it has been published.
+ */
+class GraphPlan
+{
+public:
+  GraphPlan(unsigned int channels, unsigned int max_frames) :
+    m_channels(channels),
+    m_max_frames(max_frames)
+  {}
+  ~GraphPlan() = default;
+
+  GraphPlan(const GraphPlan &) = delete;
+  GraphPlan &operator=(const GraphPlan &) = delete;
+
+  /** @brief Render the plan into an interleaved output buffer.
+   *  Blocks larger than get_max_frames() are rendered in several passes. When the plan has a
+   *  GraphScheduler, independent tasks of each pass run in parallel on its workers.
+   *  Queued MIDI messages are drained first and placed on the frames of the pass they land in.
+   *  @param output Interleaved output with get_channels() channels.
+   *  @param n_frames Number of frames to render.
+   *  @param block_start Stream frame of the first frame of the block, from StreamClock::advance().
+   *  @note Audio thread only. Lock-free and allocation-free.
+   */
+  void render(float *output, unsigned int n_frames, uint64_t block_start = 0) noexcept;
+
+  /** @brief Run every task of one pass in order on the calling thread. */
+  void run_serial(unsigned int n_frames) noexcept;
+
+  /** @brief Run one task of the current pass. Retiring tasks are skipped once the crossfade completes. */
+  void run_task(const NodeTask &task, unsigned int n_frames) noexcept
+  {
+    if (!task.retiring || is_crossfading())
+    {
+      TRACE_SCOPE_ID(task.trace_name, task.node_index);
+      task.process(task, *this, n_frames);
+    }
+  }
+
+  /** @brief Returns the samples of one channel of a plan buffer. */
+  float *get_channel(size_t buffer, unsigned int channel) noexcept
+  {
+    return m_arena.get_channel(buffer, channel);
+  }
+
+  /** @brief Returns the channel pointers of a plan buffer, for building an AudioBlockView. */
+  float *const *get_channel_pointers(size_t buffer) const noexcept
+  {
+    return m_channel_pointers.data() + buffer * m_channels;
+  }
+
+  /** @brief Returns the processor chain run by a task. */
+  std::span<framework::IProcessor *const> get_processors(const NodeTask &task) const noexcept
+  {
+    return {m_processors.data() + task.processors_begin, task.processors_count};
+  }
+
+  /** @brief Returns the plan buffers read by a task. */
+  std::span<const size_t> get_inputs(const NodeTask &task) const noexcept
+  {
+    return {m_input_buffers.data() + task.inputs_begin, task.inputs_count};
+  }
+
+  /** @brief Returns how a task mixes each of its inputs, parallel to get_inputs(). Empty unless has_input_fades. */
+  std::span<const eInputFade> get_input_fades(const NodeTask &task) const noexcept
+  {
+    return {m_input_fades.data() + task.inputs_begin, task.has_input_fades ? task.inputs_count : 0};
+  }
+
+  /** @brief Returns the delay lines aligning a task's inputs, parallel to get_inputs(), nullptr for
+   *  inputs that need none. Empty unless has_input_delays.
+   */
+  std::span<framework::DelayLine *const> get_input_delays(const NodeTask &task) const noexcept
+  {
+    return {m_input_delays.data() + task.inputs_begin, task.has_input_delays ? task.inputs_count : 0};
+  }
+
+  /** @brief Returns the indices of the tasks that read a task's buffer. */
+  std::span<const unsigned int> get_dependents(const NodeTask &task) const noexcept
+  {
+    return {m_dependents.data() + task.dependents_begin, task.dependents_count};
+  }
+
+  /** @brief Returns the tasks with no inputs, which can start as soon as a pass begins. */
+  std::span<const unsigned int> get_leaf_tasks() const noexcept { return m_leaf_tasks; }
+
+  /** @brief Reset every task's dependency counter for a new pass. */
+  void reset_dependencies() noexcept
+  {
+    for (size_t i = 0; i < m_tasks.size(); i++)
+    {
+      p_pending[i].store(static_cast<unsigned int>(m_tasks[i].inputs_count), std::memory_order_relaxed);
+    }
+  }
+
+  /** @brief Mark one input of a task complete.
+   *  @return True if it was the last outstanding input, so the task is ready to run.
+   */
+  bool release_dependency(unsigned int task) noexcept
+  {
+    return p_pending[task].fetch_sub(1, std::memory_order_acq_rel) == 1;
+  }
+
+  /** @brief Returns interleaved scratch space reserved for an input task. */
+  float *get_scratch(const NodeTask &task) noexcept
+  {
+    return m_scratch.data() + task.scratch_offset;
+  }
+
+  /** @brief Returns the interleaved scratch space an input task's resampler writes to. */
+  float *get_resampled_scratch(const NodeTask &task) noexcept
+  {
+    return m_scratch.data() + task.resampled_offset;
+  }
+
+  /** @brief Returns the MIDI events of the pass currently being rendered, offsets relative to the pass. */
+  const midi::MidiEventList &get_midi_events() const noexcept { return m_pass_events; }
+
+  /** @brief Returns the interleaved destination of the block currently being rendered. */
+  float *get_output() noexcept { return p_output; }
+
+  unsigned int get_channels() const noexcept { return m_channels; }
+  unsigned int get_max_frames() const noexcept { return m_max_frames; }
+  size_t get_buffer_count() const noexcept { return m_buffer_count; }
+
+  /** @brief Returns the bytes reserved for intermediate buffers after liveness sharing. */
+  size_t get_arena_size_bytes() const noexcept { return m_arena.get_size_bytes(); }
+
+  /** @brief Returns the bytes the intermediate buffers would need with one buffer per task. */
+  size_t get_unshared_size_bytes() const noexcept
+  {
+    return m_buffer_count > 0 ? m_arena.get_size_bytes() / m_buffer_count * m_tasks.size() : 0;
+  }
+  const std::vector<NodeTask> &get_tasks() const noexcept { return m_tasks; }
+
+  /** @brief Append a task.
+   *  Tasks must be added in execution order, ending with the output task.
+   *  @param inputs Indices of the previously added tasks whose buffers this task reads.
+   *  @param fades How each input is mixed during the crossfade, parallel to inputs. Empty mixes every input at unity.
+   *  @param delays Delay lines that realign each input with the task's slowest one, parallel to inputs.
+   *         nullptr or empty reads the input directly. The plan does not own them, retain() them.
+   *  @return The index of the task.
+   */
+  size_t add_task(NodeTask task, std::span<const size_t> inputs, std::span<const eInputFade> fades = {},
+                  std::span<framework::DelayLine *const> delays = {});
+
+  /** @brief Record the latency of the plan's output, the longest processor path to the OutputNode. */
+  void set_latency_frames(unsigned int frames) noexcept { m_latency_frames = frames; }
+  unsigned int get_latency_frames() const noexcept { return m_latency_frames; }
+
+  /** @brief Crossfade the plan's faded inputs over its first frames after it is published.
+   *  @param frames Length of the crossfade. 0 switches edges at once.
+   */
+  void set_crossfade(unsigned int frames);
+
+  /** @brief Returns true while the pass being rendered is inside the crossfade. */
+  bool is_crossfading() const noexcept { return m_crossfade_position < m_crossfade_frames; }
+
+  unsigned int get_crossfade_frames() const noexcept { return m_crossfade_frames; }
+
+  /** @brief Render passes on a worker pool. Pass nullptr to render on the audio thread only. */
+  void set_scheduler(const std::shared_ptr<GraphScheduler> &scheduler);
+
+  /** @brief Reserve interleaved scratch space for an input task.
+   *  @param channels Number of interleaved channels.
+   *  @param frames Number of frames. 0 reserves get_max_frames().
+   */
+  size_t reserve_scratch(unsigned int channels, size_t frames = 0);
+
+  /** @brief Store a processor chain for a task. The plan keeps the processors alive.
+   *  @return The index of the first processor, for NodeTask::processors_begin.
+   */
+  size_t add_processors(std::span<const framework::IProcessorPtr> processors);
+
+  /** @brief Drain MIDI messages from a queue at the start of every rendered block. */
+  void set_midi_queue(const framework::MidiQueuePtr &queue);
+
+  /** @brief Record ring buffer fill and underruns of the plan's input tasks into a StreamStatistics. */
+  void set_statistics(const framework::StreamStatisticsPtr &statistics);
+
+  /** @brief Returns the statistics input tasks record into, or nullptr. */
+  framework::StreamStatistics *get_statistics() const noexcept { return p_statistics; }
+
+  /** @brief Keep an object referenced by a task alive for the lifetime of the plan. */
+  void retain(std::shared_ptr<const void> object) { m_retained.push_back(std::move(object)); }
+
+  /** @brief Assign buffers, resolve dependencies and allocate storage. Called once after all tasks are added. */
+  void finalize();
+
+  std::string to_string() const;
+
+  // ---------------------------------------------------------------------------
+  // Node kernels
+  // ---------------------------------------------------------------------------
+
+  /** @struct NodeKernels
+   *  @brief The kernel of every node type for one channel count.
+   */
+  struct NodeKernels
+  {
+    NodeTask::ProcessFunc input;
+    NodeTask::ProcessFunc mixer;
+    NodeTask::ProcessFunc processor;
+    NodeTask::ProcessFunc output;
+  };
+
+  /** @brief Returns the kernels AudioGraph::compile() assigns for a channel count.
+   *  Mono and stereo plans get kernels instantiated for their channel count, so the channel loops
+   *  unroll and the layout branches fold away. Other counts get the kernels that read get_channels().
+   */
+  static const NodeKernels &get_node_kernels(unsigned int channels) noexcept;
+
+  // Each kernel takes the plan's channel count as a template argument, 0 for "read get_channels()"
+
+  /** @brief Pull interleaved audio from a ring buffer, resample it if needed and deinterleave it into the task's buffer. */
+  template <unsigned int Channels>
+  static void process_input(const NodeTask &task, GraphPlan &plan, unsigned int n_frames) noexcept;
+
+  /** @brief Sum every input buffer into the task's buffer, then apply the mixer's gain and pan. */
+  template <unsigned int Channels>
+  static void process_mixer(const NodeTask &task, GraphPlan &plan, unsigned int n_frames) noexcept;
+
+  /** @brief Sum every input buffer and run the task's processors over it in place with the pass's MIDI events. */
+  template <unsigned int Channels>
+  static void process_processor(const NodeTask &task, GraphPlan &plan, unsigned int n_frames) noexcept;
+
+  /** @brief Sum every input buffer and interleave it into the device output. */
+  template <unsigned int Channels>
+  static void process_output(const NodeTask &task, GraphPlan &plan, unsigned int n_frames) noexcept;
+
+  /** @brief Largest number of MIDI messages drained per block. The rest wait for the next block. */
+  static constexpr size_t MAX_MIDI_MESSAGES = 256;
+
+private:
+  void drain_midi(unsigned int n_frames, uint64_t block_start) noexcept;
+  void prepare_crossfade(unsigned int n_frames) noexcept;
+
+  template <unsigned int Channels>
+  void sum_inputs(const NodeTask &task, unsigned int n_frames) noexcept;
+
+  void assign_buffers();
+
+  const unsigned int m_channels;
+  const unsigned int m_max_frames;
+  unsigned int m_latency_frames{0};
+
+  std::vector<NodeTask> m_tasks;
+  std::vector<size_t> m_input_tasks;
+  std::vector<size_t> m_input_buffers;
+  std::vector<eInputFade> m_input_fades;
+  std::vector<framework::DelayLine *> m_input_delays;
+  std::vector<unsigned int> m_dependents;
+  std::vector<unsigned int> m_leaf_tasks;
+  std::unique_ptr<std::atomic<unsigned int>[]> p_pending;
+  size_t m_buffer_count{0};
+
+  GraphScheduler *p_scheduler{nullptr};
+
+  framework::BufferArena m_arena;
+  std::vector<float> m_scratch;
+  std::vector<float *> m_channel_pointers;
+  std::vector<framework::IProcessor *> m_processors;
+
+  float *p_output{nullptr};
+
+  framework::MidiQueue *p_midi_queue{nullptr};
+  midi::MidiEventList m_block_events;
+  midi::MidiEventList m_pass_events;
+
+  framework::StreamStatistics *p_statistics{nullptr};
+
+  // Gains of faded inputs for the current pass, advanced by the audio thread only
+  unsigned int m_crossfade_frames{0};
+  unsigned int m_crossfade_position{0};
+  std::vector<float> m_fade_in;
+  std::vector<float> m_fade_out;
+
+  std::vector<std::shared_ptr<const void>> m_retained;
+};
+
+using GraphPlanPtr = std::unique_ptr<GraphPlan>;
+
+} // namespace miniaudioengine::dataplane
+
+#endif // __GRAPH_PLAN_H__
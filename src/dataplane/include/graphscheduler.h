@@ -0,0 +1,85 @@
+#ifndef __GRAPH_SCHEDULER_H__
+#define __GRAPH_SCHEDULER_H__
+
+#include "workstealingdeque.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace miniaudioengine::dataplane
+{
+
+class GraphPlan;
+
+/** @class GraphScheduler
+ *  @brief Work-stealing worker pool which renders independent branches of a GraphPlan in parallel.
+ *  The audio thread takes part as worker 0 and returns once the output task has run, so a pass
+ *  completes within the audio callback. Tasks become ready when their dependency counter in the
+ *  plan reaches zero and are pushed onto the finishing worker's deque, where idle workers steal them.
+ *  Workers spin briefly between passes and then sleep until the next pass starts.
+ *  @note run() must only be called by one thread at a time.
+ */
+class GraphScheduler
+{
+public:
+  /** @brief Default maximum number of tasks in a plan rendered by the scheduler. */
+  static constexpr size_t MAX_TASKS = 4096;
+
+  /** @brief Start the worker pool.
+   *  @param worker_threads Number of threads started in addition to the audio thread.
+   *  @param realtime Run the workers in framework::eThreadClass::Worker, with the realtime priority and
+   *                  cores of the engine's ThreadingConfig, rather than as normal threads.
+   */
+  explicit GraphScheduler(unsigned int worker_threads, bool realtime = true);
+  ~GraphScheduler();
+
+  GraphScheduler(const GraphScheduler &) = delete;
+  GraphScheduler &operator=(const GraphScheduler &) = delete;
+
+  /** @brief Render one pass of a plan, returning once every task has run.
+   *  @note Audio thread only. Lock-free and allocation-free.
+   */
+  void run(GraphPlan &plan, unsigned int n_frames) noexcept;
+
+  /** @brief Returns the number of threads rendering each pass, including the audio thread. */
+  unsigned int get_worker_count() const { return static_cast<unsigned int>(m_workers.size()); }
+
+  size_t get_max_tasks() const { return MAX_TASKS; }
+
+private:
+  struct Worker
+  {
+    Worker() : deque(MAX_TASKS) {}
+
+    framework::WorkStealingDeque<unsigned int> deque;
+    std::thread thread;
+  };
+
+  void worker_loop(size_t index);
+  bool execute_one(size_t index) noexcept;
+  void execute(unsigned int task, size_t index) noexcept;
+
+  const bool m_realtime;
+  std::vector<std::unique_ptr<Worker>> m_workers;
+
+  // Pass state, written by the audio thread before the pass is published
+  std::atomic<GraphPlan *> p_plan{nullptr};
+  std::atomic<unsigned int> m_frames{0};
+
+  alignas(64) std::atomic<size_t> m_remaining{0};
+  alignas(64) std::atomic<uint64_t> m_generation{0};
+  std::atomic<unsigned int> m_sleeping{0};
+  std::atomic<bool> m_stop{false};
+
+  // Set by workers whose tasks flushed denormals, handed to the audio thread's flags after the pass
+  std::atomic<bool> m_worker_denormals{false};
+};
+
+using GraphSchedulerPtr = std::shared_ptr<GraphScheduler>;
+
+} // namespace miniaudioengine::dataplane
+
+#endif // __GRAPH_SCHEDULER_H__
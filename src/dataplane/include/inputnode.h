@@ -2,8 +2,10 @@
 #define __INPUT_NODE_H__
 
 #include "audiographnode.h"
+#include "audiosource.h"
 #include "io.h"
 
+#include <atomic>
 #include <memory>
 
 namespace miniaudioengine::dataplane
@@ -20,14 +22,71 @@ public:
 
   framework::IInputOutputPtr get_io() const { return p_io; }
 
+  /** @brief Set the ring buffer the node pulls interleaved audio from.
+   *  @param buffer Ring buffer filled by the input's stream.
+   *  @param channels Number of interleaved channels in the ring buffer.
+   *  @param sample_rate Sample rate of the audio in the ring buffer. When it differs from the rate the
+   *         graph is compiled for, the node resamples it. 0 assumes the graph's rate.
+   */
+  void set_source(const framework::BufferPtr &buffer, unsigned int channels, unsigned int sample_rate = 0)
+  {
+    p_source = buffer;
+    p_audio_source.reset();
+    m_source_channels = channels;
+    m_source_sample_rate = sample_rate;
+  }
+
+  /** @brief Pull audio from a source with its own consumer-side logic instead of a ring buffer.
+   *  @param source Source read by the audio thread, e.g. a seekable file stream.
+   *  @param channels Number of interleaved channels the source returns.
+   *  @param sample_rate Sample rate of the source, 0 assumes the graph's rate.
+   */
+  void set_source(const framework::AudioSourcePtr &source, unsigned int channels, unsigned int sample_rate = 0)
+  {
+    p_source.reset();
+    p_audio_source = source;
+    m_source_channels = channels;
+    m_source_sample_rate = sample_rate;
+  }
+
+  framework::BufferPtr get_source() const { return p_source; }
+  framework::AudioSourcePtr get_audio_source() const { return p_audio_source; }
+  unsigned int get_source_channels() const { return m_source_channels; }
+  unsigned int get_source_sample_rate() const { return m_source_sample_rate; }
+
+  /** @brief Steer the ring buffer's fill with an adaptive resampler. Applied by the next compile().
+   *  For a ring buffer written on another device's clock, whose rate drifts against the graph's: the
+   *  node estimates the drift from the fill level and reads slightly faster or slower to cancel it.
+   *  Sources with their own consumer-side logic are never steered.
+   */
+  void set_drift_compensation(bool enabled) { m_drift_compensation = enabled; }
+  bool is_drift_compensated() const { return m_drift_compensation; }
+
+  /** @brief Returns the estimated drift of the source's clock against the graph's, in parts per million. */
+  double get_drift_ppm() const { return m_drift_ppm.load(std::memory_order_relaxed); }
+
+  std::atomic<double> *get_drift_gauge() { return &m_drift_ppm; }
+
+  /** @brief Returns the number of blocks the source could not fill, which were padded with silence. */
+  unsigned long long get_underrun_count() const { return m_underrun_count.load(std::memory_order_relaxed); }
+
+  std::atomic<unsigned long long> *get_underrun_counter() { return &m_underrun_count; }
+
   std::string to_string() const override;
 
 private:
   framework::IInputOutputPtr p_io;
+  framework::BufferPtr p_source;
+  framework::AudioSourcePtr p_audio_source;
+  unsigned int m_source_channels{0};
+  unsigned int m_source_sample_rate{0};
+  bool m_drift_compensation{false};
+  std::atomic<unsigned long long> m_underrun_count{0};
+  std::atomic<double> m_drift_ppm{0.0};
 };
 
 using InputNodePtr = std::shared_ptr<InputNode>;
 
 } // namespace miniaudioengine::dataplane
 
-#endif // __INPUT_NODE_H__
\ No newline at end of file
+#endif // __INPUT_NODE_H__
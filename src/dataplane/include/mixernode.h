@@ -2,19 +2,62 @@
 #define __MIXER_NODE_H__
 
 #include "audiographnode.h"
+#include "meter.h"
+#include "statesnapshot.h"
 
 #include <memory>
+#include <mutex>
 
 namespace miniaudioengine::dataplane
 {
 
+/** @struct MixerParameters
+ *  @brief Parameter set of a MixerNode, published to the audio thread as one unit.
+ */
+struct MixerParameters
+{
+  float gain{1.0f};
+  float pan{0.0f};
+};
+
+/** @class MixerNode
+ *  @brief Sums its children into one bus with a gain and a stereo pan.
+ *  Gain and pan can be changed from any thread and are picked up together on the next block.
+ */
 class MixerNode : public framework::IAudioGraphNode
 {
 public:
   MixerNode() = default;
   ~MixerNode() = default;
 
+  /** @brief Set the linear gain applied to the summed children. */
+  void set_gain(float gain);
+  float get_gain() const { return get_parameters().gain; }
+
+  /** @brief Set the stereo pan position from -1 (left) to 1 (right). Ignored unless the bus is stereo. */
+  void set_pan(float pan);
+  float get_pan() const { return get_parameters().pan; }
+
+  /** @brief Set gain and pan at once, so no block is rendered with one changed and not the other. */
+  void set_parameters(const MixerParameters &parameters);
+  MixerParameters get_parameters() const;
+
+  /** @brief Returns the snapshot the compiled graph reads the parameters from on the audio thread. */
+  framework::StateSnapshot<MixerParameters> *get_parameter_snapshot() { return &m_snapshot; }
+
+  /** @brief Meter the bus after its gain and pan, or nullptr to stop metering. Applied by the next compile(). */
+  void set_meter(const framework::MeterPtr &meter) { p_meter = meter; }
+  framework::MeterPtr get_meter() const { return p_meter; }
+
   std::string to_string() const override;
+
+private:
+  framework::MeterPtr p_meter;
+
+  // Control threads serialise on the mutex, so the snapshot only ever has one writer
+  mutable std::mutex m_parameters_mutex;
+  MixerParameters m_parameters;
+  framework::StateSnapshot<MixerParameters> m_snapshot;
 };
 
 using MixerNodePtr = std::shared_ptr<MixerNode>;
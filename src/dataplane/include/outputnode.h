@@ -3,6 +3,7 @@
 
 #include "audiographnode.h"
 #include "io.h"
+#include "meter.h"
 
 namespace miniaudioengine::dataplane
 {
@@ -15,10 +16,15 @@ public:
 
   framework::IInputOutputPtr get_io() { return p_io; }
 
+  /** @brief Meter the summed output before it is interleaved, or nullptr to stop metering. Applied by the next compile(). */
+  void set_meter(const framework::MeterPtr &meter) { p_meter = meter; }
+  framework::MeterPtr get_meter() const { return p_meter; }
+
   std::string to_string() const override;
 
 private:
   framework::IInputOutputPtr p_io;
+  framework::MeterPtr p_meter;
 };
 
 using OutputNodePtr = std::shared_ptr<OutputNode>;
@@ -2,23 +2,68 @@
 #define __PROCESSOR_NODE_H__
 
 #include "audiographnode.h"
+#include "processor.h"
 
 #include <memory>
+#include <vector>
 
 namespace miniaudioengine::dataplane
 {
 
+/** @class ProcessorNode
+ *  @brief Sums its children and runs a chain of IProcessors over the result in place.
+ *  The chain is edited on control threads and picked up by the next AudioGraph::compile(). A published
+ *  plan holds a reference to every processor it renders, so removing one keeps it alive until that plan
+ *  is replaced.
+ */
 class ProcessorNode : public framework::IAudioGraphNode
 {
 public:
   ProcessorNode() = default;
   ~ProcessorNode() = default;
 
+  /** @brief Append a processor to the end of the chain. */
+  void add_processor(const framework::IProcessorPtr &processor);
+
+  /** @brief Remove every processor from the chain. */
+  void clear_processors();
+
+  const std::vector<framework::IProcessorPtr> &get_processors() const { return m_processors; }
+
+  /** @brief Prepare every processor for a stream format.
+   *  Processors already prepared for the same format are skipped, so a recompile in the playing format
+   *  never re-prepares a processor the audio thread is still rendering. AudioGraph::compile() withdraws
+   *  the playing plan before it prepares for a new format.
+   */
+  void prepare(unsigned int sample_rate, unsigned int max_block, unsigned int channels);
+
+  /** @brief Returns the latency the chain adds, the sum of its processors' latencies. Valid after prepare(). */
+  unsigned int get_latency_frames() const;
+
+  /** @brief Tell every processor the latency of the audio reaching it.
+   *  @param input_latency Latency of the compensated paths feeding the node.
+   *  @return The latency at the node's output.
+   */
+  unsigned int propagate_latency(unsigned int input_latency);
+
   std::string to_string() const override;
+
+private:
+  struct Format
+  {
+    unsigned int sample_rate{0};
+    unsigned int max_block{0};
+    unsigned int channels{0};
+
+    bool operator==(const Format &) const = default;
+  };
+
+  std::vector<framework::IProcessorPtr> m_processors;
+  std::vector<Format> m_prepared_formats;
 };
 
 using ProcessorNodePtr = std::shared_ptr<ProcessorNode>;
 
 } // namespace miniaudioengine::dataplane
 
-#endif // __PROCESSOR_NODE_H__
\ No newline at end of file
+#endif // __PROCESSOR_NODE_H__
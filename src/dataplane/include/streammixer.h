@@ -0,0 +1,131 @@
+#ifndef __STREAM_MIXER_H__
+#define __STREAM_MIXER_H__
+
+#include "audiograph.h"
+#include "io.h"
+#include "rcupointer.h"
+#include "streamstatistics.h"
+#include "transport.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace miniaudioengine::dataplane
+{
+
+/** @class StreamMixer
+ *  @brief Multiplexes many tracks onto one device stream.
+ *  Every route is a track's compiled AudioGraph, a Buffer fed from the device input, or both. Each
+ *  callback first copies the captured block into every route's Buffer, then renders every graph in
+ *  turn and sums them into the device buffer, so all tracks on a device share one stream and stay
+ *  sample aligned. Routes are edited on control threads and published to the audio thread as an
+ *  immutable table, so tracks can join and leave while the stream runs.
+ *  With a Transport the mixer either drives it, advancing it once per callback and mixing in its
+ *  click, or follows the block another stream moved it to. A route with a TransportGate is only
+ *  rendered for the frames between its start and stop frames, split at those exact frames.
+ */
+class StreamMixer
+{
+public:
+  /** @param output_channels Interleaved channels of the device output. 0 for an input-only stream.
+   *  @param input_channels Interleaved channels of the device input. 0 for an output-only stream.
+   *  @param max_frames Largest block rendered by a graph in one pass. Larger device blocks are split.
+   *  @param sample_rate Stream sample rate in Hz, used to time each route's block.
+   */
+  StreamMixer(unsigned int output_channels, unsigned int input_channels, unsigned int max_frames, unsigned int sample_rate);
+  ~StreamMixer() = default;
+
+  StreamMixer(const StreamMixer &) = delete;
+  StreamMixer &operator=(const StreamMixer &) = delete;
+
+  /** @brief Attach a track to the stream.
+   *  @param graph Compiled graph summed into the output, or nullptr if the track does not play to this device.
+   *  @param capture Buffer filled from the device input, or nullptr if the track does not capture from it.
+   *  @param statistics Statistics that record the time spent rendering the graph. May be nullptr.
+   *  @param gate Transport frames the graph sounds between, or nullptr to always render it.
+   *  @return False if both graph and capture are nullptr.
+   */
+  bool add_route(const AudioGraphPtr &graph, const framework::BufferPtr &capture,
+                 const framework::StreamStatisticsPtr &statistics, const TransportGatePtr &gate = nullptr);
+
+  /** @brief Detach a route added with the same graph and capture Buffer.
+   *  @return False if no such route is attached.
+   */
+  bool remove_route(const AudioGraphPtr &graph, const framework::BufferPtr &capture);
+
+  /** @brief Share a transport with the stream.
+   *  @param transport The session transport, or nullptr to render without one.
+   *  @param drive True if this stream advances the transport and renders its click. Only one stream should drive it.
+   */
+  void set_transport(const TransportPtr &transport, bool drive);
+
+  /** @brief Returns the number of attached routes. */
+  size_t get_route_count() const;
+
+  /** @brief Returns true if any route renders a graph to the output. */
+  bool has_outputs() const;
+
+  /** @brief Returns true if any route captures from the input. */
+  bool has_captures() const;
+
+  unsigned int get_output_channels() const { return m_output_channels; }
+  unsigned int get_input_channels() const { return m_input_channels; }
+  unsigned int get_max_frames() const { return m_max_frames; }
+  unsigned int get_sample_rate() const { return m_sample_rate; }
+
+  /** @brief Distribute a captured block and render the attached graphs into the output.
+   *  @param input Interleaved captured block, or nullptr if the stream has no input.
+   *  @param output Interleaved device buffer, or nullptr if the stream has no output.
+   *  @param n_frames Number of frames in the block.
+   *  @note Audio thread only. Lock-free and allocation-free.
+   */
+  void process(const float *input, float *output, unsigned int n_frames) noexcept;
+
+  std::string to_string() const;
+
+private:
+  /** @struct Route
+   *  @brief One track's attachment to the stream.
+   */
+  struct Route
+  {
+    AudioGraphPtr graph;
+    framework::BufferPtr capture;
+    framework::StreamStatisticsPtr statistics;
+    TransportGatePtr gate;
+  };
+
+  /** @struct RouteTable
+   *  @brief Immutable copy of the routes read by the audio thread.
+   */
+  struct RouteTable
+  {
+    std::vector<Route> routes;
+    TransportPtr transport;
+    bool drive_transport{false};
+  };
+
+  void publish_locked();
+
+  const unsigned int m_output_channels;
+  const unsigned int m_input_channels;
+  const unsigned int m_max_frames;
+  const unsigned int m_sample_rate;
+
+  mutable std::mutex m_routes_mutex;
+  std::vector<Route> m_routes;
+  TransportPtr p_transport;
+  bool m_drive_transport{false};
+  framework::RcuPointer<RouteTable> m_table;
+
+  // One graph's block, summed into the device buffer
+  std::vector<float> m_scratch;
+};
+
+using StreamMixerPtr = std::shared_ptr<StreamMixer>;
+
+} // namespace miniaudioengine::dataplane
+
+#endif // __STREAM_MIXER_H__
@@ -0,0 +1,299 @@
+#ifndef __TRANSPORT_H__
+#define __TRANSPORT_H__
+
+#include "rcupointer.h"
+#include "samplebuffer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace miniaudioengine::dataplane
+{
+
+/** @struct TempoChange
+ *  @brief Tempo and time signature from a frame of the transport timeline onwards.
+ */
+struct TempoChange
+{
+  uint64_t frame{0};
+  double bpm{120.0};            // Beats of beat_unit per minute
+  unsigned int beats_per_bar{4};
+  unsigned int beat_unit{4};
+
+  std::string to_string() const
+  {
+    return "TempoChange(Frame=" + std::to_string(frame) +
+           ", BPM=" + std::to_string(bpm) +
+           ", TimeSignature=" + std::to_string(beats_per_bar) + "/" + std::to_string(beat_unit) + ")";
+  }
+};
+
+/** @class TempoMap
+ *  @brief Immutable mapping between transport frames, beats and bars.
+ *  The map is a sorted list of tempo changes, the first at frame 0. Beats and bars are counted
+ *  continuously across changes, so a change of tempo mid-bar keeps the bar lines where they fall;
+ *  time signature changes are meant to land on a bar line. Every beat lands on a whole frame, the
+ *  same frame for the click and for anything quantised to it.
+ */
+class TempoMap
+{
+public:
+  /** @param changes Tempo changes sorted by frame. The first must be at frame 0.
+   *  @param sample_rate Sample rate of the timeline, in Hz.
+   */
+  TempoMap(const std::vector<TempoChange> &changes, unsigned int sample_rate);
+
+  /** @brief Returns the beat position of a frame, counted from 0 at frame 0. */
+  double get_beat(uint64_t frame) const noexcept;
+
+  /** @brief Returns the bar position of a frame, counted from 0 at frame 0. */
+  double get_bar(uint64_t frame) const noexcept;
+
+  /** @brief Returns the first frame at or after frame that starts a beat. */
+  uint64_t get_next_beat_frame(uint64_t frame) const noexcept;
+
+  /** @brief Returns the first frame at or after frame that starts a bar. */
+  uint64_t get_next_bar_frame(uint64_t frame) const noexcept;
+
+  /** @brief Returns the frame bars bars after the first bar line at or after frame, e.g. the end of a loop. */
+  uint64_t get_frame_after_bars(uint64_t frame, unsigned int bars) const noexcept;
+
+  /** @brief Returns the tempo in effect at a frame. */
+  const TempoChange &get_tempo(uint64_t frame) const noexcept;
+
+  unsigned int get_sample_rate() const noexcept { return m_sample_rate; }
+
+private:
+  /** @struct Segment
+   *  @brief One tempo change with its position on the beat and bar grid.
+   */
+  struct Segment
+  {
+    TempoChange change;
+    double beat;
+    double bar;
+    double frames_per_beat;
+  };
+
+  size_t find(uint64_t frame) const noexcept;
+  uint64_t get_frame(const Segment &segment, double beat) const noexcept;
+
+  std::vector<Segment> m_segments;
+  unsigned int m_sample_rate;
+};
+
+using TempoMapPtr = std::shared_ptr<const TempoMap>;
+
+/** @struct TransportBlock
+ *  @brief The stretch of the transport timeline one audio callback renders.
+ */
+struct TransportBlock
+{
+  uint64_t start{0};
+  unsigned int frames{0};
+  bool playing{false};
+};
+
+/** @class TransportGate
+ *  @brief Transport frames a track starts and stops sounding on, read by the audio thread.
+ *  An open gate lets the track sound whatever the transport does. A start or stop frame only takes
+ *  effect while the transport plays; until the start frame is reached the track is not rendered at
+ *  all, so it begins from its first frame exactly on the quantised position.
+ *  An armed gate keeps the track silent until the transport next runs, whatever frame that is on.
+ *  The first block that moves the transport turns it into a start frame, so every track armed
+ *  before Transport::start() begins on the same frame.
+ */
+class TransportGate
+{
+public:
+  static constexpr uint64_t NEVER = std::numeric_limits<uint64_t>::max();
+
+  void set_start_frame(uint64_t frame) noexcept { m_start_frame.store(frame, std::memory_order_release); }
+  void set_stop_frame(uint64_t frame) noexcept { m_stop_frame.store(frame, std::memory_order_release); }
+
+  uint64_t get_start_frame() const noexcept { return m_start_frame.load(std::memory_order_acquire); }
+  uint64_t get_stop_frame() const noexcept { return m_stop_frame.load(std::memory_order_acquire); }
+
+  /** @brief Let the track sound from now on, until stopped. */
+  void open() noexcept
+  {
+    m_armed.store(false, std::memory_order_release);
+    set_start_frame(0);
+    set_stop_frame(NEVER);
+  }
+
+  /** @brief Keep the track silent until the transport runs, then let it sound from the first frame it runs on. */
+  void arm() noexcept
+  {
+    set_stop_frame(NEVER);
+    m_armed.store(true, std::memory_order_release);
+  }
+
+  /** @brief Undo arm(), keeping any start or stop frame. */
+  void disarm() noexcept { m_armed.store(false, std::memory_order_release); }
+
+  bool is_armed() const noexcept { return m_armed.load(std::memory_order_acquire); }
+
+  /** @brief The transport started running on a frame: sound an armed track from there.
+   *  @note Audio thread of the stream that renders the track.
+   */
+  void fire(uint64_t frame) noexcept
+  {
+    set_start_frame(frame);
+    m_armed.store(false, std::memory_order_release);
+  }
+
+private:
+  std::atomic<bool> m_armed{false};
+  std::atomic<uint64_t> m_start_frame{0};
+  std::atomic<uint64_t> m_stop_frame{NEVER};
+};
+
+using TransportGatePtr = std::shared_ptr<TransportGate>;
+
+/** @class Transport
+ *  @brief Shared sample position, tempo map and metronome click of a session.
+ *  One audio callback drives the transport by calling advance() once per block with the block's
+ *  frame count, so the position is an exact frame count instead of accumulated stream time. Every
+ *  track, and anything else rendering on that callback, reads the same TransportBlock and can start
+ *  or stop on a frame quantised to a beat or bar.
+ *  The click is rendered from beat and accent samples resampled to the stream rate once, when the
+ *  transport is prepared; the audio thread only mixes them in at the beat frames.
+ *  @note Start, stop and locate requests are applied at the start of the next block.
+ */
+class Transport
+{
+public:
+  static constexpr double DEFAULT_BPM = 120.0;
+  static constexpr unsigned int DEFAULT_SAMPLE_RATE = 44100;
+
+  explicit Transport(double bpm = DEFAULT_BPM, unsigned int beats_per_bar = 4, unsigned int beat_unit = 4);
+  ~Transport() = default;
+
+  Transport(const Transport &) = delete;
+  Transport &operator=(const Transport &) = delete;
+
+  /** @brief Set the timeline's sample rate, rebuilding the tempo map and the click samples for it.
+   *  @note Control thread only.
+   */
+  bool prepare(unsigned int sample_rate);
+
+  unsigned int get_sample_rate() const;
+
+  /** @brief Run the transport from its current position. */
+  void start() noexcept { m_play_request.store(true, std::memory_order_release); }
+
+  /** @brief Hold the transport at its current position. */
+  void stop() noexcept { m_play_request.store(false, std::memory_order_release); }
+
+  /** @brief Move the position, e.g. back to 0. */
+  void locate(uint64_t frame) noexcept { m_locate_request.store(frame, std::memory_order_release); }
+
+  /** @brief Returns true if the last rendered block moved the transport. */
+  bool is_playing() const noexcept { return m_block_playing.load(std::memory_order_acquire); }
+
+  /** @brief Returns the transport frame the next block starts on. */
+  uint64_t get_position() const noexcept { return m_position.load(std::memory_order_acquire); }
+
+  /** @brief Returns the transport frame the last rendered block started on. */
+  uint64_t get_block_start() const noexcept { return m_block_start.load(std::memory_order_acquire); }
+
+  /** @brief Replace the tempo map with one tempo and time signature.
+   *  @return False if a value is zero or negative.
+   */
+  bool set_tempo(double bpm, unsigned int beats_per_bar = 4, unsigned int beat_unit = 4);
+
+  /** @brief Add a tempo change, replacing any change on the same frame.
+   *  @return False if a value is zero or negative.
+   */
+  bool add_tempo_change(const TempoChange &change);
+
+  std::vector<TempoChange> get_tempo_changes() const;
+
+  /** @brief Returns the current tempo map, which stays valid after later edits. */
+  TempoMapPtr get_tempo_map() const;
+
+  /** @brief Returns the first beat at or after get_position(). */
+  uint64_t get_next_beat_frame() const;
+
+  /** @brief Returns the first bar line at or after get_position(). */
+  uint64_t get_next_bar_frame() const;
+
+  void set_click_enabled(bool enabled) noexcept { m_click_enabled.store(enabled, std::memory_order_relaxed); }
+  bool is_click_enabled() const noexcept { return m_click_enabled.load(std::memory_order_relaxed); }
+
+  void set_click_gain(float gain) noexcept { m_click_gain.store(gain, std::memory_order_relaxed); }
+  float get_click_gain() const noexcept { return m_click_gain.load(std::memory_order_relaxed); }
+
+  /** @brief Use samples, e.g. from a SampleCache, for the click instead of the built-in one.
+   *  @param beat Played on every beat.
+   *  @param accent Played on the first beat of a bar. nullptr plays beat there too.
+   *  @return False if beat is nullptr or a sample cannot be converted to the stream rate.
+   */
+  bool set_click_samples(const framework::SampleBufferPtr &beat, const framework::SampleBufferPtr &accent = nullptr);
+
+  /** @brief Apply pending requests and move the transport over one block.
+   *  @param n_frames Frames in the callback's block.
+   *  @return The stretch of the timeline the block covers.
+   *  @note Audio thread of the driving stream only. Lock-free and allocation-free.
+   */
+  TransportBlock advance(unsigned int n_frames) noexcept;
+
+  /** @brief Mix the click for a block into an interleaved buffer.
+   *  @note Audio thread of the driving stream only, after advance(). Lock-free and allocation-free.
+   */
+  void render_click(float *output, unsigned int channels, const TransportBlock &block) noexcept;
+
+  std::string to_string() const;
+
+private:
+  static constexpr uint64_t NO_LOCATE = std::numeric_limits<uint64_t>::max();
+
+  /** @struct ClickSamples
+   *  @brief The click at the stream rate, read by the audio thread.
+   */
+  struct ClickSamples
+  {
+    framework::SampleBufferPtr beat;
+    framework::SampleBufferPtr accent;
+  };
+
+  void publish_locked();
+
+  // Control thread state
+  mutable std::mutex m_mutex;
+  std::vector<TempoChange> m_tempo_changes;
+  TempoMapPtr p_tempo_map;
+  framework::SampleBufferPtr p_beat_source;
+  framework::SampleBufferPtr p_accent_source;
+  unsigned int m_sample_rate{0};
+
+  // Published to the audio thread
+  framework::RcuPointer<TempoMap> m_audio_tempo_map;
+  framework::RcuPointer<ClickSamples> m_audio_click;
+
+  std::atomic<bool> m_play_request{false};
+  std::atomic<uint64_t> m_locate_request{NO_LOCATE};
+  std::atomic<bool> m_click_enabled{false};
+  std::atomic<float> m_click_gain{0.5f};
+
+  std::atomic<uint64_t> m_position{0};
+  std::atomic<uint64_t> m_block_start{0};
+  std::atomic<bool> m_block_playing{false};
+
+  // Audio thread only: the click voice, and the next beat it is due on
+  uint64_t m_next_click_frame{0};
+  bool m_voice_accent{false};
+  size_t m_voice_position{std::numeric_limits<size_t>::max()};
+};
+
+using TransportPtr = std::shared_ptr<Transport>;
+
+} // namespace miniaudioengine::dataplane
+
+#endif // __TRANSPORT_H__
@@ -5,6 +5,10 @@
 #include "inputnode.h"
 #include "logger.h"
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
 namespace miniaudioengine::dataplane
 {
 
@@ -40,21 +44,639 @@ IAudioGraphNodePtr AudioGraph::add_node(IAudioGraphNodePtr node, IAudioGraphNode
     return nullptr;
   }
 
+  std::lock_guard<std::mutex> lock(m_graph_mutex);
+
   size_t node_index = IGraph::add_node(node);
   node->set_index(node_index);
+  m_removed.push_back(false);
 
   if (parent)
   {
-    IGraph::add_edge(parent->get_index(), node->get_index());
+    add_edge_locked(parent->get_index(), node->get_index());
   }
 
   LOG_INFO("AudioGraph: Added ", node->to_string());
   return node;
 }
 
+bool AudioGraph::connect(const IAudioGraphNodePtr &parent, const IAudioGraphNodePtr &child)
+{
+  std::lock_guard<std::mutex> lock(m_graph_mutex);
+
+  if (!contains(parent) || !contains(child) || parent == child)
+  {
+    LOG_ERROR("AudioGraph: connect - Both nodes must be distinct nodes of this graph.");
+    return false;
+  }
+  if (IGraph::has_edge(parent->get_index(), child->get_index()))
+  {
+    LOG_ERROR("AudioGraph: connect - ", child->to_string(), " already feeds ", parent->to_string());
+    return false;
+  }
+
+  add_edge_locked(parent->get_index(), child->get_index());
+  return true;
+}
+
+bool AudioGraph::disconnect(const IAudioGraphNodePtr &parent, const IAudioGraphNodePtr &child)
+{
+  std::lock_guard<std::mutex> lock(m_graph_mutex);
+
+  if (!contains(parent) || !contains(child) || !IGraph::has_edge(parent->get_index(), child->get_index()))
+  {
+    LOG_ERROR("AudioGraph: disconnect - No edge between the nodes.");
+    return false;
+  }
+
+  remove_edge_locked(parent->get_index(), child->get_index());
+  return true;
+}
+
+bool AudioGraph::remove_node(const IAudioGraphNodePtr &node)
+{
+  std::lock_guard<std::mutex> lock(m_graph_mutex);
+
+  if (!contains(node) || node->get_index() == 0)
+  {
+    LOG_ERROR("AudioGraph: remove_node - Node is not a removable node of this graph.");
+    return false;
+  }
+
+  const size_t node_index = node->get_index();
+  for (size_t parent = 0; parent < get_node_count(); parent++)
+  {
+    if (IGraph::has_edge(parent, node_index))
+    {
+      remove_edge_locked(parent, node_index);
+    }
+  }
+
+  const std::vector<size_t> children = get_children(node_index);
+  for (const size_t child : children)
+  {
+    remove_edge_locked(node_index, child);
+  }
+
+  m_removed[node_index] = true;
+  LOG_INFO("AudioGraph: Removed ", node->to_string());
+  return true;
+}
+
+bool AudioGraph::contains(const IAudioGraphNodePtr &node) const
+{
+  return node && node->get_index() < get_node_count() && !m_removed[node->get_index()] &&
+         get_node(node->get_index()) == node;
+}
+
+/** @brief Add an edge, or cancel its pending removal so an edge restored within one batch never fades. */
+void AudioGraph::add_edge_locked(size_t parent, size_t child)
+{
+  IGraph::add_edge(parent, child);
+
+  const Edge edge{parent, child};
+  if (std::erase(m_removed_edges, edge) == 0)
+  {
+    m_added_edges.push_back(edge);
+  }
+}
+
+/** @brief Remove an edge, or cancel its pending addition so an edge added and removed within one batch never plays. */
+void AudioGraph::remove_edge_locked(size_t parent, size_t child)
+{
+  IGraph::remove_edge(parent, child);
+
+  const Edge edge{parent, child};
+  if (std::erase(m_added_edges, edge) == 0)
+  {
+    m_removed_edges.push_back(edge);
+  }
+}
+
+bool AudioGraph::compile(unsigned int channels, unsigned int max_frames, unsigned int sample_rate)
+{
+  std::lock_guard<std::mutex> lock(m_graph_mutex);
+
+  if (channels == 0 || max_frames == 0 || sample_rate == 0)
+  {
+    LOG_ERROR("AudioGraph: compile - Invalid plan format. Channels=", channels, ", MaxFrames=", max_frames,
+              ", SampleRate=", sample_rate);
+    return false;
+  }
+
+  return compile_locked(PlanFormat{channels, max_frames, sample_rate, m_resample_quality});
+}
+
+bool AudioGraph::commit()
+{
+  std::lock_guard<std::mutex> lock(m_graph_mutex);
+
+  if (!m_plan.has_value())
+  {
+    LOG_ERROR("AudioGraph: commit - No plan has been compiled yet.");
+    return false;
+  }
+
+  PlanFormat format = m_format;
+  format.resample_quality = m_resample_quality;
+  return compile_locked(format);
+}
+
+bool AudioGraph::has_pending_edits() const
+{
+  std::lock_guard<std::mutex> lock(m_graph_mutex);
+  return !m_added_edges.empty() || !m_removed_edges.empty();
+}
+
+void AudioGraph::set_crossfade_ms(double milliseconds)
+{
+  std::lock_guard<std::mutex> lock(m_graph_mutex);
+  m_crossfade_ms = std::max(0.0, milliseconds);
+}
+
+bool AudioGraph::compile_locked(const PlanFormat &format)
+{
+  const unsigned int channels = format.channels;
+  const unsigned int max_frames = format.max_frames;
+  const unsigned int sample_rate = format.sample_rate;
+
+  if (get_node_count() == 0)
+  {
+    LOG_ERROR("AudioGraph: compile - Graph has no nodes.");
+    return false;
+  }
+
+  if (!std::dynamic_pointer_cast<OutputNode>(get_node(0)))
+  {
+    LOG_ERROR("AudioGraph: compile - Root node must be an OutputNode: ", get_node(0)->to_string());
+    return false;
+  }
+
+  std::vector<size_t> order;
+  if (!sort_nodes(order))
+  {
+    return false;
+  }
+
+  // A plan of the same format replaces the playing one in place: node state carries over and
+  // edited edges crossfade. Any other plan starts from scratch.
+  const bool hot_swap = m_plan.has_value() && format == m_format;
+  const bool had_plan = m_plan.has_value();
+  const unsigned int crossfade_frames = hot_swap ? static_cast<unsigned int>(m_crossfade_ms * sample_rate / 1000.0) : 0;
+
+  // Removed edges stay in the plan until they have faded out
+  std::vector<std::vector<size_t>> retiring_children;
+  if (crossfade_frames > 0 && !m_removed_edges.empty())
+  {
+    retiring_children.resize(get_node_count());
+    for (const auto &[parent, child] : m_removed_edges)
+    {
+      retiring_children[parent].push_back(child);
+    }
+
+    std::vector<size_t> crossfade_order;
+    if (sort_nodes(crossfade_order, &retiring_children))
+    {
+      order.swap(crossfade_order);
+    }
+    else
+    {
+      LOG_WARNING("AudioGraph: compile - Removed edges cycle with the new ones, switching them without a crossfade.");
+      retiring_children.clear();
+    }
+  }
+
+  // Nodes still reachable through live edges. The others only feed edges that are fading out.
+  std::vector<bool> live(get_node_count(), false);
+  live[0] = true;
+  for (auto it = order.rbegin(); it != order.rend(); ++it)
+  {
+    for (const size_t child : get_children(*it))
+    {
+      live[child] = live[child] || live[*it];
+    }
+  }
+
+  // Resolve every node's type, inputs and buffers now so the audio thread never has to
+  auto plan = std::make_unique<GraphPlan>(channels, max_frames);
+  const GraphPlan::NodeKernels &kernels = GraphPlan::get_node_kernels(channels);
+  std::vector<CompiledNode> compiled_nodes(get_node_count());
+  std::vector<size_t> node_tasks(get_node_count(), 0);
+  std::vector<unsigned int> latencies(get_node_count(), 0);
+  std::vector<size_t> inputs;
+  std::vector<size_t> input_nodes;
+  std::vector<eInputFade> fades;
+  std::vector<framework::DelayLine *> delays;
+  bool crossfades = false;
+
+  for (const size_t node_index : order)
+  {
+    const IAudioGraphNodePtr &node = get_node(node_index);
+    const CompiledNode *previous = hot_swap && node_index < m_compiled_nodes.size() ? &m_compiled_nodes[node_index] : nullptr;
+    CompiledNode &compiled = compiled_nodes[node_index];
+
+    // Only a node audible before and after the swap fades its edited inputs. Edges inside a new or
+    // retiring subgraph are already faded where that subgraph joins the rest of the graph.
+    const bool fades_inputs = crossfade_frames > 0 && live[node_index] && previous != nullptr && previous->live;
+    compiled.live = live[node_index];
+
+    inputs.clear();
+    input_nodes.clear();
+    fades.clear();
+    for (const size_t child : get_children(node_index))
+    {
+      const bool added = fades_inputs && std::find(m_added_edges.begin(), m_added_edges.end(), Edge{node_index, child}) != m_added_edges.end();
+      inputs.push_back(node_tasks[child]);
+      input_nodes.push_back(child);
+      fades.push_back(added ? eInputFade::In : eInputFade::None);
+    }
+    if (!retiring_children.empty())
+    {
+      for (const size_t child : retiring_children[node_index])
+      {
+        inputs.push_back(node_tasks[child]);
+        input_nodes.push_back(child);
+        fades.push_back(fades_inputs ? eInputFade::Out : eInputFade::None);
+      }
+    }
+
+    // Delay every input to the slowest one, so parallel paths line up where they are summed
+    unsigned int input_latency = 0;
+    for (const size_t child : input_nodes)
+    {
+      input_latency = std::max(input_latency, latencies[child]);
+    }
+    delays.assign(inputs.size(), nullptr);
+    for (size_t input = 0; input < input_nodes.size(); input++)
+    {
+      const unsigned int compensation = input_latency - latencies[input_nodes[input]];
+      if (compensation > 0)
+      {
+        delays[input] = attach_delay(*plan, input_nodes[input], compensation, format, compiled, previous);
+      }
+    }
+    latencies[node_index] = input_latency;
+
+    NodeTask task;
+    task.node_index = node_index;
+    task.retiring = !live[node_index];
+    crossfades = crossfades || task.retiring ||
+                 std::any_of(fades.begin(), fades.end(), [](eInputFade fade) { return fade != eInputFade::None; });
+
+    if (auto input_node = std::dynamic_pointer_cast<InputNode>(node))
+    {
+      task.process = kernels.input;
+      task.trace_name = "InputNode";
+      task.p_source = input_node->get_source().get();
+      task.p_audio_source = input_node->get_audio_source().get();
+      task.source_channels = input_node->get_source_channels();
+      task.p_underrun_count = input_node->get_underrun_counter();
+      plan->retain(input_node->get_source());
+      plan->retain(input_node->get_audio_source());
+
+      // The resampler's filter history and the drift estimate continue across hot swaps while the source format
+      // is unchanged. A ring buffer on another device's clock is resampled even at the plan's rate, to steer its fill
+      const unsigned int source_rate = input_node->get_source_sample_rate() > 0 ? input_node->get_source_sample_rate() : sample_rate;
+      const bool drift_compensated = input_node->is_drift_compensated() && task.p_source != nullptr;
+      if ((source_rate != sample_rate || drift_compensated) && task.source_channels > 0)
+      {
+        if (previous != nullptr && previous->p_resampler && previous->source_rate == source_rate &&
+            previous->source_channels == task.source_channels && previous->p_resampler->is_adaptive() == drift_compensated)
+        {
+          compiled.p_resampler = previous->p_resampler;
+          compiled.p_drift_estimator = previous->p_drift_estimator;
+        }
+        else
+        {
+          const framework::DriftEstimatorConfig drift_config;
+          auto resampler = std::make_shared<framework::Resampler>();
+          if (!resampler->prepare(source_rate, sample_rate, task.source_channels, max_frames, format.resample_quality,
+                                  drift_compensated ? drift_config.max_correction : 0.0))
+          {
+            LOG_ERROR("AudioGraph: compile - Cannot resample ", node->to_string(), " from ", source_rate, " Hz to ", sample_rate, " Hz");
+            return false;
+          }
+          LOG_INFO("AudioGraph: compile - Resampling ", node->to_string(), " with ", resampler->to_string());
+          compiled.p_resampler = resampler;
+
+          if (drift_compensated)
+          {
+            compiled.p_drift_estimator = std::make_shared<framework::DriftEstimator>();
+            compiled.p_drift_estimator->prepare(drift_config, sample_rate);
+            input_node->get_drift_gauge()->store(0.0, std::memory_order_relaxed);
+          }
+        }
+        compiled.source_rate = source_rate;
+        compiled.source_channels = task.source_channels;
+
+        task.p_resampler = compiled.p_resampler.get();
+        task.p_drift_estimator = compiled.p_drift_estimator.get();
+        task.p_drift_ppm = input_node->get_drift_gauge();
+        plan->retain(compiled.p_drift_estimator);
+        task.scratch_offset = plan->reserve_scratch(task.source_channels, compiled.p_resampler->get_max_input_frames());
+        task.resampled_offset = plan->reserve_scratch(task.source_channels);
+        plan->retain(compiled.p_resampler);
+      }
+      else
+      {
+        task.scratch_offset = plan->reserve_scratch(task.source_channels);
+      }
+    }
+    else if (auto mixer_node = std::dynamic_pointer_cast<MixerNode>(node))
+    {
+      task.process = kernels.mixer;
+      task.trace_name = "MixerNode";
+      task.p_mixer_parameters = mixer_node->get_parameter_snapshot();
+      if (!attach_meter(*plan, task, mixer_node->get_meter(), format, compiled, previous))
+      {
+        return false;
+      }
+    }
+    else if (auto processor_node = std::dynamic_pointer_cast<ProcessorNode>(node))
+    {
+      // Processors allocate in prepare(), before the plan can reach the audio thread. In a new format they
+      // are prepared again, so the playing plan must stop rendering them first
+      if (!hot_swap && m_plan.has_value())
+      {
+        unpublish_locked();
+      }
+      processor_node->prepare(sample_rate, max_frames, channels);
+      latencies[node_index] = processor_node->propagate_latency(input_latency);
+      task.process = kernels.processor;
+      task.trace_name = "ProcessorNode";
+      task.processors_begin = plan->add_processors(processor_node->get_processors());
+      task.processors_count = processor_node->get_processors().size();
+    }
+    else if (auto output_node = std::dynamic_pointer_cast<OutputNode>(node))
+    {
+      if (node_index != 0)
+      {
+        LOG_ERROR("AudioGraph: compile - Only the root node can be an OutputNode: ", node->to_string());
+        return false;
+      }
+      task.process = kernels.output;
+      task.trace_name = "OutputNode";
+      if (!attach_meter(*plan, task, output_node->get_meter(), format, compiled, previous))
+      {
+        return false;
+      }
+    }
+    else
+    {
+      LOG_ERROR("AudioGraph: compile - Unsupported node: ", node->to_string());
+      return false;
+    }
+
+    // The plan holds the nodes so task pointers stay valid if the graph is edited while it plays
+    plan->retain(node);
+    node_tasks[node_index] = plan->add_task(task, inputs, fades, delays);
+  }
+
+  plan->finalize();
+  plan->set_latency_frames(latencies[0]);
+  plan->set_crossfade(crossfades ? crossfade_frames : 0);
+  plan->set_scheduler(p_scheduler);
+  plan->set_midi_queue(p_midi_queue);
+  plan->set_statistics(p_statistics);
+  LOG_INFO("AudioGraph: Compiled ", plan->to_string());
+
+  m_latency_frames = plan->get_latency_frames();
+  m_arena_size_bytes = plan->get_arena_size_bytes();
+  m_peak_arena_size_bytes = std::max(m_peak_arena_size_bytes, m_arena_size_bytes);
+
+  if (!had_plan || p_stream_clock->get_sample_rate() != sample_rate)
+  {
+    p_stream_clock->reset(sample_rate);
+  }
+
+  m_plan.publish(std::move(plan));
+  m_format = format;
+  m_compiled_nodes = std::move(compiled_nodes);
+  m_added_edges.clear();
+  m_removed_edges.clear();
+
+  // Removed nodes have faded out of the published plan, which holds them for as long as it plays
+  for (size_t node_index = 0; node_index < m_removed.size(); node_index++)
+  {
+    if (m_removed[node_index])
+    {
+      IGraph::reset_node(node_index);
+    }
+  }
+  return true;
+}
+
+/** @brief Give a metered node's task a tap. A recompile of the same format keeps the running tap, so
+ *  the meter's peak hold and loudness window continue across the swap.
+ */
+bool AudioGraph::attach_meter(GraphPlan &plan, NodeTask &task, const framework::MeterPtr &meter,
+                              const PlanFormat &format, CompiledNode &compiled, const CompiledNode *previous) const
+{
+  if (!meter)
+  {
+    return true;
+  }
+
+  if (previous != nullptr && previous->p_meter == meter && previous->p_meter_tap)
+  {
+    compiled.p_meter_tap = previous->p_meter_tap;
+  }
+  else
+  {
+    compiled.p_meter_tap = std::make_shared<framework::MeterTap>();
+    if (!compiled.p_meter_tap->prepare(meter, format.channels, format.sample_rate))
+    {
+      LOG_ERROR("AudioGraph: compile - Cannot meter node ", task.node_index);
+      return false;
+    }
+  }
+
+  compiled.p_meter = meter;
+  task.p_meter = compiled.p_meter_tap.get();
+  plan.retain(compiled.p_meter_tap);
+  return true;
+}
+
+/** @brief Give a task the line that delays one of its inputs. A recompile of the same format keeps a
+ *  running line of the same length, so the delayed path plays on without a gap.
+ */
+framework::DelayLine *AudioGraph::attach_delay(GraphPlan &plan, size_t child, unsigned int delay_frames,
+                                               const PlanFormat &format, CompiledNode &compiled,
+                                               const CompiledNode *previous) const
+{
+  framework::DelayLinePtr delay;
+  if (previous != nullptr)
+  {
+    for (const auto &[previous_child, previous_delay] : previous->p_input_delays)
+    {
+      if (previous_child == child && previous_delay->get_delay_frames() == delay_frames)
+      {
+        delay = previous_delay;
+      }
+    }
+  }
+
+  if (!delay)
+  {
+    delay = std::make_shared<framework::DelayLine>();
+    delay->prepare(format.channels, delay_frames, format.max_frames);
+    LOG_INFO("AudioGraph: compile - Compensating node ", child, " with ", delay->to_string());
+  }
+
+  compiled.p_input_delays.emplace_back(child, delay);
+  plan.retain(delay);
+  return delay.get();
+}
+
+void AudioGraph::set_worker_threads(unsigned int worker_threads, bool realtime)
+{
+  std::lock_guard<std::mutex> lock(m_graph_mutex);
+
+  // Published plans keep their scheduler alive until they are retired
+  p_scheduler = worker_threads > 0 ? std::make_shared<GraphScheduler>(worker_threads, realtime) : nullptr;
+}
+
+void AudioGraph::set_resample_quality(framework::eResampleQuality quality)
+{
+  std::lock_guard<std::mutex> lock(m_graph_mutex);
+  m_resample_quality = quality;
+}
+
+void AudioGraph::set_midi_queue(const framework::MidiQueuePtr &queue)
+{
+  std::lock_guard<std::mutex> lock(m_graph_mutex);
+  p_midi_queue = queue;
+}
+
+void AudioGraph::set_statistics(const framework::StreamStatisticsPtr &statistics)
+{
+  std::lock_guard<std::mutex> lock(m_graph_mutex);
+  p_statistics = statistics;
+}
+
+void AudioGraph::unpublish_locked()
+{
+  LOG_INFO("AudioGraph: Unpublishing the playing plan to prepare its processors for a new format.");
+  m_plan.publish(nullptr);
+
+  // The audio thread renders silence from its next block and leaves the old plan within one block
+  m_plan.reclaim();
+  while (m_plan.get_retired_count() > 0)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    m_plan.reclaim();
+  }
+}
+
+bool AudioGraph::process(float *output, unsigned int n_frames) noexcept
+{
+  auto plan = m_plan.read();
+  if (!plan)
+  {
+    return false;
+  }
+
+  plan->render(output, n_frames, p_stream_clock->advance(n_frames));
+  return true;
+}
+
+unsigned int AudioGraph::get_channels() const
+{
+  std::lock_guard<std::mutex> lock(m_graph_mutex);
+  return m_plan.has_value() ? m_format.channels : 0;
+}
+
+unsigned int AudioGraph::get_latency_frames() const
+{
+  std::lock_guard<std::mutex> lock(m_graph_mutex);
+  return m_plan.has_value() ? m_latency_frames : 0;
+}
+
+size_t AudioGraph::get_arena_size_bytes() const
+{
+  std::lock_guard<std::mutex> lock(m_graph_mutex);
+  return m_plan.has_value() ? m_arena_size_bytes : 0;
+}
+
+size_t AudioGraph::get_peak_arena_size_bytes() const
+{
+  std::lock_guard<std::mutex> lock(m_graph_mutex);
+  return m_peak_arena_size_bytes;
+}
+
+/** @brief Order the nodes reachable from the root so every child comes before its parent.
+ *  Uses an explicit stack rather than recursion so deep graphs cannot overflow the stack.
+ *  @param order Receives the node indices in execution order, ending with the root.
+ *  @param retiring_children Children still fading out of each node, visited after its live children.
+ *         Cycles are only reported for the live graph.
+ *  @return False if the graph contains a cycle.
+ */
+bool AudioGraph::sort_nodes(std::vector<size_t> &order, const std::vector<std::vector<size_t>> *retiring_children) const
+{
+  enum class eVisit : unsigned char
+  {
+    Unvisited,
+    InProgress,
+    Done
+  };
+
+  const size_t node_count = get_node_count();
+  std::vector<eVisit> visits(node_count, eVisit::Unvisited);
+
+  // Each entry is a node and the position of the next child to visit
+  std::vector<std::pair<size_t, size_t>> stack;
+  stack.emplace_back(0, 0);
+  visits[0] = eVisit::InProgress;
+  order.clear();
+  order.reserve(node_count);
+
+  while (!stack.empty())
+  {
+    auto &[node_index, next_child] = stack.back();
+    const std::vector<size_t> &children = get_children(node_index);
+    const size_t retiring_count = retiring_children != nullptr ? (*retiring_children)[node_index].size() : 0;
+
+    if (next_child == children.size() + retiring_count)
+    {
+      visits[node_index] = eVisit::Done;
+      order.push_back(node_index);
+      stack.pop_back();
+      continue;
+    }
+
+    const size_t child = next_child < children.size() ? children[next_child] : (*retiring_children)[node_index][next_child - children.size()];
+    next_child++;
+    switch (visits[child])
+    {
+      case eVisit::Unvisited:
+        visits[child] = eVisit::InProgress;
+        stack.emplace_back(child, 0);
+        break;
+      case eVisit::InProgress:
+        if (retiring_children == nullptr)
+        {
+          LOG_ERROR("AudioGraph: compile - Cycle detected at ", get_node(child)->to_string());
+        }
+        return false;
+      case eVisit::Done:
+        // Shared child, its buffer is read by more than one parent
+        break;
+    }
+  }
+
+  const size_t removed = static_cast<size_t>(std::count(m_removed.begin(), m_removed.end(), true));
+  if (retiring_children == nullptr && order.size() + removed < node_count)
+  {
+    LOG_WARNING("AudioGraph: compile - ", node_count - removed - order.size(), " node(s) are not connected to the output and will not be rendered.");
+  }
+
+  return true;
+}
+
 std::string AudioGraph::to_string() const
 {
+  std::lock_guard<std::mutex> lock(m_graph_mutex);
   std::string str = "AudioGraph(";
+  str += "Nodes=" + std::to_string(get_node_count());
   str += ")";
   return str;
 }
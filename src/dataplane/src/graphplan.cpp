@@ -0,0 +1,575 @@
+#include "graphplan.h"
+#include "graphscheduler.h"
+#include "mixernode.h"
+#include "dspkernels.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace miniaudioengine::dataplane;
+
+void GraphPlan::render(float *output, unsigned int n_frames, uint64_t block_start) noexcept
+{
+  drain_midi(n_frames, block_start);
+
+  unsigned int frames_rendered = 0;
+  while (frames_rendered < n_frames)
+  {
+    const unsigned int block_frames = std::min(n_frames - frames_rendered, m_max_frames);
+    p_output = output + static_cast<size_t>(frames_rendered) * m_channels;
+
+    m_pass_events.clear();
+    m_pass_events.add_range(m_block_events, frames_rendered, frames_rendered + block_frames);
+    prepare_crossfade(block_frames);
+
+    if (p_scheduler != nullptr)
+    {
+      p_scheduler->run(*this, block_frames);
+    }
+    else
+    {
+      run_serial(block_frames);
+    }
+
+    m_crossfade_position = std::min(m_crossfade_position + block_frames, m_crossfade_frames);
+    frames_rendered += block_frames;
+  }
+}
+
+/** @brief Fill the gains of faded inputs for the next pass, linear from the current crossfade position. */
+void GraphPlan::prepare_crossfade(unsigned int n_frames) noexcept
+{
+  if (!is_crossfading())
+  {
+    return;
+  }
+
+  const float step = 1.0f / static_cast<float>(m_crossfade_frames);
+  const float start = static_cast<float>(m_crossfade_position) * step;
+  framework::dsp::fill_ramp(m_fade_in.data(), start, step, n_frames);
+  framework::dsp::clamp(m_fade_in.data(), 0.0f, 1.0f, n_frames);
+  framework::dsp::fill_ramp(m_fade_out.data(), 1.0f - start, -step, n_frames);
+  framework::dsp::clamp(m_fade_out.data(), 0.0f, 1.0f, n_frames);
+}
+
+/** @brief Pop the messages queued since the last block and place them on this block's frames.
+ *  Messages are stamped while the previous block plays, so each is delayed by one block. That keeps
+ *  the spacing between messages intact instead of snapping them all to the start of a block.
+ */
+void GraphPlan::drain_midi(unsigned int n_frames, uint64_t block_start) noexcept
+{
+  m_block_events.clear();
+  if (p_midi_queue == nullptr || n_frames == 0)
+  {
+    return;
+  }
+
+  midi::MidiEvent event;
+  unsigned int previous_offset = 0;
+  while (m_block_events.size() < m_block_events.capacity() && p_midi_queue->try_pop(event.message))
+  {
+    const uint64_t due = event.message.timestamp + n_frames;
+    const unsigned int offset = due > block_start ? static_cast<unsigned int>(std::min<uint64_t>(due - block_start, n_frames - 1)) : 0;
+
+    // Never reorder messages, e.g. a note off ahead of its note on
+    event.frame_offset = std::max(offset, previous_offset);
+    previous_offset = event.frame_offset;
+    m_block_events.add(event);
+  }
+}
+
+void GraphPlan::run_serial(unsigned int n_frames) noexcept
+{
+  for (const NodeTask &task : m_tasks)
+  {
+    run_task(task, n_frames);
+  }
+}
+
+size_t GraphPlan::add_task(NodeTask task, std::span<const size_t> inputs, std::span<const eInputFade> fades,
+                           std::span<framework::DelayLine *const> delays)
+{
+  task.inputs_begin = m_input_tasks.size();
+  task.inputs_count = inputs.size();
+  task.has_input_fades = std::any_of(fades.begin(), fades.end(), [](eInputFade fade) { return fade != eInputFade::None; });
+  task.has_input_delays = std::any_of(delays.begin(), delays.end(), [](const framework::DelayLine *delay) { return delay != nullptr; });
+  m_input_tasks.insert(m_input_tasks.end(), inputs.begin(), inputs.end());
+
+  // Fades and delays stay parallel to the input lists, so tasks without any still get entries
+  m_input_fades.resize(m_input_tasks.size(), eInputFade::None);
+  if (task.has_input_fades)
+  {
+    std::copy_n(fades.begin(), std::min(fades.size(), inputs.size()), m_input_fades.begin() + task.inputs_begin);
+  }
+  m_input_delays.resize(m_input_tasks.size(), nullptr);
+  if (task.has_input_delays)
+  {
+    std::copy_n(delays.begin(), std::min(delays.size(), inputs.size()), m_input_delays.begin() + task.inputs_begin);
+  }
+
+  m_tasks.push_back(task);
+  return m_tasks.size() - 1;
+}
+
+void GraphPlan::set_crossfade(unsigned int frames)
+{
+  m_crossfade_frames = frames;
+  m_crossfade_position = 0;
+  m_fade_in.assign(frames > 0 ? m_max_frames : 0, 1.0f);
+  m_fade_out.assign(frames > 0 ? m_max_frames : 0, 0.0f);
+}
+
+size_t GraphPlan::add_processors(std::span<const framework::IProcessorPtr> processors)
+{
+  const size_t begin = m_processors.size();
+  for (const framework::IProcessorPtr &processor : processors)
+  {
+    m_processors.push_back(processor.get());
+    retain(processor);
+  }
+  return begin;
+}
+
+void GraphPlan::set_statistics(const framework::StreamStatisticsPtr &statistics)
+{
+  p_statistics = statistics.get();
+  retain(statistics);
+}
+
+void GraphPlan::set_midi_queue(const framework::MidiQueuePtr &queue)
+{
+  p_midi_queue = queue.get();
+  if (queue)
+  {
+    m_block_events.reserve(MAX_MIDI_MESSAGES);
+    m_pass_events.reserve(MAX_MIDI_MESSAGES);
+  }
+  retain(queue);
+}
+
+void GraphPlan::set_scheduler(const std::shared_ptr<GraphScheduler> &scheduler)
+{
+  if (scheduler && m_tasks.size() > scheduler->get_max_tasks())
+  {
+    LOG_WARNING("GraphPlan: ", m_tasks.size(), " tasks exceed the scheduler limit of ", scheduler->get_max_tasks(), ". Rendering on the audio thread.");
+    return;
+  }
+
+  p_scheduler = scheduler.get();
+  retain(scheduler);
+}
+
+size_t GraphPlan::reserve_scratch(unsigned int channels, size_t frames)
+{
+  const size_t offset = m_scratch.size();
+  m_scratch.resize(offset + static_cast<size_t>(channels) * (frames > 0 ? frames : m_max_frames));
+  return offset;
+}
+
+void GraphPlan::finalize()
+{
+  // Invert the input lists so each task knows which tasks it unblocks
+  std::vector<size_t> dependent_counts(m_tasks.size(), 0);
+  for (const size_t input : m_input_tasks)
+  {
+    dependent_counts[input]++;
+  }
+
+  size_t offset = 0;
+  for (size_t i = 0; i < m_tasks.size(); i++)
+  {
+    m_tasks[i].dependents_begin = offset;
+    m_tasks[i].dependents_count = 0;
+    offset += dependent_counts[i];
+  }
+
+  m_dependents.resize(offset);
+  m_leaf_tasks.clear();
+  for (size_t i = 0; i < m_tasks.size(); i++)
+  {
+    for (const size_t input : std::span<const size_t>(m_input_tasks.data() + m_tasks[i].inputs_begin, m_tasks[i].inputs_count))
+    {
+      NodeTask &producer = m_tasks[input];
+      m_dependents[producer.dependents_begin + producer.dependents_count++] = static_cast<unsigned int>(i);
+    }
+
+    if (m_tasks[i].inputs_count == 0)
+    {
+      m_leaf_tasks.push_back(static_cast<unsigned int>(i));
+    }
+  }
+
+  p_pending = std::make_unique<std::atomic<unsigned int>[]>(m_tasks.size());
+  reset_dependencies();
+
+  assign_buffers();
+
+  m_input_buffers.resize(m_input_tasks.size());
+  for (size_t i = 0; i < m_input_tasks.size(); i++)
+  {
+    m_input_buffers[i] = m_tasks[m_input_tasks[i]].output_buffer;
+  }
+
+  m_arena.allocate(m_buffer_count, m_channels, m_max_frames);
+
+  m_channel_pointers.resize(m_buffer_count * m_channels);
+  for (size_t buffer = 0; buffer < m_buffer_count; buffer++)
+  {
+    for (unsigned int channel = 0; channel < m_channels; channel++)
+    {
+      m_channel_pointers[buffer * m_channels + channel] = m_arena.get_channel(buffer, channel);
+    }
+  }
+}
+
+/** @brief Assign each task an arena buffer, reusing buffers whose contents are no longer needed.
+ *  A task may take over a buffer only once every reader of the buffer's current contents is
+ *  guaranteed to have finished, i.e. each reader is a transitive input of the task. That holds for
+ *  every schedule the GraphScheduler can produce, not just the serial order. A task may also run in
+ *  place on the buffer of its first input when no other pending task reads it.
+ */
+void GraphPlan::assign_buffers()
+{
+  const size_t task_count = m_tasks.size();
+  const size_t words = (task_count + 63) / 64;
+
+  // completed[t] holds every task that has finished before task t can start
+  std::vector<uint64_t> completed(task_count * words, 0);
+  auto has_completed = [&](size_t task, size_t other) {
+    return (completed[task * words + other / 64] >> (other % 64)) & 1;
+  };
+
+  for (size_t task = 0; task < task_count; task++)
+  {
+    uint64_t *row = completed.data() + task * words;
+    for (size_t i = 0; i < m_tasks[task].inputs_count; i++)
+    {
+      const size_t input = m_input_tasks[m_tasks[task].inputs_begin + i];
+      const uint64_t *input_row = completed.data() + input * words;
+      for (size_t word = 0; word < words; word++)
+      {
+        row[word] |= input_row[word];
+      }
+      row[input / 64] |= uint64_t(1) << (input % 64);
+    }
+  }
+
+  // Each buffer remembers the task whose output it holds, which tasks still read it
+  std::vector<size_t> producers;
+  std::vector<std::span<const unsigned int>> readers;
+
+  for (size_t task = 0; task < task_count; task++)
+  {
+    NodeTask &current = m_tasks[task];
+    const size_t first_input = current.inputs_count > 0 ? m_input_tasks[current.inputs_begin] : SIZE_MAX;
+
+    auto is_free = [&](size_t buffer) {
+      for (const unsigned int reader : readers[buffer])
+      {
+        const bool in_place = reader == task && producers[buffer] == first_input;
+        if (!in_place && !has_completed(task, reader))
+        {
+          return false;
+        }
+      }
+      return true;
+    };
+
+    // Prefer working in place on the first input, then any dead buffer, then a new one
+    size_t chosen = SIZE_MAX;
+    if (first_input != SIZE_MAX && is_free(m_tasks[first_input].output_buffer))
+    {
+      chosen = m_tasks[first_input].output_buffer;
+    }
+
+    for (size_t buffer = 0; chosen == SIZE_MAX && buffer < producers.size(); buffer++)
+    {
+      if (is_free(buffer))
+      {
+        chosen = buffer;
+      }
+    }
+
+    if (chosen == SIZE_MAX)
+    {
+      chosen = producers.size();
+      producers.emplace_back();
+      readers.emplace_back();
+    }
+
+    current.output_buffer = chosen;
+    producers[chosen] = task;
+    readers[chosen] = get_dependents(current);
+  }
+
+  m_buffer_count = producers.size();
+}
+
+std::string GraphPlan::to_string() const
+{
+  return "GraphPlan(Tasks=" + std::to_string(m_tasks.size()) +
+         ", Buffers=" + std::to_string(m_buffer_count) +
+         ", ArenaBytes=" + std::to_string(get_arena_size_bytes()) +
+         ", UnsharedBytes=" + std::to_string(get_unshared_size_bytes()) +
+         ", Channels=" + std::to_string(m_channels) +
+         ", MaxFrames=" + std::to_string(m_max_frames) +
+         ", LatencyFrames=" + std::to_string(m_latency_frames) +
+         ", CrossfadeFrames=" + std::to_string(m_crossfade_frames) + ")";
+}
+
+template <unsigned int Channels>
+void GraphPlan::sum_inputs(const NodeTask &task, unsigned int n_frames) noexcept
+{
+  const std::span<const size_t> inputs = get_inputs(task);
+  const std::span<const eInputFade> fades = get_input_fades(task);
+  const std::span<framework::DelayLine *const> delays = get_input_delays(task);
+  const unsigned int channels = Channels > 0 ? Channels : m_channels;
+
+  for (unsigned int channel = 0; channel < channels; channel++)
+  {
+    float *destination = get_channel(task.output_buffer, channel);
+    if (inputs.empty())
+    {
+      std::fill_n(destination, n_frames, 0.0f);
+      continue;
+    }
+
+    for (size_t input = 0; input < inputs.size(); input++)
+    {
+      // The first input may share the destination when the task runs in place. A delayed input
+      // is read from its delay line, which every pass must feed to stay in step.
+      const float *source = get_channel(inputs[input], channel);
+      if (!delays.empty() && delays[input] != nullptr)
+      {
+        source = delays[input]->process(channel, source, n_frames);
+      }
+      const eInputFade fade = fades.empty() ? eInputFade::None : fades[input];
+      const float *gains = nullptr;
+      if (fade != eInputFade::None && is_crossfading())
+      {
+        gains = fade == eInputFade::In ? m_fade_in.data() : m_fade_out.data();
+      }
+      else if (fade == eInputFade::Out)
+      {
+        // Faded out, the retiring input is no longer rendered
+        if (input == 0)
+        {
+          std::fill_n(destination, n_frames, 0.0f);
+        }
+        continue;
+      }
+
+      if (input == 0)
+      {
+        if (source != destination)
+        {
+          std::copy_n(source, n_frames, destination);
+        }
+        if (gains != nullptr)
+        {
+          framework::dsp::multiply(destination, gains, n_frames);
+        }
+      }
+      else if (gains != nullptr)
+      {
+        for (unsigned int frame = 0; frame < n_frames; frame++)
+        {
+          destination[frame] += source[frame] * gains[frame];
+        }
+      }
+      else
+      {
+        framework::dsp::add(destination, source, n_frames);
+      }
+    }
+  }
+}
+
+template <unsigned int Channels>
+void GraphPlan::process_input(const NodeTask &task, GraphPlan &plan, unsigned int n_frames) noexcept
+{
+  const unsigned int channels = Channels > 0 ? Channels : plan.get_channels();
+  const unsigned int source_channels = task.source_channels;
+  size_t frames_read = 0;
+
+  if ((task.p_source != nullptr || task.p_audio_source != nullptr) && source_channels > 0)
+  {
+    // The fill is steered in frames at the plan's rate, at most half the ring so the writer never runs into it
+    if (task.p_drift_estimator != nullptr && task.p_source != nullptr)
+    {
+      const double scale = static_cast<double>(task.p_resampler->get_target_rate()) / task.p_resampler->get_source_rate();
+      const size_t fill_frames = static_cast<size_t>(static_cast<double>(task.p_source->size() / source_channels) * scale);
+      const size_t max_target_frames = static_cast<size_t>(static_cast<double>(task.p_source->capacity() / source_channels) * scale) / 2;
+      task.p_resampler->set_rate_correction(task.p_drift_estimator->track(fill_frames, max_target_frames, n_frames));
+      task.p_drift_ppm->store(task.p_drift_estimator->get_drift() * 1e6, std::memory_order_relaxed);
+    }
+
+    // A resampled source is read at its own rate, so a block can take more or fewer frames than it renders
+    const size_t frames_wanted = task.p_resampler != nullptr ? task.p_resampler->get_input_frames_needed(n_frames) : n_frames;
+    float *scratch = plan.get_scratch(task);
+
+    if (task.p_audio_source != nullptr)
+    {
+      if (plan.get_statistics() != nullptr)
+      {
+        plan.get_statistics()->record_ring_fill(task.p_audio_source->get_available_frames() * source_channels);
+      }
+      TRACE_COUNTER("InputRingFill", task.node_index, task.p_audio_source->get_available_frames() * source_channels);
+      frames_read = task.p_audio_source->read_frames(scratch, frames_wanted);
+    }
+    else
+    {
+      // Only consume whole frames so the channel interleaving never slips
+      const size_t samples_available = task.p_source->size();
+      const size_t frames_available = samples_available / source_channels;
+      if (plan.get_statistics() != nullptr)
+      {
+        plan.get_statistics()->record_ring_fill(samples_available);
+      }
+      TRACE_COUNTER("InputRingFill", task.node_index, samples_available);
+      const size_t frames_to_read = std::min(frames_wanted, frames_available);
+      frames_read = task.p_source->read(std::span<float>(scratch, frames_to_read * source_channels)) / source_channels;
+    }
+
+    if (task.p_resampler != nullptr)
+    {
+      float *resampled = plan.get_resampled_scratch(task);
+      frames_read = task.p_resampler->process(scratch, frames_read, resampled, n_frames);
+      scratch = resampled;
+    }
+
+    if (source_channels == channels)
+    {
+      const size_t stride = plan.get_channel(task.output_buffer, 1 % channels) - plan.get_channel(task.output_buffer, 0);
+      if constexpr (Channels > 0)
+      {
+        framework::dsp::deinterleave<Channels>(plan.get_channel(task.output_buffer, 0), stride, scratch, frames_read);
+      }
+      else
+      {
+        framework::dsp::deinterleave(plan.get_channel(task.output_buffer, 0), stride, scratch, channels, frames_read);
+      }
+    }
+
+    for (unsigned int channel = 0; source_channels != channels && channel < channels; channel++)
+    {
+      float *destination = plan.get_channel(task.output_buffer, channel);
+
+      // Mono sources are copied to every channel, missing channels of other sources are silent
+      if (channel >= source_channels && source_channels != 1)
+      {
+        std::fill_n(destination, frames_read, 0.0f);
+        continue;
+      }
+
+      const unsigned int source_channel = channel < source_channels ? channel : 0;
+      for (size_t frame = 0; frame < frames_read; frame++)
+      {
+        destination[frame] = scratch[frame * source_channels + source_channel];
+      }
+    }
+  }
+
+  if (frames_read < n_frames)
+  {
+    // Underrun - never wait on the producer, fill the rest of the block with silence
+    for (unsigned int channel = 0; channel < channels; channel++)
+    {
+      std::fill(plan.get_channel(task.output_buffer, channel) + frames_read,
+                plan.get_channel(task.output_buffer, channel) + n_frames, 0.0f);
+    }
+
+    if (task.p_underrun_count != nullptr)
+    {
+      task.p_underrun_count->fetch_add(1, std::memory_order_relaxed);
+    }
+    if (task.p_drift_estimator != nullptr)
+    {
+      task.p_drift_estimator->raise_target(n_frames);
+    }
+    TRACE_INSTANT("InputUnderrun");
+    if (plan.get_statistics() != nullptr)
+    {
+      plan.get_statistics()->record_underrun();
+    }
+  }
+}
+
+template <unsigned int Channels>
+void GraphPlan::process_mixer(const NodeTask &task, GraphPlan &plan, unsigned int n_frames) noexcept
+{
+  plan.sum_inputs<Channels>(task, n_frames);
+
+  // Gain and pan come from the same published set, never one old and one new
+  const MixerParameters parameters = task.p_mixer_parameters != nullptr ? task.p_mixer_parameters->read() : MixerParameters();
+  const float gain = parameters.gain;
+  const float pan = parameters.pan;
+  const unsigned int channels = Channels > 0 ? Channels : plan.get_channels();
+  // Unity gain at centre leaves the bus as summed
+  if (gain != 1.0f || pan != 0.0f)
+  {
+    if (channels == 2)
+    {
+      // Constant-power law normalised to unity at centre
+      constexpr float sqrt2 = 1.41421356237f;
+      const framework::dsp::PanGains gains = framework::dsp::constant_power_pan(pan);
+      framework::dsp::scale(plan.get_channel(task.output_buffer, 0), gain * gains.left * sqrt2, n_frames);
+      framework::dsp::scale(plan.get_channel(task.output_buffer, 1), gain * gains.right * sqrt2, n_frames);
+    }
+    else
+    {
+      for (unsigned int channel = 0; channel < channels; channel++)
+      {
+        framework::dsp::scale(plan.get_channel(task.output_buffer, channel), gain, n_frames);
+      }
+    }
+  }
+
+  // Post-fader, while the bus is still in cache
+  if (task.p_meter != nullptr)
+  {
+    task.p_meter->process(plan.get_channel_pointers(task.output_buffer), n_frames);
+  }
+}
+
+template <unsigned int Channels>
+void GraphPlan::process_processor(const NodeTask &task, GraphPlan &plan, unsigned int n_frames) noexcept
+{
+  plan.sum_inputs<Channels>(task, n_frames);
+
+  framework::AudioBlockView block(plan.get_channel_pointers(task.output_buffer), Channels > 0 ? Channels : plan.get_channels(), n_frames);
+  for (framework::IProcessor *processor : plan.get_processors(task))
+  {
+    processor->process(block, plan.get_midi_events());
+  }
+}
+
+template <unsigned int Channels>
+void GraphPlan::process_output(const NodeTask &task, GraphPlan &plan, unsigned int n_frames) noexcept
+{
+  plan.sum_inputs<Channels>(task, n_frames);
+  if (task.p_meter != nullptr)
+  {
+    task.p_meter->process(plan.get_channel_pointers(task.output_buffer), n_frames);
+  }
+
+  const unsigned int channels = Channels > 0 ? Channels : plan.get_channels();
+  const size_t stride = plan.get_channel(task.output_buffer, 1 % channels) - plan.get_channel(task.output_buffer, 0);
+  if constexpr (Channels > 0)
+  {
+    framework::dsp::interleave<Channels>(plan.get_output(), plan.get_channel(task.output_buffer, 0), stride, n_frames);
+  }
+  else
+  {
+    framework::dsp::interleave(plan.get_output(), plan.get_channel(task.output_buffer, 0), stride, channels, n_frames);
+  }
+}
+
+const GraphPlan::NodeKernels &GraphPlan::get_node_kernels(unsigned int channels) noexcept
+{
+  static constexpr NodeKernels mono = {&process_input<1>, &process_mixer<1>, &process_processor<1>, &process_output<1>};
+  static constexpr NodeKernels stereo = {&process_input<2>, &process_mixer<2>, &process_processor<2>, &process_output<2>};
+  static constexpr NodeKernels generic = {&process_input<0>, &process_mixer<0>, &process_processor<0>, &process_output<0>};
+  return channels == 1 ? mono : channels == 2 ? stereo : generic;
+}
@@ -0,0 +1,221 @@
+#include "graphscheduler.h"
+#include "denormals.h"
+#include "graphplan.h"
+#include "logger.h"
+#include "realtime_assert.h"
+#include "realtimememory.h"
+#include "threading.h"
+
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+using namespace miniaudioengine::dataplane;
+
+namespace
+{
+
+/** @brief Number of polls a worker makes for the next pass before going to sleep. */
+constexpr unsigned int SPIN_ITERATIONS = 4096;
+
+inline void cpu_relax() noexcept
+{
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+} // namespace
+
+GraphScheduler::GraphScheduler(unsigned int worker_threads, bool realtime) :
+  m_realtime(realtime)
+{
+  m_workers.reserve(worker_threads + 1);
+  for (unsigned int i = 0; i <= worker_threads; i++)
+  {
+    m_workers.push_back(std::make_unique<Worker>());
+  }
+
+  // Worker 0 is the audio thread
+  for (size_t i = 1; i < m_workers.size(); i++)
+  {
+    m_workers[i]->thread = std::thread(&GraphScheduler::worker_loop, this, i);
+  }
+
+  LOG_INFO("GraphScheduler: Started ", worker_threads, " worker thread(s). Realtime=", (realtime ? "Yes" : "No"));
+}
+
+GraphScheduler::~GraphScheduler()
+{
+  m_stop.store(true, std::memory_order_release);
+  m_generation.fetch_add(1, std::memory_order_release);
+  m_generation.notify_all();
+
+  for (size_t i = 1; i < m_workers.size(); i++)
+  {
+    if (m_workers[i]->thread.joinable())
+    {
+      m_workers[i]->thread.join();
+    }
+  }
+}
+
+void GraphScheduler::run(GraphPlan &plan, unsigned int n_frames) noexcept
+{
+  const std::vector<NodeTask> &tasks = plan.get_tasks();
+  if (m_workers.size() == 1 || tasks.size() <= 1)
+  {
+    plan.run_serial(n_frames);
+    return;
+  }
+
+  plan.reset_dependencies();
+  p_plan.store(&plan, std::memory_order_relaxed);
+  m_frames.store(n_frames, std::memory_order_relaxed);
+  m_remaining.store(tasks.size(), std::memory_order_relaxed);
+
+  Worker &self = *m_workers[0];
+  for (const unsigned int leaf : plan.get_leaf_tasks())
+  {
+    self.deque.push(leaf);
+  }
+
+  // Start the pass, only paying for a wake-up when a worker has gone to sleep
+  m_generation.fetch_add(1, std::memory_order_acq_rel);
+  if (m_sleeping.load(std::memory_order_acquire) > 0)
+  {
+    m_generation.notify_all();
+  }
+
+  while (m_remaining.load(std::memory_order_acquire) > 0)
+  {
+    if (!execute_one(0))
+    {
+      cpu_relax();
+    }
+  }
+
+  // Denormals flushed on a worker count against the block the audio thread is rendering
+  if (m_worker_denormals.load(std::memory_order_relaxed) && m_worker_denormals.exchange(false, std::memory_order_relaxed))
+  {
+    framework::raise_denormal_flags();
+  }
+}
+
+void GraphScheduler::worker_loop(size_t index)
+{
+  // Realtime workers take the realtime cores after the audio thread's, which is worker 0
+  framework::threading::register_current_thread("GraphScheduler" + std::to_string(index),
+                                                m_realtime ? framework::eThreadClass::Worker : framework::eThreadClass::Normal,
+                                                static_cast<unsigned int>(index));
+  framework::realtime_memory::prefault_stack();
+
+  uint64_t generation = m_generation.load(std::memory_order_acquire);
+  while (!m_stop.load(std::memory_order_acquire))
+  {
+    // Wait for the next pass, spinning first since passes arrive once per audio period
+    unsigned int spins = 0;
+    while (m_generation.load(std::memory_order_acquire) == generation && spins < SPIN_ITERATIONS)
+    {
+      cpu_relax();
+      spins++;
+    }
+
+    if (m_generation.load(std::memory_order_acquire) == generation)
+    {
+      m_sleeping.fetch_add(1, std::memory_order_acq_rel);
+      m_generation.wait(generation, std::memory_order_acquire);
+      m_sleeping.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    generation = m_generation.load(std::memory_order_acquire);
+    if (m_stop.load(std::memory_order_acquire))
+    {
+      break;
+    }
+
+    // Workers render on behalf of the audio thread and follow the same rules
+    {
+      RT_ASSERT_NO_ALLOCATIONS();
+      RT_ASSERT_NO_LOCKS();
+      framework::ScopedFlushDenormals flush_denormals;
+      while (m_remaining.load(std::memory_order_acquire) > 0)
+      {
+        if (!execute_one(index))
+        {
+          cpu_relax();
+        }
+      }
+    }
+  }
+}
+
+/** @brief Run one task from the worker's own deque, or steal one from another worker.
+ *  @return False if no task was available.
+ */
+bool GraphScheduler::execute_one(size_t index) noexcept
+{
+  std::optional<unsigned int> task = m_workers[index]->deque.pop();
+
+  for (size_t i = 1; !task && i < m_workers.size(); i++)
+  {
+    task = m_workers[(index + i) % m_workers.size()]->deque.steal();
+  }
+
+  if (!task)
+  {
+    return false;
+  }
+
+  execute(*task, index);
+  return true;
+}
+
+void GraphScheduler::execute(unsigned int task_index, size_t index) noexcept
+{
+  GraphPlan &plan = *p_plan.load(std::memory_order_relaxed);
+  const unsigned int n_frames = m_frames.load(std::memory_order_relaxed);
+  Worker &self = *m_workers[index];
+
+  // Keep running the chain on this worker while it has exactly one ready successor
+  while (true)
+  {
+    const NodeTask &task = plan.get_tasks()[task_index];
+    plan.run_task(task, n_frames);
+
+    int next = -1;
+    for (const unsigned int dependent : plan.get_dependents(task))
+    {
+      if (!plan.release_dependency(dependent))
+      {
+        continue;
+      }
+
+      if (next < 0)
+      {
+        next = static_cast<int>(dependent);
+      }
+      else
+      {
+        self.deque.push(dependent);
+      }
+    }
+
+    // Published by the release below, before the audio thread can see the pass finish
+    if (index != 0 && framework::has_denormal_flags())
+    {
+      m_worker_denormals.store(true, std::memory_order_relaxed);
+    }
+    m_remaining.fetch_sub(1, std::memory_order_acq_rel);
+
+    if (next < 0)
+    {
+      return;
+    }
+    task_index = static_cast<unsigned int>(next);
+  }
+}
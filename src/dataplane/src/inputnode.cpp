@@ -8,6 +8,12 @@ std::string InputNode::to_string() const
   if (p_io) {
     str += "io=" + p_io->to_string();
   }
+  if (m_source_sample_rate > 0) {
+    str += std::string(p_io ? ", " : "") + "SourceSampleRate=" + std::to_string(m_source_sample_rate);
+  }
+  if (m_drift_compensation) {
+    str += std::string(p_io || m_source_sample_rate > 0 ? ", " : "") + "DriftCompensation=true";
+  }
   str += ")";
   return str;
 }
@@ -2,9 +2,38 @@
 
 using namespace miniaudioengine::dataplane;
 
+void MixerNode::set_gain(float gain)
+{
+  std::lock_guard<std::mutex> lock(m_parameters_mutex);
+  m_parameters.gain = gain;
+  m_snapshot.publish(m_parameters);
+}
+
+void MixerNode::set_pan(float pan)
+{
+  std::lock_guard<std::mutex> lock(m_parameters_mutex);
+  m_parameters.pan = pan;
+  m_snapshot.publish(m_parameters);
+}
+
+void MixerNode::set_parameters(const MixerParameters &parameters)
+{
+  std::lock_guard<std::mutex> lock(m_parameters_mutex);
+  m_parameters = parameters;
+  m_snapshot.publish(m_parameters);
+}
+
+MixerParameters MixerNode::get_parameters() const
+{
+  std::lock_guard<std::mutex> lock(m_parameters_mutex);
+  return m_parameters;
+}
+
 std::string MixerNode::to_string() const
 {
   std::string str = "MixerNode(";
+  str += "Gain=" + std::to_string(get_gain());
+  str += ", Pan=" + std::to_string(get_pan());
   str += ")";
   return str;
 }
@@ -1,10 +1,69 @@
 #include "processornode.h"
+#include "logger.h"
 
 using namespace miniaudioengine::dataplane;
 
+void ProcessorNode::add_processor(const framework::IProcessorPtr &processor)
+{
+  if (!processor)
+  {
+    LOG_ERROR("ProcessorNode: add_processor - Processor is null.");
+    return;
+  }
+
+  m_processors.push_back(processor);
+  m_prepared_formats.emplace_back();
+}
+
+void ProcessorNode::clear_processors()
+{
+  m_processors.clear();
+  m_prepared_formats.clear();
+}
+
+void ProcessorNode::prepare(unsigned int sample_rate, unsigned int max_block, unsigned int channels)
+{
+  const Format format{sample_rate, max_block, channels};
+  for (size_t i = 0; i < m_processors.size(); i++)
+  {
+    if (m_prepared_formats[i] == format)
+    {
+      continue;
+    }
+
+    LOG_INFO("ProcessorNode: Preparing ", m_processors[i]->to_string(), " SampleRate=", sample_rate,
+             ", MaxBlock=", max_block, ", Channels=", channels);
+    m_processors[i]->prepare(sample_rate, max_block, channels);
+    m_prepared_formats[i] = format;
+  }
+}
+
+unsigned int ProcessorNode::get_latency_frames() const
+{
+  unsigned int latency = 0;
+  for (const framework::IProcessorPtr &processor : m_processors)
+  {
+    latency += processor->get_latency_frames();
+  }
+  return latency;
+}
+
+unsigned int ProcessorNode::propagate_latency(unsigned int input_latency)
+{
+  unsigned int latency = input_latency;
+  for (const framework::IProcessorPtr &processor : m_processors)
+  {
+    processor->set_input_latency(latency);
+    latency += processor->get_latency_frames();
+  }
+  return latency;
+}
+
 std::string ProcessorNode::to_string() const
 {
   std::string str = "ProcessorNode(";
+  str += "Processors=" + std::to_string(m_processors.size());
+  str += ", LatencyFrames=" + std::to_string(get_latency_frames());
   str += ")";
   return str;
 }
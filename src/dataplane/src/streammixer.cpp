@@ -0,0 +1,197 @@
+#include "streammixer.h"
+#include "dspkernels.h"
+#include "logger.h"
+
+#include <algorithm>
+
+using namespace miniaudioengine;
+using namespace miniaudioengine::dataplane;
+
+StreamMixer::StreamMixer(unsigned int output_channels, unsigned int input_channels, unsigned int max_frames,
+                         unsigned int sample_rate) :
+  m_output_channels(output_channels),
+  m_input_channels(input_channels),
+  m_max_frames(std::max(max_frames, 1u)),
+  m_sample_rate(sample_rate),
+  m_scratch(static_cast<size_t>(m_max_frames) * output_channels)
+{
+  m_table.publish(std::make_unique<RouteTable>());
+}
+
+bool StreamMixer::add_route(const AudioGraphPtr &graph, const framework::BufferPtr &capture,
+                            const framework::StreamStatisticsPtr &statistics, const TransportGatePtr &gate)
+{
+  if (!graph && !capture)
+  {
+    LOG_ERROR("StreamMixer: add_route - A route needs a graph, a capture Buffer or both.");
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_routes_mutex);
+  m_routes.push_back(Route{graph, capture, statistics, gate});
+  publish_locked();
+  return true;
+}
+
+bool StreamMixer::remove_route(const AudioGraphPtr &graph, const framework::BufferPtr &capture)
+{
+  std::lock_guard<std::mutex> lock(m_routes_mutex);
+  auto found = std::find_if(m_routes.begin(), m_routes.end(), [&](const Route &route) {
+    return route.graph == graph && route.capture == capture;
+  });
+  if (found == m_routes.end())
+  {
+    return false;
+  }
+
+  m_routes.erase(found);
+  publish_locked();
+  return true;
+}
+
+void StreamMixer::set_transport(const TransportPtr &transport, bool drive)
+{
+  std::lock_guard<std::mutex> lock(m_routes_mutex);
+  p_transport = transport;
+  m_drive_transport = transport && drive;
+  publish_locked();
+}
+
+size_t StreamMixer::get_route_count() const
+{
+  std::lock_guard<std::mutex> lock(m_routes_mutex);
+  return m_routes.size();
+}
+
+bool StreamMixer::has_outputs() const
+{
+  std::lock_guard<std::mutex> lock(m_routes_mutex);
+  return std::any_of(m_routes.begin(), m_routes.end(), [](const Route &route) { return route.graph != nullptr; });
+}
+
+bool StreamMixer::has_captures() const
+{
+  std::lock_guard<std::mutex> lock(m_routes_mutex);
+  return std::any_of(m_routes.begin(), m_routes.end(), [](const Route &route) { return route.capture != nullptr; });
+}
+
+/** @brief Hand the audio thread a copy of the routes.
+ *  Replaced tables, and the graphs only they still reference, are destroyed here on a control thread.
+ *  @note Caller must hold m_routes_mutex.
+ */
+void StreamMixer::publish_locked()
+{
+  auto table = std::make_unique<RouteTable>();
+  table->routes = m_routes;
+  table->transport = p_transport;
+  table->drive_transport = m_drive_transport;
+  m_table.publish(std::move(table));
+}
+
+void StreamMixer::process(const float *input, float *output, unsigned int n_frames) noexcept
+{
+  auto table = m_table.read();
+
+  // A stream that does not drive the transport follows the last block the driving stream rendered
+  TransportBlock transport_block{0, n_frames, false};
+  if (table->transport)
+  {
+    transport_block = table->drive_transport
+                      ? table->transport->advance(n_frames)
+                      : TransportBlock{table->transport->get_block_start(), n_frames, table->transport->is_playing()};
+  }
+
+  // Capture first, so a track that monitors this device renders the block it was just given
+  if (input != nullptr && m_input_channels > 0)
+  {
+    const std::span<const float> block(input, static_cast<size_t>(n_frames) * m_input_channels);
+    for (const Route &route : table->routes)
+    {
+      if (!route.capture)
+      {
+        continue;
+      }
+
+      // Only queue whole frames so the channel interleaving never slips
+      const size_t available = route.capture->available();
+      const size_t samples_to_write = std::min(block.size(), available - (available % m_input_channels));
+      if (route.capture->write(block.first(samples_to_write)) < block.size() && route.statistics)
+      {
+        route.statistics->record_overflow();
+      }
+    }
+  }
+
+  if (output == nullptr || m_output_channels == 0)
+  {
+    return;
+  }
+
+  std::fill_n(output, static_cast<size_t>(n_frames) * m_output_channels, 0.0f);
+  for (unsigned int offset = 0; offset < n_frames; offset += m_max_frames)
+  {
+    const unsigned int frames = std::min(m_max_frames, n_frames - offset);
+    float *destination = output + static_cast<size_t>(offset) * m_output_channels;
+
+    for (const Route &route : table->routes)
+    {
+      if (!route.graph)
+      {
+        continue;
+      }
+
+      // Render only the frames the route's gate is open for, starting the graph on the exact frame
+      unsigned int begin = 0;
+      unsigned int end = frames;
+      if (route.gate && table->transport)
+      {
+        if (route.gate->is_armed())
+        {
+          if (!transport_block.playing)
+          {
+            continue;
+          }
+          route.gate->fire(transport_block.start);
+        }
+
+        const uint64_t start_frame = route.gate->get_start_frame();
+        const uint64_t stop_frame = route.gate->get_stop_frame();
+        const uint64_t chunk_start = transport_block.start + (transport_block.playing ? offset : 0);
+        if (transport_block.playing)
+        {
+          begin = start_frame > chunk_start ? static_cast<unsigned int>(std::min<uint64_t>(start_frame - chunk_start, frames)) : 0;
+          end = stop_frame > chunk_start ? static_cast<unsigned int>(std::min<uint64_t>(stop_frame - chunk_start, frames)) : 0;
+        }
+        else if (start_frame > chunk_start || stop_frame <= chunk_start)
+        {
+          continue;
+        }
+      }
+      if (begin >= end)
+      {
+        continue;
+      }
+
+      framework::StreamStatistics::BlockTimer block_timer(route.statistics.get(), end - begin, m_sample_rate);
+      if (route.graph->process(m_scratch.data(), end - begin))
+      {
+        framework::dsp::add(destination + static_cast<size_t>(begin) * m_output_channels, m_scratch.data(),
+                            static_cast<size_t>(end - begin) * m_output_channels);
+      }
+    }
+  }
+
+  if (table->drive_transport)
+  {
+    table->transport->render_click(output, m_output_channels, transport_block);
+  }
+}
+
+std::string StreamMixer::to_string() const
+{
+  return "StreamMixer(Routes=" + std::to_string(get_route_count()) +
+         ", OutputChannels=" + std::to_string(m_output_channels) +
+         ", InputChannels=" + std::to_string(m_input_channels) +
+         ", MaxFrames=" + std::to_string(m_max_frames) +
+         ", SampleRate=" + std::to_string(m_sample_rate) + ")";
+}
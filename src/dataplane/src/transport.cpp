@@ -0,0 +1,371 @@
+#include "transport.h"
+#include "logger.h"
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace miniaudioengine;
+using namespace miniaudioengine::dataplane;
+
+namespace
+{
+
+/** @brief Tolerance when deciding whether a position already sits on a beat or bar line. */
+constexpr double GRID_EPSILON = 1e-9;
+
+constexpr double CLICK_SECONDS = 0.02;
+constexpr double CLICK_BEAT_HZ = 1000.0;
+constexpr double CLICK_ACCENT_HZ = 1500.0;
+
+/** @brief Build the default click: a short, exponentially decaying sine burst. */
+framework::SampleBufferPtr make_click(unsigned int sample_rate, double frequency)
+{
+  constexpr double pi = 3.14159265358979323846;
+  const size_t frames = static_cast<size_t>(CLICK_SECONDS * sample_rate);
+  auto buffer = framework::SampleBuffer::allocate(frames, 1, sample_rate);
+  float *samples = buffer->get_writable_data();
+  for (size_t i = 0; i < frames; i++)
+  {
+    const double t = static_cast<double>(i) / sample_rate;
+    samples[i] = static_cast<float>(std::sin(2.0 * pi * frequency * t) * std::exp(-t / (CLICK_SECONDS / 5.0)));
+  }
+  return buffer;
+}
+
+bool is_valid(const TempoChange &change)
+{
+  return change.bpm > 0.0 && change.beats_per_bar > 0 && change.beat_unit > 0;
+}
+
+} // namespace
+
+TempoMap::TempoMap(const std::vector<TempoChange> &changes, unsigned int sample_rate) :
+  m_sample_rate(std::max(sample_rate, 1u))
+{
+  double beat = 0.0;
+  double bar = 0.0;
+  for (const TempoChange &change : changes)
+  {
+    if (!m_segments.empty())
+    {
+      const Segment &previous = m_segments.back();
+      const double beats = static_cast<double>(change.frame - previous.change.frame) / previous.frames_per_beat;
+      beat = previous.beat + beats;
+      bar = previous.bar + beats / previous.change.beats_per_bar;
+    }
+    m_segments.push_back(Segment{change, beat, bar, m_sample_rate * 60.0 / change.bpm});
+  }
+
+  if (m_segments.empty() || m_segments.front().change.frame != 0)
+  {
+    m_segments.insert(m_segments.begin(), Segment{TempoChange{}, 0.0, 0.0, m_sample_rate * 60.0 / TempoChange{}.bpm});
+  }
+}
+
+size_t TempoMap::find(uint64_t frame) const noexcept
+{
+  auto next = std::upper_bound(m_segments.begin(), m_segments.end(), frame, [](uint64_t value, const Segment &segment) {
+    return value < segment.change.frame;
+  });
+  return static_cast<size_t>(next - m_segments.begin()) - 1;
+}
+
+uint64_t TempoMap::get_frame(const Segment &segment, double beat) const noexcept
+{
+  const long long offset = std::llround((beat - segment.beat) * segment.frames_per_beat);
+  return segment.change.frame + static_cast<uint64_t>(std::max(offset, 0ll));
+}
+
+double TempoMap::get_beat(uint64_t frame) const noexcept
+{
+  const Segment &segment = m_segments[find(frame)];
+  return segment.beat + static_cast<double>(frame - segment.change.frame) / segment.frames_per_beat;
+}
+
+double TempoMap::get_bar(uint64_t frame) const noexcept
+{
+  const Segment &segment = m_segments[find(frame)];
+  const double beats = static_cast<double>(frame - segment.change.frame) / segment.frames_per_beat;
+  return segment.bar + beats / segment.change.beats_per_bar;
+}
+
+uint64_t TempoMap::get_next_beat_frame(uint64_t frame) const noexcept
+{
+  for (size_t i = find(frame); i < m_segments.size(); i++)
+  {
+    const Segment &segment = m_segments[i];
+    const uint64_t from = std::max(frame, segment.change.frame);
+    const double beat = segment.beat + static_cast<double>(from - segment.change.frame) / segment.frames_per_beat;
+
+    double next = std::ceil(beat - GRID_EPSILON);
+    uint64_t result = get_frame(segment, next);
+    if (result < from)
+    {
+      result = get_frame(segment, next + 1.0);
+    }
+
+    // A beat past the next change belongs to the grid of that change
+    if (i + 1 == m_segments.size() || result < m_segments[i + 1].change.frame)
+    {
+      return result;
+    }
+  }
+  return frame;
+}
+
+uint64_t TempoMap::get_next_bar_frame(uint64_t frame) const noexcept
+{
+  for (size_t i = find(frame); i < m_segments.size(); i++)
+  {
+    const Segment &segment = m_segments[i];
+    const uint64_t from = std::max(frame, segment.change.frame);
+    const double beats = static_cast<double>(from - segment.change.frame) / segment.frames_per_beat;
+    const double bar = segment.bar + beats / segment.change.beats_per_bar;
+
+    double next = std::ceil(bar - GRID_EPSILON);
+    uint64_t result = get_frame(segment, segment.beat + (next - segment.bar) * segment.change.beats_per_bar);
+    if (result < from)
+    {
+      next += 1.0;
+      result = get_frame(segment, segment.beat + (next - segment.bar) * segment.change.beats_per_bar);
+    }
+
+    if (i + 1 == m_segments.size() || result < m_segments[i + 1].change.frame)
+    {
+      return result;
+    }
+  }
+  return frame;
+}
+
+uint64_t TempoMap::get_frame_after_bars(uint64_t frame, unsigned int bars) const noexcept
+{
+  uint64_t result = get_next_bar_frame(frame);
+  for (unsigned int bar = 0; bar < bars; bar++)
+  {
+    result = get_next_bar_frame(result + 1);
+  }
+  return result;
+}
+
+const TempoChange &TempoMap::get_tempo(uint64_t frame) const noexcept
+{
+  return m_segments[find(frame)].change;
+}
+
+Transport::Transport(double bpm, unsigned int beats_per_bar, unsigned int beat_unit)
+{
+  TempoChange change{0, bpm, beats_per_bar, beat_unit};
+  if (!is_valid(change))
+  {
+    throw std::runtime_error("Transport: Tempo and time signature must be positive.");
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_tempo_changes.push_back(change);
+  m_sample_rate = DEFAULT_SAMPLE_RATE;
+  publish_locked();
+}
+
+bool Transport::prepare(unsigned int sample_rate)
+{
+  if (sample_rate == 0)
+  {
+    LOG_ERROR("Transport: prepare - Sample rate must be non-zero.");
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (sample_rate == m_sample_rate)
+    {
+      return true;
+    }
+
+    m_sample_rate = sample_rate;
+    publish_locked();
+  }
+
+  LOG_INFO("Transport: Prepared ", to_string());
+  return true;
+}
+
+unsigned int Transport::get_sample_rate() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_sample_rate;
+}
+
+bool Transport::set_tempo(double bpm, unsigned int beats_per_bar, unsigned int beat_unit)
+{
+  const TempoChange change{0, bpm, beats_per_bar, beat_unit};
+  if (!is_valid(change))
+  {
+    LOG_ERROR("Transport: set_tempo - Tempo and time signature must be positive.");
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_tempo_changes.assign(1, change);
+  publish_locked();
+  return true;
+}
+
+bool Transport::add_tempo_change(const TempoChange &change)
+{
+  if (!is_valid(change))
+  {
+    LOG_ERROR("Transport: add_tempo_change - Tempo and time signature must be positive.");
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto position = std::lower_bound(m_tempo_changes.begin(), m_tempo_changes.end(), change.frame,
+                                   [](const TempoChange &existing, uint64_t frame) { return existing.frame < frame; });
+  if (position != m_tempo_changes.end() && position->frame == change.frame)
+  {
+    *position = change;
+  }
+  else
+  {
+    m_tempo_changes.insert(position, change);
+  }
+
+  publish_locked();
+  return true;
+}
+
+std::vector<TempoChange> Transport::get_tempo_changes() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_tempo_changes;
+}
+
+TempoMapPtr Transport::get_tempo_map() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return p_tempo_map;
+}
+
+uint64_t Transport::get_next_beat_frame() const
+{
+  return get_tempo_map()->get_next_beat_frame(get_position());
+}
+
+uint64_t Transport::get_next_bar_frame() const
+{
+  return get_tempo_map()->get_next_bar_frame(get_position());
+}
+
+bool Transport::set_click_samples(const framework::SampleBufferPtr &beat, const framework::SampleBufferPtr &accent)
+{
+  if (!beat)
+  {
+    LOG_ERROR("Transport: set_click_samples - The beat sample is null.");
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  p_beat_source = beat;
+  p_accent_source = accent;
+  publish_locked();
+  return true;
+}
+
+/** @brief Rebuild the tempo map and click for the current sample rate and hand them to the audio thread.
+ *  Click samples at another rate are converted here, never on the audio thread.
+ *  @note Caller must hold m_mutex.
+ */
+void Transport::publish_locked()
+{
+  p_tempo_map = std::make_shared<const TempoMap>(m_tempo_changes, m_sample_rate);
+  m_audio_tempo_map.publish(std::make_unique<TempoMap>(m_tempo_changes, m_sample_rate));
+
+  auto click = std::make_unique<ClickSamples>();
+  click->beat = p_beat_source ? framework::Resampler::resample(p_beat_source, m_sample_rate)
+                              : make_click(m_sample_rate, CLICK_BEAT_HZ);
+  click->accent = p_accent_source ? framework::Resampler::resample(p_accent_source, m_sample_rate)
+                  : p_beat_source ? click->beat
+                                  : make_click(m_sample_rate, CLICK_ACCENT_HZ);
+  m_audio_click.publish(std::move(click));
+}
+
+TransportBlock Transport::advance(unsigned int n_frames) noexcept
+{
+  uint64_t position = m_position.load(std::memory_order_relaxed);
+  const uint64_t locate = m_locate_request.exchange(NO_LOCATE, std::memory_order_acq_rel);
+  if (locate != NO_LOCATE)
+  {
+    position = locate;
+    // A click still ringing belongs to the old position
+    m_voice_position = std::numeric_limits<size_t>::max();
+  }
+
+  TransportBlock block{position, n_frames, m_play_request.load(std::memory_order_acquire)};
+  m_block_start.store(block.start, std::memory_order_relaxed);
+  m_block_playing.store(block.playing, std::memory_order_release);
+  m_position.store(block.playing ? position + n_frames : position, std::memory_order_release);
+  return block;
+}
+
+void Transport::render_click(float *output, unsigned int channels, const TransportBlock &block) noexcept
+{
+  if (output == nullptr || channels == 0)
+  {
+    return;
+  }
+
+  auto click = m_audio_click.read();
+  auto tempo_map = m_audio_tempo_map.read();
+  const bool enabled = is_click_enabled();
+  const float gain = get_click_gain();
+
+  const uint64_t block_end = block.start + block.frames;
+  m_next_click_frame = block.playing && enabled ? tempo_map->get_next_beat_frame(block.start) : block_end;
+
+  unsigned int offset = 0;
+  while (offset < block.frames)
+  {
+    // Mix the voice up to the next beat, then retrigger it exactly there
+    const unsigned int until = m_next_click_frame < block_end ? static_cast<unsigned int>(m_next_click_frame - block.start)
+                                                              : block.frames;
+    const framework::SampleBuffer *sample = m_voice_accent ? click->accent.get() : click->beat.get();
+    if (sample != nullptr && m_voice_position < sample->get_frames())
+    {
+      const unsigned int sample_channels = sample->get_channels();
+      const size_t frames = std::min<size_t>(until - offset, sample->get_frames() - m_voice_position);
+      const float *source = sample->data() + m_voice_position * sample_channels;
+      float *destination = output + static_cast<size_t>(offset) * channels;
+      for (size_t frame = 0; frame < frames; frame++)
+      {
+        for (unsigned int channel = 0; channel < channels; channel++)
+        {
+          destination[frame * channels + channel] += gain * source[frame * sample_channels + channel % sample_channels];
+        }
+      }
+      m_voice_position += frames;
+    }
+
+    offset = until;
+    if (offset < block.frames)
+    {
+      m_voice_accent = tempo_map->get_next_bar_frame(m_next_click_frame) == m_next_click_frame;
+      m_voice_position = 0;
+      m_next_click_frame = tempo_map->get_next_beat_frame(m_next_click_frame + 1);
+    }
+  }
+}
+
+std::string Transport::to_string() const
+{
+  const TempoMapPtr tempo_map = get_tempo_map();
+  const TempoChange &tempo = tempo_map->get_tempo(get_position());
+  return "Transport(Playing=" + std::string(is_playing() ? "true" : "false") +
+         ", Position=" + std::to_string(get_position()) +
+         ", SampleRate=" + std::to_string(tempo_map->get_sample_rate()) +
+         ", BPM=" + std::to_string(tempo.bpm) +
+         ", TimeSignature=" + std::to_string(tempo.beats_per_bar) + "/" + std::to_string(tempo.beat_unit) +
+         ", TempoChanges=" + std::to_string(get_tempo_changes().size()) + ")";
+}
@@ -2,6 +2,9 @@
 #define __DEVICE_HANDLE_H__
 
 #include "io.h"
+#include "midiqueue.h"
+#include "streamclock.h"
+#include "streamstatistics.h"
 
 #include <memory>
 #include <string>
@@ -10,6 +13,17 @@
 namespace miniaudioengine
 {
 
+namespace dataplane
+{
+class AudioGraph;
+class StreamMixer;
+}
+
+namespace adapters
+{
+class FileWriter;
+}
+
 struct DeviceInfo
 {
   // Common fields
@@ -97,6 +111,9 @@ public:
   /** @brief Returns the preferred sample rate. Returns 0 for MIDI devices. */
   unsigned int get_preferred_sample_rate() const;
 
+  /** @brief Returns true if the device can capture and play in one full-duplex stream. False for MIDI devices. */
+  bool is_duplex() const;
+
   /** @brief Returns true if the Device's audio stream is open */
   bool is_stream_open();
 
@@ -104,13 +121,57 @@ public:
   bool close_stream();
 
   /** @brief Open the Device's audio stream. Returns true if successful, else false */
-  bool open_stream(const framework::BufferPtr &buffer);
+  bool open_stream(const framework::BufferPtr &buffer, const framework::StreamConfig &config);
+
+  /** @brief Open one stream that captures the Device's input and plays its output.
+   *  Each captured block is written to the buffer and rendered by the AudioGraph in the same callback.
+   *  @param buffer Buffer read by the AudioGraph's InputNode.
+   *  @param config Stream parameters.
+   *  @return True if successful, else false. Requires set_audio_graph() first.
+   */
+  bool open_duplex_stream(const framework::BufferPtr &buffer, const framework::StreamConfig &config);
+
+  /** @brief Open the Device's audio stream for a StreamMixer shared by many tracks.
+   *  @param mixer Mixer that captures from the input and renders into the output on every callback.
+   *  @param direction Input, Output or Duplex, depending on whether the mixer captures, renders or both.
+   *  @param config Stream parameters.
+   *  @return True if successful, else false.
+   */
+  bool open_shared_stream(const std::shared_ptr<dataplane::StreamMixer> &mixer,
+                          framework::eInputOutputDirection direction, const framework::StreamConfig &config);
+
+  /** @brief Returns the buffering of the open audio stream in frames, the round trip for a duplex stream. */
+  unsigned long long get_latency_frames() const;
+
+  /** @brief Render the Device's output stream through a compiled AudioGraph. Applied when the stream is next opened. */
+  void set_audio_graph(const std::shared_ptr<dataplane::AudioGraph> &graph);
+
+  /** @brief Record the Device's stream performance into a StreamStatistics. Applied when the stream is next opened.
+   *  @param statistics Statistics to update, or nullptr to stop recording.
+   */
+  void set_statistics(const framework::StreamStatisticsPtr &statistics);
+
+  /** @brief Stream everything the Device's input captures to a file. Applied when the stream is next opened.
+   *  @param recorder An open FileWriter fed from the audio thread, or nullptr to stop recording.
+   */
+  void set_recorder(const std::shared_ptr<adapters::FileWriter> &recorder);
 
   // MIDI-only accesors
 
   unsigned int get_port_number() const;
 
+  /** @brief Push messages from the Device's MIDI input into a queue. Applied when the stream is next opened.
+   *  @param queue Queue drained by the audio thread.
+   *  @param clock Clock of the audio stream the messages are timestamped against. May be nullptr.
+   */
+  void set_midi_queue(const framework::MidiQueuePtr &queue, const framework::StreamClockPtr &clock);
+
 private:
+  bool open_midi_stream();
+  bool open_audio_stream(const framework::BufferPtr &buffer, framework::eInputOutputDirection direction,
+                         const framework::StreamConfig &config,
+                         const std::shared_ptr<dataplane::StreamMixer> &mixer = nullptr);
+
   struct Impl;
   explicit Device(std::unique_ptr<Impl> impl);
   std::unique_ptr<Impl> p_impl;
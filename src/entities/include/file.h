@@ -2,7 +2,9 @@
 #define __FILE_HANDLE_H__
 
 #include "io.h"
+#include "audiosource.h"
 
+#include <cstdint>
 #include <filesystem>
 #include <memory>
 #include <string>
@@ -13,7 +15,11 @@ namespace miniaudioengine
 
 /** @class File
  *  @brief Handle for audio and MIDI file sources.
- *  Hides libsndfile and other library dependencies from public headers.
+ *  Hides libsndfile and other library dependencies from public headers. The format accessors
+ *  answer from the header read when the File was created; the streaming state is only created
+ *  when a stream opens and released when it closes.
+ *  An audio file streams into a read-ahead ring of its own, read through get_audio_source(), and
+ *  seeks, loops and jumps to cue points while it plays.
  */
 class File : public framework::IInputOutput, std::enable_shared_from_this<File>
 {
@@ -27,6 +33,9 @@ public:
     Midi
   };
 
+  /** @brief Seconds of a cue point preloaded into RAM by default. */
+  static constexpr double DEFAULT_CUE_PRELOAD_SECONDS = 0.5;
+
   ~File();
 
   File();
@@ -68,11 +77,11 @@ public:
   /** @brief Duration in seconds. Returns 0.0 for MIDI files. */
   double get_duration_seconds() const;
 
-  /** @brief Format string, e.g. "WAV", "AIFF", "FLAC". Returns empty string for MIDI files. */
+  /** @brief Format string, e.g. "WAV", "AIFF", "FLAC", "OGG", "MP3". Returns empty string for MIDI files. */
   std::string get_format_string() const;
 
   /** @brief Returns true if the File's audio stream is open */
-  bool open_stream(const framework::BufferPtr &buffer);
+  bool open_stream(const framework::BufferPtr &buffer, const framework::StreamConfig &config);
 
   /** @brief Close the File's audio stream. Returns true if successful, else false */
   bool close_stream();
@@ -80,6 +89,46 @@ public:
     /** @brief Open the File's audio stream. Returns true if successful, else false */
   bool is_stream_open();
 
+  /** @brief Returns what the audio graph reads the open stream from, or nullptr if no stream is open. */
+  framework::AudioSourcePtr get_audio_source() const;
+
+  /** @brief Returns the frames the open stream has ready to play, 0 if no stream is open. Any thread. */
+  size_t get_buffered_frames() const;
+
+  // -------------------------------------------------------------------------
+  // Seek, loop and cue points — audio files only
+  // -------------------------------------------------------------------------
+
+  /** @brief Jump to a frame. Sets where the next stream starts if none is open.
+   *  A jump into the preload of a cue point is heard on the next block.
+   *  @return False for MIDI files.
+   */
+  bool seek(uint64_t frame);
+
+  /** @brief Returns the frame playback is at, or the frame the next stream starts at. */
+  uint64_t get_position() const;
+
+  /** @brief Loop [start_frame, end_frame) once playback reaches end_frame. Kept across streams.
+   *  @return False for MIDI files, or if the region is too short to loop.
+   */
+  bool set_loop_region(uint64_t start_frame, uint64_t end_frame);
+
+  /** @brief Play through the end of the loop region. */
+  void clear_loop_region();
+
+  /** @brief Add a cue point, decoding its first frames into RAM so a seek to it starts instantly.
+   *  @param frame File frame of the cue point.
+   *  @param preload_seconds Seconds from the cue point to hold in RAM.
+   *  @return False for MIDI files, or if the frame cannot be decoded.
+   */
+  bool add_cue_point(uint64_t frame, double preload_seconds = DEFAULT_CUE_PRELOAD_SECONDS);
+
+  /** @brief Remove the cue point at a frame. Returns false if there is none. */
+  bool remove_cue_point(uint64_t frame);
+
+  /** @brief Returns the frames of the cue points, in order. */
+  std::vector<uint64_t> get_cue_points() const;
+
 private:
   struct Impl;
   explicit File(std::unique_ptr<Impl> impl);
@@ -98,13 +147,21 @@ using FilePtr = std::shared_ptr<File>;
 class FileHandleFactory
 {
 public:
-  /** @brief Open a WAV (or other libsndfile-compatible) file for reading.
+  /** @brief Create a handle for a WAV (or other libsndfile-compatible) file to read.
+   *  Only the header is read, and cached in the File. Nothing is opened until a stream is.
    *  @param path Absolute path to the audio file.
    *  @return Shared pointer to the constructed File.
-   *  @throws std::runtime_error if the file cannot be opened by libsndfile.
+   *  @throws std::runtime_error if the header cannot be read.
    */
   static FilePtr make_wav(const std::filesystem::path &path);
 
+  /** @brief Create a handle for a WAV file to record to, which may not exist yet.
+   *  Its format is read from the file each time it is queried, so it follows the recording.
+   *  @param path Absolute path to the audio file.
+   *  @return Shared pointer to the constructed File, with an output direction.
+   */
+  static FilePtr make_wav_output(const std::filesystem::path &path);
+
   /** @brief Create a MIDI file handle (stub — no data is parsed yet).
    *  @param path Absolute path to the MIDI file.
    *  @return Shared pointer to the constructed File.
@@ -0,0 +1,181 @@
+#ifndef __NETWORK_STREAM_H__
+#define __NETWORK_STREAM_H__
+
+#include "io.h"
+#include "audiosource.h"
+#include "streamstatistics.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace miniaudioengine
+{
+
+namespace dataplane
+{
+class AudioGraph;
+}
+
+/** @enum eNetworkCodec
+ *  @brief Payload encoding of a network stream. Samples are big-endian, as RTP audio payloads are.
+ */
+enum class eNetworkCodec
+{
+  Pcm16,  // L16, RFC 3551
+  Pcm24,  // L24, RFC 3190. The AES67 format
+  Float32 // IEEE 754, for engine-to-engine links that should not requantize
+};
+
+std::string to_string(eNetworkCodec codec);
+
+/** @brief Returns the bytes one sample takes in a packet. */
+size_t get_bytes_per_sample(eNetworkCodec codec);
+
+/** @struct NetworkStreamConfig
+ *  @brief Address, format and buffering of an RTP audio stream over UDP.
+ *  The sender and the receiver of a stream must agree on the codec, channels, sample rate and packet_frames.
+ */
+struct NetworkStreamConfig
+{
+  static constexpr uint16_t DEFAULT_PORT = 5004;
+
+  /** @brief Destination of an output. Address an input listens on: "0.0.0.0" for every interface, or a
+   *  multicast group to join. IPv4 only.
+   */
+  std::string address{"127.0.0.1"};
+  uint16_t port{DEFAULT_PORT};
+
+  eNetworkCodec codec{eNetworkCodec::Pcm24};
+  unsigned int channels{2};
+
+  /** @brief Rate of the stream. An output renders at this rate, an input is resampled to the device's. */
+  unsigned int sample_rate{48000};
+
+  /** @brief Frames per packet. 48 is 1 ms at 48 kHz, the AES67 default. A packet must fit an Ethernet frame. */
+  unsigned int packet_frames{48};
+
+  /** @brief Packets queued between the render thread and the sender thread of an output, and slots of
+   *  the jitter buffer of an input. Rounded up to a power of two.
+   */
+  unsigned int queue_packets{64};
+
+  /** @brief Largest number of packets handed to the kernel in one system call. */
+  unsigned int batch_packets{8};
+
+  /** @brief Dynamic RTP payload type carried in every packet. */
+  uint8_t payload_type{96};
+
+  /** @brief Range the jitter buffer of an input adapts its playout delay within, in milliseconds. */
+  double min_delay_ms{2.0};
+  double max_delay_ms{40.0};
+
+  std::string to_string() const;
+};
+
+/** @struct NetworkStatistics
+ *  @brief Counters of a network stream, read lock-free while it runs.
+ */
+struct NetworkStatistics
+{
+  unsigned long long packets_sent{0};
+  unsigned long long packets_received{0};
+  unsigned long long packets_lost{0};     // Never arrived, played as silence
+  unsigned long long packets_late{0};     // Arrived after their playout time
+  unsigned long long packets_dropped{0};  // Queue full, or skipped to bring the playout delay back
+  unsigned long long packets_invalid{0};  // Not RTP, another payload type or format, or another sender
+  unsigned long long send_errors{0};
+  unsigned long long underruns{0};        // The jitter buffer ran dry and rebuffered
+  double jitter_ms{0.0};                  // RFC 3550 interarrival jitter
+  double delay_ms{0.0};                   // Playout delay the jitter buffer is converging on
+  double drift_ppm{0.0};                  // Sender clock relative to the receiving stream's
+
+  std::string to_string() const;
+};
+
+/** @class NetworkStream
+ *  @brief Audio input or output streamed as RTP over UDP, e.g. to monitor mixes or another engine on the LAN.
+ *  An output has no device clock of its own: a timer thread renders the AudioGraph once per period, like
+ *  a device callback, and queues the block lock-free. A sender thread packetizes it and hands the kernel
+ *  batches of packets, so nothing but a copy happens on the render thread.
+ *  An input receives on a background thread into an adaptive jitter buffer, read through
+ *  get_audio_source() like a File. Its playout delay follows the measured jitter, and a small playback
+ *  rate correction keeps it there while the sender's clock drifts against the device's.
+ *  Hides the socket and threading code from public headers.
+ */
+class NetworkStream : public framework::IInputOutput
+{
+public:
+  ~NetworkStream();
+
+  NetworkStream(const NetworkStream &) = delete;
+  NetworkStream &operator=(const NetworkStream &) = delete;
+
+  const NetworkStreamConfig &get_config() const;
+
+  /** @brief Returns the number of interleaved channels in the stream. */
+  unsigned int get_channels() const;
+
+  /** @brief Returns the sample rate of the stream. An output's AudioGraph is compiled at this rate. */
+  unsigned int get_sample_rate() const;
+
+  /** @brief Returns a human-readable description of the stream. */
+  std::string to_string() const;
+
+  /** @brief Open the socket and start streaming. An output needs set_audio_graph() first.
+   *  @param buffer Unused. An output renders its AudioGraph, an input is read through get_audio_source().
+   *  @param config Stream parameters. frames_per_buffer is the render period of an output, and the
+   *         largest block read from an input.
+   */
+  bool open_stream(const framework::BufferPtr &buffer, const framework::StreamConfig &config);
+
+  /** @brief Stop the threads and close the socket. */
+  bool close_stream();
+
+  bool is_stream_open();
+
+  /** @brief Returns the jitter buffer an open input plays from, or nullptr. */
+  framework::AudioSourcePtr get_audio_source() const;
+
+  /** @brief Render an output through a compiled AudioGraph. Applied when the stream is next opened. */
+  void set_audio_graph(const std::shared_ptr<dataplane::AudioGraph> &graph);
+
+  /** @brief Record an output's render performance into a StreamStatistics. Applied when the stream is next opened. */
+  void set_statistics(const framework::StreamStatisticsPtr &statistics);
+
+  /** @brief Returns the latency the stream adds in frames: the render period and one packet for an output,
+   *  the current playout delay for an input.
+   */
+  unsigned long long get_latency_frames() const;
+
+  /** @brief Returns the stream's packet counters. */
+  NetworkStatistics get_network_statistics() const;
+
+private:
+  struct Impl;
+  explicit NetworkStream(std::unique_ptr<Impl> impl);
+  std::unique_ptr<Impl> p_impl;
+
+  friend class NetworkStreamFactory;
+};
+
+using NetworkStreamPtr = std::shared_ptr<NetworkStream>;
+
+/** @class NetworkStreamFactory
+ *  @brief Internal factory for constructing NetworkStream objects.
+ *  Not part of the public API. Only used within the library.
+ */
+class NetworkStreamFactory
+{
+public:
+  /** @brief Create a stream that sends to config.address:config.port, with an output direction. */
+  static NetworkStreamPtr make_output(const NetworkStreamConfig &config);
+
+  /** @brief Create a stream that listens on config.address:config.port, with an input direction. */
+  static NetworkStreamPtr make_input(const NetworkStreamConfig &config);
+};
+
+} // namespace miniaudioengine
+
+#endif // __NETWORK_STREAM_H__
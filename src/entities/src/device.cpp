@@ -1,6 +1,7 @@
 #include "device.h"
 #include "logger.h"
 #include "audioadapter.h"
+#include "midiadapter.h"
 
 #include <string>
 #include <vector>
@@ -19,8 +20,18 @@ struct Device::Impl
 
   DeviceInfo device_info;
 
-  // TODO - Add AudioAdapter
-  adapters::AudioAdapter audio_adapter;
+  // Audio devices create their RtAudio instance when a stream is first opened, so listing devices stays cheap
+  std::unique_ptr<adapters::AudioAdapter> audio_adapter;
+
+  std::shared_ptr<dataplane::AudioGraph> audio_graph;
+
+  // MIDI devices open their port on demand
+  std::unique_ptr<adapters::MidiAdapter> midi_adapter;
+  framework::MidiQueuePtr midi_queue;
+  framework::StreamClockPtr stream_clock;
+
+  framework::StreamStatisticsPtr statistics;
+  adapters::FileWriterPtr recorder;
 };
 
 // =============================================================================
@@ -50,20 +61,133 @@ unsigned int Device::get_preferred_sample_rate() const { return p_impl->device_i
 
 bool Device::is_stream_open()
 {
-  // TODO - Needs to support MIDI as well
-  return p_impl->audio_adapter.is_stream_open();
+  if (p_impl->device_type == eDeviceType::Midi)
+  {
+    return p_impl->midi_adapter && p_impl->midi_adapter->is_port_open();
+  }
+  return p_impl->audio_adapter && p_impl->audio_adapter->is_stream_open();
 }
 
 bool Device::close_stream()
 {
-  // TODO - Needs to support MIDI as well
-  return p_impl->audio_adapter.close_stream();
+  if (p_impl->device_type == eDeviceType::Midi)
+  {
+    return !p_impl->midi_adapter || p_impl->midi_adapter->close_input_port();
+  }
+  return !p_impl->audio_adapter || p_impl->audio_adapter->close_stream();
+}
+
+bool Device::open_stream(const framework::BufferPtr &buffer, const framework::StreamConfig &config)
+{
+  if (p_impl->device_type == eDeviceType::Midi)
+  {
+    return open_midi_stream();
+  }
+  return open_audio_stream(buffer, get_direction(), config);
 }
 
-bool Device::open_stream(const framework::BufferPtr &buffer)
+bool Device::open_duplex_stream(const framework::BufferPtr &buffer, const framework::StreamConfig &config)
 {
-  // TODO - Needs to support MIDI as well
-  return p_impl->audio_adapter.open_stream(p_impl->device_info, buffer, get_direction());
+  if (!is_duplex())
+  {
+    LOG_ERROR("Device: open_duplex_stream - Device does not support full-duplex streams: ", to_string());
+    return false;
+  }
+  return open_audio_stream(buffer, framework::eInputOutputDirection::Duplex, config);
+}
+
+bool Device::open_shared_stream(const std::shared_ptr<dataplane::StreamMixer> &mixer,
+                                framework::eInputOutputDirection direction, const framework::StreamConfig &config)
+{
+  if (p_impl->device_type != eDeviceType::Audio || !mixer)
+  {
+    LOG_ERROR("Device: open_shared_stream - A shared stream needs an audio device and a StreamMixer: ", to_string());
+    return false;
+  }
+  return open_audio_stream(nullptr, direction, config, mixer);
+}
+
+bool Device::open_audio_stream(const framework::BufferPtr &buffer, framework::eInputOutputDirection direction,
+                               const framework::StreamConfig &config, const std::shared_ptr<dataplane::StreamMixer> &mixer)
+{
+  try
+  {
+    if (!p_impl->audio_adapter)
+    {
+      p_impl->audio_adapter = std::make_unique<adapters::AudioAdapter>();
+    }
+  }
+  catch (const std::exception &e)
+  {
+    LOG_ERROR("Device: open_stream - ", e.what());
+    return false;
+  }
+
+  adapters::AudioAdapter &adapter = *p_impl->audio_adapter;
+  if (!adapter.set_stream_mixer(mixer) ||
+      !adapter.set_audio_graph(p_impl->audio_graph) ||
+      !adapter.set_statistics(p_impl->statistics) ||
+      !adapter.set_recorder(p_impl->recorder))
+  {
+    return false;
+  }
+  return adapter.open_stream(p_impl->device_info, buffer, direction, config);
+}
+
+unsigned long long Device::get_latency_frames() const
+{
+  return p_impl->audio_adapter ? p_impl->audio_adapter->get_latency_frames() : 0;
+}
+
+void Device::set_audio_graph(const std::shared_ptr<dataplane::AudioGraph> &graph)
+{
+  p_impl->audio_graph = graph;
+}
+
+void Device::set_statistics(const framework::StreamStatisticsPtr &statistics)
+{
+  p_impl->statistics = statistics;
+}
+
+void Device::set_recorder(const adapters::FileWriterPtr &recorder)
+{
+  p_impl->recorder = recorder;
+}
+
+void Device::set_midi_queue(const framework::MidiQueuePtr &queue, const framework::StreamClockPtr &clock)
+{
+  p_impl->midi_queue = queue;
+  p_impl->stream_clock = clock;
+}
+
+bool Device::open_midi_stream()
+{
+  if (!is_input())
+  {
+    LOG_ERROR("Device: open_stream - MIDI output is not supported: ", to_string());
+    return false;
+  }
+
+  if (!p_impl->midi_queue)
+  {
+    LOG_ERROR("Device: open_stream - No MIDI queue set for ", to_string());
+    return false;
+  }
+
+  try
+  {
+    if (!p_impl->midi_adapter)
+    {
+      p_impl->midi_adapter = std::make_unique<adapters::MidiAdapter>();
+    }
+  }
+  catch (const std::exception &e)
+  {
+    LOG_ERROR("Device: open_stream - ", e.what());
+    return false;
+  }
+
+  return p_impl->midi_adapter->open_input_port(get_port_number(), p_impl->midi_queue, p_impl->stream_clock, p_impl->statistics);
 }
 
 bool Device::is_input() const
@@ -73,6 +197,12 @@ bool Device::is_input() const
   return p_impl->device_info.is_default_input;
 }
 
+bool Device::is_duplex() const
+{
+  return p_impl->device_type == eDeviceType::Audio && p_impl->device_info.duplex_channels > 0 &&
+         p_impl->device_info.input_channels > 0 && p_impl->device_info.output_channels > 0;
+}
+
 bool Device::is_output() const
 {
   if (p_impl->device_type == eDeviceType::Audio)
@@ -1,9 +1,13 @@
 #include "file.h"
 #include "fileadapter.h"
+#include "logger.h"
 
-#include <sndfile.h>
+#include <algorithm>
+#include <cmath>
 #include <filesystem>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -19,7 +23,44 @@ struct File::Impl
 {
   File::eFileType file_type;
   std::filesystem::path filepath;
-  adapters::FileAdapter file_adapter;
+
+  // Header of an input file, read once. A file being recorded is probed on every query instead
+  mutable std::mutex format_mutex;
+  mutable std::optional<adapters::AudioFormatInfo> format;
+
+  // Created when a stream opens, so a listed file holds no stream thread or libsndfile state
+  std::unique_ptr<adapters::FileAdapter> p_file_adapter;
+
+  // Applied to every stream the file opens
+  mutable std::mutex cue_mutex;
+  uint64_t start_frame{0};
+  uint64_t loop_start{0};
+  uint64_t loop_end{adapters::FileStream::NO_LOOP};
+  adapters::CuePointList cues;
+
+  adapters::FileStreamPtr get_stream() const
+  {
+    return p_file_adapter ? p_file_adapter->get_stream() : nullptr;
+  }
+
+  adapters::AudioFormatInfo get_format(framework::eInputOutputDirection direction) const
+  {
+    if (file_type != File::eFileType::Wav)
+    {
+      return {};
+    }
+    if (direction == framework::eInputOutputDirection::Output)
+    {
+      return adapters::FileAdapter::probe(filepath).value_or(adapters::AudioFormatInfo{});
+    }
+
+    std::lock_guard<std::mutex> lock(format_mutex);
+    if (!format)
+    {
+      format = adapters::FileAdapter::probe(filepath);
+    }
+    return format.value_or(adapters::AudioFormatInfo{});
+  }
 };
 
 // =============================================================================
@@ -41,83 +82,232 @@ std::string File::get_filename() const { return p_impl->filepath.filename().stri
 
 unsigned int File::get_total_frames() const
 {
-  if (p_impl->file_type != eFileType::Wav) return 0u;
-  return static_cast<unsigned int>(p_impl->file_adapter.get_info().frames);
+  return static_cast<unsigned int>(p_impl->get_format(get_direction()).frames);
 }
 
 unsigned int File::get_bits_per_sample() const
 {
-  if (p_impl->file_type != eFileType::Wav) return 0u;
-  const int fmt = p_impl->file_adapter.get_info().format & SF_FORMAT_SUBMASK;
-  switch (fmt)
-  {
-    case SF_FORMAT_PCM_16: return 16u;
-    case SF_FORMAT_PCM_24: return 24u;
-    case SF_FORMAT_PCM_32: return 32u;
-    case SF_FORMAT_FLOAT:  return 32u;
-    case SF_FORMAT_DOUBLE: return 64u;
-    default:               return 0u;
-  }
+  return p_impl->get_format(get_direction()).bits_per_sample;
 }
 
 unsigned int File::get_sample_rate() const
 {
-  if (p_impl->file_type != eFileType::Wav) return 0u;
-  return static_cast<unsigned int>(p_impl->file_adapter.get_info().samplerate);
+  return p_impl->get_format(get_direction()).sample_rate;
 }
 
 unsigned int File::get_channels() const
 {
-  if (p_impl->file_type != eFileType::Wav) return 0u;
-  return static_cast<unsigned int>(p_impl->file_adapter.get_info().channels);
+  return p_impl->get_format(get_direction()).channels;
 }
 
 double File::get_duration_seconds() const
 {
-  if (p_impl->file_type != eFileType::Wav) return 0.0;
-  const unsigned int sr = get_sample_rate();
-  return sr > 0 ? static_cast<double>(get_total_frames()) / static_cast<double>(sr) : 0.0;
+  const adapters::AudioFormatInfo format = p_impl->get_format(get_direction());
+  return format.sample_rate > 0 ? static_cast<double>(format.frames) / static_cast<double>(format.sample_rate) : 0.0;
 }
 
 std::string File::get_format_string() const
 {
-  if (p_impl->file_type != eFileType::Wav) return {};
-  switch (p_impl->file_adapter.get_info().format & SF_FORMAT_TYPEMASK)
-  {
-    case SF_FORMAT_WAV:  return "WAV";
-    case SF_FORMAT_AIFF: return "AIFF";
-    case SF_FORMAT_FLAC: return "FLAC";
-    default:             return "Unknown";
-  }
+  return p_impl->get_format(get_direction()).format;
 }
 
 bool File::is_stream_open()
 {
-  return p_impl->file_adapter.is_stream_open();
+  return p_impl->p_file_adapter && p_impl->p_file_adapter->is_stream_open();
 }
 
 bool File::close_stream()
 {
-  return p_impl->file_adapter.close_stream();
+  if (!p_impl->p_file_adapter)
+  {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(p_impl->cue_mutex);
+  const bool closed = p_impl->p_file_adapter->close_stream();
+  p_impl->p_file_adapter.reset();
+  return closed;
+}
+
+bool File::open_stream(const framework::BufferPtr &buffer, const framework::StreamConfig &config)
+{
+  if (!p_impl->p_file_adapter)
+  {
+    p_impl->p_file_adapter = std::make_unique<adapters::FileAdapter>();
+  }
+
+  std::lock_guard<std::mutex> lock(p_impl->cue_mutex);
+  // The stream reads ahead into a ring of its own, so the track Buffer is left unused
+  (void)buffer;
+  (void)config;
+  if (!p_impl->p_file_adapter->open_stream(get_filepath(), get_direction(), p_impl->start_frame))
+  {
+    return false;
+  }
+
+  const adapters::FileStreamPtr &stream = p_impl->p_file_adapter->get_stream();
+  if (stream)
+  {
+    stream->set_loop_region(p_impl->loop_start, p_impl->loop_end);
+    stream->set_cue_points(p_impl->cues);
+
+    // Starting on a cue point plays its preload while the first read-ahead fills
+    if (!p_impl->cues.empty())
+    {
+      stream->seek(p_impl->start_frame);
+    }
+  }
+  return true;
+}
+
+framework::AudioSourcePtr File::get_audio_source() const
+{
+  return p_impl->get_stream();
+}
+
+size_t File::get_buffered_frames() const
+{
+  adapters::FileStreamPtr stream = p_impl->get_stream();
+  return stream ? stream->get_buffered_frames() : 0;
+}
+
+bool File::seek(uint64_t frame)
+{
+  if (p_impl->file_type != eFileType::Wav)
+  {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(p_impl->cue_mutex);
+  p_impl->start_frame = frame;
+  if (adapters::FileStreamPtr stream = p_impl->get_stream())
+  {
+    stream->seek(frame);
+  }
+  return true;
+}
+
+uint64_t File::get_position() const
+{
+  std::lock_guard<std::mutex> lock(p_impl->cue_mutex);
+  adapters::FileStreamPtr stream = p_impl->get_stream();
+  return stream && stream->is_open() ? stream->get_position() : p_impl->start_frame;
+}
+
+bool File::set_loop_region(uint64_t start_frame, uint64_t end_frame)
+{
+  if (p_impl->file_type != eFileType::Wav)
+  {
+    return false;
+  }
+
+  const uint64_t frames = p_impl->get_format(get_direction()).frames;
+  end_frame = std::min(end_frame, frames);
+  if (start_frame >= end_frame || end_frame - start_frame < adapters::FileStream::MIN_LOOP_FRAMES)
+  {
+    LOG_ERROR("File: set_loop_region - Region [", start_frame, ", ", end_frame, ") of ", get_filename(), " is too short to loop");
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(p_impl->cue_mutex);
+  p_impl->loop_start = start_frame;
+  p_impl->loop_end = end_frame;
+  if (adapters::FileStreamPtr stream = p_impl->get_stream())
+  {
+    stream->set_loop_region(start_frame, end_frame);
+  }
+  return true;
+}
+
+void File::clear_loop_region()
+{
+  std::lock_guard<std::mutex> lock(p_impl->cue_mutex);
+  p_impl->loop_start = 0;
+  p_impl->loop_end = adapters::FileStream::NO_LOOP;
+  if (adapters::FileStreamPtr stream = p_impl->get_stream())
+  {
+    stream->set_loop_region(0, adapters::FileStream::NO_LOOP);
+  }
+}
+
+bool File::add_cue_point(uint64_t frame, double preload_seconds)
+{
+  if (p_impl->file_type != eFileType::Wav || preload_seconds <= 0.0)
+  {
+    return false;
+  }
+
+  // Decoded outside the lock, so a slow disk does not hold up seeks
+  const unsigned int sample_rate = get_sample_rate();
+  const size_t preload_frames = static_cast<size_t>(std::ceil(preload_seconds * sample_rate));
+  framework::SampleBufferPtr samples = adapters::FileAdapter::decode_region(get_filepath(), frame, preload_frames);
+  if (!samples)
+  {
+    LOG_ERROR("File: add_cue_point - Cannot preload frame ", frame, " of ", get_filename());
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(p_impl->cue_mutex);
+  auto it = std::find_if(p_impl->cues.begin(), p_impl->cues.end(), [frame](const adapters::CuePoint &cue) { return cue.frame == frame; });
+  if (it != p_impl->cues.end())
+  {
+    it->samples = std::move(samples);
+  }
+  else
+  {
+    p_impl->cues.push_back(adapters::CuePoint{frame, std::move(samples)});
+  }
+
+  if (adapters::FileStreamPtr stream = p_impl->get_stream())
+  {
+    stream->set_cue_points(p_impl->cues);
+  }
+  return true;
+}
+
+bool File::remove_cue_point(uint64_t frame)
+{
+  std::lock_guard<std::mutex> lock(p_impl->cue_mutex);
+  const auto removed = std::erase_if(p_impl->cues, [frame](const adapters::CuePoint &cue) { return cue.frame == frame; });
+  if (removed == 0)
+  {
+    return false;
+  }
+
+  if (adapters::FileStreamPtr stream = p_impl->get_stream())
+  {
+    stream->set_cue_points(p_impl->cues);
+  }
+  return true;
 }
 
-bool File::open_stream(const framework::BufferPtr &buffer)
+std::vector<uint64_t> File::get_cue_points() const
 {
-  return p_impl->file_adapter.open_stream(get_filepath(), buffer, get_direction());
+  std::lock_guard<std::mutex> lock(p_impl->cue_mutex);
+  std::vector<uint64_t> frames;
+  frames.reserve(p_impl->cues.size());
+  for (const adapters::CuePoint &cue : p_impl->cues)
+  {
+    frames.push_back(cue.frame);
+  }
+  std::sort(frames.begin(), frames.end());
+  return frames;
 }
 
 std::string File::to_string() const
 {
   if (p_impl->file_type == eFileType::Wav)
   {
+    const adapters::AudioFormatInfo format = p_impl->get_format(get_direction());
+    const double duration = format.sample_rate > 0 ? static_cast<double>(format.frames) / format.sample_rate : 0.0;
     return "File(Type=Wav"
            ", Path=" + p_impl->filepath.string() +
-           ", TotalFrames=" + std::to_string(get_total_frames()) +
-           ", DurationSeconds=" + std::to_string(get_duration_seconds()) +
-           ", Format=" + get_format_string() +
-           ", SampleRate=" + std::to_string(get_sample_rate()) +
-           ", BitsPerSample=" + std::to_string(get_bits_per_sample()) +
-           ", Channels=" + std::to_string(get_channels()) + ")";
+           ", TotalFrames=" + std::to_string(format.frames) +
+           ", DurationSeconds=" + std::to_string(duration) +
+           ", Format=" + format.format +
+           ", SampleRate=" + std::to_string(format.sample_rate) +
+           ", BitsPerSample=" + std::to_string(format.bits_per_sample) +
+           ", Channels=" + std::to_string(format.channels) + ")";
   }
   return "File(Type=Midi, Path=" + p_impl->filepath.string() + ")";
 }
@@ -131,9 +321,24 @@ FilePtr FileHandleFactory::make_wav(const std::filesystem::path& path)
   auto impl = std::make_unique<File::Impl>();
   impl->file_type = File::eFileType::Wav;
   impl->filepath  = path;
+  impl->format    = adapters::FileAdapter::probe(path);
+  if (!impl->format)
+  {
+    throw std::runtime_error("FileHandleFactory: make_wav - Cannot read the audio header of " + path.string());
+  }
   return FilePtr(new File(std::move(impl)));
 }
 
+FilePtr FileHandleFactory::make_wav_output(const std::filesystem::path& path)
+{
+  auto impl = std::make_unique<File::Impl>();
+  impl->file_type = File::eFileType::Wav;
+  impl->filepath  = path;
+  FilePtr file(new File(std::move(impl)));
+  file->set_direction(framework::eInputOutputDirection::Output);
+  return file;
+}
+
 FilePtr FileHandleFactory::make_midi(const std::filesystem::path& path)
 {
   auto impl = std::make_unique<File::Impl>();
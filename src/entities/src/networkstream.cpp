@@ -0,0 +1,251 @@
+#include "networkstream.h"
+#include "logger.h"
+#include "networkadapter.h"
+
+#include <memory>
+#include <string>
+
+namespace miniaudioengine
+{
+
+std::string to_string(eNetworkCodec codec)
+{
+  switch (codec)
+  {
+    case eNetworkCodec::Pcm16:
+      return "Pcm16";
+    case eNetworkCodec::Pcm24:
+      return "Pcm24";
+    case eNetworkCodec::Float32:
+      return "Float32";
+  }
+  return "Unknown";
+}
+
+size_t get_bytes_per_sample(eNetworkCodec codec)
+{
+  switch (codec)
+  {
+    case eNetworkCodec::Pcm16:
+      return 2;
+    case eNetworkCodec::Pcm24:
+      return 3;
+    case eNetworkCodec::Float32:
+      return 4;
+  }
+  return 0;
+}
+
+std::string NetworkStreamConfig::to_string() const
+{
+  return "NetworkStreamConfig(Address=" + address +
+         ", Port=" + std::to_string(port) +
+         ", Codec=" + miniaudioengine::to_string(codec) +
+         ", Channels=" + std::to_string(channels) +
+         ", SampleRate=" + std::to_string(sample_rate) +
+         ", PacketFrames=" + std::to_string(packet_frames) +
+         ", QueuePackets=" + std::to_string(queue_packets) +
+         ", BatchPackets=" + std::to_string(batch_packets) +
+         ", PayloadType=" + std::to_string(payload_type) +
+         ", MinDelay=" + std::to_string(min_delay_ms) + " ms" +
+         ", MaxDelay=" + std::to_string(max_delay_ms) + " ms)";
+}
+
+std::string NetworkStatistics::to_string() const
+{
+  return "NetworkStatistics(PacketsSent=" + std::to_string(packets_sent) +
+         ", PacketsReceived=" + std::to_string(packets_received) +
+         ", PacketsLost=" + std::to_string(packets_lost) +
+         ", PacketsLate=" + std::to_string(packets_late) +
+         ", PacketsDropped=" + std::to_string(packets_dropped) +
+         ", PacketsInvalid=" + std::to_string(packets_invalid) +
+         ", SendErrors=" + std::to_string(send_errors) +
+         ", Underruns=" + std::to_string(underruns) +
+         ", Jitter=" + std::to_string(jitter_ms) + " ms" +
+         ", Delay=" + std::to_string(delay_ms) + " ms" +
+         ", Drift=" + std::to_string(drift_ppm) + " ppm)";
+}
+
+// =============================================================================
+// NetworkStream::Impl — defined here so socket headers stay out of the public API
+// =============================================================================
+
+struct NetworkStream::Impl
+{
+  NetworkStreamConfig config;
+
+  // Created when a stream first opens and kept after it closes, so the counters stay readable
+  std::unique_ptr<adapters::NetworkSender> sender;
+  std::unique_ptr<adapters::NetworkReceiver> receiver;
+
+  std::shared_ptr<dataplane::AudioGraph> audio_graph;
+  framework::StreamStatisticsPtr statistics;
+};
+
+// =============================================================================
+// NetworkStream — member implementations
+// =============================================================================
+
+NetworkStream::NetworkStream(std::unique_ptr<Impl> impl)
+    : IInputOutput(framework::Network),
+      p_impl(std::move(impl))
+{}
+
+NetworkStream::~NetworkStream() = default;
+
+const NetworkStreamConfig &NetworkStream::get_config() const { return p_impl->config; }
+unsigned int NetworkStream::get_channels() const { return p_impl->config.channels; }
+unsigned int NetworkStream::get_sample_rate() const { return p_impl->config.sample_rate; }
+
+std::string NetworkStream::to_string() const
+{
+  const bool is_output = get_direction() == framework::eInputOutputDirection::Output;
+  return std::string("NetworkStream(Direction=") + (is_output ? "Output" : "Input") +
+         ", Address=" + p_impl->config.address +
+         ", Port=" + std::to_string(p_impl->config.port) +
+         ", Codec=" + miniaudioengine::to_string(p_impl->config.codec) +
+         ", Channels=" + std::to_string(p_impl->config.channels) +
+         ", SampleRate=" + std::to_string(p_impl->config.sample_rate) +
+         ", PacketFrames=" + std::to_string(p_impl->config.packet_frames) + ")";
+}
+
+bool NetworkStream::open_stream(const framework::BufferPtr &buffer, const framework::StreamConfig &config)
+{
+  (void)buffer;
+
+  try
+  {
+    if (get_direction() == framework::eInputOutputDirection::Output)
+    {
+      if (!p_impl->sender)
+      {
+        p_impl->sender = std::make_unique<adapters::NetworkSender>();
+      }
+      if (!p_impl->sender->set_audio_graph(p_impl->audio_graph) || !p_impl->sender->set_statistics(p_impl->statistics))
+      {
+        return false;
+      }
+      return p_impl->sender->open_stream(p_impl->config, config);
+    }
+
+    if (get_direction() == framework::eInputOutputDirection::Input)
+    {
+      if (!p_impl->receiver)
+      {
+        p_impl->receiver = std::make_unique<adapters::NetworkReceiver>();
+      }
+      return p_impl->receiver->open_stream(p_impl->config, config);
+    }
+  }
+  catch (const std::exception &e)
+  {
+    LOG_ERROR("NetworkStream: open_stream - ", e.what());
+    return false;
+  }
+
+  LOG_ERROR("NetworkStream: open_stream - Duplex network streams are not supported: ", to_string());
+  return false;
+}
+
+bool NetworkStream::close_stream()
+{
+  if (p_impl->sender)
+  {
+    return p_impl->sender->close_stream();
+  }
+  if (p_impl->receiver)
+  {
+    return p_impl->receiver->close_stream();
+  }
+  return false;
+}
+
+bool NetworkStream::is_stream_open()
+{
+  return (p_impl->sender && p_impl->sender->is_stream_open()) ||
+         (p_impl->receiver && p_impl->receiver->is_stream_open());
+}
+
+framework::AudioSourcePtr NetworkStream::get_audio_source() const
+{
+  if (!p_impl->receiver || !p_impl->receiver->is_stream_open())
+  {
+    return nullptr;
+  }
+  return p_impl->receiver->get_jitter_buffer();
+}
+
+void NetworkStream::set_audio_graph(const std::shared_ptr<dataplane::AudioGraph> &graph)
+{
+  p_impl->audio_graph = graph;
+}
+
+void NetworkStream::set_statistics(const framework::StreamStatisticsPtr &statistics)
+{
+  p_impl->statistics = statistics;
+}
+
+unsigned long long NetworkStream::get_latency_frames() const
+{
+  if (p_impl->sender)
+  {
+    return p_impl->sender->get_latency_frames();
+  }
+  if (p_impl->receiver && p_impl->receiver->get_jitter_buffer())
+  {
+    return p_impl->receiver->get_jitter_buffer()->get_target_frames();
+  }
+  return 0;
+}
+
+NetworkStatistics NetworkStream::get_network_statistics() const
+{
+  NetworkStatistics statistics;
+  if (p_impl->sender)
+  {
+    statistics.packets_sent = p_impl->sender->get_packets_sent();
+    statistics.packets_dropped = p_impl->sender->get_packets_dropped();
+    statistics.send_errors = p_impl->sender->get_send_errors();
+    statistics.underruns = p_impl->sender->get_missed_periods();
+  }
+
+  const adapters::JitterBufferPtr jitter_buffer = p_impl->receiver ? p_impl->receiver->get_jitter_buffer() : nullptr;
+  if (jitter_buffer)
+  {
+    const double ms_per_frame = 1000.0 / static_cast<double>(p_impl->config.sample_rate);
+    statistics.packets_received = jitter_buffer->get_received_packets();
+    statistics.packets_lost = jitter_buffer->get_lost_packets();
+    statistics.packets_late = jitter_buffer->get_late_packets();
+    statistics.packets_dropped = jitter_buffer->get_dropped_packets();
+    statistics.packets_invalid = p_impl->receiver->get_packets_invalid();
+    statistics.underruns = jitter_buffer->get_underrun_count();
+    statistics.jitter_ms = jitter_buffer->get_jitter_frames() * ms_per_frame;
+    statistics.delay_ms = static_cast<double>(jitter_buffer->get_target_frames()) * ms_per_frame;
+    statistics.drift_ppm = jitter_buffer->get_drift_ppm();
+  }
+  return statistics;
+}
+
+// =============================================================================
+// NetworkStreamFactory
+// =============================================================================
+
+NetworkStreamPtr NetworkStreamFactory::make_output(const NetworkStreamConfig &config)
+{
+  auto impl = std::make_unique<NetworkStream::Impl>();
+  impl->config = config;
+  NetworkStreamPtr stream(new NetworkStream(std::move(impl)));
+  stream->set_direction(framework::eInputOutputDirection::Output);
+  return stream;
+}
+
+NetworkStreamPtr NetworkStreamFactory::make_input(const NetworkStreamConfig &config)
+{
+  auto impl = std::make_unique<NetworkStream::Impl>();
+  impl->config = config;
+  NetworkStreamPtr stream(new NetworkStream(std::move(impl)));
+  stream->set_direction(framework::eInputOutputDirection::Input);
+  return stream;
+}
+
+} // namespace miniaudioengine
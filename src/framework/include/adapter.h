@@ -2,6 +2,7 @@
 #define __ADAPTER_H__
 
 #include "io.h"
+#include "streamconfig.h"
 
 #include <memory>
 
@@ -25,7 +26,7 @@ public:
   IAdapter() : p_buffer(std::make_shared<framework::Buffer>())
   {}
 
-  virtual bool open_stream(const T &info, const framework::BufferPtr &buffer, const eInputOutputDirection &direction) = 0;
+  virtual bool open_stream(const T &info, const framework::BufferPtr &buffer, const eInputOutputDirection &direction, const StreamConfig &config) = 0;
   virtual bool close_stream() = 0;
   virtual bool stop_stream() = 0;
 
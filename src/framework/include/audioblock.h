@@ -0,0 +1,56 @@
+#ifndef __AUDIO_BLOCK_H__
+#define __AUDIO_BLOCK_H__
+
+#include <span>
+
+namespace miniaudioengine::framework
+{
+
+/** @class AudioBlockView
+ *  @brief Non-owning view of one block of planar audio.
+ *  Each channel is a separate run of get_frame_count() samples. Channels handed out by the
+ *  GraphPlan start on a 64-byte boundary. Processors read and write the samples in place.
+ */
+class AudioBlockView
+{
+public:
+  /** @brief Construct a view.
+   *  @param channels Array of channel_count channel pointers.
+   *  @param channel_count Number of channels.
+   *  @param frame_count Number of samples in each channel.
+   */
+  AudioBlockView(float *const *channels, unsigned int channel_count, unsigned int frame_count) noexcept :
+    p_channels(channels),
+    m_channel_count(channel_count),
+    m_frame_count(frame_count)
+  {}
+
+  /** @brief Returns the samples of one channel. */
+  float *get_channel(unsigned int channel) const noexcept { return p_channels[channel] + m_frame_offset; }
+
+  /** @brief Returns the samples of one channel as a span of get_frame_count() samples. */
+  std::span<float> get_span(unsigned int channel) const noexcept { return {get_channel(channel), m_frame_count}; }
+
+  /** @brief Returns a view of frames [offset, offset + frame_count) of this block.
+   *  The sub-block shares the channel pointer array, so it is only aligned when offset is.
+   */
+  AudioBlockView get_sub_block(unsigned int offset, unsigned int frame_count) const noexcept
+  {
+    AudioBlockView block(p_channels, m_channel_count, frame_count);
+    block.m_frame_offset = m_frame_offset + offset;
+    return block;
+  }
+
+  unsigned int get_channel_count() const noexcept { return m_channel_count; }
+  unsigned int get_frame_count() const noexcept { return m_frame_count; }
+
+private:
+  float *const *p_channels;
+  unsigned int m_channel_count;
+  unsigned int m_frame_count;
+  unsigned int m_frame_offset{0};
+};
+
+} // namespace miniaudioengine::framework
+
+#endif // __AUDIO_BLOCK_H__
@@ -0,0 +1,34 @@
+#ifndef __AUDIO_SOURCE_H__
+#define __AUDIO_SOURCE_H__
+
+#include <cstddef>
+#include <memory>
+
+namespace miniaudioengine::framework
+{
+
+/** @class IAudioSource
+ *  @brief Interleaved audio pulled by an InputNode on the audio thread, instead of a plain ring Buffer.
+ *  Lets a source keep state of its own on the consumer side, e.g. a file stream that jumps to a cue
+ *  point without waiting for the disk.
+ */
+class IAudioSource
+{
+public:
+  virtual ~IAudioSource() = default;
+
+  /** @brief Returns the number of frames a read could return now. Used for statistics. */
+  virtual size_t get_available_frames() const noexcept = 0;
+
+  /** @brief Read up to frames interleaved frames.
+   *  @return The number of frames read. Fewer than requested is an underrun.
+   *  @note Audio thread only. Must be lock-free and allocation-free.
+   */
+  virtual size_t read_frames(float *destination, size_t frames) noexcept = 0;
+};
+
+using AudioSourcePtr = std::shared_ptr<IAudioSource>;
+
+} // namespace miniaudioengine::framework
+
+#endif // __AUDIO_SOURCE_H__
@@ -0,0 +1,75 @@
+#ifndef __BUFFER_ARENA_H__
+#define __BUFFER_ARENA_H__
+
+#include "realtimememory.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+
+namespace miniaudioengine::framework
+{
+
+/** @class BufferArena
+ *  @brief One aligned allocation holding a fixed number of planar audio buffers.
+ *  Each buffer holds `channels` channels of `frames` samples. Every channel starts on a 64-byte
+ *  boundary so SIMD kernels can use aligned loads. The arena is sized once and never grows, so
+ *  handing out buffers during playback never allocates. Its storage comes from the realtime memory pool.
+ */
+class BufferArena
+{
+public:
+  static constexpr size_t ALIGNMENT = 64;
+
+  BufferArena() = default;
+  ~BufferArena() = default;
+
+  BufferArena(const BufferArena &) = delete;
+  BufferArena &operator=(const BufferArena &) = delete;
+
+  /** @brief Allocate zeroed storage for the arena's buffers, releasing any previous storage.
+   *  @param buffers Number of buffers.
+   *  @param channels Number of channels per buffer.
+   *  @param frames Number of samples per channel.
+   */
+  void allocate(size_t buffers, unsigned int channels, unsigned int frames)
+  {
+    constexpr size_t floats_per_line = ALIGNMENT / sizeof(float);
+    m_buffers = buffers;
+    m_channels = channels;
+    m_channel_stride = (static_cast<size_t>(frames) + floats_per_line - 1) / floats_per_line * floats_per_line;
+
+    const size_t samples = m_buffers * m_channels * m_channel_stride;
+    const size_t bytes = std::max<size_t>(samples * sizeof(float), ALIGNMENT);
+    p_storage.reset(static_cast<float *>(realtime_memory::allocate(bytes, ALIGNMENT)));
+    p_storage.get_deleter().bytes = bytes;
+  }
+
+  /** @brief Returns the samples of one channel of a buffer. */
+  float *get_channel(size_t buffer, unsigned int channel) noexcept
+  {
+    return p_storage.get() + (buffer * m_channels + channel) * m_channel_stride;
+  }
+
+  size_t get_buffer_count() const noexcept { return m_buffers; }
+
+  /** @brief Returns the number of bytes reserved for the arena's buffers. */
+  size_t get_size_bytes() const noexcept { return m_buffers * m_channels * m_channel_stride * sizeof(float); }
+
+private:
+  struct PoolDelete
+  {
+    size_t bytes;
+
+    void operator()(float *p) const noexcept { realtime_memory::deallocate(p, bytes, ALIGNMENT); }
+  };
+
+  std::unique_ptr<float, PoolDelete> p_storage;
+  size_t m_buffers{0};
+  unsigned int m_channels{0};
+  size_t m_channel_stride{0};
+};
+
+} // namespace miniaudioengine::framework
+
+#endif // __BUFFER_ARENA_H__
@@ -0,0 +1,181 @@
+#ifndef __COMMAND_QUEUE_H__
+#define __COMMAND_QUEUE_H__
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace miniaudioengine::framework
+{
+
+/** @brief Default number of commands a CommandQueue holds between two drains. */
+constexpr size_t COMMAND_QUEUE_SIZE = 1024;
+
+/** @class CommandQueue
+ *  @brief Bounded, lock-free multi-producer single-consumer queue for commands into the engine.
+ *  Every slot carries a sequence number that says whose turn it is: producers claim a slot by advancing
+ *  the shared write index with a compare-exchange, move the command in and then release the slot to
+ *  the consumer by bumping its sequence. The consumer owns the read index alone, so draining never
+ *  retries and never waits on a producer: a slot that is claimed but not yet filled simply ends the
+ *  drain until the next block.
+ *  All slots are allocated at construction and commands are moved, never copied, so move-only
+ *  payloads work and neither side allocates.
+ *  @tparam T The command type. Its move operations must not throw. Commands are destroyed on the
+ *          consumer thread, so payloads drained on the audio thread should not own heap memory.
+ */
+template <typename T>
+class CommandQueue
+{
+  static_assert(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_assignable_v<T>,
+                "CommandQueue requires commands that move without throwing");
+  static_assert(std::is_default_constructible_v<T>, "CommandQueue preallocates its slots");
+
+public:
+  /** @brief Construct a command queue.
+   *  @param capacity The minimum number of commands the queue must hold. Rounded up to a power of two.
+   */
+  explicit CommandQueue(size_t capacity = COMMAND_QUEUE_SIZE) :
+    m_capacity(std::bit_ceil(std::max<size_t>(capacity, 2))),
+    m_mask(m_capacity - 1),
+    p_slots(std::make_unique<Slot[]>(m_capacity))
+  {
+    for (size_t i = 0; i < m_capacity; i++)
+    {
+      p_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~CommandQueue() = default;
+
+  CommandQueue(const CommandQueue &) = delete;
+  CommandQueue &operator=(const CommandQueue &) = delete;
+
+  /** @brief Attempts to append a command.
+   *  @param command The command, moved into the queue only on success.
+   *  @return false if the queue is full.
+   *  @note Any thread. Lock-free: a producer only retries when another producer claimed the same slot first.
+   */
+  bool try_push(T &&command) noexcept
+  {
+    size_t position = m_write_index.load(std::memory_order_relaxed);
+    while (true)
+    {
+      Slot &slot = p_slots[position & m_mask];
+      const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+      const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+      if (difference == 0)
+      {
+        // The slot is free for this position, claim it before filling it
+        if (m_write_index.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+        {
+          slot.command = std::move(command);
+          slot.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (difference < 0)
+      {
+        // The consumer has not yet drained the command a full lap ago
+        return false;
+      }
+      else
+      {
+        position = m_write_index.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /** @brief Attempts to take the oldest command.
+   *  @param command Receives the command on success.
+   *  @return false if no command is ready.
+   *  @note Consumer thread only. Wait-free, safe on the audio thread.
+   */
+  bool try_pop(T &command) noexcept
+  {
+    return try_pop_batch([&command](T &&next) noexcept { command = std::move(next); }, 1) == 1;
+  }
+
+  /** @brief Hand up to max_count ready commands to a handler, oldest first.
+   *  Bounding the batch bounds the time a drain can take on the audio thread, however fast producers push.
+   *  @param handler Called with each command as an rvalue. Must not throw.
+   *  @param max_count Largest number of commands taken.
+   *  @return The number of commands taken.
+   *  @note Consumer thread only. Wait-free, safe on the audio thread.
+   */
+  template <typename Handler>
+  size_t try_pop_batch(Handler &&handler, size_t max_count = SIZE_MAX) noexcept
+  {
+    size_t position = m_read_index.load(std::memory_order_relaxed);
+    size_t count = 0;
+    while (count < max_count)
+    {
+      Slot &slot = p_slots[position & m_mask];
+      if (slot.sequence.load(std::memory_order_acquire) != position + 1)
+      {
+        break;
+      }
+
+      handler(std::move(slot.command));
+      // Hand the slot to the producer that will write it one lap from now
+      slot.sequence.store(position + m_capacity, std::memory_order_release);
+      position++;
+      count++;
+    }
+
+    m_read_index.store(position, std::memory_order_relaxed);
+    return count;
+  }
+
+  /** @brief Move up to commands.size() ready commands into commands, oldest first.
+   *  @return The number of commands written.
+   *  @note Consumer thread only. Wait-free, safe on the audio thread.
+   */
+  size_t try_pop_batch(std::span<T> commands) noexcept
+  {
+    size_t index = 0;
+    return try_pop_batch([&](T &&next) noexcept { commands[index++] = std::move(next); }, commands.size());
+  }
+
+  /** @brief Returns an estimate of the number of queued commands, for monitoring. */
+  size_t size() const noexcept
+  {
+    const size_t write = m_write_index.load(std::memory_order_relaxed);
+    const size_t read = m_read_index.load(std::memory_order_relaxed);
+    return write > read ? std::min(write - read, m_capacity) : 0;
+  }
+
+  bool empty() const noexcept { return size() == 0; }
+
+  size_t capacity() const noexcept { return m_capacity; }
+
+private:
+  /** @struct Slot
+   *  @brief A command and the sequence number that says whether a producer or the consumer owns it.
+   */
+  struct Slot
+  {
+    std::atomic<size_t> sequence{0};
+    T command{};
+  };
+
+  const size_t m_capacity;
+  const size_t m_mask;
+  std::unique_ptr<Slot[]> p_slots;
+
+  // Shared by producers
+  alignas(64) std::atomic<size_t> m_write_index{0};
+
+  // Written by the consumer only, atomic so size() can be read from other threads
+  alignas(64) std::atomic<size_t> m_read_index{0};
+};
+
+} // namespace miniaudioengine::framework
+
+#endif // __COMMAND_QUEUE_H__
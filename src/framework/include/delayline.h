@@ -0,0 +1,67 @@
+#ifndef __DELAY_LINE_H__
+#define __DELAY_LINE_H__
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace miniaudioengine::framework
+{
+
+/** @class DelayLine
+ *  @brief Fixed delay of planar audio by a whole number of frames, e.g. to realign parallel graph
+ *  paths whose processors report different latencies.
+ *  Each channel is a ring of delay + max_frames samples, so a block is written and its delayed
+ *  counterpart read back with at most two copies each, whatever the delay.
+ *  @note prepare() allocates and must be called on a control thread. process() and reset() are
+ *        lock-free and allocation-free.
+ */
+class DelayLine
+{
+public:
+  DelayLine() = default;
+  ~DelayLine() = default;
+
+  DelayLine(const DelayLine &) = delete;
+  DelayLine &operator=(const DelayLine &) = delete;
+
+  /** @brief Allocate the rings for a delay. The line starts out silent.
+   *  @param channels Number of planar channels.
+   *  @param delay_frames Delay in frames.
+   *  @param max_frames Largest block passed to process().
+   *  @return False if the channel count or the block size is zero.
+   */
+  bool prepare(unsigned int channels, size_t delay_frames, size_t max_frames);
+
+  /** @brief Silence the line. */
+  void reset() noexcept;
+
+  /** @brief Write one channel's block and return that channel delayed by get_delay_frames().
+   *  Call once per channel per block with the same n_frames.
+   *  @return n_frames delayed samples, valid until the next call for the channel.
+   *  @note Audio thread only. Lock-free and allocation-free.
+   */
+  const float *process(unsigned int channel, const float *source, size_t n_frames) noexcept;
+
+  size_t get_delay_frames() const noexcept { return m_delay_frames; }
+  unsigned int get_channels() const noexcept { return m_channels; }
+
+  std::string to_string() const;
+
+private:
+  unsigned int m_channels{0};
+  size_t m_delay_frames{0};
+  size_t m_max_frames{0};
+  size_t m_capacity{0};
+
+  std::vector<float> m_rings;           // channels x capacity
+  std::vector<float> m_output;          // channels x max_frames
+  std::vector<size_t> m_write_position; // Per channel, so channels never have to be processed in lockstep
+};
+
+using DelayLinePtr = std::shared_ptr<DelayLine>;
+
+} // namespace miniaudioengine::framework
+
+#endif // __DELAY_LINE_H__
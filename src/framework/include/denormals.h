@@ -0,0 +1,149 @@
+#ifndef __DENORMALS_H__
+#define __DENORMALS_H__
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DENORMALS_X86
+#include <xmmintrin.h>
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+#define DENORMALS_ARM64
+#endif
+
+namespace miniaudioengine::framework
+{
+
+/** @brief Denormal handling of the realtime threads.
+ *  Decaying tails, e.g. of reverbs, filters and envelopes, end in denormal floats that many CPUs
+ *  process tens of times slower than normal ones. Every thread that renders audio sets flush-to-zero
+ *  and denormals-are-zero for the duration of its work with a ScopedFlushDenormals, so those values
+ *  become zero instead. Blocks that would have produced denormals still raise the CPU's sticky
+ *  underflow and denormal flags, which a DenormalMonitor reads to count them.
+ *  Covers x86 (MXCSR) and AArch64 (FPCR and FPSR). Elsewhere the scopes do nothing.
+ */
+namespace denormals
+{
+
+#if defined(DENORMALS_X86)
+using Register = unsigned int;
+
+constexpr Register FLUSH_MODE = 0x8040;  // FTZ | DAZ
+constexpr Register STATUS_FLAGS = 0x0012; // Underflow | Denormal operand
+
+inline Register get_control() noexcept { return _mm_getcsr(); }
+inline void set_control(Register value) noexcept { _mm_setcsr(value); }
+inline Register get_status() noexcept { return _mm_getcsr(); }
+inline void set_status(Register value) noexcept { _mm_setcsr(value); }
+#elif defined(DENORMALS_ARM64)
+using Register = uint64_t;
+
+constexpr Register FLUSH_MODE = Register{1} << 24;               // FPCR.FZ, flushes inputs and outputs
+constexpr Register STATUS_FLAGS = (Register{1} << 7) | (Register{1} << 3); // FPSR.IDC | FPSR.UFC
+
+inline Register get_control() noexcept
+{
+  Register value;
+  asm volatile("mrs %0, fpcr" : "=r"(value));
+  return value;
+}
+inline void set_control(Register value) noexcept { asm volatile("msr fpcr, %0" : : "r"(value)); }
+inline Register get_status() noexcept
+{
+  Register value;
+  asm volatile("mrs %0, fpsr" : "=r"(value));
+  return value;
+}
+inline void set_status(Register value) noexcept { asm volatile("msr fpsr, %0" : : "r"(value)); }
+#else
+using Register = unsigned int;
+
+constexpr Register FLUSH_MODE = 0;
+constexpr Register STATUS_FLAGS = 0;
+
+inline Register get_control() noexcept { return 0; }
+inline void set_control(Register) noexcept {}
+inline Register get_status() noexcept { return 0; }
+inline void set_status(Register) noexcept {}
+#endif
+
+} // namespace denormals
+
+/** @brief Returns true if the calling thread has flushed or read a denormal since its flags were last cleared. */
+inline bool has_denormal_flags() noexcept
+{
+  return (denormals::get_status() & denormals::STATUS_FLAGS) != 0;
+}
+
+/** @brief Raise the calling thread's denormal flags, e.g. for denormals a worker produced on its behalf. */
+inline void raise_denormal_flags() noexcept
+{
+  denormals::set_status(denormals::get_status() | denormals::STATUS_FLAGS);
+}
+
+/** @brief Returns true if the calling thread flushes denormals to zero. */
+inline bool is_flushing_denormals() noexcept
+{
+  return denormals::FLUSH_MODE != 0 && (denormals::get_control() & denormals::FLUSH_MODE) == denormals::FLUSH_MODE;
+}
+
+/** @class ScopedFlushDenormals
+ *  @brief Flushes denormals to zero on the calling thread for the lifetime of the object.
+ *  Clears the denormal flags on entry and restores the thread's previous mode and flags on exit,
+ *  so a host thread, e.g. the audio driver's, gets its floating-point environment back unchanged.
+ */
+class ScopedFlushDenormals
+{
+public:
+  ScopedFlushDenormals() noexcept : m_control(denormals::get_control()), m_status(denormals::get_status())
+  {
+    denormals::set_control(m_control | denormals::FLUSH_MODE);
+    denormals::set_status(denormals::get_status() & ~denormals::STATUS_FLAGS);
+  }
+
+  ~ScopedFlushDenormals()
+  {
+    denormals::set_control(m_control);
+    denormals::set_status((denormals::get_status() & ~denormals::STATUS_FLAGS) | (m_status & denormals::STATUS_FLAGS));
+  }
+
+  ScopedFlushDenormals(const ScopedFlushDenormals &) = delete;
+  ScopedFlushDenormals &operator=(const ScopedFlushDenormals &) = delete;
+
+  /** @brief Returns true if the scope has flushed or read a denormal so far. */
+  bool has_denormals() const noexcept { return has_denormal_flags(); }
+
+private:
+  denormals::Register m_control;
+  denormals::Register m_status;
+};
+
+/** @class DenormalMonitor
+ *  @brief Tells whether the code run during its lifetime produced denormals. Nests.
+ *  Clears the denormal flags on entry and merges the earlier flags back on exit, so an enclosing
+ *  monitor still sees everything that happened inside this one.
+ */
+class DenormalMonitor
+{
+public:
+  DenormalMonitor() noexcept : m_status(denormals::get_status())
+  {
+    denormals::set_status(m_status & ~denormals::STATUS_FLAGS);
+  }
+
+  ~DenormalMonitor()
+  {
+    denormals::set_status(denormals::get_status() | (m_status & denormals::STATUS_FLAGS));
+  }
+
+  DenormalMonitor(const DenormalMonitor &) = delete;
+  DenormalMonitor &operator=(const DenormalMonitor &) = delete;
+
+  bool has_denormals() const noexcept { return has_denormal_flags(); }
+
+private:
+  denormals::Register m_status;
+};
+
+} // namespace miniaudioengine::framework
+
+#endif // __DENORMALS_H__
@@ -0,0 +1,107 @@
+#ifndef __DRIFT_ESTIMATOR_H__
+#define __DRIFT_ESTIMATOR_H__
+
+#include <cstddef>
+
+namespace miniaudioengine::framework
+{
+
+/** @struct DriftEstimatorConfig
+ *  @brief Response of a DriftEstimator. The defaults suit a ring buffer between two device clocks.
+ */
+struct DriftEstimatorConfig
+{
+  /** @brief Time constant of the buffered-frames average the controller steers. */
+  double average_seconds{1.0};
+
+  /** @brief Gains of the controller, per second and per second squared. The defaults are critically damped
+   *  and settle in about 80 s, slow enough that the sawtooth of block-wise writes and reads averages out.
+   */
+  double proportional_gain{0.1};
+  double integral_gain{0.0025};
+
+  /** @brief Largest clock drift the integral tracks, and largest correction of the read rate. */
+  double max_drift{0.002};
+  double max_correction{0.005};
+
+  /** @brief Time the fill is left to settle before track() measures its target. */
+  double warmup_seconds{0.5};
+};
+
+/** @class DriftEstimator
+ *  @brief Estimates the clock drift between the writer and the reader of a buffer from its fill level.
+ *  A PI controller steers the averaged fill towards a target by reading slightly faster or slower. Its
+ *  integral converges on the drift between the two clocks, so the fill holds for hours without dropouts,
+ *  and the correction stays within max_correction, well below an audible pitch change.
+ *  update() takes the distance from a target the caller maintains, as a JitterBuffer does. track()
+ *  measures the target itself: the fill a ring buffer settles at after warmup_seconds.
+ *  @note Plain state without locks. prepare() is the control thread's, the rest the reading thread's.
+ */
+class DriftEstimator
+{
+public:
+  using Config = DriftEstimatorConfig;
+
+  DriftEstimator() = default;
+  ~DriftEstimator() = default;
+
+  /** @brief Set the response and clear the state.
+   *  @param sample_rate Rate the fill is read at, in Hz.
+   */
+  void prepare(const Config &config, unsigned int sample_rate) noexcept;
+
+  /** @brief Forget the drift and, for track(), the target. */
+  void reset() noexcept;
+
+  /** @brief Restart the average at an error after a discontinuity, holding the integral until the average
+   *  is back within tolerance_frames, so the excess is not mistaken for clock drift.
+   */
+  void settle(double error_frames, double tolerance_frames) noexcept;
+
+  /** @brief Feed the distance of the fill from its target once per read.
+   *  @param error_frames Buffered frames minus the target.
+   *  @param frames Frames read since the last update.
+   *  @param feed_forward Added to the correction, e.g. for a target that moves at a known rate.
+   *  @return The read rate: frames to consume per frame produced.
+   */
+  double update(double error_frames, size_t frames, double feed_forward = 0.0) noexcept;
+
+  /** @brief Feed the fill of a buffer steered towards the fill it settles at by itself.
+   *  The read rate stays at 1 for the warm-up. The average fill over the next average_seconds becomes
+   *  the target, raised so the fill never dips below two reads, and at most max_target_frames.
+   *  @return The read rate, as update().
+   */
+  double track(size_t fill_frames, size_t max_target_frames, size_t frames) noexcept;
+
+  /** @brief The buffer ran dry: aim track() a block higher and settle on the new target. */
+  void raise_target(size_t frames) noexcept;
+
+  double get_ratio() const noexcept { return m_ratio; }
+
+  /** @brief Returns the estimated drift of the writer's clock against the reader's, as a fraction. */
+  double get_drift() const noexcept { return m_drift; }
+
+  /** @brief Returns the fill track() steers towards, 0 until it has been measured. */
+  double get_target_frames() const noexcept { return m_target_frames; }
+
+private:
+  Config m_config;
+  unsigned int m_sample_rate{0};
+  double m_ratio{1.0};
+  double m_error_average{0.0};
+  double m_drift{0.0};
+  double m_tolerance_frames{0.0};
+  bool m_settling{false};
+
+  // track(): warm-up frames seen, and the fill summed and its low point while the target is measured
+  size_t m_elapsed_frames{0};
+  double m_fill_sum{0.0};
+  size_t m_fill_samples{0};
+  double m_fill_low{0.0};
+  double m_target_frames{0.0};
+  bool m_has_target{false};
+};
+
+} // namespace miniaudioengine::framework
+
+#endif // __DRIFT_ESTIMATOR_H__
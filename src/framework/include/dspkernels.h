@@ -0,0 +1,343 @@
+#ifndef __DSP_KERNELS_H__
+#define __DSP_KERNELS_H__
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace miniaudioengine::framework::dsp
+{
+
+/** @enum eSimdLevel
+ *  @brief Instruction set used by the DSP kernels.
+ */
+enum class eSimdLevel : unsigned int
+{
+  Scalar,
+  SSE2,
+  AVX2,
+  NEON
+};
+
+/** @struct LevelSums
+ *  @brief Largest magnitude and sum of squares of a buffer, measured in one pass.
+ */
+struct LevelSums
+{
+  float peak;
+  float energy;
+};
+
+/** @struct KernelTable
+ *  @brief Function table for one instruction set. Selected once at startup from the CPU's features.
+ *  All kernels accept unaligned pointers. Lengths are in samples unless named frames.
+ */
+struct KernelTable
+{
+  eSimdLevel level;
+
+  void (*add)(float *destination, const float *source, size_t n) noexcept;
+  void (*add_with_gain)(float *destination, const float *source, float gain, size_t n) noexcept;
+  void (*copy_with_gain)(float *destination, const float *source, float gain, size_t n) noexcept;
+  void (*scale)(float *buffer, float gain, size_t n) noexcept;
+  void (*multiply)(float *buffer, const float *gains, size_t n) noexcept;
+  void (*fill_ramp)(float *destination, float start, float step, size_t n) noexcept;
+  void (*fill_exponential_ramp)(float *destination, float start, float ratio, size_t n) noexcept;
+  void (*interpolate_linear)(float *destination, const float *source, size_t stride, double position,
+                             double increment, size_t n) noexcept;
+  void (*clamp)(float *buffer, float minimum, float maximum, size_t n) noexcept;
+  void (*soft_clip)(float *buffer, size_t n) noexcept;
+
+  void (*interleave_stereo)(float *destination, const float *left, const float *right, size_t frames) noexcept;
+  void (*deinterleave_stereo)(float *left, float *right, const float *source, size_t frames) noexcept;
+
+  void (*int16_to_float)(float *destination, const int16_t *source, size_t n) noexcept;
+  void (*float_to_int16)(int16_t *destination, const float *source, size_t n) noexcept;
+  void (*int24_to_float)(float *destination, const uint8_t *source, size_t n) noexcept;
+  void (*int32_to_float)(float *destination, const int32_t *source, size_t n) noexcept;
+  void (*float_to_int32)(int32_t *destination, const float *source, size_t n) noexcept;
+
+  float (*dot)(const float *a, const float *b, size_t n) noexcept;
+
+  LevelSums (*measure_levels)(const float *source, size_t n) noexcept;
+};
+
+namespace detail
+{
+extern std::atomic<const KernelTable *> active_kernels;
+}
+
+/** @brief Returns the kernels of the active instruction set. */
+inline const KernelTable &get_kernels() noexcept
+{
+  return *detail::active_kernels.load(std::memory_order_relaxed);
+}
+
+/** @brief Returns the best instruction set supported by this CPU and build. */
+eSimdLevel get_best_simd_level();
+
+/** @brief Returns the instruction set currently used by the kernels. */
+inline eSimdLevel get_simd_level() noexcept { return get_kernels().level; }
+
+/** @brief Select the instruction set used by the kernels, e.g. to compare paths in benchmarks.
+ *  @return False if the instruction set is not supported. The active kernels are unchanged.
+ *  @note Not intended to be called while audio is rendering.
+ */
+bool set_simd_level(eSimdLevel level);
+
+std::string to_string(eSimdLevel level);
+
+// -----------------------------------------------------------------------------
+// Mixing
+// -----------------------------------------------------------------------------
+
+/** @brief destination[i] += source[i] */
+inline void add(float *destination, const float *source, size_t n) noexcept
+{
+  get_kernels().add(destination, source, n);
+}
+
+/** @brief destination[i] += source[i] * gain */
+inline void add_with_gain(float *destination, const float *source, float gain, size_t n) noexcept
+{
+  get_kernels().add_with_gain(destination, source, gain, n);
+}
+
+/** @brief destination[i] = source[i] * gain */
+inline void copy_with_gain(float *destination, const float *source, float gain, size_t n) noexcept
+{
+  get_kernels().copy_with_gain(destination, source, gain, n);
+}
+
+/** @brief buffer[i] *= gain */
+inline void scale(float *buffer, float gain, size_t n) noexcept
+{
+  get_kernels().scale(buffer, gain, n);
+}
+
+/** @brief buffer[i] *= gains[i], e.g. a per-sample gain ramp from fill_ramp(). */
+inline void multiply(float *buffer, const float *gains, size_t n) noexcept
+{
+  get_kernels().multiply(buffer, gains, n);
+}
+
+/** @struct PanGains
+ *  @brief Left and right gains for a stereo pan position.
+ */
+struct PanGains
+{
+  float left;
+  float right;
+};
+
+/** @brief Constant-power pan law (-3 dB at centre).
+ *  @param pan Position from -1 (hard left) to 1 (hard right).
+ */
+inline PanGains constant_power_pan(float pan) noexcept
+{
+  constexpr float quarter_pi = 0.785398163397448f;
+  const float angle = (std::fmin(std::fmax(pan, -1.0f), 1.0f) + 1.0f) * quarter_pi;
+  return {std::cos(angle), std::sin(angle)};
+}
+
+/** @brief Pan a mono source into a planar stereo destination, accumulating.
+ *  @param gains Gains from constant_power_pan().
+ */
+inline void add_panned(float *left, float *right, const float *source, PanGains gains, size_t frames) noexcept
+{
+  const KernelTable &kernels = get_kernels();
+  kernels.add_with_gain(left, source, gains.left, frames);
+  kernels.add_with_gain(right, source, gains.right, frames);
+}
+
+// -----------------------------------------------------------------------------
+// Ramps
+// -----------------------------------------------------------------------------
+
+/** @brief destination[i] = start + step * i, a linear ramp. */
+inline void fill_ramp(float *destination, float start, float step, size_t n) noexcept
+{
+  get_kernels().fill_ramp(destination, start, step, n);
+}
+
+/** @brief destination[i] = start * ratio^i, an exponential ramp, e.g. a constant dB per sample fade.
+ *  The SIMD paths multiply by ratio once per lane width, so results can differ from the scalar path in the last bits.
+ */
+inline void fill_exponential_ramp(float *destination, float start, float ratio, size_t n) noexcept
+{
+  get_kernels().fill_exponential_ramp(destination, start, ratio, n);
+}
+
+// -----------------------------------------------------------------------------
+// Sample playback
+// -----------------------------------------------------------------------------
+
+/** @brief Read a sample at fractional positions with linear interpolation, e.g. a pitched voice.
+ *  destination[i] = source[p * stride] between its neighbours, for p = position + increment * i.
+ *  @param stride Distance in samples between consecutive frames, the channel count of interleaved audio.
+ *  @param increment Frames advanced per output sample, e.g. 2 plays an octave up. Must be positive.
+ *  @note Reads frames up to floor(position + increment * (n - 1)) + 1, which must be in the source.
+ *        The SIMD paths index the source with 32-bit offsets, so it must hold fewer than 2^31 samples.
+ */
+inline void interpolate_linear(float *destination, const float *source, size_t stride, double position,
+                               double increment, size_t n) noexcept
+{
+  get_kernels().interpolate_linear(destination, source, stride, position, increment, n);
+}
+
+// -----------------------------------------------------------------------------
+// Limiting
+// -----------------------------------------------------------------------------
+
+/** @brief Clamp every sample to [minimum, maximum]. */
+inline void clamp(float *buffer, float minimum, float maximum, size_t n) noexcept
+{
+  get_kernels().clamp(buffer, minimum, maximum, n);
+}
+
+/** @brief Smooth saturation, roughly tanh(x). Unity slope around zero, reaches +/-1 at +/-3. */
+inline void soft_clip(float *buffer, size_t n) noexcept
+{
+  get_kernels().soft_clip(buffer, n);
+}
+
+// -----------------------------------------------------------------------------
+// Channel layout
+// -----------------------------------------------------------------------------
+
+/** @brief Interleave two planar channels into LRLR... */
+inline void interleave_stereo(float *destination, const float *left, const float *right, size_t frames) noexcept
+{
+  get_kernels().interleave_stereo(destination, left, right, frames);
+}
+
+/** @brief Split LRLR... into two planar channels. */
+inline void deinterleave_stereo(float *left, float *right, const float *source, size_t frames) noexcept
+{
+  get_kernels().deinterleave_stereo(left, right, source, frames);
+}
+
+/** @brief Interleave planar channels into one buffer. Uses the stereo kernel for two channels.
+ *  @param stride Distance in samples between the starts of consecutive planar channels.
+ */
+void interleave(float *destination, const float *source, size_t stride, unsigned int channels, size_t frames) noexcept;
+
+/** @brief Split an interleaved buffer into planar channels. Uses the stereo kernel for two channels.
+ *  @param stride Distance in samples between the starts of consecutive planar channels.
+ */
+void deinterleave(float *destination, size_t stride, const float *source, unsigned int channels, size_t frames) noexcept;
+
+/** @brief interleave() for a channel count known at compile time, so the channel loop unrolls. */
+template <unsigned int Channels>
+inline void interleave(float *destination, const float *source, size_t stride, size_t frames) noexcept
+{
+  static_assert(Channels > 0, "Use the runtime overload for a channel count known only at run time");
+  if constexpr (Channels == 1)
+  {
+    std::copy_n(source, frames, destination);
+  }
+  else if constexpr (Channels == 2)
+  {
+    interleave_stereo(destination, source, source + stride, frames);
+  }
+  else
+  {
+    for (size_t frame = 0; frame < frames; frame++)
+    {
+      for (unsigned int channel = 0; channel < Channels; channel++)
+      {
+        destination[frame * Channels + channel] = source[channel * stride + frame];
+      }
+    }
+  }
+}
+
+/** @brief deinterleave() for a channel count known at compile time, so the channel loop unrolls. */
+template <unsigned int Channels>
+inline void deinterleave(float *destination, size_t stride, const float *source, size_t frames) noexcept
+{
+  static_assert(Channels > 0, "Use the runtime overload for a channel count known only at run time");
+  if constexpr (Channels == 1)
+  {
+    std::copy_n(source, frames, destination);
+  }
+  else if constexpr (Channels == 2)
+  {
+    deinterleave_stereo(destination, destination + stride, source, frames);
+  }
+  else
+  {
+    for (size_t frame = 0; frame < frames; frame++)
+    {
+      for (unsigned int channel = 0; channel < Channels; channel++)
+      {
+        destination[channel * stride + frame] = source[frame * Channels + channel];
+      }
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Sample format conversion
+// -----------------------------------------------------------------------------
+
+/** @brief Convert signed 16-bit PCM to float in [-1, 1). */
+inline void int16_to_float(float *destination, const int16_t *source, size_t n) noexcept
+{
+  get_kernels().int16_to_float(destination, source, n);
+}
+
+/** @brief Convert float to signed 16-bit PCM, rounding and saturating out-of-range samples. */
+inline void float_to_int16(int16_t *destination, const float *source, size_t n) noexcept
+{
+  get_kernels().float_to_int16(destination, source, n);
+}
+
+/** @brief Convert packed little-endian signed 24-bit PCM (3 bytes per sample) to float. */
+inline void int24_to_float(float *destination, const uint8_t *source, size_t n) noexcept
+{
+  get_kernels().int24_to_float(destination, source, n);
+}
+
+/** @brief Convert signed 32-bit PCM to float in [-1, 1). */
+inline void int32_to_float(float *destination, const int32_t *source, size_t n) noexcept
+{
+  get_kernels().int32_to_float(destination, source, n);
+}
+
+/** @brief Convert float to signed 32-bit PCM, rounding and saturating out-of-range samples. */
+inline void float_to_int32(int32_t *destination, const float *source, size_t n) noexcept
+{
+  get_kernels().float_to_int32(destination, source, n);
+}
+
+// -----------------------------------------------------------------------------
+// Filtering
+// -----------------------------------------------------------------------------
+
+/** @brief Returns the sum of a[i] * b[i], the inner loop of FIR filters and resamplers.
+ *  The SIMD paths sum in a different order than the scalar path, so results can differ in the last bits.
+ */
+inline float dot(const float *a, const float *b, size_t n) noexcept
+{
+  return get_kernels().dot(a, b, n);
+}
+
+// -----------------------------------------------------------------------------
+// Metering
+// -----------------------------------------------------------------------------
+
+/** @brief Returns the peak magnitude and the sum of squares of a buffer, read once, for peak and RMS meters.
+ *  The SIMD paths sum in a different order than the scalar path, so the energy can differ in the last bits.
+ */
+inline LevelSums measure_levels(const float *source, size_t n) noexcept
+{
+  return get_kernels().measure_levels(source, n);
+}
+
+} // namespace miniaudioengine::framework::dsp
+
+#endif // __DSP_KERNELS_H__
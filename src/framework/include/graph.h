@@ -1,6 +1,7 @@
 #ifndef __GRAPH_H__
 #define __GRAPH_H__
 
+#include <algorithm>
 #include <vector>
 #include <string>
 
@@ -23,8 +24,39 @@ public:
     m_adjacency[parent].push_back(child);
   }
 
+  /** @brief Remove the edge from a parent to a child. Other children keep their order.
+   *  @return False if the edge does not exist.
+   */
+  bool remove_edge(size_t parent, size_t child)
+  {
+    std::vector<size_t> &children = m_adjacency[parent];
+    auto it = std::find(children.begin(), children.end(), child);
+    if (it == children.end())
+    {
+      return false;
+    }
+    children.erase(it);
+    return true;
+  }
+
+  bool has_edge(size_t parent, size_t child) const
+  {
+    const std::vector<size_t> &children = m_adjacency[parent];
+    return std::find(children.begin(), children.end(), child) != children.end();
+  }
+
+  /** @brief Release a node's value, keeping its index so the indices of other nodes never move. */
+  void reset_node(size_t index) { m_nodes[index] = T(); }
+
   T get_root_node() { return m_nodes[0]; }
 
+  size_t get_node_count() const { return m_nodes.size(); }
+
+  const T &get_node(size_t index) const { return m_nodes[index]; }
+
+  /** @brief Returns the indices of the child nodes connected to a parent. */
+  const std::vector<size_t> &get_children(size_t parent) const { return m_adjacency[parent]; }
+
   std::vector<T> get_leaf_nodes()
   {
     std::vector<T> leaf_nodes;
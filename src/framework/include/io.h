@@ -2,6 +2,7 @@
 #define __INPUT_OUTPUT_H__
 
 #include "ringbuffer.h"
+#include "streamconfig.h"
 
 #include <string>
 #include <memory>
@@ -9,7 +10,7 @@
 namespace miniaudioengine::framework
 {
 
-using Buffer = framework::RingBuffer<float, framework::BUFFER_SIZE>;
+using Buffer = framework::RingBuffer<float>;
 using BufferPtr = std::shared_ptr<Buffer>;
 
 /** @enum eInputOutputType
@@ -19,13 +20,15 @@ enum eInputOutputType
 {
   Device,
   File,
+  Network,
   None
 };
 
 enum eInputOutputDirection
 {
   Input,
-  Output
+  Output,
+  Duplex // Input and output of one device in a single stream
 };
 
 /** @class IInputOutput
@@ -54,7 +57,7 @@ public:
     return m_direction;
   }
 
-  virtual bool open_stream(const BufferPtr &buffer) = 0;
+  virtual bool open_stream(const BufferPtr &buffer, const StreamConfig &config) = 0;
   virtual bool close_stream() = 0;
   virtual bool is_stream_open() = 0;
 
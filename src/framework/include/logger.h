@@ -9,18 +9,44 @@
 #include <mutex>
 #include <thread>
 #include <iomanip>
+#include <memory>
+#include <type_traits>
 
-#define LOG_INFO(...) \
-  miniaudioengine::framework::Logger::instance().log(miniaudioengine::framework::eLogLevel::Info, __VA_ARGS__)
+/** @brief Least severe level compiled into the build: 0 Debug, 1 Info, 2 Warning, 3 Error.
+ *  Defaults to 1 when NDEBUG is defined, so LOG_DEBUG and LOG_RT_DEBUG compile out of release builds.
+ */
+#ifndef MINIAUDIOENGINE_LOG_LEVEL
+#ifdef NDEBUG
+#define MINIAUDIOENGINE_LOG_LEVEL 1
+#else
+#define MINIAUDIOENGINE_LOG_LEVEL 0
+#endif
+#endif
 
-#define LOG_WARNING(...) \
-  miniaudioengine::framework::Logger::instance().log(miniaudioengine::framework::eLogLevel::Warning, __VA_ARGS__)
+// Disabled levels are discarded at compile time, their arguments are never evaluated
+#define MINIAUDIOENGINE_LOG_AT(level, method, ...)                                                       \
+  do                                                                                                     \
+  {                                                                                                      \
+    if constexpr (miniaudioengine::framework::get_log_severity(level) >= MINIAUDIOENGINE_LOG_LEVEL)       \
+    {                                                                                                    \
+      miniaudioengine::framework::Logger::instance().method(level, __VA_ARGS__);                         \
+    }                                                                                                    \
+  } while (0)
 
-#define LOG_ERROR(...) \
-  miniaudioengine::framework::Logger::instance().log(miniaudioengine::framework::eLogLevel::Error, __VA_ARGS__)
+#define LOG_INFO(...) MINIAUDIOENGINE_LOG_AT(miniaudioengine::framework::eLogLevel::Info, log, __VA_ARGS__)
+#define LOG_WARNING(...) MINIAUDIOENGINE_LOG_AT(miniaudioengine::framework::eLogLevel::Warning, log, __VA_ARGS__)
+#define LOG_ERROR(...) MINIAUDIOENGINE_LOG_AT(miniaudioengine::framework::eLogLevel::Error, log, __VA_ARGS__)
+#define LOG_DEBUG(...) MINIAUDIOENGINE_LOG_AT(miniaudioengine::framework::eLogLevel::Debug, log, __VA_ARGS__)
 
-#define LOG_DEBUG(...) \
-  miniaudioengine::framework::Logger::instance().log(miniaudioengine::framework::eLogLevel::Debug, __VA_ARGS__)
+/** @brief Realtime-safe logging for audio and streaming threads.
+ *  The first argument must be a string literal and identifies the call site. The rest must be
+ *  numbers, booleans, pointers or string literals. Records are queued without locking or allocating
+ *  and are formatted by the logger's background thread.
+ */
+#define LOG_RT_INFO(...) MINIAUDIOENGINE_LOG_AT(miniaudioengine::framework::eLogLevel::Info, log_realtime, __VA_ARGS__)
+#define LOG_RT_WARNING(...) MINIAUDIOENGINE_LOG_AT(miniaudioengine::framework::eLogLevel::Warning, log_realtime, __VA_ARGS__)
+#define LOG_RT_ERROR(...) MINIAUDIOENGINE_LOG_AT(miniaudioengine::framework::eLogLevel::Error, log_realtime, __VA_ARGS__)
+#define LOG_RT_DEBUG(...) MINIAUDIOENGINE_LOG_AT(miniaudioengine::framework::eLogLevel::Debug, log_realtime, __VA_ARGS__)
 
 namespace miniaudioengine::framework
 {
@@ -33,6 +59,113 @@ enum class eLogLevel
   Debug
 };
 
+/** @brief Returns the severity of a level, from 0 (Debug) to 3 (Error). */
+constexpr int get_log_severity(eLogLevel level)
+{
+  switch (level)
+  {
+  case eLogLevel::Debug:
+    return 0;
+  case eLogLevel::Info:
+    return 1;
+  case eLogLevel::Warning:
+    return 2;
+  case eLogLevel::Error:
+    return 3;
+  }
+  return 3;
+}
+
+/** @struct LogArgument
+ *  @brief One argument of a realtime log record, stored by value.
+ */
+struct LogArgument
+{
+  enum class eType : unsigned char
+  {
+    Signed,
+    Unsigned,
+    Float,
+    Bool,
+    Text,
+    Pointer
+  };
+
+  eType type;
+  union
+  {
+    long long signed_value;
+    unsigned long long unsigned_value;
+    double float_value;
+    bool bool_value;
+    const char *text;
+    const void *pointer;
+  };
+};
+
+/** @struct LogRecord
+ *  @brief Binary log record written by realtime threads and formatted by the logger thread.
+ */
+struct LogRecord
+{
+  static constexpr size_t MAX_ARGUMENTS = 8;
+
+  eLogLevel level;
+  unsigned char argument_count;
+  long long timestamp_ns;   // steady_clock time the record was written
+  const char *format;       // Static string literal naming the call site
+  LogArgument arguments[MAX_ARGUMENTS];
+};
+
+/** @brief Encode one realtime log argument. Only values that stay valid after the call are accepted. */
+template <typename T>
+LogArgument make_log_argument(const T &value) noexcept
+{
+  using Type = std::decay_t<T>;
+  LogArgument argument{};
+  if constexpr (std::is_same_v<Type, bool>)
+  {
+    argument.type = LogArgument::eType::Bool;
+    argument.bool_value = value;
+  }
+  else if constexpr (std::is_same_v<Type, const char *> || std::is_same_v<Type, char *>)
+  {
+    // Must be a string literal or otherwise outlive the record
+    argument.type = LogArgument::eType::Text;
+    argument.text = value;
+  }
+  else if constexpr (std::is_enum_v<Type>)
+  {
+    argument.type = LogArgument::eType::Signed;
+    argument.signed_value = static_cast<long long>(value);
+  }
+  else if constexpr (std::is_integral_v<Type> && std::is_signed_v<Type>)
+  {
+    argument.type = LogArgument::eType::Signed;
+    argument.signed_value = value;
+  }
+  else if constexpr (std::is_integral_v<Type>)
+  {
+    argument.type = LogArgument::eType::Unsigned;
+    argument.unsigned_value = value;
+  }
+  else if constexpr (std::is_floating_point_v<Type>)
+  {
+    argument.type = LogArgument::eType::Float;
+    argument.float_value = value;
+  }
+  else if constexpr (std::is_pointer_v<Type>)
+  {
+    argument.type = LogArgument::eType::Pointer;
+    argument.pointer = value;
+  }
+  else
+  {
+    static_assert(sizeof(Type) == 0, "LOG_RT arguments must be numbers, booleans, pointers or string literals");
+  }
+  return argument;
+}
+
 void set_thread_name(const std::string &name);
 const std::string &get_thread_name();
 
@@ -72,10 +205,65 @@ public:
 
   template <typename... Args>
   void log(eLogLevel level, Args &&...args)
+  {
+    std::ostringstream message_stream;
+    (message_stream << ... << args); // C++17 fold expression
+
+    write(level, std::chrono::system_clock::now(), get_thread_name(), message_stream.str());
+  }
+
+  /** @brief Queue a log record from a realtime thread. Lock-free and allocation-free.
+   *  Each thread gets its own ring the first time it logs. Records are dropped when the ring is full
+   *  or every ring is taken, see get_dropped_record_count().
+   *  @param format String literal naming the call site, printed before the arguments.
+   */
+  template <typename... Args>
+  void log_realtime(eLogLevel level, const char *format, const Args &...args) noexcept
+  {
+    static_assert(sizeof...(Args) <= LogRecord::MAX_ARGUMENTS, "Too many LOG_RT arguments");
+
+    LogRecord record;
+    record.level = level;
+    record.argument_count = static_cast<unsigned char>(sizeof...(Args));
+    record.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now().time_since_epoch()).count();
+    record.format = format;
+
+    [[maybe_unused]] size_t index = 0;
+    ((record.arguments[index++] = make_log_argument(args)), ...);
+
+    push_record(record);
+  }
+
+  /** @brief Format and write every queued realtime record. Called periodically by the logger thread. */
+  void flush_realtime();
+
+  /** @brief Returns the number of realtime records dropped because a ring was full. */
+  unsigned long long get_dropped_record_count() const;
+
+private:
+  struct RealtimeState;
+
+  std::ostream *p_out_stream = &std::cout;
+  std::ostream *p_file_out_stream = nullptr;
+  std::mutex m_log_mutex;
+
+  bool m_console_output_enabled = true;
+  bool m_colors_enabled = true;
+
+  std::unique_ptr<RealtimeState> p_realtime;
+
+  Logger();
+  ~Logger();
+  Logger(const Logger &) = delete;
+  Logger &operator=(const Logger &) = delete;
+
+  void push_record(const LogRecord &record) noexcept;
+
+  void write(eLogLevel level, std::chrono::system_clock::time_point now, const std::string &thread_name, const std::string &message)
   {
     std::lock_guard<std::mutex> lock(m_log_mutex);
 
-    auto now = std::chrono::system_clock::now();
     auto time = std::chrono::system_clock::to_time_t(now);
     auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
     std::tm local_time{};
@@ -89,9 +277,6 @@ public:
     timestamp_stream << std::put_time(&local_time, "%Y-%m-%d %H:%M:%S")
             << '.' << std::setfill('0') << std::setw(3) << ms.count();
 
-    std::ostringstream message_stream;
-    (message_stream << ... << args); // C++17 fold expression
-
     if (m_console_output_enabled)
     {
       // For ERROR and WARNING, color the entire line
@@ -110,10 +295,10 @@ public:
       if (!color_entire_line)
         (*p_out_stream) << get_reset_code();
       
-      if (get_thread_name() != "unnamed")
-        (*p_out_stream) << (m_colors_enabled && !color_entire_line ? "\033[1m" : "") << "[Thread: " << get_thread_name() << "]" << (m_colors_enabled && !color_entire_line ? "\033[0m" : "") << " ";
+      if (thread_name != "unnamed")
+        (*p_out_stream) << (m_colors_enabled && !color_entire_line ? "\033[1m" : "") << "[Thread: " << thread_name << "]" << (m_colors_enabled && !color_entire_line ? "\033[0m" : "") << " ";
       
-      (*p_out_stream) << message_stream.str();
+      (*p_out_stream) << message;
       
       if (color_entire_line)
         (*p_out_stream) << get_reset_code();
@@ -125,25 +310,12 @@ public:
     {
       (*p_file_out_stream) << "[" << timestamp_stream.str() << "] "
                       << "[" << log_level_to_string(level) << "] ";
-      if (get_thread_name() != "unnamed")
-        (*p_file_out_stream) << "[Thread: " << get_thread_name() << "] ";
-      (*p_file_out_stream) << message_stream.str() << "\n";
+      if (thread_name != "unnamed")
+        (*p_file_out_stream) << "[Thread: " << thread_name << "] ";
+      (*p_file_out_stream) << message << "\n";
     }
   }
 
-private:
-  std::ostream *p_out_stream = &std::cout;
-  std::ostream *p_file_out_stream;
-  std::mutex m_log_mutex;
-
-  bool m_console_output_enabled = true;
-  bool m_colors_enabled = true;
-
-  Logger() = default;
-  ~Logger() = default;
-  Logger(const Logger &) = delete;
-  Logger &operator=(const Logger &) = delete;
-
   std::string log_level_to_string(eLogLevel level)
   {
     switch (level)
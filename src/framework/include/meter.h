@@ -0,0 +1,172 @@
+#ifndef __METER_H__
+#define __METER_H__
+
+#include "statesnapshot.h"
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace miniaudioengine::framework
+{
+
+/** @struct MeterConfig
+ *  @brief What a Meter measures. Peak and RMS are always measured, the costlier measurements are opt-in.
+ */
+struct MeterConfig
+{
+  /** @brief Measure inter-sample peaks with 4x oversampling. 48 multiply-adds per sample and channel. */
+  bool true_peak{false};
+
+  /** @brief Measure K-weighted momentary and short-term loudness (ITU-R BS.1770). Two biquads per sample and channel. */
+  bool loudness{false};
+
+  /** @brief Readings published per second, e.g. the UI's frame rate. */
+  unsigned int refresh_rate{30};
+
+  std::string to_string() const;
+};
+
+/** @struct MeterReading
+ *  @brief Levels measured over one refresh interval. Levels are linear, 1 is full scale.
+ */
+struct MeterReading
+{
+  static constexpr unsigned int MAX_CHANNELS = 8;
+
+  unsigned int channels{0};
+  std::array<float, MAX_CHANNELS> peak{};      // Largest sample magnitude
+  std::array<float, MAX_CHANNELS> rms{};       // Root mean square
+  std::array<float, MAX_CHANNELS> true_peak{}; // Largest oversampled magnitude, 0 unless MeterConfig::true_peak
+
+  float momentary_lufs{-std::numeric_limits<float>::infinity()};  // Last 400 ms, unless MeterConfig::loudness
+  float short_term_lufs{-std::numeric_limits<float>::infinity()}; // Last 3 s, unless MeterConfig::loudness
+
+  uint64_t frames{0}; // Frames metered since the graph was compiled
+
+  std::string to_string() const;
+};
+
+/** @brief Returns a linear level in dBFS, -inf for silence. */
+float to_decibels(float level) noexcept;
+
+/** @class Meter
+ *  @brief Level meter attached to a graph node, read at UI rate from any thread.
+ *  The compiled graph measures the node's buffer right after the node renders it, while it is still in
+ *  cache, and publishes a MeterReading once per refresh interval through a StateSnapshot. Measuring never
+ *  locks or allocates, and reading never blocks the audio thread.
+ *  @note Attach a meter to one node only. The node's compiled graphs are its only writer.
+ */
+class Meter
+{
+public:
+  explicit Meter(const MeterConfig &config = MeterConfig()) : m_config(config) {}
+  ~Meter() = default;
+
+  Meter(const Meter &) = delete;
+  Meter &operator=(const Meter &) = delete;
+
+  const MeterConfig &get_config() const { return m_config; }
+
+  /** @brief Returns the latest published reading. Any thread, readers serialise on a mutex. */
+  MeterReading get_reading();
+
+  /** @brief Returns the snapshot a MeterTap publishes readings to. */
+  StateSnapshot<MeterReading> &get_snapshot() { return m_snapshot; }
+
+private:
+  const MeterConfig m_config;
+  std::mutex m_read_mutex;
+  StateSnapshot<MeterReading> m_snapshot;
+};
+
+using MeterPtr = std::shared_ptr<Meter>;
+
+/** @class MeterTap
+ *  @brief The measurement state of one Meter inside one compiled graph.
+ *  Each GraphPlan gets its own tap, so a recompile never touches the filters of a running plan.
+ *  Every block is read once per channel with dsp::measure_levels(). The K-weighting filters and the
+ *  true-peak interpolator, when enabled, read the same samples again while they are still in cache.
+ *  Channels beyond MeterReading::MAX_CHANNELS are not metered.
+ */
+class MeterTap
+{
+public:
+  /** @brief Taps per phase of the 4x true-peak interpolator. */
+  static constexpr unsigned int TRUE_PEAK_TAPS = 12;
+  static constexpr unsigned int TRUE_PEAK_PHASES = 4;
+
+  MeterTap() = default;
+  ~MeterTap() = default;
+
+  /** @brief Reset the tap for a channel count and sample rate. Control thread, before the plan is published.
+   *  @return False if meter is nullptr or the format is invalid.
+   */
+  bool prepare(const MeterPtr &meter, unsigned int channels, unsigned int sample_rate);
+
+  /** @brief Measure a block of planar channels and publish a reading when a refresh interval completes.
+   *  @note Audio thread only. Lock-free and allocation-free.
+   */
+  void process(float *const *channels, unsigned int n_frames) noexcept;
+
+private:
+  /** @struct Biquad
+   *  @brief Transposed direct form II section.
+   */
+  struct Biquad
+  {
+    float b0{1.0f}, b1{0.0f}, b2{0.0f}, a1{0.0f}, a2{0.0f};
+  };
+
+  /** @struct ChannelState
+   *  @brief Accumulators and filter histories of one channel.
+   */
+  struct ChannelState
+  {
+    float peak{0.0f};
+    double energy{0.0};
+    float true_peak{0.0f};
+    float shelf_z1{0.0f}, shelf_z2{0.0f};
+    float highpass_z1{0.0f}, highpass_z2{0.0f};
+    std::array<float, TRUE_PEAK_TAPS - 1> history{}; // Last samples of the previous block, oldest first
+  };
+
+  static constexpr unsigned int MOMENTARY_BLOCKS = 4;   // 400 ms of 100 ms blocks
+  static constexpr unsigned int SHORT_TERM_BLOCKS = 30; // 3 s of 100 ms blocks
+  static constexpr unsigned int TRUE_PEAK_CHUNK = 128;  // Frames interpolated per pass
+
+  void measure_loudness(unsigned int channel, const float *source, unsigned int n_frames) noexcept;
+  void measure_true_peak(unsigned int channel, const float *source, unsigned int n_frames) noexcept;
+  void publish() noexcept;
+
+  MeterPtr p_meter;
+  MeterConfig m_config;
+  unsigned int m_channels{0};
+
+  unsigned int m_publish_interval{0};
+  unsigned int m_publish_position{0};
+  uint64_t m_frames{0};
+  std::array<ChannelState, MeterReading::MAX_CHANNELS> m_state{};
+
+  Biquad m_shelf;
+  Biquad m_highpass;
+  std::array<std::array<float, TRUE_PEAK_TAPS>, TRUE_PEAK_PHASES> m_interpolator{};
+  std::array<float, TRUE_PEAK_TAPS - 1 + 2 * TRUE_PEAK_CHUNK> m_true_peak_window{}; // History, chunk, then one phase
+
+  // K-weighted energy of every channel, summed per 100 ms block
+  unsigned int m_loudness_block_frames{0};
+  unsigned int m_loudness_position{0};
+  double m_loudness_energy{0.0};
+  std::array<double, SHORT_TERM_BLOCKS> m_loudness_blocks{};
+  unsigned int m_loudness_next{0};
+  unsigned int m_loudness_count{0};
+};
+
+using MeterTapPtr = std::shared_ptr<MeterTap>;
+
+} // namespace miniaudioengine::framework
+
+#endif // __METER_H__
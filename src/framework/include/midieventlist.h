@@ -0,0 +1,121 @@
+#ifndef __MIDI_EVENT_LIST_H__
+#define __MIDI_EVENT_LIST_H__
+
+#include "audioblock.h"
+#include "miditypes.h"
+
+#include <algorithm>
+#include <span>
+#include <vector>
+
+namespace miniaudioengine::midi
+{
+
+/** @struct MidiEvent
+ *  @brief A MIDI message placed on a frame of an audio block.
+ */
+struct MidiEvent
+{
+  unsigned int frame_offset; // Frame of the block at which the message takes effect
+  MidiMessage message;
+};
+
+/** @class MidiEventList
+ *  @brief Preallocated list of the MIDI events of one audio block, sorted by frame offset.
+ *  Storage is reserved on a control thread, so filling and clearing the list on the audio thread
+ *  never allocates. Events on the same frame keep the order they were added in.
+ */
+class MidiEventList
+{
+public:
+  MidiEventList() = default;
+  explicit MidiEventList(size_t capacity) { reserve(capacity); }
+
+  /** @brief Reserve room for a number of events. Control thread only. */
+  void reserve(size_t capacity) { m_events.reserve(capacity); }
+
+  /** @brief Insert an event in frame order.
+   *  @return False if the list is full. The event is dropped.
+   *  @note Never allocates.
+   */
+  bool add(const MidiEvent &event) noexcept
+  {
+    if (m_events.size() == m_events.capacity())
+    {
+      return false;
+    }
+
+    // Usually appended, events mostly arrive in order
+    auto position = std::upper_bound(m_events.begin(), m_events.end(), event.frame_offset,
+                                     [](unsigned int offset, const MidiEvent &other) { return offset < other.frame_offset; });
+    m_events.insert(position, event);
+    return true;
+  }
+
+  /** @brief Add every event of another list in [begin_frame, end_frame), rebased so begin_frame becomes frame 0.
+   *  @return False if some events did not fit.
+   */
+  bool add_range(const MidiEventList &other, unsigned int begin_frame, unsigned int end_frame) noexcept
+  {
+    bool added_all = true;
+    for (const MidiEvent &event : other.get_events(begin_frame, end_frame))
+    {
+      added_all &= add({event.frame_offset - begin_frame, event.message});
+    }
+    return added_all;
+  }
+
+  void clear() noexcept { m_events.clear(); }
+
+  /** @brief Returns every event in frame order. */
+  std::span<const MidiEvent> get_events() const noexcept { return m_events; }
+
+  /** @brief Returns the events in [begin_frame, end_frame). Offsets are unchanged. */
+  std::span<const MidiEvent> get_events(unsigned int begin_frame, unsigned int end_frame) const noexcept
+  {
+    auto by_offset = [](const MidiEvent &event, unsigned int offset) { return event.frame_offset < offset; };
+    auto first = std::lower_bound(m_events.begin(), m_events.end(), begin_frame, by_offset);
+    auto last = std::lower_bound(first, m_events.end(), end_frame, by_offset);
+    return {first, last};
+  }
+
+  size_t size() const noexcept { return m_events.size(); }
+  size_t capacity() const noexcept { return m_events.capacity(); }
+  bool empty() const noexcept { return m_events.empty(); }
+
+private:
+  std::vector<MidiEvent> m_events;
+};
+
+/** @brief Process a block in segments that start at each event, so events land on their exact frame.
+ *  @param block The block to split.
+ *  @param events The block's events.
+ *  @param on_event Called as on_event(const MidiEvent &) before the segment starting at the event's frame.
+ *  @param on_segment Called as on_segment(AudioBlockView &) for every non-empty run of frames between events.
+ */
+template <typename OnEvent, typename OnSegment>
+void split_at_events(framework::AudioBlockView &block, const MidiEventList &events, OnEvent &&on_event, OnSegment &&on_segment)
+{
+  unsigned int frame = 0;
+  for (const MidiEvent &event : events.get_events())
+  {
+    const unsigned int event_frame = std::min(event.frame_offset, block.get_frame_count());
+    if (event_frame > frame)
+    {
+      framework::AudioBlockView segment = block.get_sub_block(frame, event_frame - frame);
+      on_segment(segment);
+      frame = event_frame;
+    }
+    on_event(event);
+  }
+
+  if (frame < block.get_frame_count())
+  {
+    framework::AudioBlockView segment = block.get_sub_block(frame, block.get_frame_count() - frame);
+    on_segment(segment);
+  }
+}
+
+} // namespace miniaudioengine::midi
+
+#endif // __MIDI_EVENT_LIST_H__
@@ -0,0 +1,21 @@
+#ifndef __MIDI_QUEUE_H__
+#define __MIDI_QUEUE_H__
+
+#include "miditypes.h"
+#include "ringbuffer.h"
+
+#include <memory>
+
+namespace miniaudioengine::framework
+{
+
+/** @brief Lock-free SPSC queue of MIDI messages from a MIDI input callback to the audio thread. */
+using MidiQueue = RingBuffer<midi::MidiMessage>;
+using MidiQueuePtr = std::shared_ptr<MidiQueue>;
+
+/** @brief Default number of messages a MidiQueue holds between two audio blocks. */
+constexpr size_t MIDI_QUEUE_SIZE = 1024;
+
+} // namespace miniaudioengine::framework
+
+#endif // __MIDI_QUEUE_H__
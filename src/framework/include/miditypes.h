@@ -4,7 +4,10 @@
 #include <string>
 #include <string_view>
 #include <array>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <type_traits>
 
 namespace miniaudioengine::midi
 {
@@ -58,30 +61,51 @@ inline constexpr std::array<std::pair<eMidiMessageType, std::string_view>, 19> m
   {eMidiMessageType::SystemReset, "System Reset"}
 }};
 
+/** @brief Returns the human-readable name of a MIDI message type. */
+constexpr std::string_view get_midi_message_type_name(eMidiMessageType type)
+{
+  for (const auto &[message_type, name] : midi_message_type_names)
+  {
+    if (message_type == type)
+    {
+      return name;
+    }
+  }
+  return "Unknown";
+}
+
 /** @struct MidiMessage
-  * @brief Represents a MIDI message with its delta time received, status, data bytes, and type name.
+  * @brief Represents a MIDI message with its delta time received, timestamp, status and data bytes.
+  * A fixed-size, trivially copyable value so it can be passed through lock-free queues to the audio thread.
   */
 struct MidiMessage
 {
-  double deltatime;  // Time in seconds since the last message
+  double deltatime;      // Time in seconds since the last message
+  uint64_t timestamp;    // Stream frame at which the message was received
   unsigned char status;  // Status byte of the MIDI message
   eMidiMessageType type; // Type of the MIDI message (e.g., Note On, Control Change)
   unsigned char channel; // MIDI channel (0-15)
   unsigned char data1;   // First data byte (e.g., note number, control change number)
   unsigned char data2;   // Second data byte (e.g., velocity, control change value)
-  std::string_view type_name; // Human-readable name of the MIDI message type
 
   int channel_num() const
   {
     return static_cast<int>(channel);
   }
 
-  virtual std::string to_string() const
+  /** @brief Returns the human-readable name of the message type. */
+  std::string_view type_name() const
+  {
+    return get_midi_message_type_name(type);
+  }
+
+  std::string to_string() const
   {
     return "MidiMessage(" +
            std::string("Deltatime=") + std::to_string(deltatime) +
+           ", Timestamp=" + std::to_string(timestamp) +
            ", Status=0x" + std::to_string(static_cast<int>(status)) +
-           ", Type=" + std::string(type_name) +
+           ", Type=" + std::string(type_name()) +
            ", Channel=" + std::to_string(channel_num()) +
            ", Data1=" + std::to_string(static_cast<int>(data1)) +
            ", Data2=" + std::to_string(static_cast<int>(data2)) +
@@ -89,6 +113,30 @@ struct MidiMessage
   }
 };
 
+static_assert(std::is_trivially_copyable_v<MidiMessage>, "MidiMessage must be trivially copyable");
+
+/** @brief Decode a raw MIDI message of up to three bytes.
+ *  @param bytes The status byte followed by its data bytes.
+ *  @param size Number of bytes.
+ *  @param message Receives the decoded message. Its deltatime and timestamp are left unchanged.
+ *  @return False if the bytes do not start with a status byte or are too long, e.g. SysEx.
+ */
+inline bool decode_midi_message(const unsigned char *bytes, size_t size, MidiMessage &message) noexcept
+{
+  if (size == 0 || size > 3 || (bytes[0] & 0x80) == 0)
+  {
+    return false;
+  }
+
+  const unsigned char status = bytes[0];
+  message.status = status;
+  message.type = static_cast<eMidiMessageType>(status < 0xF0 ? (status & 0xF0) : status);
+  message.channel = status < 0xF0 ? (status & 0x0F) : 0;
+  message.data1 = size > 1 ? bytes[1] : 0;
+  message.data2 = size > 2 ? bytes[2] : 0;
+  return true;
+}
+
 /** @struct MidiNoteMessage 
  *  @brief Represents a MIDI note message, derived from MidiMessage, with helper methods to get note number and velocity.
  */
@@ -104,12 +152,13 @@ struct MidiNoteMessage : public MidiMessage
     return static_cast<int>(data2);
   }
 
-  std::string to_string() const override
+  std::string to_string() const
   {
     return "MidiNoteMessage(" +
            std::string("Deltatime=") + std::to_string(deltatime) +
+           ", Timestamp=" + std::to_string(timestamp) +
            ", Status=0x" + std::to_string(static_cast<int>(status)) +
-           ", Type=" + std::string(type_name) +
+           ", Type=" + std::string(type_name()) +
            ", Channel=" + std::to_string(channel_num()) +
            ", Note Number=" + std::to_string(note_number()) +
            ", Velocity=" + std::to_string(velocity()) +
@@ -132,12 +181,13 @@ struct MidiControlMessage : public MidiMessage
     return static_cast<int>(data2);
   }
 
-  std::string to_string() const override
+  std::string to_string() const
   {
     return "MidiControlMessage(" +
            std::string("Deltatime=") + std::to_string(deltatime) +
+           ", Timestamp=" + std::to_string(timestamp) +
            ", Status=0x" + std::to_string(static_cast<int>(status)) +
-           ", Type=" + std::string(type_name) +
+           ", Type=" + std::string(type_name()) +
            ", Channel=" + std::to_string(channel_num()) +
            ", Controller Number=" + std::to_string(controller_number()) +
            ", Controller Value=" + std::to_string(controller_value()) +
@@ -0,0 +1,231 @@
+#ifndef __PARAMETER_H__
+#define __PARAMETER_H__
+
+#include "rcupointer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace miniaudioengine::framework
+{
+
+/** @enum eParameterSmoothing
+ *  @brief How a parameter moves to a new target.
+ */
+enum class eParameterSmoothing
+{
+  None,       // Jump on the next block
+  Linear,     // Constant step per sample, e.g. pan
+  Exponential // Constant ratio per sample, e.g. gain in dB. Linear when crossing or touching zero
+};
+
+/** @enum eAutomationCurve
+ *  @brief Shape of an automation lane from one breakpoint to the next.
+ */
+enum class eAutomationCurve
+{
+  Linear,
+  Exponential, // Linear when either end is zero or they differ in sign
+  Step         // Hold the value until the next breakpoint
+};
+
+/** @struct AutomationPoint
+ *  @brief A value on a frame of the timeline, and the curve to the next point.
+ */
+struct AutomationPoint
+{
+  uint64_t frame{0};
+  float value{0.0f};
+  eAutomationCurve curve{eAutomationCurve::Linear};
+};
+
+/** @class AutomationLane
+ *  @brief Immutable breakpoints sorted by frame.
+ *  Before the first point the lane holds its value, after the last point it holds that one.
+ */
+class AutomationLane
+{
+public:
+  /** @struct Segment
+   *  @brief The run of frames from a frame up to the next breakpoint, as a ramp.
+   */
+  struct Segment
+  {
+    float start{0.0f};       // Value at the frame
+    float increment{0.0f};   // Step per frame for linear, ratio per frame for exponential
+    eAutomationCurve curve{eAutomationCurve::Step};
+    uint64_t end_frame{std::numeric_limits<uint64_t>::max()}; // Frame of the next breakpoint
+  };
+
+  /** @param points Breakpoints in any order. Points on the same frame keep their order. */
+  explicit AutomationLane(std::vector<AutomationPoint> points);
+
+  const std::vector<AutomationPoint> &get_points() const noexcept { return m_points; }
+
+  bool empty() const noexcept { return m_points.empty(); }
+
+  /** @brief Returns the index of the last point at or before a frame, or 0 before the first point. Binary search. */
+  size_t find(uint64_t frame) const noexcept;
+
+  /** @brief Returns the ramp from a frame to the next breakpoint.
+   *  @param index The last point at or before frame, from find() or an AutomationCursor.
+   */
+  Segment get_segment(size_t index, uint64_t frame) const noexcept;
+
+  /** @brief Returns the value at a frame. Searches the lane, use an AutomationCursor on the audio thread. */
+  float evaluate(uint64_t frame) const noexcept;
+
+private:
+  std::vector<AutomationPoint> m_points;
+};
+
+/** @class AutomationCursor
+ *  @brief Audio thread position in an AutomationLane.
+ *  Playback moves forward block by block, so the cursor walks from the breakpoint it found last
+ *  time instead of searching the lane. It only searches after a jump backwards, e.g. a locate.
+ */
+class AutomationCursor
+{
+public:
+  /** @brief Returns the index of the last point at or before a frame. */
+  size_t seek(const AutomationLane &lane, uint64_t frame) noexcept
+  {
+    const std::vector<AutomationPoint> &points = lane.get_points();
+    if (m_index >= points.size() || (m_index > 0 && points[m_index].frame > frame))
+    {
+      m_index = lane.find(frame);
+    }
+    while (m_index + 1 < points.size() && points[m_index + 1].frame <= frame)
+    {
+      m_index++;
+    }
+    return m_index;
+  }
+
+  void reset() noexcept { m_index = 0; }
+
+private:
+  size_t m_index{0};
+};
+
+/** @class Parameter
+ *  @brief A named value processors read once per block, set from any thread.
+ *  Control threads, MIDI and the UI store a target atomically. The audio thread ramps towards it
+ *  over the smoothing time, either per sample with process(), which fills a block of values with
+ *  the SIMD ramp kernels, or per block with process_block(). An automation lane, when set, drives
+ *  the value from the timeline instead and the target takes over again once it is cleared.
+ */
+class Parameter
+{
+public:
+  static constexpr double DEFAULT_SMOOTHING_SECONDS = 0.02;
+
+  /** @param name Unique name within a ParameterRegistry.
+   *  @param minimum Lowest value. set_value() clamps to [minimum, maximum].
+   *  @param maximum Highest value.
+   *  @param default_value Initial value.
+   *  @param smoothing How the value moves to a new target.
+   *  @param smoothing_seconds How long the move takes.
+   */
+  Parameter(std::string name, float minimum, float maximum, float default_value,
+            eParameterSmoothing smoothing = eParameterSmoothing::Linear,
+            double smoothing_seconds = DEFAULT_SMOOTHING_SECONDS);
+  ~Parameter() = default;
+
+  Parameter(const Parameter &) = delete;
+  Parameter &operator=(const Parameter &) = delete;
+
+  const std::string &get_name() const noexcept { return m_name; }
+  float get_minimum() const noexcept { return m_minimum; }
+  float get_maximum() const noexcept { return m_maximum; }
+  float get_default_value() const noexcept { return m_default_value; }
+  eParameterSmoothing get_smoothing() const noexcept { return m_smoothing; }
+
+  /** @brief Set the target, clamped to the range. Lock-free, e.g. from a MIDI callback. */
+  void set_value(float value) noexcept;
+
+  /** @brief Returns the target. */
+  float get_value() const noexcept { return m_target.load(std::memory_order_relaxed); }
+
+  /** @brief Set the target from 0 (minimum) to 1 (maximum). */
+  void set_normalized(float normalized) noexcept;
+
+  float get_normalized() const noexcept;
+
+  /** @brief Returns the value the audio thread last reached, e.g. to draw a moving fader. */
+  float get_current_value() const noexcept { return m_reported.load(std::memory_order_relaxed); }
+
+  /** @brief Replace the automation lane. The audio thread follows it from its next block.
+   *  @note Control threads only. Allocates.
+   */
+  void set_automation(const std::vector<AutomationPoint> &points);
+
+  /** @brief Remove the automation lane. The value ramps back to the target. */
+  void clear_automation();
+
+  bool has_automation() const noexcept { return m_automation.has_value(); }
+
+  /** @brief Size the value buffer for a stream format.
+   *  @note Control thread only, while the parameter is not being rendered.
+   */
+  void prepare(unsigned int sample_rate, unsigned int max_block);
+
+  /** @brief Move towards the target over a block and return a value per sample.
+   *  @param frames Frames in the block, at most the max_block passed to prepare().
+   *  @return frames values, valid until the next call.
+   *  @note Audio thread only. Lock-free and allocation-free.
+   */
+  const float *process(unsigned int frames) noexcept;
+
+  /** @brief Follow the automation lane over a block of the timeline, or the target without one.
+   *  @param timeline_frame Timeline frame of the first sample, e.g. from the session transport.
+   */
+  const float *process(unsigned int frames, uint64_t timeline_frame) noexcept;
+
+  /** @brief Move towards the target over a block and return the value reached, for parameters read once per block.
+   *  @note Audio thread only. Lock-free and allocation-free.
+   */
+  float process_block(unsigned int frames) noexcept;
+
+  /** @brief Returns true while the value is still moving towards the target. Audio thread only. */
+  bool is_smoothing() const noexcept { return m_ramp_remaining > 0; }
+
+  /** @brief Jump to the target, e.g. when playback restarts. Audio thread, or while not rendered. */
+  void snap() noexcept;
+
+private:
+  /** @brief Audio thread: start a ramp if the target moved since the last block. */
+  void follow_target() noexcept;
+
+  const std::string m_name;
+  const float m_minimum;
+  const float m_maximum;
+  const float m_default_value;
+  const eParameterSmoothing m_smoothing;
+  const double m_smoothing_seconds;
+
+  std::atomic<float> m_target;
+  std::atomic<float> m_reported;
+  RcuPointer<AutomationLane> m_automation;
+
+  // Audio thread only
+  std::vector<float> m_values;
+  AutomationCursor m_cursor;
+  float m_current;
+  float m_ramp_target;
+  float m_increment{0.0f}; // Step per sample, or ratio per sample for exponential ramps
+  bool m_exponential_ramp{false};
+  unsigned int m_ramp_remaining{0};
+  unsigned int m_smoothing_frames{0};
+};
+
+using ParameterPtr = std::shared_ptr<Parameter>;
+using ParameterList = std::vector<ParameterPtr>;
+
+} // namespace miniaudioengine::framework
+
+#endif // __PARAMETER_H__
@@ -0,0 +1,127 @@
+#ifndef __PARAMETER_REGISTRY_H__
+#define __PARAMETER_REGISTRY_H__
+
+#include "midicontroltypes.h"
+#include "midieventlist.h"
+#include "parameter.h"
+#include "rcupointer.h"
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace miniaudioengine::framework
+{
+
+/** @class ParameterRegistry
+ *  @brief The parameters of a processor by name, and the MIDI controllers mapped to them.
+ *  Parameters are added and mapped on control threads. The controller map is a fixed table of
+ *  every channel and controller number, published to the audio thread as an immutable copy, so a
+ *  Control Change is applied with one lookup and one atomic store: no locks and no allocation.
+ */
+class ParameterRegistry
+{
+public:
+  static constexpr unsigned int MIDI_CHANNELS = 16;
+  static constexpr unsigned int MIDI_CONTROLLERS = 128;
+
+  /** @brief Channel of a mapping that follows the controller on every channel. */
+  static constexpr unsigned int ANY_CHANNEL = MIDI_CHANNELS;
+
+  ParameterRegistry();
+  ~ParameterRegistry() = default;
+
+  ParameterRegistry(const ParameterRegistry &) = delete;
+  ParameterRegistry &operator=(const ParameterRegistry &) = delete;
+
+  /** @brief Create and register a parameter. See Parameter::Parameter().
+   *  @return The parameter, or nullptr if one with the name exists.
+   */
+  ParameterPtr add(const std::string &name, float minimum, float maximum, float default_value,
+                   eParameterSmoothing smoothing = eParameterSmoothing::Linear,
+                   double smoothing_seconds = Parameter::DEFAULT_SMOOTHING_SECONDS);
+
+  /** @brief Returns the parameter with a name, or nullptr. */
+  ParameterPtr get(const std::string &name) const;
+
+  ParameterList get_parameters() const;
+
+  /** @brief Set a parameter's target by name.
+   *  @return False if no parameter has the name.
+   */
+  bool set_value(const std::string &name, float value);
+
+  /** @brief Drive a parameter from a MIDI controller, scaling 0-127 onto [minimum, maximum] of the
+   *  parameter's normalized range, so 1 to 0 inverts it. Replaces any mapping of the controller.
+   *  @param channel MIDI channel 0-15, or ANY_CHANNEL. A mapping on the exact channel wins over ANY_CHANNEL.
+   *  @return False if no parameter has the name, or the controller or channel is out of range.
+   */
+  bool map_midi_controller(const std::string &name, unsigned int controller, unsigned int channel = ANY_CHANNEL,
+                           float minimum = 0.0f, float maximum = 1.0f);
+
+  bool map_midi_controller(const std::string &name, midi::eMidiController controller, unsigned int channel = ANY_CHANNEL,
+                           float minimum = 0.0f, float maximum = 1.0f)
+  {
+    return map_midi_controller(name, static_cast<unsigned int>(controller), channel, minimum, maximum);
+  }
+
+  /** @brief Remove a controller mapping. Returns false if the controller was not mapped on the channel. */
+  bool unmap_midi_controller(unsigned int controller, unsigned int channel = ANY_CHANNEL);
+
+  void clear_midi_map();
+
+  /** @brief Prepare every parameter for a stream format, e.g. from IProcessor::prepare(). */
+  void prepare(unsigned int sample_rate, unsigned int max_block);
+
+  /** @brief Jump every parameter to its target, e.g. from IProcessor::reset(). */
+  void snap();
+
+  /** @brief Apply a Control Change to the parameter mapped to it.
+   *  @return True if a parameter is mapped to the controller.
+   *  @note Lock-free and allocation-free. Audio thread, one at a time.
+   */
+  bool handle_midi(const midi::MidiMessage &message) noexcept;
+
+  /** @brief Apply every Control Change of a block, e.g. from IProcessor::process().
+   *  @return Number of events that moved a parameter.
+   *  @note Lock-free and allocation-free. Audio thread, one at a time.
+   */
+  size_t handle_midi(const midi::MidiEventList &events) noexcept;
+
+private:
+  /** @struct ControllerMapping
+   *  @brief The parameter one controller on one channel drives.
+   */
+  struct ControllerMapping
+  {
+    Parameter *parameter{nullptr};
+    float minimum{0.0f};
+    float maximum{1.0f};
+  };
+
+  /** @struct ControllerTable
+   *  @brief Immutable copy of the controller map read by the audio thread.
+   *  Row ANY_CHANNEL holds the mappings for every channel. The parameters are kept alive by the registry.
+   */
+  struct ControllerTable
+  {
+    std::array<ControllerMapping, (MIDI_CHANNELS + 1) * MIDI_CONTROLLERS> mappings{};
+  };
+
+  static size_t get_slot(unsigned int channel, unsigned int controller) { return channel * MIDI_CONTROLLERS + controller; }
+
+  ParameterPtr find_locked(const std::string &name) const;
+
+  void publish_locked();
+
+  mutable std::mutex m_mutex;
+  ParameterList m_parameters;
+  std::unique_ptr<ControllerTable> p_controllers;
+  RcuPointer<ControllerTable> m_table;
+};
+
+} // namespace miniaudioengine::framework
+
+#endif // __PARAMETER_REGISTRY_H__
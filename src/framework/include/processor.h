@@ -1,19 +1,25 @@
 #ifndef __PROCESSOR_H__
 #define __PROCESSOR_H__
 
+#include "audioblock.h"
+#include "midieventlist.h"
+#include "miditypes.h"
+
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace miniaudioengine::framework
 {
 
-namespace adapters
-{
-using AudioStreamStatus = unsigned int;
-}
-
 /** @class IProcessor
- *  @brief This is an abstract interface designated the derived object is an audio or MIDI I/O interface.
+ *  @brief This is an abstract interface designated the derived object processes audio or MIDI.
+ *  Audio processors are driven in three steps:
+ *  - prepare() is called on a control thread before the processor is rendered, so it can allocate
+ *    everything it needs for the largest block it will see.
+ *  - process() is called on the audio thread for every block, with the MIDI events landing in it.
+ *  - reset() clears internal state such as filter memory, e.g. when playback restarts.
+ *  Processors that delay their output, e.g. lookahead effects, report it with get_latency_frames().
  */
 class IProcessor
 {
@@ -21,28 +27,46 @@ public:
   IProcessor() = default;
   virtual ~IProcessor() = default;
 
-  virtual void audio_input_callback(void *output_buffer, void *input_buffer, unsigned int n_frames,
-                                   double stream_time, adapters::AudioStreamStatus status, void *user_data) noexcept
+  /** @brief Prepare the processor for a stream format.
+   *  @param sample_rate Sample rate in Hz.
+   *  @param max_block Largest number of frames passed to a single process() call.
+   *  @param channels Number of channels of every block.
+   *  @note Control thread only. Never called while the processor is being rendered with another format.
+   */
+  virtual void prepare(unsigned int sample_rate, unsigned int max_block, unsigned int channels)
   {
-    (void)output_buffer;
-    (void)input_buffer;
-    (void)n_frames;
-    (void)stream_time;
-    (void)status;
-    (void)user_data;
+    (void)sample_rate;
+    (void)max_block;
+    (void)channels;
   }
 
-  virtual void audio_output_callback(void *output_buffer, void *input_buffer, unsigned int n_frames,
-                                    double stream_time, adapters::AudioStreamStatus status, void *user_data) noexcept
+  /** @brief Process one block of planar audio in place.
+   *  @param block The audio to process.
+   *  @param events MIDI events landing in this block, sorted by frame offset. Processors that need
+   *         sample-accurate timing can render between events with midi::split_at_events().
+   *  @note Audio thread only. Must not lock, allocate or block.
+   */
+  virtual void process(AudioBlockView &block, const midi::MidiEventList &events) noexcept
   {
-    (void)output_buffer;
-    (void)input_buffer;
-    (void)n_frames;
-    (void)stream_time;
-    (void)status;
-    (void)user_data;
+    (void)block;
+    (void)events;
   }
 
+  /** @brief Clear internal state without changing the prepared format. */
+  virtual void reset() {}
+
+  /** @brief Returns the frames by which the processor delays its output, e.g. a limiter's lookahead.
+   *  Read by AudioGraph::compile() after prepare(), which delays parallel paths to match.
+   */
+  virtual unsigned int get_latency_frames() const { return 0; }
+
+  /** @brief Receive the latency of the audio reaching the processor: the longest compensated path
+   *  feeding its node plus the processors before it in the chain. Processors that record or
+   *  timestamp their input use it to line up with the timeline.
+   *  @note Called by AudioGraph::compile() on a control thread, possibly while the processor renders.
+   */
+  virtual void set_input_latency(unsigned int frames) { (void)frames; }
+
   virtual void midi_input_callback(double deltatime, std::vector<unsigned char> *message, void *user_data)
   {
     (void)deltatime;
@@ -64,4 +88,4 @@ using IProcessorPtr = std::shared_ptr<IProcessor>;
 
 } // namespace miniaudioengine::framework
 
-#endif // __PROCESSOR_H__
\ No newline at end of file
+#endif // __PROCESSOR_H__
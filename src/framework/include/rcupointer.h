@@ -0,0 +1,148 @@
+#ifndef __RCU_POINTER_H__
+#define __RCU_POINTER_H__
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace miniaudioengine::framework
+{
+
+/** @class RcuPointer
+ *  @brief Read-copy-update pointer for publishing immutable snapshots to realtime readers.
+ *  Writers build a new object off the audio thread and publish() it with a single atomic exchange.
+ *  Readers enter a read-side section by recording the current epoch in their slot, which costs two
+ *  atomic stores and one load: no locks, no allocation and no reference counting. Replaced objects
+ *  are retired and only destroyed by a writer once every reader has left the epoch they were
+ *  published in.
+ *  @tparam T The type of the published object.
+ *  @tparam MaxReaders The number of concurrent reader threads. Each reader uses its own slot.
+ */
+template <typename T, size_t MaxReaders = 1>
+class RcuPointer
+{
+public:
+  /** @class ReadGuard
+   *  @brief Keeps the object observed by a reader alive until the guard goes out of scope.
+   */
+  class ReadGuard
+  {
+  public:
+    ReadGuard(const ReadGuard &) = delete;
+    ReadGuard &operator=(const ReadGuard &) = delete;
+
+    ~ReadGuard()
+    {
+      p_slot->store(0, std::memory_order_release);
+    }
+
+    T *get() const noexcept { return p_object; }
+    T *operator->() const noexcept { return p_object; }
+    T &operator*() const noexcept { return *p_object; }
+    explicit operator bool() const noexcept { return p_object != nullptr; }
+
+  private:
+    friend class RcuPointer;
+
+    ReadGuard(std::atomic<uint64_t> *slot, T *object) noexcept : p_slot(slot), p_object(object) {}
+
+    std::atomic<uint64_t> *p_slot;
+    T *p_object;
+  };
+
+  RcuPointer() = default;
+
+  ~RcuPointer()
+  {
+    // No readers may be active once the owner is destroyed
+    delete p_current.load(std::memory_order_acquire);
+  }
+
+  RcuPointer(const RcuPointer &) = delete;
+  RcuPointer &operator=(const RcuPointer &) = delete;
+
+  /** @brief Enter a read-side section and return the current object (which may be null).
+   *  @param reader The reader slot owned by the calling thread. Slots must not be shared between threads
+   *         and a slot may only hold one ReadGuard at a time.
+   *  @note Lock-free and allocation-free. Safe to call from the audio thread.
+   */
+  ReadGuard read(size_t reader = 0) noexcept
+  {
+    std::atomic<uint64_t> &slot = m_reader_epochs[reader];
+    slot.store(m_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    return ReadGuard(&slot, p_current.load(std::memory_order_seq_cst));
+  }
+
+  /** @brief Publish a new object, replacing the current one.
+   *  The replaced object is retired and destroyed once no reader can still be using it.
+   *  @note Control threads only. May allocate and lock.
+   */
+  void publish(std::unique_ptr<T> object)
+  {
+    std::lock_guard<std::mutex> lock(m_writer_mutex);
+
+    T *previous = p_current.exchange(object.release(), std::memory_order_seq_cst);
+    const uint64_t retire_epoch = m_epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+    if (previous != nullptr)
+    {
+      m_retired.emplace_back(retire_epoch, std::unique_ptr<T>(previous));
+    }
+
+    reclaim_locked();
+  }
+
+  /** @brief Destroy retired objects that no reader can still observe.
+   *  @note Control threads only.
+   */
+  void reclaim()
+  {
+    std::lock_guard<std::mutex> lock(m_writer_mutex);
+    reclaim_locked();
+  }
+
+  /** @brief Returns the number of retired objects still waiting for readers to move on. */
+  size_t get_retired_count() const
+  {
+    std::lock_guard<std::mutex> lock(m_writer_mutex);
+    return m_retired.size();
+  }
+
+  /** @brief Returns true if an object is currently published. */
+  bool has_value() const noexcept
+  {
+    return p_current.load(std::memory_order_acquire) != nullptr;
+  }
+
+private:
+  void reclaim_locked()
+  {
+    // The oldest epoch any reader is still inside. Objects retired after that epoch began are in use.
+    uint64_t oldest_reader = UINT64_MAX;
+    for (const auto &slot : m_reader_epochs)
+    {
+      const uint64_t epoch = slot.load(std::memory_order_seq_cst);
+      if (epoch != 0 && epoch < oldest_reader)
+      {
+        oldest_reader = epoch;
+      }
+    }
+
+    std::erase_if(m_retired, [oldest_reader](const auto &retired) { return retired.first <= oldest_reader; });
+  }
+
+  // Epoch 0 marks an idle reader slot, so the global epoch starts at 1
+  std::atomic<uint64_t> m_epoch{1};
+  std::atomic<T *> p_current{nullptr};
+  std::array<std::atomic<uint64_t>, MaxReaders> m_reader_epochs{};
+
+  mutable std::mutex m_writer_mutex;
+  std::vector<std::pair<uint64_t, std::unique_ptr<T>>> m_retired;
+};
+
+} // namespace miniaudioengine::framework
+
+#endif // __RCU_POINTER_H__
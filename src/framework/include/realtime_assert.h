@@ -1,13 +1,114 @@
 #ifndef __RT_ASSERT_H__
 #define __RT_ASSERT_H__
 
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
 namespace miniaudioengine::framework
 {
 
+/** @brief Realtime safety checks.
+ *  When built with ENABLE_REALTIME_CHECKS, the RT_ASSERT_* macros mark the rest of the enclosing
+ *  scope as realtime on the calling thread. Heap allocations (global operator new/delete) and, on
+ *  Linux, pthread mutex acquisitions made inside such a scope are recorded as violations, as is a
+ *  scope that outlives its RT_ASSERT_BOUNDED_TIME() budget. Violations are written to a lock-free
+ *  report buffer that control threads read with get_realtime_violations().
+ *  Without ENABLE_REALTIME_CHECKS the macros compile to nothing and no violations are recorded.
+ */
+namespace realtime
+{
+
+/** @enum eViolation
+ *  @brief Kinds of realtime safety violation.
+ */
+enum class eViolation : unsigned char
+{
+  Allocation,
+  Deallocation,
+  Lock,
+  Deadline
+};
+
+/** @struct Violation
+ *  @brief One recorded violation.
+ */
+struct Violation
+{
+  eViolation type;
+  uint64_t detail;      // Bytes allocated, or microseconds taken for a deadline
+  const char *file;     // Location of the innermost RT_ASSERT_* scope
+  int line;
+};
+
+/** @brief Largest number of violations held until clear_realtime_violations(). Later ones are only counted. */
+constexpr size_t MAX_VIOLATIONS = 1024;
+
+/** @class Scope
+ *  @brief Marks the calling thread realtime for the lifetime of the object. Used by the RT_ASSERT_* macros.
+ */
+class Scope
+{
+public:
+  /** @param check_allocations Record heap allocations made in the scope.
+   *  @param check_locks Record mutex acquisitions made in the scope.
+   *  @param max_us Record a violation if the scope takes longer. 0 disables the deadline.
+   */
+  Scope(bool check_allocations, bool check_locks, uint64_t max_us, const char *file, int line) noexcept;
+  ~Scope();
+
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+
+private:
+  bool m_check_allocations;
+  bool m_check_locks;
+  uint64_t m_max_us;
+  uint64_t m_start_ticks;
+  const char *m_file;
+  int m_line;
+  const Scope *p_parent;
+};
+
+/** @brief Returns true if the calling thread is inside a scope that checks allocations. */
+bool is_checking_allocations() noexcept;
+
+/** @brief Returns true if the calling thread is inside a scope that checks locks. */
+bool is_checking_locks() noexcept;
+
+/** @brief Record a violation against the calling thread's innermost scope. Lock-free and allocation-free. */
+void report_violation(eViolation type, uint64_t detail) noexcept;
+
+} // namespace realtime
+
+/** @brief Returns the number of violations recorded since the last clear, including any that did not fit. */
+size_t get_realtime_violation_count();
+
+/** @brief Returns a copy of the recorded violations. Control thread only. */
+std::vector<realtime::Violation> get_realtime_violations();
+
+/** @brief Forget every recorded violation. Call while no realtime scope is active. */
+void clear_realtime_violations();
+
+std::string to_string(const realtime::Violation &violation);
+
+#define RT_ASSERT_CONCAT_IMPL(a, b) a##b
+#define RT_ASSERT_CONCAT(a, b) RT_ASSERT_CONCAT_IMPL(a, b)
+
+#ifdef ENABLE_REALTIME_CHECKS
+#define RT_ASSERT_NO_LOCKS() \
+  miniaudioengine::framework::realtime::Scope RT_ASSERT_CONCAT(rt_assert_scope_, __LINE__)(false, true, 0, __FILE__, __LINE__)
+#define RT_ASSERT_NO_ALLOCATIONS() \
+  miniaudioengine::framework::realtime::Scope RT_ASSERT_CONCAT(rt_assert_scope_, __LINE__)(true, false, 0, __FILE__, __LINE__)
+#define RT_ASSERT_BOUNDED_TIME(max_us) \
+  miniaudioengine::framework::realtime::Scope RT_ASSERT_CONCAT(rt_assert_scope_, __LINE__)(false, false, (max_us), __FILE__, __LINE__)
+#else
 #define RT_ASSERT_NO_LOCKS()
 #define RT_ASSERT_NO_ALLOCATIONS()
-#define RT_ASSERT_BOUNDED_TIME(max_us)
+#define RT_ASSERT_BOUNDED_TIME(max_us) ((void)sizeof(max_us))
+#endif
 
 } // namespace miniaudioengine::framework
 
-#endif // __RT_ASSERT_H__
\ No newline at end of file
+#endif // __RT_ASSERT_H__
@@ -0,0 +1,89 @@
+#ifndef __REALTIME_MEMORY_H__
+#define __REALTIME_MEMORY_H__
+
+#include <cstddef>
+#include <string>
+
+namespace miniaudioengine::framework
+{
+
+/** @struct RealtimeMemoryStatistics
+ *  @brief Snapshot of the realtime memory pool.
+ */
+struct RealtimeMemoryStatistics
+{
+  bool enabled{false};          // Realtime memory mode is on
+  bool process_locked{false};   // The whole process is locked with mlockall()
+  size_t pool_bytes{0};         // Bytes reserved by the pool, free blocks included
+  size_t locked_bytes{0};       // Bytes of the pool locked in memory
+  size_t failed_lock_bytes{0};  // Bytes of the pool the OS refused to lock, e.g. above RLIMIT_MEMLOCK
+
+  std::string to_string() const;
+};
+
+/** @brief Memory of the realtime working set: ring buffers, graph arenas, loop buffers and samples.
+ *  A page touched for the first time in the audio callback costs a page fault, and a page the OS
+ *  swapped out costs a disk read, either of which can miss a period. Realtime buffers are therefore
+ *  allocated from a pool that hands them out zeroed, so every page is faulted in on the control thread
+ *  that allocates it. While realtime memory mode is enabled the pool's pages are also locked in RAM:
+ *  with mlockall() where the process may lock without limit, otherwise region by region with mlock()
+ *  (VirtualLock() on Windows) until the OS refuses.
+ *  Small buffers are carved from page-aligned chunks and recycled through per-size free lists, large
+ *  ones get page-aligned blocks of their own, so unlocking one buffer never unlocks a neighbour's page.
+ *  @note allocate() and deallocate() take a mutex. Control threads only.
+ */
+namespace realtime_memory
+{
+
+/** @brief Stack touched by prefault_stack(), well inside the smallest stacks audio drivers create. */
+constexpr size_t STACK_PREFAULT_BYTES = 64 * 1024;
+
+/** @brief Enter realtime memory mode: lock the pool's current and future pages in memory.
+ *  @return True if every pool page is locked. False leaves the mode on with the pages prefaulted only.
+ */
+bool enable();
+
+/** @brief Leave realtime memory mode and unlock the pool. */
+void disable();
+
+bool is_enabled() noexcept;
+
+/** @brief Allocate a zeroed realtime buffer, locked if realtime memory mode is enabled.
+ *  @param alignment A power of two. Blocks are aligned to at least 64 bytes.
+ *  @throws std::bad_alloc if the memory cannot be allocated.
+ */
+void *allocate(size_t bytes, size_t alignment = 64);
+
+/** @brief Allocate a zeroed realtime buffer on pages of its own, locked whether or not realtime memory mode is
+ *  enabled and kept locked until it is freed. For buffers that must never be swapped out, e.g. loop recordings.
+ *  @param locked Set to true if the OS locked the pages.
+ *  @throws std::bad_alloc if the memory cannot be allocated.
+ */
+void *allocate_pinned(size_t bytes, size_t alignment, bool &locked);
+
+/** @brief Return a buffer from allocate() or allocate_pinned() to the pool, with the size and alignment it was
+ *  allocated with.
+ */
+void deallocate(void *data, size_t bytes, size_t alignment = 64) noexcept;
+
+/** @brief Lock memory the pool does not own, e.g. a memory-mapped sample file, reading it in if needed.
+ *  The lock ends when the memory is unmapped or freed.
+ *  @return False if the OS refused.
+ */
+bool lock(const void *data, size_t bytes) noexcept;
+
+/** @brief Fault in every page of a region that was allocated elsewhere, keeping its contents. */
+void prefault(void *data, size_t bytes) noexcept;
+
+/** @brief Fault in STACK_PREFAULT_BYTES of the calling thread's stack.
+ *  Call once when a realtime thread starts, so deep calls in its first block do not fault.
+ */
+void prefault_stack() noexcept;
+
+RealtimeMemoryStatistics get_statistics();
+
+} // namespace realtime_memory
+
+} // namespace miniaudioengine::framework
+
+#endif // __REALTIME_MEMORY_H__
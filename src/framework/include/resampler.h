@@ -0,0 +1,142 @@
+#ifndef __RESAMPLER_H__
+#define __RESAMPLER_H__
+
+#include "samplebuffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace miniaudioengine::framework
+{
+
+/** @enum eResampleQuality
+ *  @brief Filter length and accuracy of a Resampler.
+ */
+enum class eResampleQuality : unsigned int
+{
+  Fast,     // 8 taps, nearest phase. Lowest CPU, for live monitoring
+  Balanced, // 32 taps, interpolated phases
+  High      // 64 taps, interpolated phases. For offline bounces and load-time conversion
+};
+
+std::string to_string(eResampleQuality quality);
+
+/** @class Resampler
+ *  @brief Streaming polyphase windowed-sinc sample-rate converter for interleaved float audio.
+ *  A Kaiser-windowed sinc is tabulated at a fixed number of sub-sample phases when the resampler is
+ *  prepared. Each output frame is then one dot product per channel between the filter phase and the
+ *  channel's history, using the SIMD dsp::dot kernel. The read position advances by the exact
+ *  rational ratio source_rate / target_rate, so long streams never drift. When downsampling, the
+ *  cutoff follows the target rate and the filter is lengthened by the same ratio.
+ *  A resampler prepared with a max_correction is adaptive: set_rate_correction() scales the ratio
+ *  by a read rate close to 1, e.g. from a DriftEstimator following another device's clock. Its step
+ *  is then a 32-bit binary fraction instead of the exact ratio, which the caller's control loop absorbs.
+ *  The resampler is pull driven: ask get_input_frames_needed() for a block, read that many frames
+ *  from the source and pass them to process(). The first output frame lands exactly on the first
+ *  input frame, so the output is not delayed, but the first block reads get_taps() / 2 frames ahead.
+ *  @note prepare() allocates and must be called on a control thread. process() and reset() are
+ *        lock-free and allocation-free.
+ */
+class Resampler
+{
+public:
+  Resampler() = default;
+  ~Resampler() = default;
+
+  Resampler(const Resampler &) = delete;
+  Resampler &operator=(const Resampler &) = delete;
+
+  /** @brief Design the filter and allocate the history for a conversion.
+   *  @param source_rate Sample rate of the input, in Hz.
+   *  @param target_rate Sample rate of the output, in Hz.
+   *  @param channels Number of interleaved channels.
+   *  @param max_output_frames Largest number of frames requested from one process() call.
+   *  @param quality Filter length and accuracy.
+   *  @param max_correction Largest deviation from 1 set_rate_correction() accepts. 0 keeps the exact ratio.
+   *  @return False if a rate, the channel count or the block size is zero.
+   */
+  bool prepare(unsigned int source_rate, unsigned int target_rate, unsigned int channels,
+               size_t max_output_frames, eResampleQuality quality, double max_correction = 0.0);
+
+  /** @brief Clear the history, e.g. after a seek. The next output starts on the next input frame. */
+  void reset() noexcept;
+
+  /** @brief Read the input faster or slower than the nominal ratio, from the next process() on.
+   *  @param rate Input frames consumed per nominal frame, clamped to 1 +/- max_correction. Ignored unless adaptive.
+   *  @note Lock-free and allocation-free, safe on the audio thread.
+   */
+  void set_rate_correction(double rate) noexcept;
+
+  /** @brief Returns the number of input frames process() needs to produce output_frames frames. */
+  size_t get_input_frames_needed(size_t output_frames) const noexcept;
+
+  /** @brief Returns the largest value get_input_frames_needed() returns for max_output_frames. */
+  size_t get_max_input_frames() const noexcept { return m_max_input_frames; }
+
+  /** @brief Convert a block.
+   *  @param input Interleaved input frames. At most get_max_input_frames() frames are consumed.
+   *  @param input_frames Number of input frames, usually get_input_frames_needed(output_frames).
+   *  @param output Interleaved destination for up to output_frames frames.
+   *  @param output_frames Number of frames wanted.
+   *  @return The number of frames written. Fewer than requested when the input ran short.
+   *  @note Lock-free and allocation-free, safe on the audio thread.
+   */
+  size_t process(const float *input, size_t input_frames, float *output, size_t output_frames) noexcept;
+
+  /** @brief Convert a whole buffer at once, e.g. when a sample is loaded into a cache.
+   *  @return A new buffer at target_rate, or the source itself when the rates already match.
+   */
+  static SampleBufferPtr resample(const SampleBufferPtr &source, unsigned int target_rate,
+                                  eResampleQuality quality = eResampleQuality::High);
+
+  bool is_prepared() const noexcept { return m_channels > 0; }
+  unsigned int get_source_rate() const noexcept { return m_source_rate; }
+  unsigned int get_target_rate() const noexcept { return m_target_rate; }
+  unsigned int get_channels() const noexcept { return m_channels; }
+  eResampleQuality get_quality() const noexcept { return m_quality; }
+  bool is_adaptive() const noexcept { return m_max_correction > 0.0; }
+
+  /** @brief Returns the number of taps per filter phase. */
+  size_t get_taps() const noexcept { return m_taps; }
+
+  std::string to_string() const;
+
+private:
+  float *get_history(unsigned int channel) noexcept { return m_history.data() + channel * m_history_capacity; }
+
+  const float *get_phase(size_t phase) const noexcept { return m_coefficients.data() + phase * m_taps; }
+
+  unsigned int m_source_rate{0};
+  unsigned int m_target_rate{0};
+  unsigned int m_channels{0};
+  eResampleQuality m_quality{eResampleQuality::Balanced};
+
+  // Filter: m_phases + 1 rows of m_taps coefficients, the last row closes the interpolation range
+  size_t m_taps{0};
+  size_t m_phases{0};
+  bool m_interpolate{false};
+  std::vector<float> m_coefficients;
+
+  // Position of the first tap of the next output, as a whole frame plus m_position_fraction / m_step_denominator
+  size_t m_position{0};
+  uint64_t m_position_fraction{0};
+  uint64_t m_step_numerator{0};
+  uint64_t m_step_denominator{1};
+
+  // Adaptive resamplers: the nominal step and how far set_rate_correction() may move it
+  double m_nominal_step{1.0};
+  double m_max_correction{0.0};
+
+  // Planar history per channel. The first m_history_frames frames of each channel are valid
+  std::vector<float> m_history;
+  size_t m_history_capacity{0};
+  size_t m_history_frames{0};
+  size_t m_max_output_frames{0};
+  size_t m_max_input_frames{0};
+};
+
+} // namespace miniaudioengine::framework
+
+#endif // __RESAMPLER_H__
@@ -1,15 +1,22 @@
 #ifndef __RINGBUFFER_H__
 #define __RINGBUFFER_H__
 
-#include <array>
+#include <atomic>
+#include <algorithm>
+#include <bit>
+#include <chrono>
 #include <cstddef>
-#include <mutex>
+#include <memory>
+#include <semaphore>
+#include <span>
 
 #include "logger.h"
+#include "realtimememory.h"
 
 namespace miniaudioengine::framework
 {
 
+/** @brief Default ring buffer capacity in elements, used when no StreamConfig is supplied. */
 constexpr size_t BUFFER_SIZE = 8 * 1024;
 
 /** @enum eDirection
@@ -22,118 +29,291 @@ enum class eDirection : unsigned int
 };
 
 /** @class RingBuffer
- *  @brief A Ring Buffer implementation for audio streaming.
- *  The data structure is single producer, single-consumer (SPSC).
+ *  @brief A lock-free Ring Buffer implementation for audio streaming.
+ *  The data structure is single producer, single-consumer (SPSC). The producer only writes
+ *  the write index and the consumer only writes the read index, so no locks are required.
+ *  Indices increase monotonically and are masked into the storage, which lets the buffer
+ *  use every slot and replaces the modulo with a bitwise AND.
+ *  The storage is allocated once at construction, so the capacity can be chosen at runtime
+ *  (e.g. from a StreamConfig) without reallocating on the audio thread. It comes from the
+ *  realtime memory pool, prefaulted and locked while realtime memory mode is enabled.
+ *  An optional low watermark lets the consumer wake a sleeping producer when the fill level
+ *  drops, so producers can be event driven instead of polling on a timer.
  *  @tparam T The type of elements stored in the ring buffer.
- *  @tparam Size The maximum number of elements the ring buffer can hold.
  */
-template <typename T, size_t Size>
+template <typename T>
 class RingBuffer
 {
 public:
-  RingBuffer() = default;
+  /** @brief Construct a ring buffer.
+   *  @param capacity The minimum number of elements the buffer must hold. Rounded up to a power of two.
+   */
+  explicit RingBuffer(size_t capacity = BUFFER_SIZE) :
+    m_capacity(std::bit_ceil(std::max<size_t>(capacity, 1))),
+    m_mask(m_capacity - 1),
+    p_buffer(allocate_storage(m_capacity), StorageDelete{m_capacity})
+  {}
+
   ~RingBuffer() = default;
 
+  RingBuffer(const RingBuffer &) = delete;
+  RingBuffer &operator=(const RingBuffer &) = delete;
+
   /** @brief Attempts to push an item into the ring buffer.
-   *  @return true if the item was successfully pushed, false if the buffer is full.
    *  @param item The item to be pushed into the buffer.
-   *  @note If the buffer is full, the item will not be added and the method will return false.
+   *  @note Producer thread only. If the buffer is full, the item will not be added.
    *  @return false if the buffer is full. True otherwise.
    */
-  bool try_push(const T &item)
+  bool try_push(const T &item) noexcept
   {
-    std::lock_guard<std::mutex> guard(m_mutex);
+    const size_t current_write = m_write_index.load(std::memory_order_relaxed);
 
-    // Check if the buffer is full
-    size_t current_write = m_write_index;
-    size_t next_write = (current_write + 1) % Size;
-    size_t current_read = m_read_index;
-
-    if (next_write == current_read)
+    if (current_write - m_cached_read_index == m_capacity)
     {
-      // Buffer is full, cannot push
-      return false;
+      m_cached_read_index = m_read_index.load(std::memory_order_acquire);
+      if (current_write - m_cached_read_index == m_capacity)
+      {
+        // Buffer is full, cannot push
+        return false;
+      }
     }
 
-    m_buffer[current_write] = item;
-    m_write_index = next_write;
+    p_buffer[current_write & m_mask] = item;
+    m_write_index.store(current_write + 1, std::memory_order_release);
     return true;
   }
 
   /** @brief Attempts to pop an item from the ring buffer.
-   *  @return true if an item was successfully popped, false if the buffer is empty.
    *  @param item Reference to store the popped item.
-   *  @note If the buffer is empty, no item will be retrieved and the method will return false.
+   *  @note Consumer thread only. If the buffer is empty, no item will be retrieved.
    *  @return false if the buffer is empty. True otherwise.
    */
-  bool try_pop(T &item)
+  bool try_pop(T &item) noexcept
   {
-    std::lock_guard<std::mutex> guard(m_mutex);
+    const size_t current_read = m_read_index.load(std::memory_order_relaxed);
 
-    // Check if the buffer is empty
-    size_t current_read = m_read_index;
-    size_t current_write = m_write_index;
-
-    if (current_read == current_write)
+    if (current_read == m_cached_write_index)
     {
-      // Buffer is empty, cannot pop
-      return false;
+      m_cached_write_index = m_write_index.load(std::memory_order_acquire);
+      if (current_read == m_cached_write_index)
+      {
+        // Buffer is empty, cannot pop
+        return false;
+      }
     }
 
-    item = m_buffer[current_read];
-    size_t next_read = (current_read + 1) % Size;
-    m_read_index = next_read;
+    item = p_buffer[current_read & m_mask];
+    m_read_index.store(current_read + 1, std::memory_order_release);
     return true;
   }
 
-  /** @brief Returns the current number of items in the ring buffer.
-   *  @return The number of items currently stored in the buffer.
-   *  @note This method is lock-free and safe for use in real-time contexts.
+  /** @brief Writes as many items as currently fit into the ring buffer.
+   *  The copy is split into at most two contiguous regions (before and after the wrap point).
+   *  @param items The items to write.
+   *  @note Producer thread only.
+   *  @return The number of items written, which may be less than items.size() if the buffer fills.
    */
-  size_t size() const
+  size_t write(std::span<const T> items) noexcept
   {
-    std::lock_guard<std::mutex> guard(m_mutex);
+    const size_t current_write = m_write_index.load(std::memory_order_relaxed);
+    const size_t current_read = m_read_index.load(std::memory_order_acquire);
+    m_cached_read_index = current_read;
 
-    size_t current_write = m_write_index;
-    size_t current_read = m_read_index;
+    const size_t count = std::min(items.size(), m_capacity - (current_write - current_read));
+    if (count == 0)
+    {
+      return 0;
+    }
+
+    const size_t offset = current_write & m_mask;
+    const size_t first = std::min(count, m_capacity - offset);
+    std::copy_n(items.data(), first, p_buffer.get() + offset);
+    std::copy_n(items.data() + first, count - first, p_buffer.get());
+
+    m_write_index.store(current_write + count, std::memory_order_release);
+    return count;
+  }
 
-    if (current_write >= current_read)
+  /** @brief Reads as many items as are currently available from the ring buffer.
+   *  The copy is split into at most two contiguous regions (before and after the wrap point).
+   *  @param items Destination for the items read.
+   *  @note Consumer thread only.
+   *  @return The number of items read, which may be less than items.size() if the buffer empties.
+   */
+  size_t read(std::span<T> items) noexcept
+  {
+    const size_t current_read = m_read_index.load(std::memory_order_relaxed);
+    const size_t current_write = m_write_index.load(std::memory_order_acquire);
+    m_cached_write_index = current_write;
+
+    const size_t count = std::min(items.size(), current_write - current_read);
+    if (count == 0)
     {
-      return current_write - current_read;
+      return 0;
     }
-    else
+
+    const size_t offset = current_read & m_mask;
+    const size_t first = std::min(count, m_capacity - offset);
+    std::copy_n(p_buffer.get() + offset, first, items.data());
+    std::copy_n(p_buffer.get(), count - first, items.data() + first);
+
+    m_read_index.store(current_read + count, std::memory_order_release);
+    notify_low_watermark(current_write - (current_read + count));
+    return count;
+  }
+
+  /** @brief Drops every item currently in the buffer, e.g. stale audio after a seek.
+   *  @note Consumer thread only. Items written concurrently by the producer may or may not be dropped.
+   *  @return The number of items dropped.
+   */
+  size_t discard() noexcept
+  {
+    const size_t current_read = m_read_index.load(std::memory_order_relaxed);
+    const size_t current_write = m_write_index.load(std::memory_order_acquire);
+    m_cached_write_index = current_write;
+
+    m_read_index.store(current_write, std::memory_order_release);
+    notify_low_watermark(0);
+    return current_write - current_read;
+  }
+
+  /** @brief Enable producer wakeups based on the buffer fill level.
+   *  @param low_watermark When a read leaves this many items or fewer, the waiting producer is woken.
+   *  @param high_watermark The fill level the producer should top the buffer up to.
+   *  @note Not thread-safe. Call before the producer and consumer start.
+   */
+  void set_watermarks(size_t low_watermark, size_t high_watermark) noexcept
+  {
+    m_high_watermark = std::min(high_watermark, m_capacity);
+    m_low_watermark = std::min(low_watermark, m_high_watermark);
+  }
+
+  /** @brief Returns the fill level the producer should top the buffer up to. */
+  size_t get_high_watermark() const noexcept
+  {
+    return m_high_watermark;
+  }
+
+  /** @brief Returns the fill level at or below which the producer is woken. */
+  size_t get_low_watermark() const noexcept
+  {
+    return m_low_watermark;
+  }
+
+  /** @brief Block the producer until the consumer drains the buffer to the low watermark.
+   *  @param timeout Maximum time to wait, so the producer can still observe stop requests.
+   *  @note Producer thread only.
+   *  @return true if woken by the consumer, false on timeout.
+   */
+  bool wait_for_low_watermark(std::chrono::milliseconds timeout)
+  {
+    if (!m_low_watermark_signal.try_acquire_for(timeout))
     {
-      return Size - (current_read - current_write);
+      return false;
     }
+
+    // Only clear the pending flag once the release has been consumed, so the semaphore never exceeds one
+    m_low_watermark_pending.store(false, std::memory_order_release);
+    return true;
+  }
+
+  /** @brief Returns the current number of items in the ring buffer.
+   *  @return The number of items currently stored in the buffer.
+   *  @note This method is lock-free and safe for use in real-time contexts. The value is a
+   *        snapshot and may be stale by the time it is used.
+   */
+  size_t size() const noexcept
+  {
+    const size_t current_read = m_read_index.load(std::memory_order_acquire);
+    const size_t current_write = m_write_index.load(std::memory_order_acquire);
+    return current_write - current_read;
+  }
+
+  /** @brief Returns the number of items that can be written before the buffer is full.
+   *  @note This method is lock-free and safe for use in real-time contexts.
+   */
+  size_t available() const noexcept
+  {
+    return m_capacity - size();
   }
 
   /** @brief Returns the maximum capacity of the ring buffer.
    *  @return The maximum number of items the buffer can hold.
    *  @note This method is lock-free and safe for use in real-time contexts.
-   *  @note The usable capacity is Size - 1 to distinguish between full and empty states.
    */
-  size_t capacity() const
+  size_t capacity() const noexcept
   {
-    return Size - 1; // One slot is used to distinguish full vs empty
+    return m_capacity;
   }
 
   /** @brief Clears the ring buffer, resetting it to an empty state.
    *  @note This method is not thread-safe and should only be called when no other threads are accessing the buffer.
    */
-  void clear()
+  void clear() noexcept
   {
-    m_write_index = 0;
-    m_read_index = 0;
+    m_write_index.store(0, std::memory_order_relaxed);
+    m_read_index.store(0, std::memory_order_relaxed);
+    m_cached_write_index = 0;
+    m_cached_read_index = 0;
   }
 
 private:
-  std::array<T, Size> m_buffer;
-  std::mutex m_mutex;
+  /** @brief Frees storage from allocate_storage(). */
+  struct StorageDelete
+  {
+    size_t capacity;
+
+    void operator()(T *p) const noexcept
+    {
+      std::destroy_n(p, capacity);
+      realtime_memory::deallocate(p, capacity * sizeof(T), STORAGE_ALIGNMENT);
+    }
+  };
+
+  static constexpr size_t STORAGE_ALIGNMENT = std::max<size_t>(alignof(T), 64);
+
+  static T *allocate_storage(size_t capacity)
+  {
+    T *storage = static_cast<T *>(realtime_memory::allocate(capacity * sizeof(T), STORAGE_ALIGNMENT));
+    std::uninitialized_value_construct_n(storage, capacity);
+    return storage;
+  }
+
+  /** @brief Wake the producer once per drain cycle when the fill level reaches the low watermark.
+   *  The semaphore release never blocks, so this is safe to call from the audio thread.
+   */
+  void notify_low_watermark(size_t fill_level) noexcept
+  {
+    if (m_low_watermark == 0 || fill_level > m_low_watermark)
+    {
+      return;
+    }
+
+    if (!m_low_watermark_pending.exchange(true, std::memory_order_acq_rel))
+    {
+      m_low_watermark_signal.release();
+    }
+  }
+
+  const size_t m_capacity;
+  const size_t m_mask;
+  std::unique_ptr<T[], StorageDelete> p_buffer;
+
+  // Producer cache line: write index plus the producer's last observed read index
+  alignas(64) std::atomic<size_t> m_write_index{0};
+  size_t m_cached_read_index{0};
+
+  // Consumer cache line: read index plus the consumer's last observed write index
+  alignas(64) std::atomic<size_t> m_read_index{0};
+  size_t m_cached_write_index{0};
 
-  size_t m_write_index{0}; // Producer index
-  size_t m_read_index{0}; // Consumer index
+  // Producer wakeup, signalled by the consumer
+  size_t m_low_watermark{0};
+  size_t m_high_watermark{m_capacity};
+  alignas(64) std::atomic<bool> m_low_watermark_pending{false};
+  std::binary_semaphore m_low_watermark_signal{0};
 };
 
 } // namespace miniaudioengine::framework
 
-#endif // __RINGBUFFER_H__
\ No newline at end of file
+#endif // __RINGBUFFER_H__
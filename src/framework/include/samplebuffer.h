@@ -0,0 +1,103 @@
+#ifndef __SAMPLE_BUFFER_H__
+#define __SAMPLE_BUFFER_H__
+
+#include "realtimememory.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <span>
+
+namespace miniaudioengine::framework
+{
+
+/** @class SampleBuffer
+ *  @brief Immutable block of decoded, interleaved float audio shared between Tracks and voices.
+ *  The samples either live in a 64-byte aligned block of the realtime memory pool or point into a
+ *  memory-mapped file.
+ *  Once published as a SampleBufferPtr the data is read-only, so any number of threads (including
+ *  the audio thread) can read it without synchronization.
+ */
+class SampleBuffer
+{
+public:
+  static constexpr size_t ALIGNMENT = 64;
+
+  /** @brief Allocate an aligned, zero-initialized buffer to be filled by a loader.
+   *  @param frames Number of sample frames.
+   *  @param channels Number of interleaved channels.
+   *  @param sample_rate Sample rate in Hz.
+   */
+  static std::shared_ptr<SampleBuffer> allocate(size_t frames, unsigned int channels, unsigned int sample_rate)
+  {
+    const size_t samples = frames * channels;
+    const size_t bytes = std::max<size_t>(samples * sizeof(float), ALIGNMENT);
+    float *data = static_cast<float *>(realtime_memory::allocate(bytes, ALIGNMENT));
+
+    auto storage = std::shared_ptr<void>(data, [bytes](void *p) { realtime_memory::deallocate(p, bytes, ALIGNMENT); });
+    return std::shared_ptr<SampleBuffer>(new SampleBuffer(data, data, frames, channels, sample_rate, std::move(storage), false));
+  }
+
+  /** @brief Wrap samples owned by external storage, e.g. a memory-mapped file.
+   *  @param data Pointer to the first interleaved sample.
+   *  @param frames Number of sample frames.
+   *  @param channels Number of interleaved channels.
+   *  @param sample_rate Sample rate in Hz.
+   *  @param storage Keeps the underlying memory alive for the lifetime of the buffer.
+   */
+  static std::shared_ptr<SampleBuffer> wrap(const float *data, size_t frames, unsigned int channels,
+                                            unsigned int sample_rate, std::shared_ptr<void> storage)
+  {
+    return std::shared_ptr<SampleBuffer>(new SampleBuffer(data, nullptr, frames, channels, sample_rate, std::move(storage), true));
+  }
+
+  SampleBuffer(const SampleBuffer &) = delete;
+  SampleBuffer &operator=(const SampleBuffer &) = delete;
+
+  /** @brief Returns the interleaved samples. */
+  const float *data() const noexcept { return p_data; }
+
+  /** @brief Returns the interleaved samples as a span. */
+  std::span<const float> get_samples() const noexcept { return {p_data, m_frames * m_channels}; }
+
+  /** @brief Returns writable samples for loaders, or nullptr when the buffer wraps read-only storage.
+   *  @note Must not be used once the buffer has been shared.
+   */
+  float *get_writable_data() noexcept { return p_writable_data; }
+
+  size_t get_frames() const noexcept { return m_frames; }
+  unsigned int get_channels() const noexcept { return m_channels; }
+  unsigned int get_sample_rate() const noexcept { return m_sample_rate; }
+
+  /** @brief Returns the memory footprint of the samples in bytes. */
+  size_t get_size_bytes() const noexcept { return m_frames * m_channels * sizeof(float); }
+
+  /** @brief Returns true if the samples point into a memory-mapped file. */
+  bool is_mapped() const noexcept { return m_mapped; }
+
+private:
+  SampleBuffer(const float *data, float *writable_data, size_t frames, unsigned int channels,
+               unsigned int sample_rate, std::shared_ptr<void> storage, bool mapped) :
+    p_data(data),
+    p_writable_data(writable_data),
+    m_frames(frames),
+    m_channels(channels),
+    m_sample_rate(sample_rate),
+    p_storage(std::move(storage)),
+    m_mapped(mapped)
+  {}
+
+  const float *p_data;
+  float *p_writable_data;
+  size_t m_frames;
+  unsigned int m_channels;
+  unsigned int m_sample_rate;
+  std::shared_ptr<void> p_storage;
+  bool m_mapped;
+};
+
+using SampleBufferPtr = std::shared_ptr<const SampleBuffer>;
+
+} // namespace miniaudioengine::framework
+
+#endif // __SAMPLE_BUFFER_H__
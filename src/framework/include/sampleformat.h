@@ -0,0 +1,53 @@
+#ifndef __SAMPLE_FORMAT_H__
+#define __SAMPLE_FORMAT_H__
+
+#include <cstddef>
+#include <string>
+
+namespace miniaudioengine::framework
+{
+
+/** @enum eSampleFormat
+ *  @brief Sample encoding of a device stream or an audio file. Int24 is packed, 3 bytes per sample.
+ */
+enum class eSampleFormat : unsigned int
+{
+  Int16,
+  Int24,
+  Int32,
+  Float32
+};
+
+std::string to_string(eSampleFormat format);
+
+/** @brief Returns the bytes one sample occupies in the given format. */
+unsigned int get_bytes_per_sample(eSampleFormat format);
+
+namespace dsp
+{
+
+/** @brief Convert float samples to a format at the device edge. Integer formats clip out-of-range samples. */
+template <eSampleFormat Format>
+void from_float(void *destination, const float *source, size_t n) noexcept;
+
+/** @brief Convert samples of a format to float in [-1, 1). */
+template <eSampleFormat Format>
+void to_float(float *destination, const void *source, size_t n) noexcept;
+
+/** @struct SampleFormatKernels
+ *  @brief The conversions of one sample format, instantiated at compile time and picked once per stream.
+ */
+struct SampleFormatKernels
+{
+  eSampleFormat format;
+  void (*from_float)(void *destination, const float *source, size_t n) noexcept;
+  void (*to_float)(float *destination, const void *source, size_t n) noexcept;
+};
+
+const SampleFormatKernels &get_format_kernels(eSampleFormat format) noexcept;
+
+} // namespace dsp
+
+} // namespace miniaudioengine::framework
+
+#endif // __SAMPLE_FORMAT_H__
@@ -0,0 +1,107 @@
+#ifndef __STATE_SNAPSHOT_H__
+#define __STATE_SNAPSHOT_H__
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace miniaudioengine::framework
+{
+
+/** @class StateSnapshot
+ *  @brief Wait-free triple buffer for publishing the latest value of a state from one writer to one reader.
+ *  Three copies of T live inside the object. The writer fills its private back slot and swaps it with the
+ *  shared middle slot, and the reader swaps the middle slot with its private front slot when a newer state
+ *  is waiting. Each side owns a slot the other never touches, so the reader always sees a whole state
+ *  published by one publish() call, never a mix of two. Both sides are a single atomic exchange: no locks,
+ *  no retries and no allocation.
+ *  Unlike a queue, intermediate states are skipped when the writer publishes faster than the reader reads.
+ *  @tparam T The published state. Copying it must not allocate for publish() to be allocation-free, e.g. a
+ *          struct of parameters or a std::array.
+ */
+template <typename T>
+class StateSnapshot
+{
+  static_assert(std::is_copy_assignable_v<T>, "StateSnapshot requires a copy-assignable state");
+
+public:
+  explicit StateSnapshot(const T &initial = T())
+  {
+    for (Slot &slot : m_slots)
+    {
+      slot.value = initial;
+    }
+  }
+  ~StateSnapshot() = default;
+
+  StateSnapshot(const StateSnapshot &) = delete;
+  StateSnapshot &operator=(const StateSnapshot &) = delete;
+
+  /** @brief Returns the slot the writer fills before calling publish().
+   *  It holds an older state, not necessarily the last one published, so every field must be written.
+   *  @note Writer thread only.
+   */
+  T &get_write_buffer() noexcept { return m_slots[m_back].value; }
+
+  /** @brief Make the write buffer the latest state.
+   *  @note Writer thread only. Wait-free.
+   */
+  void publish() noexcept
+  {
+    m_back = m_middle.exchange(static_cast<uint8_t>(m_back | DIRTY), std::memory_order_acq_rel) & INDEX_MASK;
+  }
+
+  /** @brief Copy a state into the write buffer and publish it.
+   *  @note Writer thread only. Wait-free.
+   */
+  void publish(const T &state) noexcept(std::is_nothrow_copy_assignable_v<T>)
+  {
+    get_write_buffer() = state;
+    publish();
+  }
+
+  /** @brief Returns the latest published state, picking up a newer one if it is waiting.
+   *  The reference stays valid and unchanged until the reader calls read() again.
+   *  @note Reader thread only. Wait-free and allocation-free, safe on the audio thread. A reader that moves
+   *        between threads, e.g. a graph task run by different workers, is fine as long as successive calls
+   *        are ordered by the scheduler.
+   */
+  const T &read() noexcept
+  {
+    if (m_middle.load(std::memory_order_relaxed) & DIRTY)
+    {
+      m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+    return m_slots[m_front].value;
+  }
+
+  /** @brief Returns true if a state was published since the reader last called read(). */
+  bool has_update() const noexcept
+  {
+    return (m_middle.load(std::memory_order_acquire) & DIRTY) != 0;
+  }
+
+private:
+  static constexpr uint8_t INDEX_MASK = 0x3;
+  static constexpr uint8_t DIRTY = 0x4;
+
+  /** @struct Slot
+   *  @brief One copy of the state, on its own cache line so the writer and reader never share one.
+   */
+  struct alignas(64) Slot
+  {
+    T value;
+  };
+
+  Slot m_slots[3];
+
+  // Slot indices. m_middle also carries the DIRTY flag while it holds a state the reader has not taken.
+  alignas(64) std::atomic<uint8_t> m_middle{1};
+  alignas(64) uint8_t m_back{2};
+  alignas(64) uint8_t m_front{0};
+};
+
+} // namespace miniaudioengine::framework
+
+#endif // __STATE_SNAPSHOT_H__
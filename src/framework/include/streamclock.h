@@ -0,0 +1,119 @@
+#ifndef __STREAM_CLOCK_H__
+#define __STREAM_CLOCK_H__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+namespace miniaudioengine::framework
+{
+
+/** @class StreamClock
+ *  @brief Maps wall-clock time onto the frame timeline of an audio stream.
+ *  The audio thread advances the clock once per block. Any other thread, e.g. a MIDI callback,
+ *  can then convert a steady_clock time into the stream frame that was playing at that time.
+ *  The time of frame 0 is low-pass filtered across blocks so callback jitter does not reach the
+ *  timestamps, and is re-anchored when the stream stalls or restarts.
+ */
+class StreamClock
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  StreamClock() = default;
+
+  StreamClock(const StreamClock &) = delete;
+  StreamClock &operator=(const StreamClock &) = delete;
+
+  /** @brief Set the stream sample rate and restart the timeline at frame 0.
+   *  @note Control thread, also while the stream runs, as AudioGraph::compile() does on a hot recompile. A block
+   *  advancing at the same time is dropped from the new timeline, which starts with the next block.
+   */
+  void reset(unsigned int sample_rate) noexcept
+  {
+    m_sample_rate.store(sample_rate, std::memory_order_relaxed);
+    // Sequentially consistent with advance(), so an origin it stores for the old timeline never survives both checks
+    m_frame.store(0);
+    m_origin_ns.store(NO_ORIGIN);
+  }
+
+  /** @brief Mark the start of a block.
+   *  @param n_frames Number of frames in the block.
+   *  @return The stream frame of the first frame of the block.
+   *  @note Audio thread only.
+   */
+  uint64_t advance(unsigned int n_frames) noexcept
+  {
+    const uint64_t frame = m_frame.load(std::memory_order_relaxed);
+    const unsigned int sample_rate = m_sample_rate.load(std::memory_order_relaxed);
+    if (sample_rate > 0)
+    {
+      const int64_t now_ns = to_ns(Clock::now());
+      const int64_t estimate = now_ns - static_cast<int64_t>(static_cast<double>(frame) * 1e9 / sample_rate);
+      const int64_t block_ns = static_cast<int64_t>(static_cast<double>(n_frames) * 1e9 / sample_rate);
+
+      // The error is only taken against a real origin, NO_ORIGIN would overflow the subtraction
+      int64_t origin = m_origin_ns.load(std::memory_order_relaxed);
+      const int64_t error = origin != NO_ORIGIN ? estimate - origin : 0;
+      if (origin == NO_ORIGIN || error > 2 * block_ns || error < -2 * block_ns)
+      {
+        origin = estimate;
+      }
+      else
+      {
+        origin += error / SMOOTHING;
+      }
+      m_origin_ns.store(origin);
+    }
+
+    // A reset() since the frame was loaded wins. The origin stored above belongs to the old timeline
+    uint64_t expected = frame;
+    if (!m_frame.compare_exchange_strong(expected, frame + n_frames))
+    {
+      m_origin_ns.store(NO_ORIGIN);
+    }
+    return frame;
+  }
+
+  /** @brief Returns the stream frame playing at a point in time.
+   *  Returns the start of the current block before the clock has been advanced.
+   */
+  uint64_t get_frame(Clock::time_point time) const noexcept
+  {
+    const int64_t origin = m_origin_ns.load(std::memory_order_acquire);
+    const unsigned int sample_rate = m_sample_rate.load(std::memory_order_relaxed);
+    if (origin == NO_ORIGIN || sample_rate == 0)
+    {
+      return m_frame.load(std::memory_order_acquire);
+    }
+
+    const int64_t elapsed_ns = to_ns(time) - origin;
+    return elapsed_ns > 0 ? static_cast<uint64_t>(static_cast<double>(elapsed_ns) * sample_rate * 1e-9) : 0;
+  }
+
+  /** @brief Returns the stream frame at the start of the next block. */
+  uint64_t get_frame() const noexcept { return m_frame.load(std::memory_order_acquire); }
+
+  unsigned int get_sample_rate() const noexcept { return m_sample_rate.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr int64_t NO_ORIGIN = std::numeric_limits<int64_t>::min();
+  static constexpr int64_t SMOOTHING = 16;
+
+  static int64_t to_ns(Clock::time_point time) noexcept
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+  }
+
+  std::atomic<unsigned int> m_sample_rate{0};
+  std::atomic<uint64_t> m_frame{0};
+  std::atomic<int64_t> m_origin_ns{NO_ORIGIN};
+};
+
+using StreamClockPtr = std::shared_ptr<StreamClock>;
+
+} // namespace miniaudioengine::framework
+
+#endif // __STREAM_CLOCK_H__
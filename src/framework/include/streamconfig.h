@@ -0,0 +1,110 @@
+#ifndef __STREAM_CONFIG_H__
+#define __STREAM_CONFIG_H__
+
+#include "resampler.h"
+#include "sampleformat.h"
+
+#include <cstddef>
+#include <string>
+
+namespace miniaudioengine::framework
+{
+
+/** @struct StreamConfig
+ *  @brief Buffering and scheduling parameters for an audio stream.
+ *  Passed through Track::play() to every IInputOutput::open_stream() call so the same binary can
+ *  run a low-latency live profile or a high-throughput render profile.
+ */
+struct StreamConfig
+{
+  /** @brief Number of frames the device callback processes per buffer. */
+  unsigned int frames_per_buffer{1024};
+
+  /** @brief Ring buffer capacity between producer and consumer, in blocks of frames_per_buffer. */
+  unsigned int ring_capacity_blocks{8};
+
+  /** @brief Stream sample rate in Hz. 0 selects the device's preferred sample rate. */
+  unsigned int sample_rate{0};
+
+  /** @brief Number of device periods (hardware buffers). 0 lets the audio backend choose. */
+  unsigned int number_of_periods{0};
+
+  /** @brief Ask the audio backend for the lowest latency it supports (RTAUDIO_MINIMIZE_LATENCY). */
+  bool minimize_latency{false};
+
+  /** @brief Ask the audio backend to run its callback thread with realtime scheduling (RTAUDIO_SCHEDULE_REALTIME). */
+  bool schedule_realtime{false};
+
+  /** @brief Open one full-duplex stream when a track's audio input and output are the same device.
+   *  The captured block is rendered to the output in the same callback, so monitoring adds no ring buffer latency.
+   */
+  bool duplex{true};
+
+  /** @brief Worker threads that render independent graph branches alongside the audio callback. 0 renders on the callback thread only. */
+  unsigned int worker_threads{0};
+
+  /** @brief Sample format the device is opened with. The engine renders float and converts at the device edge,
+   *  for devices or drivers that only take integer samples or dislike converting them themselves.
+   */
+  eSampleFormat device_format{eSampleFormat::Float32};
+
+  /** @brief Filter used for inputs whose sample rate differs from the stream's. */
+  eResampleQuality resample_quality{eResampleQuality::Balanced};
+
+  /** @brief Disk space reserved up front for each recorded file, in seconds of audio. 0 grows the file as it is written. */
+  unsigned int record_preallocate_seconds{0};
+
+  /** @brief Blocks of frames_per_buffer every file input reads ahead before AudioSession::play() starts the transport. 0 starts at once. */
+  unsigned int preroll_blocks{2};
+
+  /** @brief Returns the ring buffer capacity in samples for an interleaved stream.
+   *  @param channels Number of interleaved channels carried by the ring buffer.
+   */
+  size_t get_ring_capacity(unsigned int channels) const
+  {
+    return static_cast<size_t>(frames_per_buffer) * ring_capacity_blocks * (channels > 0 ? channels : 1);
+  }
+
+  /** @brief Profile for live monitoring: small buffers, few periods and realtime scheduling. */
+  static StreamConfig live()
+  {
+    StreamConfig config;
+    config.frames_per_buffer = 128;
+    config.ring_capacity_blocks = 4;
+    config.number_of_periods = 2;
+    config.minimize_latency = true;
+    config.schedule_realtime = true;
+    config.resample_quality = eResampleQuality::Fast;
+    return config;
+  }
+
+  /** @brief Profile for rendering and playback where throughput matters more than latency. */
+  static StreamConfig render()
+  {
+    StreamConfig config;
+    config.frames_per_buffer = 4096;
+    config.ring_capacity_blocks = 8;
+    config.resample_quality = eResampleQuality::High;
+    return config;
+  }
+
+  std::string to_string() const
+  {
+    return "StreamConfig(FramesPerBuffer=" + std::to_string(frames_per_buffer) +
+           ", RingCapacityBlocks=" + std::to_string(ring_capacity_blocks) +
+           ", SampleRate=" + std::to_string(sample_rate) +
+           ", Periods=" + std::to_string(number_of_periods) +
+           ", MinimizeLatency=" + (minimize_latency ? "Yes" : "No") +
+           ", ScheduleRealtime=" + (schedule_realtime ? "Yes" : "No") +
+           ", Duplex=" + (duplex ? "Yes" : "No") +
+           ", WorkerThreads=" + std::to_string(worker_threads) +
+           ", DeviceFormat=" + framework::to_string(device_format) +
+           ", ResampleQuality=" + framework::to_string(resample_quality) +
+           ", RecordPreallocateSeconds=" + std::to_string(record_preallocate_seconds) +
+           ", PrerollBlocks=" + std::to_string(preroll_blocks) + ")";
+  }
+};
+
+} // namespace miniaudioengine::framework
+
+#endif // __STREAM_CONFIG_H__
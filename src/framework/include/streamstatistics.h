@@ -0,0 +1,328 @@
+#ifndef __STREAM_STATISTICS_H__
+#define __STREAM_STATISTICS_H__
+
+#include "denormals.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+
+namespace miniaudioengine::framework
+{
+
+/** @struct StreamStatisticsSnapshot
+ *  @brief Plain copy of a StreamStatistics, safe to keep and format on any thread.
+ */
+struct StreamStatisticsSnapshot
+{
+  unsigned long long callback_count{0};
+  unsigned long long xrun_count{0};       // Over/underflows reported by the audio driver
+  unsigned long long underrun_count{0};   // Blocks padded with silence because a ring buffer ran dry
+  unsigned long long overflow_count{0};   // Items dropped because a ring buffer was full
+  unsigned long long dropped_frames{0};   // Recorded frames lost because the disk writer fell behind
+  unsigned long long denormal_blocks{0};  // Blocks whose rendering flushed or read denormals, e.g. a decaying tail
+
+  // Fewest and most samples seen in the stream's ring buffers. Both 0 if never sampled.
+  size_t ring_fill_low{0};
+  size_t ring_fill_high{0};
+
+  // Time spent rendering one block, from a log-scale histogram with ~9% resolution. Max is exact.
+  double block_time_p50_us{0.0};
+  double block_time_p99_us{0.0};
+  double block_time_max_us{0.0};
+
+  /** @brief Length of the most recent period. */
+  double period_us{0.0};
+
+  /** @brief Total processing time as a percentage of the total period time. */
+  double dsp_load_percent{0.0};
+
+  /** @brief Largest processing time of one block as a percentage of its period. */
+  double dsp_load_peak_percent{0.0};
+
+  /** @brief Buffering between the device input and output reported when the stream opened. 0 if unknown. */
+  unsigned long long latency_frames{0};
+  double latency_ms{0.0};
+
+  std::string to_string() const
+  {
+    return "StreamStatistics(Callbacks=" + std::to_string(callback_count) +
+           ", Xruns=" + std::to_string(xrun_count) +
+           ", Underruns=" + std::to_string(underrun_count) +
+           ", Overflows=" + std::to_string(overflow_count) +
+           ", DroppedFrames=" + std::to_string(dropped_frames) +
+           ", DenormalBlocks=" + std::to_string(denormal_blocks) +
+           ", RingFill=[" + std::to_string(ring_fill_low) + ", " + std::to_string(ring_fill_high) + "]" +
+           ", BlockTimeUs(p50=" + std::to_string(block_time_p50_us) +
+           ", p99=" + std::to_string(block_time_p99_us) +
+           ", max=" + std::to_string(block_time_max_us) + ")" +
+           ", DspLoad=" + std::to_string(dsp_load_percent) + "%" +
+           ", DspLoadPeak=" + std::to_string(dsp_load_peak_percent) + "%" +
+           ", Latency=" + std::to_string(latency_frames) + " frames (" + std::to_string(latency_ms) + " ms))";
+  }
+};
+
+/** @class StreamStatistics
+ *  @brief Performance counters of one stream, updated lock-free from the audio path.
+ *  The audio callback records every block with record_block(). Ring buffer readers and writers
+ *  record fills, underruns and overflows from whichever thread hits them. Control threads read a
+ *  consistent-enough copy with get_snapshot() without ever blocking the writers.
+ */
+class StreamStatistics
+{
+public:
+  /** Sub-buckets per power of two in the block time histogram. */
+  static constexpr unsigned int HISTOGRAM_SUB_BUCKET_BITS = 3;
+  static constexpr size_t HISTOGRAM_BUCKETS = (64 - HISTOGRAM_SUB_BUCKET_BITS + 1) << HISTOGRAM_SUB_BUCKET_BITS;
+
+  StreamStatistics() { reset(); }
+
+  StreamStatistics(const StreamStatistics &) = delete;
+  StreamStatistics &operator=(const StreamStatistics &) = delete;
+
+  /** @class BlockTimer
+   *  @brief Times one audio callback and records it when it goes out of scope.
+   *  Also records whether rendering the block produced denormals.
+   */
+  class BlockTimer
+  {
+  public:
+    /** @param statistics Statistics to record into. May be nullptr to disable timing. */
+    BlockTimer(StreamStatistics *statistics, unsigned int n_frames, unsigned int sample_rate) noexcept :
+      p_statistics(statistics),
+      m_period_ns(sample_rate > 0 ? static_cast<uint64_t>(n_frames) * 1000000000ull / sample_rate : 0),
+      m_start(p_statistics != nullptr ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point())
+    {}
+
+    ~BlockTimer()
+    {
+      if (p_statistics != nullptr)
+      {
+        const auto elapsed = std::chrono::steady_clock::now() - m_start;
+        p_statistics->record_block(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()), m_period_ns);
+        if (m_denormals.has_denormals())
+        {
+          p_statistics->record_denormal_block();
+        }
+      }
+    }
+
+    BlockTimer(const BlockTimer &) = delete;
+    BlockTimer &operator=(const BlockTimer &) = delete;
+
+  private:
+    StreamStatistics *p_statistics;
+    uint64_t m_period_ns;
+    std::chrono::steady_clock::time_point m_start;
+    DenormalMonitor m_denormals;
+  };
+
+  /** @brief Record one rendered block.
+   *  @param elapsed_ns Time spent rendering the block.
+   *  @param period_ns Duration of the audio in the block, or 0 if unknown.
+   *  @note Audio thread only.
+   */
+  void record_block(uint64_t elapsed_ns, uint64_t period_ns) noexcept
+  {
+    m_callback_count.fetch_add(1, std::memory_order_relaxed);
+    m_histogram[get_bucket(elapsed_ns)].fetch_add(1, std::memory_order_relaxed);
+    m_total_ns.fetch_add(elapsed_ns, std::memory_order_relaxed);
+    m_total_period_ns.fetch_add(period_ns, std::memory_order_relaxed);
+    m_period_ns.store(period_ns, std::memory_order_relaxed);
+
+    if (elapsed_ns > m_max_ns.load(std::memory_order_relaxed))
+    {
+      m_max_ns.store(elapsed_ns, std::memory_order_relaxed);
+    }
+
+    const uint64_t load_ppm = period_ns > 0 ? elapsed_ns * 1000000 / period_ns : 0;
+    if (load_ppm > m_peak_load_ppm.load(std::memory_order_relaxed))
+    {
+      m_peak_load_ppm.store(load_ppm, std::memory_order_relaxed);
+    }
+  }
+
+  /** @brief Record an over/underflow reported by the audio driver. */
+  void record_xrun() noexcept { m_xrun_count.fetch_add(1, std::memory_order_relaxed); }
+
+  /** @brief Record a block padded with silence because a ring buffer ran dry. */
+  void record_underrun() noexcept { m_underrun_count.fetch_add(1, std::memory_order_relaxed); }
+
+  /** @brief Record an item dropped because a ring buffer was full. */
+  void record_overflow() noexcept { m_overflow_count.fetch_add(1, std::memory_order_relaxed); }
+
+  /** @brief Record frames a recorder could not hand to its disk writer. */
+  void record_dropped_frames(unsigned long long frames) noexcept { m_dropped_frames.fetch_add(frames, std::memory_order_relaxed); }
+
+  /** @brief Record a block whose rendering flushed or read denormals. */
+  void record_denormal_block() noexcept { m_denormal_blocks.fetch_add(1, std::memory_order_relaxed); }
+
+  /** @brief Record the fill of a ring buffer, in samples, for the low and high watermarks. */
+  void record_ring_fill(size_t samples) noexcept
+  {
+    size_t low = m_ring_fill_low.load(std::memory_order_relaxed);
+    while (samples < low && !m_ring_fill_low.compare_exchange_weak(low, samples, std::memory_order_relaxed))
+    {
+    }
+
+    size_t high = m_ring_fill_high.load(std::memory_order_relaxed);
+    while (samples > high && !m_ring_fill_high.compare_exchange_weak(high, samples, std::memory_order_relaxed))
+    {
+    }
+  }
+
+  /** @brief Record the stream's buffering latency when it opens.
+   *  @param frames Frames of buffering between the device input and output.
+   *  @param sample_rate Stream sample rate in Hz.
+   */
+  void record_latency(unsigned long long frames, unsigned int sample_rate) noexcept
+  {
+    m_latency_frames.store(frames, std::memory_order_relaxed);
+    m_latency_sample_rate.store(sample_rate, std::memory_order_relaxed);
+  }
+
+  /** @brief Forget every recorded value. Call while the stream is stopped for exact results. */
+  void reset() noexcept
+  {
+    m_callback_count.store(0, std::memory_order_relaxed);
+    m_xrun_count.store(0, std::memory_order_relaxed);
+    m_underrun_count.store(0, std::memory_order_relaxed);
+    m_overflow_count.store(0, std::memory_order_relaxed);
+    m_dropped_frames.store(0, std::memory_order_relaxed);
+    m_denormal_blocks.store(0, std::memory_order_relaxed);
+    m_ring_fill_low.store(std::numeric_limits<size_t>::max(), std::memory_order_relaxed);
+    m_ring_fill_high.store(0, std::memory_order_relaxed);
+    m_total_ns.store(0, std::memory_order_relaxed);
+    m_total_period_ns.store(0, std::memory_order_relaxed);
+    m_period_ns.store(0, std::memory_order_relaxed);
+    m_max_ns.store(0, std::memory_order_relaxed);
+    m_peak_load_ppm.store(0, std::memory_order_relaxed);
+    m_latency_frames.store(0, std::memory_order_relaxed);
+    m_latency_sample_rate.store(0, std::memory_order_relaxed);
+    for (auto &bucket : m_histogram)
+    {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  /** @brief Copy the counters. Never blocks the audio path. */
+  StreamStatisticsSnapshot get_snapshot() const
+  {
+    StreamStatisticsSnapshot snapshot;
+    snapshot.callback_count = m_callback_count.load(std::memory_order_relaxed);
+    snapshot.xrun_count = m_xrun_count.load(std::memory_order_relaxed);
+    snapshot.underrun_count = m_underrun_count.load(std::memory_order_relaxed);
+    snapshot.overflow_count = m_overflow_count.load(std::memory_order_relaxed);
+    snapshot.dropped_frames = m_dropped_frames.load(std::memory_order_relaxed);
+    snapshot.denormal_blocks = m_denormal_blocks.load(std::memory_order_relaxed);
+
+    const size_t low = m_ring_fill_low.load(std::memory_order_relaxed);
+    snapshot.ring_fill_low = low == std::numeric_limits<size_t>::max() ? 0 : low;
+    snapshot.ring_fill_high = m_ring_fill_high.load(std::memory_order_relaxed);
+
+    std::array<uint64_t, HISTOGRAM_BUCKETS> histogram;
+    uint64_t count = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+      histogram[i] = m_histogram[i].load(std::memory_order_relaxed);
+      count += histogram[i];
+    }
+    snapshot.block_time_p50_us = get_percentile(histogram, count, 0.50) / 1000.0;
+    snapshot.block_time_p99_us = get_percentile(histogram, count, 0.99) / 1000.0;
+    snapshot.block_time_max_us = static_cast<double>(m_max_ns.load(std::memory_order_relaxed)) / 1000.0;
+
+    // The histogram rounds up, so never report a percentile above the exact maximum
+    snapshot.block_time_p50_us = std::min(snapshot.block_time_p50_us, snapshot.block_time_max_us);
+    snapshot.block_time_p99_us = std::min(snapshot.block_time_p99_us, snapshot.block_time_max_us);
+
+    snapshot.period_us = static_cast<double>(m_period_ns.load(std::memory_order_relaxed)) / 1000.0;
+    const uint64_t total_period_ns = m_total_period_ns.load(std::memory_order_relaxed);
+    snapshot.dsp_load_percent = total_period_ns > 0
+                                  ? 100.0 * static_cast<double>(m_total_ns.load(std::memory_order_relaxed)) / static_cast<double>(total_period_ns)
+                                  : 0.0;
+    snapshot.dsp_load_peak_percent = static_cast<double>(m_peak_load_ppm.load(std::memory_order_relaxed)) / 10000.0;
+
+    snapshot.latency_frames = m_latency_frames.load(std::memory_order_relaxed);
+    const unsigned int latency_sample_rate = m_latency_sample_rate.load(std::memory_order_relaxed);
+    snapshot.latency_ms = latency_sample_rate > 0
+                            ? 1000.0 * static_cast<double>(snapshot.latency_frames) / latency_sample_rate
+                            : 0.0;
+    return snapshot;
+  }
+
+private:
+  /** @brief Log-linear bucket: values below 2^SUB_BITS are exact, above that each power of two is split evenly. */
+  static size_t get_bucket(uint64_t value) noexcept
+  {
+    constexpr uint64_t sub_buckets = 1ull << HISTOGRAM_SUB_BUCKET_BITS;
+    if (value < sub_buckets)
+    {
+      return static_cast<size_t>(value);
+    }
+    const unsigned int shift = static_cast<unsigned int>(std::bit_width(value)) - HISTOGRAM_SUB_BUCKET_BITS - 1;
+    return static_cast<size_t>(((shift + 1) << HISTOGRAM_SUB_BUCKET_BITS) + ((value >> shift) - sub_buckets));
+  }
+
+  /** @brief Returns the largest value that falls into a bucket. */
+  static double get_bucket_upper_bound(size_t bucket) noexcept
+  {
+    constexpr size_t sub_buckets = size_t{1} << HISTOGRAM_SUB_BUCKET_BITS;
+    if (bucket < sub_buckets)
+    {
+      return static_cast<double>(bucket);
+    }
+    const unsigned int shift = static_cast<unsigned int>(bucket >> HISTOGRAM_SUB_BUCKET_BITS) - 1;
+    const double mantissa = static_cast<double>((bucket & (sub_buckets - 1)) + sub_buckets + 1);
+    return std::ldexp(mantissa, static_cast<int>(shift)) - 1.0;
+  }
+
+  static double get_percentile(const std::array<uint64_t, HISTOGRAM_BUCKETS> &histogram, uint64_t count, double percentile) noexcept
+  {
+    if (count == 0)
+    {
+      return 0.0;
+    }
+
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile * static_cast<double>(count))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+      seen += histogram[i];
+      if (seen >= rank)
+      {
+        return get_bucket_upper_bound(i);
+      }
+    }
+    return get_bucket_upper_bound(HISTOGRAM_BUCKETS - 1);
+  }
+
+  std::atomic<unsigned long long> m_callback_count;
+  std::atomic<unsigned long long> m_xrun_count;
+  std::atomic<unsigned long long> m_underrun_count;
+  std::atomic<unsigned long long> m_overflow_count;
+  std::atomic<unsigned long long> m_dropped_frames;
+  std::atomic<unsigned long long> m_denormal_blocks;
+  std::atomic<size_t> m_ring_fill_low;
+  std::atomic<size_t> m_ring_fill_high;
+  std::atomic<uint64_t> m_total_ns;
+  std::atomic<uint64_t> m_total_period_ns;
+  std::atomic<uint64_t> m_period_ns;
+  std::atomic<uint64_t> m_max_ns;
+  std::atomic<uint64_t> m_peak_load_ppm;
+  std::atomic<unsigned long long> m_latency_frames;
+  std::atomic<unsigned int> m_latency_sample_rate;
+  std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS> m_histogram;
+};
+
+using StreamStatisticsPtr = std::shared_ptr<StreamStatistics>;
+
+} // namespace miniaudioengine::framework
+
+#endif // __STREAM_STATISTICS_H__
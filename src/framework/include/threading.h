@@ -0,0 +1,95 @@
+#ifndef __THREADING_H__
+#define __THREADING_H__
+
+#include <string>
+#include <vector>
+
+namespace miniaudioengine::framework
+{
+
+/** @enum eThreadClass
+ *  @brief Scheduling class of an engine thread.
+ */
+enum class eThreadClass : unsigned int
+{
+  Audio,     // Device callback. SCHED_FIFO or MMCSS "Pro Audio", on a realtime core
+  Worker,    // Graph workers rendering alongside the callback, one priority step below it
+  Normal,    // Default scheduling, e.g. offline render threads, kept off the realtime cores
+  Io,        // Disk reads, decoding and recording. Default priority, kept off the realtime cores
+  Background // Scans and other bulk work. Lowest priority, kept off the realtime cores
+};
+
+std::string to_string(eThreadClass thread_class);
+
+/** @struct ThreadingConfig
+ *  @brief Engine-wide priorities and core placement of every registered thread.
+ */
+struct ThreadingConfig
+{
+  /** @brief Cores reserved for Audio and Worker threads, e.g. cores isolated with isolcpus={2,3,4,5}.
+   *  A realtime thread with index i runs on realtime_cores[i % size]: the audio callback and graph worker 0
+   *  on the first core, each further worker on the next. Every other thread is kept off these cores.
+   *  Empty leaves every thread free to run anywhere.
+   */
+  std::vector<unsigned int> realtime_cores;
+
+  /** @brief SCHED_FIFO priority of Audio threads. 0 keeps what the audio backend set, e.g. with
+   *  StreamConfig::schedule_realtime. On Windows any non-zero value joins MMCSS "Pro Audio" at critical priority.
+   */
+  int audio_priority{0};
+
+  /** @brief SCHED_FIFO priority of Worker threads, or MMCSS "Pro Audio" at high priority on Windows. 0 keeps the default. */
+  int worker_priority{70};
+
+  /** @brief Nice value of Background threads on Linux. Below normal priority on Windows. */
+  int background_nice{10};
+
+  std::string to_string() const;
+};
+
+/** @struct ThreadInfo
+ *  @brief A registered thread, for diagnostics.
+ */
+struct ThreadInfo
+{
+  std::string name;
+  eThreadClass thread_class{eThreadClass::Normal};
+  unsigned int index{0};
+  bool applied{false}; // Every priority and affinity request of the last configuration succeeded
+
+  std::string to_string() const;
+};
+
+/** @brief Engine threading: names, priorities and core affinity of every thread the engine runs.
+ *  Each thread registers itself once, when it starts, with a name and a class. Registration sets the
+ *  name used by the logger and the OS, then applies the class's priority and cores from the current
+ *  ThreadingConfig. Registered threads are remembered until they exit, so configure() also moves the
+ *  threads already running. Every request is best effort: a refused priority or affinity is logged
+ *  and the thread keeps running with what it has.
+ */
+namespace threading
+{
+
+/** @brief Replace the engine's threading configuration and apply it to every registered thread.
+ *  @return False if a priority or affinity request was refused, e.g. without CAP_SYS_NICE or rtprio limits.
+ */
+bool configure(const ThreadingConfig &config);
+
+ThreadingConfig get_config();
+
+/** @brief Name the calling thread and apply its class. Call once, from the thread itself.
+ *  @param index Position of the thread among the realtime threads, used to pick its core.
+ *  @return False if a priority or affinity request was refused.
+ */
+bool register_current_thread(const std::string &name, eThreadClass thread_class, unsigned int index = 0);
+
+/** @brief Returns true if the calling thread has registered. */
+bool is_current_thread_registered() noexcept;
+
+std::vector<ThreadInfo> get_threads();
+
+} // namespace threading
+
+} // namespace miniaudioengine::framework
+
+#endif // __THREADING_H__
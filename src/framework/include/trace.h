@@ -0,0 +1,180 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+namespace miniaudioengine::framework
+{
+
+/** @enum eTraceEventType
+ *  @brief Kinds of trace event, named after their Chrome trace phases.
+ */
+enum class eTraceEventType : unsigned char
+{
+  Complete, // A timed scope, e.g. one audio callback
+  Instant,  // A moment, e.g. an underrun
+  Counter   // A sampled value, e.g. a ring buffer fill
+};
+
+/** @struct TraceEvent
+ *  @brief One recorded event, copied out of a thread's ring.
+ */
+struct TraceEvent
+{
+  const char *name{nullptr}; // String literal, never freed
+  eTraceEventType type{eTraceEventType::Instant};
+  uint32_t id{0};            // E.g. the graph node index. Counters with different ids are separate tracks
+  uint64_t start_ticks{0};
+  uint64_t duration_ticks{0};
+  int64_t value{0};          // Counter value
+};
+
+/** @brief Engine timeline tracing.
+ *  When built with ENABLE_TRACING, the TRACE_* macros record events into a ring per thread while
+ *  tracing is enabled: a cycle counter read and a handful of relaxed stores, never a lock or an allocation.
+ *  Each ring keeps the most recent events and overwrites the oldest, so a dump taken right after a
+ *  glitch shows what every thread was doing leading up to it. Rings are allocated by enable() and
+ *  claimed lock-free by a thread's first event. Threads beyond MAX_THREADS are not traced.
+ *  Without ENABLE_TRACING the macros compile to nothing.
+ */
+namespace trace
+{
+
+/** @brief Largest number of threads traced at once. A ring is reused once its thread has exited. */
+constexpr size_t MAX_THREADS = 32;
+
+/** @brief Events kept per thread unless enable() is given a size. */
+constexpr size_t DEFAULT_EVENTS_PER_THREAD = 8192;
+
+namespace detail
+{
+extern std::atomic<bool> enabled;
+}
+
+/** @brief Returns true while events are recorded. */
+inline bool is_enabled() noexcept
+{
+  return detail::enabled.load(std::memory_order_relaxed);
+}
+
+/** @brief Returns steady_clock nanoseconds, the fallback trace clock. */
+uint64_t read_steady_ns() noexcept;
+
+/** @brief Returns the trace clock: the CPU's cycle counter where there is one, steady_clock nanoseconds otherwise. */
+inline uint64_t now() noexcept
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+  uint64_t ticks;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+  return ticks;
+#else
+  return read_steady_ns();
+#endif
+}
+
+/** @brief Allocate the rings and start recording. Control thread.
+ *  @param events_per_thread Ring size, rounded up to a power of two. Only the first call allocates.
+ */
+void enable(size_t events_per_thread = DEFAULT_EVENTS_PER_THREAD);
+
+/** @brief Stop recording. The rings keep their events until clear() or the next enable(). */
+void disable();
+
+/** @brief Forget every recorded event. Call while tracing is disabled for exact results. */
+void clear();
+
+/** @brief Record one event on the calling thread's ring. Lock-free and allocation-free. */
+void record(const TraceEvent &event) noexcept;
+
+/** @brief Returns the recorded events as Chrome trace JSON, opened by chrome://tracing and ui.perfetto.dev.
+ *  Timestamps are microseconds since enable(). Each thread is named after its logger thread name.
+ */
+std::string to_chrome_json();
+
+/** @brief Write to_chrome_json() to a file.
+ *  @return False if the file cannot be written.
+ */
+bool write_chrome_json(const std::filesystem::path &path);
+
+/** @class Scope
+ *  @brief Records a Complete event spanning its lifetime. Used by the TRACE_SCOPE macros.
+ */
+class Scope
+{
+public:
+  Scope(const char *name, uint32_t id = 0) noexcept :
+    m_name(is_enabled() ? name : nullptr),
+    m_id(id),
+    m_start(m_name != nullptr ? now() : 0)
+  {}
+
+  ~Scope()
+  {
+    if (m_name != nullptr)
+    {
+      record({m_name, eTraceEventType::Complete, m_id, m_start, now() - m_start, 0});
+    }
+  }
+
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+
+private:
+  const char *m_name;
+  uint32_t m_id;
+  uint64_t m_start;
+};
+
+/** @brief Record an Instant event. */
+inline void instant(const char *name, uint32_t id = 0) noexcept
+{
+  if (is_enabled())
+  {
+    record({name, eTraceEventType::Instant, id, now(), 0, 0});
+  }
+}
+
+/** @brief Record a Counter sample. */
+inline void counter(const char *name, uint32_t id, int64_t value) noexcept
+{
+  if (is_enabled())
+  {
+    record({name, eTraceEventType::Counter, id, now(), 0, value});
+  }
+}
+
+} // namespace trace
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+#ifdef ENABLE_TRACING
+#define TRACE_SCOPE(name) \
+  miniaudioengine::framework::trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_SCOPE_ID(name, id) \
+  miniaudioengine::framework::trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(name, static_cast<uint32_t>(id))
+#define TRACE_INSTANT(name) miniaudioengine::framework::trace::instant(name)
+#define TRACE_COUNTER(name, id, value) \
+  miniaudioengine::framework::trace::counter(name, static_cast<uint32_t>(id), static_cast<int64_t>(value))
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_SCOPE_ID(name, id) ((void)sizeof(id))
+#define TRACE_INSTANT(name)
+#define TRACE_COUNTER(name, id, value) ((void)sizeof(id), (void)sizeof(value))
+#endif
+
+} // namespace miniaudioengine::framework
+
+#endif // __TRACE_H__
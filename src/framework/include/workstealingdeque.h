@@ -0,0 +1,132 @@
+#ifndef __WORK_STEALING_DEQUE_H__
+#define __WORK_STEALING_DEQUE_H__
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+namespace miniaudioengine::framework
+{
+
+/** @class WorkStealingDeque
+ *  @brief Fixed-capacity Chase-Lev work-stealing deque.
+ *  The owning thread pushes and pops at the bottom, any other thread can steal from the top.
+ *  The storage is allocated once at construction so it never allocates while scheduling.
+ *  @tparam T A small trivially copyable item, e.g. a task index.
+ */
+template <typename T>
+class WorkStealingDeque
+{
+  static_assert(std::is_trivially_copyable_v<T>, "WorkStealingDeque items must be trivially copyable");
+
+public:
+  /** @brief Construct a deque.
+   *  @param capacity The maximum number of queued items. Rounded up to a power of two.
+   */
+  explicit WorkStealingDeque(size_t capacity) :
+    m_capacity(std::bit_ceil(std::max<size_t>(capacity, 2))),
+    m_mask(m_capacity - 1),
+    p_items(std::make_unique<std::atomic<T>[]>(m_capacity))
+  {}
+
+  WorkStealingDeque(const WorkStealingDeque &) = delete;
+  WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+  /** @brief Push an item at the bottom.
+   *  @note Owner thread only.
+   *  @return false if the deque is full.
+   */
+  bool push(T item) noexcept
+  {
+    const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    const int64_t top = m_top.load(std::memory_order_acquire);
+    if (bottom - top >= static_cast<int64_t>(m_capacity))
+    {
+      return false;
+    }
+
+    p_items[bottom & m_mask].store(item, std::memory_order_relaxed);
+    m_bottom.store(bottom + 1, std::memory_order_release);
+    return true;
+  }
+
+  /** @brief Pop the most recently pushed item.
+   *  @note Owner thread only.
+   */
+  std::optional<T> pop() noexcept
+  {
+    const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = m_top.load(std::memory_order_relaxed);
+
+    if (top > bottom)
+    {
+      // Empty
+      m_bottom.store(bottom + 1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+
+    T item = p_items[bottom & m_mask].load(std::memory_order_relaxed);
+    if (top == bottom)
+    {
+      // Last item, race against thieves for it
+      const bool won = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+      m_bottom.store(bottom + 1, std::memory_order_relaxed);
+      if (!won)
+      {
+        return std::nullopt;
+      }
+    }
+
+    return item;
+  }
+
+  /** @brief Steal the oldest item.
+   *  @note Any thread. May fail spuriously when racing another thief or the owner.
+   */
+  std::optional<T> steal() noexcept
+  {
+    int64_t top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom)
+    {
+      return std::nullopt;
+    }
+
+    T item = p_items[top & m_mask].load(std::memory_order_relaxed);
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+      return std::nullopt;
+    }
+
+    return item;
+  }
+
+  /** @brief Returns true if the deque looked empty. The value is a snapshot. */
+  bool empty() const noexcept
+  {
+    return m_top.load(std::memory_order_acquire) >= m_bottom.load(std::memory_order_acquire);
+  }
+
+  size_t capacity() const noexcept { return m_capacity; }
+
+private:
+  const size_t m_capacity;
+  const size_t m_mask;
+  std::unique_ptr<std::atomic<T>[]> p_items;
+
+  alignas(64) std::atomic<int64_t> m_top{0};
+  alignas(64) std::atomic<int64_t> m_bottom{0};
+};
+
+} // namespace miniaudioengine::framework
+
+#endif // __WORK_STEALING_DEQUE_H__
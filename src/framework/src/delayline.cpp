@@ -0,0 +1,59 @@
+#include "delayline.h"
+#include "logger.h"
+
+#include <algorithm>
+
+using namespace miniaudioengine::framework;
+
+bool DelayLine::prepare(unsigned int channels, size_t delay_frames, size_t max_frames)
+{
+  if (channels == 0 || max_frames == 0)
+  {
+    LOG_ERROR("DelayLine: prepare - Invalid format. Channels=", channels, ", MaxFrames=", max_frames);
+    return false;
+  }
+
+  m_channels = channels;
+  m_delay_frames = delay_frames;
+  m_max_frames = max_frames;
+  m_capacity = delay_frames + max_frames;
+  m_rings.assign(static_cast<size_t>(channels) * m_capacity, 0.0f);
+  m_output.assign(static_cast<size_t>(channels) * max_frames, 0.0f);
+  m_write_position.assign(channels, 0);
+  return true;
+}
+
+void DelayLine::reset() noexcept
+{
+  std::fill(m_rings.begin(), m_rings.end(), 0.0f);
+  std::fill(m_write_position.begin(), m_write_position.end(), 0);
+}
+
+const float *DelayLine::process(unsigned int channel, const float *source, size_t n_frames) noexcept
+{
+  float *ring = m_rings.data() + static_cast<size_t>(channel) * m_capacity;
+  float *output = m_output.data() + static_cast<size_t>(channel) * m_max_frames;
+  n_frames = std::min(n_frames, m_max_frames);
+
+  // Write first, so a delay shorter than the block reads part of the block just written
+  size_t &position = m_write_position[channel];
+  const size_t write_first = std::min(n_frames, m_capacity - position);
+  std::copy_n(source, write_first, ring + position);
+  std::copy_n(source + write_first, n_frames - write_first, ring);
+
+  // The ring holds delay + max_frames samples, so the samples read are never ones the write replaced
+  const size_t read_position = (position + m_capacity - m_delay_frames) % m_capacity;
+  const size_t read_first = std::min(n_frames, m_capacity - read_position);
+  std::copy_n(ring + read_position, read_first, output);
+  std::copy_n(ring, n_frames - read_first, output + read_first);
+
+  position = (position + n_frames) % m_capacity;
+  return output;
+}
+
+std::string DelayLine::to_string() const
+{
+  return "DelayLine(Channels=" + std::to_string(m_channels) +
+         ", DelayFrames=" + std::to_string(m_delay_frames) +
+         ", MaxFrames=" + std::to_string(m_max_frames) + ")";
+}
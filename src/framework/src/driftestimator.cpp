@@ -0,0 +1,101 @@
+#include "driftestimator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace miniaudioengine::framework;
+
+void DriftEstimator::prepare(const Config &config, unsigned int sample_rate) noexcept
+{
+  m_config = config;
+  m_sample_rate = sample_rate > 0 ? sample_rate : 1;
+  reset();
+}
+
+void DriftEstimator::reset() noexcept
+{
+  m_ratio = 1.0;
+  m_error_average = 0.0;
+  m_drift = 0.0;
+  m_tolerance_frames = 0.0;
+  m_settling = false;
+  m_elapsed_frames = 0;
+  m_fill_sum = 0.0;
+  m_fill_samples = 0;
+  m_fill_low = std::numeric_limits<double>::max();
+  m_target_frames = 0.0;
+  m_has_target = false;
+}
+
+void DriftEstimator::settle(double error_frames, double tolerance_frames) noexcept
+{
+  m_error_average = error_frames;
+  m_tolerance_frames = tolerance_frames;
+  m_settling = true;
+}
+
+double DriftEstimator::update(double error_frames, size_t frames, double feed_forward) noexcept
+{
+  const double alpha = std::min(1.0, static_cast<double>(frames) / (m_sample_rate * m_config.average_seconds));
+  m_error_average += (error_frames - m_error_average) * alpha;
+
+  if (m_settling && std::abs(m_error_average) <= m_tolerance_frames)
+  {
+    m_settling = false;
+  }
+
+  const double error_seconds = m_error_average / m_sample_rate;
+  const double elapsed_seconds = static_cast<double>(frames) / m_sample_rate;
+  if (!m_settling)
+  {
+    m_drift = std::clamp(m_drift + m_config.integral_gain * error_seconds * elapsed_seconds, -m_config.max_drift,
+                         m_config.max_drift);
+  }
+  m_ratio = 1.0 + std::clamp(m_config.proportional_gain * error_seconds + m_drift + feed_forward,
+                             -m_config.max_correction, m_config.max_correction);
+  return m_ratio;
+}
+
+double DriftEstimator::track(size_t fill_frames, size_t max_target_frames, size_t frames) noexcept
+{
+  if (!m_has_target)
+  {
+    // The first blocks after a start fill or drain the buffer while both streams spin up, so they are skipped
+    m_elapsed_frames += frames;
+    const double elapsed_seconds = static_cast<double>(m_elapsed_frames) / m_sample_rate;
+    if (elapsed_seconds <= m_config.warmup_seconds)
+    {
+      return m_ratio;
+    }
+
+    m_fill_sum += static_cast<double>(fill_frames);
+    m_fill_samples++;
+    m_fill_low = std::min(m_fill_low, static_cast<double>(fill_frames));
+    if (elapsed_seconds <= m_config.warmup_seconds + m_config.average_seconds)
+    {
+      return m_ratio;
+    }
+
+    // The fill swings by the writer's and reader's blocks. The lowest point must keep two reads in hand,
+    // and a target clamped below the fill drains the excess without mistaking it for drift
+    const double average = m_fill_sum / static_cast<double>(m_fill_samples);
+    const double headroom = std::max(0.0, 2.0 * static_cast<double>(frames) - m_fill_low);
+    m_target_frames = std::min(average + headroom, static_cast<double>(max_target_frames));
+    m_has_target = true;
+    settle(average - m_target_frames, static_cast<double>(frames));
+  }
+
+  const double target = std::min(m_target_frames, static_cast<double>(max_target_frames));
+  return update(static_cast<double>(fill_frames) - target, frames);
+}
+
+void DriftEstimator::raise_target(size_t frames) noexcept
+{
+  if (!m_has_target)
+  {
+    return;
+  }
+  m_target_frames += static_cast<double>(frames);
+  settle(m_error_average - static_cast<double>(frames), static_cast<double>(frames));
+}
@@ -0,0 +1,1209 @@
+#include "dspkernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DSP_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define DSP_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+// GCC and Clang need AVX2 enabled per function, MSVC accepts AVX2 intrinsics anywhere
+#if defined(DSP_KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define DSP_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define DSP_TARGET_AVX2
+#endif
+
+using namespace miniaudioengine::framework;
+
+namespace
+{
+
+constexpr float INT16_SCALE = 1.0f / 32768.0f;
+constexpr float INT24_SCALE = 1.0f / 8388608.0f;
+constexpr float INT32_SCALE = 1.0f / 2147483648.0f;
+
+// =============================================================================
+// Scalar
+// =============================================================================
+
+void scalar_add(float *destination, const float *source, size_t n) noexcept
+{
+  for (size_t i = 0; i < n; i++)
+    destination[i] += source[i];
+}
+
+void scalar_add_with_gain(float *destination, const float *source, float gain, size_t n) noexcept
+{
+  for (size_t i = 0; i < n; i++)
+    destination[i] += source[i] * gain;
+}
+
+void scalar_copy_with_gain(float *destination, const float *source, float gain, size_t n) noexcept
+{
+  for (size_t i = 0; i < n; i++)
+    destination[i] = source[i] * gain;
+}
+
+void scalar_scale(float *buffer, float gain, size_t n) noexcept
+{
+  for (size_t i = 0; i < n; i++)
+    buffer[i] *= gain;
+}
+
+void scalar_multiply(float *buffer, const float *gains, size_t n) noexcept
+{
+  for (size_t i = 0; i < n; i++)
+    buffer[i] *= gains[i];
+}
+
+void scalar_fill_ramp(float *destination, float start, float step, size_t n) noexcept
+{
+  for (size_t i = 0; i < n; i++)
+    destination[i] = start + step * static_cast<float>(i);
+}
+
+void scalar_fill_exponential_ramp(float *destination, float start, float ratio, size_t n) noexcept
+{
+  float value = start;
+  for (size_t i = 0; i < n; i++)
+  {
+    destination[i] = value;
+    value *= ratio;
+  }
+}
+
+/** @brief Interpolate outputs [begin, n), positions computed exactly as the SIMD paths do. */
+inline void interpolate_linear_from(float *destination, const float *source, size_t stride, double position,
+                                    double increment, size_t begin, size_t n) noexcept
+{
+  for (size_t i = begin; i < n; i++)
+  {
+    const double p = position + increment * static_cast<double>(i);
+    const size_t index = static_cast<size_t>(p);
+    const float fraction = static_cast<float>(p - static_cast<double>(index));
+    const float a = source[index * stride];
+    const float b = source[(index + 1) * stride];
+    destination[i] = a + fraction * (b - a);
+  }
+}
+
+void scalar_interpolate_linear(float *destination, const float *source, size_t stride, double position,
+                               double increment, size_t n) noexcept
+{
+  interpolate_linear_from(destination, source, stride, position, increment, 0, n);
+}
+
+void scalar_clamp(float *buffer, float minimum, float maximum, size_t n) noexcept
+{
+  for (size_t i = 0; i < n; i++)
+    buffer[i] = std::min(std::max(buffer[i], minimum), maximum);
+}
+
+inline float soft_clip_sample(float x) noexcept
+{
+  // Pade approximation of tanh, exact at the +/-3 clamp points
+  x = std::min(std::max(x, -3.0f), 3.0f);
+  const float x2 = x * x;
+  return x * (27.0f + x2) / (27.0f + 9.0f * x2);
+}
+
+void scalar_soft_clip(float *buffer, size_t n) noexcept
+{
+  for (size_t i = 0; i < n; i++)
+    buffer[i] = soft_clip_sample(buffer[i]);
+}
+
+void scalar_interleave_stereo(float *destination, const float *left, const float *right, size_t frames) noexcept
+{
+  for (size_t i = 0; i < frames; i++)
+  {
+    destination[2 * i] = left[i];
+    destination[2 * i + 1] = right[i];
+  }
+}
+
+void scalar_deinterleave_stereo(float *left, float *right, const float *source, size_t frames) noexcept
+{
+  for (size_t i = 0; i < frames; i++)
+  {
+    left[i] = source[2 * i];
+    right[i] = source[2 * i + 1];
+  }
+}
+
+void scalar_int16_to_float(float *destination, const int16_t *source, size_t n) noexcept
+{
+  for (size_t i = 0; i < n; i++)
+    destination[i] = static_cast<float>(source[i]) * INT16_SCALE;
+}
+
+void scalar_float_to_int16(int16_t *destination, const float *source, size_t n) noexcept
+{
+  for (size_t i = 0; i < n; i++)
+  {
+    const float scaled = std::min(std::max(source[i], -1.0f), 1.0f) * 32767.0f;
+    destination[i] = static_cast<int16_t>(std::lrint(scaled));
+  }
+}
+
+void scalar_int24_to_float(float *destination, const uint8_t *source, size_t n) noexcept
+{
+  for (size_t i = 0; i < n; i++)
+  {
+    const uint8_t *sample = source + 3 * i;
+    // Assemble in the top 24 bits so the arithmetic shift sign-extends
+    const int32_t value = static_cast<int32_t>((uint32_t(sample[0]) << 8) | (uint32_t(sample[1]) << 16) | (uint32_t(sample[2]) << 24)) >> 8;
+    destination[i] = static_cast<float>(value) * INT24_SCALE;
+  }
+}
+
+void scalar_int32_to_float(float *destination, const int32_t *source, size_t n) noexcept
+{
+  for (size_t i = 0; i < n; i++)
+    destination[i] = static_cast<float>(source[i]) * INT32_SCALE;
+}
+
+void scalar_float_to_int32(int32_t *destination, const float *source, size_t n) noexcept
+{
+  for (size_t i = 0; i < n; i++)
+  {
+    // Work in double so full scale maps onto INT32_MAX without overflowing
+    const double scaled = std::min(std::max(static_cast<double>(source[i]), -1.0), 1.0) * 2147483647.0;
+    destination[i] = static_cast<int32_t>(std::lrint(scaled));
+  }
+}
+
+float scalar_dot(const float *a, const float *b, size_t n) noexcept
+{
+  float sum = 0.0f;
+  for (size_t i = 0; i < n; i++)
+    sum += a[i] * b[i];
+  return sum;
+}
+
+dsp::LevelSums scalar_measure_levels(const float *source, size_t n) noexcept
+{
+  dsp::LevelSums sums{0.0f, 0.0f};
+  for (size_t i = 0; i < n; i++)
+  {
+    sums.peak = std::max(sums.peak, std::fabs(source[i]));
+    sums.energy += source[i] * source[i];
+  }
+  return sums;
+}
+
+constexpr dsp::KernelTable SCALAR_KERNELS = {
+  dsp::eSimdLevel::Scalar,
+  scalar_add,
+  scalar_add_with_gain,
+  scalar_copy_with_gain,
+  scalar_scale,
+  scalar_multiply,
+  scalar_fill_ramp,
+  scalar_fill_exponential_ramp,
+  scalar_interpolate_linear,
+  scalar_clamp,
+  scalar_soft_clip,
+  scalar_interleave_stereo,
+  scalar_deinterleave_stereo,
+  scalar_int16_to_float,
+  scalar_float_to_int16,
+  scalar_int24_to_float,
+  scalar_int32_to_float,
+  scalar_float_to_int32,
+  scalar_dot,
+  scalar_measure_levels,
+};
+
+#if defined(DSP_KERNELS_X86)
+
+// =============================================================================
+// SSE2
+// =============================================================================
+
+void sse2_add(float *destination, const float *source, size_t n) noexcept
+{
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(destination + i, _mm_add_ps(_mm_loadu_ps(destination + i), _mm_loadu_ps(source + i)));
+  scalar_add(destination + i, source + i, n - i);
+}
+
+void sse2_add_with_gain(float *destination, const float *source, float gain, size_t n) noexcept
+{
+  const __m128 g = _mm_set1_ps(gain);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(destination + i, _mm_add_ps(_mm_loadu_ps(destination + i), _mm_mul_ps(_mm_loadu_ps(source + i), g)));
+  scalar_add_with_gain(destination + i, source + i, gain, n - i);
+}
+
+void sse2_copy_with_gain(float *destination, const float *source, float gain, size_t n) noexcept
+{
+  const __m128 g = _mm_set1_ps(gain);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(destination + i, _mm_mul_ps(_mm_loadu_ps(source + i), g));
+  scalar_copy_with_gain(destination + i, source + i, gain, n - i);
+}
+
+void sse2_scale(float *buffer, float gain, size_t n) noexcept
+{
+  const __m128 g = _mm_set1_ps(gain);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(buffer + i, _mm_mul_ps(_mm_loadu_ps(buffer + i), g));
+  scalar_scale(buffer + i, gain, n - i);
+}
+
+void sse2_multiply(float *buffer, const float *gains, size_t n) noexcept
+{
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(buffer + i, _mm_mul_ps(_mm_loadu_ps(buffer + i), _mm_loadu_ps(gains + i)));
+  scalar_multiply(buffer + i, gains + i, n - i);
+}
+
+void sse2_fill_ramp(float *destination, float start, float step, size_t n) noexcept
+{
+  // Every lane is computed from its index, so the ramp never drifts from the scalar one
+  const __m128 s = _mm_set1_ps(step);
+  __m128 index = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+  const __m128 four = _mm_set1_ps(4.0f);
+  const __m128 base = _mm_set1_ps(start);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    _mm_storeu_ps(destination + i, _mm_add_ps(base, _mm_mul_ps(s, index)));
+    index = _mm_add_ps(index, four);
+  }
+  for (; i < n; i++)
+    destination[i] = start + step * static_cast<float>(i);
+}
+
+void sse2_fill_exponential_ramp(float *destination, float start, float ratio, size_t n) noexcept
+{
+  const float ratio2 = ratio * ratio;
+  __m128 value = _mm_setr_ps(start, start * ratio, start * ratio2, start * ratio2 * ratio);
+  const __m128 ratio4 = _mm_set1_ps(ratio2 * ratio2);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    _mm_storeu_ps(destination + i, value);
+    value = _mm_mul_ps(value, ratio4);
+  }
+  scalar_fill_exponential_ramp(destination + i, _mm_cvtss_f32(value), ratio, n - i);
+}
+
+void sse2_interpolate_linear(float *destination, const float *source, size_t stride, double position,
+                             double increment, size_t n) noexcept
+{
+  // Positions stay in double so every path reads the same frames. The loads are scalar, SSE2 has no gather
+  const __m128d start = _mm_set1_pd(position);
+  const __m128d step = _mm_set1_pd(increment);
+  const __m128d four = _mm_set1_pd(4.0);
+  __m128d frame01 = _mm_setr_pd(0.0, 1.0);
+  __m128d frame23 = _mm_setr_pd(2.0, 3.0);
+  alignas(16) int32_t index[4];
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    const __m128d p01 = _mm_add_pd(start, _mm_mul_pd(step, frame01));
+    const __m128d p23 = _mm_add_pd(start, _mm_mul_pd(step, frame23));
+    const __m128i whole01 = _mm_cvttpd_epi32(p01);
+    const __m128i whole23 = _mm_cvttpd_epi32(p23);
+    const __m128 fraction = _mm_movelh_ps(_mm_cvtpd_ps(_mm_sub_pd(p01, _mm_cvtepi32_pd(whole01))),
+                                          _mm_cvtpd_ps(_mm_sub_pd(p23, _mm_cvtepi32_pd(whole23))));
+    _mm_store_si128(reinterpret_cast<__m128i *>(index), _mm_unpacklo_epi64(whole01, whole23));
+
+    const float *s0 = source + static_cast<size_t>(index[0]) * stride;
+    const float *s1 = source + static_cast<size_t>(index[1]) * stride;
+    const float *s2 = source + static_cast<size_t>(index[2]) * stride;
+    const float *s3 = source + static_cast<size_t>(index[3]) * stride;
+    const __m128 a = _mm_setr_ps(s0[0], s1[0], s2[0], s3[0]);
+    const __m128 b = _mm_setr_ps(s0[stride], s1[stride], s2[stride], s3[stride]);
+    _mm_storeu_ps(destination + i, _mm_add_ps(a, _mm_mul_ps(fraction, _mm_sub_ps(b, a))));
+
+    frame01 = _mm_add_pd(frame01, four);
+    frame23 = _mm_add_pd(frame23, four);
+  }
+  interpolate_linear_from(destination, source, stride, position, increment, i, n);
+}
+
+void sse2_clamp(float *buffer, float minimum, float maximum, size_t n) noexcept
+{
+  const __m128 lo = _mm_set1_ps(minimum);
+  const __m128 hi = _mm_set1_ps(maximum);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(buffer + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(buffer + i), lo), hi));
+  scalar_clamp(buffer + i, minimum, maximum, n - i);
+}
+
+void sse2_soft_clip(float *buffer, size_t n) noexcept
+{
+  const __m128 lo = _mm_set1_ps(-3.0f);
+  const __m128 hi = _mm_set1_ps(3.0f);
+  const __m128 c27 = _mm_set1_ps(27.0f);
+  const __m128 c9 = _mm_set1_ps(9.0f);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    const __m128 x = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(buffer + i), lo), hi);
+    const __m128 x2 = _mm_mul_ps(x, x);
+    const __m128 numerator = _mm_mul_ps(x, _mm_add_ps(c27, x2));
+    const __m128 denominator = _mm_add_ps(c27, _mm_mul_ps(c9, x2));
+    _mm_storeu_ps(buffer + i, _mm_div_ps(numerator, denominator));
+  }
+  scalar_soft_clip(buffer + i, n - i);
+}
+
+void sse2_interleave_stereo(float *destination, const float *left, const float *right, size_t frames) noexcept
+{
+  size_t i = 0;
+  for (; i + 4 <= frames; i += 4)
+  {
+    const __m128 l = _mm_loadu_ps(left + i);
+    const __m128 r = _mm_loadu_ps(right + i);
+    _mm_storeu_ps(destination + 2 * i, _mm_unpacklo_ps(l, r));
+    _mm_storeu_ps(destination + 2 * i + 4, _mm_unpackhi_ps(l, r));
+  }
+  scalar_interleave_stereo(destination + 2 * i, left + i, right + i, frames - i);
+}
+
+void sse2_deinterleave_stereo(float *left, float *right, const float *source, size_t frames) noexcept
+{
+  size_t i = 0;
+  for (; i + 4 <= frames; i += 4)
+  {
+    const __m128 a = _mm_loadu_ps(source + 2 * i);
+    const __m128 b = _mm_loadu_ps(source + 2 * i + 4);
+    _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+  }
+  scalar_deinterleave_stereo(left + i, right + i, source + 2 * i, frames - i);
+}
+
+void sse2_int16_to_float(float *destination, const int16_t *source, size_t n) noexcept
+{
+  const __m128 scale = _mm_set1_ps(INT16_SCALE);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+    // Place each sample in the top half of a 32-bit lane, then shift down to sign-extend
+    const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+    const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+    _mm_storeu_ps(destination + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+    _mm_storeu_ps(destination + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+  }
+  scalar_int16_to_float(destination + i, source + i, n - i);
+}
+
+void sse2_float_to_int16(int16_t *destination, const float *source, size_t n) noexcept
+{
+  const __m128 lo = _mm_set1_ps(-1.0f);
+  const __m128 hi = _mm_set1_ps(1.0f);
+  const __m128 scale = _mm_set1_ps(32767.0f);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    const __m128 a = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(source + i), lo), hi), scale);
+    const __m128 b = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(source + i + 4), lo), hi), scale);
+    const __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i), packed);
+  }
+  scalar_float_to_int16(destination + i, source + i, n - i);
+}
+
+void sse2_int32_to_float(float *destination, const int32_t *source, size_t n) noexcept
+{
+  const __m128 scale = _mm_set1_ps(INT32_SCALE);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+    _mm_storeu_ps(destination + i, _mm_mul_ps(_mm_cvtepi32_ps(x), scale));
+  }
+  scalar_int32_to_float(destination + i, source + i, n - i);
+}
+
+float sse2_dot(const float *a, const float *b, size_t n) noexcept
+{
+  // Two accumulators hide the latency of the dependent adds
+  __m128 sum0 = _mm_setzero_ps();
+  __m128 sum1 = _mm_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+  }
+  for (; i + 4 <= n; i += 4)
+    sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+
+  __m128 sum = _mm_add_ps(sum0, sum1);
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+  return _mm_cvtss_f32(sum) + scalar_dot(a + i, b + i, n - i);
+}
+
+dsp::LevelSums sse2_measure_levels(const float *source, size_t n) noexcept
+{
+  // Clearing the sign bit gives the magnitude
+  const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  __m128 peak = _mm_setzero_ps();
+  __m128 energy0 = _mm_setzero_ps();
+  __m128 energy1 = _mm_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    const __m128 a = _mm_loadu_ps(source + i);
+    const __m128 b = _mm_loadu_ps(source + i + 4);
+    peak = _mm_max_ps(peak, _mm_max_ps(_mm_and_ps(a, abs_mask), _mm_and_ps(b, abs_mask)));
+    energy0 = _mm_add_ps(energy0, _mm_mul_ps(a, a));
+    energy1 = _mm_add_ps(energy1, _mm_mul_ps(b, b));
+  }
+
+  __m128 energy = _mm_add_ps(energy0, energy1);
+  energy = _mm_add_ps(energy, _mm_movehl_ps(energy, energy));
+  energy = _mm_add_ss(energy, _mm_shuffle_ps(energy, energy, 1));
+  peak = _mm_max_ps(peak, _mm_movehl_ps(peak, peak));
+  peak = _mm_max_ss(peak, _mm_shuffle_ps(peak, peak, 1));
+
+  const dsp::LevelSums tail = scalar_measure_levels(source + i, n - i);
+  return {std::max(_mm_cvtss_f32(peak), tail.peak), _mm_cvtss_f32(energy) + tail.energy};
+}
+
+constexpr dsp::KernelTable SSE2_KERNELS = {
+  dsp::eSimdLevel::SSE2,
+  sse2_add,
+  sse2_add_with_gain,
+  sse2_copy_with_gain,
+  sse2_scale,
+  sse2_multiply,
+  sse2_fill_ramp,
+  sse2_fill_exponential_ramp,
+  sse2_interpolate_linear,
+  sse2_clamp,
+  sse2_soft_clip,
+  sse2_interleave_stereo,
+  sse2_deinterleave_stereo,
+  sse2_int16_to_float,
+  sse2_float_to_int16,
+  scalar_int24_to_float,
+  sse2_int32_to_float,
+  scalar_float_to_int32,
+  sse2_dot,
+  sse2_measure_levels,
+};
+
+// =============================================================================
+// AVX2
+// =============================================================================
+
+// The SSE2 tails are legacy-encoded. Clear the upper ymm state first, or every SSE instruction
+// after the AVX loop pays a transition penalty.
+
+DSP_TARGET_AVX2 void avx2_add(float *destination, const float *source, size_t n) noexcept
+{
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(destination + i, _mm256_add_ps(_mm256_loadu_ps(destination + i), _mm256_loadu_ps(source + i)));
+  _mm256_zeroupper();
+  sse2_add(destination + i, source + i, n - i);
+}
+
+DSP_TARGET_AVX2 void avx2_add_with_gain(float *destination, const float *source, float gain, size_t n) noexcept
+{
+  const __m256 g = _mm256_set1_ps(gain);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(destination + i, _mm256_add_ps(_mm256_loadu_ps(destination + i), _mm256_mul_ps(_mm256_loadu_ps(source + i), g)));
+  _mm256_zeroupper();
+  sse2_add_with_gain(destination + i, source + i, gain, n - i);
+}
+
+DSP_TARGET_AVX2 void avx2_copy_with_gain(float *destination, const float *source, float gain, size_t n) noexcept
+{
+  const __m256 g = _mm256_set1_ps(gain);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(destination + i, _mm256_mul_ps(_mm256_loadu_ps(source + i), g));
+  _mm256_zeroupper();
+  sse2_copy_with_gain(destination + i, source + i, gain, n - i);
+}
+
+DSP_TARGET_AVX2 void avx2_scale(float *buffer, float gain, size_t n) noexcept
+{
+  const __m256 g = _mm256_set1_ps(gain);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(buffer + i, _mm256_mul_ps(_mm256_loadu_ps(buffer + i), g));
+  _mm256_zeroupper();
+  sse2_scale(buffer + i, gain, n - i);
+}
+
+DSP_TARGET_AVX2 void avx2_multiply(float *buffer, const float *gains, size_t n) noexcept
+{
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(buffer + i, _mm256_mul_ps(_mm256_loadu_ps(buffer + i), _mm256_loadu_ps(gains + i)));
+  _mm256_zeroupper();
+  sse2_multiply(buffer + i, gains + i, n - i);
+}
+
+DSP_TARGET_AVX2 void avx2_fill_ramp(float *destination, float start, float step, size_t n) noexcept
+{
+  const __m256 s = _mm256_set1_ps(step);
+  __m256 index = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+  const __m256 eight = _mm256_set1_ps(8.0f);
+  const __m256 base = _mm256_set1_ps(start);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    _mm256_storeu_ps(destination + i, _mm256_add_ps(base, _mm256_mul_ps(s, index)));
+    index = _mm256_add_ps(index, eight);
+  }
+  _mm256_zeroupper();
+  for (; i < n; i++)
+    destination[i] = start + step * static_cast<float>(i);
+}
+
+DSP_TARGET_AVX2 void avx2_fill_exponential_ramp(float *destination, float start, float ratio, size_t n) noexcept
+{
+  alignas(32) float lanes[8];
+  lanes[0] = start;
+  for (int lane = 1; lane < 8; lane++)
+    lanes[lane] = lanes[lane - 1] * ratio;
+
+  const float ratio2 = ratio * ratio;
+  const float ratio4 = ratio2 * ratio2;
+  __m256 value = _mm256_load_ps(lanes);
+  const __m256 ratio8 = _mm256_set1_ps(ratio4 * ratio4);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    _mm256_storeu_ps(destination + i, value);
+    value = _mm256_mul_ps(value, ratio8);
+  }
+  _mm256_store_ps(lanes, value);
+  _mm256_zeroupper();
+  scalar_fill_exponential_ramp(destination + i, lanes[0], ratio, n - i);
+}
+
+DSP_TARGET_AVX2 void avx2_interpolate_linear(float *destination, const float *source, size_t stride, double position,
+                                             double increment, size_t n) noexcept
+{
+  const __m256d start = _mm256_set1_pd(position);
+  const __m256d step = _mm256_set1_pd(increment);
+  const __m256d eight = _mm256_set1_pd(8.0);
+  const __m256i frame_stride = _mm256_set1_epi32(static_cast<int>(stride));
+  __m256d frame_lo = _mm256_setr_pd(0.0, 1.0, 2.0, 3.0);
+  __m256d frame_hi = _mm256_setr_pd(4.0, 5.0, 6.0, 7.0);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    const __m256d p_lo = _mm256_add_pd(start, _mm256_mul_pd(step, frame_lo));
+    const __m256d p_hi = _mm256_add_pd(start, _mm256_mul_pd(step, frame_hi));
+    const __m128i whole_lo = _mm256_cvttpd_epi32(p_lo);
+    const __m128i whole_hi = _mm256_cvttpd_epi32(p_hi);
+    const __m128 fraction_lo = _mm256_cvtpd_ps(_mm256_sub_pd(p_lo, _mm256_cvtepi32_pd(whole_lo)));
+    const __m128 fraction_hi = _mm256_cvtpd_ps(_mm256_sub_pd(p_hi, _mm256_cvtepi32_pd(whole_hi)));
+    const __m256 fraction = _mm256_insertf128_ps(_mm256_castps128_ps256(fraction_lo), fraction_hi, 1);
+
+    const __m256i offsets = _mm256_mullo_epi32(_mm256_inserti128_si256(_mm256_castsi128_si256(whole_lo), whole_hi, 1),
+                                               frame_stride);
+    const __m256 a = _mm256_i32gather_ps(source, offsets, 4);
+    const __m256 b = _mm256_i32gather_ps(source + stride, offsets, 4);
+    _mm256_storeu_ps(destination + i, _mm256_add_ps(a, _mm256_mul_ps(fraction, _mm256_sub_ps(b, a))));
+
+    frame_lo = _mm256_add_pd(frame_lo, eight);
+    frame_hi = _mm256_add_pd(frame_hi, eight);
+  }
+  _mm256_zeroupper();
+  interpolate_linear_from(destination, source, stride, position, increment, i, n);
+}
+
+DSP_TARGET_AVX2 void avx2_clamp(float *buffer, float minimum, float maximum, size_t n) noexcept
+{
+  const __m256 lo = _mm256_set1_ps(minimum);
+  const __m256 hi = _mm256_set1_ps(maximum);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(buffer + i, _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(buffer + i), lo), hi));
+  _mm256_zeroupper();
+  sse2_clamp(buffer + i, minimum, maximum, n - i);
+}
+
+DSP_TARGET_AVX2 void avx2_soft_clip(float *buffer, size_t n) noexcept
+{
+  const __m256 lo = _mm256_set1_ps(-3.0f);
+  const __m256 hi = _mm256_set1_ps(3.0f);
+  const __m256 c27 = _mm256_set1_ps(27.0f);
+  const __m256 c9 = _mm256_set1_ps(9.0f);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    const __m256 x = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(buffer + i), lo), hi);
+    const __m256 x2 = _mm256_mul_ps(x, x);
+    const __m256 numerator = _mm256_mul_ps(x, _mm256_add_ps(c27, x2));
+    const __m256 denominator = _mm256_add_ps(c27, _mm256_mul_ps(c9, x2));
+    _mm256_storeu_ps(buffer + i, _mm256_div_ps(numerator, denominator));
+  }
+  _mm256_zeroupper();
+  sse2_soft_clip(buffer + i, n - i);
+}
+
+DSP_TARGET_AVX2 void avx2_interleave_stereo(float *destination, const float *left, const float *right, size_t frames) noexcept
+{
+  size_t i = 0;
+  for (; i + 8 <= frames; i += 8)
+  {
+    const __m256 l = _mm256_loadu_ps(left + i);
+    const __m256 r = _mm256_loadu_ps(right + i);
+    // Unpack works per 128-bit lane, so swap the middle lanes back into order
+    const __m256 lo = _mm256_unpacklo_ps(l, r);
+    const __m256 hi = _mm256_unpackhi_ps(l, r);
+    _mm256_storeu_ps(destination + 2 * i, _mm256_permute2f128_ps(lo, hi, 0x20));
+    _mm256_storeu_ps(destination + 2 * i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+  }
+  _mm256_zeroupper();
+  sse2_interleave_stereo(destination + 2 * i, left + i, right + i, frames - i);
+}
+
+DSP_TARGET_AVX2 void avx2_deinterleave_stereo(float *left, float *right, const float *source, size_t frames) noexcept
+{
+  size_t i = 0;
+  for (; i + 8 <= frames; i += 8)
+  {
+    const __m256 a = _mm256_loadu_ps(source + 2 * i);
+    const __m256 b = _mm256_loadu_ps(source + 2 * i + 8);
+    // Shuffle works per 128-bit lane, leaving the 64-bit halves as [a0 b0 a1 b1]
+    const __m256 l = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    const __m256 r = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    _mm256_storeu_ps(left + i, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(l), _MM_SHUFFLE(3, 1, 2, 0))));
+    _mm256_storeu_ps(right + i, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(r), _MM_SHUFFLE(3, 1, 2, 0))));
+  }
+  _mm256_zeroupper();
+  sse2_deinterleave_stereo(left + i, right + i, source + 2 * i, frames - i);
+}
+
+DSP_TARGET_AVX2 void avx2_int16_to_float(float *destination, const int16_t *source, size_t n) noexcept
+{
+  const __m256 scale = _mm256_set1_ps(INT16_SCALE);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    const __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i)));
+    _mm256_storeu_ps(destination + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+  }
+  _mm256_zeroupper();
+  sse2_int16_to_float(destination + i, source + i, n - i);
+}
+
+DSP_TARGET_AVX2 void avx2_float_to_int16(int16_t *destination, const float *source, size_t n) noexcept
+{
+  const __m256 lo = _mm256_set1_ps(-1.0f);
+  const __m256 hi = _mm256_set1_ps(1.0f);
+  const __m256 scale = _mm256_set1_ps(32767.0f);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16)
+  {
+    const __m256 a = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(source + i), lo), hi), scale);
+    const __m256 b = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(source + i + 8), lo), hi), scale);
+    // Pack works per 128-bit lane, so restore sample order afterwards
+    const __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(destination + i), _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+  }
+  _mm256_zeroupper();
+  sse2_float_to_int16(destination + i, source + i, n - i);
+}
+
+DSP_TARGET_AVX2 void avx2_int32_to_float(float *destination, const int32_t *source, size_t n) noexcept
+{
+  const __m256 scale = _mm256_set1_ps(INT32_SCALE);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + i));
+    _mm256_storeu_ps(destination + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+  }
+  _mm256_zeroupper();
+  sse2_int32_to_float(destination + i, source + i, n - i);
+}
+
+DSP_TARGET_AVX2 float avx2_dot(const float *a, const float *b, size_t n) noexcept
+{
+  __m256 sum0 = _mm256_setzero_ps();
+  __m256 sum1 = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16)
+  {
+    sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+  }
+  for (; i + 8 <= n; i += 8)
+    sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+
+  const __m256 sum = _mm256_add_ps(sum0, sum1);
+  __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+  _mm256_zeroupper();
+  half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+  half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+  return _mm_cvtss_f32(half) + sse2_dot(a + i, b + i, n - i);
+}
+
+DSP_TARGET_AVX2 dsp::LevelSums avx2_measure_levels(const float *source, size_t n) noexcept
+{
+  const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+  __m256 peak = _mm256_setzero_ps();
+  __m256 energy0 = _mm256_setzero_ps();
+  __m256 energy1 = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16)
+  {
+    const __m256 a = _mm256_loadu_ps(source + i);
+    const __m256 b = _mm256_loadu_ps(source + i + 8);
+    peak = _mm256_max_ps(peak, _mm256_max_ps(_mm256_and_ps(a, abs_mask), _mm256_and_ps(b, abs_mask)));
+    energy0 = _mm256_add_ps(energy0, _mm256_mul_ps(a, a));
+    energy1 = _mm256_add_ps(energy1, _mm256_mul_ps(b, b));
+  }
+
+  const __m256 energy = _mm256_add_ps(energy0, energy1);
+  __m128 energy_half = _mm_add_ps(_mm256_castps256_ps128(energy), _mm256_extractf128_ps(energy, 1));
+  __m128 peak_half = _mm_max_ps(_mm256_castps256_ps128(peak), _mm256_extractf128_ps(peak, 1));
+  _mm256_zeroupper();
+  energy_half = _mm_add_ps(energy_half, _mm_movehl_ps(energy_half, energy_half));
+  energy_half = _mm_add_ss(energy_half, _mm_shuffle_ps(energy_half, energy_half, 1));
+  peak_half = _mm_max_ps(peak_half, _mm_movehl_ps(peak_half, peak_half));
+  peak_half = _mm_max_ss(peak_half, _mm_shuffle_ps(peak_half, peak_half, 1));
+
+  const dsp::LevelSums tail = sse2_measure_levels(source + i, n - i);
+  return {std::max(_mm_cvtss_f32(peak_half), tail.peak), _mm_cvtss_f32(energy_half) + tail.energy};
+}
+
+constexpr dsp::KernelTable AVX2_KERNELS = {
+  dsp::eSimdLevel::AVX2,
+  avx2_add,
+  avx2_add_with_gain,
+  avx2_copy_with_gain,
+  avx2_scale,
+  avx2_multiply,
+  avx2_fill_ramp,
+  avx2_fill_exponential_ramp,
+  avx2_interpolate_linear,
+  avx2_clamp,
+  avx2_soft_clip,
+  avx2_interleave_stereo,
+  avx2_deinterleave_stereo,
+  avx2_int16_to_float,
+  avx2_float_to_int16,
+  scalar_int24_to_float,
+  avx2_int32_to_float,
+  scalar_float_to_int32,
+  avx2_dot,
+  avx2_measure_levels,
+};
+
+bool cpu_supports_avx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7)
+    return false;
+
+  // AVX2 needs the OS to save the YMM registers (OSXSAVE + XCR0 bits 1 and 2)
+  __cpuid(info, 1);
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  if (!osxsave || (_xgetbv(0) & 0x6) != 0x6)
+    return false;
+
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // DSP_KERNELS_X86
+
+#if defined(DSP_KERNELS_NEON)
+
+// =============================================================================
+// NEON
+// =============================================================================
+
+void neon_add(float *destination, const float *source, size_t n) noexcept
+{
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    vst1q_f32(destination + i, vaddq_f32(vld1q_f32(destination + i), vld1q_f32(source + i)));
+  scalar_add(destination + i, source + i, n - i);
+}
+
+void neon_add_with_gain(float *destination, const float *source, float gain, size_t n) noexcept
+{
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    vst1q_f32(destination + i, vmlaq_n_f32(vld1q_f32(destination + i), vld1q_f32(source + i), gain));
+  scalar_add_with_gain(destination + i, source + i, gain, n - i);
+}
+
+void neon_copy_with_gain(float *destination, const float *source, float gain, size_t n) noexcept
+{
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    vst1q_f32(destination + i, vmulq_n_f32(vld1q_f32(source + i), gain));
+  scalar_copy_with_gain(destination + i, source + i, gain, n - i);
+}
+
+void neon_scale(float *buffer, float gain, size_t n) noexcept
+{
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    vst1q_f32(buffer + i, vmulq_n_f32(vld1q_f32(buffer + i), gain));
+  scalar_scale(buffer + i, gain, n - i);
+}
+
+void neon_multiply(float *buffer, const float *gains, size_t n) noexcept
+{
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    vst1q_f32(buffer + i, vmulq_f32(vld1q_f32(buffer + i), vld1q_f32(gains + i)));
+  scalar_multiply(buffer + i, gains + i, n - i);
+}
+
+void neon_fill_ramp(float *destination, float start, float step, size_t n) noexcept
+{
+  const float initial[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+  float32x4_t index = vld1q_f32(initial);
+  const float32x4_t base = vdupq_n_f32(start);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    vst1q_f32(destination + i, vmlaq_n_f32(base, index, step));
+    index = vaddq_f32(index, vdupq_n_f32(4.0f));
+  }
+  for (; i < n; i++)
+    destination[i] = start + step * static_cast<float>(i);
+}
+
+void neon_fill_exponential_ramp(float *destination, float start, float ratio, size_t n) noexcept
+{
+  const float ratio2 = ratio * ratio;
+  const float initial[4] = {start, start * ratio, start * ratio2, start * ratio2 * ratio};
+  float32x4_t value = vld1q_f32(initial);
+  const float ratio4 = ratio2 * ratio2;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    vst1q_f32(destination + i, value);
+    value = vmulq_n_f32(value, ratio4);
+  }
+  scalar_fill_exponential_ramp(destination + i, vgetq_lane_f32(value, 0), ratio, n - i);
+}
+
+void neon_interpolate_linear(float *destination, const float *source, size_t stride, double position,
+                             double increment, size_t n) noexcept
+{
+  const float64x2_t start = vdupq_n_f64(position);
+  const double initial01[2] = {0.0, 1.0};
+  const double initial23[2] = {2.0, 3.0};
+  float64x2_t frame01 = vld1q_f64(initial01);
+  float64x2_t frame23 = vld1q_f64(initial23);
+  float a[4];
+  float b[4];
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    const float64x2_t p01 = vaddq_f64(start, vmulq_n_f64(frame01, increment));
+    const float64x2_t p23 = vaddq_f64(start, vmulq_n_f64(frame23, increment));
+    const uint64x2_t whole01 = vcvtq_u64_f64(p01);
+    const uint64x2_t whole23 = vcvtq_u64_f64(p23);
+    const float32x4_t fraction = vcombine_f32(vcvt_f32_f64(vsubq_f64(p01, vcvtq_f64_u64(whole01))),
+                                              vcvt_f32_f64(vsubq_f64(p23, vcvtq_f64_u64(whole23))));
+
+    const size_t index[4] = {vgetq_lane_u64(whole01, 0), vgetq_lane_u64(whole01, 1),
+                             vgetq_lane_u64(whole23, 0), vgetq_lane_u64(whole23, 1)};
+    for (int lane = 0; lane < 4; lane++)
+    {
+      a[lane] = source[index[lane] * stride];
+      b[lane] = source[(index[lane] + 1) * stride];
+    }
+    const float32x4_t va = vld1q_f32(a);
+    vst1q_f32(destination + i, vmlaq_f32(va, fraction, vsubq_f32(vld1q_f32(b), va)));
+
+    frame01 = vaddq_f64(frame01, vdupq_n_f64(4.0));
+    frame23 = vaddq_f64(frame23, vdupq_n_f64(4.0));
+  }
+  interpolate_linear_from(destination, source, stride, position, increment, i, n);
+}
+
+void neon_clamp(float *buffer, float minimum, float maximum, size_t n) noexcept
+{
+  const float32x4_t lo = vdupq_n_f32(minimum);
+  const float32x4_t hi = vdupq_n_f32(maximum);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    vst1q_f32(buffer + i, vminq_f32(vmaxq_f32(vld1q_f32(buffer + i), lo), hi));
+  scalar_clamp(buffer + i, minimum, maximum, n - i);
+}
+
+void neon_soft_clip(float *buffer, size_t n) noexcept
+{
+  const float32x4_t lo = vdupq_n_f32(-3.0f);
+  const float32x4_t hi = vdupq_n_f32(3.0f);
+  const float32x4_t c27 = vdupq_n_f32(27.0f);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    const float32x4_t x = vminq_f32(vmaxq_f32(vld1q_f32(buffer + i), lo), hi);
+    const float32x4_t x2 = vmulq_f32(x, x);
+    const float32x4_t numerator = vmulq_f32(x, vaddq_f32(c27, x2));
+    const float32x4_t denominator = vmlaq_n_f32(c27, x2, 9.0f);
+    vst1q_f32(buffer + i, vdivq_f32(numerator, denominator));
+  }
+  scalar_soft_clip(buffer + i, n - i);
+}
+
+void neon_interleave_stereo(float *destination, const float *left, const float *right, size_t frames) noexcept
+{
+  size_t i = 0;
+  for (; i + 4 <= frames; i += 4)
+  {
+    float32x4x2_t lr;
+    lr.val[0] = vld1q_f32(left + i);
+    lr.val[1] = vld1q_f32(right + i);
+    vst2q_f32(destination + 2 * i, lr);
+  }
+  scalar_interleave_stereo(destination + 2 * i, left + i, right + i, frames - i);
+}
+
+void neon_deinterleave_stereo(float *left, float *right, const float *source, size_t frames) noexcept
+{
+  size_t i = 0;
+  for (; i + 4 <= frames; i += 4)
+  {
+    const float32x4x2_t lr = vld2q_f32(source + 2 * i);
+    vst1q_f32(left + i, lr.val[0]);
+    vst1q_f32(right + i, lr.val[1]);
+  }
+  scalar_deinterleave_stereo(left + i, right + i, source + 2 * i, frames - i);
+}
+
+void neon_int16_to_float(float *destination, const int16_t *source, size_t n) noexcept
+{
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    const int16x8_t x = vld1q_s16(source + i);
+    vst1q_f32(destination + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), INT16_SCALE));
+    vst1q_f32(destination + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), INT16_SCALE));
+  }
+  scalar_int16_to_float(destination + i, source + i, n - i);
+}
+
+void neon_float_to_int16(int16_t *destination, const float *source, size_t n) noexcept
+{
+  const float32x4_t lo = vdupq_n_f32(-1.0f);
+  const float32x4_t hi = vdupq_n_f32(1.0f);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    const float32x4_t a = vmulq_n_f32(vminq_f32(vmaxq_f32(vld1q_f32(source + i), lo), hi), 32767.0f);
+    const float32x4_t b = vmulq_n_f32(vminq_f32(vmaxq_f32(vld1q_f32(source + i + 4), lo), hi), 32767.0f);
+    vst1q_s16(destination + i, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)), vqmovn_s32(vcvtnq_s32_f32(b))));
+  }
+  scalar_float_to_int16(destination + i, source + i, n - i);
+}
+
+void neon_int32_to_float(float *destination, const int32_t *source, size_t n) noexcept
+{
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    vst1q_f32(destination + i, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(source + i)), INT32_SCALE));
+  scalar_int32_to_float(destination + i, source + i, n - i);
+}
+
+float neon_dot(const float *a, const float *b, size_t n) noexcept
+{
+  float32x4_t sum0 = vdupq_n_f32(0.0f);
+  float32x4_t sum1 = vdupq_n_f32(0.0f);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    sum0 = vmlaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+    sum1 = vmlaq_f32(sum1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+  }
+  for (; i + 4 <= n; i += 4)
+    sum0 = vmlaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+
+  return vaddvq_f32(vaddq_f32(sum0, sum1)) + scalar_dot(a + i, b + i, n - i);
+}
+
+dsp::LevelSums neon_measure_levels(const float *source, size_t n) noexcept
+{
+  float32x4_t peak = vdupq_n_f32(0.0f);
+  float32x4_t energy0 = vdupq_n_f32(0.0f);
+  float32x4_t energy1 = vdupq_n_f32(0.0f);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    const float32x4_t a = vld1q_f32(source + i);
+    const float32x4_t b = vld1q_f32(source + i + 4);
+    peak = vmaxq_f32(peak, vmaxq_f32(vabsq_f32(a), vabsq_f32(b)));
+    energy0 = vmlaq_f32(energy0, a, a);
+    energy1 = vmlaq_f32(energy1, b, b);
+  }
+
+  const dsp::LevelSums tail = scalar_measure_levels(source + i, n - i);
+  return {std::max(vmaxvq_f32(peak), tail.peak), vaddvq_f32(vaddq_f32(energy0, energy1)) + tail.energy};
+}
+
+constexpr dsp::KernelTable NEON_KERNELS = {
+  dsp::eSimdLevel::NEON,
+  neon_add,
+  neon_add_with_gain,
+  neon_copy_with_gain,
+  neon_scale,
+  neon_multiply,
+  neon_fill_ramp,
+  neon_fill_exponential_ramp,
+  neon_interpolate_linear,
+  neon_clamp,
+  neon_soft_clip,
+  neon_interleave_stereo,
+  neon_deinterleave_stereo,
+  neon_int16_to_float,
+  neon_float_to_int16,
+  scalar_int24_to_float,
+  neon_int32_to_float,
+  scalar_float_to_int32,
+  neon_dot,
+  neon_measure_levels,
+};
+
+#endif // DSP_KERNELS_NEON
+
+const dsp::KernelTable *find_kernels(dsp::eSimdLevel level)
+{
+  switch (level)
+  {
+    case dsp::eSimdLevel::Scalar:
+      return &SCALAR_KERNELS;
+#if defined(DSP_KERNELS_X86)
+    case dsp::eSimdLevel::SSE2:
+      return &SSE2_KERNELS;
+    case dsp::eSimdLevel::AVX2:
+      return cpu_supports_avx2() ? &AVX2_KERNELS : nullptr;
+#endif
+#if defined(DSP_KERNELS_NEON)
+    case dsp::eSimdLevel::NEON:
+      return &NEON_KERNELS;
+#endif
+    default:
+      return nullptr;
+  }
+}
+
+/** @brief Select the best kernels before main() so the audio thread never pays for detection. */
+[[maybe_unused]] const bool kernels_selected = dsp::set_simd_level(dsp::get_best_simd_level());
+
+} // namespace
+
+namespace miniaudioengine::framework::dsp
+{
+
+namespace detail
+{
+std::atomic<const KernelTable *> active_kernels{&SCALAR_KERNELS};
+}
+
+eSimdLevel get_best_simd_level()
+{
+#if defined(DSP_KERNELS_X86)
+  return cpu_supports_avx2() ? eSimdLevel::AVX2 : eSimdLevel::SSE2;
+#elif defined(DSP_KERNELS_NEON)
+  return eSimdLevel::NEON;
+#else
+  return eSimdLevel::Scalar;
+#endif
+}
+
+bool set_simd_level(eSimdLevel level)
+{
+  const KernelTable *kernels = find_kernels(level);
+  if (kernels == nullptr)
+  {
+    return false;
+  }
+
+  detail::active_kernels.store(kernels, std::memory_order_relaxed);
+  return true;
+}
+
+std::string to_string(eSimdLevel level)
+{
+  switch (level)
+  {
+    case eSimdLevel::Scalar:
+      return "Scalar";
+    case eSimdLevel::SSE2:
+      return "SSE2";
+    case eSimdLevel::AVX2:
+      return "AVX2";
+    case eSimdLevel::NEON:
+      return "NEON";
+    default:
+      return "Unknown";
+  }
+}
+
+void interleave(float *destination, const float *source, size_t stride, unsigned int channels, size_t frames) noexcept
+{
+  if (channels == 2)
+  {
+    interleave_stereo(destination, source, source + stride, frames);
+    return;
+  }
+
+  for (unsigned int channel = 0; channel < channels; channel++)
+  {
+    const float *planar = source + channel * stride;
+    for (size_t frame = 0; frame < frames; frame++)
+    {
+      destination[frame * channels + channel] = planar[frame];
+    }
+  }
+}
+
+void deinterleave(float *destination, size_t stride, const float *source, unsigned int channels, size_t frames) noexcept
+{
+  if (channels == 2)
+  {
+    deinterleave_stereo(destination, destination + stride, source, frames);
+    return;
+  }
+
+  for (unsigned int channel = 0; channel < channels; channel++)
+  {
+    float *planar = destination + channel * stride;
+    for (size_t frame = 0; frame < frames; frame++)
+    {
+      planar[frame] = source[frame * channels + channel];
+    }
+  }
+}
+
+} // namespace miniaudioengine::framework::dsp
@@ -1,4 +1,12 @@
 #include "logger.h"
+#include "ringbuffer.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+
+using namespace miniaudioengine::framework;
 
 // Single per-thread instance for the whole program
 thread_local std::string thread_name = "unnamed";
@@ -11,4 +19,191 @@ void miniaudioengine::framework::set_thread_name(const std::string &name)
 const std::string &miniaudioengine::framework::get_thread_name()
 {
   return thread_name;
-}
\ No newline at end of file
+}
+
+namespace
+{
+
+constexpr size_t REALTIME_THREADS = 16;
+constexpr size_t REALTIME_RING_SIZE = 256;
+constexpr size_t THREAD_NAME_SIZE = 32;
+constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(10);
+
+/** @struct RealtimeRing
+ *  @brief Records of one realtime thread. Preallocated so claiming a ring never allocates.
+ */
+struct RealtimeRing
+{
+  enum eOwner : int
+  {
+    Free,
+    Owned,
+    Released // The thread exited, free the ring once it has been drained
+  };
+
+  std::atomic<int> owner{Free};
+  char thread_name[THREAD_NAME_SIZE]{};
+  RingBuffer<LogRecord> records{REALTIME_RING_SIZE};
+};
+
+} // namespace
+
+struct Logger::RealtimeState
+{
+  std::array<RealtimeRing, REALTIME_THREADS> rings;
+  std::atomic<unsigned long long> dropped_count{0};
+  unsigned long long reported_dropped_count{0};
+
+  std::mutex flush_mutex;
+  std::mutex wake_mutex;
+  std::condition_variable_any wake;
+  std::jthread flush_thread;
+};
+
+namespace
+{
+
+/** @brief Hands the ring back when its thread exits. */
+struct RealtimeRingHandle
+{
+  RealtimeRing *p_ring{nullptr};
+
+  ~RealtimeRingHandle()
+  {
+    if (p_ring != nullptr)
+    {
+      p_ring->owner.store(RealtimeRing::Released, std::memory_order_release);
+    }
+  }
+};
+
+thread_local RealtimeRingHandle realtime_ring;
+
+std::string format_record(const LogRecord &record)
+{
+  std::ostringstream stream;
+  stream << record.format;
+  for (unsigned char i = 0; i < record.argument_count; i++)
+  {
+    const LogArgument &argument = record.arguments[i];
+    switch (argument.type)
+    {
+    case LogArgument::eType::Signed:
+      stream << argument.signed_value;
+      break;
+    case LogArgument::eType::Unsigned:
+      stream << argument.unsigned_value;
+      break;
+    case LogArgument::eType::Float:
+      stream << argument.float_value;
+      break;
+    case LogArgument::eType::Bool:
+      stream << (argument.bool_value ? "true" : "false");
+      break;
+    case LogArgument::eType::Text:
+      stream << (argument.text != nullptr ? argument.text : "(null)");
+      break;
+    case LogArgument::eType::Pointer:
+      stream << argument.pointer;
+      break;
+    }
+  }
+  return stream.str();
+}
+
+} // namespace
+
+Logger::Logger() :
+  p_realtime(std::make_unique<RealtimeState>())
+{
+  p_realtime->flush_thread = std::jthread([this](std::stop_token stop_token) {
+    set_thread_name("Logger");
+    while (!stop_token.stop_requested())
+    {
+      {
+        std::unique_lock<std::mutex> lock(p_realtime->wake_mutex);
+        p_realtime->wake.wait_for(lock, stop_token, FLUSH_INTERVAL, [] { return false; });
+      }
+      flush_realtime();
+    }
+  });
+}
+
+Logger::~Logger()
+{
+  p_realtime->flush_thread.request_stop();
+  p_realtime->flush_thread.join();
+  flush_realtime();
+}
+
+void Logger::push_record(const LogRecord &record) noexcept
+{
+  RealtimeRing *ring = realtime_ring.p_ring;
+  if (ring == nullptr)
+  {
+    // First record from this thread, claim a free ring
+    for (RealtimeRing &candidate : p_realtime->rings)
+    {
+      int expected = RealtimeRing::Free;
+      if (candidate.owner.compare_exchange_strong(expected, RealtimeRing::Owned, std::memory_order_acq_rel))
+      {
+        std::strncpy(candidate.thread_name, get_thread_name().c_str(), THREAD_NAME_SIZE - 1);
+        candidate.thread_name[THREAD_NAME_SIZE - 1] = '\0';
+        ring = &candidate;
+        realtime_ring.p_ring = ring;
+        break;
+      }
+    }
+  }
+
+  if (ring == nullptr || !ring->records.try_push(record))
+  {
+    p_realtime->dropped_count.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void Logger::flush_realtime()
+{
+  std::lock_guard<std::mutex> lock(p_realtime->flush_mutex);
+
+  // Map the records' steady timestamps onto the wall clock
+  const auto system_now = std::chrono::system_clock::now();
+  const long long steady_now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::steady_clock::now().time_since_epoch()).count();
+
+  LogRecord record;
+  for (RealtimeRing &ring : p_realtime->rings)
+  {
+    const int owner = ring.owner.load(std::memory_order_acquire);
+    if (owner == RealtimeRing::Free)
+    {
+      continue;
+    }
+
+    const std::string name = ring.thread_name;
+    while (ring.records.try_pop(record))
+    {
+      const auto age = std::chrono::nanoseconds(steady_now - record.timestamp_ns);
+      write(record.level, system_now - std::chrono::duration_cast<std::chrono::system_clock::duration>(age),
+            name, format_record(record));
+    }
+
+    if (owner == RealtimeRing::Released)
+    {
+      ring.owner.store(RealtimeRing::Free, std::memory_order_release);
+    }
+  }
+
+  const unsigned long long dropped = p_realtime->dropped_count.load(std::memory_order_relaxed);
+  if (dropped > p_realtime->reported_dropped_count)
+  {
+    write(eLogLevel::Warning, system_now, get_thread_name(),
+          "Logger: Dropped " + std::to_string(dropped - p_realtime->reported_dropped_count) + " realtime log record(s).");
+    p_realtime->reported_dropped_count = dropped;
+  }
+}
+
+unsigned long long Logger::get_dropped_record_count() const
+{
+  return p_realtime->dropped_count.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,285 @@
+#include "meter.h"
+#include "dspkernels.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace miniaudioengine::framework;
+
+namespace
+{
+
+constexpr double PI = 3.14159265358979323846;
+
+/** @brief Loudness of a mean square, in LUFS (ITU-R BS.1770). */
+float to_lufs(double mean_square)
+{
+  return mean_square > 0.0 ? static_cast<float>(-0.691 + 10.0 * std::log10(mean_square))
+                           : -std::numeric_limits<float>::infinity();
+}
+
+} // namespace
+
+std::string MeterConfig::to_string() const
+{
+  return "MeterConfig(TruePeak=" + std::string(true_peak ? "true" : "false") +
+         ", Loudness=" + std::string(loudness ? "true" : "false") +
+         ", RefreshRate=" + std::to_string(refresh_rate) + ")";
+}
+
+std::string MeterReading::to_string() const
+{
+  std::string str = "MeterReading(Channels=" + std::to_string(channels);
+  for (unsigned int channel = 0; channel < channels && channel < MAX_CHANNELS; channel++)
+  {
+    str += ", Peak" + std::to_string(channel) + "=" + std::to_string(to_decibels(peak[channel])) + " dB";
+    str += ", Rms" + std::to_string(channel) + "=" + std::to_string(to_decibels(rms[channel])) + " dB";
+  }
+  str += ", Momentary=" + std::to_string(momentary_lufs) + " LUFS";
+  str += ", ShortTerm=" + std::to_string(short_term_lufs) + " LUFS";
+  str += ", Frames=" + std::to_string(frames) + ")";
+  return str;
+}
+
+float miniaudioengine::framework::to_decibels(float level) noexcept
+{
+  return level > 0.0f ? 20.0f * std::log10(level) : -std::numeric_limits<float>::infinity();
+}
+
+MeterReading Meter::get_reading()
+{
+  std::lock_guard<std::mutex> lock(m_read_mutex);
+  return m_snapshot.read();
+}
+
+bool MeterTap::prepare(const MeterPtr &meter, unsigned int channels, unsigned int sample_rate)
+{
+  if (!meter || channels == 0 || sample_rate == 0)
+  {
+    LOG_ERROR("MeterTap: prepare - Invalid meter format. Channels=", channels, ", SampleRate=", sample_rate);
+    return false;
+  }
+  if (channels > MeterReading::MAX_CHANNELS)
+  {
+    LOG_WARNING("MeterTap: prepare - Metering the first ", MeterReading::MAX_CHANNELS, " of ", channels, " channels");
+  }
+
+  p_meter = meter;
+  m_config = meter->get_config();
+  m_channels = std::min(channels, MeterReading::MAX_CHANNELS);
+  m_publish_interval = std::max(1u, sample_rate / std::max(1u, m_config.refresh_rate));
+  m_publish_position = 0;
+  m_frames = 0;
+  m_state.fill(ChannelState());
+
+  // K-weighting: a +4 dB high shelf for the head, then a 38 Hz high-pass, derived for any sample rate
+  {
+    const double k = std::tan(PI * 1681.974450955533 / sample_rate);
+    const double q = 0.7071752369554196;
+    const double vh = std::pow(10.0, 3.999843853973347 / 20.0);
+    const double vb = std::pow(vh, 0.4996667741545416);
+    const double a0 = 1.0 + k / q + k * k;
+    m_shelf.b0 = static_cast<float>((vh + vb * k / q + k * k) / a0);
+    m_shelf.b1 = static_cast<float>(2.0 * (k * k - vh) / a0);
+    m_shelf.b2 = static_cast<float>((vh - vb * k / q + k * k) / a0);
+    m_shelf.a1 = static_cast<float>(2.0 * (k * k - 1.0) / a0);
+    m_shelf.a2 = static_cast<float>((1.0 - k / q + k * k) / a0);
+  }
+  {
+    const double k = std::tan(PI * 38.13547087602444 / sample_rate);
+    const double q = 0.5003270373238773;
+    const double a0 = 1.0 + k / q + k * k;
+    m_highpass.b0 = 1.0f;
+    m_highpass.b1 = -2.0f;
+    m_highpass.b2 = 1.0f;
+    m_highpass.a1 = static_cast<float>(2.0 * (k * k - 1.0) / a0);
+    m_highpass.a2 = static_cast<float>((1.0 - k / q + k * k) / a0);
+  }
+
+  // Hann-windowed sinc interpolator, each phase normalised to unity gain at DC
+  constexpr unsigned int length = TRUE_PEAK_TAPS * TRUE_PEAK_PHASES;
+  for (unsigned int phase = 0; phase < TRUE_PEAK_PHASES; phase++)
+  {
+    double sum = 0.0;
+    std::array<double, TRUE_PEAK_TAPS> taps{};
+    for (unsigned int tap = 0; tap < TRUE_PEAK_TAPS; tap++)
+    {
+      const unsigned int n = tap * TRUE_PEAK_PHASES + phase;
+      const double t = (static_cast<double>(n) - (length - 1) / 2.0) / TRUE_PEAK_PHASES;
+      const double sinc = t == 0.0 ? 1.0 : std::sin(PI * t) / (PI * t);
+      const double window = 0.5 - 0.5 * std::cos(2.0 * PI * (n + 0.5) / length);
+      taps[tap] = sinc * window;
+      sum += taps[tap];
+    }
+    for (unsigned int tap = 0; tap < TRUE_PEAK_TAPS; tap++)
+    {
+      m_interpolator[phase][tap] = static_cast<float>(taps[tap] / sum);
+    }
+  }
+
+  m_loudness_block_frames = std::max(1u, sample_rate / 10);
+  m_loudness_position = 0;
+  m_loudness_energy = 0.0;
+  m_loudness_blocks.fill(0.0);
+  m_loudness_next = 0;
+  m_loudness_count = 0;
+  return true;
+}
+
+void MeterTap::process(float *const *channels, unsigned int n_frames) noexcept
+{
+  if (p_meter == nullptr)
+  {
+    return;
+  }
+
+  // Split the block where a refresh interval or a 100 ms loudness block ends
+  unsigned int offset = 0;
+  while (offset < n_frames)
+  {
+    unsigned int frames = std::min(n_frames - offset, m_publish_interval - m_publish_position);
+    if (m_config.loudness)
+    {
+      frames = std::min(frames, m_loudness_block_frames - m_loudness_position);
+    }
+
+    for (unsigned int channel = 0; channel < m_channels; channel++)
+    {
+      const float *source = channels[channel] + offset;
+      const dsp::LevelSums sums = dsp::measure_levels(source, frames);
+      ChannelState &state = m_state[channel];
+      state.peak = std::max(state.peak, sums.peak);
+      state.energy += sums.energy;
+
+      if (m_config.loudness)
+      {
+        measure_loudness(channel, source, frames);
+      }
+      if (m_config.true_peak)
+      {
+        measure_true_peak(channel, source, frames);
+      }
+    }
+
+    offset += frames;
+    m_frames += frames;
+
+    if (m_config.loudness && (m_loudness_position += frames) == m_loudness_block_frames)
+    {
+      m_loudness_blocks[m_loudness_next] = m_loudness_energy;
+      m_loudness_next = (m_loudness_next + 1) % SHORT_TERM_BLOCKS;
+      m_loudness_count = std::min(m_loudness_count + 1, SHORT_TERM_BLOCKS);
+      m_loudness_energy = 0.0;
+      m_loudness_position = 0;
+    }
+
+    if ((m_publish_position += frames) == m_publish_interval)
+    {
+      publish();
+      m_publish_position = 0;
+    }
+  }
+}
+
+/** @brief Add one channel's K-weighted energy to the current 100 ms block. */
+void MeterTap::measure_loudness(unsigned int channel, const float *source, unsigned int n_frames) noexcept
+{
+  ChannelState &state = m_state[channel];
+  const Biquad shelf = m_shelf;
+  const Biquad highpass = m_highpass;
+  float shelf_z1 = state.shelf_z1, shelf_z2 = state.shelf_z2;
+  float highpass_z1 = state.highpass_z1, highpass_z2 = state.highpass_z2;
+  float weighted_energy = 0.0f;
+
+  for (unsigned int frame = 0; frame < n_frames; frame++)
+  {
+    const float x = source[frame];
+    const float shelved = shelf.b0 * x + shelf_z1;
+    shelf_z1 = shelf.b1 * x - shelf.a1 * shelved + shelf_z2;
+    shelf_z2 = shelf.b2 * x - shelf.a2 * shelved;
+
+    const float weighted = highpass.b0 * shelved + highpass_z1;
+    highpass_z1 = highpass.b1 * shelved - highpass.a1 * weighted + highpass_z2;
+    highpass_z2 = highpass.b2 * shelved - highpass.a2 * weighted;
+    weighted_energy += weighted * weighted;
+  }
+
+  state.shelf_z1 = shelf_z1;
+  state.shelf_z2 = shelf_z2;
+  state.highpass_z1 = highpass_z1;
+  state.highpass_z2 = highpass_z2;
+  m_loudness_energy += weighted_energy;
+}
+
+/** @brief Track one channel's largest interpolated magnitude.
+ *  Works on chunks placed after the channel's last TRUE_PEAK_TAPS - 1 samples, so every phase is a
+ *  short FIR over a contiguous window, accumulated one tap at a time with the SIMD mixing kernels.
+ */
+void MeterTap::measure_true_peak(unsigned int channel, const float *source, unsigned int n_frames) noexcept
+{
+  constexpr unsigned int history_size = TRUE_PEAK_TAPS - 1;
+  const dsp::KernelTable &kernels = dsp::get_kernels();
+  ChannelState &state = m_state[channel];
+  float *window = m_true_peak_window.data();
+  float *interpolated = m_true_peak_window.data() + history_size + TRUE_PEAK_CHUNK;
+  float true_peak = state.true_peak;
+
+  for (unsigned int offset = 0; offset < n_frames; offset += TRUE_PEAK_CHUNK)
+  {
+    const unsigned int frames = std::min(TRUE_PEAK_CHUNK, n_frames - offset);
+    std::copy_n(state.history.data(), history_size, window);
+    std::copy_n(source + offset, frames, window + history_size);
+
+    for (unsigned int phase = 0; phase < TRUE_PEAK_PHASES; phase++)
+    {
+      const float *coefficients = m_interpolator[phase].data();
+      kernels.copy_with_gain(interpolated, window + history_size, coefficients[0], frames);
+      for (unsigned int tap = 1; tap < TRUE_PEAK_TAPS; tap++)
+      {
+        kernels.add_with_gain(interpolated, window + history_size - tap, coefficients[tap], frames);
+      }
+      true_peak = std::max(true_peak, kernels.measure_levels(interpolated, frames).peak);
+    }
+
+    std::copy_n(window + frames, history_size, state.history.data());
+  }
+
+  state.true_peak = true_peak;
+}
+
+void MeterTap::publish() noexcept
+{
+  MeterReading &reading = p_meter->get_snapshot().get_write_buffer();
+  reading.channels = m_channels;
+  for (unsigned int channel = 0; channel < MeterReading::MAX_CHANNELS; channel++)
+  {
+    ChannelState &state = m_state[channel];
+    reading.peak[channel] = state.peak;
+    reading.rms[channel] = static_cast<float>(std::sqrt(state.energy / m_publish_interval));
+    reading.true_peak[channel] = m_config.true_peak ? std::max(state.true_peak, state.peak) : 0.0f;
+    state.peak = 0.0f;
+    state.energy = 0.0;
+    state.true_peak = 0.0f;
+  }
+
+  reading.momentary_lufs = -std::numeric_limits<float>::infinity();
+  reading.short_term_lufs = -std::numeric_limits<float>::infinity();
+  if (m_config.loudness && m_loudness_count > 0)
+  {
+    double momentary = 0.0;
+    double short_term = 0.0;
+    for (unsigned int block = 0; block < m_loudness_count; block++)
+    {
+      const double energy = m_loudness_blocks[(m_loudness_next + SHORT_TERM_BLOCKS - 1 - block) % SHORT_TERM_BLOCKS];
+      momentary += block < MOMENTARY_BLOCKS ? energy : 0.0;
+      short_term += energy;
+    }
+    const double block_frames = m_loudness_block_frames;
+    reading.momentary_lufs = to_lufs(momentary / (std::min(m_loudness_count, MOMENTARY_BLOCKS) * block_frames));
+    reading.short_term_lufs = to_lufs(short_term / (m_loudness_count * block_frames));
+  }
+
+  reading.frames = m_frames;
+  p_meter->get_snapshot().publish();
+}
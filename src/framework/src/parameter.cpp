@@ -0,0 +1,280 @@
+#include "parameter.h"
+#include "dspkernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace miniaudioengine::framework;
+
+namespace
+{
+
+/** @brief Returns true if an exponential curve can join two values: both non-zero and of one sign. */
+bool can_ramp_exponentially(float from, float to) noexcept
+{
+  return from != 0.0f && to != 0.0f && (from > 0.0f) == (to > 0.0f);
+}
+
+} // namespace
+
+AutomationLane::AutomationLane(std::vector<AutomationPoint> points) : m_points(std::move(points))
+{
+  std::stable_sort(m_points.begin(), m_points.end(),
+                   [](const AutomationPoint &a, const AutomationPoint &b) { return a.frame < b.frame; });
+}
+
+size_t AutomationLane::find(uint64_t frame) const noexcept
+{
+  auto after = std::upper_bound(m_points.begin(), m_points.end(), frame,
+                                [](uint64_t value, const AutomationPoint &point) { return value < point.frame; });
+  return after == m_points.begin() ? 0 : static_cast<size_t>(after - m_points.begin()) - 1;
+}
+
+AutomationLane::Segment AutomationLane::get_segment(size_t index, uint64_t frame) const noexcept
+{
+  Segment segment;
+  if (m_points.empty())
+  {
+    return segment;
+  }
+
+  const AutomationPoint &point = m_points[index];
+  segment.start = point.value;
+
+  // Before the first point, hold its value until it is reached
+  if (frame < point.frame)
+  {
+    segment.end_frame = point.frame;
+    return segment;
+  }
+
+  if (index + 1 >= m_points.size())
+  {
+    return segment;
+  }
+
+  const AutomationPoint &next = m_points[index + 1];
+  segment.end_frame = next.frame;
+  if (point.curve == eAutomationCurve::Step || next.frame == point.frame)
+  {
+    return segment;
+  }
+
+  const double length = static_cast<double>(next.frame - point.frame);
+  const double elapsed = static_cast<double>(frame - point.frame);
+  if (point.curve == eAutomationCurve::Exponential && can_ramp_exponentially(point.value, next.value))
+  {
+    const double ratio = std::pow(static_cast<double>(next.value) / point.value, 1.0 / length);
+    segment.curve = eAutomationCurve::Exponential;
+    segment.increment = static_cast<float>(ratio);
+    segment.start = static_cast<float>(point.value * std::pow(ratio, elapsed));
+  }
+  else
+  {
+    const double step = (static_cast<double>(next.value) - point.value) / length;
+    segment.curve = eAutomationCurve::Linear;
+    segment.increment = static_cast<float>(step);
+    segment.start = static_cast<float>(point.value + step * elapsed);
+  }
+  return segment;
+}
+
+float AutomationLane::evaluate(uint64_t frame) const noexcept
+{
+  return get_segment(find(frame), frame).start;
+}
+
+Parameter::Parameter(std::string name, float minimum, float maximum, float default_value,
+                     eParameterSmoothing smoothing, double smoothing_seconds) :
+  m_name(std::move(name)),
+  m_minimum(std::min(minimum, maximum)),
+  m_maximum(std::max(minimum, maximum)),
+  m_default_value(std::clamp(default_value, m_minimum, m_maximum)),
+  m_smoothing(smoothing),
+  m_smoothing_seconds(std::max(smoothing_seconds, 0.0)),
+  m_target(m_default_value),
+  m_reported(m_default_value),
+  m_current(m_default_value),
+  m_ramp_target(m_default_value)
+{}
+
+void Parameter::set_value(float value) noexcept
+{
+  // NaN would never compare equal to the ramp target, keep the old target instead
+  if (std::isnan(value))
+  {
+    return;
+  }
+  m_target.store(std::clamp(value, m_minimum, m_maximum), std::memory_order_relaxed);
+}
+
+void Parameter::set_normalized(float normalized) noexcept
+{
+  set_value(m_minimum + std::clamp(normalized, 0.0f, 1.0f) * (m_maximum - m_minimum));
+}
+
+float Parameter::get_normalized() const noexcept
+{
+  return m_maximum > m_minimum ? (get_value() - m_minimum) / (m_maximum - m_minimum) : 0.0f;
+}
+
+void Parameter::set_automation(const std::vector<AutomationPoint> &points)
+{
+  if (points.empty())
+  {
+    clear_automation();
+    return;
+  }
+
+  std::vector<AutomationPoint> clamped = points;
+  for (AutomationPoint &point : clamped)
+  {
+    point.value = std::clamp(point.value, m_minimum, m_maximum);
+  }
+  m_automation.publish(std::make_unique<AutomationLane>(std::move(clamped)));
+}
+
+void Parameter::clear_automation()
+{
+  m_automation.publish(nullptr);
+}
+
+void Parameter::prepare(unsigned int sample_rate, unsigned int max_block)
+{
+  m_values.assign(std::max(max_block, 1u), m_current);
+  m_smoothing_frames = static_cast<unsigned int>(std::lround(m_smoothing_seconds * sample_rate));
+  m_ramp_remaining = 0;
+  snap();
+}
+
+void Parameter::follow_target() noexcept
+{
+  const float target = m_target.load(std::memory_order_relaxed);
+  if (target == m_ramp_target)
+  {
+    return;
+  }
+
+  m_ramp_target = target;
+  if (m_smoothing == eParameterSmoothing::None || m_smoothing_frames == 0)
+  {
+    m_current = target;
+    m_ramp_remaining = 0;
+    return;
+  }
+
+  m_ramp_remaining = m_smoothing_frames;
+  m_exponential_ramp = m_smoothing == eParameterSmoothing::Exponential && can_ramp_exponentially(m_current, target);
+  m_increment = m_exponential_ramp
+                ? static_cast<float>(std::pow(static_cast<double>(target) / m_current, 1.0 / m_smoothing_frames))
+                : (target - m_current) / static_cast<float>(m_smoothing_frames);
+}
+
+const float *Parameter::process(unsigned int frames) noexcept
+{
+  frames = std::min<unsigned int>(frames, static_cast<unsigned int>(m_values.size()));
+  if (frames == 0)
+  {
+    return m_values.data();
+  }
+  follow_target();
+
+  unsigned int ramped = 0;
+  if (m_ramp_remaining > 0)
+  {
+    ramped = std::min(frames, m_ramp_remaining);
+    if (m_exponential_ramp)
+    {
+      dsp::fill_exponential_ramp(m_values.data(), m_current * m_increment, m_increment, ramped);
+    }
+    else
+    {
+      dsp::fill_ramp(m_values.data(), m_current + m_increment, m_increment, ramped);
+    }
+
+    // Land exactly on the target, whatever rounding the ramp collected
+    m_ramp_remaining -= ramped;
+    m_current = m_ramp_remaining == 0 ? m_ramp_target : m_values[ramped - 1];
+    if (m_ramp_remaining == 0)
+    {
+      m_values[ramped - 1] = m_current;
+    }
+  }
+
+  std::fill(m_values.begin() + ramped, m_values.begin() + frames, m_current);
+  m_reported.store(m_current, std::memory_order_relaxed);
+  return m_values.data();
+}
+
+const float *Parameter::process(unsigned int frames, uint64_t timeline_frame) noexcept
+{
+  auto lane = m_automation.read();
+  if (!lane || lane->empty())
+  {
+    return process(frames);
+  }
+
+  frames = std::min<unsigned int>(frames, static_cast<unsigned int>(m_values.size()));
+  unsigned int offset = 0;
+  while (offset < frames)
+  {
+    const uint64_t frame = timeline_frame + offset;
+    const AutomationLane::Segment segment = lane->get_segment(m_cursor.seek(*lane, frame), frame);
+    const unsigned int count = static_cast<unsigned int>(std::min<uint64_t>(frames - offset, segment.end_frame - frame));
+    float *values = m_values.data() + offset;
+    switch (segment.curve)
+    {
+      case eAutomationCurve::Linear:
+        dsp::fill_ramp(values, segment.start, segment.increment, count);
+        break;
+      case eAutomationCurve::Exponential:
+        dsp::fill_exponential_ramp(values, segment.start, segment.increment, count);
+        break;
+      default:
+        std::fill_n(values, count, segment.start);
+        break;
+    }
+    offset += count;
+  }
+
+  // Once the lane is cleared, ramp from where it left off to the target
+  m_current = frames > 0 ? m_values[frames - 1] : m_current;
+  m_ramp_target = std::numeric_limits<float>::quiet_NaN();
+  m_ramp_remaining = 0;
+  m_reported.store(m_current, std::memory_order_relaxed);
+  return m_values.data();
+}
+
+float Parameter::process_block(unsigned int frames) noexcept
+{
+  follow_target();
+  if (m_ramp_remaining > 0)
+  {
+    const unsigned int ramped = std::min(frames, m_ramp_remaining);
+    m_ramp_remaining -= ramped;
+    if (m_ramp_remaining == 0)
+    {
+      m_current = m_ramp_target;
+    }
+    else if (m_exponential_ramp)
+    {
+      m_current *= static_cast<float>(std::pow(static_cast<double>(m_increment), ramped));
+    }
+    else
+    {
+      m_current += m_increment * static_cast<float>(ramped);
+    }
+  }
+
+  m_reported.store(m_current, std::memory_order_relaxed);
+  return m_current;
+}
+
+void Parameter::snap() noexcept
+{
+  m_current = m_target.load(std::memory_order_relaxed);
+  m_ramp_target = m_current;
+  m_ramp_remaining = 0;
+  m_cursor.reset();
+  m_reported.store(m_current, std::memory_order_relaxed);
+}
@@ -0,0 +1,163 @@
+#include "parameterregistry.h"
+#include "logger.h"
+
+#include <algorithm>
+
+using namespace miniaudioengine::framework;
+
+ParameterRegistry::ParameterRegistry() : p_controllers(std::make_unique<ControllerTable>())
+{
+  m_table.publish(std::make_unique<ControllerTable>());
+}
+
+ParameterPtr ParameterRegistry::add(const std::string &name, float minimum, float maximum, float default_value,
+                                    eParameterSmoothing smoothing, double smoothing_seconds)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (find_locked(name))
+  {
+    LOG_ERROR("ParameterRegistry: add - A parameter named ", name, " exists.");
+    return nullptr;
+  }
+
+  auto parameter = std::make_shared<Parameter>(name, minimum, maximum, default_value, smoothing, smoothing_seconds);
+  m_parameters.push_back(parameter);
+  return parameter;
+}
+
+ParameterPtr ParameterRegistry::get(const std::string &name) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return find_locked(name);
+}
+
+ParameterList ParameterRegistry::get_parameters() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_parameters;
+}
+
+bool ParameterRegistry::set_value(const std::string &name, float value)
+{
+  ParameterPtr parameter = get(name);
+  if (!parameter)
+  {
+    return false;
+  }
+  parameter->set_value(value);
+  return true;
+}
+
+bool ParameterRegistry::map_midi_controller(const std::string &name, unsigned int controller, unsigned int channel,
+                                            float minimum, float maximum)
+{
+  if (controller >= MIDI_CONTROLLERS || channel > ANY_CHANNEL)
+  {
+    LOG_ERROR("ParameterRegistry: map_midi_controller - Controller ", controller, " on channel ", channel, " is out of range.");
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  ParameterPtr parameter = find_locked(name);
+  if (!parameter)
+  {
+    LOG_ERROR("ParameterRegistry: map_midi_controller - No parameter named ", name);
+    return false;
+  }
+
+  p_controllers->mappings[get_slot(channel, controller)] = ControllerMapping{parameter.get(), minimum, maximum};
+  publish_locked();
+  return true;
+}
+
+bool ParameterRegistry::unmap_midi_controller(unsigned int controller, unsigned int channel)
+{
+  if (controller >= MIDI_CONTROLLERS || channel > ANY_CHANNEL)
+  {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  ControllerMapping &mapping = p_controllers->mappings[get_slot(channel, controller)];
+  if (mapping.parameter == nullptr)
+  {
+    return false;
+  }
+
+  mapping = ControllerMapping{};
+  publish_locked();
+  return true;
+}
+
+void ParameterRegistry::clear_midi_map()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  p_controllers->mappings.fill(ControllerMapping{});
+  publish_locked();
+}
+
+void ParameterRegistry::prepare(unsigned int sample_rate, unsigned int max_block)
+{
+  for (const ParameterPtr &parameter : get_parameters())
+  {
+    parameter->prepare(sample_rate, max_block);
+  }
+}
+
+void ParameterRegistry::snap()
+{
+  for (const ParameterPtr &parameter : get_parameters())
+  {
+    parameter->snap();
+  }
+}
+
+bool ParameterRegistry::handle_midi(const midi::MidiMessage &message) noexcept
+{
+  if (message.type != midi::eMidiMessageType::ControlChange || message.data1 >= MIDI_CONTROLLERS)
+  {
+    return false;
+  }
+
+  auto table = m_table.read();
+  const ControllerMapping *mapping = message.channel < MIDI_CHANNELS
+                                     ? &table->mappings[get_slot(message.channel, message.data1)]
+                                     : nullptr;
+  if (mapping == nullptr || mapping->parameter == nullptr)
+  {
+    mapping = &table->mappings[get_slot(ANY_CHANNEL, message.data1)];
+  }
+  if (mapping->parameter == nullptr)
+  {
+    return false;
+  }
+
+  const float position = static_cast<float>(std::min<unsigned int>(message.data2, 127)) / 127.0f;
+  mapping->parameter->set_normalized(mapping->minimum + position * (mapping->maximum - mapping->minimum));
+  return true;
+}
+
+size_t ParameterRegistry::handle_midi(const midi::MidiEventList &events) noexcept
+{
+  size_t applied = 0;
+  for (const midi::MidiEvent &event : events.get_events())
+  {
+    applied += handle_midi(event.message) ? 1 : 0;
+  }
+  return applied;
+}
+
+ParameterPtr ParameterRegistry::find_locked(const std::string &name) const
+{
+  auto found = std::find_if(m_parameters.begin(), m_parameters.end(),
+                            [&name](const ParameterPtr &parameter) { return parameter->get_name() == name; });
+  return found != m_parameters.end() ? *found : nullptr;
+}
+
+/** @brief Hand the audio thread a copy of the controller map.
+ *  @note Caller must hold m_mutex.
+ */
+void ParameterRegistry::publish_locked()
+{
+  m_table.publish(std::make_unique<ControllerTable>(*p_controllers));
+}
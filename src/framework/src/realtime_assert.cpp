@@ -0,0 +1,315 @@
+#include "realtime_assert.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define RT_ASSERT_HAS_TSC 1
+#endif
+
+#if defined(ENABLE_REALTIME_CHECKS) && defined(PLATFORM_LINUX)
+#include <dlfcn.h>
+#include <pthread.h>
+#endif
+
+using namespace miniaudioengine::framework;
+using namespace miniaudioengine::framework::realtime;
+
+namespace
+{
+
+struct ViolationSlot
+{
+  std::atomic<bool> ready{false};
+  Violation violation{};
+};
+
+std::array<ViolationSlot, MAX_VIOLATIONS> violations;
+std::atomic<size_t> violation_count{0};
+
+thread_local unsigned int allocation_depth = 0;
+thread_local unsigned int lock_depth = 0;
+thread_local const Scope *current_scope = nullptr;
+thread_local const char *current_file = nullptr;
+thread_local int current_line = 0;
+
+/** @brief Cycle counter used to time scopes. Falls back to steady_clock nanoseconds. */
+uint64_t read_ticks() noexcept
+{
+#if defined(RT_ASSERT_HAS_TSC)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  uint64_t ticks;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+  return ticks;
+#else
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+/** @brief Measure the counter's rate once, before any realtime scope can be entered. */
+[[maybe_unused]] double measure_ticks_per_us()
+{
+#if defined(RT_ASSERT_HAS_TSC)
+  const auto start_time = std::chrono::steady_clock::now();
+  const uint64_t start_ticks = read_ticks();
+  while (std::chrono::steady_clock::now() - start_time < std::chrono::milliseconds(2))
+  {
+  }
+  const uint64_t ticks = read_ticks() - start_ticks;
+  const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start_time).count();
+  return std::max(1.0, static_cast<double>(ticks) / us);
+#elif defined(__aarch64__)
+  uint64_t frequency;
+  asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+  return static_cast<double>(frequency) / 1e6;
+#else
+  return 1000.0;
+#endif
+}
+
+#ifdef ENABLE_REALTIME_CHECKS
+const double ticks_per_us = measure_ticks_per_us();
+#else
+const double ticks_per_us = 1.0;
+#endif
+
+} // namespace
+
+Scope::Scope(bool check_allocations, bool check_locks, uint64_t max_us, const char *file, int line) noexcept :
+  m_check_allocations(check_allocations),
+  m_check_locks(check_locks),
+  m_max_us(max_us),
+  m_start_ticks(max_us > 0 ? read_ticks() : 0),
+  m_file(file),
+  m_line(line),
+  p_parent(current_scope)
+{
+  allocation_depth += check_allocations ? 1 : 0;
+  lock_depth += check_locks ? 1 : 0;
+  current_scope = this;
+  current_file = m_file;
+  current_line = m_line;
+}
+
+Scope::~Scope()
+{
+  if (m_max_us > 0)
+  {
+    const uint64_t elapsed_us = static_cast<uint64_t>(static_cast<double>(read_ticks() - m_start_ticks) / ticks_per_us);
+    if (elapsed_us > m_max_us)
+    {
+      report_violation(eViolation::Deadline, elapsed_us);
+    }
+  }
+
+  allocation_depth -= m_check_allocations ? 1 : 0;
+  lock_depth -= m_check_locks ? 1 : 0;
+  current_scope = p_parent;
+  current_file = p_parent != nullptr ? p_parent->m_file : nullptr;
+  current_line = p_parent != nullptr ? p_parent->m_line : 0;
+}
+
+bool realtime::is_checking_allocations() noexcept
+{
+  return allocation_depth > 0;
+}
+
+bool realtime::is_checking_locks() noexcept
+{
+  return lock_depth > 0;
+}
+
+void realtime::report_violation(eViolation type, uint64_t detail) noexcept
+{
+  const size_t index = violation_count.fetch_add(1, std::memory_order_relaxed);
+  if (index >= MAX_VIOLATIONS)
+  {
+    return;
+  }
+
+  ViolationSlot &slot = violations[index];
+  slot.violation = {type, detail, current_file, current_line};
+  slot.ready.store(true, std::memory_order_release);
+}
+
+size_t miniaudioengine::framework::get_realtime_violation_count()
+{
+  return violation_count.load(std::memory_order_relaxed);
+}
+
+std::vector<Violation> miniaudioengine::framework::get_realtime_violations()
+{
+  const size_t count = std::min(violation_count.load(std::memory_order_acquire), MAX_VIOLATIONS);
+
+  std::vector<Violation> result;
+  result.reserve(count);
+  for (size_t i = 0; i < count; i++)
+  {
+    if (violations[i].ready.load(std::memory_order_acquire))
+    {
+      result.push_back(violations[i].violation);
+    }
+  }
+  return result;
+}
+
+void miniaudioengine::framework::clear_realtime_violations()
+{
+  for (ViolationSlot &slot : violations)
+  {
+    slot.ready.store(false, std::memory_order_relaxed);
+  }
+  violation_count.store(0, std::memory_order_release);
+}
+
+std::string miniaudioengine::framework::to_string(const Violation &violation)
+{
+  std::string str = "Violation(Type=";
+  switch (violation.type)
+  {
+    case eViolation::Allocation:
+      str += "Allocation, Bytes=" + std::to_string(violation.detail);
+      break;
+    case eViolation::Deallocation:
+      str += "Deallocation";
+      break;
+    case eViolation::Lock:
+      str += "Lock";
+      break;
+    case eViolation::Deadline:
+      str += "Deadline, Microseconds=" + std::to_string(violation.detail);
+      break;
+  }
+  str += ", Location=" + std::string(violation.file != nullptr ? violation.file : "unknown") + ":" + std::to_string(violation.line);
+  str += ")";
+  return str;
+}
+
+#ifdef ENABLE_REALTIME_CHECKS
+
+// -----------------------------------------------------------------------------
+// Interposed allocator. Replaces every global operator new and delete.
+// -----------------------------------------------------------------------------
+
+namespace
+{
+
+void *checked_allocate(size_t size, size_t alignment, bool nothrow)
+{
+  if (allocation_depth > 0)
+  {
+    report_violation(eViolation::Allocation, size);
+  }
+
+  size = std::max<size_t>(size, 1);
+  void *p = nullptr;
+  if (alignment <= alignof(std::max_align_t))
+  {
+    p = std::malloc(size);
+  }
+  else
+  {
+#ifdef _WIN32
+    p = _aligned_malloc(size, alignment);
+#else
+    p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+  }
+
+  if (p == nullptr && !nothrow)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void checked_free(void *p, size_t alignment) noexcept
+{
+  if (p == nullptr)
+  {
+    return;
+  }
+
+  if (allocation_depth > 0)
+  {
+    report_violation(eViolation::Deallocation, 0);
+  }
+
+#ifdef _WIN32
+  if (alignment > alignof(std::max_align_t))
+  {
+    _aligned_free(p);
+    return;
+  }
+#else
+  (void)alignment;
+#endif
+  std::free(p);
+}
+
+constexpr size_t DEFAULT_ALIGNMENT = alignof(std::max_align_t);
+
+} // namespace
+
+void *operator new(size_t size) { return checked_allocate(size, DEFAULT_ALIGNMENT, false); }
+void *operator new[](size_t size) { return checked_allocate(size, DEFAULT_ALIGNMENT, false); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return checked_allocate(size, DEFAULT_ALIGNMENT, true); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return checked_allocate(size, DEFAULT_ALIGNMENT, true); }
+void *operator new(size_t size, std::align_val_t alignment) { return checked_allocate(size, static_cast<size_t>(alignment), false); }
+void *operator new[](size_t size, std::align_val_t alignment) { return checked_allocate(size, static_cast<size_t>(alignment), false); }
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept { return checked_allocate(size, static_cast<size_t>(alignment), true); }
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept { return checked_allocate(size, static_cast<size_t>(alignment), true); }
+
+void operator delete(void *p) noexcept { checked_free(p, DEFAULT_ALIGNMENT); }
+void operator delete[](void *p) noexcept { checked_free(p, DEFAULT_ALIGNMENT); }
+void operator delete(void *p, size_t) noexcept { checked_free(p, DEFAULT_ALIGNMENT); }
+void operator delete[](void *p, size_t) noexcept { checked_free(p, DEFAULT_ALIGNMENT); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { checked_free(p, DEFAULT_ALIGNMENT); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { checked_free(p, DEFAULT_ALIGNMENT); }
+void operator delete(void *p, std::align_val_t alignment) noexcept { checked_free(p, static_cast<size_t>(alignment)); }
+void operator delete[](void *p, std::align_val_t alignment) noexcept { checked_free(p, static_cast<size_t>(alignment)); }
+void operator delete(void *p, size_t, std::align_val_t alignment) noexcept { checked_free(p, static_cast<size_t>(alignment)); }
+void operator delete[](void *p, size_t, std::align_val_t alignment) noexcept { checked_free(p, static_cast<size_t>(alignment)); }
+void operator delete(void *p, std::align_val_t alignment, const std::nothrow_t &) noexcept { checked_free(p, static_cast<size_t>(alignment)); }
+void operator delete[](void *p, std::align_val_t alignment, const std::nothrow_t &) noexcept { checked_free(p, static_cast<size_t>(alignment)); }
+
+#ifdef PLATFORM_LINUX
+
+// -----------------------------------------------------------------------------
+// Interposed pthread_mutex_lock, which std::mutex uses on Linux.
+// -----------------------------------------------------------------------------
+
+extern "C" int pthread_mutex_lock(pthread_mutex_t *mutex)
+{
+  using LockFunc = int (*)(pthread_mutex_t *);
+  static std::atomic<LockFunc> real_lock{nullptr};
+
+  LockFunc lock = real_lock.load(std::memory_order_acquire);
+  if (lock == nullptr)
+  {
+    lock = reinterpret_cast<LockFunc>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+    real_lock.store(lock, std::memory_order_release);
+  }
+
+  if (lock_depth > 0)
+  {
+    report_violation(eViolation::Lock, 0);
+  }
+
+  return lock(mutex);
+}
+
+#endif // PLATFORM_LINUX
+
+#endif // ENABLE_REALTIME_CHECKS
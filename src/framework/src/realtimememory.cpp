@@ -0,0 +1,501 @@
+#include "realtimememory.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#if defined(PLATFORM_LINUX)
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#elif defined(PLATFORM_WINDOWS)
+#include <windows.h>
+#endif
+
+using namespace miniaudioengine::framework;
+
+namespace
+{
+
+/** @brief Smallest block, and the alignment of every small block. */
+constexpr size_t MIN_BLOCK_BYTES = 64;
+
+/** @brief Largest block carved from a chunk. Larger buffers get pages of their own. */
+constexpr size_t MAX_SMALL_BYTES = 256 * 1024;
+
+constexpr size_t CHUNK_BYTES = 2 * 1024 * 1024;
+
+constexpr size_t SIZE_CLASSES = std::countr_zero(MAX_SMALL_BYTES / MIN_BLOCK_BYTES) + 1;
+
+size_t page_size() noexcept
+{
+#if defined(PLATFORM_LINUX)
+  static const size_t size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+#elif defined(PLATFORM_WINDOWS)
+  static const size_t size = []
+  {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return static_cast<size_t>(info.dwPageSize);
+  }();
+#else
+  static const size_t size = 4096;
+#endif
+  return size;
+}
+
+size_t round_up(size_t bytes, size_t multiple) noexcept
+{
+  return (bytes + multiple - 1) / multiple * multiple;
+}
+
+bool lock_pages(const void *data, size_t bytes) noexcept
+{
+#if defined(PLATFORM_LINUX)
+  return ::mlock(data, bytes) == 0;
+#elif defined(PLATFORM_WINDOWS)
+  // VirtualLock is capped by the minimum working set, so grow it by the region first
+  SIZE_T minimum = 0;
+  SIZE_T maximum = 0;
+  HANDLE process = GetCurrentProcess();
+  if (GetProcessWorkingSetSize(process, &minimum, &maximum))
+  {
+    SetProcessWorkingSetSize(process, minimum + bytes, std::max(maximum, minimum + bytes));
+  }
+  return VirtualLock(const_cast<void *>(data), bytes) != 0;
+#else
+  (void)data;
+  (void)bytes;
+  return false;
+#endif
+}
+
+void unlock_pages(const void *data, size_t bytes) noexcept
+{
+#if defined(PLATFORM_LINUX)
+  ::munlock(data, bytes);
+#elif defined(PLATFORM_WINDOWS)
+  VirtualUnlock(const_cast<void *>(data), bytes);
+#else
+  (void)data;
+  (void)bytes;
+#endif
+}
+
+/** @brief Returns true if mlockall() cannot run into RLIMIT_MEMLOCK, which would fail later allocations. */
+bool may_lock_process() noexcept
+{
+#if defined(PLATFORM_LINUX)
+  rlimit limit{};
+  return ::geteuid() == 0 || (::getrlimit(RLIMIT_MEMLOCK, &limit) == 0 && limit.rlim_cur == RLIM_INFINITY);
+#else
+  return false;
+#endif
+}
+
+bool lock_process() noexcept
+{
+#if defined(PLATFORM_LINUX)
+  return ::mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+#else
+  return false;
+#endif
+}
+
+void unlock_process() noexcept
+{
+#if defined(PLATFORM_LINUX)
+  ::munlockall();
+#endif
+}
+
+/** @struct Region
+ *  @brief Page-aligned memory owned by the pool: a chunk of small blocks or one large buffer.
+ */
+struct Region
+{
+  void *data{nullptr};
+  size_t bytes{0};
+  size_t alignment{0};
+  bool locked{false};
+  bool pinned{false}; // Locked for its whole life, whatever the mode
+};
+
+/** @class Pool
+ *  @brief The process-wide realtime memory pool behind the realtime_memory functions.
+ */
+class Pool
+{
+public:
+  void *allocate(size_t bytes, size_t alignment)
+  {
+    bool lock_failed = false;
+    void *block = nullptr;
+    size_t block_bytes = 0;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      const int size_class = get_size_class(bytes, alignment);
+      if (size_class >= 0)
+      {
+        block_bytes = MIN_BLOCK_BYTES << size_class;
+        block = pop_free_locked(static_cast<size_t>(size_class));
+        if (block == nullptr)
+        {
+          block = carve_locked(block_bytes, lock_failed);
+        }
+      }
+      else
+      {
+        Region region = allocate_region_locked(bytes, std::max(alignment, page_size()), lock_failed);
+        block = region.data;
+        block_bytes = region.bytes;
+        m_large.emplace(region.data, region);
+      }
+    }
+
+    if (lock_failed)
+    {
+      warn_lock_failed();
+    }
+
+    // Zeroing the whole block faults its pages in on this thread instead of the audio thread
+    std::memset(block, 0, block_bytes);
+    return block;
+  }
+
+  void *allocate_pinned(size_t bytes, size_t alignment, bool &locked)
+  {
+    Region region;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      bool lock_failed = false;
+      region = allocate_region_locked(bytes, std::max(alignment, page_size()), lock_failed);
+      region.pinned = true;
+      lock_region_locked(region);
+      m_large.emplace(region.data, region);
+    }
+
+    locked = region.locked;
+    std::memset(region.data, 0, region.bytes);
+    return region.data;
+  }
+
+  void deallocate(void *data, size_t bytes, size_t alignment) noexcept
+  {
+    if (data == nullptr)
+    {
+      return;
+    }
+
+    // Pinned buffers of any size have a region of their own, small blocks never start one
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_large.find(data);
+    if (it != m_large.end())
+    {
+      free_region_locked(it->second);
+      m_large.erase(it);
+      return;
+    }
+
+    const int size_class = get_size_class(bytes, alignment);
+    if (size_class >= 0)
+    {
+      push_free_locked(data, static_cast<size_t>(size_class));
+    }
+  }
+
+  bool enable()
+  {
+    bool all_locked = true;
+    bool process_locked = false;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_enabled.store(true, std::memory_order_relaxed);
+      if (!m_process_locked && may_lock_process())
+      {
+        m_process_locked = lock_process();
+      }
+      process_locked = m_process_locked;
+
+      for (Region &chunk : m_chunks)
+      {
+        all_locked = lock_region_locked(chunk) && all_locked;
+      }
+      for (auto &[data, region] : m_large)
+      {
+        all_locked = lock_region_locked(region) && all_locked;
+      }
+    }
+
+    if (!all_locked)
+    {
+      warn_lock_failed();
+    }
+    LOG_INFO("RealtimeMemory: Enabled, ", process_locked ? "process locked" : "pool locked region by region",
+             ". ", get_statistics().to_string());
+    return all_locked;
+  }
+
+  void disable()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_enabled.store(false, std::memory_order_relaxed);
+    for (Region &chunk : m_chunks)
+    {
+      unlock_region_locked(chunk);
+    }
+    for (auto &[data, region] : m_large)
+    {
+      if (!region.pinned)
+      {
+        unlock_region_locked(region);
+      }
+    }
+    if (m_process_locked)
+    {
+      unlock_process();
+      m_process_locked = false;
+    }
+    m_warned = false;
+  }
+
+  bool is_enabled() const noexcept { return m_enabled.load(std::memory_order_relaxed); }
+
+  RealtimeMemoryStatistics get_statistics()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    RealtimeMemoryStatistics statistics;
+    statistics.enabled = m_enabled.load(std::memory_order_relaxed);
+    statistics.process_locked = m_process_locked;
+
+    auto add = [&statistics](const Region &region)
+    {
+      statistics.pool_bytes += region.bytes;
+      if (region.locked)
+      {
+        statistics.locked_bytes += region.bytes;
+      }
+      else if (statistics.enabled)
+      {
+        statistics.failed_lock_bytes += region.bytes;
+      }
+    };
+    for (const Region &chunk : m_chunks)
+    {
+      add(chunk);
+    }
+    for (const auto &[data, region] : m_large)
+    {
+      add(region);
+    }
+    return statistics;
+  }
+
+private:
+  /** @brief Returns the free list of a small block, or -1 if the buffer needs a region of its own. */
+  static int get_size_class(size_t bytes, size_t alignment) noexcept
+  {
+    if (bytes > MAX_SMALL_BYTES || alignment > MIN_BLOCK_BYTES)
+    {
+      return -1;
+    }
+    const size_t block_bytes = std::bit_ceil(std::max(bytes, MIN_BLOCK_BYTES));
+    return std::countr_zero(block_bytes / MIN_BLOCK_BYTES);
+  }
+
+  void *pop_free_locked(size_t size_class) noexcept
+  {
+    void *block = m_free_lists[size_class];
+    if (block != nullptr)
+    {
+      std::memcpy(&m_free_lists[size_class], block, sizeof(void *));
+    }
+    return block;
+  }
+
+  void push_free_locked(void *block, size_t size_class) noexcept
+  {
+    // A free block stores the next free block of its size in its first bytes
+    std::memcpy(block, &m_free_lists[size_class], sizeof(void *));
+    m_free_lists[size_class] = block;
+  }
+
+  /** @brief Cut a small block from the newest chunk, starting a new chunk when it is full. */
+  void *carve_locked(size_t block_bytes, bool &lock_failed)
+  {
+    if (m_chunks.empty() || m_chunk_used + block_bytes > m_chunks.back().bytes)
+    {
+      // Hand the tail of the full chunk to the free lists, largest blocks first. Offsets stay 64-byte aligned
+      if (!m_chunks.empty())
+      {
+        char *chunk = static_cast<char *>(m_chunks.back().data);
+        for (size_t size_class = SIZE_CLASSES; size_class-- > 0;)
+        {
+          const size_t bytes = MIN_BLOCK_BYTES << size_class;
+          while (m_chunk_used + bytes <= m_chunks.back().bytes)
+          {
+            push_free_locked(chunk + m_chunk_used, size_class);
+            m_chunk_used += bytes;
+          }
+        }
+      }
+
+      m_chunks.push_back(allocate_region_locked(CHUNK_BYTES, page_size(), lock_failed));
+      m_chunk_used = 0;
+    }
+
+    void *block = static_cast<char *>(m_chunks.back().data) + m_chunk_used;
+    m_chunk_used += block_bytes;
+    return block;
+  }
+
+  Region allocate_region_locked(size_t bytes, size_t alignment, bool &lock_failed)
+  {
+    // Whole pages per region, so unlocking one never unlocks memory of another
+    Region region;
+    region.bytes = round_up(std::max<size_t>(bytes, 1), page_size());
+    region.alignment = alignment;
+    region.data = ::operator new(region.bytes, std::align_val_t{alignment});
+    if (m_enabled.load(std::memory_order_relaxed) && !lock_region_locked(region))
+    {
+      lock_failed = true;
+    }
+    return region;
+  }
+
+  void free_region_locked(Region &region) noexcept
+  {
+    unlock_region_locked(region);
+    ::operator delete(region.data, std::align_val_t{region.alignment});
+    region.data = nullptr;
+  }
+
+  bool lock_region_locked(Region &region) noexcept
+  {
+    if (!region.locked)
+    {
+      region.locked = lock_pages(region.data, region.bytes);
+    }
+    return region.locked;
+  }
+
+  void unlock_region_locked(Region &region) noexcept
+  {
+    if (region.locked)
+    {
+      unlock_pages(region.data, region.bytes);
+      region.locked = false;
+    }
+  }
+
+  /** @brief Warn once per enable() that the pool is only partly locked. Called without the mutex held. */
+  void warn_lock_failed()
+  {
+    if (!m_warned.exchange(true, std::memory_order_relaxed))
+    {
+      LOG_WARNING("RealtimeMemory: Failed to lock realtime buffers, pages may be swapped out. "
+                  "Raise RLIMIT_MEMLOCK to lock them all.");
+    }
+  }
+
+  std::mutex m_mutex;
+  std::atomic<bool> m_enabled{false};
+  std::atomic<bool> m_warned{false};
+  bool m_process_locked{false};
+  std::vector<Region> m_chunks;
+  size_t m_chunk_used{0}; // Bytes carved from the newest chunk
+  std::array<void *, SIZE_CLASSES> m_free_lists{};
+  std::map<void *, Region> m_large;
+};
+
+/** @brief The pool is never destroyed, so buffers in static objects can be freed during shutdown. */
+Pool &get_pool()
+{
+  static Pool *pool = new Pool();
+  return *pool;
+}
+
+} // namespace
+
+std::string RealtimeMemoryStatistics::to_string() const
+{
+  return "RealtimeMemoryStatistics(Enabled=" + std::string(enabled ? "true" : "false") +
+         ", ProcessLocked=" + std::string(process_locked ? "true" : "false") +
+         ", PoolBytes=" + std::to_string(pool_bytes) +
+         ", LockedBytes=" + std::to_string(locked_bytes) +
+         ", FailedLockBytes=" + std::to_string(failed_lock_bytes) + ")";
+}
+
+bool realtime_memory::enable()
+{
+  return get_pool().enable();
+}
+
+void realtime_memory::disable()
+{
+  get_pool().disable();
+}
+
+bool realtime_memory::is_enabled() noexcept
+{
+  return get_pool().is_enabled();
+}
+
+void *realtime_memory::allocate(size_t bytes, size_t alignment)
+{
+  return get_pool().allocate(bytes, alignment);
+}
+
+void *realtime_memory::allocate_pinned(size_t bytes, size_t alignment, bool &locked)
+{
+  return get_pool().allocate_pinned(bytes, alignment, locked);
+}
+
+void realtime_memory::deallocate(void *data, size_t bytes, size_t alignment) noexcept
+{
+  get_pool().deallocate(data, bytes, alignment);
+}
+
+RealtimeMemoryStatistics realtime_memory::get_statistics()
+{
+  return get_pool().get_statistics();
+}
+
+bool realtime_memory::lock(const void *data, size_t bytes) noexcept
+{
+  return bytes > 0 && lock_pages(data, bytes);
+}
+
+void realtime_memory::prefault(void *data, size_t bytes) noexcept
+{
+  if (bytes == 0)
+  {
+    return;
+  }
+
+  // Writing a byte back faults its page in writable, without changing the contents
+  volatile unsigned char *pages = static_cast<volatile unsigned char *>(data);
+  for (size_t offset = 0; offset < bytes; offset += page_size())
+  {
+    pages[offset] = pages[offset];
+  }
+  pages[bytes - 1] = pages[bytes - 1];
+}
+
+void realtime_memory::prefault_stack() noexcept
+{
+  // Volatile stores cannot be optimised away, so every page of the array is written
+  [[maybe_unused]] volatile unsigned char stack[STACK_PREFAULT_BYTES];
+  for (size_t offset = 0; offset < STACK_PREFAULT_BYTES; offset += page_size())
+  {
+    stack[offset] = 0;
+  }
+  stack[STACK_PREFAULT_BYTES - 1] = 0;
+}
@@ -0,0 +1,325 @@
+#include "resampler.h"
+#include "dspkernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+using namespace miniaudioengine::framework;
+
+namespace
+{
+
+/** @struct FilterDesign
+ *  @brief Filter parameters of one quality tier, before stretching for downsampling.
+ */
+struct FilterDesign
+{
+  size_t taps;
+  size_t phases;
+  bool interpolate;
+  double cutoff; // Fraction of the lower Nyquist frequency kept in the passband
+  double beta;   // Kaiser window shape, higher trades transition width for stopband attenuation
+};
+
+constexpr size_t MAX_TAPS = 512;
+
+/** @brief Frames converted per pass by Resampler::resample(). */
+constexpr size_t OFFLINE_BLOCK_FRAMES = 4096;
+
+/** @brief Denominator of an adaptive resampler's step, fine enough for a correction of 1e-9. */
+constexpr uint64_t ADAPTIVE_STEP_DENOMINATOR = uint64_t{1} << 32;
+
+/** @brief Largest read rate correction an adaptive resampler accepts, 1%. */
+constexpr double MAX_RATE_CORRECTION = 0.01;
+
+FilterDesign get_design(eResampleQuality quality)
+{
+  switch (quality)
+  {
+    case eResampleQuality::Fast:
+      return {8, 128, false, 0.85, 5.0};
+    case eResampleQuality::High:
+      return {64, 512, true, 0.95, 9.0};
+    case eResampleQuality::Balanced:
+    default:
+      return {32, 256, true, 0.91, 7.5};
+  }
+}
+
+/** @brief Zeroth-order modified Bessel function of the first kind, for the Kaiser window. */
+double bessel_i0(double x)
+{
+  double sum = 1.0;
+  double term = 1.0;
+  for (int k = 1; k < 64 && term > sum * 1e-12; k++)
+  {
+    const double factor = x / (2.0 * k);
+    term *= factor * factor;
+    sum += term;
+  }
+  return sum;
+}
+
+double sinc(double x)
+{
+  constexpr double pi = 3.14159265358979323846;
+  return x == 0.0 ? 1.0 : std::sin(pi * x) / (pi * x);
+}
+
+} // namespace
+
+std::string miniaudioengine::framework::to_string(eResampleQuality quality)
+{
+  switch (quality)
+  {
+    case eResampleQuality::Fast:
+      return "Fast";
+    case eResampleQuality::Balanced:
+      return "Balanced";
+    case eResampleQuality::High:
+      return "High";
+    default:
+      return "Unknown";
+  }
+}
+
+bool Resampler::prepare(unsigned int source_rate, unsigned int target_rate, unsigned int channels,
+                        size_t max_output_frames, eResampleQuality quality, double max_correction)
+{
+  if (source_rate == 0 || target_rate == 0 || channels == 0 || max_output_frames == 0)
+  {
+    return false;
+  }
+
+  const FilterDesign design = get_design(quality);
+  const double ratio = static_cast<double>(source_rate) / target_rate;
+  const double stretch = std::max(1.0, ratio);
+
+  m_source_rate = source_rate;
+  m_target_rate = target_rate;
+  m_channels = channels;
+  m_quality = quality;
+
+  // A longer filter keeps the transition band the same width relative to the lower rate.
+  // A multiple of four keeps the SIMD dot products free of scalar tails.
+  m_taps = std::min(MAX_TAPS, (static_cast<size_t>(std::ceil(design.taps * stretch)) + 3) & ~size_t{3});
+  m_phases = design.phases;
+  m_interpolate = design.interpolate;
+
+  const unsigned int divisor = std::gcd(source_rate, target_rate);
+  m_step_numerator = source_rate / divisor;
+  m_step_denominator = target_rate / divisor;
+  m_nominal_step = ratio;
+  m_max_correction = std::clamp(max_correction, 0.0, MAX_RATE_CORRECTION);
+  if (is_adaptive())
+  {
+    m_step_denominator = ADAPTIVE_STEP_DENOMINATOR;
+    m_step_numerator = static_cast<uint64_t>(std::llround(ratio * static_cast<double>(ADAPTIVE_STEP_DENOMINATOR)));
+  }
+
+  // Row p holds the filter for an output p / m_phases of a frame after the centre tap
+  const double cutoff = design.cutoff / stretch;
+  const double half_length = static_cast<double>(m_taps) / 2.0;
+  const double window_scale = 1.0 / bessel_i0(design.beta);
+  m_coefficients.assign((m_phases + 1) * m_taps, 0.0f);
+  std::vector<double> taps(m_taps);
+  for (size_t phase = 0; phase <= m_phases; phase++)
+  {
+    const double fraction = static_cast<double>(phase) / m_phases;
+    float *row = m_coefficients.data() + phase * m_taps;
+
+    double sum = 0.0;
+    for (size_t tap = 0; tap < m_taps; tap++)
+    {
+      const double x = static_cast<double>(tap) - (half_length - 1.0) - fraction;
+      const double u = x / half_length;
+      const double window = std::abs(u) <= 1.0 ? bessel_i0(design.beta * std::sqrt(1.0 - u * u)) * window_scale : 0.0;
+      taps[tap] = cutoff * sinc(cutoff * x) * window;
+      sum += taps[tap];
+    }
+
+    // Unity gain at DC for every phase, so a constant input stays constant
+    for (size_t tap = 0; tap < m_taps; tap++)
+    {
+      row[tap] = static_cast<float>(taps[tap] / sum);
+    }
+  }
+
+  // Enough input for the largest block at the fastest step, starting at any fractional position, plus one filter length
+  const uint64_t max_step = is_adaptive() ? static_cast<uint64_t>(std::ceil(ratio * (1.0 + m_max_correction) *
+                                                                            static_cast<double>(ADAPTIVE_STEP_DENOMINATOR)))
+                                          : m_step_numerator;
+  m_max_output_frames = max_output_frames;
+  m_max_input_frames = static_cast<size_t>(((m_step_denominator - 1) + (max_output_frames - 1) * max_step) /
+                                           m_step_denominator) + m_taps;
+  m_history_capacity = m_taps + m_max_input_frames;
+  m_history.assign(m_history_capacity * channels, 0.0f);
+
+  reset();
+  return true;
+}
+
+void Resampler::reset() noexcept
+{
+  std::fill(m_history.begin(), m_history.end(), 0.0f);
+
+  // Silence before the first input frame lets the first output sit exactly on it
+  m_history_frames = m_taps > 0 ? m_taps / 2 - 1 : 0;
+  m_position = 0;
+  m_position_fraction = 0;
+}
+
+void Resampler::set_rate_correction(double rate) noexcept
+{
+  if (!is_adaptive())
+  {
+    return;
+  }
+  const double step = m_nominal_step * std::clamp(rate, 1.0 - m_max_correction, 1.0 + m_max_correction);
+  m_step_numerator = static_cast<uint64_t>(step * static_cast<double>(ADAPTIVE_STEP_DENOMINATOR));
+}
+
+size_t Resampler::get_input_frames_needed(size_t output_frames) const noexcept
+{
+  output_frames = std::min(output_frames, m_max_output_frames);
+  if (output_frames == 0)
+  {
+    return 0;
+  }
+
+  // First tap of the last output, plus its filter length
+  const uint64_t total = m_position_fraction + (output_frames - 1) * m_step_numerator;
+  const size_t required = m_position + static_cast<size_t>(total / m_step_denominator) + m_taps;
+  return required > m_history_frames ? required - m_history_frames : 0;
+}
+
+size_t Resampler::process(const float *input, size_t input_frames, float *output, size_t output_frames) noexcept
+{
+  if (!is_prepared())
+  {
+    return 0;
+  }
+
+  input_frames = std::min(input_frames, m_history_capacity - m_history_frames);
+  if (input_frames > 0)
+  {
+    dsp::deinterleave(get_history(0) + m_history_frames, m_history_capacity, input, m_channels, input_frames);
+    m_history_frames += input_frames;
+  }
+
+  output_frames = std::min(output_frames, m_max_output_frames);
+  size_t produced = 0;
+  while (produced < output_frames && m_position + m_taps <= m_history_frames)
+  {
+    const uint64_t phase_position = m_position_fraction * m_phases;
+    float *frame = output + produced * m_channels;
+
+    if (m_interpolate)
+    {
+      const size_t phase = static_cast<size_t>(phase_position / m_step_denominator);
+      const float blend = static_cast<float>(phase_position % m_step_denominator) / static_cast<float>(m_step_denominator);
+      const float *lower = get_phase(phase);
+      const float *upper = get_phase(phase + 1);
+      for (unsigned int channel = 0; channel < m_channels; channel++)
+      {
+        const float *history = get_history(channel) + m_position;
+        const float a = dsp::dot(history, lower, m_taps);
+        const float b = dsp::dot(history, upper, m_taps);
+        frame[channel] = a + blend * (b - a);
+      }
+    }
+    else
+    {
+      const size_t phase = static_cast<size_t>((phase_position + m_step_denominator / 2) / m_step_denominator);
+      const float *coefficients = get_phase(phase);
+      for (unsigned int channel = 0; channel < m_channels; channel++)
+      {
+        frame[channel] = dsp::dot(get_history(channel) + m_position, coefficients, m_taps);
+      }
+    }
+
+    m_position_fraction += m_step_numerator;
+    m_position += static_cast<size_t>(m_position_fraction / m_step_denominator);
+    m_position_fraction %= m_step_denominator;
+    produced++;
+  }
+
+  // Drop the frames no future output can reach, keeping the history at the front of its storage
+  const size_t consumed = std::min(m_position, m_history_frames);
+  if (consumed > 0)
+  {
+    for (unsigned int channel = 0; channel < m_channels; channel++)
+    {
+      float *history = get_history(channel);
+      std::copy(history + consumed, history + m_history_frames, history);
+    }
+    m_history_frames -= consumed;
+    m_position -= consumed;
+  }
+
+  return produced;
+}
+
+SampleBufferPtr Resampler::resample(const SampleBufferPtr &source, unsigned int target_rate, eResampleQuality quality)
+{
+  if (!source || target_rate == 0 || source->get_sample_rate() == target_rate)
+  {
+    return source;
+  }
+
+  const unsigned int channels = source->get_channels();
+  Resampler resampler;
+  if (!resampler.prepare(source->get_sample_rate(), target_rate, channels, OFFLINE_BLOCK_FRAMES, quality))
+  {
+    return nullptr;
+  }
+
+  const size_t output_frames = static_cast<size_t>(
+    (static_cast<uint64_t>(source->get_frames()) * target_rate + source->get_sample_rate() - 1) / source->get_sample_rate());
+  auto output = SampleBuffer::allocate(output_frames, channels, target_rate);
+
+  // Past the end of the source the filter is fed silence so the last frames ring out
+  std::vector<float> silence(resampler.get_max_input_frames() * channels, 0.0f);
+  const float *input = source->data();
+  size_t input_position = 0;
+  size_t written = 0;
+  while (written < output_frames)
+  {
+    const size_t wanted = std::min(OFFLINE_BLOCK_FRAMES, output_frames - written);
+    const size_t needed = resampler.get_input_frames_needed(wanted);
+    const size_t available = std::min(needed, source->get_frames() - input_position);
+    float *destination = output->get_writable_data() + written * channels;
+
+    size_t produced = 0;
+    if (available == needed)
+    {
+      produced = resampler.process(input + input_position * channels, available, destination, wanted);
+    }
+    else
+    {
+      resampler.process(input + input_position * channels, available, destination, 0);
+      produced = resampler.process(silence.data(), needed - available, destination, wanted);
+    }
+    input_position += available;
+
+    if (produced == 0)
+    {
+      break;
+    }
+    written += produced;
+  }
+
+  return output;
+}
+
+std::string Resampler::to_string() const
+{
+  return "Resampler(SourceRate=" + std::to_string(m_source_rate) +
+         ", TargetRate=" + std::to_string(m_target_rate) +
+         ", Channels=" + std::to_string(m_channels) +
+         ", Quality=" + framework::to_string(m_quality) +
+         ", Taps=" + std::to_string(m_taps) +
+         ", Phases=" + std::to_string(m_phases) +
+         ", MaxCorrection=" + std::to_string(m_max_correction) + ")";
+}
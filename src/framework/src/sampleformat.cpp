@@ -0,0 +1,127 @@
+#include "sampleformat.h"
+#include "dspkernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+using namespace miniaudioengine::framework;
+
+namespace
+{
+
+void float_to_int24(uint8_t *destination, const float *source, size_t n) noexcept
+{
+  for (size_t i = 0; i < n; i++)
+  {
+    const float scaled = std::min(std::max(source[i], -1.0f), 1.0f) * 8388607.0f;
+    const uint32_t value = static_cast<uint32_t>(static_cast<int32_t>(std::lrint(scaled)));
+    uint8_t *sample = destination + 3 * i;
+    sample[0] = static_cast<uint8_t>(value);
+    sample[1] = static_cast<uint8_t>(value >> 8);
+    sample[2] = static_cast<uint8_t>(value >> 16);
+  }
+}
+
+} // namespace
+
+std::string miniaudioengine::framework::to_string(eSampleFormat format)
+{
+  switch (format)
+  {
+    case eSampleFormat::Int16:
+      return "Int16";
+    case eSampleFormat::Int24:
+      return "Int24";
+    case eSampleFormat::Int32:
+      return "Int32";
+    case eSampleFormat::Float32:
+      return "Float32";
+    default:
+      return "Unknown";
+  }
+}
+
+unsigned int miniaudioengine::framework::get_bytes_per_sample(eSampleFormat format)
+{
+  switch (format)
+  {
+    case eSampleFormat::Int16:
+      return 2;
+    case eSampleFormat::Int24:
+      return 3;
+    case eSampleFormat::Int32:
+    case eSampleFormat::Float32:
+    default:
+      return 4;
+  }
+}
+
+namespace miniaudioengine::framework::dsp
+{
+
+template <eSampleFormat Format>
+void from_float(void *destination, const float *source, size_t n) noexcept
+{
+  if constexpr (Format == eSampleFormat::Int16)
+  {
+    float_to_int16(static_cast<int16_t *>(destination), source, n);
+  }
+  else if constexpr (Format == eSampleFormat::Int24)
+  {
+    float_to_int24(static_cast<uint8_t *>(destination), source, n);
+  }
+  else if constexpr (Format == eSampleFormat::Int32)
+  {
+    float_to_int32(static_cast<int32_t *>(destination), source, n);
+  }
+  else
+  {
+    std::memcpy(destination, source, n * sizeof(float));
+  }
+}
+
+template <eSampleFormat Format>
+void to_float(float *destination, const void *source, size_t n) noexcept
+{
+  if constexpr (Format == eSampleFormat::Int16)
+  {
+    int16_to_float(destination, static_cast<const int16_t *>(source), n);
+  }
+  else if constexpr (Format == eSampleFormat::Int24)
+  {
+    int24_to_float(destination, static_cast<const uint8_t *>(source), n);
+  }
+  else if constexpr (Format == eSampleFormat::Int32)
+  {
+    int32_to_float(destination, static_cast<const int32_t *>(source), n);
+  }
+  else
+  {
+    std::memcpy(destination, source, n * sizeof(float));
+  }
+}
+
+const SampleFormatKernels &get_format_kernels(eSampleFormat format) noexcept
+{
+  static constexpr SampleFormatKernels kernels[] = {
+    {eSampleFormat::Int16, &from_float<eSampleFormat::Int16>, &to_float<eSampleFormat::Int16>},
+    {eSampleFormat::Int24, &from_float<eSampleFormat::Int24>, &to_float<eSampleFormat::Int24>},
+    {eSampleFormat::Int32, &from_float<eSampleFormat::Int32>, &to_float<eSampleFormat::Int32>},
+    {eSampleFormat::Float32, &from_float<eSampleFormat::Float32>, &to_float<eSampleFormat::Float32>},
+  };
+  const size_t index = static_cast<size_t>(format);
+  return kernels[index < std::size(kernels) ? index : std::size(kernels) - 1];
+}
+
+template void from_float<eSampleFormat::Int16>(void *, const float *, size_t) noexcept;
+template void from_float<eSampleFormat::Int24>(void *, const float *, size_t) noexcept;
+template void from_float<eSampleFormat::Int32>(void *, const float *, size_t) noexcept;
+template void from_float<eSampleFormat::Float32>(void *, const float *, size_t) noexcept;
+template void to_float<eSampleFormat::Int16>(float *, const void *, size_t) noexcept;
+template void to_float<eSampleFormat::Int24>(float *, const void *, size_t) noexcept;
+template void to_float<eSampleFormat::Int32>(float *, const void *, size_t) noexcept;
+template void to_float<eSampleFormat::Float32>(float *, const void *, size_t) noexcept;
+
+} // namespace miniaudioengine::framework::dsp
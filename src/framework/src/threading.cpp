@@ -0,0 +1,392 @@
+#include "threading.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <thread>
+
+#if defined(PLATFORM_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(PLATFORM_WINDOWS)
+#include <windows.h>
+#include <avrt.h>
+#endif
+
+using namespace miniaudioengine::framework;
+
+namespace
+{
+
+/** @brief Longest thread name Linux accepts, without the terminator. */
+constexpr size_t OS_THREAD_NAME_SIZE = 15;
+
+/** @struct ThreadEntry
+ *  @brief A registered thread and the OS handles used to reconfigure it from other threads.
+ */
+struct ThreadEntry
+{
+  ThreadInfo info;
+  bool pinned{false};
+#if defined(PLATFORM_LINUX)
+  pthread_t handle{};
+  pid_t tid{0};
+#elif defined(PLATFORM_WINDOWS)
+  HANDLE handle{nullptr};
+  HANDLE mmcss{nullptr};
+#endif
+};
+
+std::string join_cores(const std::vector<unsigned int> &cores)
+{
+  std::string text;
+  for (size_t i = 0; i < cores.size(); i++)
+  {
+    if (i > 0)
+    {
+      text += ',';
+    }
+    text += std::to_string(cores[i]);
+  }
+  return text;
+}
+
+bool is_realtime(eThreadClass thread_class)
+{
+  return thread_class == eThreadClass::Audio || thread_class == eThreadClass::Worker;
+}
+
+/** @brief Returns the cores a thread may run on, or an empty list to allow every core. */
+std::vector<unsigned int> get_thread_cores(const ThreadEntry &entry, const ThreadingConfig &config)
+{
+  if (config.realtime_cores.empty())
+  {
+    return {};
+  }
+  if (is_realtime(entry.info.thread_class))
+  {
+    return {config.realtime_cores[entry.info.index % config.realtime_cores.size()]};
+  }
+
+  std::vector<unsigned int> cores;
+  const unsigned int count = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned int core = 0; core < count; core++)
+  {
+    if (std::find(config.realtime_cores.begin(), config.realtime_cores.end(), core) == config.realtime_cores.end())
+    {
+      cores.push_back(core);
+    }
+  }
+  return cores;
+}
+
+bool set_affinity(ThreadEntry &entry, const ThreadingConfig &config)
+{
+  std::vector<unsigned int> cores = get_thread_cores(entry, config);
+  if (cores.empty())
+  {
+    if (!entry.pinned)
+    {
+      return true;
+    }
+    // Release a thread pinned by an earlier configuration
+    const unsigned int count = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int core = 0; core < count; core++)
+    {
+      cores.push_back(core);
+    }
+  }
+
+#if defined(PLATFORM_LINUX)
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (unsigned int core : cores)
+  {
+    CPU_SET(core, &cpuset);
+  }
+  const bool applied = pthread_setaffinity_np(entry.handle, sizeof(cpuset), &cpuset) == 0;
+#elif defined(PLATFORM_WINDOWS)
+  DWORD_PTR mask = 0;
+  for (unsigned int core : cores)
+  {
+    mask |= core < 64 ? DWORD_PTR(1) << core : 0;
+  }
+  const bool applied = mask != 0 && SetThreadAffinityMask(entry.handle, mask) != 0;
+#else
+  const bool applied = false;
+#endif
+
+  if (!applied)
+  {
+    LOG_WARNING("Threading: Unable to run ", entry.info.name, " on cores ", join_cores(cores));
+    return false;
+  }
+  entry.pinned = !config.realtime_cores.empty();
+  return true;
+}
+
+bool set_priority(ThreadEntry &entry, const ThreadingConfig &config)
+{
+  const eThreadClass thread_class = entry.info.thread_class;
+  const int priority = thread_class == eThreadClass::Audio ? config.audio_priority :
+                       thread_class == eThreadClass::Worker ? config.worker_priority : 0;
+
+#if defined(PLATFORM_LINUX)
+  if (is_realtime(thread_class) && priority > 0)
+  {
+    sched_param param{};
+    param.sched_priority = std::clamp(priority, sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO));
+    if (pthread_setschedparam(entry.handle, SCHED_FIFO, &param) != 0)
+    {
+      LOG_WARNING("Threading: Unable to set realtime priority ", param.sched_priority, " for ", entry.info.name,
+                  ". Running with normal priority.");
+      return false;
+    }
+  }
+  else if (thread_class == eThreadClass::Background)
+  {
+    // Linux applies nice values per thread
+    if (::setpriority(PRIO_PROCESS, static_cast<id_t>(entry.tid), config.background_nice) != 0)
+    {
+      LOG_WARNING("Threading: Unable to lower the priority of ", entry.info.name);
+      return false;
+    }
+  }
+#elif defined(PLATFORM_WINDOWS)
+  int thread_priority = THREAD_PRIORITY_NORMAL;
+  if (is_realtime(thread_class) && priority > 0)
+  {
+    if (entry.mmcss != nullptr)
+    {
+      return true; // MMCSS boosts the thread itself
+    }
+    thread_priority = thread_class == eThreadClass::Audio ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_HIGHEST;
+  }
+  else if (thread_class == eThreadClass::Background)
+  {
+    thread_priority = THREAD_PRIORITY_BELOW_NORMAL;
+  }
+  else
+  {
+    return true;
+  }
+  if (!SetThreadPriority(entry.handle, thread_priority))
+  {
+    LOG_WARNING("Threading: Unable to set the priority of ", entry.info.name);
+    return false;
+  }
+#else
+  (void)entry;
+  (void)priority;
+#endif
+  return true;
+}
+
+/** @class ThreadRegistry
+ *  @brief The threading configuration and every registered thread.
+ */
+class ThreadRegistry
+{
+public:
+  using Iterator = std::list<ThreadEntry>::iterator;
+
+  bool configure(const ThreadingConfig &config)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_config = config;
+    bool applied = true;
+    for (ThreadEntry &entry : m_entries)
+    {
+      applied = apply_locked(entry) && applied;
+    }
+    LOG_INFO("Threading: Configured ", m_entries.size(), " thread(s). ", m_config.to_string());
+    return applied;
+  }
+
+  ThreadingConfig get_config()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_config;
+  }
+
+  Iterator add(ThreadEntry entry, bool &applied)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.push_back(std::move(entry));
+    Iterator it = std::prev(m_entries.end());
+    applied = apply_locked(*it);
+    return it;
+  }
+
+  void remove(Iterator it)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+#if defined(PLATFORM_WINDOWS)
+    CloseHandle(it->handle);
+#endif
+    m_entries.erase(it);
+  }
+
+  std::vector<ThreadInfo> get_threads()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<ThreadInfo> threads;
+    threads.reserve(m_entries.size());
+    for (const ThreadEntry &entry : m_entries)
+    {
+      threads.push_back(entry.info);
+    }
+    return threads;
+  }
+
+private:
+  bool apply_locked(ThreadEntry &entry)
+  {
+    const bool priority_set = set_priority(entry, m_config);
+    const bool affinity_set = set_affinity(entry, m_config);
+    entry.info.applied = priority_set && affinity_set;
+    return entry.info.applied;
+  }
+
+  std::mutex m_mutex;
+  ThreadingConfig m_config;
+  std::list<ThreadEntry> m_entries;
+};
+
+/** @brief Never destroyed, so threads exiting during shutdown can still deregister. */
+ThreadRegistry &get_registry()
+{
+  static ThreadRegistry *registry = new ThreadRegistry();
+  return *registry;
+}
+
+/** @brief Removes the calling thread from the registry when it exits. */
+struct ThreadRegistration
+{
+  bool registered{false};
+  ThreadRegistry::Iterator entry;
+#if defined(PLATFORM_WINDOWS)
+  HANDLE mmcss{nullptr};
+#endif
+
+  ~ThreadRegistration()
+  {
+    if (registered)
+    {
+      get_registry().remove(entry);
+    }
+#if defined(PLATFORM_WINDOWS)
+    if (mmcss != nullptr)
+    {
+      AvRevertMmThreadCharacteristics(mmcss);
+    }
+#endif
+  }
+};
+
+thread_local ThreadRegistration registration;
+
+} // namespace
+
+std::string miniaudioengine::framework::to_string(eThreadClass thread_class)
+{
+  switch (thread_class)
+  {
+    case eThreadClass::Audio:
+      return "Audio";
+    case eThreadClass::Worker:
+      return "Worker";
+    case eThreadClass::Normal:
+      return "Normal";
+    case eThreadClass::Io:
+      return "Io";
+    case eThreadClass::Background:
+      return "Background";
+    default:
+      return "Unknown";
+  }
+}
+
+std::string ThreadingConfig::to_string() const
+{
+  return "ThreadingConfig(RealtimeCores=" + std::string(realtime_cores.empty() ? "Any" : join_cores(realtime_cores)) +
+         ", AudioPriority=" + std::to_string(audio_priority) +
+         ", WorkerPriority=" + std::to_string(worker_priority) +
+         ", BackgroundNice=" + std::to_string(background_nice) + ")";
+}
+
+std::string ThreadInfo::to_string() const
+{
+  return "ThreadInfo(Name=" + name +
+         ", Class=" + framework::to_string(thread_class) +
+         ", Index=" + std::to_string(index) +
+         ", Applied=" + std::string(applied ? "true" : "false") + ")";
+}
+
+bool threading::configure(const ThreadingConfig &config)
+{
+  return get_registry().configure(config);
+}
+
+ThreadingConfig threading::get_config()
+{
+  return get_registry().get_config();
+}
+
+bool threading::register_current_thread(const std::string &name, eThreadClass thread_class, unsigned int index)
+{
+  if (registration.registered)
+  {
+    return true;
+  }
+  set_thread_name(name);
+
+  ThreadEntry entry;
+  entry.info.name = name;
+  entry.info.thread_class = thread_class;
+  entry.info.index = index;
+
+#if defined(PLATFORM_LINUX)
+  entry.handle = pthread_self();
+  entry.tid = static_cast<pid_t>(::syscall(SYS_gettid));
+  pthread_setname_np(entry.handle, name.substr(0, OS_THREAD_NAME_SIZE).c_str());
+#elif defined(PLATFORM_WINDOWS)
+  entry.handle = OpenThread(THREAD_SET_INFORMATION | THREAD_QUERY_INFORMATION, FALSE, GetCurrentThreadId());
+  SetThreadDescription(GetCurrentThread(), std::wstring(name.begin(), name.end()).c_str());
+
+  // MMCSS can only be joined by the thread itself
+  const ThreadingConfig config = get_registry().get_config();
+  const int priority = thread_class == eThreadClass::Audio ? config.audio_priority :
+                       thread_class == eThreadClass::Worker ? config.worker_priority : 0;
+  if (is_realtime(thread_class) && priority > 0)
+  {
+    DWORD task_index = 0;
+    registration.mmcss = AvSetMmThreadCharacteristicsW(L"Pro Audio", &task_index);
+    if (registration.mmcss != nullptr)
+    {
+      AvSetMmThreadPriority(registration.mmcss, thread_class == eThreadClass::Audio ? AVRT_PRIORITY_CRITICAL : AVRT_PRIORITY_HIGH);
+    }
+    entry.mmcss = registration.mmcss;
+  }
+#endif
+
+  bool applied = false;
+  registration.entry = get_registry().add(std::move(entry), applied);
+  registration.registered = true;
+  return applied;
+}
+
+bool threading::is_current_thread_registered() noexcept
+{
+  return registration.registered;
+}
+
+std::vector<ThreadInfo> threading::get_threads()
+{
+  return get_registry().get_threads();
+}
@@ -0,0 +1,326 @@
+#include "trace.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace miniaudioengine::framework;
+
+std::atomic<bool> trace::detail::enabled{false};
+
+namespace
+{
+
+constexpr size_t THREAD_NAME_SIZE = 32;
+
+/** @struct EventSlot
+ *  @brief One event in a ring. Fields are relaxed atomics so a dump can read while the owner writes.
+ */
+struct EventSlot
+{
+  std::atomic<const char *> name{nullptr};
+  std::atomic<uint64_t> type_and_id{0};
+  std::atomic<uint64_t> start_ticks{0};
+  std::atomic<uint64_t> duration_ticks{0};
+  std::atomic<int64_t> value{0};
+};
+
+/** @struct ThreadRing
+ *  @brief Events of one thread, newest overwriting oldest. Written only by its owner.
+ */
+struct ThreadRing
+{
+  enum eOwner : int
+  {
+    Free,
+    Owned,
+    Released // The thread exited, the events are kept until the ring is claimed again
+  };
+
+  std::atomic<int> owner{Free};
+  char thread_name[THREAD_NAME_SIZE]{};
+  std::unique_ptr<EventSlot[]> events;
+  std::atomic<uint64_t> written{0};
+};
+
+struct TraceState
+{
+  std::mutex mutex; // Serialises enable(), clear() and dumps
+  std::array<ThreadRing, trace::MAX_THREADS> rings;
+  size_t capacity{0};
+  std::atomic<bool> allocated{false};
+  std::atomic<unsigned long long> untraced_events{0};
+
+  // Trace clock and steady_clock read together at enable(), to convert ticks to microseconds
+  uint64_t origin_ticks{0};
+  uint64_t origin_ns{0};
+};
+
+TraceState &get_state()
+{
+  static TraceState state;
+  return state;
+}
+
+/** @brief Hands the ring back when its thread exits. */
+struct ThreadRingHandle
+{
+  ThreadRing *p_ring{nullptr};
+
+  ~ThreadRingHandle()
+  {
+    if (p_ring != nullptr)
+    {
+      p_ring->owner.store(ThreadRing::Released, std::memory_order_release);
+    }
+  }
+};
+
+thread_local ThreadRingHandle thread_ring;
+
+/** @brief Claim a free ring for the calling thread, or the ring of a thread that exited. */
+ThreadRing *claim_ring(TraceState &state) noexcept
+{
+  for (const int from : {static_cast<int>(ThreadRing::Free), static_cast<int>(ThreadRing::Released)})
+  {
+    for (ThreadRing &candidate : state.rings)
+    {
+      int expected = from;
+      if (candidate.owner.compare_exchange_strong(expected, ThreadRing::Owned, std::memory_order_acq_rel))
+      {
+        candidate.written.store(0, std::memory_order_release);
+        std::strncpy(candidate.thread_name, get_thread_name().c_str(), THREAD_NAME_SIZE - 1);
+        candidate.thread_name[THREAD_NAME_SIZE - 1] = '\0';
+        return &candidate;
+      }
+    }
+  }
+  return nullptr;
+}
+
+/** @brief Copy the events of a ring that were not overwritten while they were read. */
+void copy_events(const ThreadRing &ring, size_t capacity, std::vector<TraceEvent> &events)
+{
+  events.clear();
+  const uint64_t written = ring.written.load(std::memory_order_acquire);
+  const uint64_t begin = written > capacity ? written - capacity : 0;
+  for (uint64_t index = begin; index < written; index++)
+  {
+    const EventSlot &slot = ring.events[index & (capacity - 1)];
+    const uint64_t type_and_id = slot.type_and_id.load(std::memory_order_relaxed);
+    events.push_back({slot.name.load(std::memory_order_relaxed),
+                      static_cast<eTraceEventType>(type_and_id >> 32),
+                      static_cast<uint32_t>(type_and_id),
+                      slot.start_ticks.load(std::memory_order_relaxed),
+                      slot.duration_ticks.load(std::memory_order_relaxed),
+                      slot.value.load(std::memory_order_relaxed)});
+  }
+
+  // The owner may have lapped the copy. Its next write lands on the oldest slot still kept, so drop that one too
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const uint64_t written_after = ring.written.load(std::memory_order_relaxed);
+  if (written_after < written)
+  {
+    events.clear(); // The ring was claimed by another thread meanwhile
+    return;
+  }
+  const uint64_t valid_begin = written_after + 1 > capacity ? written_after + 1 - capacity : 0;
+  const size_t stale = static_cast<size_t>(std::min<uint64_t>(valid_begin > begin ? valid_begin - begin : 0, events.size()));
+  events.erase(events.begin(), events.begin() + static_cast<std::ptrdiff_t>(stale));
+}
+
+void append_escaped(std::string &json, const char *text)
+{
+  for (const char *c = text != nullptr ? text : "(null)"; *c != '\0'; c++)
+  {
+    if (*c == '"' || *c == '\\')
+    {
+      json += '\\';
+    }
+    json += static_cast<unsigned char>(*c) < 0x20 ? ' ' : *c;
+  }
+}
+
+} // namespace
+
+uint64_t trace::read_steady_ns() noexcept
+{
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void trace::enable(size_t events_per_thread)
+{
+  TraceState &state = get_state();
+  std::lock_guard<std::mutex> lock(state.mutex);
+
+  if (!state.allocated.load(std::memory_order_relaxed))
+  {
+    state.capacity = std::bit_ceil(std::max<size_t>(events_per_thread, 2));
+    for (ThreadRing &ring : state.rings)
+    {
+      ring.events = std::make_unique<EventSlot[]>(state.capacity);
+    }
+    state.allocated.store(true, std::memory_order_release);
+    LOG_INFO("Trace: enable - Allocated ", trace::MAX_THREADS, " rings of ", state.capacity, " events");
+  }
+  else if (events_per_thread != state.capacity && events_per_thread != DEFAULT_EVENTS_PER_THREAD)
+  {
+    LOG_WARNING("Trace: enable - Rings are already allocated with ", state.capacity, " events, ignoring ", events_per_thread);
+  }
+
+  for (ThreadRing &ring : state.rings)
+  {
+    ring.written.store(0, std::memory_order_release);
+  }
+  state.untraced_events.store(0, std::memory_order_relaxed);
+  state.origin_ns = read_steady_ns();
+  state.origin_ticks = now();
+  detail::enabled.store(true, std::memory_order_release);
+}
+
+void trace::disable()
+{
+  detail::enabled.store(false, std::memory_order_release);
+}
+
+void trace::clear()
+{
+  TraceState &state = get_state();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  for (ThreadRing &ring : state.rings)
+  {
+    ring.written.store(0, std::memory_order_release);
+  }
+  state.untraced_events.store(0, std::memory_order_relaxed);
+}
+
+void trace::record(const TraceEvent &event) noexcept
+{
+  TraceState &state = get_state();
+  if (!state.allocated.load(std::memory_order_acquire))
+  {
+    return;
+  }
+
+  ThreadRing *ring = thread_ring.p_ring;
+  if (ring == nullptr)
+  {
+    ring = claim_ring(state);
+    if (ring == nullptr)
+    {
+      state.untraced_events.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    thread_ring.p_ring = ring;
+  }
+
+  const uint64_t index = ring->written.load(std::memory_order_relaxed);
+  EventSlot &slot = ring->events[index & (state.capacity - 1)];
+  slot.name.store(event.name, std::memory_order_relaxed);
+  slot.type_and_id.store((static_cast<uint64_t>(event.type) << 32) | event.id, std::memory_order_relaxed);
+  slot.start_ticks.store(event.start_ticks, std::memory_order_relaxed);
+  slot.duration_ticks.store(event.duration_ticks, std::memory_order_relaxed);
+  slot.value.store(event.value, std::memory_order_relaxed);
+  ring->written.store(index + 1, std::memory_order_release);
+}
+
+std::string trace::to_chrome_json()
+{
+  TraceState &state = get_state();
+  std::lock_guard<std::mutex> lock(state.mutex);
+
+  std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+  json += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"miniaudioengine\"}}";
+  if (!state.allocated.load(std::memory_order_acquire))
+  {
+    return json + "\n]}\n";
+  }
+
+  // Ticks per microsecond, measured over the whole trace so it needs no calibration pause
+  const uint64_t elapsed_ns = std::max<uint64_t>(1, read_steady_ns() - state.origin_ns);
+  const double ticks_per_us = std::max(1e-9, static_cast<double>(now() - state.origin_ticks) * 1000.0 / static_cast<double>(elapsed_ns));
+  auto to_us = [&](uint64_t ticks, bool since_origin) {
+    const double relative = since_origin ? static_cast<double>(static_cast<int64_t>(ticks - state.origin_ticks))
+                                         : static_cast<double>(ticks);
+    return relative / ticks_per_us;
+  };
+
+  std::vector<TraceEvent> events;
+  events.reserve(state.capacity);
+  char number[64];
+  for (size_t ring_index = 0; ring_index < state.rings.size(); ring_index++)
+  {
+    const ThreadRing &ring = state.rings[ring_index];
+    if (ring.owner.load(std::memory_order_acquire) == ThreadRing::Free)
+    {
+      continue;
+    }
+    copy_events(ring, state.capacity, events);
+    if (events.empty())
+    {
+      continue;
+    }
+
+    const std::string tid = std::to_string(ring_index + 1);
+    json += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + tid + ",\"args\":{\"name\":\"";
+    append_escaped(json, ring.thread_name);
+    json += "\"}}";
+
+    for (const TraceEvent &event : events)
+    {
+      json += ",\n{\"name\":\"";
+      append_escaped(json, event.name);
+      if (event.type == eTraceEventType::Counter && event.id != 0)
+      {
+        json += ' ';
+        json += std::to_string(event.id);
+      }
+      std::snprintf(number, sizeof(number), "%.3f", to_us(event.start_ticks, true));
+      json += "\",\"pid\":1,\"tid\":" + tid + ",\"ts\":" + number;
+
+      switch (event.type)
+      {
+        case eTraceEventType::Complete:
+          std::snprintf(number, sizeof(number), "%.3f", to_us(event.duration_ticks, false));
+          json += ",\"ph\":\"X\",\"dur\":" + std::string(number) + ",\"args\":{\"id\":" + std::to_string(event.id) + "}}";
+          break;
+        case eTraceEventType::Counter:
+          json += ",\"ph\":\"C\",\"args\":{\"value\":" + std::to_string(event.value) + "}}";
+          break;
+        case eTraceEventType::Instant:
+        default:
+          json += ",\"ph\":\"i\",\"s\":\"t\",\"args\":{\"id\":" + std::to_string(event.id) + "}}";
+          break;
+      }
+    }
+  }
+
+  const unsigned long long untraced = state.untraced_events.load(std::memory_order_relaxed);
+  if (untraced > 0)
+  {
+    LOG_WARNING("Trace: to_chrome_json - ", untraced, " events of threads beyond the ", trace::MAX_THREADS, " rings were not recorded");
+  }
+  return json + "\n]}\n";
+}
+
+bool trace::write_chrome_json(const std::filesystem::path &path)
+{
+  const std::string json = to_chrome_json();
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file || !file.write(json.data(), static_cast<std::streamsize>(json.size())))
+  {
+    LOG_ERROR("Trace: write_chrome_json - Failed to write ", path.string());
+    return false;
+  }
+  LOG_INFO("Trace: write_chrome_json - Wrote ", json.size(), " bytes to ", path.string());
+  return true;
+}
@@ -1,11 +1,21 @@
 #ifndef __DEVICE_MANAGER_H__
 #define __DEVICE_MANAGER_H__
 
+#include "io.h"
+#include "streamstatistics.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <optional>
 #include <stdexcept>
+#include <thread>
+#include <unordered_map>
 
 namespace miniaudioengine
 {
@@ -17,21 +27,69 @@ using AudioAdapterPtr = std::shared_ptr<class AudioAdapter>;
 using MidiAdapterPtr = std::shared_ptr<class MidiAdapter>;
 }
 
+namespace dataplane
+{
+using AudioGraphPtr = std::shared_ptr<class AudioGraph>;
+using StreamMixerPtr = std::shared_ptr<class StreamMixer>;
+using TransportPtr = std::shared_ptr<class Transport>;
+using TransportGatePtr = std::shared_ptr<class TransportGate>;
+}
+
 class Device;
 
 using DevicePtr = std::shared_ptr<Device>;
 using DeviceList = std::vector<DevicePtr>;
 
+/** @struct DeviceChange
+ *  @brief Devices plugged in or removed since the previous enumeration.
+ */
+struct DeviceChange
+{
+  DeviceList added;
+  DeviceList removed;
+  bool defaults_changed{false}; // A default input or output device moved to another device
+
+  bool empty() const { return added.empty() && removed.empty() && !defaults_changed; }
+
+  std::string to_string() const;
+};
+
+typedef std::function<void(const DeviceChange &)> DeviceChangeCallback;
+
 /** @class DeviceService
  *  @brief This class manages the system's audio and MIDI I/O devices.
  *  It is implemented as a singleton to provide a global point of access.
+ *  Devices are enumerated on a background thread into an immutable table, so lookups by ID and of the
+ *  default devices are hash lookups instead of backend probes, and constructing the service does not
+ *  wait for the audio backend. The thread re-enumerates on an interval and after refresh_devices(),
+ *  publishes a new table when devices were plugged in or removed, and reports the change to the
+ *  device change callback. Only the first lookup waits, until the first table is built.
+ *  Every lookup of a physical audio device returns the same Device handle, so the service can own
+ *  one stream per device. Tracks attach to that stream instead of opening their own: the first
+ *  attachment opens it, every further track is mixed into the same callback and the last one to
+ *  detach closes it.
  */
 class DeviceService
 {
 public:
-  DeviceService();
+  /** @brief Interval between background enumerations, which detect hot-plugged devices. */
+  static constexpr std::chrono::milliseconds DEFAULT_POLL_INTERVAL{2000};
+
+  /** @param poll_interval Interval between enumerations. 0 only enumerates on refresh_devices(). */
+  explicit DeviceService(std::chrono::milliseconds poll_interval = DEFAULT_POLL_INTERVAL);
   ~DeviceService();
 
+  /** @brief Enumerate the devices now and wait for the new table.
+   *  @return True if a device was plugged in or removed, or a default device changed.
+   */
+  bool refresh_devices();
+
+  /** @brief Set a callback run on the enumeration thread whenever devices are plugged in or removed.
+   *  @param callback The callback, e.g. `void on_devices(const miniaudioengine::DeviceChange &change)`, or nullptr.
+   *  @note The callback must not call refresh_devices(), which waits for the thread running it.
+   */
+  void set_device_change_callback(DeviceChangeCallback callback);
+
   /** @brief Return a list of all available audio devices.
    *  @return A vector of Device objects representing the available audio devices.
    */
@@ -76,9 +134,105 @@ public:
    */
   DevicePtr get_default_midi_output_device();
 
+  /** @brief Attach a track to the shared stream of an audio device, opening the stream on first use.
+   *  A stream opened for output only is reopened as a duplex stream when the first track captures from it.
+   *  @param device The audio device, as returned by this service.
+   *  @param graph The track's compiled graph, mixed into the device output. nullptr if the track does not play to the device.
+   *  @param capture The track's Buffer, fed from the device input. nullptr if the track does not capture from the device.
+   *  @param statistics The track's statistics, which record the time spent rendering its graph.
+   *  @param config Stream parameters. The first attachment's buffer size and sample rate set the stream's format,
+   *  and later attachments must match it.
+   *  @param gate Transport frames the graph sounds between, or nullptr to always render it.
+   *  @return False if the stream cannot be opened or runs at a different buffer size or sample rate.
+   */
+  bool attach_to_stream(const DevicePtr &device, const dataplane::AudioGraphPtr &graph, const framework::BufferPtr &capture,
+                        const framework::StreamStatisticsPtr &statistics, const framework::StreamConfig &config,
+                        const dataplane::TransportGatePtr &gate = nullptr);
+
+  /** @brief Detach a track attached with the same graph and capture Buffer. Closes the stream when no track is left.
+   *  @return False if the track is not attached to the device's stream.
+   */
+  bool detach_from_stream(const DevicePtr &device, const dataplane::AudioGraphPtr &graph, const framework::BufferPtr &capture);
+
+  /** @brief Share a transport with every device stream.
+   *  One open stream drives it, preferring one with an output, and prepares it for its sample rate.
+   *  When that stream closes another open stream takes over.
+   *  @param transport The session transport, or nullptr to stream without one.
+   */
+  void set_transport(const dataplane::TransportPtr &transport);
+
+  dataplane::TransportPtr get_transport() const;
+
+  /** @brief Returns the number of tracks attached to a device's shared stream, 0 if it is closed. */
+  size_t get_stream_reference_count(const DevicePtr &device) const;
+
+  /** @brief Returns the callback timing and xruns of a device's shared stream, or nullptr if it is closed. */
+  framework::StreamStatisticsPtr get_stream_statistics(const DevicePtr &device) const;
+
+  /** @brief Returns the sample rate a device's stream runs at for a config. */
+  static unsigned int get_stream_sample_rate(const DevicePtr &device, const framework::StreamConfig &config);
+
 private:
+  /** @struct DeviceTable
+   *  @brief Immutable result of one enumeration.
+   */
+  struct DeviceTable
+  {
+    DeviceList audio_devices;
+    DeviceList midi_devices;
+    std::unordered_map<unsigned int, DevicePtr> audio_by_id;
+    std::unordered_map<unsigned int, DevicePtr> midi_by_id;
+    DevicePtr default_audio_input;
+    DevicePtr default_audio_output;
+    DevicePtr default_midi_input;
+    DevicePtr default_midi_output;
+  };
+
+  using DeviceTablePtr = std::shared_ptr<const DeviceTable>;
+
+  /** @brief Returns the current table, waiting for the first enumeration if it has not finished. */
+  DeviceTablePtr get_table() const;
+
+  void poll(std::stop_token stop_token);
+
+  DeviceTablePtr build_table(const DeviceTable *previous, DeviceChange &change);
+
+  /** @struct SharedStream
+   *  @brief The one stream open on a device and the mixer every attached track renders through.
+   */
+  struct SharedStream
+  {
+    DevicePtr device;
+    dataplane::StreamMixerPtr mixer;
+    framework::StreamStatisticsPtr statistics;
+    framework::eInputOutputDirection direction{framework::eInputOutputDirection::Output};
+    bool is_open{false};
+  };
+
+  bool open_shared_stream(SharedStream &stream, framework::eInputOutputDirection direction, const framework::StreamConfig &config);
+
+  void assign_transport_locked();
+
+  // Enumeration thread only
   adapters::AudioAdapterPtr p_audio_adapter;
   adapters::MidiAdapterPtr p_midi_adapter;
+
+  const std::chrono::milliseconds m_poll_interval;
+
+  mutable std::mutex m_devices_mutex;
+  mutable std::condition_variable_any m_devices_signal; // A table was published, or a refresh was requested
+  DeviceTablePtr p_table;
+  uint64_t m_refresh_requested{0};
+  uint64_t m_refresh_completed{0};
+  bool m_refresh_changed{false};
+  DeviceChangeCallback m_device_change_callback;
+
+  mutable std::mutex m_streams_mutex;
+  std::unordered_map<unsigned int, SharedStream> m_streams;
+  dataplane::TransportPtr p_transport;
+  std::optional<unsigned int> m_transport_driver;
+
+  std::jthread m_poll_thread; // Declared last, so the thread stops before the table and adapters are released
 };
 
 } // namespace miniaudioengine
@@ -0,0 +1,112 @@
+#ifndef __FILE_INDEX_H__
+#define __FILE_INDEX_H__
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace miniaudioengine
+{
+
+/** @struct AudioFileInfo
+ *  @brief Lightweight description of an audio file found by a scan, read from its header only.
+ *  Open it with FileService::get_audio_file() when it is actually used.
+ */
+struct AudioFileInfo
+{
+  std::filesystem::path path;
+  uint64_t size_bytes{0};
+  int64_t modified_time{0}; // Last write time in file clock ticks, with size_bytes tells if the file changed
+  uint64_t frames{0};
+  unsigned int sample_rate{0};
+  unsigned int channels{0};
+  unsigned int bits_per_sample{0};
+  std::string format; // e.g. "WAV", empty if the header could not be read
+
+  /** @brief Returns true if the header was read, false for a file that is not a readable audio file. */
+  bool is_valid() const { return channels > 0 && sample_rate > 0; }
+
+  std::string get_filename() const { return path.filename().string(); }
+
+  double get_duration_seconds() const
+  {
+    return sample_rate > 0 ? static_cast<double>(frames) / sample_rate : 0.0;
+  }
+
+  std::string to_string() const
+  {
+    return "AudioFileInfo(Path=" + path.string() +
+           ", Format=" + format +
+           ", Frames=" + std::to_string(frames) +
+           ", SampleRate=" + std::to_string(sample_rate) +
+           ", Channels=" + std::to_string(channels) +
+           ", BitsPerSample=" + std::to_string(bits_per_sample) +
+           ", SizeBytes=" + std::to_string(size_bytes) + ")";
+  }
+};
+
+using AudioFileInfoList = std::vector<AudioFileInfo>;
+
+/** @class FileIndex
+ *  @brief Metadata of scanned audio files keyed by path, kept between launches in an index file.
+ *  An entry is only reused while the file's size and last write time match the ones it was read
+ *  with, so a changed file is probed again. Files that could not be read are kept too, so they are
+ *  not probed again on every scan.
+ *  @note Thread-safe, so scanner threads can look up and add entries concurrently.
+ */
+class FileIndex
+{
+public:
+  static constexpr const char *FILE_MAGIC = "miniaudioengine-file-index";
+  static constexpr unsigned int FILE_VERSION = 1;
+
+  FileIndex() = default;
+  ~FileIndex() = default;
+
+  FileIndex(const FileIndex &) = delete;
+  FileIndex &operator=(const FileIndex &) = delete;
+
+  /** @brief Use an index file, replacing the entries with the ones it holds.
+   *  A missing file starts an empty index that is created by the next save().
+   *  @return False if the file exists but is not an index of this version. The index is then empty.
+   */
+  bool open(const std::filesystem::path &index_path);
+
+  /** @brief Write the entries to the index file, if it is set and anything changed since it was read.
+   *  The file is replaced atomically, so an interrupted save leaves the previous index.
+   *  @return False if the file could not be written.
+   */
+  bool save();
+
+  std::filesystem::path get_index_path() const;
+
+  /** @brief Returns the entry for a path if it was read from a file of this size and write time. */
+  std::optional<AudioFileInfo> find(const std::filesystem::path &path, uint64_t size_bytes, int64_t modified_time) const;
+
+  /** @brief Add an entry, replacing any entry for the same path. */
+  void insert(const AudioFileInfo &info);
+
+  /** @brief Remove the entries below a directory whose path is not in seen, i.e. deleted files.
+   *  @return The number of entries removed.
+   */
+  size_t prune(const std::filesystem::path &directory, const std::unordered_set<std::string> &seen);
+
+  size_t size() const;
+
+  void clear();
+
+private:
+  mutable std::mutex m_mutex;
+  std::filesystem::path m_index_path;
+  std::unordered_map<std::string, AudioFileInfo> m_entries;
+  bool m_dirty{false};
+};
+
+} // namespace miniaudioengine
+
+#endif // __FILE_INDEX_H__
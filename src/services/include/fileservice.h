@@ -2,11 +2,13 @@
 #define __FILE_SYSTEM_H__
 
 #include "file.h"
+#include "fileindex.h"
 
 #include <filesystem>
 #include <vector>
 #include <string>
 #include <memory>
+#include <mutex>
 #include <optional>
 
 namespace miniaudioengine
@@ -25,6 +27,15 @@ enum class PathType
   All,
 };
 
+/** @struct FileScanOptions
+ *  @brief How FileService::scan_audio_files() walks a directory.
+ */
+struct FileScanOptions
+{
+  bool recursive{true};
+  unsigned int max_threads{0}; // Scanner threads, 0 for one per hardware thread
+};
+
 /** @class FileService
  *  @brief Singleton class for managing file system operations.
  */
@@ -42,14 +53,51 @@ public:
 
 	std::vector<std::filesystem::path> list_directory(const std::filesystem::path &path, PathType type = PathType::All) const;
   std::vector<std::filesystem::path> list_wav_files_in_directory(const std::filesystem::path &path) const;
+
+  /** @brief Lists the audio files directly in a directory, compressed formats included. See is_audio_extension(). */
+  std::vector<std::filesystem::path> list_audio_files_in_directory(const std::filesystem::path &path) const;
   std::vector<std::filesystem::path> list_midi_files_in_directory(const std::filesystem::path &path) const;
 
+  /** @brief Creates a File for every audio file directly in a directory.
+   *  @note For large sample libraries prefer scan_audio_files(), which only reads file headers.
+   */
   FileList get_audio_files(const std::filesystem::path &directory) const;
   FileList get_midi_files(const std::filesystem::path &directory) const;
 
   FilePtr get_audio_file(const std::filesystem::path &file_path) const;
+
+  /** @brief Creates a File for an audio file found by scan_audio_files(). */
+  FilePtr get_audio_file(const AudioFileInfo &info) const { return get_audio_file(info.path); }
+
+  /** @brief Finds the audio files in a directory and reads their format from their headers.
+   *  Directories are walked and headers probed on a pool of threads. A file already in the index
+   *  with the same size and write time is not opened at all, and the index is saved afterwards if
+   *  one is set, so the next launch only probes new and changed files. No File is created; open
+   *  the ones that are used with get_audio_file().
+   *  @param directory The directory to scan.
+   *  @param options Recursion and thread count.
+   *  @return The readable audio files sorted by path, empty if the directory does not exist.
+   */
+  AudioFileInfoList scan_audio_files(const std::filesystem::path &directory, const FileScanOptions &options = FileScanOptions()) const;
+
+  /** @brief Keep the metadata index of scanned files in an index file, loading the entries it holds.
+   *  Without one the index only lasts as long as the FileService.
+   *  @return False if the file exists but is not a valid index; it is rebuilt by the next scan.
+   */
+  bool set_index_path(const std::filesystem::path &index_path) { return m_index.open(index_path); }
+
+  std::filesystem::path get_index_path() const { return m_index.get_index_path(); }
+
+  /** @brief Returns the number of files in the metadata index. */
+  size_t get_index_size() const { return m_index.size(); }
   FilePtr get_midi_file(const std::filesystem::path &file_path) const;
 
+  /** @brief Creates a File for a WAV file that a track will record to.
+   *  @param file_path The WAV file to write. It is created when recording starts, overwritten if it exists.
+   *  @return FilePtr on success, or nullptr if the directory does not exist or the path is not a .wav file.
+   */
+  FilePtr create_audio_file(const std::filesystem::path &file_path) const;
+
   /** @brief Checks if a specified path exists.
    *  @param path The path to check.
    *  @return True if the path exists, false otherwise.
@@ -80,6 +128,22 @@ public:
     return (std::filesystem::is_regular_file(path, ec) && path.extension() == ".wav");
   }
 
+  /** @brief Checks if a path has the extension of an audio format the engine streams, ignoring case.
+   *  WAV, AIFF, FLAC, Ogg (Vorbis and Opus) and MP3. Formats other than PCM and float WAV are
+   *  decoded by libsndfile on the shared DecodePool.
+   */
+  static bool is_audio_extension(const std::filesystem::path &path);
+
+  /** @brief Checks if a specified path is an audio file of a streamed format.
+   *  @param path The path to check.
+   *  @return True if the path is a regular file with an audio extension, false otherwise.
+   */
+  inline bool is_audio_file(const std::filesystem::path &path) const
+  {
+    std::error_code ec;
+    return std::filesystem::is_regular_file(path, ec) && is_audio_extension(path);
+  }
+
   /** @brief Checks if a specified path is a MIDI file.
    *  @param path The path to check.
    *  @return True if the path is a MIDI file, false otherwise.
@@ -120,7 +184,15 @@ public:
     return path.is_relative() ? std::filesystem::current_path() / path.lexically_normal() : path;
   }
 
-	void save_to_wav_file(std::vector<float> audio_buffer, const std::filesystem::path &path);
+  /** @brief Writes interleaved float audio to a WAV file.
+   *  @param audio_buffer Interleaved samples, a whole number of frames.
+   *  @param path The path of the WAV file, overwritten if it exists.
+   *  @param channels Number of interleaved channels in audio_buffer.
+   *  @param sample_rate Sample rate in Hz.
+   *  @return True if every frame was written, false otherwise.
+   */
+  bool save_to_wav_file(const std::vector<float> &audio_buffer, const std::filesystem::path &path,
+                        unsigned int channels = 2, unsigned int sample_rate = 44100) const;
 
   /** @brief Loads audio data from a WAV (or libsndfile-compatible audio) file.
    *  @param path The path to the audio file.
@@ -133,6 +205,16 @@ public:
    *  @return FilePtr on success, or std::nullopt if the path is invalid.
    */
   FilePtr read_midi_file(const std::filesystem::path &path) const;
+
+private:
+  /** @brief Returns the index entry for a file, reading its header if the index has none for its size and write time.
+   *  @param header_read Set to true if the header was read.
+   *  @return The entry, invalid if the header cannot be read, or std::nullopt if the file cannot be stat'ed.
+   */
+  std::optional<AudioFileInfo> probe_audio_file(const std::filesystem::directory_entry &entry, bool &header_read) const;
+
+  mutable FileIndex m_index;
+  mutable std::mutex m_scan_mutex; // One scan at a time updates and saves the index
 };
 
 }  // namespace miniaudioengine
@@ -0,0 +1,82 @@
+#ifndef __GAIN_PROCESSOR_H__
+#define __GAIN_PROCESSOR_H__
+
+#include "parameterregistry.h"
+#include "processor.h"
+#include "transport.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace miniaudioengine
+{
+
+/** @class GainProcessor
+ *  @brief Smoothed, automatable gain and pan for a Track's effects chain.
+ *  Both are Parameters in the processor's registry, so they can be set from any thread, mapped to
+ *  MIDI controllers and automated on the session timeline. Gain ramps exponentially per sample,
+ *  pan linearly, so moves never zipper. Pan only applies to stereo blocks and keeps unity gain at
+ *  the centre: one side is attenuated as the other is panned towards.
+ */
+class GainProcessor : public framework::IProcessor
+{
+public:
+  static constexpr const char *GAIN = "gain";
+  static constexpr const char *PAN = "pan";
+
+  /** @brief Highest gain, +6 dB. */
+  static constexpr float MAX_GAIN = 2.0f;
+
+  GainProcessor();
+  ~GainProcessor() override = default;
+
+  GainProcessor(const GainProcessor &) = delete;
+  GainProcessor &operator=(const GainProcessor &) = delete;
+
+  /** @brief Set the linear gain, 0 to MAX_GAIN. */
+  void set_gain(float gain) noexcept { p_gain->set_value(gain); }
+  float get_gain() const noexcept { return p_gain->get_value(); }
+
+  /** @brief Set the pan position, -1 (hard left) to 1 (hard right). */
+  void set_pan(float pan) noexcept { p_pan->set_value(pan); }
+  float get_pan() const noexcept { return p_pan->get_value(); }
+
+  const framework::ParameterPtr &get_gain_parameter() const { return p_gain; }
+  const framework::ParameterPtr &get_pan_parameter() const { return p_pan; }
+
+  /** @brief Returns the registry, e.g. to map MIDI controllers with map_midi_controller(GAIN, ...). */
+  framework::ParameterRegistry &get_parameters() { return m_parameters; }
+
+  /** @brief Follow automation on a session transport instead of the processor's own frame count.
+   *  @note Control thread only, before the processor is rendered.
+   */
+  void set_transport(const dataplane::TransportPtr &transport) { p_transport = transport; }
+
+  void prepare(unsigned int sample_rate, unsigned int max_block, unsigned int channels) override;
+
+  void process(framework::AudioBlockView &block, const midi::MidiEventList &events) noexcept override;
+
+  void reset() override;
+
+  std::string to_string() const override;
+
+private:
+  /** @brief Audio thread: the timeline frame of the block, advancing the processor's clocks. */
+  uint64_t advance_timeline(unsigned int n_frames) noexcept;
+
+  framework::ParameterRegistry m_parameters;
+  framework::ParameterPtr p_gain;
+  framework::ParameterPtr p_pan;
+  dataplane::TransportPtr p_transport;
+
+  // Audio thread only
+  std::vector<float> m_side_gains;
+  uint64_t m_frame_position{0};
+  uint64_t m_transport_block_start{UINT64_MAX};
+  uint64_t m_transport_cursor{0};
+};
+
+} // namespace miniaudioengine
+
+#endif // __GAIN_PROCESSOR_H__
@@ -0,0 +1,326 @@
+#ifndef __LOOP_ENGINE_H__
+#define __LOOP_ENGINE_H__
+
+#include "commandqueue.h"
+#include "processor.h"
+#include "rcupointer.h"
+#include "realtimememory.h"
+#include "transport.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace miniaudioengine
+{
+
+/** @enum eLoopState
+ *  @brief Where a Loop is in its record/play cycle.
+ */
+enum class eLoopState : unsigned int
+{
+  Idle,            // Silent. Keeps any recorded content
+  WaitingToRecord, // Record scheduled for a later frame
+  Recording,       // Writing the input from the start of the buffer, the loop length grows
+  WaitingToPlay,   // Play scheduled for a later frame
+  Playing,         // Repeating the recorded content
+  Overdubbing      // Repeating the recorded content while summing the input into it
+};
+
+std::string to_string(eLoopState state);
+
+/** @struct LoopEngineConfig
+ *  @brief Format and limits of a LoopEngine. Every loop buffer is allocated for the longest loop up front.
+ */
+struct LoopEngineConfig
+{
+  unsigned int sample_rate{48000};
+  unsigned int channels{2};
+  double max_loop_seconds{60.0}; // Capacity of every loop buffer
+  size_t max_loops{8};
+  bool monitor_input{true}; // Pass the live input through alongside the loops
+
+  std::string to_string() const
+  {
+    return "LoopEngineConfig(SampleRate=" + std::to_string(sample_rate) +
+           ", Channels=" + std::to_string(channels) +
+           ", MaxLoopSeconds=" + std::to_string(max_loop_seconds) +
+           ", MaxLoops=" + std::to_string(max_loops) +
+           ", MonitorInput=" + std::string(monitor_input ? "true" : "false") + ")";
+  }
+};
+
+/** @class Loop
+ *  @brief One loop of a LoopEngine: a preallocated planar buffer and its record/play state.
+ *  The buffer is allocated, touched and page-locked when the loop is created, so recording into it
+ *  never faults a page in on the audio thread. The state and length are written by the audio thread
+ *  and can be read from any thread; transitions are requested through LoopEngine.
+ */
+class Loop
+{
+public:
+  /** @param id Identifier unique within the LoopEngine.
+   *  @param capacity_frames Longest loop the buffer holds.
+   *  @param channels Number of planar channels.
+   *  @param sample_rate Sample rate in Hz.
+   */
+  Loop(unsigned int id, size_t capacity_frames, unsigned int channels, unsigned int sample_rate);
+  ~Loop();
+
+  Loop(const Loop &) = delete;
+  Loop &operator=(const Loop &) = delete;
+
+  unsigned int get_id() const { return m_id; }
+
+  eLoopState get_state() const { return m_state.load(std::memory_order_acquire); }
+
+  bool is_muted() const { return m_muted.load(std::memory_order_relaxed); }
+
+  /** @brief Silence the loop's playback without stopping it, so it stays in time. */
+  void set_muted(bool muted) { m_muted.store(muted, std::memory_order_relaxed); }
+
+  /** @brief Returns the recorded length in frames. Grows while the loop records. */
+  size_t get_length_frames() const { return m_length.load(std::memory_order_acquire); }
+
+  double get_duration_seconds() const { return static_cast<double>(get_length_frames()) / m_sample_rate; }
+
+  size_t get_capacity_frames() const { return m_capacity_frames; }
+
+  unsigned int get_channels() const { return m_channels; }
+
+  /** @brief Returns true if the OS locked the buffer's pages in memory when it was allocated. */
+  bool is_locked() const { return m_locked; }
+
+  std::string to_string() const;
+
+private:
+  friend class LoopEngine;
+
+  float *get_channel(unsigned int channel) noexcept { return p_samples + channel * m_capacity_frames; }
+
+  void set_state(eLoopState state) noexcept { m_state.store(state, std::memory_order_release); }
+
+  void finish_recording() noexcept;
+
+  unsigned int write_tail(const float *input, size_t stride, unsigned int frames) noexcept;
+
+  const unsigned int m_id;
+  const size_t m_capacity_frames;
+  const unsigned int m_channels;
+  const unsigned int m_sample_rate;
+
+  float *p_samples{nullptr};
+  size_t m_size_bytes{0};
+  bool m_locked{false};
+
+  std::atomic<eLoopState> m_state{eLoopState::Idle};
+  std::atomic<bool> m_muted{false};
+  std::atomic<size_t> m_length{0};
+
+  // Audio thread only
+  size_t m_position{0};
+  size_t m_record_target{0}; // Frames to record before playing, 0 records until told otherwise
+
+  // Audio thread only: latency compensation of the take. The first m_record_latency input frames predate
+  // the record command and are skipped, and once the loop closes the same number of late frames are
+  // written to its end while it already plays.
+  size_t m_record_latency{0};
+  size_t m_skip_remaining{0};
+  size_t m_tail_position{0};
+  size_t m_tail_remaining{0};
+};
+
+using LoopPtr = std::shared_ptr<Loop>;
+using LoopList = std::vector<LoopPtr>;
+
+/** @enum eLoopCommand
+ *  @brief Loop transition requested by a control thread.
+ */
+enum class eLoopCommand : unsigned int
+{
+  Record,
+  Play,
+  Overdub,
+  Stop,
+  Cancel
+};
+
+/** @struct LoopCommand
+ *  @brief A LoopEngine transition and the engine frame it takes effect on.
+ */
+struct LoopCommand
+{
+  eLoopCommand command{eLoopCommand::Stop};
+  unsigned int loop_id{0};
+  uint64_t frame{0}; // Engine frame, 0 for the next block
+  size_t length_frames{0};
+};
+
+/** @class LoopEngine
+ *  @brief Records, overdubs and plays back loops of a Track's input, on the audio thread.
+ *  Add the engine to a Track with add_effects_processor(): every block it sees holds the track's
+ *  live input, which is written into recording loops and summed into overdubbing ones, and every
+ *  playing loop is summed into the block on top of the input.
+ *  Transitions are commands stamped with the engine frame they take effect on. Control threads push
+ *  them through a lock-free CommandQueue and the audio thread splits its block at that exact frame,
+ *  so a loop started on a bar boundary is sample accurate whatever the block size. Loops are created
+ *  and deleted on control threads and published to the audio thread through an RcuPointer, so
+ *  starting, stopping or deleting a loop never allocates or locks on the audio thread.
+ */
+class LoopEngine : public framework::IProcessor
+{
+public:
+  using Config = LoopEngineConfig;
+
+  /** @brief Frame stamp for a command that takes effect at the start of the next block. */
+  static constexpr uint64_t NEXT_BLOCK = 0;
+
+  explicit LoopEngine(const Config &config = Config());
+  ~LoopEngine() override = default;
+
+  LoopEngine(const LoopEngine &) = delete;
+  LoopEngine &operator=(const LoopEngine &) = delete;
+
+  /** @brief Allocate a new, idle loop.
+   *  @return The loop, or nullptr if max_loops loops exist.
+   *  @note Control thread only. Allocates and locks the loop buffer.
+   */
+  LoopPtr create_loop();
+
+  /** @brief Remove a loop. The audio thread stops rendering it from its next block.
+   *  @return False if no loop has this id.
+   */
+  bool delete_loop(unsigned int loop_id);
+
+  void delete_all_loops();
+
+  LoopPtr get_loop(unsigned int loop_id) const;
+  LoopList get_loops() const;
+  size_t get_loop_count() const;
+
+  /** @brief Start recording a loop from the start of its buffer, replacing its content.
+   *  @param at_frame Engine frame recording starts on, or NEXT_BLOCK.
+   *  @param length_frames Frames to record before the loop starts playing. 0 records until play(),
+   *         overdub() or stop(), or until the buffer is full.
+   *  @return False if the loop does not exist or the command queue is full.
+   */
+  bool record(unsigned int loop_id, uint64_t at_frame = NEXT_BLOCK, size_t length_frames = 0);
+
+  /** @brief Start playing a loop from its start, or close a recording and play it back seamlessly. */
+  bool play(unsigned int loop_id, uint64_t at_frame = NEXT_BLOCK);
+
+  /** @brief Sum the input into a playing loop, or close a recording and overdub its next lap. */
+  bool overdub(unsigned int loop_id, uint64_t at_frame = NEXT_BLOCK);
+
+  /** @brief Stop a loop. A recording is closed and kept, the next play() starts from the top. */
+  bool stop(unsigned int loop_id, uint64_t at_frame = NEXT_BLOCK);
+
+  /** @brief Stop a loop and drop a recording in progress, or withdraw a waiting record or play. */
+  bool cancel(unsigned int loop_id);
+
+  /** @brief Stamp commands on a session transport instead of the engine's own frame count, so loops
+   *  line up with its bars and with tracks quantised to it. While the transport is stopped, commands
+   *  for later frames wait and loops keep playing.
+   *  @note Control thread only, before the engine is rendered.
+   */
+  void set_transport(const dataplane::TransportPtr &transport) { p_transport = transport; }
+
+  const dataplane::TransportPtr &get_transport() const { return p_transport; }
+
+  /** @brief Receive the latency of the engine's input from AudioGraph::compile(), e.g. the lookahead
+   *  of effects before the engine in the chain. Recordings and overdubs are shifted back by it, so
+   *  they line up with the frames their commands were stamped on. Applies from the next record().
+   */
+  void set_input_latency(unsigned int frames) override { m_input_latency.store(frames, std::memory_order_relaxed); }
+
+  unsigned int get_input_latency() const { return m_input_latency.load(std::memory_order_relaxed); }
+
+  /** @brief Returns the frame the next block starts on, on the timeline commands are stamped on:
+   *  the transport's if one is set, otherwise the number of frames the engine has processed.
+   */
+  uint64_t get_frame_position() const;
+
+  /** @brief Returns the first frame after the current position on a multiple of quantum_frames,
+   *  e.g. the next bar for quantum_frames = samples per bar.
+   */
+  uint64_t get_next_boundary(uint64_t quantum_frames) const;
+
+  const Config &get_config() const { return m_config; }
+
+  size_t get_capacity_frames() const { return m_capacity_frames; }
+
+  void prepare(unsigned int sample_rate, unsigned int max_block, unsigned int channels) override;
+
+  void process(framework::AudioBlockView &block, const midi::MidiEventList &events) noexcept override;
+
+  /** @brief Stop every loop, keeping its content, drop scheduled commands and rewind the engine clock.
+   *  @note Control thread only, while the engine is not being rendered.
+   */
+  void reset() override;
+
+  std::string to_string() const override;
+
+private:
+  /** @brief Commands queued from control threads, and scheduled on the audio thread, at one time. */
+  static constexpr size_t MAX_PENDING_COMMANDS = 256;
+
+  static constexpr uint64_t NO_TRANSPORT_BLOCK = UINT64_MAX;
+
+  /** @struct LoopTable
+   *  @brief Immutable copy of the loops read by the audio thread.
+   */
+  struct LoopTable
+  {
+    LoopList loops;
+  };
+
+  bool push_command(eLoopCommand command, unsigned int loop_id, uint64_t at_frame, size_t length_frames = 0);
+
+  void publish_locked();
+
+  Loop *find_loop(const LoopTable &table, unsigned int loop_id) const noexcept;
+
+  void schedule(const LoopTable &table, const LoopCommand &command, uint64_t block_start) noexcept;
+
+  void apply(Loop &loop, const LoopCommand &command) noexcept;
+
+  void render(const LoopTable &table, framework::AudioBlockView &block, unsigned int offset, unsigned int frames) noexcept;
+
+  void render_loop(Loop &loop, framework::AudioBlockView &block, unsigned int offset, unsigned int frames) noexcept;
+
+  void layer_input(Loop &loop, unsigned int input_offset, size_t position, unsigned int frames) noexcept;
+
+  const Config m_config;
+  const size_t m_capacity_frames;
+
+  mutable std::mutex m_loops_mutex;
+  LoopList m_loops;
+  unsigned int m_next_loop_id{1};
+  framework::RcuPointer<LoopTable> m_table;
+
+  framework::CommandQueue<LoopCommand> m_commands;
+
+  // Audio thread only: commands stamped for a later block, and a copy of the block's input
+  std::vector<LoopCommand> m_pending;
+  size_t m_pending_count{0};
+  std::vector<float> m_input;
+  unsigned int m_max_block{0};
+  bool m_format_valid{false};
+
+  std::atomic<uint64_t> m_frame_position{0};
+  std::atomic<unsigned int> m_input_latency{0};
+
+  // Audio thread only: where on the transport timeline the next pass of the current device block starts
+  dataplane::TransportPtr p_transport;
+  uint64_t m_transport_block_start{NO_TRANSPORT_BLOCK};
+  uint64_t m_transport_cursor{0};
+};
+
+using LoopEnginePtr = std::shared_ptr<LoopEngine>;
+
+} // namespace miniaudioengine
+
+#endif // __LOOP_ENGINE_H__
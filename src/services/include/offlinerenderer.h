@@ -0,0 +1,142 @@
+#ifndef __OFFLINE_RENDERER_H__
+#define __OFFLINE_RENDERER_H__
+
+#include "filewriter.h"
+#include "samplecache.h"
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace miniaudioengine
+{
+
+typedef std::shared_ptr<class Track> TrackPtr;
+using TrackList = std::vector<TrackPtr>;
+
+/** @struct OfflineRenderConfig
+ *  @brief Parameters of a headless render to a file.
+ */
+struct OfflineRenderConfig
+{
+  /** @brief Output sample rate in Hz. 0 uses the sample rate of the first input file. */
+  unsigned int sample_rate{0};
+
+  /** @brief Number of channels in the rendered file. */
+  unsigned int channels{2};
+
+  /** @brief Frames rendered per block. Large blocks amortise the per-block graph overhead. */
+  unsigned int frames_per_block{8192};
+
+  /** @brief Frames rendered after the last input ends, so effect tails are not cut off. */
+  unsigned long long tail_frames{0};
+
+  /** @brief Stop after this many frames. 0 renders until every input and the tail have ended. */
+  unsigned long long max_frames{0};
+
+  /** @brief Worker threads that render independent tracks alongside the render thread. */
+  unsigned int worker_threads{0};
+
+  /** @brief Sample encoding of the rendered file. */
+  adapters::eSampleFormat format{adapters::eSampleFormat::Float32};
+
+  /** @brief Filter used to convert input files whose sample rate differs from the render's. */
+  framework::eResampleQuality resample_quality{framework::eResampleQuality::High};
+
+  std::string to_string() const
+  {
+    return "OfflineRenderConfig(SampleRate=" + std::to_string(sample_rate) +
+           ", Channels=" + std::to_string(channels) +
+           ", FramesPerBlock=" + std::to_string(frames_per_block) +
+           ", TailFrames=" + std::to_string(tail_frames) +
+           ", MaxFrames=" + std::to_string(max_frames) +
+           ", WorkerThreads=" + std::to_string(worker_threads) +
+           ", Format=" + framework::to_string(format) +
+           ", ResampleQuality=" + framework::to_string(resample_quality) + ")";
+  }
+};
+
+/** @struct OfflineRenderResult
+ *  @brief Outcome and throughput of one offline render.
+ */
+struct OfflineRenderResult
+{
+  bool success{false};
+  std::filesystem::path output_path;
+  unsigned int sample_rate{0};
+  unsigned long long frames_rendered{0};
+
+  /** @brief Duration of the rendered audio. */
+  double audio_seconds{0.0};
+
+  /** @brief Wall-clock time spent rendering and writing, including the final flush. */
+  double render_seconds{0.0};
+
+  /** @brief audio_seconds / render_seconds, e.g. 40 means forty times faster than playback. */
+  double realtime_multiple{0.0};
+
+  std::string to_string() const
+  {
+    return "OfflineRenderResult(Success=" + std::string(success ? "true" : "false") +
+           ", Output=" + output_path.string() +
+           ", SampleRate=" + std::to_string(sample_rate) +
+           ", Frames=" + std::to_string(frames_rendered) +
+           ", AudioSeconds=" + std::to_string(audio_seconds) +
+           ", RenderSeconds=" + std::to_string(render_seconds) +
+           ", RealtimeMultiple=" + std::to_string(realtime_multiple) + ")";
+  }
+};
+
+/** @struct OfflineRenderJob
+ *  @brief One mix to render: the tracks to sum, where to write them and how.
+ */
+struct OfflineRenderJob
+{
+  TrackList tracks;
+  std::filesystem::path output_path;
+  OfflineRenderConfig config;
+};
+
+/** @class OfflineRenderer
+ *  @brief Bounces tracks to a WAV file as fast as the CPU allows.
+ *  The tracks are compiled into a private AudioGraph with no device attached:
+ *  OutputNode <- master MixerNode <- per track ProcessorNode (effects) <- InputNode (file samples).
+ *  The render thread feeds every input from memory and pulls the graph block by block, so the
+ *  result is deterministic and does not depend on disk or scheduling jitter. Rendered blocks are
+ *  handed to a FileWriter, which encodes them on its own thread while the next block renders.
+ *  Inputs at another sample rate are converted once when they are loaded, not block by block.
+ *  @note A track's effects must not be rendered by a live stream and an offline render at the same time.
+ */
+class OfflineRenderer
+{
+public:
+  /** @param sample_cache Cache used to load input files. nullptr loads them privately for each render. */
+  explicit OfflineRenderer(const SampleCachePtr &sample_cache = nullptr) : p_sample_cache(sample_cache) {}
+  ~OfflineRenderer() = default;
+
+  /** @brief Render the audio file inputs of a set of tracks into one file.
+   *  Tracks without an audio file input are skipped with a warning.
+   */
+  OfflineRenderResult render(const TrackList &tracks, const std::filesystem::path &output_path,
+                             const OfflineRenderConfig &config = OfflineRenderConfig()) const;
+
+  /** @brief Render several jobs, one per core.
+   *  Jobs that share a track or an effects processor, e.g. two renders of one session, are rendered one
+   *  after another on the same thread, in the order of jobs, since a render runs the tracks' own processors.
+   *  @param jobs Jobs to render.
+   *  @param max_threads Largest number of jobs rendered at once. 0 uses std::thread::hardware_concurrency().
+   *  @return One result per job, in the order of jobs.
+   */
+  std::vector<OfflineRenderResult> render_parallel(const std::vector<OfflineRenderJob> &jobs, unsigned int max_threads = 0) const;
+
+private:
+  SampleBufferPtr load(const std::filesystem::path &path, unsigned int sample_rate,
+                       framework::eResampleQuality quality) const;
+
+  SampleCachePtr p_sample_cache;
+};
+
+} // namespace miniaudioengine
+
+#endif // __OFFLINE_RENDERER_H__
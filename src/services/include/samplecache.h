@@ -0,0 +1,115 @@
+#ifndef __SAMPLE_CACHE_H__
+#define __SAMPLE_CACHE_H__
+
+#include "resampler.h"
+#include "samplebuffer.h"
+
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace miniaudioengine
+{
+
+class File;
+
+using FilePtr = std::shared_ptr<File>;
+using SampleBufferPtr = framework::SampleBufferPtr;
+
+/** @class SampleCache
+ *  @brief Decodes audio files once into shared, immutable SampleBuffers.
+ *  Float32 WAV files are memory-mapped, everything else is decoded into an aligned buffer.
+ *  Every Track or voice that plays the same file shares one buffer, so retriggering a sample
+ *  never touches the disk or libsndfile. Entries are evicted least-recently-used first once the
+ *  cache exceeds its memory budget; evicted buffers stay alive while anything still holds them.
+ *  A file can also be cached converted to another sample rate, so a sample played on a device at a
+ *  different rate is resampled once at load time instead of on every block.
+ *  @note Thread-safe. Intended for control threads, not the audio thread.
+ */
+class SampleCache
+{
+public:
+  static constexpr size_t DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+  explicit SampleCache(size_t memory_budget_bytes = DEFAULT_MEMORY_BUDGET) :
+    m_memory_budget(memory_budget_bytes)
+  {}
+  ~SampleCache() = default;
+
+  SampleCache(const SampleCache &) = delete;
+  SampleCache &operator=(const SampleCache &) = delete;
+
+  /** @brief Returns the cached samples for a file, decoding or mapping it on first use.
+   *  @param path Path to the audio file.
+   *  @return The shared samples, or nullptr if the file cannot be loaded.
+   */
+  SampleBufferPtr load(const std::filesystem::path &path);
+
+  /** @brief Returns the cached samples for a File, decoding or mapping it on first use.
+   *  @param file File handle retrieved from FileService.
+   *  @return The shared samples, or nullptr if the file cannot be loaded.
+   */
+  SampleBufferPtr load(const FilePtr &file);
+
+  /** @brief Returns the cached samples for a file at a sample rate, converting them on first use.
+   *  The converted buffer is cached as its own entry alongside the original.
+   *  @param path Path to the audio file.
+   *  @param sample_rate Sample rate of the returned buffer, in Hz. 0 keeps the file's rate.
+   *  @param quality Filter used for the conversion.
+   *  @return The shared samples, or nullptr if the file cannot be loaded.
+   */
+  SampleBufferPtr load(const std::filesystem::path &path, unsigned int sample_rate,
+                       framework::eResampleQuality quality = framework::eResampleQuality::High);
+
+  /** @brief Returns the cached samples for a file without loading it.
+   *  @return The shared samples, or nullptr if the file is not cached.
+   */
+  SampleBufferPtr find(const std::filesystem::path &path);
+
+  /** @brief Drop a file and its resampled copies from the cache. Buffers still in use remain valid. */
+  void evict(const std::filesystem::path &path);
+
+  /** @brief Drop every entry from the cache. */
+  void clear();
+
+  /** @brief Set the memory budget and evict least-recently-used entries until the cache fits. */
+  void set_memory_budget(size_t memory_budget_bytes);
+
+  size_t get_memory_budget() const;
+
+  /** @brief Returns the number of bytes held by cached entries. */
+  size_t get_memory_usage() const;
+
+  /** @brief Returns the number of cached buffers, counting resampled copies separately. */
+  size_t size() const;
+
+private:
+  struct Entry
+  {
+    SampleBufferPtr buffer;
+    std::list<std::string>::iterator lru_position;
+  };
+
+  static std::string get_key(const std::filesystem::path &path);
+
+  SampleBufferPtr find_entry(const std::string &key);
+  SampleBufferPtr insert_entry(const std::string &key, const SampleBufferPtr &buffer);
+  void erase_entry(std::unordered_map<std::string, Entry>::iterator entry);
+  void evict_to_budget();
+
+  mutable std::mutex m_mutex;
+  size_t m_memory_budget;
+  size_t m_memory_usage{0};
+
+  std::list<std::string> m_lru; // Most recently used at the front
+  std::unordered_map<std::string, Entry> m_entries;
+};
+
+using SampleCachePtr = std::shared_ptr<SampleCache>;
+
+} // namespace miniaudioengine
+
+#endif // __SAMPLE_CACHE_H__
@@ -0,0 +1,245 @@
+#ifndef __SAMPLER_H__
+#define __SAMPLER_H__
+
+#include "processor.h"
+#include "rcupointer.h"
+#include "samplebuffer.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace miniaudioengine
+{
+
+/** @struct SamplerZone
+ *  @brief A sample and the notes, velocities and MIDI channel that play it.
+ */
+struct SamplerZone
+{
+  /** @brief Channel of a zone that answers notes on every MIDI channel. */
+  static constexpr unsigned int ANY_CHANNEL = 16;
+
+  framework::SampleBufferPtr samples; // e.g. from SampleCache::load() at the device's sample rate
+  unsigned int low_note{0};
+  unsigned int high_note{127};
+  unsigned int root_note{60}; // Note that plays the sample at its recorded pitch
+  unsigned int low_velocity{1};
+  unsigned int high_velocity{127};
+  unsigned int channel{ANY_CHANNEL};
+  float gain{1.0f};
+  bool pitch_tracking{true};   // False plays every note at the recorded pitch, e.g. drums
+  bool one_shot{false};        // Ignore note off and play the sample to its end, e.g. drums
+  unsigned int choke_group{0}; // A note in a group fades out the others, e.g. open and closed hi-hat. 0 for none
+  double attack_seconds{0.001};
+  double release_seconds{0.05};
+
+  std::string to_string() const;
+};
+
+/** @class Sampler
+ *  @brief Polyphonic sample playback driven by a Track's MIDI input.
+ *  Add the sampler to a Track with add_effects_processor(). The notes the track's MIDI input pushes
+ *  through its lock-free MidiQueue reach process() as the block's events, and every note on starts a
+ *  voice per matching zone on the note's exact frame. Voices live in a fixed pool stored as one array
+ *  per field, so allocating, stealing and envelope updates scan contiguous memory, and each voice is
+ *  rendered with the SIMD kernels straight from its zone's shared SampleBuffer.
+ *  When every voice is in use the quietest releasing voice, or else the oldest one, is stolen: it
+ *  fades out over a few milliseconds in a spare slot instead of clicking off.
+ *  Zones are edited on control threads and published to the audio thread through an RcuPointer.
+ *  Sustain pedal (CC 64), All Sound Off (CC 120) and All Notes Off (CC 123) are honoured.
+ */
+class Sampler : public framework::IProcessor
+{
+public:
+  static constexpr size_t DEFAULT_MAX_VOICES = 128;
+
+  /** @brief Most channels a zone's samples may have. */
+  static constexpr unsigned int MAX_SAMPLE_CHANNELS = 8;
+
+  /** @param max_voices Voices that can sound at once. Every voice is allocated up front. */
+  explicit Sampler(size_t max_voices = DEFAULT_MAX_VOICES);
+  ~Sampler() override = default;
+
+  Sampler(const Sampler &) = delete;
+  Sampler &operator=(const Sampler &) = delete;
+
+  /** @brief Add a zone. The audio thread plays it from its next block.
+   *  @return The zone's id, or 0 if it has no samples or they have more than MAX_SAMPLE_CHANNELS channels.
+   *  @note Control threads only.
+   */
+  unsigned int add_zone(const SamplerZone &zone);
+
+  /** @brief Remove a zone. Voices already playing it finish, its samples are released once they have.
+   *  @return False if no zone has this id.
+   */
+  bool remove_zone(unsigned int zone_id);
+
+  void clear_zones();
+
+  size_t get_zone_count() const;
+
+  size_t get_max_voices() const { return m_max_voices; }
+
+  /** @brief Returns the number of voices sounding at the end of the last block, fading ones included. */
+  size_t get_active_voice_count() const { return m_active_voices.load(std::memory_order_relaxed); }
+
+  /** @brief Returns the number of voices taken from older notes since the last reset(). */
+  uint64_t get_stolen_voice_count() const { return m_stolen_voices.load(std::memory_order_relaxed); }
+
+  void prepare(unsigned int sample_rate, unsigned int max_block, unsigned int channels) override;
+
+  void process(framework::AudioBlockView &block, const midi::MidiEventList &events) noexcept override;
+
+  /** @brief Silence every voice and release the samples of removed zones.
+   *  @note Control thread only, while the sampler is not being rendered.
+   */
+  void reset() override;
+
+  std::string to_string() const override;
+
+private:
+  static constexpr unsigned int MIDI_CHANNELS = 16;
+
+  /** @brief Fade of a stolen or choked voice. */
+  static constexpr double FADE_SECONDS = 0.003;
+
+  /** @enum eVoiceStage
+   *  @brief Where a voice is in its envelope.
+   */
+  enum class eVoiceStage : uint8_t
+  {
+    Attack,  // Level ramps up to 1
+    Sustain, // Level holds at 1
+    Release, // Level ramps down to 0 after note off
+    Fade     // Level ramps down quickly after being stolen or choked. No longer counts as a note
+  };
+
+  /** @struct ZoneEntry
+   *  @brief A zone and its id.
+   */
+  struct ZoneEntry
+  {
+    unsigned int id{0};
+    SamplerZone zone;
+  };
+
+  /** @struct ZoneTable
+   *  @brief Immutable copy of the zones read by the audio thread.
+   */
+  struct ZoneTable
+  {
+    std::vector<ZoneEntry> zones;
+    uint64_t generation{0};
+  };
+
+  /** @struct RetiredSamples
+   *  @brief Samples of a removed zone, kept alive while voices started from its last table may still play them.
+   */
+  struct RetiredSamples
+  {
+    uint64_t generation{0}; // Last table generation holding the zone
+    framework::SampleBufferPtr samples;
+  };
+
+  /** @struct VoicePool
+   *  @brief The state of every voice, stored as one array per field.
+   *  Voices point straight at their samples. The buffers are kept alive by the zone table and, once a
+   *  zone is removed, by the retired list until no voice started from an older table is left.
+   */
+  struct VoicePool
+  {
+    std::vector<const float *> samples;
+    std::vector<size_t> frames;
+    std::vector<unsigned int> channels;
+    std::vector<double> position;  // Frame of the sample the next output reads
+    std::vector<double> increment; // Frames advanced per output frame
+    std::vector<float> gain;
+    std::vector<float> level;      // Envelope level
+    std::vector<float> level_step; // Envelope change per frame while ramping
+    std::vector<unsigned int> stage_frames; // Frames left in the attack, release or fade
+    std::vector<unsigned int> release_frames;
+    std::vector<eVoiceStage> stage;
+    std::vector<unsigned char> note;
+    std::vector<unsigned char> channel;
+    std::vector<unsigned char> one_shot;
+    std::vector<unsigned char> sustained; // Note off arrived while the sustain pedal was down
+    std::vector<unsigned int> choke_group;
+    std::vector<uint64_t> started;    // Note on counter, for oldest-first stealing
+    std::vector<uint64_t> generation; // Zone table the voice was started from
+
+    void resize(size_t voices);
+  };
+
+  void publish_locked();
+
+  void prune_retired_locked();
+
+  void handle_message(const ZoneTable &table, const midi::MidiMessage &message) noexcept;
+
+  void note_on(const ZoneTable &table, unsigned int channel, unsigned int note, unsigned int velocity) noexcept;
+
+  void note_off(unsigned int channel, unsigned int note) noexcept;
+
+  void set_sustain(unsigned int channel, bool down) noexcept;
+
+  void release_all(unsigned int channel) noexcept;
+
+  void fade_all(unsigned int channel) noexcept;
+
+  void start_voice(const ZoneTable &table, const SamplerZone &zone, unsigned int note, unsigned int channel,
+                   unsigned int velocity) noexcept;
+
+  unsigned int allocate_voice() noexcept;
+
+  void release_voice(unsigned int voice) noexcept;
+
+  void fade_voice(unsigned int voice) noexcept;
+
+  void free_voice(size_t active_index) noexcept;
+
+  void render(framework::AudioBlockView &block) noexcept;
+
+  bool render_voice(unsigned int voice, framework::AudioBlockView &block) noexcept;
+
+  size_t read_voice(unsigned int voice, size_t frames) noexcept;
+
+  const size_t m_max_voices;
+  const size_t m_pool_size; // max_voices plus spare slots for fading voices
+
+  mutable std::mutex m_zones_mutex;
+  std::vector<ZoneEntry> m_zones;
+  std::vector<RetiredSamples> m_retired;
+  unsigned int m_next_zone_id{1};
+  uint64_t m_generation{1};
+  framework::RcuPointer<ZoneTable> m_table;
+
+  std::atomic<uint64_t> m_oldest_generation{0};
+  std::atomic<size_t> m_active_voices{0};
+  std::atomic<uint64_t> m_stolen_voices{0};
+
+  // Audio thread only
+  VoicePool m_voices;
+  std::vector<unsigned int> m_active; // Indices of sounding voices, in the first m_active_count entries
+  std::vector<unsigned int> m_free;   // Indices of free voices, in the first m_free_count entries
+  size_t m_active_count{0};
+  size_t m_free_count{0};
+  size_t m_note_count{0}; // Active voices not fading out
+  uint64_t m_note_counter{0};
+  std::array<bool, MIDI_CHANNELS> m_sustain{};
+  std::vector<float> m_scratch; // MAX_SAMPLE_CHANNELS planar channels of max_block frames
+  std::vector<float> m_envelope;
+  unsigned int m_sample_rate{0};
+  unsigned int m_max_block{0};
+  unsigned int m_fade_frames{1};
+};
+
+using SamplerPtr = std::shared_ptr<Sampler>;
+
+} // namespace miniaudioengine
+
+#endif // __SAMPLER_H__
@@ -15,7 +15,12 @@
 #include "device.h"
 #include "file.h"
 #include "miditypes.h"
+#include "meter.h"
+#include "midiqueue.h"
 #include "ringbuffer.h"
+#include "streamconfig.h"
+#include "streamstatistics.h"
+#include "transport.h"
 
 namespace miniaudioengine
 {
@@ -30,6 +35,18 @@ typedef std::shared_ptr<class IInputOutput> IInputOutputPtr;
 typedef std::shared_ptr<class IProcessor> IProcessorPtr;
 }
 
+namespace dataplane
+{
+class AudioGraph;
+class ProcessorNode;
+class InputNode;
+}
+
+namespace adapters
+{
+class FileWriter;
+}
+
 typedef std::shared_ptr<class Track> TrackPtr;
 
 typedef std::function<void(const midi::MidiNoteMessage&, TrackPtr)> MidiNoteOnCallbackFunc;
@@ -54,12 +71,20 @@ typedef std::function<void(eTrackEvent)> TrackEventCallback;
 
 /** @struct TrackStatistics
  *  @brief Statistics related to Track operations.
+ *  A copy of the counters the track's streams update lock-free on the audio path since the last play().
  */
-struct TrackStatistics
+struct TrackStatistics : public framework::StreamStatisticsSnapshot
 {
+  bool is_playing{false};
+
+  /** @brief Drift of a separate input device's clock against the output's, in parts per million. */
+  double input_drift_ppm{0.0};
+
   std::string to_string() const
   {
-    return "TrackStatistics()";
+    return "TrackStatistics(Playing=" + std::string(is_playing ? "true" : "false") +
+           ", InputDrift=" + std::to_string(input_drift_ppm) + " ppm" +
+           ", " + framework::StreamStatisticsSnapshot::to_string() + ")";
   }
 };
 
@@ -72,7 +97,8 @@ public:
   explicit Track() : p_audio_input(nullptr),
                      p_audio_output(nullptr),
                      p_midi_input(nullptr),
-                     p_midi_output(nullptr)
+                     p_midi_output(nullptr),
+                     p_statistics(std::make_shared<framework::StreamStatistics>())
   {}
 
   virtual ~Track() = default;
@@ -151,30 +177,101 @@ public:
    */
   framework::IInputOutputPtr get_midi_output() const;
 
+  /** @brief Append an effect to the track's processing chain.
+   *  The chain is prepared and compiled into the track's AudioGraph on the next play(). While the
+   *  track plays, the effect is inserted after the running chain and crossfaded in without
+   *  restarting the stream.
+   */
   void add_effects_processor(const framework::IProcessorPtr &processor);
 
   std::vector<framework::IProcessorPtr> get_effects_processors() const;
 
   // Playback control
-  /** @brief Start playback of the track. */
-  virtual bool play();
+  /** @brief Start playback of the track.
+   *  @param config Buffer size, sample rate and latency profile used for every stream the track opens.
+   */
+  virtual bool play(const framework::StreamConfig &config = framework::StreamConfig());
+
+  /** @brief Start playback with the track's audio devices streamed by a DeviceService.
+   *  Instead of opening its own streams, the track attaches its Buffer and AudioGraph to the one stream the
+   *  service keeps per device, so every track on a device is rendered in the same callback. stop() detaches it.
+   *  @param config Buffer size, sample rate and latency profile used for every stream the track opens.
+   *  @param device_service Service that owns the device streams. Must outlive the playback.
+   */
+  bool play(const framework::StreamConfig &config, DeviceService &device_service);
 
   /** @brief Stop playback of the track. */
   virtual bool stop();
 
+  /** @brief Keep the track silent until a frame of the session transport, e.g. the next bar line.
+   *  Call before or during play(). The track's graph is not rendered until the frame, so it starts from
+   *  its first sample exactly there. Only applies to tracks streamed by a DeviceService with a transport.
+   *  @param frame Transport frame, e.g. from Transport::get_next_bar_frame().
+   */
+  void schedule_start(uint64_t frame) { p_gate->set_start_frame(frame); }
+
+  /** @brief Silence the track from a frame of the session transport onwards. stop() still releases its streams.
+   *  @param frame Transport frame, e.g. from Transport::get_next_beat_frame().
+   */
+  void schedule_stop(uint64_t frame) { p_gate->set_stop_frame(frame); }
+
+  /** @brief Keep the track silent until the session transport next starts, then start it on the transport's first frame.
+   *  Call before play(). Tracks armed together start sample aligned. A start frame set with schedule_start() is kept.
+   */
+  void arm_start();
+
+  /** @brief Undo arm_start() for a track that will not be played after all, so it does not wait for a start that never comes. */
+  void disarm_start();
+
+  /** @brief Returns true once the audio input file has read ahead at least frames, or to the end of the file.
+   *  Tracks without an open audio input file are always prerolled.
+   */
+  bool is_prerolled(size_t frames) const;
+
+  /** @brief Jump the audio input file to a frame, instantly if the frame is inside a cue point's preload.
+   *  @return False if the track has no audio input file.
+   */
+  bool seek(uint64_t frame);
+
+  /** @brief Returns the frame of the audio input file playback is at, or 0 without one. */
+  uint64_t get_position() const;
+
+  /** @brief Loop [start_frame, end_frame) of the audio input file.
+   *  @return False if the track has no audio input file or the region is too short to loop.
+   */
+  bool set_loop_region(uint64_t start_frame, uint64_t end_frame);
+
+  /** @brief Play the audio input file through the end of its loop region.
+   *  @return False if the track has no audio input file.
+   */
+  bool clear_loop_region();
+
+  /** @brief Add a cue point to the audio input file, preloading its first frames so seeks to it start instantly.
+   *  @return False if the track has no audio input file or the frame cannot be decoded.
+   */
+  bool add_cue_point(uint64_t frame, double preload_seconds = File::DEFAULT_CUE_PRELOAD_SECONDS);
+
+  /** @brief Remove a cue point from the audio input file.
+   *  @return False if the track has no audio input file or no cue point at the frame.
+   */
+  bool remove_cue_point(uint64_t frame);
+
   /** @brief Check if the track is currently playing.
    *  @return True if the track is playing, false otherwise.
    */
   virtual bool is_playing();
 
   /** @brief Get track statistics.
+   *  Only reads atomics, so it can be polled at any rate without stalling the audio thread.
    *  @return TrackStatistics structure containing audio and MIDI statistics.
    */
-  TrackStatistics get_statistics() const
-  {
-    TrackStatistics stats;
-    return stats;
-  }
+  TrackStatistics get_statistics() const;
+
+  /** @brief Meter the track's output, e.g. std::make_shared<framework::Meter>(), or nullptr to stop metering.
+   *  Applied by the next play(). Read the levels with get_meter()->get_reading() at any rate, from any thread.
+   */
+  void set_meter(const framework::MeterPtr &meter) { p_meter = meter; }
+  framework::MeterPtr get_meter() const { return p_meter; }
 
   /** @brief Set a callback function for track events.
    *  @param callback The callback function to set e.g. `void playback_func(miniaudioengine::eTrackEvent event)`.
@@ -216,11 +313,38 @@ public:
   std::string to_string() const;
 
 private:
-  bool open_stream(const framework::IInputOutputPtr &stream, const framework::BufferPtr &buffer);
+  bool open_stream(const framework::IInputOutputPtr &stream, const framework::BufferPtr &buffer, const framework::StreamConfig &config);
+
+  unsigned int get_stream_channels() const;
+
+  /** @brief Returns the audio input as a File, or nullptr if it is a device or missing. */
+  FilePtr get_input_file() const;
+
+  bool build_audio_graph(const framework::BufferPtr &buffer, const framework::StreamConfig &config);
+
+  /** @brief Returns true if the track records its audio input device into its audio output file. */
+  bool is_recording_track() const;
+
+  bool start_recording(const framework::StreamConfig &config);
+
+  /** @brief Returns true if the track's audio input and output are one device that can open a full-duplex stream. */
+  bool is_duplex_track(const framework::StreamConfig &config) const;
+
+  bool open_duplex_stream(const framework::BufferPtr &buffer, const framework::StreamConfig &config);
+
+  bool start_playback(const framework::StreamConfig &config, DeviceService *device_service);
+
+  bool attach_device_streams(const framework::BufferPtr &buffer, const framework::StreamConfig &config,
+                             DeviceService &device_service, bool attach_input, bool attach_output);
+
+  void detach_device_streams();
+
+  bool stop_recording();
 
   void handle_midi_message(const midi::MidiMessage& message); // TODO - Remove
 
-  eTrackState m_state = eTrackState::Stopped;
+  // Written by play()/stop(), read from any thread, e.g. statistics pollers and the audio thread
+  std::atomic<eTrackState> m_state{eTrackState::Stopped};
   
   TrackEventCallback m_event_callback;
 
@@ -231,6 +355,40 @@ private:
 
   std::vector<framework::IProcessorPtr> m_effects_processors;
 
+  std::shared_ptr<dataplane::AudioGraph> p_audio_graph;
+
+  // Last effects node before the output node, live inserts go after it
+  std::shared_ptr<dataplane::ProcessorNode> p_effects_node;
+  std::shared_ptr<dataplane::InputNode> p_input_node;
+
+  // MIDI input -> audio thread, drained at the start of every block
+  framework::MidiQueuePtr p_midi_queue;
+
+  // Updated by the output stream, the AudioGraph and the MIDI input
+  framework::StreamStatisticsPtr p_statistics;
+
+  // Measured by the output node of the track's AudioGraph
+  framework::MeterPtr p_meter;
+
+  // Fed by the input device's audio thread while recording to a file output
+  std::shared_ptr<adapters::FileWriter> p_recorder;
+
+  /** @struct SharedStreamRoute
+   *  @brief What the track attached to a device stream owned by a DeviceService.
+   */
+  struct SharedStreamRoute
+  {
+    DevicePtr device;
+    std::shared_ptr<dataplane::AudioGraph> graph;
+    framework::BufferPtr capture;
+  };
+
+  DeviceService *p_device_service{nullptr};
+  std::vector<SharedStreamRoute> m_shared_routes;
+
+  // Transport frames the track's graph sounds between on a shared stream
+  dataplane::TransportGatePtr p_gate{std::make_shared<dataplane::TransportGate>()};
+
   MidiNoteOnCallbackFunc m_note_on_callback;
   MidiNoteOffCallbackFunc m_note_off_callback;
   MidiControlCallbackFunc m_control_change_callback;
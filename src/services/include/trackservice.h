@@ -3,7 +3,9 @@
 
 #include "track.h"
 
+#include <chrono>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 namespace miniaudioengine
@@ -11,14 +13,27 @@ namespace miniaudioengine
 
 /** @class TrackService
  *  @brief The TrackService manages a single-layer of parallel track objects.
+ *  Tracks are added and removed on control threads under a mutex. The audio thread never walks the
+ *  list: each track renders its own graph, and tracks sharing a device stream are mixed from the
+ *  StreamMixer's own route table. Control-side iteration works on a snapshot from get_tracks(), so a
+ *  concurrent add or remove never invalidates it.
  */
 class TrackService
 {
 
 public:
-  TrackService() = default;
+  /** @brief How often wait_for_preroll() checks the tracks' file inputs. */
+  static constexpr std::chrono::milliseconds PREROLL_POLL_INTERVAL{1};
+
+  /** @param device_service Service whose shared device streams the tracks play through.
+   *         nullptr lets every track open its own streams.
+   */
+  explicit TrackService(DeviceService *device_service = nullptr);
   ~TrackService() = default;
 
+  TrackService(const TrackService &) = delete;
+  TrackService &operator=(const TrackService &) = delete;
+
   /** @brief Create a new track.
    *  @return Shared pointer to the new track.
    */
@@ -31,18 +46,39 @@ public:
   bool remove_track(TrackPtr track);
 
   /** @brief Get all tracks in the hierarchy (MainTrack + direct children).
-   *  @return Vector of all track pointers including MainTrack.
+   *  @return A copy of the track list, unaffected by later adds and removes.
    */
-  inline std::vector<TrackPtr> get_tracks() const { return m_tracks; }
+  std::vector<TrackPtr> get_tracks() const;
+
+  /** @brief Returns the number of tracks. */
+  size_t get_track_count() const;
 
   /** @brief Clear all tracks.
    */
   void clear_tracks();
 
-  bool play();
+  /** @brief Start playback of every track, or of none.
+   *  Plays the tracks listed when it is called, so tracks can be added or removed meanwhile.
+   *  Tracks that target the same device are mixed into that device's one shared stream. Every track
+   *  is armed first, so the tracks on shared streams stay silent until the transport starts and then
+   *  all start on its first frame. If a track fails to start, every track started so far is stopped
+   *  and the rest are disarmed again.
+   *  @param config Stream configuration passed to each Track::play().
+   */
+  bool play(const framework::StreamConfig &config = framework::StreamConfig());
   bool stop();
 
+  /** @brief Wait until every playing track's file input has read ahead, e.g. before starting the transport.
+   *  @param frames Frames each file input must have buffered, or fewer at the end of the file.
+   *  @param timeout Longest wait.
+   *  @return False if a track was still not prerolled at the timeout.
+   */
+  bool wait_for_preroll(size_t frames, std::chrono::milliseconds timeout) const;
+
 private:
+  DeviceService *p_device_service;
+
+  mutable std::mutex m_tracks_mutex;
   std::vector<TrackPtr> m_tracks;
 };
 
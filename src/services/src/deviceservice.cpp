@@ -7,84 +7,531 @@
 #include "audioadapter.h"
 #include "midiadapter.h"
 
+// dataplane
+#include "audiograph.h"
+#include "streammixer.h"
+
+#include "logger.h"
+#include "threading.h"
+
+#include <algorithm>
 
 using namespace miniaudioengine;
 using namespace miniaudioengine::adapters;
 
-DeviceService::DeviceService()
+namespace
+{
+
+bool contains(const DeviceList &devices, const DevicePtr &device)
+{
+  return std::find(devices.begin(), devices.end(), device) != devices.end();
+}
+
+/** @brief Keep the handle of every device that did not change, so streams and lookups stay on one handle per device. */
+void reuse_handles(DeviceList &devices, const DeviceList &previous)
+{
+  for (DevicePtr &device : devices)
+  {
+    auto same = std::find_if(previous.begin(), previous.end(), [&device](const DevicePtr &old) { return *old == *device; });
+    if (same != previous.end())
+    {
+      device = *same;
+    }
+  }
+}
+
+void diff_devices(const DeviceList &devices, const DeviceList &previous, DeviceChange &change)
+{
+  for (const DevicePtr &device : devices)
+  {
+    if (!contains(previous, device))
+    {
+      change.added.push_back(device);
+    }
+  }
+  for (const DevicePtr &device : previous)
+  {
+    if (!contains(devices, device))
+    {
+      change.removed.push_back(device);
+    }
+  }
+}
+
+} // namespace
+
+std::string DeviceChange::to_string() const
+{
+  auto names = [](const DeviceList &devices)
+  {
+    std::string text;
+    for (size_t i = 0; i < devices.size(); i++)
+    {
+      text += (i > 0 ? ", " : "") + devices[i]->get_name();
+    }
+    return text;
+  };
+  return "DeviceChange(Added=[" + names(added) + "], Removed=[" + names(removed) +
+         "], DefaultsChanged=" + std::string(defaults_changed ? "true" : "false") + ")";
+}
+
+DeviceService::DeviceService(std::chrono::milliseconds poll_interval) :
+  m_poll_interval(poll_interval)
 {
-  p_audio_adapter = std::make_shared<AudioAdapter>();
-  p_midi_adapter = std::make_shared<MidiAdapter>();
+  m_poll_thread = std::jthread([this](std::stop_token stop_token) { poll(stop_token); });
 }
 
-DeviceService::~DeviceService() = default;
+DeviceService::~DeviceService()
+{
+  // Close shared streams before their mixers, and the graphs they render, are released
+  std::lock_guard<std::mutex> lock(m_streams_mutex);
+  for (auto &[id, stream] : m_streams)
+  {
+    if (stream.is_open)
+    {
+      stream.device->close_stream();
+    }
+  }
+}
 
 DevicePtr DeviceService::get_audio_device(const unsigned int id) const
 {
-  for (const auto& device : get_audio_devices())
+  const DeviceTablePtr table = get_table();
+  auto found = table->audio_by_id.find(id);
+  if (found == table->audio_by_id.end())
   {
-    if (device->get_id() == id)
-      return device;
+    throw std::out_of_range("Audio device with ID " + std::to_string(id) + " does not exist");
   }
-  throw std::out_of_range("Audio device with ID " + std::to_string(id) + " does not exist");
+  return found->second;
 }
 
 DeviceList DeviceService::get_audio_devices() const
 {
-  return p_audio_adapter->get_devices();
+  return get_table()->audio_devices;
 }
 
 DeviceList DeviceService::get_midi_devices() const
 {
-  return p_midi_adapter->get_devices();
+  return get_table()->midi_devices;
 }
 
 DevicePtr DeviceService::get_midi_device(const unsigned int id) const
 {
-  for (const auto& device : get_midi_devices())
+  const DeviceTablePtr table = get_table();
+  auto found = table->midi_by_id.find(id);
+  if (found == table->midi_by_id.end())
   {
-    if (device->get_id() == id)
-      return device;
+    throw std::out_of_range("MIDI device with ID " + std::to_string(id) + " does not exist");
   }
-  throw std::out_of_range("MIDI device with ID " + std::to_string(id) + " does not exist");
+  return found->second;
 }
 
 DevicePtr DeviceService::get_default_audio_input_device()
 {
-  for (const auto& dev : get_audio_devices())
+  return get_table()->default_audio_input;
+}
+
+DevicePtr DeviceService::get_default_audio_output_device()
+{
+  return get_table()->default_audio_output;
+}
+
+DevicePtr DeviceService::get_default_midi_input_device()
+{
+  return get_table()->default_midi_input;
+}
+
+DevicePtr DeviceService::get_default_midi_output_device()
+{
+  return get_table()->default_midi_output;
+}
+
+bool DeviceService::refresh_devices()
+{
+  std::unique_lock<std::mutex> lock(m_devices_mutex);
+  const uint64_t request = ++m_refresh_requested;
+  m_devices_signal.notify_all();
+  m_devices_signal.wait(lock, [this, request] { return m_refresh_completed >= request; });
+  return m_refresh_changed;
+}
+
+void DeviceService::set_device_change_callback(DeviceChangeCallback callback)
+{
+  std::lock_guard<std::mutex> lock(m_devices_mutex);
+  m_device_change_callback = std::move(callback);
+}
+
+DeviceService::DeviceTablePtr DeviceService::get_table() const
+{
+  std::unique_lock<std::mutex> lock(m_devices_mutex);
+  m_devices_signal.wait(lock, [this] { return p_table != nullptr; });
+  return p_table;
+}
+
+/** @brief Enumerate devices until the service is destroyed, publishing a table whenever they change.
+ *  Runs on its own thread, which alone uses the enumeration adapters.
+ */
+void DeviceService::poll(std::stop_token stop_token)
+{
+  framework::threading::register_current_thread("DevicePoll", framework::eThreadClass::Background);
+
+  try
+  {
+    p_audio_adapter = std::make_shared<AudioAdapter>();
+  }
+  catch (const std::exception &e)
+  {
+    LOG_ERROR("DeviceService: poll - No audio devices. ", e.what());
+  }
+  try
   {
-    if (dev->is_default_input())
-      return dev;
+    p_midi_adapter = std::make_shared<MidiAdapter>();
+  }
+  catch (const std::exception &e)
+  {
+    LOG_ERROR("DeviceService: poll - No MIDI devices. ", e.what());
+  }
+
+  while (!stop_token.stop_requested())
+  {
+    DeviceTablePtr previous;
+    uint64_t request = 0;
+    {
+      std::lock_guard<std::mutex> lock(m_devices_mutex);
+      previous = p_table;
+      request = m_refresh_requested;
+    }
+
+    DeviceChange change;
+    DeviceTablePtr table = build_table(previous.get(), change);
+    const bool changed = previous && !change.empty();
+
+    DeviceChangeCallback callback;
+    {
+      std::lock_guard<std::mutex> lock(m_devices_mutex);
+      if (!previous || changed)
+      {
+        p_table = std::move(table);
+      }
+      m_refresh_completed = request;
+      m_refresh_changed = changed;
+      callback = m_device_change_callback;
+    }
+    m_devices_signal.notify_all();
+
+    if (changed)
+    {
+      LOG_INFO("DeviceService: Devices changed. ", change.to_string());
+      if (callback)
+      {
+        callback(change);
+      }
+    }
+
+    std::unique_lock<std::mutex> lock(m_devices_mutex);
+    auto refresh_requested = [this] { return m_refresh_requested != m_refresh_completed; };
+    if (m_poll_interval.count() > 0)
+    {
+      m_devices_signal.wait_for(lock, stop_token, m_poll_interval, refresh_requested);
+    }
+    else
+    {
+      m_devices_signal.wait(lock, stop_token, refresh_requested);
+    }
   }
-  return nullptr;
 }
 
-DevicePtr DeviceService::get_default_audio_output_device()
+DeviceService::DeviceTablePtr DeviceService::build_table(const DeviceTable *previous, DeviceChange &change)
+{
+  auto table = std::make_shared<DeviceTable>();
+  const DeviceList no_devices;
+  const DeviceList &previous_audio = previous ? previous->audio_devices : no_devices;
+  const DeviceList &previous_midi = previous ? previous->midi_devices : no_devices;
+
+  try
+  {
+    table->audio_devices = p_audio_adapter ? p_audio_adapter->get_devices() : DeviceList();
+  }
+  catch (const std::exception &e)
+  {
+    LOG_ERROR("DeviceService: build_table - Failed to enumerate audio devices. ", e.what());
+    table->audio_devices = previous_audio;
+  }
+  try
+  {
+    table->midi_devices = p_midi_adapter ? p_midi_adapter->get_devices() : DeviceList();
+  }
+  catch (const std::exception &e)
+  {
+    LOG_ERROR("DeviceService: build_table - Failed to enumerate MIDI devices. ", e.what());
+    table->midi_devices = previous_midi;
+  }
+
+  reuse_handles(table->audio_devices, previous_audio);
+  reuse_handles(table->midi_devices, previous_midi);
+
+  // Backends that open a device to probe it can miss one this engine is streaming on. Keep it until it closes
+  {
+    std::lock_guard<std::mutex> lock(m_streams_mutex);
+    for (const DevicePtr &device : previous_audio)
+    {
+      auto stream = m_streams.find(device->get_id());
+      if (stream != m_streams.end() && stream->second.is_open && stream->second.device == device &&
+          std::none_of(table->audio_devices.begin(), table->audio_devices.end(),
+                       [&device](const DevicePtr &found) { return found->get_id() == device->get_id(); }))
+      {
+        table->audio_devices.push_back(device);
+      }
+    }
+  }
+
+  for (const DevicePtr &device : table->audio_devices)
+  {
+    table->audio_by_id.emplace(device->get_id(), device);
+    if (device->is_default_input() && !table->default_audio_input)
+    {
+      table->default_audio_input = device;
+    }
+    if (device->is_default_output() && !table->default_audio_output)
+    {
+      table->default_audio_output = device;
+    }
+  }
+  for (const DevicePtr &device : table->midi_devices)
+  {
+    table->midi_by_id.emplace(device->get_id(), device);
+    if (device->is_default_input() && !table->default_midi_input)
+    {
+      table->default_midi_input = device;
+    }
+    if (device->is_default_output() && !table->default_midi_output)
+    {
+      table->default_midi_output = device;
+    }
+  }
+
+  if (previous)
+  {
+    diff_devices(table->audio_devices, previous_audio, change);
+    diff_devices(table->midi_devices, previous_midi, change);
+    change.defaults_changed = table->default_audio_input != previous->default_audio_input ||
+                              table->default_audio_output != previous->default_audio_output ||
+                              table->default_midi_input != previous->default_midi_input ||
+                              table->default_midi_output != previous->default_midi_output;
+  }
+  return table;
+}
+
+unsigned int DeviceService::get_stream_sample_rate(const DevicePtr &device, const framework::StreamConfig &config)
 {
-  for (const auto& dev : get_audio_devices())
+  // Same rule as the audio adapter uses to open the stream
+  unsigned int sample_rate = config.sample_rate > 0 ? config.sample_rate : device->get_preferred_sample_rate();
+  return sample_rate > 0 ? sample_rate : dataplane::AudioGraph::DEFAULT_SAMPLE_RATE;
+}
+
+bool DeviceService::attach_to_stream(const DevicePtr &device, const dataplane::AudioGraphPtr &graph,
+                                     const framework::BufferPtr &capture, const framework::StreamStatisticsPtr &statistics,
+                                     const framework::StreamConfig &config, const dataplane::TransportGatePtr &gate)
+{
+  if (!device || device->get_device_type() != Device::eDeviceType::Audio)
+  {
+    LOG_ERROR("DeviceService: attach_to_stream - Only audio devices have a shared stream.");
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_streams_mutex);
+  SharedStream &stream = m_streams[device->get_id()];
+  if (!stream.mixer)
+  {
+    stream.device = device;
+    stream.statistics = std::make_shared<framework::StreamStatistics>();
+    stream.mixer = std::make_shared<dataplane::StreamMixer>(device->get_output_channels(), device->get_input_channels(),
+                                                            config.frames_per_buffer, get_stream_sample_rate(device, config));
+  }
+
+  // Every route renders straight into the mixer's blocks, so it must share the stream's format
+  const unsigned int sample_rate = get_stream_sample_rate(device, config);
+  if (config.frames_per_buffer != stream.mixer->get_max_frames() || sample_rate != stream.mixer->get_sample_rate())
   {
-    if (dev->is_default_output())
-      return dev;
+    LOG_ERROR("DeviceService: attach_to_stream - The shared stream of ", device->get_name(), " runs ",
+              stream.mixer->get_max_frames(), " frames at ", stream.mixer->get_sample_rate(), " Hz, the track asks for ",
+              config.frames_per_buffer, " frames at ", sample_rate, " Hz.");
+    return false;
   }
-  return nullptr;
+
+  // The stream must run in every direction its tracks use
+  const bool needs_output = graph || stream.mixer->has_outputs();
+  const bool needs_input = capture || stream.mixer->has_captures();
+  const framework::eInputOutputDirection direction = needs_output && needs_input ? framework::eInputOutputDirection::Duplex
+                                                     : needs_input             ? framework::eInputOutputDirection::Input
+                                                                               : framework::eInputOutputDirection::Output;
+
+  if (!stream.mixer->add_route(graph, capture, statistics, gate))
+  {
+    return false;
+  }
+
+  if (stream.is_open && stream.direction == direction)
+  {
+    LOG_INFO("DeviceService: Attached to the shared stream of ", device->get_name(), ". ", stream.mixer->to_string());
+    return true;
+  }
+
+  if (!open_shared_stream(stream, direction, config))
+  {
+    // Put the tracks already attached back on the stream they had
+    stream.mixer->remove_route(graph, capture);
+    if (stream.mixer->get_route_count() == 0)
+    {
+      m_streams.erase(device->get_id());
+    }
+    else
+    {
+      open_shared_stream(stream, stream.direction, config);
+    }
+    assign_transport_locked();
+    return false;
+  }
+
+  assign_transport_locked();
+  LOG_INFO("DeviceService: Attached to the shared stream of ", device->get_name(), ". ", stream.mixer->to_string());
+  return true;
 }
 
-DevicePtr DeviceService::get_default_midi_input_device()
+bool DeviceService::detach_from_stream(const DevicePtr &device, const dataplane::AudioGraphPtr &graph,
+                                       const framework::BufferPtr &capture)
+{
+  if (!device)
+  {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_streams_mutex);
+  auto found = m_streams.find(device->get_id());
+  if (found == m_streams.end() || !found->second.mixer->remove_route(graph, capture))
+  {
+    LOG_WARNING("DeviceService: detach_from_stream - Track is not attached to ", device->get_name());
+    return false;
+  }
+
+  SharedStream &stream = found->second;
+  if (stream.mixer->get_route_count() > 0)
+  {
+    return true;
+  }
+
+  // Last track left. Close before the mixer is released so the callback never sees it destroyed
+  LOG_INFO("DeviceService: Closing the shared stream of ", device->get_name());
+  const bool closed = !stream.is_open || stream.device->close_stream();
+  if (!closed)
+  {
+    LOG_ERROR("DeviceService: detach_from_stream - Failed to close the stream of ", device->get_name());
+  }
+  m_streams.erase(found);
+  assign_transport_locked();
+  return closed;
+}
+
+void DeviceService::set_transport(const dataplane::TransportPtr &transport)
+{
+  std::lock_guard<std::mutex> lock(m_streams_mutex);
+  p_transport = transport;
+  m_transport_driver.reset();
+  assign_transport_locked();
+}
+
+dataplane::TransportPtr DeviceService::get_transport() const
 {
-  for (const auto& dev : get_midi_devices())
+  std::lock_guard<std::mutex> lock(m_streams_mutex);
+  return p_transport;
+}
+
+/** @brief Hand the transport to the open streams and pick the one that drives it.
+ *  The current driver keeps the transport while it is open, so the position never jumps between streams.
+ *  @note Caller must hold m_streams_mutex.
+ */
+void DeviceService::assign_transport_locked()
+{
+  auto driver = m_transport_driver ? m_streams.find(*m_transport_driver) : m_streams.end();
+  if (!p_transport || driver == m_streams.end() || !driver->second.is_open)
+  {
+    m_transport_driver.reset();
+    for (const auto &[id, stream] : m_streams)
+    {
+      if (!p_transport || !stream.is_open)
+      {
+        continue;
+      }
+
+      // An output stream renders the click, an input-only one can still keep time
+      if (!m_transport_driver || stream.direction != framework::eInputOutputDirection::Input)
+      {
+        m_transport_driver = id;
+      }
+      if (stream.direction != framework::eInputOutputDirection::Input)
+      {
+        break;
+      }
+    }
+
+    if (m_transport_driver)
+    {
+      p_transport->prepare(m_streams[*m_transport_driver].mixer->get_sample_rate());
+      LOG_INFO("DeviceService: The stream of ", m_streams[*m_transport_driver].device->get_name(), " drives the transport.");
+    }
+  }
+
+  for (auto &[id, stream] : m_streams)
   {
-    if (dev->is_default_input())
-      return dev;
+    stream.mixer->set_transport(p_transport, m_transport_driver == id);
   }
-  return nullptr;
 }
 
-DevicePtr DeviceService::get_default_midi_output_device()
+size_t DeviceService::get_stream_reference_count(const DevicePtr &device) const
 {
-  for (const auto& dev : get_midi_devices())
+  std::lock_guard<std::mutex> lock(m_streams_mutex);
+  auto found = device ? m_streams.find(device->get_id()) : m_streams.end();
+  return found != m_streams.end() ? found->second.mixer->get_route_count() : 0;
+}
+
+framework::StreamStatisticsPtr DeviceService::get_stream_statistics(const DevicePtr &device) const
+{
+  std::lock_guard<std::mutex> lock(m_streams_mutex);
+  auto found = device ? m_streams.find(device->get_id()) : m_streams.end();
+  return found != m_streams.end() ? found->second.statistics : nullptr;
+}
+
+/** @brief Open, or reopen in another direction, the one stream of a device.
+ *  @note Caller must hold m_streams_mutex.
+ */
+bool DeviceService::open_shared_stream(SharedStream &stream, framework::eInputOutputDirection direction,
+                                       const framework::StreamConfig &config)
+{
+  if (direction == framework::eInputOutputDirection::Duplex && !stream.device->is_duplex())
   {
-    if (dev->is_default_output())
-      return dev;
+    LOG_ERROR("DeviceService: open_shared_stream - ", stream.device->get_name(),
+              " cannot capture and play in one stream. Use separate input and output devices.");
+    return false;
   }
-  return nullptr;
-}
\ No newline at end of file
+
+  if (stream.device->is_stream_open() && !stream.device->close_stream())
+  {
+    LOG_ERROR("DeviceService: open_shared_stream - Failed to close the stream of ", stream.device->get_name());
+    return false;
+  }
+  stream.is_open = false;
+
+  stream.device->set_statistics(stream.statistics);
+  if (!stream.device->open_shared_stream(stream.mixer, direction, config))
+  {
+    LOG_ERROR("DeviceService: open_shared_stream - Failed to open the stream of ", stream.device->get_name());
+    return false;
+  }
+
+  stream.direction = direction;
+  stream.is_open = true;
+  LOG_INFO("DeviceService: Opened the shared ", (direction == framework::eInputOutputDirection::Duplex ? "duplex" :
+                                                 direction == framework::eInputOutputDirection::Input  ? "input" : "output"),
+           " stream of ", stream.device->get_name());
+  return true;
+}
@@ -0,0 +1,210 @@
+#include "fileindex.h"
+#include "logger.h"
+
+#include <fstream>
+#include <sstream>
+
+using namespace miniaudioengine;
+
+namespace
+{
+
+/** @brief Parse one "size mtime frames rate channels bits format path" line of an index file, tab separated.
+ *  The path is last so it may contain any character but a newline.
+ */
+std::optional<AudioFileInfo> parse_entry(const std::string &line)
+{
+  std::istringstream stream(line);
+  std::string field;
+  std::vector<std::string> fields;
+  while (fields.size() < 7 && std::getline(stream, field, '\t'))
+  {
+    fields.push_back(field);
+  }
+
+  std::string path;
+  if (fields.size() != 7 || !std::getline(stream, path) || path.empty())
+  {
+    return std::nullopt;
+  }
+
+  try
+  {
+    AudioFileInfo info;
+    info.size_bytes = std::stoull(fields[0]);
+    info.modified_time = std::stoll(fields[1]);
+    info.frames = std::stoull(fields[2]);
+    info.sample_rate = static_cast<unsigned int>(std::stoul(fields[3]));
+    info.channels = static_cast<unsigned int>(std::stoul(fields[4]));
+    info.bits_per_sample = static_cast<unsigned int>(std::stoul(fields[5]));
+    info.format = fields[6];
+    info.path = path;
+    return info;
+  }
+  catch (const std::exception &)
+  {
+    return std::nullopt;
+  }
+}
+
+} // namespace
+
+bool FileIndex::open(const std::filesystem::path &index_path)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_index_path = index_path;
+  m_entries.clear();
+  m_dirty = false;
+
+  std::error_code ec;
+  if (!std::filesystem::exists(index_path, ec))
+  {
+    LOG_INFO("FileIndex: Starting a new index at ", index_path.string());
+    return true;
+  }
+
+  std::ifstream file(index_path);
+  std::string magic;
+  unsigned int version = 0;
+  std::string line;
+  if (!file || !(file >> magic >> version) || magic != FILE_MAGIC || version != FILE_VERSION || !std::getline(file, line))
+  {
+    LOG_ERROR("FileIndex: open - Not a version ", FILE_VERSION, " index file, rebuilding it: ", index_path.string());
+    m_dirty = true;
+    return false;
+  }
+
+  size_t skipped = 0;
+  while (std::getline(file, line))
+  {
+    std::optional<AudioFileInfo> info = parse_entry(line);
+    if (!info)
+    {
+      skipped++;
+      continue;
+    }
+    std::string key = info->path.string();
+    m_entries[std::move(key)] = std::move(*info);
+  }
+
+  if (skipped > 0)
+  {
+    LOG_WARNING("FileIndex: Skipped ", skipped, " malformed entries in ", index_path.string());
+    m_dirty = true;
+  }
+
+  LOG_INFO("FileIndex: Loaded ", m_entries.size(), " entries from ", index_path.string());
+  return true;
+}
+
+bool FileIndex::save()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_index_path.empty() || !m_dirty)
+  {
+    return true;
+  }
+
+  std::filesystem::path temp_path = m_index_path;
+  temp_path += ".tmp";
+
+  {
+    std::ofstream file(temp_path, std::ios::trunc);
+    if (!file)
+    {
+      LOG_ERROR("FileIndex: save - Cannot write ", temp_path.string());
+      return false;
+    }
+
+    file << FILE_MAGIC << ' ' << FILE_VERSION << '\n';
+    for (const auto &[key, info] : m_entries)
+    {
+      if (key.find('\n') != std::string::npos)
+      {
+        continue;
+      }
+      file << info.size_bytes << '\t' << info.modified_time << '\t' << info.frames << '\t'
+           << info.sample_rate << '\t' << info.channels << '\t' << info.bits_per_sample << '\t'
+           << info.format << '\t' << key << '\n';
+    }
+
+    if (!file.flush())
+    {
+      LOG_ERROR("FileIndex: save - Failed writing ", temp_path.string());
+      return false;
+    }
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(temp_path, m_index_path, ec);
+  if (ec)
+  {
+    LOG_ERROR("FileIndex: save - Cannot replace ", m_index_path.string(), ": ", ec.message());
+    std::filesystem::remove(temp_path, ec);
+    return false;
+  }
+
+  m_dirty = false;
+  LOG_INFO("FileIndex: Saved ", m_entries.size(), " entries to ", m_index_path.string());
+  return true;
+}
+
+std::filesystem::path FileIndex::get_index_path() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_index_path;
+}
+
+std::optional<AudioFileInfo> FileIndex::find(const std::filesystem::path &path, uint64_t size_bytes, int64_t modified_time) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_entries.find(path.string());
+  if (it == m_entries.end() || it->second.size_bytes != size_bytes || it->second.modified_time != modified_time)
+  {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+void FileIndex::insert(const AudioFileInfo &info)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries[info.path.string()] = info;
+  m_dirty = true;
+}
+
+size_t FileIndex::prune(const std::filesystem::path &directory, const std::unordered_set<std::string> &seen)
+{
+  std::string prefix = (directory / "").string();
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  size_t removed = 0;
+  for (auto it = m_entries.begin(); it != m_entries.end();)
+  {
+    if (it->first.starts_with(prefix) && !seen.contains(it->first))
+    {
+      it = m_entries.erase(it);
+      removed++;
+    }
+    else
+    {
+      ++it;
+    }
+  }
+
+  m_dirty = m_dirty || removed > 0;
+  return removed;
+}
+
+size_t FileIndex::size() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_entries.size();
+}
+
+void FileIndex::clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_dirty = m_dirty || !m_entries.empty();
+  m_entries.clear();
+}
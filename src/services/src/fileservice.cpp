@@ -1,5 +1,15 @@
 #include "fileservice.h"
+#include "filewriter.h"
+#include "fileadapter.h"
 #include "logger.h"
+#include "threading.h"
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
 
 using namespace miniaudioengine;
 
@@ -67,6 +77,23 @@ std::vector<std::filesystem::path> FileService::list_wav_files_in_directory(cons
   return wav_files;
 }
 
+std::vector<std::filesystem::path> FileService::list_audio_files_in_directory(const std::filesystem::path &path) const
+{
+  std::vector<std::filesystem::path> contents = list_directory(path, PathType::File);
+  std::erase_if(contents, [](const std::filesystem::path &entry) { return !is_audio_extension(entry); });
+  return contents;
+}
+
+bool FileService::is_audio_extension(const std::filesystem::path &path)
+{
+  static constexpr std::string_view AUDIO_EXTENSIONS[] = {".wav", ".wave", ".aif", ".aiff", ".flac", ".ogg", ".oga", ".opus", ".mp3"};
+
+  std::string extension = path.extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  return std::find(std::begin(AUDIO_EXTENSIONS), std::end(AUDIO_EXTENSIONS), extension) != std::end(AUDIO_EXTENSIONS);
+}
+
 /** @brief Lists MIDI files in a specified directory.
  *  @param path The path to the directory to list.
  *  @return A vector of fileservice paths representing the MIDI files in the specified directory.
@@ -91,11 +118,11 @@ std::vector<std::filesystem::path> FileService::list_midi_files_in_directory(con
 FileList FileService::get_audio_files(const std::filesystem::path &directory) const
 {
   FileList audio_files;
-  std::vector<std::filesystem::path> wav_paths = list_wav_files_in_directory(directory);
+  std::vector<std::filesystem::path> audio_paths = list_audio_files_in_directory(directory);
 
-  for (const auto& wav_path : wav_paths)
+  for (const auto& audio_path : audio_paths)
   {
-    FilePtr audio_file = get_audio_file(wav_path);
+    FilePtr audio_file = get_audio_file(audio_path);
     if (audio_file)
     {
       audio_files.push_back(audio_file);
@@ -105,6 +132,175 @@ FileList FileService::get_audio_files(const std::filesystem::path &directory) co
   return audio_files;
 }
 
+AudioFileInfoList FileService::scan_audio_files(const std::filesystem::path &directory, const FileScanOptions &options) const
+{
+  std::filesystem::path root = convert_to_absolute(std::filesystem::weakly_canonical(directory));
+  if (!is_directory(root))
+  {
+    LOG_ERROR("FileService: scan_audio_files - Not a directory: ", root.string());
+    return {};
+  }
+
+  std::lock_guard<std::mutex> scan_lock(m_scan_mutex);
+
+  unsigned int max_threads = options.max_threads;
+  if (max_threads == 0)
+  {
+    max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  // Threads take the next directory from a shared queue and push the sub-directories they find, so
+  // wide and deep trees both keep every thread busy. The walk ends when the queue is empty and no
+  // thread is still listing a directory.
+  std::mutex mutex;
+  std::condition_variable directory_ready;
+  std::vector<std::filesystem::path> directories{root};
+  size_t busy = 0;
+  AudioFileInfoList found;
+  std::unordered_set<std::string> seen;
+  size_t probed = 0;
+
+  auto scan = [&](unsigned int thread_index) {
+    framework::threading::register_current_thread("FileScan" + std::to_string(thread_index), framework::eThreadClass::Background,
+                                                  thread_index);
+
+    std::vector<std::filesystem::path> subdirectories;
+    AudioFileInfoList infos;
+    while (true)
+    {
+      std::filesystem::path current;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        directory_ready.wait(lock, [&]() { return !directories.empty() || busy == 0; });
+        if (directories.empty())
+        {
+          return;
+        }
+        current = std::move(directories.back());
+        directories.pop_back();
+        busy++;
+      }
+
+      size_t current_probed = 0;
+      std::error_code ec;
+      std::filesystem::directory_iterator it(current, std::filesystem::directory_options::skip_permission_denied, ec);
+      if (ec)
+      {
+        LOG_WARNING("FileService: Cannot list ", current.string(), ": ", ec.message());
+      }
+      for (; !ec && it != std::filesystem::directory_iterator(); it.increment(ec))
+      {
+        const std::filesystem::directory_entry &entry = *it;
+        std::error_code entry_ec;
+        if (entry.is_directory(entry_ec))
+        {
+          // Symlinked directories are not followed, so a link cycle cannot loop the walk
+          if (options.recursive && !entry.is_symlink(entry_ec))
+          {
+            subdirectories.push_back(entry.path());
+          }
+        }
+        else if (is_audio_extension(entry.path()) && entry.is_regular_file(entry_ec))
+        {
+          bool header_read = false;
+          std::optional<AudioFileInfo> info = probe_audio_file(entry, header_read);
+          if (info)
+          {
+            current_probed += header_read ? 1 : 0;
+            infos.push_back(std::move(*info));
+          }
+        }
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      busy--;
+      for (auto &subdirectory : subdirectories)
+      {
+        directories.push_back(std::move(subdirectory));
+      }
+      subdirectories.clear();
+      for (auto &info : infos)
+      {
+        seen.insert(info.path.string());
+        if (info.is_valid())
+        {
+          found.push_back(std::move(info));
+        }
+      }
+      infos.clear();
+      probed += current_probed;
+      directory_ready.notify_all();
+    }
+  };
+
+  {
+    std::vector<std::jthread> threads;
+    threads.reserve(max_threads);
+    for (unsigned int i = 0; i < max_threads; i++)
+    {
+      threads.emplace_back(scan, i);
+    }
+  }
+
+  std::sort(found.begin(), found.end(), [](const AudioFileInfo &a, const AudioFileInfo &b) { return a.path < b.path; });
+
+  // A file below the root that was not found has been deleted. A flat scan cannot tell for the
+  // sub-directories it skipped, so only a recursive scan prunes the index.
+  if (options.recursive)
+  {
+    m_index.prune(root, seen);
+  }
+  m_index.save();
+
+  LOG_INFO("FileService: Scanned ", root.string(), ", found ", found.size(), " audio files (",
+           probed, " headers read, the rest from the index) on ", max_threads, " threads");
+  return found;
+}
+
+std::optional<AudioFileInfo> FileService::probe_audio_file(const std::filesystem::directory_entry &entry, bool &header_read) const
+{
+  header_read = false;
+  std::error_code ec;
+  const uint64_t size_bytes = entry.file_size(ec);
+  if (ec)
+  {
+    return std::nullopt;
+  }
+  const int64_t modified_time = entry.last_write_time(ec).time_since_epoch().count();
+  if (ec)
+  {
+    return std::nullopt;
+  }
+
+  std::filesystem::path path = entry.path().lexically_normal();
+  if (std::optional<AudioFileInfo> cached = m_index.find(path, size_bytes, modified_time))
+  {
+    return cached;
+  }
+
+  // Only the header is read, never the samples
+  header_read = true;
+  AudioFileInfo info;
+  info.path = path;
+  info.size_bytes = size_bytes;
+  info.modified_time = modified_time;
+  if (std::optional<adapters::AudioFormatInfo> format = adapters::FileAdapter::probe(path))
+  {
+    info.frames = format->frames;
+    info.sample_rate = format->sample_rate;
+    info.channels = format->channels;
+    info.bits_per_sample = format->bits_per_sample;
+    info.format = format->format;
+  }
+  else
+  {
+    LOG_WARNING("FileService: Cannot read the audio header of ", path.string());
+  }
+
+  m_index.insert(info);
+  return info;
+}
+
 FileList FileService::get_midi_files(const std::filesystem::path &directory) const
 {
   FileList midi_files;
@@ -134,14 +330,47 @@ FilePtr FileService::get_midi_file(const std::filesystem::path &file_path) const
   return midi_file;
 }
 
-void FileService::save_to_wav_file(std::vector<float> audio_buffer, const std::filesystem::path &path)
+FilePtr FileService::create_audio_file(const std::filesystem::path &file_path) const
 {
-  (void)audio_buffer; // Suppress unused variable warning
-  (void)path; // Suppress unused variable warning
+  std::filesystem::path absolute_path = convert_to_absolute(std::filesystem::weakly_canonical(file_path));
+
+  if (absolute_path.extension() != ".wav")
+  {
+    LOG_ERROR("Recorded file must be a WAV file: ", absolute_path.string());
+    return nullptr;
+  }
+
+  if (!path_exists(absolute_path.parent_path()))
+  {
+    LOG_ERROR("Directory does not exist: ", absolute_path.parent_path().string());
+    return nullptr;
+  }
+
+  return FileHandleFactory::make_wav_output(absolute_path);
+}
+
+bool FileService::save_to_wav_file(const std::vector<float> &audio_buffer, const std::filesystem::path &path,
+                                   unsigned int channels, unsigned int sample_rate) const
+{
+  if (channels == 0 || audio_buffer.size() % channels != 0)
+  {
+    LOG_ERROR("Cannot save WAV file ", path.string(), ": buffer is not a whole number of ", channels, "-channel frames");
+    return false;
+  }
+
+  adapters::FileWriter writer;
+  if (!writer.open(path, channels, sample_rate))
+  {
+    LOG_ERROR("Failed to create WAV file: ", path.string());
+    return false;
+  }
+
+  const bool queued = writer.write_all(audio_buffer);
+  return writer.close() && queued;
 }
 
-/** @brief Loads audio data from a WAV file.
- *  @param path The path to the WAV file to load.
+/** @brief Loads audio data from an audio file.
+ *  @param path The path to the WAV, AIFF, FLAC, Ogg or MP3 file to load.
  *  @return An AudioFile object containing the loaded audio data.
  */
 FilePtr FileService::read_wav_file(const std::filesystem::path &path) const
@@ -151,13 +380,13 @@ FilePtr FileService::read_wav_file(const std::filesystem::path &path) const
 
   if (!path_exists(absolute_path))
   {
-    LOG_ERROR("WAV file does not exist: ", absolute_path.string());
+    LOG_ERROR("Audio file does not exist: ", absolute_path.string());
     return nullptr;
   }
 
-  if (!is_wav_file(absolute_path))
+  if (!is_audio_file(absolute_path))
   {
-    LOG_ERROR("File is not a WAV file: ", absolute_path.string());
+    LOG_ERROR("File is not a supported audio file: ", absolute_path.string());
     return nullptr;
   }
 
@@ -167,7 +396,7 @@ FilePtr FileService::read_wav_file(const std::filesystem::path &path) const
   }
   catch (const std::exception& ex)
   {
-    LOG_ERROR("Failed to open WAV file: ", ex.what());
+    LOG_ERROR("Failed to open audio file: ", ex.what());
     return nullptr;
   }
 }
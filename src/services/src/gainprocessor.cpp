@@ -0,0 +1,84 @@
+#include "gainprocessor.h"
+#include "dspkernels.h"
+
+#include <algorithm>
+
+using namespace miniaudioengine;
+
+GainProcessor::GainProcessor() :
+  p_gain(m_parameters.add(GAIN, 0.0f, MAX_GAIN, 1.0f, framework::eParameterSmoothing::Exponential)),
+  p_pan(m_parameters.add(PAN, -1.0f, 1.0f, 0.0f, framework::eParameterSmoothing::Linear))
+{}
+
+void GainProcessor::prepare(unsigned int sample_rate, unsigned int max_block, unsigned int channels)
+{
+  (void)channels;
+  m_parameters.prepare(sample_rate, max_block);
+  m_side_gains.assign(max_block, 1.0f);
+}
+
+uint64_t GainProcessor::advance_timeline(unsigned int n_frames) noexcept
+{
+  uint64_t block_start = m_frame_position;
+  m_frame_position += n_frames;
+  if (p_transport)
+  {
+    // A graph renders a device block in passes, so later passes continue from where the last one ended
+    const uint64_t transport_start = p_transport->get_block_start();
+    const bool moving = p_transport->is_playing();
+    if (transport_start != m_transport_block_start || !moving)
+    {
+      m_transport_block_start = transport_start;
+      m_transport_cursor = transport_start;
+    }
+    block_start = m_transport_cursor;
+    m_transport_cursor += moving ? n_frames : 0;
+  }
+  return block_start;
+}
+
+void GainProcessor::process(framework::AudioBlockView &block, const midi::MidiEventList &events) noexcept
+{
+  m_parameters.handle_midi(events);
+
+  const unsigned int n_frames = std::min<unsigned int>(block.get_frame_count(), static_cast<unsigned int>(m_side_gains.size()));
+  const uint64_t timeline_frame = advance_timeline(n_frames);
+  const float *gains = p_gain->process(n_frames, timeline_frame);
+
+  if (block.get_channel_count() != 2)
+  {
+    for (unsigned int channel = 0; channel < block.get_channel_count(); channel++)
+    {
+      framework::dsp::multiply(block.get_channel(channel), gains, n_frames);
+    }
+    return;
+  }
+
+  // Left keeps unity until panned right of centre, and right until panned left
+  const float *pans = p_pan->process(n_frames, timeline_frame);
+  float *side_gains = m_side_gains.data();
+  for (unsigned int i = 0; i < n_frames; i++)
+  {
+    side_gains[i] = gains[i] * std::min(1.0f, 1.0f - pans[i]);
+  }
+  framework::dsp::multiply(block.get_channel(0), side_gains, n_frames);
+
+  for (unsigned int i = 0; i < n_frames; i++)
+  {
+    side_gains[i] = gains[i] * std::min(1.0f, 1.0f + pans[i]);
+  }
+  framework::dsp::multiply(block.get_channel(1), side_gains, n_frames);
+}
+
+void GainProcessor::reset()
+{
+  m_parameters.snap();
+  m_frame_position = 0;
+  m_transport_block_start = UINT64_MAX;
+  m_transport_cursor = 0;
+}
+
+std::string GainProcessor::to_string() const
+{
+  return "GainProcessor(Gain=" + std::to_string(get_gain()) + ", Pan=" + std::to_string(get_pan()) + ")";
+}
@@ -0,0 +1,604 @@
+#include "loopengine.h"
+#include "dspkernels.h"
+#include "logger.h"
+#include "realtimememory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace miniaudioengine;
+
+namespace
+{
+
+constexpr size_t LOOP_BUFFER_ALIGNMENT = 64;
+
+} // namespace
+
+std::string miniaudioengine::to_string(eLoopState state)
+{
+  switch (state)
+  {
+    case eLoopState::Idle:
+      return "Idle";
+    case eLoopState::WaitingToRecord:
+      return "WaitingToRecord";
+    case eLoopState::Recording:
+      return "Recording";
+    case eLoopState::WaitingToPlay:
+      return "WaitingToPlay";
+    case eLoopState::Playing:
+      return "Playing";
+    case eLoopState::Overdubbing:
+      return "Overdubbing";
+    default:
+      return "Unknown";
+  }
+}
+
+Loop::Loop(unsigned int id, size_t capacity_frames, unsigned int channels, unsigned int sample_rate) :
+  m_id(id),
+  m_capacity_frames(capacity_frames),
+  m_channels(channels),
+  m_sample_rate(sample_rate)
+{
+  if (capacity_frames == 0 || channels == 0 || sample_rate == 0)
+  {
+    throw std::runtime_error("Loop: Capacity, channels and sample rate must be non-zero.");
+  }
+
+  const size_t samples = capacity_frames * channels;
+  m_size_bytes = std::max(samples * sizeof(float), LOOP_BUFFER_ALIGNMENT);
+
+  // The pool zeroes every sample, faulting each page in here rather than on the first record. A take must
+  // never be swapped out mid-loop, so the buffer is locked whether or not realtime memory mode is enabled
+  p_samples = static_cast<float *>(framework::realtime_memory::allocate_pinned(m_size_bytes, LOOP_BUFFER_ALIGNMENT, m_locked));
+  if (!m_locked)
+  {
+    LOG_WARNING("Loop: Failed to lock ", m_size_bytes, " bytes for loop ", id,
+                ", pages may be swapped out. Raise RLIMIT_MEMLOCK to lock loop buffers.");
+  }
+}
+
+Loop::~Loop()
+{
+  framework::realtime_memory::deallocate(p_samples, m_size_bytes, LOOP_BUFFER_ALIGNMENT);
+}
+
+/** @brief Close a recording at the current position and rewind to the start of the loop.
+ *  A latency-compensated take is m_record_latency frames longer than what has arrived. Those frames
+ *  arrive while the loop plays its first lap and write_tail() puts them at its end. A take no longer
+ *  than its latency closes uncompensated.
+ */
+void Loop::finish_recording() noexcept
+{
+  const size_t latency = m_position >= m_record_latency ? m_record_latency : 0;
+  m_tail_position = m_position;
+  m_tail_remaining = latency;
+  m_length.store(m_position + latency, std::memory_order_release);
+  m_position = 0;
+  m_record_target = 0;
+  m_skip_remaining = 0;
+}
+
+/** @brief Write the late frames of a closed take to its end.
+ *  @return The number of input frames that belonged to the take.
+ */
+unsigned int Loop::write_tail(const float *input, size_t stride, unsigned int frames) noexcept
+{
+  const unsigned int tail = static_cast<unsigned int>(std::min<size_t>(frames, m_tail_remaining));
+  for (unsigned int channel = 0; channel < m_channels && tail > 0; channel++)
+  {
+    std::copy_n(input + channel * stride, tail, get_channel(channel) + m_tail_position);
+  }
+  m_tail_position += tail;
+  m_tail_remaining -= tail;
+  return tail;
+}
+
+std::string Loop::to_string() const
+{
+  return "Loop(Id=" + std::to_string(m_id) +
+         ", State=" + miniaudioengine::to_string(get_state()) +
+         ", Muted=" + std::string(is_muted() ? "true" : "false") +
+         ", LengthFrames=" + std::to_string(get_length_frames()) +
+         ", CapacityFrames=" + std::to_string(m_capacity_frames) +
+         ", Channels=" + std::to_string(m_channels) +
+         ", Locked=" + std::string(is_locked() ? "true" : "false") + ")";
+}
+
+LoopEngine::LoopEngine(const Config &config) :
+  m_config(config),
+  m_capacity_frames(static_cast<size_t>(std::ceil(std::max(config.max_loop_seconds, 0.0) * config.sample_rate))),
+  m_commands(MAX_PENDING_COMMANDS),
+  m_pending(MAX_PENDING_COMMANDS)
+{
+  if (config.sample_rate == 0 || config.channels == 0 || m_capacity_frames == 0)
+  {
+    throw std::runtime_error("LoopEngine: Sample rate, channels and max loop length must be non-zero.");
+  }
+
+  m_table.publish(std::make_unique<LoopTable>());
+}
+
+LoopPtr LoopEngine::create_loop()
+{
+  std::lock_guard<std::mutex> lock(m_loops_mutex);
+  if (m_loops.size() >= m_config.max_loops)
+  {
+    LOG_ERROR("LoopEngine: create_loop - All ", m_config.max_loops, " loops are in use.");
+    return nullptr;
+  }
+
+  auto loop = std::make_shared<Loop>(m_next_loop_id++, m_capacity_frames, m_config.channels, m_config.sample_rate);
+  m_loops.push_back(loop);
+  publish_locked();
+
+  LOG_INFO("LoopEngine: Created ", loop->to_string());
+  return loop;
+}
+
+bool LoopEngine::delete_loop(unsigned int loop_id)
+{
+  std::lock_guard<std::mutex> lock(m_loops_mutex);
+  auto found = std::find_if(m_loops.begin(), m_loops.end(), [loop_id](const LoopPtr &loop) {
+    return loop->get_id() == loop_id;
+  });
+  if (found == m_loops.end())
+  {
+    LOG_ERROR("LoopEngine: delete_loop - Loop ", loop_id, " does not exist.");
+    return false;
+  }
+
+  m_loops.erase(found);
+  publish_locked();
+  return true;
+}
+
+void LoopEngine::delete_all_loops()
+{
+  std::lock_guard<std::mutex> lock(m_loops_mutex);
+  m_loops.clear();
+  publish_locked();
+}
+
+LoopPtr LoopEngine::get_loop(unsigned int loop_id) const
+{
+  std::lock_guard<std::mutex> lock(m_loops_mutex);
+  auto found = std::find_if(m_loops.begin(), m_loops.end(), [loop_id](const LoopPtr &loop) {
+    return loop->get_id() == loop_id;
+  });
+  return found != m_loops.end() ? *found : nullptr;
+}
+
+LoopList LoopEngine::get_loops() const
+{
+  std::lock_guard<std::mutex> lock(m_loops_mutex);
+  return m_loops;
+}
+
+size_t LoopEngine::get_loop_count() const
+{
+  std::lock_guard<std::mutex> lock(m_loops_mutex);
+  return m_loops.size();
+}
+
+bool LoopEngine::record(unsigned int loop_id, uint64_t at_frame, size_t length_frames)
+{
+  if (length_frames > m_capacity_frames)
+  {
+    LOG_WARNING("LoopEngine: record - ", length_frames, " frames exceed the loop capacity, recording ",
+                m_capacity_frames, " frames.");
+    length_frames = m_capacity_frames;
+  }
+  return push_command(eLoopCommand::Record, loop_id, at_frame, length_frames);
+}
+
+bool LoopEngine::play(unsigned int loop_id, uint64_t at_frame)
+{
+  return push_command(eLoopCommand::Play, loop_id, at_frame);
+}
+
+bool LoopEngine::overdub(unsigned int loop_id, uint64_t at_frame)
+{
+  return push_command(eLoopCommand::Overdub, loop_id, at_frame);
+}
+
+bool LoopEngine::stop(unsigned int loop_id, uint64_t at_frame)
+{
+  return push_command(eLoopCommand::Stop, loop_id, at_frame);
+}
+
+bool LoopEngine::cancel(unsigned int loop_id)
+{
+  return push_command(eLoopCommand::Cancel, loop_id, NEXT_BLOCK);
+}
+
+uint64_t LoopEngine::get_frame_position() const
+{
+  return p_transport ? p_transport->get_position() : m_frame_position.load(std::memory_order_acquire);
+}
+
+uint64_t LoopEngine::get_next_boundary(uint64_t quantum_frames) const
+{
+  const uint64_t position = get_frame_position();
+  if (quantum_frames == 0)
+  {
+    return position;
+  }
+  return (position / quantum_frames + 1) * quantum_frames;
+}
+
+bool LoopEngine::push_command(eLoopCommand command, unsigned int loop_id, uint64_t at_frame, size_t length_frames)
+{
+  if (!get_loop(loop_id))
+  {
+    LOG_ERROR("LoopEngine: Loop ", loop_id, " does not exist.");
+    return false;
+  }
+
+  if (!m_commands.try_push(LoopCommand{command, loop_id, at_frame, length_frames}))
+  {
+    LOG_ERROR("LoopEngine: Command queue is full, dropping command for loop ", loop_id, ".");
+    return false;
+  }
+  return true;
+}
+
+/** @brief Hand the audio thread a copy of the loops.
+ *  Deleted loops are only freed here, on a control thread, once the audio thread has let go of them.
+ *  @note Caller must hold m_loops_mutex.
+ */
+void LoopEngine::publish_locked()
+{
+  auto table = std::make_unique<LoopTable>();
+  table->loops = m_loops;
+  m_table.publish(std::move(table));
+}
+
+void LoopEngine::prepare(unsigned int sample_rate, unsigned int max_block, unsigned int channels)
+{
+  m_format_valid = sample_rate == m_config.sample_rate && channels == m_config.channels && max_block > 0;
+  if (!m_format_valid)
+  {
+    LOG_ERROR("LoopEngine: prepare - Stream format SampleRate=", sample_rate, ", Channels=", channels,
+              " does not match ", m_config.to_string(), ". Loops are bypassed.");
+    return;
+  }
+
+  m_max_block = max_block;
+  m_input.assign(static_cast<size_t>(max_block) * channels, 0.0f);
+}
+
+Loop *LoopEngine::find_loop(const LoopTable &table, unsigned int loop_id) const noexcept
+{
+  for (const LoopPtr &loop : table.loops)
+  {
+    if (loop->get_id() == loop_id)
+    {
+      return loop.get();
+    }
+  }
+  return nullptr;
+}
+
+/** @brief Queue a drained command until its frame, or act on a cancel straight away. */
+void LoopEngine::schedule(const LoopTable &table, const LoopCommand &command, uint64_t block_start) noexcept
+{
+  Loop *loop = find_loop(table, command.loop_id);
+  if (loop == nullptr)
+  {
+    return;
+  }
+
+  if (command.command == eLoopCommand::Cancel)
+  {
+    // Withdraw every transition still waiting for this loop
+    auto end = std::remove_if(m_pending.begin(), m_pending.begin() + m_pending_count, [&](const LoopCommand &pending) {
+      return pending.loop_id == command.loop_id;
+    });
+    m_pending_count = static_cast<size_t>(end - m_pending.begin());
+    apply(*loop, command);
+    return;
+  }
+
+  m_pending[m_pending_count++] = command;
+
+  // Only an idle loop waits, one that records or plays keeps doing so until the frame arrives
+  if (command.frame > block_start && loop->get_state() == eLoopState::Idle)
+  {
+    loop->set_state(command.command == eLoopCommand::Record ? eLoopState::WaitingToRecord : eLoopState::WaitingToPlay);
+  }
+}
+
+void LoopEngine::apply(Loop &loop, const LoopCommand &command) noexcept
+{
+  const eLoopState state = loop.get_state();
+  switch (command.command)
+  {
+    case eLoopCommand::Record:
+    {
+      // The input lags the timeline, a take must be long enough to hold the late frames at its end
+      const size_t latency = m_input_latency.load(std::memory_order_relaxed);
+      const size_t longest = command.length_frames > 0 ? command.length_frames : m_capacity_frames;
+      loop.m_record_latency = 2 * latency <= longest ? latency : 0;
+      loop.m_skip_remaining = loop.m_record_latency;
+      loop.m_tail_remaining = 0;
+      loop.m_position = 0;
+      loop.m_record_target = command.length_frames;
+      loop.m_length.store(0, std::memory_order_release);
+      loop.set_state(eLoopState::Recording);
+      break;
+    }
+
+    case eLoopCommand::Play:
+      if (state == eLoopState::Recording)
+      {
+        loop.finish_recording();
+      }
+      else if (state != eLoopState::Playing && state != eLoopState::Overdubbing)
+      {
+        loop.m_position = 0;
+      }
+      loop.set_state(loop.get_length_frames() > 0 ? eLoopState::Playing : eLoopState::Idle);
+      break;
+
+    case eLoopCommand::Overdub:
+      if (state == eLoopState::Recording)
+      {
+        loop.finish_recording();
+      }
+      else if (state != eLoopState::Playing && state != eLoopState::Overdubbing)
+      {
+        loop.m_position = 0;
+      }
+      loop.set_state(loop.get_length_frames() > 0 ? eLoopState::Overdubbing : eLoopState::Idle);
+      break;
+
+    case eLoopCommand::Stop:
+      if (state == eLoopState::Recording)
+      {
+        loop.finish_recording();
+      }
+      loop.m_position = 0;
+      loop.set_state(eLoopState::Idle);
+      break;
+
+    case eLoopCommand::Cancel:
+      if (state == eLoopState::Recording)
+      {
+        loop.m_length.store(0, std::memory_order_release);
+      }
+      loop.m_position = 0;
+      loop.m_record_target = 0;
+      loop.m_skip_remaining = 0;
+      loop.m_tail_remaining = 0;
+      loop.set_state(eLoopState::Idle);
+      break;
+  }
+}
+
+void LoopEngine::process(framework::AudioBlockView &block, const midi::MidiEventList &events) noexcept
+{
+  (void)events;
+
+  const unsigned int n_frames = block.get_frame_count();
+  const uint64_t frame_count = m_frame_position.load(std::memory_order_relaxed);
+  if (!m_format_valid || block.get_channel_count() != m_config.channels)
+  {
+    m_frame_position.store(frame_count + n_frames, std::memory_order_release);
+    return;
+  }
+
+  // The transport has already been advanced over the device block by the stream that drives it.
+  // A graph renders a device block in passes, so later passes continue from where the last one ended
+  bool moving = true;
+  uint64_t block_start = frame_count;
+  if (p_transport)
+  {
+    const uint64_t transport_start = p_transport->get_block_start();
+    moving = p_transport->is_playing();
+    if (transport_start != m_transport_block_start || !moving)
+    {
+      m_transport_block_start = transport_start;
+      m_transport_cursor = transport_start;
+    }
+    block_start = m_transport_cursor;
+    m_transport_cursor += moving ? n_frames : 0;
+  }
+
+  auto table = m_table.read();
+
+  // Only drain what fits, the rest stays queued for the next block
+  m_commands.try_pop_batch([&](LoopCommand &&command) noexcept { schedule(*table, command, block_start); },
+                           m_pending.size() - m_pending_count);
+
+  unsigned int offset = 0;
+  while (offset < n_frames)
+  {
+    // Apply every command due at this frame, in the order they were pushed
+    const uint64_t frame = block_start + (moving ? offset : 0);
+    unsigned int next = n_frames;
+    size_t kept = 0;
+    for (size_t i = 0; i < m_pending_count; i++)
+    {
+      const LoopCommand &command = m_pending[i];
+      if (command.frame <= frame)
+      {
+        if (Loop *loop = find_loop(*table, command.loop_id))
+        {
+          apply(*loop, command);
+        }
+        continue;
+      }
+
+      if (moving && command.frame - block_start < next)
+      {
+        next = static_cast<unsigned int>(command.frame - block_start);
+      }
+      m_pending[kept++] = command;
+    }
+    m_pending_count = kept;
+
+    // Never render more than prepare() made room for
+    next = std::min(next, offset + m_max_block);
+    render(*table, block, offset, next - offset);
+    offset = next;
+  }
+
+  m_frame_position.store(frame_count + n_frames, std::memory_order_release);
+}
+
+/** @brief Render a stretch of the block in which no command takes effect. */
+void LoopEngine::render(const LoopTable &table, framework::AudioBlockView &block, unsigned int offset,
+                        unsigned int frames) noexcept
+{
+  // Keep the input aside, every loop records what came in rather than what the loops before it added
+  for (unsigned int channel = 0; channel < m_config.channels; channel++)
+  {
+    float *source = block.get_channel(channel) + offset;
+    std::copy_n(source, frames, m_input.data() + static_cast<size_t>(channel) * m_max_block);
+    if (!m_config.monitor_input)
+    {
+      std::fill_n(source, frames, 0.0f);
+    }
+  }
+
+  for (const LoopPtr &loop : table.loops)
+  {
+    render_loop(*loop, block, offset, frames);
+  }
+}
+
+void LoopEngine::render_loop(Loop &loop, framework::AudioBlockView &block, unsigned int offset,
+                             unsigned int frames) noexcept
+{
+  // Input frames before tail_end belong to the end of a take that has just closed
+  unsigned int tail_end = loop.write_tail(m_input.data(), m_max_block, frames);
+
+  unsigned int input_offset = 0;
+  while (input_offset < frames)
+  {
+    const unsigned int remaining = frames - input_offset;
+    const eLoopState state = loop.get_state();
+
+    if (state == eLoopState::Recording)
+    {
+      // Frames that arrive before the latency has passed predate the record command
+      if (loop.m_skip_remaining > 0)
+      {
+        const unsigned int skipped = static_cast<unsigned int>(std::min<size_t>(remaining, loop.m_skip_remaining));
+        loop.m_skip_remaining -= skipped;
+        input_offset += skipped;
+        continue;
+      }
+
+      const size_t limit = (loop.m_record_target > 0 ? loop.m_record_target : loop.m_capacity_frames) - loop.m_record_latency;
+      const unsigned int chunk = static_cast<unsigned int>(std::min<size_t>(remaining, limit - loop.m_position));
+      for (unsigned int channel = 0; channel < loop.m_channels; channel++)
+      {
+        const float *input = m_input.data() + static_cast<size_t>(channel) * m_max_block + input_offset;
+        std::copy_n(input, chunk, loop.get_channel(channel) + loop.m_position);
+      }
+      loop.m_position += chunk;
+      loop.m_length.store(loop.m_position, std::memory_order_release);
+      input_offset += chunk;
+
+      // A full or fixed-length recording closes on its last frame and plays from the next one
+      if (loop.m_position >= limit)
+      {
+        loop.finish_recording();
+        loop.set_state(eLoopState::Playing);
+        tail_end = input_offset + loop.write_tail(m_input.data() + input_offset, m_max_block, frames - input_offset);
+      }
+    }
+    else if (state == eLoopState::Playing || state == eLoopState::Overdubbing)
+    {
+      const size_t length = loop.get_length_frames();
+      if (length == 0)
+      {
+        loop.set_state(eLoopState::Idle);
+        return;
+      }
+
+      const unsigned int chunk = static_cast<unsigned int>(std::min<size_t>(remaining, length - loop.m_position));
+      if (!loop.is_muted())
+      {
+        for (unsigned int channel = 0; channel < loop.m_channels; channel++)
+        {
+          framework::dsp::add(block.get_channel(channel) + offset + input_offset, loop.get_channel(channel) + loop.m_position, chunk);
+        }
+      }
+
+      // The lap just played is heard before the input is layered onto it, as far behind the
+      // playhead as the input lags the timeline
+      if (state == eLoopState::Overdubbing)
+      {
+        const unsigned int take = tail_end > input_offset ? std::min(tail_end - input_offset, chunk) : 0;
+        const size_t latency = m_input_latency.load(std::memory_order_relaxed) % length;
+        layer_input(loop, input_offset + take, (loop.m_position + take + length - latency) % length, chunk - take);
+      }
+
+      loop.m_position += chunk;
+      if (loop.m_position >= length)
+      {
+        loop.m_position = 0;
+      }
+      input_offset += chunk;
+    }
+    else
+    {
+      return;
+    }
+  }
+}
+
+/** @brief Sum input frames into a loop from a position, wrapping at its end. */
+void LoopEngine::layer_input(Loop &loop, unsigned int input_offset, size_t position, unsigned int frames) noexcept
+{
+  const size_t length = loop.get_length_frames();
+  while (frames > 0)
+  {
+    const unsigned int chunk = static_cast<unsigned int>(std::min<size_t>(frames, length - position));
+    for (unsigned int channel = 0; channel < loop.m_channels; channel++)
+    {
+      framework::dsp::add(loop.get_channel(channel) + position,
+                          m_input.data() + static_cast<size_t>(channel) * m_max_block + input_offset, chunk);
+    }
+    input_offset += chunk;
+    frames -= chunk;
+    position = 0;
+  }
+}
+
+void LoopEngine::reset()
+{
+  std::lock_guard<std::mutex> lock(m_loops_mutex);
+  for (const LoopPtr &loop : m_loops)
+  {
+    if (loop->get_state() == eLoopState::Recording)
+    {
+      loop->finish_recording();
+    }
+
+    // Late frames that will never arrive are not part of the take
+    loop->m_length.store(loop->get_length_frames() - loop->m_tail_remaining, std::memory_order_release);
+    loop->m_tail_remaining = 0;
+    loop->m_position = 0;
+    loop->m_record_target = 0;
+    loop->set_state(eLoopState::Idle);
+  }
+
+  m_pending_count = 0;
+  m_transport_block_start = NO_TRANSPORT_BLOCK;
+  m_frame_position.store(0, std::memory_order_release);
+}
+
+std::string LoopEngine::to_string() const
+{
+  return "LoopEngine(Loops=" + std::to_string(get_loop_count()) +
+         ", CapacityFrames=" + std::to_string(m_capacity_frames) +
+         ", SampleRate=" + std::to_string(m_config.sample_rate) +
+         ", Channels=" + std::to_string(m_config.channels) + ")";
+}
@@ -0,0 +1,304 @@
+#include "offlinerenderer.h"
+#include "track.h"
+#include "file.h"
+#include "fileadapter.h"
+#include "audiograph.h"
+#include "denormals.h"
+#include "inputnode.h"
+#include "mixernode.h"
+#include "outputnode.h"
+#include "processornode.h"
+#include "logger.h"
+#include "threading.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#include <thread>
+#include <unordered_map>
+
+using namespace miniaudioengine;
+
+namespace
+{
+
+/** @struct RenderSource
+ *  @brief One track input, fed from memory into its InputNode ring one block at a time.
+ */
+struct RenderSource
+{
+  SampleBufferPtr samples;
+  framework::BufferPtr ring;
+  size_t position{0};
+};
+
+OfflineRenderResult fail(OfflineRenderResult result, std::chrono::steady_clock::time_point start)
+{
+  result.success = false;
+  result.render_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return result;
+}
+
+} // namespace
+
+OfflineRenderResult OfflineRenderer::render(const TrackList &tracks, const std::filesystem::path &output_path,
+                                            const OfflineRenderConfig &config) const
+{
+  const auto start = std::chrono::steady_clock::now();
+
+  OfflineRenderResult result;
+  result.output_path = output_path;
+
+  if (config.channels == 0 || config.frames_per_block == 0)
+  {
+    LOG_ERROR("OfflineRenderer: render - Invalid config ", config.to_string());
+    return fail(result, start);
+  }
+
+  dataplane::AudioGraph graph;
+  graph.set_worker_threads(config.worker_threads, false);
+  auto output_node = graph.add_output_node(nullptr);
+  auto master_node = graph.add_mixer_node(output_node);
+
+  unsigned int sample_rate = config.sample_rate;
+  std::vector<RenderSource> sources;
+  for (const TrackPtr &track : tracks)
+  {
+    if (!track)
+    {
+      continue;
+    }
+
+    if (track->is_playing())
+    {
+      LOG_WARNING("OfflineRenderer: render - Skipping track that is playing live ", track->to_string());
+      continue;
+    }
+
+    FilePtr file = std::dynamic_pointer_cast<File>(track->get_audio_input());
+    if (!file || file->get_file_type() != File::eFileType::Wav)
+    {
+      LOG_WARNING("OfflineRenderer: render - Skipping track without an audio file input ", track->to_string());
+      continue;
+    }
+
+    // The first file sets the render rate when the config does not, later files are converted to it
+    SampleBufferPtr samples = load(file->get_filepath(), sample_rate, config.resample_quality);
+    if (!samples)
+    {
+      LOG_ERROR("OfflineRenderer: render - Failed to load ", file->get_filepath().string());
+      return fail(result, start);
+    }
+
+    if (sample_rate == 0)
+    {
+      sample_rate = samples->get_sample_rate();
+    }
+
+    // Effects start from a clean state so repeated renders of the same session are identical
+    auto processor_node = graph.add_processor_node(master_node);
+    for (const framework::IProcessorPtr &processor : track->get_effects_processors())
+    {
+      processor->reset();
+      processor_node->add_processor(processor);
+    }
+
+    // The ring only ever holds the block about to be rendered
+    RenderSource source;
+    source.samples = samples;
+    source.ring = std::make_shared<framework::Buffer>(static_cast<size_t>(config.frames_per_block) * samples->get_channels());
+    auto input_node = graph.add_input_node(file, processor_node);
+    input_node->set_source(source.ring, samples->get_channels());
+    sources.push_back(std::move(source));
+  }
+
+  if (sources.empty())
+  {
+    LOG_ERROR("OfflineRenderer: render - No track has an audio file input to render");
+    return fail(result, start);
+  }
+
+  if (sample_rate == 0)
+  {
+    sample_rate = dataplane::AudioGraph::DEFAULT_SAMPLE_RATE;
+  }
+  result.sample_rate = sample_rate;
+
+  if (!graph.compile(config.channels, config.frames_per_block, sample_rate))
+  {
+    LOG_ERROR("OfflineRenderer: render - Failed to compile AudioGraph");
+    return fail(result, start);
+  }
+
+  unsigned long long total_frames = 0;
+  for (const RenderSource &source : sources)
+  {
+    total_frames = std::max<unsigned long long>(total_frames, source.samples->get_frames());
+  }
+  total_frames += config.tail_frames;
+  if (config.max_frames > 0)
+  {
+    total_frames = std::min(total_frames, config.max_frames);
+  }
+
+  // Queue several blocks so encoding overlaps with rendering the next ones
+  adapters::FileWriter writer;
+  adapters::FileWriter::Config writer_config;
+  writer_config.format = config.format;
+  writer_config.chunk_frames = std::max<size_t>(writer_config.chunk_frames, config.frames_per_block);
+  writer_config.preallocate_frames = total_frames;
+  if (!writer.open(output_path, config.channels, sample_rate, writer_config))
+  {
+    LOG_ERROR("OfflineRenderer: render - Failed to create ", output_path.string());
+    return fail(result, start);
+  }
+
+  LOG_INFO("OfflineRenderer: Rendering ", sources.size(), " tracks, ", total_frames, " frames to ",
+           output_path.string(), ". ", config.to_string());
+
+  std::vector<float> block(static_cast<size_t>(config.frames_per_block) * config.channels);
+  bool write_failed = false;
+  while (result.frames_rendered < total_frames)
+  {
+    const unsigned int n_frames = static_cast<unsigned int>(
+      std::min<unsigned long long>(config.frames_per_block, total_frames - result.frames_rendered));
+
+    // Inputs that have ended are left short and the InputNode pads them with silence
+    for (RenderSource &source : sources)
+    {
+      const unsigned int channels = source.samples->get_channels();
+      const size_t frames = std::min<size_t>(n_frames, source.samples->get_frames() - source.position);
+      source.ring->write(source.samples->get_samples().subspan(source.position * channels, frames * channels));
+      source.position += frames;
+    }
+
+    {
+      // Render in the floating-point mode of the realtime path, so a bounce matches playback
+      framework::ScopedFlushDenormals flush_denormals;
+      graph.process(block.data(), n_frames);
+    }
+
+    if (!writer.write_all(std::span<const float>(block.data(), static_cast<size_t>(n_frames) * config.channels)))
+    {
+      LOG_ERROR("OfflineRenderer: render - Failed to write ", output_path.string());
+      write_failed = true;
+      break;
+    }
+    result.frames_rendered += n_frames;
+  }
+
+  const bool closed = writer.close();
+  result.success = closed && !write_failed;
+  result.audio_seconds = static_cast<double>(result.frames_rendered) / sample_rate;
+  result.render_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  result.realtime_multiple = result.render_seconds > 0.0 ? result.audio_seconds / result.render_seconds : 0.0;
+
+  LOG_INFO("OfflineRenderer: Finished ", result.to_string());
+  return result;
+}
+
+std::vector<OfflineRenderResult> OfflineRenderer::render_parallel(const std::vector<OfflineRenderJob> &jobs, unsigned int max_threads) const
+{
+  std::vector<OfflineRenderResult> results(jobs.size());
+  if (jobs.empty())
+  {
+    return results;
+  }
+
+  if (max_threads == 0)
+  {
+    max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  // A render resets, prepares and runs the tracks' own processors, so jobs sharing a track or a processor,
+  // e.g. two jobs made from one session, are chained and rendered one after another
+  std::vector<size_t> parents(jobs.size());
+  std::iota(parents.begin(), parents.end(), 0);
+  auto find = [&parents](size_t job) {
+    while (parents[job] != job)
+    {
+      job = parents[job] = parents[parents[job]];
+    }
+    return job;
+  };
+
+  std::unordered_map<const void *, size_t> owners;
+  auto claim = [&](const void *object, size_t job) {
+    auto [it, inserted] = owners.emplace(object, job);
+    if (!inserted)
+    {
+      parents[find(job)] = find(it->second);
+    }
+  };
+  for (size_t job = 0; job < jobs.size(); job++)
+  {
+    for (const TrackPtr &track : jobs[job].tracks)
+    {
+      if (!track)
+      {
+        continue;
+      }
+      claim(track.get(), job);
+      for (const framework::IProcessorPtr &processor : track->get_effects_processors())
+      {
+        claim(processor.get(), job);
+      }
+    }
+  }
+
+  std::vector<std::vector<size_t>> chains;
+  std::unordered_map<size_t, size_t> chain_of_root;
+  for (size_t job = 0; job < jobs.size(); job++)
+  {
+    auto [it, inserted] = chain_of_root.emplace(find(job), chains.size());
+    if (inserted)
+    {
+      chains.emplace_back();
+    }
+    chains[it->second].push_back(job);
+  }
+
+  const size_t thread_count = std::min<size_t>(max_threads, chains.size());
+  LOG_INFO("OfflineRenderer: Rendering ", jobs.size(), " jobs in ", chains.size(), " independent chains on ",
+           thread_count, " threads");
+
+  // Threads take the next chain as they finish, so long and short jobs balance out
+  std::atomic<size_t> next_chain{0};
+  {
+    std::vector<std::jthread> threads;
+    threads.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; i++)
+    {
+      threads.emplace_back([&, i]() {
+        framework::threading::register_current_thread("OfflineRender" + std::to_string(i), framework::eThreadClass::Normal,
+                                                      static_cast<unsigned int>(i));
+        for (size_t chain = next_chain.fetch_add(1); chain < chains.size(); chain = next_chain.fetch_add(1))
+        {
+          for (size_t job : chains[chain])
+          {
+            results[job] = render(jobs[job].tracks, jobs[job].output_path, jobs[job].config);
+          }
+        }
+      });
+    }
+  }
+
+  return results;
+}
+
+SampleBufferPtr OfflineRenderer::load(const std::filesystem::path &path, unsigned int sample_rate,
+                                      framework::eResampleQuality quality) const
+{
+  if (p_sample_cache)
+  {
+    return p_sample_cache->load(path, sample_rate, quality);
+  }
+
+  SampleBufferPtr buffer = adapters::FileAdapter::map_file(path);
+  if (!buffer)
+  {
+    buffer = adapters::FileAdapter::decode_file(path);
+  }
+  return sample_rate > 0 ? framework::Resampler::resample(buffer, sample_rate, quality) : buffer;
+}
@@ -0,0 +1,192 @@
+#include "samplecache.h"
+#include "file.h"
+#include "fileadapter.h"
+#include "logger.h"
+
+using namespace miniaudioengine;
+
+SampleBufferPtr SampleCache::load(const std::filesystem::path &path)
+{
+  const std::string key = get_key(path);
+  if (SampleBufferPtr buffer = find_entry(key))
+  {
+    return buffer;
+  }
+
+  // Load outside the lock so other lookups are not stalled by disk I/O
+  SampleBufferPtr buffer = adapters::FileAdapter::map_file(key);
+  if (!buffer)
+  {
+    buffer = adapters::FileAdapter::decode_file(key);
+  }
+
+  if (!buffer)
+  {
+    LOG_ERROR("SampleCache: Failed to load ", key);
+    return nullptr;
+  }
+
+  buffer = insert_entry(key, buffer);
+  LOG_INFO("SampleCache: Loaded ", key, (buffer->is_mapped() ? " (mapped)" : " (decoded)"),
+           ". Frames=", buffer->get_frames(), ", Channels=", buffer->get_channels(),
+           ", Usage=", get_memory_usage(), "/", get_memory_budget(), " bytes");
+  return buffer;
+}
+
+SampleBufferPtr SampleCache::load(const FilePtr &file)
+{
+  if (!file)
+  {
+    return nullptr;
+  }
+  return load(file->get_filepath());
+}
+
+SampleBufferPtr SampleCache::load(const std::filesystem::path &path, unsigned int sample_rate,
+                                  framework::eResampleQuality quality)
+{
+  SampleBufferPtr source = load(path);
+  if (!source || sample_rate == 0 || source->get_sample_rate() == sample_rate)
+  {
+    return source;
+  }
+
+  // Copies at other rates share the file's key as a prefix so evict() can find them
+  const std::string key = get_key(path) + "@" + std::to_string(sample_rate) + "/" + framework::to_string(quality);
+  if (SampleBufferPtr buffer = find_entry(key))
+  {
+    return buffer;
+  }
+
+  // Convert outside the lock, a long file takes a while at high quality
+  SampleBufferPtr buffer = framework::Resampler::resample(source, sample_rate, quality);
+  if (!buffer)
+  {
+    LOG_ERROR("SampleCache: Failed to resample ", key);
+    return nullptr;
+  }
+
+  buffer = insert_entry(key, buffer);
+  LOG_INFO("SampleCache: Resampled ", key, " from ", source->get_sample_rate(), " Hz. Frames=", buffer->get_frames(),
+           ", Usage=", get_memory_usage(), "/", get_memory_budget(), " bytes");
+  return buffer;
+}
+
+SampleBufferPtr SampleCache::find(const std::filesystem::path &path)
+{
+  return find_entry(get_key(path));
+}
+
+void SampleCache::evict(const std::filesystem::path &path)
+{
+  const std::string key = get_key(path);
+  const std::string resampled_prefix = key + "@";
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto entry = m_entries.begin(); entry != m_entries.end();)
+  {
+    auto next = std::next(entry);
+    if (entry->first == key || entry->first.starts_with(resampled_prefix))
+    {
+      erase_entry(entry);
+    }
+    entry = next;
+  }
+}
+
+void SampleCache::clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.clear();
+  m_lru.clear();
+  m_memory_usage = 0;
+}
+
+void SampleCache::set_memory_budget(size_t memory_budget_bytes)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_memory_budget = memory_budget_bytes;
+  evict_to_budget();
+}
+
+size_t SampleCache::get_memory_budget() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_memory_budget;
+}
+
+size_t SampleCache::get_memory_usage() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_memory_usage;
+}
+
+size_t SampleCache::size() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_entries.size();
+}
+
+std::string SampleCache::get_key(const std::filesystem::path &path)
+{
+  return std::filesystem::weakly_canonical(path).string();
+}
+
+/** @brief Returns a cached buffer and marks it most recently used, or nullptr if it is not cached. */
+SampleBufferPtr SampleCache::find_entry(const std::string &key)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto found = m_entries.find(key);
+  if (found == m_entries.end())
+  {
+    return nullptr;
+  }
+
+  m_lru.splice(m_lru.begin(), m_lru, found->second.lru_position);
+  return found->second.buffer;
+}
+
+/** @brief Cache a buffer loaded without the lock held.
+ *  @return The cached buffer, which is another thread's if it cached the same key first.
+ */
+SampleBufferPtr SampleCache::insert_entry(const std::string &key, const SampleBufferPtr &buffer)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  // Another thread may have loaded the same file while the lock was released
+  auto found = m_entries.find(key);
+  if (found != m_entries.end())
+  {
+    m_lru.splice(m_lru.begin(), m_lru, found->second.lru_position);
+    return found->second.buffer;
+  }
+
+  m_lru.push_front(key);
+  m_entries.emplace(key, Entry{buffer, m_lru.begin()});
+  m_memory_usage += buffer->get_size_bytes();
+
+  evict_to_budget();
+  return buffer;
+}
+
+/** @note Caller must hold m_mutex. */
+void SampleCache::erase_entry(std::unordered_map<std::string, Entry>::iterator entry)
+{
+  m_memory_usage -= entry->second.buffer->get_size_bytes();
+  m_lru.erase(entry->second.lru_position);
+  m_entries.erase(entry);
+}
+
+/** @brief Evict least-recently-used entries until the cache fits its budget.
+ *  The most recently used entry is always kept, even if it alone exceeds the budget.
+ *  @note Caller must hold m_mutex.
+ */
+void SampleCache::evict_to_budget()
+{
+  while (m_memory_usage > m_memory_budget && m_lru.size() > 1)
+  {
+    auto found = m_entries.find(m_lru.back());
+    LOG_DEBUG("SampleCache: Evicted ", found->first);
+    erase_entry(found);
+  }
+}
@@ -0,0 +1,611 @@
+#include "sampler.h"
+#include "dspkernels.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace miniaudioengine;
+
+namespace
+{
+
+constexpr unsigned char SUSTAIN_PEDAL = 64;
+constexpr unsigned char ALL_SOUND_OFF = 120;
+constexpr unsigned char ALL_NOTES_OFF = 123;
+
+/** @brief Spare voices for fading out stolen ones, so a steal never cuts a voice dead. */
+size_t get_fade_voices(size_t max_voices)
+{
+  return std::max<size_t>(4, max_voices / 8);
+}
+
+unsigned int get_frames(double seconds, unsigned int sample_rate)
+{
+  return static_cast<unsigned int>(std::lround(std::max(seconds, 0.0) * sample_rate));
+}
+
+} // namespace
+
+std::string SamplerZone::to_string() const
+{
+  return "SamplerZone(Notes=" + std::to_string(low_note) + "-" + std::to_string(high_note) +
+         ", RootNote=" + std::to_string(root_note) +
+         ", Velocities=" + std::to_string(low_velocity) + "-" + std::to_string(high_velocity) +
+         ", Channel=" + (channel == ANY_CHANNEL ? std::string("Any") : std::to_string(channel)) +
+         ", Gain=" + std::to_string(gain) +
+         ", PitchTracking=" + std::string(pitch_tracking ? "true" : "false") +
+         ", OneShot=" + std::string(one_shot ? "true" : "false") +
+         ", ChokeGroup=" + std::to_string(choke_group) +
+         ", Frames=" + std::to_string(samples ? samples->get_frames() : 0) + ")";
+}
+
+void Sampler::VoicePool::resize(size_t voices)
+{
+  samples.assign(voices, nullptr);
+  frames.assign(voices, 0);
+  channels.assign(voices, 0);
+  position.assign(voices, 0.0);
+  increment.assign(voices, 1.0);
+  gain.assign(voices, 0.0f);
+  level.assign(voices, 0.0f);
+  level_step.assign(voices, 0.0f);
+  stage_frames.assign(voices, 0);
+  release_frames.assign(voices, 0);
+  stage.assign(voices, eVoiceStage::Sustain);
+  note.assign(voices, 0);
+  channel.assign(voices, 0);
+  one_shot.assign(voices, 0);
+  sustained.assign(voices, 0);
+  choke_group.assign(voices, 0);
+  started.assign(voices, 0);
+  generation.assign(voices, 0);
+}
+
+Sampler::Sampler(size_t max_voices) :
+  m_max_voices(std::max<size_t>(max_voices, 1)),
+  m_pool_size(m_max_voices + get_fade_voices(m_max_voices))
+{
+  m_voices.resize(m_pool_size);
+  m_active.assign(m_pool_size, 0);
+  m_free.resize(m_pool_size);
+  for (size_t i = 0; i < m_pool_size; i++)
+  {
+    // Popped from the back, so the lowest voices are used first
+    m_free[i] = static_cast<unsigned int>(m_pool_size - 1 - i);
+  }
+  m_free_count = m_pool_size;
+
+  auto table = std::make_unique<ZoneTable>();
+  table->generation = m_generation;
+  m_table.publish(std::move(table));
+}
+
+unsigned int Sampler::add_zone(const SamplerZone &zone)
+{
+  if (!zone.samples || zone.samples->get_frames() == 0)
+  {
+    LOG_ERROR("Sampler: add_zone - Zone has no samples.");
+    return 0;
+  }
+  if (zone.samples->get_channels() == 0 || zone.samples->get_channels() > MAX_SAMPLE_CHANNELS)
+  {
+    LOG_ERROR("Sampler: add_zone - Samples have ", zone.samples->get_channels(), " channels, at most ",
+              MAX_SAMPLE_CHANNELS, " are supported.");
+    return 0;
+  }
+
+  std::lock_guard<std::mutex> lock(m_zones_mutex);
+  const unsigned int id = m_next_zone_id++;
+  m_zones.push_back(ZoneEntry{id, zone});
+  publish_locked();
+
+  LOG_INFO("Sampler: Added zone ", id, " ", zone.to_string());
+  return id;
+}
+
+bool Sampler::remove_zone(unsigned int zone_id)
+{
+  std::lock_guard<std::mutex> lock(m_zones_mutex);
+  auto found = std::find_if(m_zones.begin(), m_zones.end(), [zone_id](const ZoneEntry &entry) {
+    return entry.id == zone_id;
+  });
+  if (found == m_zones.end())
+  {
+    LOG_ERROR("Sampler: remove_zone - Zone ", zone_id, " does not exist.");
+    return false;
+  }
+
+  m_retired.push_back(RetiredSamples{m_generation, found->zone.samples});
+  m_zones.erase(found);
+  publish_locked();
+  return true;
+}
+
+void Sampler::clear_zones()
+{
+  std::lock_guard<std::mutex> lock(m_zones_mutex);
+  for (const ZoneEntry &entry : m_zones)
+  {
+    m_retired.push_back(RetiredSamples{m_generation, entry.zone.samples});
+  }
+  m_zones.clear();
+  publish_locked();
+}
+
+size_t Sampler::get_zone_count() const
+{
+  std::lock_guard<std::mutex> lock(m_zones_mutex);
+  return m_zones.size();
+}
+
+/** @brief Hand the audio thread a copy of the zones under a new generation.
+ *  @note Caller must hold m_zones_mutex.
+ */
+void Sampler::publish_locked()
+{
+  auto table = std::make_unique<ZoneTable>();
+  table->zones = m_zones;
+  table->generation = ++m_generation;
+  m_table.publish(std::move(table));
+  prune_retired_locked();
+}
+
+/** @brief Release the samples of removed zones once no voice started from a table holding them is left.
+ *  @note Caller must hold m_zones_mutex.
+ */
+void Sampler::prune_retired_locked()
+{
+  const uint64_t oldest = m_oldest_generation.load(std::memory_order_acquire);
+  std::erase_if(m_retired, [oldest](const RetiredSamples &retired) { return retired.generation < oldest; });
+}
+
+void Sampler::prepare(unsigned int sample_rate, unsigned int max_block, unsigned int channels)
+{
+  (void)channels;
+  m_sample_rate = sample_rate;
+  m_max_block = max_block;
+  m_fade_frames = std::max(get_frames(FADE_SECONDS, sample_rate), 1u);
+  m_scratch.assign(static_cast<size_t>(MAX_SAMPLE_CHANNELS) * max_block, 0.0f);
+  m_envelope.assign(max_block, 0.0f);
+  reset();
+}
+
+void Sampler::reset()
+{
+  while (m_active_count > 0)
+  {
+    free_voice(m_active_count - 1);
+  }
+  m_note_count = 0;
+  m_sustain.fill(false);
+  m_active_voices.store(0, std::memory_order_relaxed);
+  m_stolen_voices.store(0, std::memory_order_relaxed);
+
+  // No voice is left, so nothing reads retired samples
+  std::lock_guard<std::mutex> lock(m_zones_mutex);
+  m_oldest_generation.store(m_generation, std::memory_order_release);
+  m_retired.clear();
+}
+
+void Sampler::process(framework::AudioBlockView &block, const midi::MidiEventList &events) noexcept
+{
+  if (m_max_block == 0)
+  {
+    return;
+  }
+
+  auto table = m_table.read();
+  midi::split_at_events(
+    block, events,
+    [this, &table](const midi::MidiEvent &event) { handle_message(*table, event.message); },
+    [this](framework::AudioBlockView &segment) { render(segment); });
+
+  uint64_t oldest = table->generation;
+  for (size_t i = 0; i < m_active_count; i++)
+  {
+    oldest = std::min(oldest, m_voices.generation[m_active[i]]);
+  }
+  m_oldest_generation.store(oldest, std::memory_order_release);
+  m_active_voices.store(m_active_count, std::memory_order_relaxed);
+}
+
+void Sampler::handle_message(const ZoneTable &table, const midi::MidiMessage &message) noexcept
+{
+  if (message.channel >= MIDI_CHANNELS)
+  {
+    return;
+  }
+
+  switch (message.type)
+  {
+    case midi::eMidiMessageType::NoteOn:
+      if (message.data2 == 0)
+      {
+        note_off(message.channel, message.data1);
+      }
+      else
+      {
+        note_on(table, message.channel, message.data1, message.data2);
+      }
+      break;
+    case midi::eMidiMessageType::NoteOff:
+      note_off(message.channel, message.data1);
+      break;
+    case midi::eMidiMessageType::ControlChange:
+      if (message.data1 == SUSTAIN_PEDAL)
+      {
+        set_sustain(message.channel, message.data2 >= 64);
+      }
+      else if (message.data1 == ALL_NOTES_OFF)
+      {
+        release_all(message.channel);
+      }
+      else if (message.data1 == ALL_SOUND_OFF)
+      {
+        fade_all(message.channel);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void Sampler::note_on(const ZoneTable &table, unsigned int channel, unsigned int note, unsigned int velocity) noexcept
+{
+  m_note_counter++;
+  for (const ZoneEntry &entry : table.zones)
+  {
+    const SamplerZone &zone = entry.zone;
+    if ((zone.channel != SamplerZone::ANY_CHANNEL && zone.channel != channel) ||
+        note < zone.low_note || note > zone.high_note || velocity < zone.low_velocity || velocity > zone.high_velocity)
+    {
+      continue;
+    }
+
+    // Layers of this note share its counter, so a zone never chokes a layer started with it
+    if (zone.choke_group != 0)
+    {
+      for (size_t i = 0; i < m_active_count; i++)
+      {
+        const unsigned int voice = m_active[i];
+        if (m_voices.choke_group[voice] == zone.choke_group && m_voices.started[voice] != m_note_counter)
+        {
+          fade_voice(voice);
+        }
+      }
+    }
+    start_voice(table, zone, note, channel, velocity);
+  }
+}
+
+void Sampler::start_voice(const ZoneTable &table, const SamplerZone &zone, unsigned int note, unsigned int channel,
+                          unsigned int velocity) noexcept
+{
+  const unsigned int voice = allocate_voice();
+  const framework::SampleBuffer &samples = *zone.samples;
+  const double rate_ratio = m_sample_rate > 0 ? static_cast<double>(samples.get_sample_rate()) / m_sample_rate : 1.0;
+  const double semitones = zone.pitch_tracking ? static_cast<double>(note) - static_cast<double>(zone.root_note) : 0.0;
+  const float normalized_velocity = static_cast<float>(velocity) / 127.0f;
+  const unsigned int attack_frames = get_frames(zone.attack_seconds, m_sample_rate);
+
+  VoicePool &voices = m_voices;
+  voices.samples[voice] = samples.data();
+  voices.frames[voice] = samples.get_frames();
+  voices.channels[voice] = samples.get_channels();
+  voices.position[voice] = 0.0;
+  voices.increment[voice] = rate_ratio * std::exp2(semitones / 12.0);
+  voices.gain[voice] = zone.gain * normalized_velocity * normalized_velocity;
+  voices.stage[voice] = attack_frames > 0 ? eVoiceStage::Attack : eVoiceStage::Sustain;
+  voices.level[voice] = attack_frames > 0 ? 0.0f : 1.0f;
+  voices.level_step[voice] = attack_frames > 0 ? 1.0f / static_cast<float>(attack_frames) : 0.0f;
+  voices.stage_frames[voice] = attack_frames;
+  voices.release_frames[voice] = std::max(get_frames(zone.release_seconds, m_sample_rate), 1u);
+  voices.note[voice] = static_cast<unsigned char>(note);
+  voices.channel[voice] = static_cast<unsigned char>(channel);
+  voices.one_shot[voice] = zone.one_shot ? 1 : 0;
+  voices.sustained[voice] = 0;
+  voices.choke_group[voice] = zone.choke_group;
+  voices.started[voice] = m_note_counter;
+  voices.generation[voice] = table.generation;
+
+  m_active[m_active_count++] = voice;
+  m_note_count++;
+}
+
+/** @brief Returns a free voice, stealing one when max_voices notes are sounding.
+ *  The quietest releasing voice goes first, then the oldest. A stolen voice fades out in a spare
+ *  slot. Only when the spare slots are used up too is the quietest fading voice cut off.
+ */
+unsigned int Sampler::allocate_voice() noexcept
+{
+  if (m_note_count >= m_max_voices)
+  {
+    const VoicePool &voices = m_voices;
+    size_t victim = m_active_count;
+    for (size_t i = 0; i < m_active_count; i++)
+    {
+      const unsigned int voice = m_active[i];
+      if (voices.stage[voice] == eVoiceStage::Fade)
+      {
+        continue;
+      }
+      if (victim == m_active_count)
+      {
+        victim = i;
+        continue;
+      }
+
+      const unsigned int best = m_active[victim];
+      const bool releasing = voices.stage[voice] == eVoiceStage::Release;
+      const bool best_releasing = voices.stage[best] == eVoiceStage::Release;
+      if (releasing != best_releasing ? releasing
+                                      : (releasing ? voices.level[voice] < voices.level[best]
+                                                   : voices.started[voice] < voices.started[best]))
+      {
+        victim = i;
+      }
+    }
+
+    if (victim < m_active_count)
+    {
+      fade_voice(m_active[victim]);
+      m_stolen_voices.store(m_stolen_voices.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+  }
+
+  if (m_free_count == 0)
+  {
+    size_t quietest = 0;
+    float quietest_level = 2.0f;
+    for (size_t i = 0; i < m_active_count; i++)
+    {
+      const unsigned int voice = m_active[i];
+      if (m_voices.stage[voice] == eVoiceStage::Fade && m_voices.level[voice] < quietest_level)
+      {
+        quietest = i;
+        quietest_level = m_voices.level[voice];
+      }
+    }
+    free_voice(quietest);
+  }
+
+  return m_free[--m_free_count];
+}
+
+void Sampler::note_off(unsigned int channel, unsigned int note) noexcept
+{
+  for (size_t i = 0; i < m_active_count; i++)
+  {
+    const unsigned int voice = m_active[i];
+    if (m_voices.channel[voice] != channel || m_voices.note[voice] != note || m_voices.one_shot[voice] != 0)
+    {
+      continue;
+    }
+
+    if (m_sustain[channel])
+    {
+      m_voices.sustained[voice] = 1;
+    }
+    else
+    {
+      release_voice(voice);
+    }
+  }
+}
+
+void Sampler::set_sustain(unsigned int channel, bool down) noexcept
+{
+  m_sustain[channel] = down;
+  if (down)
+  {
+    return;
+  }
+
+  for (size_t i = 0; i < m_active_count; i++)
+  {
+    const unsigned int voice = m_active[i];
+    if (m_voices.channel[voice] == channel && m_voices.sustained[voice] != 0)
+    {
+      release_voice(voice);
+    }
+  }
+}
+
+void Sampler::release_all(unsigned int channel) noexcept
+{
+  for (size_t i = 0; i < m_active_count; i++)
+  {
+    const unsigned int voice = m_active[i];
+    if (m_voices.channel[voice] == channel && m_voices.one_shot[voice] == 0)
+    {
+      release_voice(voice);
+    }
+  }
+}
+
+void Sampler::fade_all(unsigned int channel) noexcept
+{
+  for (size_t i = 0; i < m_active_count; i++)
+  {
+    const unsigned int voice = m_active[i];
+    if (m_voices.channel[voice] == channel)
+    {
+      fade_voice(voice);
+    }
+  }
+}
+
+void Sampler::release_voice(unsigned int voice) noexcept
+{
+  const eVoiceStage stage = m_voices.stage[voice];
+  if (stage == eVoiceStage::Release || stage == eVoiceStage::Fade)
+  {
+    return;
+  }
+
+  m_voices.stage[voice] = eVoiceStage::Release;
+  m_voices.stage_frames[voice] = m_voices.release_frames[voice];
+  m_voices.level_step[voice] = -m_voices.level[voice] / static_cast<float>(m_voices.release_frames[voice]);
+  m_voices.sustained[voice] = 0;
+}
+
+void Sampler::fade_voice(unsigned int voice) noexcept
+{
+  if (m_voices.stage[voice] == eVoiceStage::Fade)
+  {
+    return;
+  }
+
+  m_voices.stage[voice] = eVoiceStage::Fade;
+  m_voices.stage_frames[voice] = m_fade_frames;
+  m_voices.level_step[voice] = -m_voices.level[voice] / static_cast<float>(m_fade_frames);
+  m_voices.sustained[voice] = 0;
+  m_note_count--;
+}
+
+/** @brief Return an active voice to the free list. The last active voice takes its place. */
+void Sampler::free_voice(size_t active_index) noexcept
+{
+  const unsigned int voice = m_active[active_index];
+  if (m_voices.stage[voice] != eVoiceStage::Fade)
+  {
+    m_note_count--;
+  }
+  m_voices.samples[voice] = nullptr;
+  m_active[active_index] = m_active[--m_active_count];
+  m_free[m_free_count++] = voice;
+}
+
+void Sampler::render(framework::AudioBlockView &block) noexcept
+{
+  for (unsigned int offset = 0; offset < block.get_frame_count(); offset += m_max_block)
+  {
+    framework::AudioBlockView chunk = block.get_sub_block(offset, std::min(block.get_frame_count() - offset, m_max_block));
+    size_t i = 0;
+    while (i < m_active_count)
+    {
+      if (render_voice(m_active[i], chunk))
+      {
+        i++;
+      }
+      else
+      {
+        free_voice(i);
+      }
+    }
+  }
+}
+
+/** @brief Sum one voice into a block, splitting it where the envelope changes stage.
+ *  @return False once the voice has finished, at the end of its samples or its release.
+ */
+bool Sampler::render_voice(unsigned int voice, framework::AudioBlockView &block) noexcept
+{
+  VoicePool &voices = m_voices;
+  const unsigned int channels = voices.channels[voice];
+  const unsigned int outputs = block.get_channel_count();
+  const unsigned int frames = block.get_frame_count();
+
+  unsigned int done = 0;
+  while (done < frames)
+  {
+    const bool ramping = voices.stage[voice] != eVoiceStage::Sustain;
+    const unsigned int chunk = ramping ? std::min(frames - done, voices.stage_frames[voice]) : frames - done;
+    const size_t rendered = read_voice(voice, chunk);
+
+    if (rendered > 0)
+    {
+      // A sustained voice folds its level into the gain, only ramps need a value per frame
+      float gain = voices.gain[voice];
+      if (ramping)
+      {
+        framework::dsp::fill_ramp(m_envelope.data(), voices.level[voice], voices.level_step[voice], rendered);
+        for (unsigned int channel = 0; channel < channels; channel++)
+        {
+          framework::dsp::multiply(m_scratch.data() + channel * m_max_block, m_envelope.data(), rendered);
+        }
+        voices.level[voice] += voices.level_step[voice] * static_cast<float>(rendered);
+      }
+      else
+      {
+        gain *= voices.level[voice];
+      }
+
+      // Mono feeds every output, extra sample channels wrap around onto the outputs
+      for (unsigned int route = 0; route < std::max(channels, outputs); route++)
+      {
+        framework::dsp::add_with_gain(block.get_channel(route % outputs) + done,
+                                      m_scratch.data() + (route % channels) * m_max_block, gain, rendered);
+      }
+    }
+
+    if (rendered < chunk)
+    {
+      return false;
+    }
+
+    done += chunk;
+    if (ramping)
+    {
+      voices.stage_frames[voice] -= chunk;
+      if (voices.stage_frames[voice] == 0)
+      {
+        if (voices.stage[voice] != eVoiceStage::Attack)
+        {
+          return false;
+        }
+        voices.stage[voice] = eVoiceStage::Sustain;
+        voices.level[voice] = 1.0f;
+        voices.level_step[voice] = 0.0f;
+      }
+    }
+  }
+  return true;
+}
+
+/** @brief Read up to a number of frames of a voice into the planar scratch channels and advance it.
+ *  @return Frames read, fewer than asked once the samples run out.
+ */
+size_t Sampler::read_voice(unsigned int voice, size_t frames) noexcept
+{
+  VoicePool &voices = m_voices;
+  const float *samples = voices.samples[voice];
+  const size_t length = voices.frames[voice];
+  const unsigned int channels = voices.channels[voice];
+  const double position = voices.position[voice];
+  const double increment = voices.increment[voice];
+
+  size_t n = 0;
+  if (increment == 1.0 && position == std::floor(position))
+  {
+    // At the recorded pitch and rate a voice is a straight copy, e.g. drums
+    const size_t index = static_cast<size_t>(position);
+    n = index < length ? std::min(frames, length - index) : 0;
+    framework::dsp::deinterleave(m_scratch.data(), m_max_block, samples + index * channels, channels, n);
+  }
+  else if (position + 1.0 < static_cast<double>(length))
+  {
+    // Interpolation reads the frame after every position, so stop one frame short of the end
+    n = std::min(frames, static_cast<size_t>(std::ceil((static_cast<double>(length - 1) - position) / increment)));
+    while (n > 0 && static_cast<size_t>(position + increment * static_cast<double>(n - 1)) + 1 >= length)
+    {
+      n--;
+    }
+    for (unsigned int channel = 0; channel < channels; channel++)
+    {
+      framework::dsp::interpolate_linear(m_scratch.data() + channel * m_max_block, samples + channel, channels,
+                                         position, increment, n);
+    }
+  }
+
+  voices.position[voice] = position + increment * static_cast<double>(n);
+  return n;
+}
+
+std::string Sampler::to_string() const
+{
+  return "Sampler(Zones=" + std::to_string(get_zone_count()) +
+         ", MaxVoices=" + std::to_string(m_max_voices) +
+         ", ActiveVoices=" + std::to_string(get_active_voice_count()) + ")";
+}
@@ -3,8 +3,14 @@
 #include "io.h"
 #include "device.h"
 #include "file.h"
+#include "networkstream.h"
 #include "miditypes.h"
 #include "logger.h"
+#include "audiograph.h"
+#include "inputnode.h"
+#include "outputnode.h"
+#include "processornode.h"
+#include "filewriter.h"
 
 #include <iostream>
 #include <stdexcept>
@@ -23,7 +29,7 @@ using namespace miniaudioengine;
 // ============================================================================
 
 /** @brief Adds an audio input to the track.
- *  @param input The audio input device or file.
+ *  @param input The audio input device, file or network stream.
  */
 void Track::add_audio_input(const IInputOutputPtr &input)
 {
@@ -51,6 +57,12 @@ void Track::add_audio_input(const IInputOutputPtr &input)
     p_audio_input = input;
   }
 
+  if (input->get_type() == framework::Network)
+  {
+    LOG_INFO("Track: Added Audio Input - ", input->to_string());
+    p_audio_input = input;
+  }
+
   input->set_direction(framework::eInputOutputDirection::Input);
 }
 
@@ -110,6 +122,12 @@ void Track::add_audio_output(const IInputOutputPtr &output)
     p_audio_output = output;
   }
 
+  if (output->get_type() == framework::Network)
+  {
+    LOG_INFO("Track: Added Audio Output - ", output->to_string());
+    p_audio_output = output;
+  }
+
   output->set_direction(framework::eInputOutputDirection::Output);
 }
 
@@ -235,6 +253,25 @@ IInputOutputPtr Track::get_midi_output() const
 void Track::add_effects_processor(const IProcessorPtr &processor)
 {
   m_effects_processors.push_back(processor);
+
+  if (!is_playing() || !p_audio_graph || !p_effects_node)
+  {
+    return;
+  }
+
+  // Output <- effect <- running chain, committed as one edit so the output crossfades from dry to wet
+  IAudioGraphNodePtr output_node = p_audio_graph->get_root_node();
+  auto effect_node = p_audio_graph->add_processor_node();
+  effect_node->add_processor(processor);
+  p_audio_graph->disconnect(output_node, p_effects_node);
+  p_audio_graph->connect(output_node, effect_node);
+  p_audio_graph->connect(effect_node, p_effects_node);
+  p_effects_node = effect_node;
+
+  if (!p_audio_graph->commit())
+  {
+    LOG_ERROR("Track: add_effects_processor - Failed to insert ", processor->to_string(), " while playing");
+  }
 }
 
 std::vector<framework::IProcessorPtr> Track::get_effects_processors() const
@@ -247,7 +284,20 @@ std::vector<framework::IProcessorPtr> Track::get_effects_processors() const
  *  If the track has a MIDI input device, it opens the port and starts the MIDI dataplane.
  *  Then the audio stream is started via the audio controller.
  */
-bool Track::play()
+bool Track::play(const framework::StreamConfig &config)
+{
+  return start_playback(config, nullptr);
+}
+
+bool Track::play(const framework::StreamConfig &config, DeviceService &device_service)
+{
+  return start_playback(config, &device_service);
+}
+
+/** @brief Opens or attaches every stream of the track.
+ *  @param device_service Service whose shared streams carry the track's audio devices, or nullptr to open them directly.
+ */
+bool Track::start_playback(const framework::StreamConfig &config, DeviceService *device_service)
 {
   // If already playing, do nothing
   if (is_playing())
@@ -256,23 +306,58 @@ bool Track::play()
     return false;
   }
 
-  m_state = eTrackState::Stopped;
-  framework::BufferPtr buffer = std::make_shared<Buffer>();
+  m_state.store(eTrackState::Stopped, std::memory_order_release);
+  p_statistics->reset();
+  framework::BufferPtr buffer = std::make_shared<Buffer>(config.get_ring_capacity(get_stream_channels()));
+  p_midi_queue = has_midi_input() ? std::make_shared<framework::MidiQueue>(framework::MIDI_QUEUE_SIZE) : nullptr;
+
+  // Devices streamed by the service are attached to its shared streams instead of opened here.
+  // A recorded input keeps its own stream, which feeds the FileWriter directly
+  const bool shares_input = device_service != nullptr && has_audio_input() &&
+                            get_audio_input()->get_type() == framework::Device && !is_recording_track();
+  const bool shares_output = device_service != nullptr && has_audio_output() &&
+                             get_audio_output()->get_type() == framework::Device;
+
+  // Audio Input and Output on one device. Falls back to two streams if the duplex stream cannot open
+  const bool duplex = !shares_input && !shares_output && is_duplex_track(config) && open_duplex_stream(buffer, config);
 
   // Audio Input
-  if (has_audio_input())
+  if (has_audio_input() && !duplex && !shares_input)
   {
+    if (is_recording_track() && !start_recording(config))
+      return false;
+
+    // A recorded input feeds the FileWriter directly, nothing drains the Buffer
     LOG_INFO("Track: play - Opening audio input ", get_audio_input()->to_string());
-    if (!open_stream(get_audio_input(), buffer))
+    if (!open_stream(get_audio_input(), is_recording_track() ? nullptr : buffer, config))
       return false;
   }
 
-  // Audio Output
-  if (has_audio_output())
+  if ((shares_input || shares_output) && !attach_device_streams(buffer, config, *device_service, shares_input, shares_output))
+    return false;
+
+  // Audio Output. A file output is written by the recorder started with the input
+  if (has_audio_output() && !is_recording_track() && !duplex && !shares_output)
   {
     LOG_INFO("Track: play - Opening audio output ", get_audio_output()->to_string());
-    // TODO - Pass input buffer for audio output
-    if (!open_stream(get_audio_output(), buffer))
+    const bool renders_graph = get_audio_output()->get_type() == framework::Device ||
+                               get_audio_output()->get_type() == framework::Network;
+    if (renders_graph && !build_audio_graph(buffer, config))
+      return false;
+
+    if (auto device = std::dynamic_pointer_cast<Device>(get_audio_output()))
+    {
+      device->set_audio_graph(p_audio_graph);
+      device->set_statistics(p_statistics);
+    }
+
+    if (auto network = std::dynamic_pointer_cast<NetworkStream>(get_audio_output()))
+    {
+      network->set_audio_graph(p_audio_graph);
+      network->set_statistics(p_statistics);
+    }
+
+    if (!open_stream(get_audio_output(), buffer, config))
       return false;
   }
 
@@ -280,7 +365,14 @@ bool Track::play()
   if (has_midi_input())
   {
     LOG_INFO("Track: play - Opening MIDI input ", get_midi_input()->to_string());
-    if (!open_stream(get_midi_input(), nullptr))
+    if (auto device = std::dynamic_pointer_cast<Device>(get_midi_input()))
+    {
+      // Timestamp messages against the stream that renders them
+      device->set_midi_queue(p_midi_queue, p_audio_graph ? p_audio_graph->get_stream_clock() : nullptr);
+      device->set_statistics(p_statistics);
+    }
+
+    if (!open_stream(get_midi_input(), nullptr, config))
       return false;
   }
 
@@ -288,11 +380,11 @@ bool Track::play()
   if (has_midi_output())
   {
     LOG_INFO("Track: play - Opening MIDI output ", get_midi_output()->to_string());
-    if (!open_stream(get_midi_output(), nullptr))
+    if (!open_stream(get_midi_output(), nullptr, config))
       return false;
   }
 
-  m_state = eTrackState::Playing;
+  m_state.store(eTrackState::Playing, std::memory_order_release);
 
   LOG_INFO("Track: Started playing.");
   return true;
@@ -310,7 +402,15 @@ bool Track::stop()
     LOG_WARNING("Track: Not currently playing.");
   }
 
-  m_state = eTrackState::Stopped;
+  m_state.store(eTrackState::Stopped, std::memory_order_release);
+
+  detach_device_streams();
+  p_gate->open();
+
+  if (p_recorder && !stop_recording())
+  {
+    return false;
+  }
 
   return true;
 }
@@ -328,40 +428,122 @@ void Track::handle_midi_message(const midi::MidiMessage& message)
   {
     case midi::eMidiMessageType::NoteOn:
     {
-      midi::MidiNoteMessage note_on_msg = static_cast<const midi::MidiNoteMessage&>(message);
+      midi::MidiNoteMessage note_on_msg{message};
       LOG_INFO("Track: Note On - ", note_on_msg.to_string());
       m_note_on_callback(note_on_msg, shared_from_this());
       break;
     }
     case midi::eMidiMessageType::NoteOff:
     {
-      midi::MidiNoteMessage note_off_msg = static_cast<const midi::MidiNoteMessage&>(message);
+      midi::MidiNoteMessage note_off_msg{message};
       LOG_INFO("Track: Note Off - ", note_off_msg.to_string());
       m_note_off_callback(note_off_msg, shared_from_this());
       break;
     }
     case midi::eMidiMessageType::ControlChange:
     {
-      midi::MidiControlMessage control_change_msg = static_cast<const midi::MidiControlMessage &>(message);
+      midi::MidiControlMessage control_change_msg{message};
       LOG_INFO("Track: Control Change - ", control_change_msg.to_string());
       m_control_change_callback(control_change_msg, shared_from_this());
       break;
     }
     default:
-      LOG_INFO("Track: Unknown MIDI Message Type - ", message.type_name);
+      LOG_INFO("Track: Unknown MIDI Message Type - ", message.type_name());
       break;
   }
 }
 
+TrackStatistics Track::get_statistics() const
+{
+  TrackStatistics stats;
+  static_cast<framework::StreamStatisticsSnapshot &>(stats) = p_statistics->get_snapshot();
+  stats.is_playing = m_state.load(std::memory_order_acquire) == eTrackState::Playing;
+  stats.input_drift_ppm = p_input_node ? p_input_node->get_drift_ppm() : 0.0;
+  return stats;
+}
+
 /** @brief Check if the track is currently playing.
  *  @return True if the track is playing, false otherwise.
  */
 bool Track::is_playing()
 {
-  return m_state == eTrackState::Playing;
+  return m_state.load(std::memory_order_acquire) == eTrackState::Playing;
 }
 
-bool Track::open_stream(const framework::IInputOutputPtr &stream, const framework::BufferPtr &buffer)
+void Track::arm_start()
+{
+  if (p_gate->get_start_frame() == 0)
+  {
+    p_gate->arm();
+  }
+}
+
+void Track::disarm_start()
+{
+  p_gate->disarm();
+}
+
+bool Track::is_prerolled(size_t frames) const
+{
+  FilePtr file = get_input_file();
+  framework::AudioSourcePtr source = file ? file->get_audio_source() : nullptr;
+  if (!source)
+  {
+    return true;
+  }
+
+  const uint64_t total = file->get_total_frames();
+  const uint64_t remaining = total > file->get_position() ? total - file->get_position() : 0;
+  return file->get_buffered_frames() >= std::min<uint64_t>(frames, remaining);
+}
+
+bool Track::seek(uint64_t frame)
+{
+  FilePtr file = get_input_file();
+  return file && file->seek(frame);
+}
+
+uint64_t Track::get_position() const
+{
+  FilePtr file = get_input_file();
+  return file ? file->get_position() : 0;
+}
+
+bool Track::set_loop_region(uint64_t start_frame, uint64_t end_frame)
+{
+  FilePtr file = get_input_file();
+  return file && file->set_loop_region(start_frame, end_frame);
+}
+
+bool Track::clear_loop_region()
+{
+  FilePtr file = get_input_file();
+  if (!file)
+  {
+    return false;
+  }
+  file->clear_loop_region();
+  return true;
+}
+
+bool Track::add_cue_point(uint64_t frame, double preload_seconds)
+{
+  FilePtr file = get_input_file();
+  return file && file->add_cue_point(frame, preload_seconds);
+}
+
+bool Track::remove_cue_point(uint64_t frame)
+{
+  FilePtr file = get_input_file();
+  return file && file->remove_cue_point(frame);
+}
+
+FilePtr Track::get_input_file() const
+{
+  return has_audio_input() ? std::dynamic_pointer_cast<File>(get_audio_input()) : nullptr;
+}
+
+bool Track::open_stream(const framework::IInputOutputPtr &stream, const framework::BufferPtr &buffer, const framework::StreamConfig &config)
 {
   if (stream->is_stream_open())
   {
@@ -373,7 +555,7 @@ bool Track::open_stream(const framework::IInputOutputPtr &stream, const framewor
     }
   }
 
-  if (!stream->open_stream(buffer))
+  if (!stream->open_stream(buffer, config))
   {
     LOG_ERROR("Track: play - Failed to open stream ", stream->to_string());
     return false;
@@ -382,6 +564,275 @@ bool Track::open_stream(const framework::IInputOutputPtr &stream, const framewor
   return true;
 }
 
+/** @brief Returns the number of interleaved channels carried by the track's audio Buffer.
+ *  The Buffer carries the input's channel layout. The AudioGraph maps it onto the output device's channels.
+ */
+unsigned int Track::get_stream_channels() const
+{
+  if (has_audio_input() && get_audio_input()->get_type() == framework::File)
+  {
+    return std::dynamic_pointer_cast<File>(get_audio_input())->get_channels();
+  }
+
+  if (has_audio_input() && get_audio_input()->get_type() == framework::Device)
+  {
+    return std::dynamic_pointer_cast<Device>(get_audio_input())->get_input_channels();
+  }
+
+  if (has_audio_input() && get_audio_input()->get_type() == framework::Network)
+  {
+    return std::dynamic_pointer_cast<NetworkStream>(get_audio_input())->get_channels();
+  }
+
+  if (has_audio_output() && get_audio_output()->get_type() == framework::Device)
+  {
+    return std::dynamic_pointer_cast<Device>(get_audio_output())->get_output_channels();
+  }
+
+  if (has_audio_output() && get_audio_output()->get_type() == framework::Network)
+  {
+    return std::dynamic_pointer_cast<NetworkStream>(get_audio_output())->get_channels();
+  }
+
+  return 2;
+}
+
+/** @brief Build and compile the AudioGraph rendered by the output device or network stream.
+ *  OutputNode (device) <- ProcessorNode (effects) <- InputNode (track Buffer)
+ */
+bool Track::build_audio_graph(const framework::BufferPtr &buffer, const framework::StreamConfig &config)
+{
+  // A network output has no device clock, so its graph renders at the stream's own format
+  DevicePtr device = std::dynamic_pointer_cast<Device>(get_audio_output());
+  NetworkStreamPtr network = std::dynamic_pointer_cast<NetworkStream>(get_audio_output());
+
+  const unsigned int sample_rate = network ? network->get_sample_rate() : DeviceService::get_stream_sample_rate(device, config);
+  const unsigned int output_channels = network ? network->get_channels() : device->get_output_channels();
+
+  p_audio_graph = std::make_shared<dataplane::AudioGraph>();
+  p_audio_graph->set_worker_threads(config.worker_threads, config.schedule_realtime);
+  p_audio_graph->set_midi_queue(p_midi_queue);
+  p_audio_graph->set_statistics(p_statistics);
+  p_audio_graph->set_resample_quality(config.resample_quality);
+  auto output_node = p_audio_graph->add_output_node(get_audio_output());
+  output_node->set_meter(p_meter);
+  auto processor_node = p_audio_graph->add_processor_node(output_node);
+  for (const IProcessorPtr &processor : m_effects_processors)
+  {
+    processor_node->add_processor(processor);
+  }
+  p_effects_node = processor_node;
+  p_input_node.reset();
+
+  if (has_audio_input())
+  {
+    auto input_node = p_audio_graph->add_input_node(get_audio_input(), processor_node);
+    p_input_node = input_node;
+
+    // A file streams at its own rate from its own read-ahead ring, and a network input from its jitter
+    // buffer, so the input node converts them when they differ from the device's
+    FilePtr file = get_input_file();
+    framework::AudioSourcePtr file_source = file ? file->get_audio_source() : nullptr;
+    NetworkStreamPtr network_input = std::dynamic_pointer_cast<NetworkStream>(get_audio_input());
+    framework::AudioSourcePtr network_source = network_input ? network_input->get_audio_source() : nullptr;
+    if (file_source)
+    {
+      input_node->set_source(file_source, get_stream_channels(), file->get_sample_rate());
+    }
+    else if (network_source)
+    {
+      input_node->set_source(network_source, get_stream_channels(), network_input->get_sample_rate());
+    }
+    else if (DevicePtr input_device = std::dynamic_pointer_cast<Device>(get_audio_input()))
+    {
+      // A separate input device writes the ring on its own clock, which drifts against the one rendering
+      // the graph, so the node follows the drift instead of slowly overflowing or draining the ring
+      const bool same_device = device && *input_device == *device;
+      input_node->set_source(buffer, get_stream_channels(),
+                             same_device ? 0 : DeviceService::get_stream_sample_rate(input_device, config));
+      input_node->set_drift_compensation(!same_device);
+    }
+    else
+    {
+      input_node->set_source(buffer, get_stream_channels(), file ? file->get_sample_rate() : 0);
+    }
+  }
+
+  if (!p_audio_graph->compile(output_channels, config.frames_per_buffer, sample_rate))
+  {
+    LOG_ERROR("Track: play - Failed to compile AudioGraph for ", get_audio_output()->to_string());
+    return false;
+  }
+
+  return true;
+}
+
+/** @brief Attach the track's device input and output to the streams a DeviceService shares between tracks.
+ *  An input and output on the same device are attached as one route, so the shared stream captures the
+ *  block and renders it back out in the same callback.
+ */
+bool Track::attach_device_streams(const framework::BufferPtr &buffer, const framework::StreamConfig &config,
+                                  DeviceService &device_service, bool attach_input, bool attach_output)
+{
+  DevicePtr input = attach_input ? std::dynamic_pointer_cast<Device>(get_audio_input()) : nullptr;
+  DevicePtr output = attach_output ? std::dynamic_pointer_cast<Device>(get_audio_output()) : nullptr;
+
+  if (output && !build_audio_graph(buffer, config))
+  {
+    return false;
+  }
+
+  std::vector<SharedStreamRoute> routes;
+  if (input && output && *input == *output)
+  {
+    routes.push_back(SharedStreamRoute{output, p_audio_graph, buffer});
+  }
+  else
+  {
+    if (input)
+    {
+      routes.push_back(SharedStreamRoute{input, nullptr, buffer});
+    }
+    if (output)
+    {
+      routes.push_back(SharedStreamRoute{output, p_audio_graph, nullptr});
+    }
+  }
+
+  p_device_service = &device_service;
+  for (const SharedStreamRoute &route : routes)
+  {
+    LOG_INFO("Track: play - Attaching to the shared stream of ", route.device->to_string());
+    if (!device_service.attach_to_stream(route.device, route.graph, route.capture, p_statistics, config,
+                                         route.graph ? p_gate : nullptr))
+    {
+      LOG_ERROR("Track: play - Failed to attach to the shared stream of ", route.device->to_string());
+      detach_device_streams();
+      return false;
+    }
+    m_shared_routes.push_back(route);
+  }
+
+  return true;
+}
+
+void Track::detach_device_streams()
+{
+  if (p_device_service == nullptr)
+  {
+    return;
+  }
+
+  for (const SharedStreamRoute &route : m_shared_routes)
+  {
+    p_device_service->detach_from_stream(route.device, route.graph, route.capture);
+  }
+  m_shared_routes.clear();
+  p_device_service = nullptr;
+}
+
+bool Track::is_duplex_track(const framework::StreamConfig &config) const
+{
+  if (!config.duplex || !has_audio_input() || !has_audio_output())
+  {
+    return false;
+  }
+
+  DevicePtr input = std::dynamic_pointer_cast<Device>(get_audio_input());
+  DevicePtr output = std::dynamic_pointer_cast<Device>(get_audio_output());
+  return input && output && *input == *output && output->is_duplex();
+}
+
+/** @brief Open the shared input and output device as one full-duplex stream.
+ *  The callback captures into the track Buffer and renders the AudioGraph straight after, so the
+ *  monitored input reaches the output in the same period instead of waiting in the ring buffer.
+ */
+bool Track::open_duplex_stream(const framework::BufferPtr &buffer, const framework::StreamConfig &config)
+{
+  DevicePtr device = std::dynamic_pointer_cast<Device>(get_audio_output());
+  LOG_INFO("Track: play - Opening full-duplex audio stream ", device->to_string());
+
+  if (!build_audio_graph(buffer, config))
+  {
+    return false;
+  }
+  device->set_audio_graph(p_audio_graph);
+  device->set_statistics(p_statistics);
+
+  if (device->is_stream_open() && !device->close_stream())
+  {
+    LOG_ERROR("Track: play - Failed to close stream ", device->to_string());
+    return false;
+  }
+
+  if (!device->open_duplex_stream(buffer, config))
+  {
+    LOG_WARNING("Track: play - Failed to open a full-duplex stream, opening separate input and output streams for ",
+                device->to_string());
+    return false;
+  }
+
+  LOG_INFO("Track: play - Round-trip latency ", device->get_latency_frames(), " frames");
+  return true;
+}
+
+bool Track::is_recording_track() const
+{
+  return has_audio_input() && get_audio_input()->get_type() == framework::Device &&
+         has_audio_output() && get_audio_output()->get_type() == framework::File;
+}
+
+/** @brief Create the output file and attach a FileWriter to the input device.
+ *  The audio thread copies each captured block into the writer's preallocated chunks and the
+ *  writer thread issues the disk writes, so the input callback never waits on the disk.
+ */
+bool Track::start_recording(const framework::StreamConfig &config)
+{
+  DevicePtr device = std::dynamic_pointer_cast<Device>(get_audio_input());
+  FilePtr file = std::dynamic_pointer_cast<File>(get_audio_output());
+
+  const unsigned int sample_rate = DeviceService::get_stream_sample_rate(device, config);
+
+  adapters::FileWriter::Config writer_config;
+  writer_config.preallocate_frames = static_cast<unsigned long long>(config.record_preallocate_seconds) * sample_rate;
+
+  auto recorder = std::make_shared<adapters::FileWriter>();
+  recorder->set_statistics(p_statistics);
+  if (!recorder->open(file->get_filepath(), device->get_input_channels(), sample_rate, writer_config))
+  {
+    LOG_ERROR("Track: play - Failed to start recording to ", file->to_string());
+    return false;
+  }
+
+  device->set_statistics(p_statistics);
+  device->set_recorder(recorder);
+  p_recorder = recorder;
+
+  LOG_INFO("Track: play - Recording ", device->get_name(), " to ", file->get_filepath().string());
+  return true;
+}
+
+/** @brief Stop capturing, then let the writer flush its queued chunks and finalize the file. */
+bool Track::stop_recording()
+{
+  // The input stream must be closed first so the audio thread no longer writes to the recorder
+  if (DevicePtr device = std::dynamic_pointer_cast<Device>(get_audio_input()))
+  {
+    if (device->is_stream_open() && !device->close_stream())
+    {
+      LOG_ERROR("Track: stop - Failed to close recording input ", device->to_string());
+      return false;
+    }
+    device->set_recorder(nullptr);
+  }
+
+  const bool success = p_recorder->close();
+  LOG_INFO("Track: stop - Recorded ", p_recorder->get_frames_written(), " frames to ", p_recorder->get_path().string(),
+           ", dropped ", p_recorder->get_dropped_frames());
+  p_recorder.reset();
+  return success;
+}
+
 std::string Track::to_string() const
 {
   IInputOutputPtr audio_input = get_audio_input();
@@ -389,24 +840,11 @@ std::string Track::to_string() const
   IInputOutputPtr midi_input = get_midi_input();
   IInputOutputPtr midi_output = get_midi_output();
 
-  std::string audio_input_str = audio_input ?
-    (audio_input->get_type() == framework::Device  ?
-    std::dynamic_pointer_cast<Device>(audio_input)->to_string() : std::dynamic_pointer_cast<File>(audio_input)->to_string()) : "None";
-
-  std::string audio_output_str = audio_output ?
-    (audio_output->get_type() == framework::Device  ?
-    std::dynamic_pointer_cast<Device>(audio_output)->to_string() : std::dynamic_pointer_cast<File>(audio_output)->to_string()) : "None";
-
-  std::string midi_input_str = midi_input ?
-    (midi_input->get_type() == framework::Device  ?
-    std::dynamic_pointer_cast<Device>(midi_input)->to_string() : std::dynamic_pointer_cast<File>(midi_input)->to_string()) : "None";
-
-  std::string midi_output_str = midi_output ?
-    (midi_output->get_type() == framework::Device  ?
-    std::dynamic_pointer_cast<Device>(midi_output)->to_string() : std::dynamic_pointer_cast<File>(midi_output)->to_string()) : "None";
+  // Devices, files and network streams each describe themselves
+  auto describe = [](const IInputOutputPtr &io) { return io ? io->to_string() : std::string("None"); };
 
-  return "Track(AudioInput=" + audio_input_str +
-         ", AudioOutput=" + audio_output_str +
-         ", MidiInput=" + midi_input_str +
-         ", MidiOutput=" + midi_output_str + ")";
+  return "Track(AudioInput=" + describe(audio_input) +
+         ", AudioOutput=" + describe(audio_output) +
+         ", MidiInput=" + describe(midi_input) +
+         ", MidiOutput=" + describe(midi_output) + ")";
 }
\ No newline at end of file
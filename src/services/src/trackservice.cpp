@@ -1,16 +1,23 @@
 #include "trackservice.h"
 #include "logger.h"
 
+#include <algorithm>
+#include <thread>
+
 using namespace miniaudioengine;
 
+TrackService::TrackService(DeviceService *device_service) : p_device_service(device_service) {}
+
 /** @brief Create a new track.
  *  @return Shared pointer to the new track.
  */
 TrackPtr TrackService::add_track()
 {
   auto new_track = std::make_shared<Track>();
+
+  std::lock_guard<std::mutex> lock(m_tracks_mutex);
   m_tracks.push_back(new_track);
-  LOG_INFO("TrackService: Created Track. Total Track(s): ", get_tracks().size());
+  LOG_INFO("TrackService: Created Track. Total Track(s): ", m_tracks.size());
   return new_track;
 }
 
@@ -25,38 +32,87 @@ bool TrackService::remove_track(TrackPtr track)
     return false;
   }
 
+  std::lock_guard<std::mutex> lock(m_tracks_mutex);
   auto found = std::find(m_tracks.begin(), m_tracks.end(), track);
-  TrackPtr found_track = *found;
-  if (!found_track)
+  if (found == m_tracks.end())
   {
+    LOG_WARNING("TrackService: remove_track - Track not found.");
     return false;
   }
 
   m_tracks.erase(found);
 
-  LOG_INFO("TrackService: Removed Track. Total Track(s): ", get_tracks().size());
+  LOG_INFO("TrackService: Removed Track. Total Track(s): ", m_tracks.size());
   return true;
 }
 
+std::vector<TrackPtr> TrackService::get_tracks() const
+{
+  std::lock_guard<std::mutex> lock(m_tracks_mutex);
+  return m_tracks;
+}
+
+size_t TrackService::get_track_count() const
+{
+  std::lock_guard<std::mutex> lock(m_tracks_mutex);
+  return m_tracks.size();
+}
+
 /** @brief Clear all tracks except MainTrack.
  */
 void TrackService::clear_tracks()
 {
+  std::lock_guard<std::mutex> lock(m_tracks_mutex);
+  const size_t cleared = m_tracks.size();
   m_tracks.clear();
   // TODO - Make sure each Track removed is cleaned up
-  LOG_INFO("TrackService: Cleared ", get_tracks().size(), " Track(s) after clear: ", get_tracks().size());
+  LOG_INFO("TrackService: Cleared ", cleared, " Track(s). Track(s) after clear: ", m_tracks.size());
+}
+
+bool TrackService::play(const framework::StreamConfig &config)
+{
+  // Tracks are played outside the lock, so a slow device open never blocks add_track()/remove_track()
+  const std::vector<TrackPtr> tracks = get_tracks();
+  LOG_INFO("TrackService: play - ", tracks.size(), " Track(s)");
+  for (const auto &track : tracks)
+  {
+    track->arm_start();
+  }
+
+  for (size_t i = 0; i < tracks.size(); i++)
+  {
+    const bool playing = p_device_service != nullptr ? tracks[i]->play(config, *p_device_service) : tracks[i]->play(config);
+    if (!playing)
+    {
+      LOG_ERROR("TrackService: play - Track ", i, " failed to start. Stopping ", i + 1, " Track(s).");
+      for (size_t started = i + 1; started-- > 0;)
+      {
+        tracks[started]->stop();
+      }
+      // The tracks not played yet were armed too, and would otherwise wait for a start that never comes
+      for (size_t unstarted = i + 1; unstarted < tracks.size(); unstarted++)
+      {
+        tracks[unstarted]->disarm_start();
+      }
+      return false;
+    }
+  }
+  return true;
 }
 
-bool TrackService::play()
+bool TrackService::wait_for_preroll(size_t frames, std::chrono::milliseconds timeout) const
 {
-  LOG_INFO("TrackService: play - ", get_tracks().size(), " Track(s)");
-  for (const auto &track : m_tracks)
+  const std::vector<TrackPtr> tracks = get_tracks();
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (!std::all_of(tracks.begin(), tracks.end(), [frames](const TrackPtr &track) {
+           return !track->is_playing() || track->is_prerolled(frames);
+         }))
   {
-    if (!track->play())
+    if (std::chrono::steady_clock::now() >= deadline)
     {
-      track->stop();
       return false;
     }
+    std::this_thread::sleep_for(PREROLL_POLL_INTERVAL);
   }
   return true;
 }
@@ -64,7 +120,7 @@ bool TrackService::play()
 bool TrackService::stop()
 {
   LOG_INFO("TrackService: stop");
-  for (const auto &track : m_tracks)
+  for (const auto &track : get_tracks())
   {
     if (!track->stop())
     {